@@ -907,6 +907,8 @@ __SYSCALL(__NR_process_mrelease, sys_process_mrelease)
 __SYSCALL(__NR_futex_waitv, sys_futex_waitv)
 #define __NR_set_mempolicy_home_node 450
 __SYSCALL(__NR_set_mempolicy_home_node, sys_set_mempolicy_home_node)
+#define __NR_futex_wakev 451
+__SYSCALL(__NR_futex_wakev, sys_futex_wakev)
 
 /*
  * Please add new compat syscalls above this comment and update
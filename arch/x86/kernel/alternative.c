@@ -1371,6 +1371,10 @@ void __init alternative_instructions(void)
 	 * Doing paravirt patching after alternative patching would clobber
 	 * the optimization of the custom code with a function call again.
 	 */
+
+	/* Pick the NUMA-aware spinlock slowpath before it's patched in. */
+	cna_configure_spin_lock_slowpath();
+
 	paravirt_set_cap();
 
 	/*
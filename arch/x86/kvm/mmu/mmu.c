@@ -4393,6 +4393,100 @@ int kvm_tdp_page_fault(struct kvm_vcpu *vcpu, struct kvm_page_fault *fault)
 	return direct_page_fault(vcpu, fault);
 }
 
+#ifdef CONFIG_HAVE_KVM_PRE_FAULT_MEMORY
+/*
+ * Map @gpa as if the guest had faulted on it, and return the level of the
+ * resulting mapping in @level.
+ */
+static int kvm_tdp_map_page(struct kvm_vcpu *vcpu, gpa_t gpa, u32 error_code,
+			    u8 *level)
+{
+	int r;
+
+	/*
+	 * Restrict to TDP page fault, since that's the only case where the MMU
+	 * is indexed by GPA.
+	 */
+	if (vcpu->arch.mmu->page_fault != kvm_tdp_page_fault)
+		return -EOPNOTSUPP;
+
+	do {
+		struct kvm_page_fault fault = {
+			.addr = gpa,
+			.error_code = error_code,
+			.exec = error_code & PFERR_FETCH_MASK,
+			.write = error_code & PFERR_WRITE_MASK,
+			.present = error_code & PFERR_PRESENT_MASK,
+			.rsvd = error_code & PFERR_RSVD_MASK,
+			.user = error_code & PFERR_USER_MASK,
+			.prefetch = true,
+			.is_tdp = true,
+			.nx_huge_page_workaround_enabled =
+				is_nx_huge_page_enabled(vcpu->kvm),
+
+			.max_level = KVM_MAX_HUGEPAGE_LEVEL,
+			.req_level = PG_LEVEL_4K,
+			.goal_level = PG_LEVEL_4K,
+		};
+
+		if (signal_pending(current))
+			return -EINTR;
+		cond_resched();
+
+		r = kvm_tdp_page_fault(vcpu, &fault);
+		*level = fault.goal_level;
+	} while (r == RET_PF_RETRY);
+
+	if (r < 0)
+		return r;
+
+	switch (r) {
+	case RET_PF_FIXED:
+	case RET_PF_SPURIOUS:
+		return 0;
+
+	case RET_PF_EMULATE:
+		return -ENOENT;
+
+	case RET_PF_RETRY:
+	case RET_PF_CONTINUE:
+	case RET_PF_INVALID:
+	default:
+		WARN_ONCE(1, "could not fix page fault during prefault");
+		return -EIO;
+	}
+}
+
+long kvm_arch_vcpu_pre_fault_memory(struct kvm_vcpu *vcpu,
+				    struct kvm_pre_fault_memory *range)
+{
+	/* a plain read fault, the mapping is still made writable if possible */
+	u32 error_code = 0;
+	u8 level = PG_LEVEL_4K;
+	u64 end;
+	int r;
+
+	/*
+	 * reload is efficient when called repeatedly, so we can do it on
+	 * every iteration.
+	 */
+	r = kvm_mmu_reload(vcpu);
+	if (r)
+		return r;
+
+	r = kvm_tdp_map_page(vcpu, range->gpa, error_code, &level);
+	if (r < 0)
+		return r;
+
+	/*
+	 * If the mapping that covers range->gpa can use a huge page, it
+	 * may start below it or end after range->gpa + range->size.
+	 */
+	end = (range->gpa & KVM_HPAGE_MASK(level)) + KVM_HPAGE_SIZE(level);
+	return min(range->size, end - range->gpa);
+}
+#endif
+
 static void nonpaging_init_context(struct kvm_mmu *context)
 {
 	context->page_fault = nonpaging_page_fault;
@@ -6485,7 +6579,7 @@ void kvm_mmu_zap_collapsible_sptes(struct kvm *kvm,
 
 	if (is_tdp_mmu_enabled(kvm)) {
 		read_lock(&kvm->mmu_lock);
-		kvm_tdp_mmu_zap_collapsible_sptes(kvm, slot);
+		kvm_tdp_mmu_recover_huge_pages(kvm, slot);
 		read_unlock(&kvm->mmu_lock);
 	}
 }
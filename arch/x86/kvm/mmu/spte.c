@@ -308,6 +308,35 @@ u64 make_huge_page_split_spte(struct kvm *kvm, u64 huge_spte, union kvm_mmu_page
 	return child_spte;
 }
 
+/*
+ * Construct a huge page SPTE of the given level from one of the small SPTEs
+ * it replaces.  This is the inverse of make_huge_page_split_spte() and is used
+ * to recover huge pages in place, e.g. after dirty logging is disabled.
+ */
+u64 make_huge_spte(struct kvm *kvm, u64 small_spte, int level)
+{
+	u64 huge_spte;
+
+	if (WARN_ON_ONCE(!is_shadow_present_pte(small_spte)))
+		return 0;
+
+	if (WARN_ON_ONCE(level == PG_LEVEL_4K))
+		return 0;
+
+	huge_spte = small_spte | PT_PAGE_SIZE_MASK;
+
+	/*
+	 * huge_spte already has the address of the sub-page being collapsed
+	 * from small_spte, so just clear the lower address bits to create the
+	 * huge page address.
+	 */
+	huge_spte &= KVM_HPAGE_MASK(level) | ~PAGE_MASK;
+
+	if (is_nx_huge_page_enabled(kvm))
+		huge_spte |= shadow_nx_mask;
+
+	return huge_spte;
+}
 
 u64 make_nonleaf_spte(u64 *child_pt, bool ad_disabled)
 {
@@ -217,6 +217,14 @@ static unsigned int g_mbps;
 module_param_named(mbps, g_mbps, uint, 0444);
 MODULE_PARM_DESC(mbps, "Limit maximum bandwidth (in MiB/s). Default: 0 (no limit)");
 
+static unsigned int g_iops;
+module_param_named(iops, g_iops, uint, 0444);
+MODULE_PARM_DESC(iops, "Limit the commands per second of each hardware queue, with irqmode=2. Default: 0 (no limit)");
+
+static unsigned long g_rw_penalty_nsec;
+module_param_named(rw_penalty_nsec, g_rw_penalty_nsec, ulong, 0444);
+MODULE_PARM_DESC(rw_penalty_nsec, "Time in ns added to a command of a different direction than the previous one on its queue, with irqmode=2. Default: 0");
+
 static bool g_zoned;
 module_param_named(zoned, g_zoned, bool, S_IRUGO);
 MODULE_PARM_DESC(zoned, "Make device as a host-managed zoned block device. Default: false");
@@ -241,6 +249,10 @@ static unsigned int g_zone_max_active;
 module_param_named(zone_max_active, g_zone_max_active, uint, 0444);
 MODULE_PARM_DESC(zone_max_active, "Maximum number of active zones when block device is zoned. Default: 0 (no limit)");
 
+static unsigned long g_zone_write_nsec;
+module_param_named(zone_write_nsec, g_zone_write_nsec, ulong, 0444);
+MODULE_PARM_DESC(zone_write_nsec, "Time in ns a write holds the write pointer of its zone, with irqmode=2. Default: 0");
+
 static struct nullb_device *null_alloc_dev(void);
 static void null_free_dev(struct nullb_device *dev);
 static void null_del_dev(struct nullb *nullb);
@@ -417,6 +429,8 @@ NULLB_DEVICE_ATTR(use_per_node_hctx, bool, NULL);
 NULLB_DEVICE_ATTR(memory_backed, bool, NULL);
 NULLB_DEVICE_ATTR(discard, bool, NULL);
 NULLB_DEVICE_ATTR(mbps, uint, NULL);
+NULLB_DEVICE_ATTR(iops, uint, NULL);
+NULLB_DEVICE_ATTR(rw_penalty_nsec, ulong, NULL);
 NULLB_DEVICE_ATTR(cache_size, ulong, NULL);
 NULLB_DEVICE_ATTR(zoned, bool, NULL);
 NULLB_DEVICE_ATTR(zone_size, ulong, NULL);
@@ -424,6 +438,7 @@ NULLB_DEVICE_ATTR(zone_capacity, ulong, NULL);
 NULLB_DEVICE_ATTR(zone_nr_conv, uint, NULL);
 NULLB_DEVICE_ATTR(zone_max_open, uint, NULL);
 NULLB_DEVICE_ATTR(zone_max_active, uint, NULL);
+NULLB_DEVICE_ATTR(zone_write_nsec, ulong, NULL);
 NULLB_DEVICE_ATTR(virt_boundary, bool, NULL);
 NULLB_DEVICE_ATTR(no_sched, bool, NULL);
 NULLB_DEVICE_ATTR(shared_tag_bitmap, bool, NULL);
@@ -523,6 +538,105 @@ static ssize_t nullb_device_badblocks_store(struct config_item *item,
 }
 CONFIGFS_ATTR(nullb_device_, badblocks);
 
+/*
+ * The completion latency distribution is given as a list of up to
+ * NULLB_LAT_POINTS "percentile:nsec" pairs, e.g. "50:20000,99.9:400000".
+ * Latencies are interpolated between the points, starting from
+ * completion_nsec at the 0th percentile.  An empty string clears it.
+ */
+static ssize_t nullb_device_completion_dist_show(struct config_item *item,
+						 char *page)
+{
+	struct nullb_device *dev = to_nullb_device(item);
+	ssize_t len = 0;
+	unsigned int i;
+
+	for (i = 0; i < dev->nr_lat_points; i++)
+		len += sysfs_emit_at(page, len, "%s%u.%02u:%llu",
+				     i ? "," : "", dev->lat_pct[i] / 100,
+				     dev->lat_pct[i] % 100, dev->lat_nsec[i]);
+	len += sysfs_emit_at(page, len, "\n");
+	return len;
+}
+
+static int nullb_parse_pct(char *str, u16 *pct)
+{
+	char *frac = strchr(str, '.');
+	unsigned int whole, part = 0;
+	int ret;
+
+	if (frac) {
+		*frac++ = '\0';
+		if (!*frac || strlen(frac) > 2)
+			return -EINVAL;
+		ret = kstrtouint(frac, 10, &part);
+		if (ret)
+			return ret;
+		if (strlen(frac) == 1)
+			part *= 10;
+	}
+
+	ret = kstrtouint(str, 10, &whole);
+	if (ret)
+		return ret;
+	if (whole > 100 || whole * 100 + part > 10000)
+		return -EINVAL;
+
+	*pct = whole * 100 + part;
+	return 0;
+}
+
+static ssize_t nullb_device_completion_dist_store(struct config_item *item,
+						  const char *page, size_t count)
+{
+	struct nullb_device *dev = to_nullb_device(item);
+	u16 pct[NULLB_LAT_POINTS];
+	u64 nsec[NULLB_LAT_POINTS];
+	unsigned int n = 0;
+	char *orig, *buf, *tok, *sep;
+	int ret = 0;
+
+	if (test_bit(NULLB_DEV_FL_CONFIGURED, &dev->flags))
+		return -EBUSY;
+
+	orig = kstrndup(page, count, GFP_KERNEL);
+	if (!orig)
+		return -ENOMEM;
+
+	buf = strstrip(orig);
+	while (*buf && (tok = strsep(&buf, ",")) != NULL) {
+		ret = -EINVAL;
+		sep = strchr(tok, ':');
+		if (!sep || n == NULLB_LAT_POINTS)
+			goto out;
+		*sep = '\0';
+
+		ret = nullb_parse_pct(strim(tok), &pct[n]);
+		if (ret)
+			goto out;
+		ret = kstrtoull(strim(sep + 1), 0, &nsec[n]);
+		if (ret)
+			goto out;
+
+		ret = -EINVAL;
+		if (!pct[n] || (n && (pct[n] <= pct[n - 1] ||
+				      nsec[n] < nsec[n - 1])))
+			goto out;
+		n++;
+		if (!buf)
+			break;
+	}
+
+	memcpy(dev->lat_pct, pct, n * sizeof(pct[0]));
+	memcpy(dev->lat_nsec, nsec, n * sizeof(nsec[0]));
+	dev->nr_lat_points = n;
+	ret = count;
+out:
+	kfree(orig);
+	return ret;
+}
+CONFIGFS_ATTR(nullb_device_, completion_dist);
+
 static ssize_t nullb_device_zone_readonly_store(struct config_item *item,
 						const char *page, size_t count)
 {
@@ -544,6 +658,7 @@ CONFIGFS_ATTR_WO(nullb_device_, zone_offline);
 static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_size,
 	&nullb_device_attr_completion_nsec,
+	&nullb_device_attr_completion_dist,
 	&nullb_device_attr_submit_queues,
 	&nullb_device_attr_poll_queues,
 	&nullb_device_attr_home_node,
@@ -559,6 +674,8 @@ static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_memory_backed,
 	&nullb_device_attr_discard,
 	&nullb_device_attr_mbps,
+	&nullb_device_attr_iops,
+	&nullb_device_attr_rw_penalty_nsec,
 	&nullb_device_attr_cache_size,
 	&nullb_device_attr_badblocks,
 	&nullb_device_attr_zoned,
@@ -567,6 +684,7 @@ static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_zone_nr_conv,
 	&nullb_device_attr_zone_max_open,
 	&nullb_device_attr_zone_max_active,
+	&nullb_device_attr_zone_write_nsec,
 	&nullb_device_attr_zone_readonly,
 	&nullb_device_attr_zone_offline,
 	&nullb_device_attr_virt_boundary,
@@ -629,12 +747,14 @@ static ssize_t memb_group_features_show(struct config_item *item, char *page)
 {
 	return snprintf(page, PAGE_SIZE,
 			"badblocks,blocking,blocksize,cache_size,"
-			"completion_nsec,discard,home_node,hw_queue_depth,"
-			"irqmode,max_sectors,mbps,memory_backed,no_sched,"
-			"poll_queues,power,queue_mode,shared_tag_bitmap,size,"
-			"submit_queues,use_per_node_hctx,virt_boundary,zoned,"
-			"zone_capacity,zone_max_active,zone_max_open,"
-			"zone_nr_conv,zone_offline,zone_readonly,zone_size\n");
+			"completion_dist,completion_nsec,discard,home_node,"
+			"hw_queue_depth,iops,irqmode,max_sectors,mbps,"
+			"memory_backed,no_sched,poll_queues,power,queue_mode,"
+			"rw_penalty_nsec,shared_tag_bitmap,size,submit_queues,"
+			"use_per_node_hctx,virt_boundary,zoned,zone_capacity,"
+			"zone_max_active,zone_max_open,zone_nr_conv,"
+			"zone_offline,zone_readonly,zone_size,"
+			"zone_write_nsec\n");
 }
 
 CONFIGFS_ATTR_RO(memb_group_, features);
@@ -700,6 +820,8 @@ static struct nullb_device *null_alloc_dev(void)
 	dev->discard = g_discard;
 	dev->cache_size = g_cache_size;
 	dev->mbps = g_mbps;
+	dev->iops = g_iops;
+	dev->rw_penalty_nsec = g_rw_penalty_nsec;
 	dev->use_per_node_hctx = g_use_per_node_hctx;
 	dev->zoned = g_zoned;
 	dev->zone_size = g_zone_size;
@@ -707,6 +829,7 @@ static struct nullb_device *null_alloc_dev(void)
 	dev->zone_nr_conv = g_zone_nr_conv;
 	dev->zone_max_open = g_zone_max_open;
 	dev->zone_max_active = g_zone_max_active;
+	dev->zone_write_nsec = g_zone_write_nsec;
 	dev->virt_boundary = g_virt_boundary;
 	dev->no_sched = g_no_sched;
 	dev->shared_tag_bitmap = g_shared_tag_bitmap;
@@ -818,9 +941,82 @@ static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
+/* Draw a latency from the distribution, @r is in 1/100 percent. */
+static u64 null_sample_latency(struct nullb_device *dev, u32 r)
+{
+	u64 lo = dev->completion_nsec, hi;
+	u32 lo_pct = 0, hi_pct;
+	unsigned int i;
+
+	for (i = 0; i < dev->nr_lat_points; i++) {
+		hi_pct = dev->lat_pct[i];
+		hi = dev->lat_nsec[i];
+		if (r < hi_pct) {
+			if (hi <= lo)
+				return hi;
+			return lo + div_u64((hi - lo) * (r - lo_pct),
+					    hi_pct - lo_pct);
+		}
+		lo_pct = hi_pct;
+		lo = hi;
+	}
+
+	return lo;
+}
+
+/*
+ * The time to complete @cmd in: its latency, plus the read/write switch
+ * penalty, plus the time it has to wait for the commands before it when
+ * the queue is at its iops cap, plus the time it waited for the write
+ * pointer of its zone.  Zone append commands don't wait for each other, but
+ * the device may place them in any order, so they get up to zone_write_nsec
+ * of jitter instead.  The random state is per queue, so that a run can be
+ * reproduced.
+ */
+static ktime_t null_cmd_delay(struct nullb_cmd *cmd)
+{
+	struct nullb_queue *nq = cmd->nq;
+	struct nullb_device *dev = nq->dev;
+	u64 delay = dev->completion_nsec, now, start;
+	unsigned long flags;
+	enum req_op op;
+	bool write;
+
+	if (!dev->nr_lat_points && !dev->iops && !dev->rw_penalty_nsec &&
+	    !dev->zone_write_nsec)
+		return delay;
+
+	if (dev->queue_mode == NULL_Q_BIO)
+		op = bio_op(cmd->bio);
+	else
+		op = req_op(cmd->rq);
+	write = op_is_write(op);
+	delay += cmd->zone_nsec;
+
+	spin_lock_irqsave(&nq->delay_lock, flags);
+	if (dev->nr_lat_points)
+		delay = cmd->zone_nsec + null_sample_latency(dev,
+				prandom_u32_state(&nq->rnd) % 10000);
+	if (op == REQ_OP_ZONE_APPEND && dev->zone_write_nsec)
+		delay += prandom_u32_state(&nq->rnd) % dev->zone_write_nsec;
+	if (write != nq->last_write) {
+		delay += dev->rw_penalty_nsec;
+		nq->last_write = write;
+	}
+	if (dev->iops) {
+		now = ktime_get_ns();
+		start = max(now, nq->iops_next);
+		nq->iops_next = start + NSEC_PER_SEC / dev->iops;
+		delay += start - now;
+	}
+	spin_unlock_irqrestore(&nq->delay_lock, flags);
+
+	return ns_to_ktime(delay);
+}
+
 static void null_cmd_end_timer(struct nullb_cmd *cmd)
 {
-	ktime_t kt = cmd->nq->dev->completion_nsec;
+	ktime_t kt = null_cmd_delay(cmd);
 
 	hrtimer_start(&cmd->timer, kt, HRTIMER_MODE_REL);
 }
@@ -1458,6 +1654,8 @@ static blk_status_t null_handle_cmd(struct nullb_cmd *cmd, sector_t sector,
 	struct nullb *nullb = dev->nullb;
 	blk_status_t sts;
 
+	cmd->zone_nsec = 0;
+
 	if (test_bit(NULLB_DEV_FL_THROTTLED, &dev->flags)) {
 		sts = null_handle_throttled(cmd);
 		if (sts != BLK_STS_OK)
@@ -1736,6 +1934,10 @@ static void null_init_queue(struct nullb *nullb, struct nullb_queue *nq)
 	nq->dev = nullb->dev;
 	INIT_LIST_HEAD(&nq->poll_list);
 	spin_lock_init(&nq->poll_lock);
+	spin_lock_init(&nq->delay_lock);
+	prandom_seed_state(&nq->rnd, nq - nullb->queues);
+	nq->iops_next = 0;
+	nq->last_write = false;
 }
 
 static int null_init_hctx(struct blk_mq_hw_ctx *hctx, void *driver_data,
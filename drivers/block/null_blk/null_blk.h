@@ -14,6 +14,7 @@
 #include <linux/fault-inject.h>
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
+#include <linux/prandom.h>
 
 struct nullb_cmd {
 	union {
@@ -25,6 +26,7 @@ struct nullb_cmd {
 	bool fake_timeout;
 	struct nullb_queue *nq;
 	struct hrtimer timer;
+	u64 zone_nsec; /* time waited for the zone write pointer */
 };
 
 struct nullb_queue {
@@ -37,6 +39,12 @@ struct nullb_queue {
 	struct list_head poll_list;
 	spinlock_t poll_lock;
 
+	/* Completion delay emulation, with irqmode=2 */
+	spinlock_t delay_lock;
+	struct rnd_state rnd;
+	u64 iops_next;		/* When the next command may start, in ns */
+	bool last_write;
+
 	struct nullb_cmd *cmds;
 };
 
@@ -58,8 +66,12 @@ struct nullb_zone {
 	sector_t wp;
 	unsigned int len;
 	unsigned int capacity;
+	u64 wp_busy; /* the write pointer is busy until then, in ns */
 };
 
+/* Points of the completion latency distribution */
+#define NULLB_LAT_POINTS	8
+
 /* Queue modes */
 enum {
 	NULL_Q_BIO	= 0,
@@ -94,6 +106,7 @@ struct nullb_device {
 	unsigned int zone_nr_conv; /* number of conventional zones */
 	unsigned int zone_max_open; /* max number of open zones */
 	unsigned int zone_max_active; /* max number of active zones */
+	unsigned long zone_write_nsec; /* time in ns a write holds the write pointer */
 	unsigned int submit_queues; /* number of submission queues */
 	unsigned int prev_submit_queues; /* number of submission queues before change */
 	unsigned int poll_queues; /* number of IOPOLL submission queues */
@@ -106,6 +119,11 @@ struct nullb_device {
 	unsigned int hw_queue_depth; /* queue depth */
 	unsigned int index; /* index of the disk, only valid with a disk */
 	unsigned int mbps; /* Bandwidth throttle cap (in MB/s) */
+	unsigned int iops; /* Commands per second cap of each queue */
+	unsigned long rw_penalty_nsec; /* time in ns to switch between reads and writes */
+	unsigned int nr_lat_points; /* points of the latency distribution */
+	u16 lat_pct[NULLB_LAT_POINTS]; /* percentiles, in 1/100 percent */
+	u64 lat_nsec[NULLB_LAT_POINTS]; /* latencies at lat_pct, in ns */
 	bool blocking; /* blocking blk-mq device */
 	bool use_per_node_hctx; /* use per-node allocation for hardware context */
 	bool power; /* power on/off the device */
@@ -440,6 +440,14 @@ static blk_status_t null_zone_write(struct nullb_cmd *cmd, sector_t sector,
 	if (ret != BLK_STS_OK)
 		goto unlock;
 
+	/* Regular writes to a zone are serialized on its write pointer. */
+	if (dev->zone_write_nsec && !append) {
+		u64 now = ktime_get_ns(), start = max(now, zone->wp_busy);
+
+		zone->wp_busy = start + dev->zone_write_nsec;
+		cmd->zone_nsec = zone->wp_busy - now;
+	}
+
 	zone->wp += nr_sectors;
 	if (zone->wp == zone->start + zone->capacity) {
 		null_lock_zone_res(dev);
@@ -987,7 +987,8 @@ static size_t rnbd_clt_get_sg_size(struct scatterlist *sglist, u32 len)
 
 static int rnbd_client_xfer_request(struct rnbd_clt_dev *dev,
 				     struct request *rq,
-				     struct rnbd_iu *iu)
+				     struct rnbd_iu *iu,
+				     struct rtrs_clt_plug *plug)
 {
 	struct rtrs_clt_sess *rtrs = dev->sess->rtrs;
 	struct rtrs_permit *permit = iu->permit;
@@ -1026,6 +1027,7 @@ static int rnbd_client_xfer_request(struct rnbd_clt_dev *dev,
 	req_ops = (struct rtrs_clt_req_ops) {
 		.priv = iu,
 		.conf_fn = msg_io_conf,
+		.plug = plug,
 	};
 	err = rtrs_clt_request(rq_data_dir(rq), &req_ops, rtrs, permit,
 			       &vec, 1, size, iu->sgt.sgl, sg_cnt);
@@ -1108,6 +1110,33 @@ static void rnbd_clt_dev_kick_mq_queue(struct rnbd_clt_dev *dev,
 		blk_mq_delay_run_hw_queue(hctx, 10/*ms*/);
 }
 
+/* Get a permit and the sg table for @rq, -EBUSY if there is no permit */
+static int rnbd_prep_iu(struct rnbd_clt_dev *dev, struct request *rq,
+			struct rnbd_iu *iu)
+{
+	int err;
+
+	iu->permit = rnbd_get_permit(dev->sess, RTRS_IO_CON,
+				      RTRS_PERMIT_NOWAIT);
+	if (!iu->permit)
+		return -EBUSY;
+
+	iu->sgt.sgl = iu->first_sgl;
+	err = sg_alloc_table_chained(&iu->sgt,
+				     /* Even-if the request has no segment,
+				      * sglist must have one entry at least.
+				      */
+				     blk_rq_nr_phys_segments(rq) ? : 1,
+				     iu->sgt.sgl,
+				     RNBD_INLINE_SG_CNT);
+	if (err) {
+		rnbd_put_permit(dev->sess, iu->permit);
+		return err;
+	}
+
+	return 0;
+}
+
 static blk_status_t rnbd_queue_rq(struct blk_mq_hw_ctx *hctx,
 				   const struct blk_mq_queue_data *bd)
 {
@@ -1120,30 +1149,19 @@ static blk_status_t rnbd_queue_rq(struct blk_mq_hw_ctx *hctx,
 	if (dev->dev_state != DEV_STATE_MAPPED)
 		return BLK_STS_IOERR;
 
-	iu->permit = rnbd_get_permit(dev->sess, RTRS_IO_CON,
-				      RTRS_PERMIT_NOWAIT);
-	if (!iu->permit) {
+	err = rnbd_prep_iu(dev, rq, iu);
+	if (err == -EBUSY) {
 		rnbd_clt_dev_kick_mq_queue(dev, hctx, RNBD_DELAY_IFBUSY);
 		return BLK_STS_RESOURCE;
 	}
-
-	iu->sgt.sgl = iu->first_sgl;
-	err = sg_alloc_table_chained(&iu->sgt,
-				     /* Even-if the request has no segment,
-				      * sglist must have one entry at least.
-				      */
-				     blk_rq_nr_phys_segments(rq) ? : 1,
-				     iu->sgt.sgl,
-				     RNBD_INLINE_SG_CNT);
 	if (err) {
 		rnbd_clt_err_rl(dev, "sg_alloc_table_chained ret=%d\n", err);
 		rnbd_clt_dev_kick_mq_queue(dev, hctx, 10/*ms*/);
-		rnbd_put_permit(dev->sess, iu->permit);
 		return BLK_STS_RESOURCE;
 	}
 
 	blk_mq_start_request(rq);
-	err = rnbd_client_xfer_request(dev, rq, iu);
+	err = rnbd_client_xfer_request(dev, rq, iu, NULL);
 	if (err == 0)
 		return BLK_STS_OK;
 	if (err == -EAGAIN || err == -ENOMEM) {
@@ -1155,6 +1173,46 @@ static blk_status_t rnbd_queue_rq(struct blk_mq_hw_ctx *hctx,
 	return ret;
 }
 
+/*
+ * Submit a plugged list of requests, posting their RDMA work requests with
+ * one doorbell per connection.  Requests we can't get the resources for
+ * are left on @rqlist, for ->queue_rq() to wait for them.
+ */
+static void rnbd_queue_rqs(struct request **rqlist)
+{
+	struct request *rq = rq_list_peek(rqlist);
+	struct rnbd_clt_dev *dev = rq->q->disk->private_data;
+	struct rtrs_clt_plug plug;
+	struct rnbd_iu *iu;
+	int err;
+
+	if (dev->dev_state != DEV_STATE_MAPPED)
+		return;
+
+	rtrs_clt_start_plug(&plug);
+	while ((rq = rq_list_peek(rqlist))) {
+		iu = blk_mq_rq_to_pdu(rq);
+		if (rnbd_prep_iu(dev, rq, iu))
+			break;
+		rq_list_pop(rqlist);
+
+		blk_mq_start_request(rq);
+		err = rnbd_client_xfer_request(dev, rq, iu, &plug);
+		if (!err)
+			continue;
+
+		sg_free_table_chained(&iu->sgt, RNBD_INLINE_SG_CNT);
+		rnbd_put_permit(dev->sess, iu->permit);
+		if (err == -EAGAIN || err == -ENOMEM) {
+			blk_mq_requeue_request(rq, false);
+			blk_mq_delay_kick_requeue_list(rq->q, 10/*ms*/);
+		} else {
+			blk_mq_end_request(rq, BLK_STS_IOERR);
+		}
+	}
+	rtrs_clt_finish_plug(&plug);
+}
+
 static int rnbd_rdma_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
 {
 	struct rnbd_queue *q = hctx->driver_data;
@@ -1196,6 +1254,7 @@ static void rnbd_rdma_map_queues(struct blk_mq_tag_set *set)
 
 static struct blk_mq_ops rnbd_mq_ops = {
 	.queue_rq	= rnbd_queue_rq,
+	.queue_rqs	= rnbd_queue_rqs,
 	.complete	= rnbd_softirq_done_fn,
 	.map_queues     = rnbd_rdma_map_queues,
 	.poll           = rnbd_rdma_poll,
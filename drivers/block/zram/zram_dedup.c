@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Deduplication of identical compressed objects in zram.
+ *
+ * Every compressed object stored while dedup is enabled gets an entry that
+ * is hashed both by a checksum of its compressed contents and by its
+ * zsmalloc handle. A write that compresses to the same bytes as an existing
+ * object takes a reference on that object instead of allocating a new one,
+ * and the slot is marked ZRAM_DEDUP so that freeing it drops the reference.
+ *
+ * Compression is deterministic for a given algorithm, so comparing the
+ * compressed bytes is sufficient. Only objects compressed with the primary
+ * algorithm are ever inserted.
+ */
+
+#include <linux/hash.h>
+#include <linux/jhash.h>
+#include <linux/log2.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include "zram_drv.h"
+#include "zram_dedup.h"
+
+#define ZRAM_DEDUP_MIN_BITS	8
+#define ZRAM_DEDUP_MAX_BITS	20
+
+struct zram_dedup_entry {
+	struct hlist_node checksum_node;
+	struct hlist_node handle_node;
+	unsigned long handle;
+	unsigned long refcount;
+	unsigned int len;
+	u32 checksum;
+};
+
+u32 zram_dedup_checksum(const void *mem, unsigned int len)
+{
+	return jhash(mem, len, 0);
+}
+
+static struct hlist_head *checksum_head(struct zram *zram, u32 checksum)
+{
+	return &zram->dedup_checksum[hash_32(checksum, zram->dedup_bits)];
+}
+
+static struct hlist_head *handle_head(struct zram *zram, unsigned long handle)
+{
+	return &zram->dedup_handle[hash_long(handle, zram->dedup_bits)];
+}
+
+/*
+ * Look for an object with the same compressed contents as @mem. On success a
+ * reference is taken on the object and its handle returned, 0 otherwise.
+ */
+unsigned long zram_dedup_find(struct zram *zram, const void *mem,
+			      unsigned int len, u32 checksum)
+{
+	struct zram_dedup_entry *entry;
+	unsigned long handle = 0;
+
+	spin_lock(&zram->dedup_lock);
+	hlist_for_each_entry(entry, checksum_head(zram, checksum),
+			     checksum_node) {
+		void *obj;
+		bool match;
+
+		if (entry->checksum != checksum || entry->len != len)
+			continue;
+
+		obj = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+		match = !memcmp(obj, mem, len);
+		zs_unmap_object(zram->mem_pool, entry->handle);
+		if (match) {
+			entry->refcount++;
+			handle = entry->handle;
+			break;
+		}
+	}
+	spin_unlock(&zram->dedup_lock);
+
+	return handle;
+}
+
+/*
+ * Make a freshly stored object available for sharing. Returns false if the
+ * object could not be tracked, in which case the slot owns it exclusively.
+ */
+bool zram_dedup_insert(struct zram *zram, unsigned long handle,
+		       unsigned int len, u32 checksum)
+{
+	struct zram_dedup_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return false;
+
+	entry->handle = handle;
+	entry->refcount = 1;
+	entry->len = len;
+	entry->checksum = checksum;
+
+	spin_lock(&zram->dedup_lock);
+	hlist_add_head(&entry->checksum_node, checksum_head(zram, checksum));
+	hlist_add_head(&entry->handle_node, handle_head(zram, handle));
+	spin_unlock(&zram->dedup_lock);
+
+	return true;
+}
+
+/*
+ * Drop a slot's reference to a shared object. Returns true if that was the
+ * last reference and the caller has to free the object.
+ */
+bool zram_dedup_put(struct zram *zram, unsigned long handle)
+{
+	struct zram_dedup_entry *entry;
+
+	spin_lock(&zram->dedup_lock);
+	hlist_for_each_entry(entry, handle_head(zram, handle), handle_node) {
+		if (entry->handle != handle)
+			continue;
+
+		if (--entry->refcount) {
+			spin_unlock(&zram->dedup_lock);
+			return false;
+		}
+		hlist_del(&entry->checksum_node);
+		hlist_del(&entry->handle_node);
+		spin_unlock(&zram->dedup_lock);
+		kfree(entry);
+		return true;
+	}
+	spin_unlock(&zram->dedup_lock);
+
+	WARN_ON_ONCE(1);
+	return true;
+}
+
+bool zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	size_t nr_buckets;
+
+	if (!zram->use_dedup)
+		return true;
+
+	zram->dedup_bits = clamp_t(unsigned int,
+				   order_base_2(num_pages >> 4),
+				   ZRAM_DEDUP_MIN_BITS, ZRAM_DEDUP_MAX_BITS);
+	nr_buckets = 1UL << zram->dedup_bits;
+
+	zram->dedup_checksum = vzalloc(array_size(nr_buckets,
+					sizeof(*zram->dedup_checksum)));
+	zram->dedup_handle = vzalloc(array_size(nr_buckets,
+					sizeof(*zram->dedup_handle)));
+	if (!zram->dedup_checksum || !zram->dedup_handle) {
+		zram_dedup_fini(zram);
+		return false;
+	}
+
+	spin_lock_init(&zram->dedup_lock);
+	return true;
+}
+
+void zram_dedup_fini(struct zram *zram)
+{
+	vfree(zram->dedup_checksum);
+	vfree(zram->dedup_handle);
+	zram->dedup_checksum = NULL;
+	zram->dedup_handle = NULL;
+}
@@ -35,6 +35,7 @@
 #include <linux/part_stat.h>
 
 #include "zram_drv.h"
+#include "zram_dedup.h"
 
 static DEFINE_IDR(zram_index_idr);
 /* idr index must be protected */
@@ -42,9 +43,12 @@ static DEFINE_MUTEX(zram_index_mutex);
 
 static int zram_major;
 static const char *default_compressor = CONFIG_ZRAM_DEF_COMP;
+static struct workqueue_struct *zram_write_wq;
 
 /* Module params (documentation at end) */
 static unsigned int num_devices = 1;
+/* Minimum size in pages of a write bio compressed on several CPUs */
+static unsigned int parallel_write_pages;
 /*
  * Pages that compress to sizes equals or greater than this are stored
  * uncompressed in memory.
@@ -650,18 +654,109 @@ static int read_from_bdev_async(struct zram *zram, struct bio_vec *bvec,
 #define IDLE_WRITEBACK			(1<<1)
 #define INCOMPRESSIBLE_WRITEBACK	(1<<2)
 
+/* Number of slots read and written back to the backing device together */
+#define ZRAM_WB_BATCH_PAGES	32
+
+struct zram_wb_batch {
+	struct page *pages[ZRAM_WB_BATCH_PAGES];
+	u32 index[ZRAM_WB_BATCH_PAGES];
+	unsigned long blk_idx[ZRAM_WB_BATCH_PAGES];
+	unsigned int nr;
+	unsigned int max;
+};
+
+/*
+ * Finish writeback of a batch slot. We released zram_slot_lock so need to
+ * check if the slot was changed. If there is freeing for the slot, we can
+ * catch it easily by zram_allocated.
+ * A subtle case is the slot is freed/reallocated/marked as ZRAM_IDLE again.
+ * To close the race, idle_store doesn't mark ZRAM_IDLE once it found the
+ * slot was ZRAM_UNDER_WB. Thus, we could close the race by checking
+ * ZRAM_IDLE bit.
+ */
+static void zram_wb_complete_slot(struct zram *zram, u32 index,
+				  unsigned long blk_idx, int err)
+{
+	zram_slot_lock(zram, index);
+	if (err || !zram_allocated(zram, index) ||
+	    !zram_test_flag(zram, index, ZRAM_IDLE)) {
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+		zram_slot_unlock(zram, index);
+		free_block_bdev(zram, blk_idx);
+		return;
+	}
+
+	zram_free_page(zram, index);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+	zram_set_flag(zram, index, ZRAM_WB);
+	zram_set_element(zram, index, blk_idx);
+	atomic64_inc(&zram->stats.pages_stored);
+	spin_lock(&zram->wb_limit_lock);
+	if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
+		zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
+	spin_unlock(&zram->wb_limit_lock);
+	zram_slot_unlock(zram, index);
+}
+
+/*
+ * Write out the batched slots, merging slots that landed on consecutive
+ * backing device blocks into a single bio. Returns the most recent bio
+ * error, if any.
+ */
+static int zram_wb_flush_batch(struct zram *zram, struct zram_wb_batch *wb)
+{
+	unsigned int start, end, i;
+	int ret = 0;
+
+	for (start = 0; start < wb->nr; start = end) {
+		struct bio *bio;
+		int err;
+
+		for (end = start + 1; end < wb->nr; end++)
+			if (wb->blk_idx[end] != wb->blk_idx[end - 1] + 1)
+				break;
+
+		bio = bio_alloc(zram->bdev, end - start,
+				REQ_OP_WRITE | REQ_SYNC, GFP_KERNEL);
+		bio->bi_iter.bi_sector = wb->blk_idx[start] * (PAGE_SIZE >> 9);
+		for (i = start; i < end; i++)
+			__bio_add_page(bio, wb->pages[i], PAGE_SIZE, 0);
+
+		err = submit_bio_wait(bio);
+		bio_put(bio);
+		/*
+		 * BIO errors are not fatal, we continue and simply attempt to
+		 * writeback the remaining objects (pages). At the same time we
+		 * need to signal user-space that some writes (at least one,
+		 * but also could be all of them) were not successful and we
+		 * do so by returning the most recent BIO error.
+		 */
+		if (err)
+			ret = err;
+		else
+			atomic64_add(end - start, &zram->stats.bd_writes);
+
+		for (i = start; i < end; i++)
+			zram_wb_complete_slot(zram, wb->index[i],
+					      wb->blk_idx[i], err);
+	}
+
+	wb->nr = 0;
+	return ret;
+}
+
 static ssize_t writeback_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	struct zram *zram = dev_to_zram(dev);
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
 	unsigned long index = 0;
-	struct bio bio;
-	struct bio_vec bio_vec;
-	struct page *page;
+	struct zram_wb_batch *wb;
 	ssize_t ret = len;
 	int mode, err;
 	unsigned long blk_idx = 0;
+	unsigned int i;
 
 	if (sysfs_streq(buf, "idle"))
 		mode = IDLE_WRITEBACK;
@@ -694,21 +789,42 @@ static ssize_t writeback_store(struct device *dev,
 		goto release_init_lock;
 	}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
+	wb = kzalloc(sizeof(*wb), GFP_KERNEL);
+	if (!wb) {
 		ret = -ENOMEM;
 		goto release_init_lock;
 	}
 
+	/* a smaller batch is fine if we're short on memory */
+	for (i = 0; i < min_t(unsigned long, nr_pages, ZRAM_WB_BATCH_PAGES);
+	     i++) {
+		wb->pages[i] = alloc_page(GFP_KERNEL | __GFP_NOWARN);
+		if (!wb->pages[i])
+			break;
+		wb->max++;
+	}
+	if (!wb->max) {
+		ret = -ENOMEM;
+		goto free_batch;
+	}
+
 	for (; nr_pages != 0; index++, nr_pages--) {
 		struct bio_vec bvec;
 
-		bvec.bv_page = page;
+		if (wb->nr == wb->max) {
+			err = zram_wb_flush_batch(zram, wb);
+			if (err)
+				ret = err;
+		}
+
+		bvec.bv_page = wb->pages[wb->nr];
 		bvec.bv_len = PAGE_SIZE;
 		bvec.bv_offset = 0;
 
+		/* account for the slots already queued in the batch */
 		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && !zram->bd_wb_limit) {
+		if (zram->wb_limit_enable && zram->bd_wb_limit <=
+		    ((u64)wb->nr << (PAGE_SHIFT - 12))) {
 			spin_unlock(&zram->wb_limit_lock);
 			ret = -EIO;
 			break;
@@ -758,69 +874,27 @@ static ssize_t writeback_store(struct device *dev,
 			continue;
 		}
 
-		bio_init(&bio, zram->bdev, &bio_vec, 1,
-			 REQ_OP_WRITE | REQ_SYNC);
-		bio.bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
-
-		bio_add_page(&bio, bvec.bv_page, bvec.bv_len,
-				bvec.bv_offset);
-		/*
-		 * XXX: A single page IO would be inefficient for write
-		 * but it would be not bad as starter.
-		 */
-		err = submit_bio_wait(&bio);
-		if (err) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
-			/*
-			 * BIO errors are not fatal, we continue and simply
-			 * attempt to writeback the remaining objects (pages).
-			 * At the same time we need to signal user-space that
-			 * some writes (at least one, but also could be all of
-			 * them) were not successful and we do so by returning
-			 * the most recent BIO error.
-			 */
-			ret = err;
-			continue;
-		}
-
-		atomic64_inc(&zram->stats.bd_writes);
-		/*
-		 * We released zram_slot_lock so need to check if the slot was
-		 * changed. If there is freeing for the slot, we can catch it
-		 * easily by zram_allocated.
-		 * A subtle case is the slot is freed/reallocated/marked as
-		 * ZRAM_IDLE again. To close the race, idle_store doesn't
-		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
-		 * Thus, we could close the race by checking ZRAM_IDLE bit.
-		 */
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index) ||
-			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			goto next;
-		}
-
-		zram_free_page(zram, index);
-		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-		zram_set_flag(zram, index, ZRAM_WB);
-		zram_set_element(zram, index, blk_idx);
+		/* the block now belongs to the batch */
+		wb->index[wb->nr] = index;
+		wb->blk_idx[wb->nr] = blk_idx;
+		wb->nr++;
 		blk_idx = 0;
-		atomic64_inc(&zram->stats.pages_stored);
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
-			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
-		spin_unlock(&zram->wb_limit_lock);
+		continue;
 next:
 		zram_slot_unlock(zram, index);
 	}
 
+	if (wb->nr) {
+		err = zram_wb_flush_batch(zram, wb);
+		if (err)
+			ret = err;
+	}
 	if (blk_idx)
 		free_block_bdev(zram, blk_idx);
-	__free_page(page);
+free_batch:
+	for (i = 0; i < wb->max; i++)
+		__free_page(wb->pages[i]);
+	kfree(wb);
 release_init_lock:
 	up_read(&zram->init_lock);
 
@@ -1276,6 +1350,61 @@ static ssize_t debug_stat_show(struct device *dev,
 	return ret;
 }
 
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t dedup_stat_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+			"%8llu %8llu\n",
+			(u64)atomic64_read(&zram->stats.dup_data_size),
+			(u64)atomic64_read(&zram->stats.dup_pages));
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", val);
+}
+
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
+static DEVICE_ATTR_RO(dedup_stat);
+static DEVICE_ATTR_RW(use_dedup);
+#endif
+
 static DEVICE_ATTR_RO(io_stat);
 static DEVICE_ATTR_RO(mm_stat);
 #ifdef CONFIG_ZRAM_WRITEBACK
@@ -1293,6 +1422,7 @@ static void zram_meta_free(struct zram *zram, u64 disksize)
 		zram_free_page(zram, index);
 
 	zs_destroy_pool(zram->mem_pool);
+	zram_dedup_fini(zram);
 	vfree(zram->table);
 }
 
@@ -1311,6 +1441,12 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
 		return false;
 	}
 
+	if (!zram_dedup_init(zram, num_pages)) {
+		zs_destroy_pool(zram->mem_pool);
+		vfree(zram->table);
+		return false;
+	}
+
 	if (!huge_class_size)
 		huge_class_size = zs_huge_class_size(zram->mem_pool);
 	return true;
@@ -1339,6 +1475,11 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
 		zram_clear_flag(zram, index, ZRAM_INCOMPRESSIBLE);
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram_get_priority(zram, index))
+		atomic64_dec(&zram->stats.prio_pages[zram_get_priority(zram,
+								       index)]);
+#endif
 	zram_set_priority(zram, index, 0);
 
 	if (zram_test_flag(zram, index, ZRAM_WB)) {
@@ -1361,6 +1502,19 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (!handle)
 		return;
 
+	/* other slots still share the object, only drop our reference */
+	if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+		zram_clear_flag(zram, index, ZRAM_DEDUP);
+		if (!zram_dedup_put(zram, handle)) {
+#ifdef CONFIG_ZRAM_DEDUP
+			atomic64_sub(zram_get_obj_size(zram, index),
+					&zram->stats.dup_data_size);
+			atomic64_dec(&zram->stats.dup_pages);
+#endif
+			goto out;
+		}
+	}
+
 	zs_free(zram->mem_pool, handle);
 
 	atomic64_sub(zram_get_obj_size(zram, index),
@@ -1511,6 +1665,8 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	struct page *page = bvec->bv_page;
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
+	bool dedup = false;
+	u32 checksum = 0;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -1537,6 +1693,29 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 
 	if (comp_len >= huge_class_size)
 		comp_len = PAGE_SIZE;
+
+	if (comp_len != PAGE_SIZE && zram_dedup_enabled(zram)) {
+		checksum = zram_dedup_checksum(zstrm->buffer, comp_len);
+		/* don't bother once the slow path allocated a handle */
+		if (IS_ERR_VALUE(handle)) {
+			unsigned long dup;
+
+			dup = zram_dedup_find(zram, zstrm->buffer, comp_len,
+					      checksum);
+			if (dup) {
+				zcomp_stream_put(zram->comps[ZRAM_PRIMARY_COMP]);
+				handle = dup;
+				dedup = true;
+#ifdef CONFIG_ZRAM_DEDUP
+				atomic64_add(comp_len,
+					     &zram->stats.dup_data_size);
+				atomic64_inc(&zram->stats.dup_pages);
+#endif
+				goto out;
+			}
+		}
+	}
+
 	/*
 	 * handle allocation has 2 paths:
 	 * a) fast path is executed with preemption disabled (for
@@ -1598,6 +1777,9 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	zcomp_stream_put(zram->comps[ZRAM_PRIMARY_COMP]);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
+
+	if (comp_len != PAGE_SIZE && zram_dedup_enabled(zram))
+		dedup = zram_dedup_insert(zram, handle, comp_len, checksum);
 out:
 	/*
 	 * Free memory associated with this sector
@@ -1618,6 +1800,8 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	}  else {
 		zram_set_handle(zram, index, handle);
 		zram_set_obj_size(zram, index, comp_len);
+		if (dedup)
+			zram_set_flag(zram, index, ZRAM_DEDUP);
 	}
 	zram_slot_unlock(zram, index);
 
@@ -1800,6 +1984,7 @@ static int zram_recompress(struct zram *zram, u32 index, struct page *page,
 
 	atomic64_add(comp_len_new, &zram->stats.compr_data_size);
 	atomic64_inc(&zram->stats.pages_stored);
+	atomic64_inc(&zram->stats.prio_pages[prio]);
 
 	return 0;
 }
@@ -1807,6 +1992,22 @@ static int zram_recompress(struct zram *zram, u32 index, struct page *page,
 #define RECOMPRESS_IDLE		(1 << 0)
 #define RECOMPRESS_HUGE		(1 << 1)
 
+/*
+ * Slots that can't be (or are not worth being) recompressed. Shared dedup
+ * objects are skipped because recompressing one copy would only add a new
+ * object next to the one still used by the other slots.
+ *
+ * Corresponding ZRAM slot should be locked.
+ */
+static bool zram_recompress_skip(struct zram *zram, u32 index)
+{
+	return zram_test_flag(zram, index, ZRAM_WB) ||
+	       zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+	       zram_test_flag(zram, index, ZRAM_SAME) ||
+	       zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE) ||
+	       zram_test_flag(zram, index, ZRAM_DEDUP);
+}
+
 static ssize_t recompress_store(struct device *dev,
 				struct device_attribute *attr,
 				const char *buf, size_t len)
@@ -1906,10 +2107,7 @@ static ssize_t recompress_store(struct device *dev,
 		    !zram_test_flag(zram, index, ZRAM_HUGE))
 			goto next;
 
-		if (zram_test_flag(zram, index, ZRAM_WB) ||
-		    zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
-		    zram_test_flag(zram, index, ZRAM_SAME) ||
-		    zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
+		if (zram_recompress_skip(zram, index))
 			goto next;
 
 		err = zram_recompress(zram, index, page, threshold,
@@ -1930,6 +2128,187 @@ static ssize_t recompress_store(struct device *dev,
 	up_read(&zram->init_lock);
 	return ret;
 }
+
+/*
+ * A slot is cold if it hasn't been accessed for recomp_age seconds. Without
+ * access tracking we fall back to the ZRAM_IDLE flag set via idle_store.
+ */
+static bool zram_slot_cold(struct zram *zram, u32 index, ktime_t cutoff)
+{
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	if (cutoff)
+		return ktime_after(cutoff, zram->table[index].ac_time);
+#endif
+	return zram_test_flag(zram, index, ZRAM_IDLE);
+}
+
+/*
+ * Background recompression: every recomp_interval seconds look at the next
+ * recomp_batch slots and move the cold ones to the secondary algorithms,
+ * leaving recently used pages with the (fast) primary one. The batch size
+ * bounds the CPU time spent per interval.
+ */
+static void zram_recompress_work(struct work_struct *work)
+{
+	struct zram *zram = container_of(to_delayed_work(work), struct zram,
+					 recomp_work);
+	unsigned long nr_pages, index;
+	unsigned int i, batch;
+	ktime_t cutoff = 0;
+	struct page *page;
+
+	/* don't block zram_reset_device(), which cancels us under the lock */
+	if (!down_read_trylock(&zram->init_lock))
+		goto requeue;
+
+	if (!init_done(zram) || zram->num_active_comps < 2)
+		goto unlock;
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		goto unlock;
+
+	if (zram->recomp_age)
+		cutoff = ktime_sub(ktime_get_boottime(),
+				   ns_to_ktime(zram->recomp_age * NSEC_PER_SEC));
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	batch = min_t(unsigned long, zram->recomp_batch, nr_pages);
+	index = zram->recomp_cursor;
+	for (i = 0; i < batch; i++, index++) {
+		u32 prio;
+		int err;
+
+		if (index >= nr_pages)
+			index = 0;
+
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index) ||
+		    zram_recompress_skip(zram, index) ||
+		    !zram_slot_cold(zram, index, cutoff)) {
+			zram_slot_unlock(zram, index);
+			continue;
+		}
+
+		atomic64_inc(&zram->stats.recomp_scanned);
+		prio = zram_get_priority(zram, index);
+		err = zram_recompress(zram, index, page,
+				      zram->recomp_threshold,
+				      ZRAM_SECONDARY_COMP, ZRAM_MAX_COMPS);
+		if (!err && zram_get_priority(zram, index) != prio)
+			atomic64_inc(&zram->stats.recomp_pages);
+		zram_slot_unlock(zram, index);
+
+		/* try again next interval rather than push on memory */
+		if (err == -ENOMEM)
+			break;
+		cond_resched();
+	}
+	zram->recomp_cursor = index;
+
+	__free_page(page);
+unlock:
+	up_read(&zram->init_lock);
+requeue:
+	if (READ_ONCE(zram->recomp_interval))
+		queue_delayed_work(system_unbound_wq, &zram->recomp_work,
+				   READ_ONCE(zram->recomp_interval) * HZ);
+}
+
+static ssize_t recompress_auto_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE,
+			"interval=%u batch=%u age=%llu threshold=%u\n",
+			zram->recomp_interval, zram->recomp_batch,
+			zram->recomp_age, zram->recomp_threshold);
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+
+static ssize_t recompress_auto_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int interval = 0, batch = 1024, threshold = 0;
+	char *args, *param, *val;
+	u64 age = 0;
+	ssize_t ret;
+
+	args = skip_spaces(buf);
+	while (*args) {
+		args = next_arg(args, &param, &val);
+
+		if (!*val)
+			return -EINVAL;
+
+		if (!strcmp(param, "interval"))
+			ret = kstrtouint(val, 10, &interval);
+		else if (!strcmp(param, "batch"))
+			ret = kstrtouint(val, 10, &batch);
+		else if (!strcmp(param, "threshold"))
+			ret = kstrtouint(val, 10, &threshold);
+		else if (!strcmp(param, "age") &&
+			 IS_ENABLED(CONFIG_ZRAM_MEMORY_TRACKING))
+			ret = kstrtoull(val, 10, &age);
+		else
+			ret = -EINVAL;
+		if (ret)
+			return ret;
+	}
+
+	if (!batch || threshold >= PAGE_SIZE)
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram)) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	/* stop a running policy before changing its parameters */
+	WRITE_ONCE(zram->recomp_interval, 0);
+	cancel_delayed_work_sync(&zram->recomp_work);
+
+	zram->recomp_batch = batch;
+	zram->recomp_threshold = threshold;
+	zram->recomp_age = age;
+	WRITE_ONCE(zram->recomp_interval, interval);
+	if (interval)
+		queue_delayed_work(system_unbound_wq, &zram->recomp_work,
+				   interval * HZ);
+	ret = len;
+
+release_init_lock:
+	up_read(&zram->init_lock);
+	return ret;
+}
+
+static ssize_t recomp_stat_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	ssize_t ret;
+	u32 prio;
+
+	down_read(&zram->init_lock);
+	ret = scnprintf(buf, PAGE_SIZE, "%8llu %8llu",
+			(u64)atomic64_read(&zram->stats.recomp_scanned),
+			(u64)atomic64_read(&zram->stats.recomp_pages));
+	for (prio = ZRAM_SECONDARY_COMP; prio < ZRAM_MAX_COMPS; prio++)
+		ret += scnprintf(buf + ret, PAGE_SIZE - ret, " %8llu",
+			(u64)atomic64_read(&zram->stats.prio_pages[prio]));
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret, "\n");
+	up_read(&zram->init_lock);
+
+	return ret;
+}
 #endif
 
 /*
@@ -2001,6 +2380,128 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	return ret;
 }
 
+/* Never hand a CPU fewer pages than this */
+#define ZRAM_WRITE_CHUNK_MIN_PAGES	8
+#define ZRAM_WRITE_MAX_CHUNKS		16
+
+struct zram_write_chunk {
+	struct work_struct work;
+	struct zram_parallel_write *pw;
+	struct bvec_iter iter;
+	u32 index;
+};
+
+struct zram_parallel_write {
+	struct zram *zram;
+	struct bio *bio;
+	unsigned long start_time;
+	atomic_t pending;
+	struct zram_write_chunk chunks[];
+};
+
+static void zram_write_chunk_fn(struct work_struct *work)
+{
+	struct zram_write_chunk *chunk = container_of(work,
+					struct zram_write_chunk, work);
+	struct zram_parallel_write *pw = chunk->pw;
+	struct zram *zram = pw->zram;
+	struct bio *bio = pw->bio;
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+	u32 index = chunk->index;
+
+	__bio_for_each_segment(bvec, bio, iter, chunk->iter) {
+		if (zram_bvec_rw(zram, &bvec, index, 0, REQ_OP_WRITE,
+				 bio) < 0) {
+			WRITE_ONCE(bio->bi_status, BLK_STS_IOERR);
+			break;
+		}
+		index++;
+	}
+
+	/* the bio completes once every chunk has been stored */
+	if (atomic_dec_and_test(&pw->pending)) {
+		bio_end_io_acct(bio, pw->start_time);
+		bio_endio(bio);
+		kfree(pw);
+		/* zram_reset_device() waits for this before freeing the meta */
+		if (atomic_dec_and_test(&zram->parallel_writes))
+			wake_up(&zram->parallel_wait);
+	}
+}
+
+/* Whether every segment of @bio is a whole page, as the chunks assume */
+static bool zram_bio_whole_pages(struct bio *bio)
+{
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+
+	bio_for_each_segment(bvec, bio, iter)
+		if (bvec.bv_offset || bvec.bv_len != PAGE_SIZE)
+			return false;
+	return true;
+}
+
+/*
+ * Split a large, page aligned write across zram_write_wq so that pages are
+ * compressed on several CPUs, each with its own per-CPU stream. This helps
+ * when a swap-out burst lands on a single CPU. Returns false if the bio
+ * should be handled synchronously instead.
+ */
+static bool zram_write_parallel(struct zram *zram, struct bio *bio, u32 index)
+{
+	struct zram_parallel_write *pw;
+	struct bvec_iter iter = bio->bi_iter;
+	unsigned int nr_pages = bio->bi_iter.bi_size >> PAGE_SHIFT;
+	unsigned int nr_chunks, per_chunk, i;
+
+	if (!parallel_write_pages || nr_pages < parallel_write_pages)
+		return false;
+	if (!IS_ALIGNED(bio->bi_iter.bi_size, PAGE_SIZE))
+		return false;
+	if (!zram_bio_whole_pages(bio))
+		return false;
+
+	nr_chunks = min3(num_online_cpus(),
+			 nr_pages / ZRAM_WRITE_CHUNK_MIN_PAGES,
+			 (unsigned int)ZRAM_WRITE_MAX_CHUNKS);
+	if (nr_chunks < 2)
+		return false;
+
+	pw = kmalloc(struct_size(pw, chunks, nr_chunks),
+		     GFP_NOIO | __GFP_NOWARN);
+	if (!pw)
+		return false;
+
+	atomic_inc(&zram->parallel_writes);
+	pw->zram = zram;
+	pw->bio = bio;
+	pw->start_time = bio_start_io_acct(bio);
+	atomic_set(&pw->pending, nr_chunks);
+
+	per_chunk = nr_pages / nr_chunks;
+	for (i = 0; i < nr_chunks; i++) {
+		struct zram_write_chunk *chunk = &pw->chunks[i];
+		unsigned int pages = per_chunk;
+
+		/* the last chunk picks up the remainder */
+		if (i == nr_chunks - 1)
+			pages = nr_pages - per_chunk * (nr_chunks - 1);
+
+		chunk->pw = pw;
+		chunk->index = index;
+		chunk->iter = iter;
+		chunk->iter.bi_size = pages << PAGE_SHIFT;
+		bio_advance_iter(bio, &iter, pages << PAGE_SHIFT);
+		index += pages;
+		INIT_WORK(&chunk->work, zram_write_chunk_fn);
+	}
+
+	for (i = 0; i < nr_chunks; i++)
+		queue_work(zram_write_wq, &pw->chunks[i].work);
+	return true;
+}
+
 static void __zram_make_request(struct zram *zram, struct bio *bio)
 {
 	int offset;
@@ -2019,6 +2520,10 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 		zram_bio_discard(zram, index, offset, bio);
 		bio_endio(bio);
 		return;
+	case REQ_OP_WRITE:
+		if (!offset && zram_write_parallel(zram, bio, index))
+			return;
+		break;
 	default:
 		break;
 	}
@@ -2162,10 +2667,17 @@ static void zram_reset_device(struct zram *zram)
 		return;
 	}
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	WRITE_ONCE(zram->recomp_interval, 0);
+	cancel_delayed_work_sync(&zram->recomp_work);
+	zram->recomp_cursor = 0;
+#endif
+
 	set_capacity_and_notify(zram->disk, 0);
 	part_stat_set_all(zram->disk->part0, 0);
 
 	/* I/O operation under all of CPU are done so let's free */
+	wait_event(zram->parallel_wait, !atomic_read(&zram->parallel_writes));
 	zram_meta_free(zram, zram->disksize);
 	zram->disksize = 0;
 	zram_destroy_comps(zram);
@@ -2312,6 +2824,8 @@ static DEVICE_ATTR_RW(writeback_limit_enable);
 #ifdef CONFIG_ZRAM_MULTI_COMP
 static DEVICE_ATTR_RW(recomp_algorithm);
 static DEVICE_ATTR_WO(recompress);
+static DEVICE_ATTR_RW(recompress_auto);
+static DEVICE_ATTR_RO(recomp_stat);
 #endif
 
 static struct attribute *zram_disk_attrs[] = {
@@ -2339,6 +2853,12 @@ static struct attribute *zram_disk_attrs[] = {
 #ifdef CONFIG_ZRAM_MULTI_COMP
 	&dev_attr_recomp_algorithm.attr,
 	&dev_attr_recompress.attr,
+	&dev_attr_recompress_auto.attr,
+	&dev_attr_recomp_stat.attr,
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+	&dev_attr_use_dedup.attr,
+	&dev_attr_dedup_stat.attr,
 #endif
 	NULL,
 };
@@ -2364,9 +2884,14 @@ static int zram_add(void)
 	device_id = ret;
 
 	init_rwsem(&zram->init_lock);
+	atomic_set(&zram->parallel_writes, 0);
+	init_waitqueue_head(&zram->parallel_wait);
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
 #endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	INIT_DELAYED_WORK(&zram->recomp_work, zram_recompress_work);
+#endif
 
 	/* gendisk structure */
 	zram->disk = blk_alloc_disk(NUMA_NO_NODE);
@@ -2565,6 +3090,7 @@ static void destroy_devices(void)
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
 	cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+	destroy_workqueue(zram_write_wq);
 }
 
 static int __init zram_init(void)
@@ -2573,15 +3099,24 @@ static int __init zram_init(void)
 
 	BUILD_BUG_ON(__NR_ZRAM_PAGEFLAGS > BITS_PER_LONG);
 
+	/* swap-out goes through here, so it must make progress under reclaim */
+	zram_write_wq = alloc_workqueue("zram_write",
+					WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!zram_write_wq)
+		return -ENOMEM;
+
 	ret = cpuhp_setup_state_multi(CPUHP_ZCOMP_PREPARE, "block/zram:prepare",
 				      zcomp_cpu_up_prepare, zcomp_cpu_dead);
-	if (ret < 0)
+	if (ret < 0) {
+		destroy_workqueue(zram_write_wq);
 		return ret;
+	}
 
 	ret = class_register(&zram_control_class);
 	if (ret) {
 		pr_err("Unable to register zram-control class\n");
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		destroy_workqueue(zram_write_wq);
 		return ret;
 	}
 
@@ -2591,6 +3126,7 @@ static int __init zram_init(void)
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		destroy_workqueue(zram_write_wq);
 		return -EBUSY;
 	}
 
@@ -2621,6 +3157,10 @@ module_exit(zram_exit);
 module_param(num_devices, uint, 0);
 MODULE_PARM_DESC(num_devices, "Number of pre-created zram devices");
 
+module_param(parallel_write_pages, uint, 0644);
+MODULE_PARM_DESC(parallel_write_pages,
+		 "Minimum write size in pages to compress on several CPUs (0 = disabled)");
+
 MODULE_LICENSE("Dual BSD/GPL");
 MODULE_AUTHOR("Nitin Gupta <ngupta@vflare.org>");
 MODULE_DESCRIPTION("Compressed RAM Block Device");
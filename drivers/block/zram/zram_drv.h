@@ -53,6 +53,7 @@ enum zram_pageflags {
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
 	ZRAM_INCOMPRESSIBLE, /* none of the algorithms could compress it */
+	ZRAM_DEDUP,	/* object is shared through the dedup index */
 
 	ZRAM_COMP_PRIORITY_BIT1, /* First bit of comp priority index */
 	ZRAM_COMP_PRIORITY_BIT2, /* Second bit of comp priority index */
@@ -60,6 +61,16 @@ enum zram_pageflags {
 	__NR_ZRAM_PAGEFLAGS,
 };
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+#define ZRAM_PRIMARY_COMP	0U
+#define ZRAM_SECONDARY_COMP	1U
+#define ZRAM_MAX_COMPS	4U
+#else
+#define ZRAM_PRIMARY_COMP	0U
+#define ZRAM_SECONDARY_COMP	0U
+#define ZRAM_MAX_COMPS	1U
+#endif
+
 /*-- Data structures */
 
 /* Allocated for each disk page */
@@ -87,6 +98,15 @@ struct zram_stats {
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
 	atomic64_t miss_free;		/* no. of missed free */
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	atomic64_t recomp_scanned;	/* no. of slots checked by auto recompress */
+	atomic64_t recomp_pages;	/* no. of pages auto recompressed */
+	atomic64_t prio_pages[ZRAM_MAX_COMPS];	/* no. of pages stored per comp priority */
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+	atomic64_t dup_data_size;	/* compressed size saved by dedup */
+	atomic64_t dup_pages;		/* no. of pages sharing an object */
+#endif
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
@@ -94,16 +114,6 @@ struct zram_stats {
 #endif
 };
 
-#ifdef CONFIG_ZRAM_MULTI_COMP
-#define ZRAM_PRIMARY_COMP	0U
-#define ZRAM_SECONDARY_COMP	1U
-#define ZRAM_MAX_COMPS	4U
-#else
-#define ZRAM_PRIMARY_COMP	0U
-#define ZRAM_SECONDARY_COMP	0U
-#define ZRAM_MAX_COMPS	1U
-#endif
-
 struct zram {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
@@ -128,6 +138,9 @@ struct zram {
 	 * zram is claimed so open request will be failed
 	 */
 	bool claim; /* Protected by disk->open_mutex */
+	/* bios split by zram_write_parallel() still being stored */
+	atomic_t parallel_writes;
+	wait_queue_head_t parallel_wait;
 #ifdef CONFIG_ZRAM_WRITEBACK
 	struct file *backing_dev;
 	spinlock_t wb_limit_lock;
@@ -140,5 +153,21 @@ struct zram {
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
 	struct dentry *debugfs_dir;
 #endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	/* background recompression of cold objects, see recompress_auto */
+	struct delayed_work recomp_work;
+	unsigned long recomp_cursor;
+	unsigned int recomp_interval;	/* seconds, 0 = disabled */
+	unsigned int recomp_batch;	/* slots scanned per interval */
+	unsigned int recomp_threshold;
+	u64 recomp_age;			/* seconds */
+#endif
+#ifdef CONFIG_ZRAM_DEDUP
+	bool use_dedup;
+	spinlock_t dedup_lock;
+	unsigned int dedup_bits;
+	struct hlist_head *dedup_checksum;
+	struct hlist_head *dedup_handle;
+#endif
 };
 #endif
@@ -19,6 +19,9 @@
 #include <linux/sched.h>
 #include <linux/module.h>
 #include <linux/kvm_para.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/percpu.h>
 #include <trace/events/power.h>
 
 static unsigned int guest_halt_poll_ns __read_mostly = 200000;
@@ -40,6 +43,39 @@ module_param(guest_halt_poll_grow_start, uint, 0644);
 static bool guest_halt_poll_allow_shrink __read_mostly = true;
 module_param(guest_halt_poll_allow_shrink, bool, 0644);
 
+/* pick the poll window from the wakeup interval histogram */
+static bool guest_halt_poll_adaptive __read_mostly;
+module_param(guest_halt_poll_adaptive, bool, 0644);
+
+/* value in ns of a wakeup that finds the vCPU halted, for the adaptive mode */
+static unsigned int guest_halt_poll_penalty_ns __read_mostly = 20000;
+module_param(guest_halt_poll_penalty_ns, uint, 0644);
+
+/*
+ * Histogram of the intervals from the start of polling to the wakeup.
+ * Bucket i counts the intervals up to HP_BUCKET_NS(i); the last one
+ * everything longer.  The counts are halved every HP_DECAY samples so
+ * that the window follows changes of the load.
+ */
+#define HP_NR_BUCKETS		16
+#define HP_BUCKET_NS(i)		(1024ULL << (i))
+#define HP_DECAY		64
+#define HP_UPDATE		16
+
+struct haltpoll_hist {
+	unsigned int count[HP_NR_BUCKETS];
+	unsigned int samples;
+	/* poll time of a window that ran out, before the halt */
+	u64 pending_ns;
+	/* fraction of the wakeups the window is expected to catch, in % */
+	unsigned int predicted_pct;
+	/* polls ended by a wakeup, and polls that ran out */
+	unsigned long hits;
+	unsigned long misses;
+};
+
+static DEFINE_PER_CPU(struct haltpoll_hist, haltpoll_hist);
+
 /**
  * haltpoll_select - selects the next idle state to enter
  * @drv: cpuidle driver containing state data
@@ -107,6 +143,89 @@ static void adjust_poll_limit(struct cpuidle_device *dev, u64 block_ns)
 	}
 }
 
+static unsigned int hist_bucket(u64 ns)
+{
+	unsigned int i;
+
+	for (i = 0; i < HP_NR_BUCKETS - 1; i++)
+		if (ns <= HP_BUCKET_NS(i))
+			break;
+	return i;
+}
+
+/*
+ * Pick the bucket bound that minimizes the expected cost of a wakeup:
+ * the time spent polling for the wakeups that come within the window,
+ * and the whole window plus guest_halt_poll_penalty_ns for the others.
+ * Each bucket is taken as if all its wakeups came at its upper bound,
+ * which errs on the side of shorter windows.
+ */
+static void adaptive_poll_limit(struct cpuidle_device *dev,
+				struct haltpoll_hist *h)
+{
+	u64 best_cost = U64_MAX, best = 0, cost, window;
+	unsigned int i, w, hit, total = 0;
+
+	for (i = 0; i < HP_NR_BUCKETS; i++)
+		total += h->count[i];
+	if (!total)
+		return;
+
+	for (w = 0; w < HP_NR_BUCKETS; w++) {
+		/* w == 0: halt right away */
+		window = w ? HP_BUCKET_NS(w - 1) : 0;
+		if (window > guest_halt_poll_ns)
+			break;
+
+		cost = 0;
+		for (i = 0; i < HP_NR_BUCKETS; i++) {
+			if (i < w)
+				cost += (u64)h->count[i] * HP_BUCKET_NS(i);
+			else
+				cost += (u64)h->count[i] *
+					(window + guest_halt_poll_penalty_ns);
+		}
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = window;
+			for (hit = 0, i = 0; i < w; i++)
+				hit += h->count[i];
+			h->predicted_pct = hit * 100 / total;
+		}
+	}
+
+	if (best > dev->poll_limit_ns)
+		trace_guest_halt_poll_ns_grow(best, dev->poll_limit_ns);
+	else if (best < dev->poll_limit_ns)
+		trace_guest_halt_poll_ns_shrink(best, dev->poll_limit_ns);
+	dev->poll_limit_ns = best;
+}
+
+static void account_wakeup(struct cpuidle_device *dev, int index)
+{
+	struct haltpoll_hist *h = per_cpu_ptr(&haltpoll_hist, dev->cpu);
+	unsigned int i;
+
+	/* The window ran out: the wakeup is still to come, in halt. */
+	if (index == 0 && dev->poll_time_limit) {
+		h->misses++;
+		h->pending_ns += dev->last_residency_ns;
+		return;
+	}
+	if (index == 0)
+		h->hits++;
+
+	h->count[hist_bucket(h->pending_ns + dev->last_residency_ns)]++;
+	h->pending_ns = 0;
+
+	if (++h->samples % HP_DECAY == 0) {
+		for (i = 0; i < HP_NR_BUCKETS; i++)
+			h->count[i] /= 2;
+	}
+	if (guest_halt_poll_adaptive && h->samples % HP_UPDATE == 0)
+		adaptive_poll_limit(dev, h);
+}
+
 /**
  * haltpoll_reflect - update variables and update poll time
  * @dev: the CPU
@@ -116,7 +235,9 @@ static void haltpoll_reflect(struct cpuidle_device *dev, int index)
 {
 	dev->last_state_idx = index;
 
-	if (index != 0)
+	account_wakeup(dev, index);
+
+	if (index != 0 && !guest_halt_poll_adaptive)
 		adjust_poll_limit(dev, dev->last_residency_ns);
 }
 
@@ -128,7 +249,10 @@ static void haltpoll_reflect(struct cpuidle_device *dev, int index)
 static int haltpoll_enable_device(struct cpuidle_driver *drv,
 				  struct cpuidle_device *dev)
 {
+	struct haltpoll_hist *h = per_cpu_ptr(&haltpoll_hist, dev->cpu);
+
 	dev->poll_limit_ns = 0;
+	memset(h, 0, sizeof(*h));
 
 	return 0;
 }
@@ -141,10 +265,34 @@ static struct cpuidle_governor haltpoll_governor = {
 	.reflect =		haltpoll_reflect,
 };
 
+static int haltpoll_stats_show(struct seq_file *s, void *unused)
+{
+	struct cpuidle_device *dev;
+	struct haltpoll_hist *h;
+	unsigned long polls;
+	int cpu;
+
+	seq_puts(s, "cpu poll_limit_ns predicted_pct actual_pct hits misses\n");
+	for_each_online_cpu(cpu) {
+		dev = per_cpu(cpuidle_devices, cpu);
+		h = per_cpu_ptr(&haltpoll_hist, cpu);
+		polls = h->hits + h->misses;
+		seq_printf(s, "%d %llu %u %lu %lu %lu\n", cpu,
+			   dev ? dev->poll_limit_ns : 0, h->predicted_pct,
+			   polls ? h->hits * 100 / polls : 0, h->hits,
+			   h->misses);
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(haltpoll_stats);
+
 static int __init init_haltpoll(void)
 {
-	if (kvm_para_available())
+	if (kvm_para_available()) {
+		debugfs_create_file("haltpoll_stats", 0444, NULL, NULL,
+				    &haltpoll_stats_fops);
 		return cpuidle_register_governor(&haltpoll_governor);
+	}
 
 	return 0;
 }
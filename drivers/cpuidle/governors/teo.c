@@ -99,11 +99,21 @@
  *      select the given idle state instead of the candidate one.
  *
  * 3. By default, select the candidate state.
+ *
+ * With CONFIG_CPU_IDLE_GOV_TEO_IRQ_TIMINGS, the "irq_timings" parameter (teo.irq_timings=1 on
+ * the command line) has the governor also consult the prediction of the next
+ * device interrupt made by the IRQ timings code, and use it in place of the
+ * sleep length in the first step of the selection if it comes earlier.  This
+ * keeps the CPU out of the idle states whose exit latency would be paid just
+ * before a periodic device interrupt, e.g. from a NIC, arrives.  The metrics
+ * are still collected against the sleep length.
  */
 
 #include <linux/cpuidle.h>
+#include <linux/interrupt.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
+#include <linux/moduleparam.h>
 #include <linux/sched/clock.h>
 #include <linux/tick.h>
 
@@ -276,6 +286,36 @@ static int teo_find_shallower_state(struct cpuidle_driver *drv,
 	return state_idx;
 }
 
+#ifdef CONFIG_IRQ_TIMINGS
+static bool irq_timings __read_mostly;
+module_param(irq_timings, bool, 0444);
+
+/**
+ * teo_irq_duration - Time till the next predicted device interrupt.
+ * @now: Current local_clock() value.
+ * @duration_ns: Current idle duration estimate, returned if no interrupt is
+ *		 predicted before it.
+ */
+static s64 teo_irq_duration(u64 now, s64 duration_ns)
+{
+	u64 next;
+
+	if (!irq_timings)
+		return duration_ns;
+
+	next = irq_timings_next_event(now);
+	if (next == U64_MAX || next <= now)
+		return duration_ns;
+
+	return min_t(u64, next - now, duration_ns);
+}
+#else
+static inline s64 teo_irq_duration(u64 now, s64 duration_ns)
+{
+	return duration_ns;
+}
+#endif
+
 /**
  * teo_select - Selects the next idle state to enter.
  * @drv: cpuidle driver containing state data.
@@ -309,6 +349,7 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 
 	duration_ns = tick_nohz_get_sleep_length(&delta_tick);
 	cpu_data->sleep_length_ns = duration_ns;
+	duration_ns = teo_irq_duration(cpu_data->time_span_ns, duration_ns);
 
 	/* Check if there is any choice in the first place. */
 	if (drv->state_count < 2) {
@@ -528,6 +569,10 @@ static struct cpuidle_governor teo_governor = {
 
 static int __init teo_governor_init(void)
 {
+#ifdef CONFIG_IRQ_TIMINGS
+	if (irq_timings)
+		irq_timings_enable();
+#endif
 	return cpuidle_register_governor(&teo_governor);
 }
 
@@ -3,6 +3,7 @@
 #include <linux/memremap.h>
 #include <linux/pagemap.h>
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/device.h>
 #include <linux/pfn_t.h>
 #include <linux/cdev.h>
@@ -100,11 +101,75 @@ static void dax_set_mapping(struct vm_fault *vmf, pfn_t pfn,
 	}
 }
 
+/*
+ * Map up to this many bytes around a PTE or PMD fault, rounded down to a power
+ * of two and limited to one page table of the next level.  Populating a large
+ * mapping then takes a fault per PMD or PUD rather than per device alignment.
+ */
+static unsigned long fault_around_bytes = PUD_SIZE;
+module_param(fault_around_bytes, ulong, 0644);
+MODULE_PARM_DESC(fault_around_bytes,
+		"Bytes to map around a PTE or PMD fault (default: PUD_SIZE)");
+
+static void dev_dax_fault_around(struct dev_dax *dev_dax,
+		struct vm_fault *vmf, unsigned long fault_size)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	bool write = vmf->flags & FAULT_FLAG_WRITE;
+	unsigned long window, start, end, addr;
+	phys_addr_t phys;
+	vm_fault_t rc;
+	pfn_t pfn;
+
+	window = min(READ_ONCE(fault_around_bytes),
+		     fault_size == PAGE_SIZE ? PMD_SIZE : PUD_SIZE);
+	if (window <= fault_size)
+		return;
+	window = rounddown_pow_of_two(window);
+
+	start = max(ALIGN_DOWN(vmf->address, window), vma->vm_start);
+	end = min(ALIGN_DOWN(vmf->address, window) + window, vma->vm_end);
+
+	for (addr = start; addr < end; addr += fault_size) {
+		struct vm_fault around = {
+			.vma = vma,
+			.address = addr,
+			.flags = vmf->flags,
+			.pgoff = linear_page_index(vma, addr),
+			.pud = vmf->pud,
+		};
+
+		if (addr == ALIGN_DOWN(vmf->address, fault_size))
+			continue;
+
+		/* The window is within the PMD table of the faulting entry */
+		if (fault_size == PMD_SIZE) {
+			around.pmd = pmd_offset(vmf->pud, addr);
+			if (!pmd_none(*around.pmd))
+				continue;
+		}
+
+		phys = dax_pgoff_to_phys(dev_dax, around.pgoff, fault_size);
+		if (phys == -1)
+			break;
+		pfn = phys_to_pfn_t(phys, PFN_DEV|PFN_MAP);
+
+		dax_set_mapping(&around, pfn, fault_size);
+		if (fault_size == PMD_SIZE)
+			rc = vmf_insert_pfn_pmd(&around, pfn, write);
+		else
+			rc = vmf_insert_mixed(vma, addr, pfn);
+		if (rc != VM_FAULT_NOPAGE)
+			break;
+	}
+}
+
 static vm_fault_t __dev_dax_pte_fault(struct dev_dax *dev_dax,
 				struct vm_fault *vmf)
 {
 	struct device *dev = &dev_dax->dev;
 	phys_addr_t phys;
+	vm_fault_t rc;
 	pfn_t pfn;
 	unsigned int fault_size = PAGE_SIZE;
 
@@ -130,7 +195,10 @@ static vm_fault_t __dev_dax_pte_fault(struct dev_dax *dev_dax,
 
 	dax_set_mapping(vmf, pfn, fault_size);
 
-	return vmf_insert_mixed(vmf->vma, vmf->address, pfn);
+	rc = vmf_insert_mixed(vmf->vma, vmf->address, pfn);
+	if (rc == VM_FAULT_NOPAGE)
+		dev_dax_fault_around(dev_dax, vmf, fault_size);
+	return rc;
 }
 
 static vm_fault_t __dev_dax_pmd_fault(struct dev_dax *dev_dax,
@@ -140,6 +208,7 @@ static vm_fault_t __dev_dax_pmd_fault(struct dev_dax *dev_dax,
 	struct device *dev = &dev_dax->dev;
 	phys_addr_t phys;
 	pgoff_t pgoff;
+	vm_fault_t rc;
 	pfn_t pfn;
 	unsigned int fault_size = PMD_SIZE;
 
@@ -173,7 +242,10 @@ static vm_fault_t __dev_dax_pmd_fault(struct dev_dax *dev_dax,
 
 	dax_set_mapping(vmf, pfn, fault_size);
 
-	return vmf_insert_pfn_pmd(vmf, pfn, vmf->flags & FAULT_FLAG_WRITE);
+	rc = vmf_insert_pfn_pmd(vmf, pfn, vmf->flags & FAULT_FLAG_WRITE);
+	if (rc == VM_FAULT_NOPAGE)
+		dev_dax_fault_around(dev_dax, vmf, fault_size);
+	return rc;
 }
 
 #ifdef CONFIG_HAVE_ARCH_TRANSPARENT_HUGEPAGE_PUD
@@ -4,6 +4,7 @@
 #include <linux/pagemap.h>
 #include <linux/memory.h>
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/device.h>
 #include <linux/pfn_t.h>
 #include <linux/slab.h>
@@ -27,6 +28,88 @@ static const char *kmem_name;
 /* Set if any memory will remain added when the driver will be unloaded. */
 static bool any_hotremove_failed;
 
+/*
+ * Abstract distance given to the nodes of devices probed from now on, which
+ * places them in a memory tier and so decides where they demote to and from.
+ */
+static int kmem_adistance = MEMTIER_DEFAULT_DAX_ADISTANCE;
+
+static int kmem_adistance_set(const char *val, const struct kernel_param *kp)
+{
+	int adistance, rc;
+
+	rc = kstrtoint(val, 0, &adistance);
+	if (rc)
+		return rc;
+	if (adistance <= 0)
+		return -EINVAL;
+	WRITE_ONCE(kmem_adistance, adistance);
+	return 0;
+}
+
+static const struct kernel_param_ops kmem_adistance_ops = {
+	.set = kmem_adistance_set,
+	.get = param_get_int,
+};
+module_param_cb(adistance, &kmem_adistance_ops, &kmem_adistance, 0644);
+MODULE_PARM_DESC(adistance,
+		"Abstract distance of the memory onlined from now on (default: 5 * DRAM)");
+
+/* One memory type per abstract distance used, kept until unload */
+struct kmem_memory_type {
+	struct list_head list;
+	int adistance;
+	/* NULL without CONFIG_NUMA */
+	struct memory_dev_type *mtype;
+};
+
+static LIST_HEAD(kmem_memory_types);
+static DEFINE_MUTEX(kmem_memory_type_lock);
+
+static struct memory_dev_type *kmem_find_alloc_memory_type(int adistance)
+{
+	struct memory_dev_type *mtype;
+	struct kmem_memory_type *kt;
+
+	mutex_lock(&kmem_memory_type_lock);
+	list_for_each_entry(kt, &kmem_memory_types, list) {
+		if (kt->adistance == adistance) {
+			mtype = kt->mtype;
+			goto out;
+		}
+	}
+
+	mtype = ERR_PTR(-ENOMEM);
+	kt = kmalloc(sizeof(*kt), GFP_KERNEL);
+	if (!kt)
+		goto out;
+	kt->mtype = alloc_memory_type(adistance);
+	if (IS_ERR(kt->mtype)) {
+		mtype = kt->mtype;
+		kfree(kt);
+		goto out;
+	}
+	kt->adistance = adistance;
+	list_add(&kt->list, &kmem_memory_types);
+	mtype = kt->mtype;
+out:
+	mutex_unlock(&kmem_memory_type_lock);
+	return mtype;
+}
+
+static void kmem_put_memory_types(void)
+{
+	struct kmem_memory_type *kt, *next;
+
+	mutex_lock(&kmem_memory_type_lock);
+	list_for_each_entry_safe(kt, next, &kmem_memory_types, list) {
+		list_del(&kt->list);
+		destroy_memory_type(kt->mtype);
+		kfree(kt);
+	}
+	mutex_unlock(&kmem_memory_type_lock);
+}
+
 static int dax_kmem_range(struct dev_dax *dev_dax, int i, struct range *r)
 {
 	struct dev_dax_range *dax_range = &dev_dax->ranges[i];
@@ -46,13 +129,14 @@ static int dax_kmem_range(struct dev_dax *dev_dax, int i, struct range *r)
 struct dax_kmem_data {
 	const char *res_name;
 	int mgid;
+	struct memory_dev_type *mtype;
 	struct resource *res[];
 };
 
-static struct memory_dev_type *dax_slowmem_type;
 static int dev_dax_kmem_probe(struct dev_dax *dev_dax)
 {
 	struct device *dev = &dev_dax->dev;
+	struct memory_dev_type *mtype;
 	unsigned long total_len = 0;
 	struct dax_kmem_data *data;
 	int i, rc, mapped = 0;
@@ -88,12 +172,17 @@ static int dev_dax_kmem_probe(struct dev_dax *dev_dax)
 		return -EINVAL;
 	}
 
-	init_node_memory_type(numa_node, dax_slowmem_type);
+	mtype = kmem_find_alloc_memory_type(READ_ONCE(kmem_adistance));
+	if (IS_ERR(mtype))
+		return PTR_ERR(mtype);
+
+	init_node_memory_type(numa_node, mtype);
 
 	rc = -ENOMEM;
 	data = kzalloc(struct_size(data, res, dev_dax->nr_range), GFP_KERNEL);
 	if (!data)
 		goto err_dax_kmem_data;
+	data->mtype = mtype;
 
 	data->res_name = kstrdup(dev_name(dev), GFP_KERNEL);
 	if (!data->res_name)
@@ -167,7 +256,7 @@ static int dev_dax_kmem_probe(struct dev_dax *dev_dax)
 err_res_name:
 	kfree(data);
 err_dax_kmem_data:
-	clear_node_memory_type(numa_node, dax_slowmem_type);
+	clear_node_memory_type(numa_node, mtype);
 	return rc;
 }
 
@@ -208,6 +297,8 @@ static void dev_dax_kmem_remove(struct dev_dax *dev_dax)
 	}
 
 	if (success >= dev_dax->nr_range) {
+		struct memory_dev_type *mtype = data->mtype;
+
 		memory_group_unregister(data->mgid);
 		kfree(data->res_name);
 		kfree(data);
@@ -219,7 +310,7 @@ static void dev_dax_kmem_remove(struct dev_dax *dev_dax)
 		 * for that. This implies this reference will be around
 		 * till next reboot.
 		 */
-		clear_node_memory_type(node, dax_slowmem_type);
+		clear_node_memory_type(node, mtype);
 	}
 }
 #else
@@ -237,6 +328,12 @@ static void dev_dax_kmem_remove(struct dev_dax *dev_dax)
 #endif /* CONFIG_MEMORY_HOTREMOVE */
 
 static struct dax_device_driver device_dax_kmem_driver = {
+	/*
+	 * Hotplug itself is serialized, but this keeps onlining a large
+	 * device off the path of whoever created it, and lets the devices
+	 * overlap their setup.
+	 */
+	.drv.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	.probe = dev_dax_kmem_probe,
 	.remove = dev_dax_kmem_remove,
 };
@@ -250,22 +347,10 @@ static int __init dax_kmem_init(void)
 	if (!kmem_name)
 		return -ENOMEM;
 
-	dax_slowmem_type = alloc_memory_type(MEMTIER_DEFAULT_DAX_ADISTANCE);
-	if (IS_ERR(dax_slowmem_type)) {
-		rc = PTR_ERR(dax_slowmem_type);
-		goto err_dax_slowmem_type;
-	}
-
 	rc = dax_driver_register(&device_dax_kmem_driver);
 	if (rc)
-		goto error_dax_driver;
-
-	return rc;
+		kfree_const(kmem_name);
 
-error_dax_driver:
-	destroy_memory_type(dax_slowmem_type);
-err_dax_slowmem_type:
-	kfree_const(kmem_name);
 	return rc;
 }
 
@@ -274,7 +359,7 @@ static void __exit dax_kmem_exit(void)
 	dax_driver_unregister(&device_dax_kmem_driver);
 	if (!any_hotremove_failed)
 		kfree_const(kmem_name);
-	destroy_memory_type(dax_slowmem_type);
+	kmem_put_memory_types();
 }
 
 MODULE_AUTHOR("Intel Corporation");
@@ -11,6 +11,12 @@
 
 static bool dma_fence_chain_enable_signaling(struct dma_fence *fence);
 
+/*
+ * Number of signaled nodes a new node unlinks from behind it, see
+ * dma_fence_chain_init().
+ */
+#define DMA_FENCE_CHAIN_GC_BATCH	4
+
 /**
  * dma_fence_chain_get_prev - use RCU to get a reference to the previous fence
  * @chain: chain node to get the previous node from
@@ -29,26 +35,25 @@ static struct dma_fence *dma_fence_chain_get_prev(struct dma_fence_chain *chain)
 }
 
 /**
- * dma_fence_chain_walk - chain walking function
- * @fence: current chain node
+ * dma_fence_chain_collect - garbage collect signaled nodes
+ * @chain: chain node to start from
+ * @budget: maximum number of nodes to unlink
  *
- * Walk the chain to the next node. Returns the next fence or NULL if we are at
- * the end of the chain. Garbage collects chain nodes which are already
- * signaled.
+ * Unlink the signaled nodes which directly precede @chain, at most @budget of
+ * them. Returns the previous fence, which is not signaled unless the budget
+ * ran out, with a reference, or NULL if we reached the end of the chain.
  */
-struct dma_fence *dma_fence_chain_walk(struct dma_fence *fence)
+static struct dma_fence *dma_fence_chain_collect(struct dma_fence_chain *chain,
+						 unsigned int budget)
 {
-	struct dma_fence_chain *chain, *prev_chain;
+	struct dma_fence_chain *prev_chain;
 	struct dma_fence *prev, *replacement, *tmp;
 
-	chain = to_dma_fence_chain(fence);
-	if (!chain) {
-		dma_fence_put(fence);
-		return NULL;
-	}
-
 	while ((prev = dma_fence_chain_get_prev(chain))) {
 
+		if (!budget--)
+			break;
+
 		prev_chain = to_dma_fence_chain(prev);
 		if (prev_chain) {
 			if (!dma_fence_is_signaled(prev_chain->fence))
@@ -71,6 +76,30 @@ struct dma_fence *dma_fence_chain_walk(struct dma_fence *fence)
 		dma_fence_put(prev);
 	}
 
+	return prev;
+}
+
+/**
+ * dma_fence_chain_walk - chain walking function
+ * @fence: current chain node
+ *
+ * Walk the chain to the next node. Returns the next fence or NULL if we are at
+ * the end of the chain. Garbage collects chain nodes which are already
+ * signaled.
+ */
+struct dma_fence *dma_fence_chain_walk(struct dma_fence *fence)
+{
+	struct dma_fence_chain *chain;
+	struct dma_fence *prev;
+
+	chain = to_dma_fence_chain(fence);
+	if (!chain) {
+		dma_fence_put(fence);
+		return NULL;
+	}
+
+	prev = dma_fence_chain_collect(chain, UINT_MAX);
+
 	dma_fence_put(fence);
 	return prev;
 }
@@ -225,6 +254,10 @@ EXPORT_SYMBOL(dma_fence_chain_ops);
  *
  * Initialize a new chain node and either start a new chain or add the node to
  * the existing chain of the previous fence.
+ *
+ * Up to DMA_FENCE_CHAIN_GC_BATCH signaled nodes behind it are unlinked on the
+ * way, so that adding points to a timeline collects the ones that completed
+ * meanwhile instead of leaving them all to the next waiter.
  */
 void dma_fence_chain_init(struct dma_fence_chain *chain,
 			  struct dma_fence *prev,
@@ -261,5 +294,9 @@ void dma_fence_chain_init(struct dma_fence_chain *chain,
 	 * structure into a dma_fence_array by the caller instead.
 	 */
 	WARN_ON(dma_fence_is_chain(fence));
+
+	if (prev_chain)
+		dma_fence_put(dma_fence_chain_collect(chain,
+						      DMA_FENCE_CHAIN_GC_BATCH));
 }
 EXPORT_SYMBOL(dma_fence_chain_init);
@@ -164,6 +164,44 @@ static inline struct dma_resv_list *dma_resv_fences_list(struct dma_resv *obj)
 	return rcu_dereference_check(obj->fences, dma_resv_held(obj));
 }
 
+/*
+ * Drop the signaled fences at the end of the list in place. An unlocked
+ * reader that still walks the old length finds fences that are signaled,
+ * or freed and then restarts, or added later; like for the slots reused by
+ * dma_resv_add_fence() that's fine.
+ */
+static void dma_resv_list_trim(struct dma_resv *obj, struct dma_resv_list *list)
+{
+	unsigned int i = list->num_fences;
+
+	while (i) {
+		struct dma_fence *fence;
+
+		dma_resv_list_entry(list, i - 1, obj, &fence, NULL);
+		if (!dma_fence_is_signaled(fence))
+			break;
+		dma_fence_put(fence);
+		--i;
+	}
+	WRITE_ONCE(list->num_fences, i);
+}
+
+/* Count the fences which would be kept when copying the list. */
+static unsigned int dma_resv_list_unsignaled(struct dma_resv *obj,
+					     struct dma_resv_list *list)
+{
+	unsigned int i, count = 0;
+
+	for (i = 0; i < list->num_fences; ++i) {
+		struct dma_fence *fence;
+
+		dma_resv_list_entry(list, i, obj, &fence, NULL);
+		if (!dma_fence_is_signaled(fence))
+			++count;
+	}
+	return count;
+}
+
 /**
  * dma_resv_reserve_fences - Reserve space to add fences to a dma_resv object.
  * @obj: reservation object
@@ -188,9 +226,19 @@ int dma_resv_reserve_fences(struct dma_resv *obj, unsigned int num_fences)
 
 	old = dma_resv_fences_list(obj);
 	if (old && old->max_fences) {
+		dma_resv_list_trim(obj, old);
 		if ((old->num_fences + num_fences) <= old->max_fences)
 			return 0;
-		max = max(old->num_fences + num_fences, old->max_fences * 2);
+
+		/*
+		 * The copy below leaves the signaled fences behind, so only
+		 * grow the list if that doesn't make enough room.
+		 */
+		i = dma_resv_list_unsignaled(obj, old) + num_fences;
+		if (i <= old->max_fences)
+			max = old->max_fences;
+		else
+			max = max(i, old->max_fences * 2);
 	} else {
 		max = max(4ul, roundup_pow_of_two(num_fences));
 	}
@@ -726,12 +774,19 @@ void dma_resv_describe(struct dma_resv *obj, struct seq_file *seq)
 	static const char *usage[] = { "kernel", "write", "read", "bookkeep" };
 	struct dma_resv_iter cursor;
 	struct dma_fence *fence;
+	struct dma_resv_list *list;
 
 	dma_resv_for_each_fence(&cursor, obj, DMA_RESV_USAGE_READ, fence) {
 		seq_printf(seq, "\t%s fence:",
 			   usage[dma_resv_iter_usage(&cursor)]);
 		dma_fence_describe(fence, seq);
 	}
+
+	list = dma_resv_fences_list(obj);
+	if (list)
+		seq_printf(seq, "\tfence slots: %u unsignaled, %u used, %u allocated\n",
+			   dma_resv_list_unsignaled(obj, list),
+			   list->num_fences, list->max_fences);
 }
 EXPORT_SYMBOL_GPL(dma_resv_describe);
 
@@ -333,6 +333,46 @@ static int find_out_of_order(void *arg)
 	return err;
 }
 
+static int collect_on_add(void *arg)
+{
+	struct fence_chains fc;
+	struct dma_fence *f, *chain;
+	int err;
+
+	err = fence_chains_init(&fc, 2, seqno_inc);
+	if (err)
+		return err;
+
+	f = mock_fence();
+	if (!f) {
+		err = -ENOMEM;
+		goto err;
+	}
+
+	dma_fence_signal(fc.fences[0]);
+	dma_fence_signal(fc.fences[1]);
+
+	/* Adding a point unlinks the signaled points behind it. */
+	chain = mock_chain(fc.tail, f, 3);
+	if (!chain) {
+		err = -ENOMEM;
+		goto err_fence;
+	}
+
+	if (rcu_access_pointer(to_dma_fence_chain(chain)->prev)) {
+		pr_err("Signaled chain-fences not collected when adding seqno:3\n");
+		err = -EINVAL;
+	}
+
+	dma_fence_put(chain);
+err_fence:
+	dma_fence_signal(f);
+	dma_fence_put(f);
+err:
+	fence_chains_fini(&fc);
+	return err;
+}
+
 static uint64_t seqno_inc2(unsigned int i)
 {
 	return 2 * i + 2;
@@ -684,6 +724,7 @@ int dma_fence_chain(void)
 		SUBTEST(find_seqno),
 		SUBTEST(find_signaled),
 		SUBTEST(find_out_of_order),
+		SUBTEST(collect_on_add),
 		SUBTEST(find_gap),
 		SUBTEST(find_race),
 		SUBTEST(signal_forward),
@@ -293,6 +293,74 @@ static int test_get_fences(void *arg)
 	return r;
 }
 
+static int test_compaction(void *arg)
+{
+	enum dma_resv_usage usage = (unsigned long)arg;
+	struct dma_fence *f[4], *fence;
+	struct dma_resv_iter cursor;
+	struct dma_resv resv;
+	int i, count, r;
+
+	for (i = 0; i < ARRAY_SIZE(f); ++i) {
+		f[i] = alloc_fence();
+		if (!f[i]) {
+			while (i--)
+				dma_fence_put(f[i]);
+			return -ENOMEM;
+		}
+		dma_fence_enable_sw_signaling(f[i]);
+	}
+
+	dma_resv_init(&resv);
+	r = dma_resv_lock(&resv, NULL);
+	if (r) {
+		pr_err("Resv locking failed\n");
+		goto err_free;
+	}
+
+	r = dma_resv_reserve_fences(&resv, ARRAY_SIZE(f));
+	if (r) {
+		pr_err("Resv shared slot allocation failed\n");
+		goto err_unlock;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(f); ++i)
+		dma_resv_add_fence(&resv, f[i], usage);
+
+	/* The signaled fences at the end of the list go on the next reserve */
+	dma_fence_signal(f[2]);
+	dma_fence_signal(f[3]);
+	r = dma_resv_reserve_fences(&resv, 1);
+	if (r) {
+		pr_err("Resv shared slot allocation failed\n");
+		goto err_unlock;
+	}
+
+	count = 0;
+	dma_resv_for_each_fence(&cursor, &resv, usage, fence) {
+		if (fence != f[count]) {
+			pr_err("Unexpected fence at %d\n", count);
+			r = -EINVAL;
+			goto err_unlock;
+		}
+		++count;
+	}
+	if (count != 2) {
+		pr_err("Signaled fences not dropped, %d left\n", count);
+		r = -EINVAL;
+	}
+
+err_unlock:
+	dma_resv_unlock(&resv);
+err_free:
+	dma_resv_fini(&resv);
+	for (i = 0; i < ARRAY_SIZE(f); ++i) {
+		dma_fence_signal(f[i]);
+		dma_fence_put(f[i]);
+	}
+	return r;
+}
+
 int dma_resv(void)
 {
 	static const struct subtest tests[] = {
@@ -301,6 +369,7 @@ int dma_resv(void)
 		SUBTEST(test_for_each),
 		SUBTEST(test_for_each_unlocked),
 		SUBTEST(test_get_fences),
+		SUBTEST(test_compaction),
 	};
 	enum dma_resv_usage usage;
 	int r;
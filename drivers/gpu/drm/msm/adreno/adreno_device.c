@@ -650,10 +650,10 @@ static void suspend_scheduler(struct msm_gpu *gpu)
 
 	/*
 	 * Shut down the scheduler before we force suspend, so that
-	 * suspend isn't racing with scheduler kthread feeding us
+	 * suspend isn't racing with the scheduler work feeding us
 	 * more work.
 	 *
-	 * Note, we just want to park the thread, and let any jobs
+	 * Note, we just want to stop the submission, and let any jobs
 	 * that are already on the hw queue complete normally, as
 	 * opposed to the drm_sched_stop() path used for handling
 	 * faulting/timed-out jobs.  We can't really cancel any jobs
@@ -661,7 +661,7 @@ static void suspend_scheduler(struct msm_gpu *gpu)
 	 */
 	for (i = 0; i < gpu->nr_rings; i++) {
 		struct drm_gpu_scheduler *sched = &gpu->rb[i]->sched;
-		kthread_park(sched->thread);
+		drm_sched_wqueue_stop(sched);
 	}
 }
 
@@ -671,7 +671,7 @@ static void resume_scheduler(struct msm_gpu *gpu)
 
 	for (i = 0; i < gpu->nr_rings; i++) {
 		struct drm_gpu_scheduler *sched = &gpu->rb[i]->sched;
-		kthread_unpark(sched->thread);
+		drm_sched_wqueue_start(sched);
 	}
 }
 
@@ -152,11 +152,24 @@ int msm_gpu_pm_suspend(struct msm_gpu *gpu)
 void msm_gpu_show_fdinfo(struct msm_gpu *gpu, struct msm_file_private *ctx,
 			 struct drm_printer *p)
 {
+	int i;
+
 	drm_printf(p, "drm-driver:\t%s\n", gpu->dev->driver->name);
 	drm_printf(p, "drm-client-id:\t%u\n", ctx->seqno);
 	drm_printf(p, "drm-engine-gpu:\t%llu ns\n", ctx->elapsed_ns);
 	drm_printf(p, "drm-cycles-gpu:\t%llu\n", ctx->cycles);
 	drm_printf(p, "drm-maxfreq-gpu:\t%u Hz\n", gpu->fast_rate);
+
+	for (i = 0; i < ARRAY_SIZE(ctx->entities); i++) {
+		struct drm_sched_entity *entity = smp_load_acquire(&ctx->entities[i]);
+		char name[16];
+
+		if (!entity)
+			continue;
+
+		snprintf(name, sizeof(name), "queue%d", i);
+		drm_sched_entity_print_stats(p, entity, name);
+	}
 }
 
 int msm_gpu_hw_init(struct msm_gpu *gpu)
@@ -147,7 +147,8 @@ get_sched_entity(struct msm_file_private *ctx, struct msm_ringbuffer *ring,
 			return ERR_PTR(ret);
 		}
 
-		ctx->entities[idx] = entity;
+		/* Pairs with msm_gpu_show_fdinfo(), which doesn't take entity_lock */
+		smp_store_release(&ctx->entities[idx], entity);
 	}
 
 	mutex_unlock(&entity_lock);
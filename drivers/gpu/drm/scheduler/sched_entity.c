@@ -66,6 +66,13 @@ int drm_sched_entity_init(struct drm_sched_entity *entity,
 		return -EINVAL;
 
 	memset(entity, 0, sizeof(struct drm_sched_entity));
+
+	entity->stats = kzalloc(sizeof(*entity->stats), GFP_KERNEL);
+	if (!entity->stats)
+		return -ENOMEM;
+	kref_init(&entity->stats->kref);
+	spin_lock_init(&entity->stats->lock);
+
 	INIT_LIST_HEAD(&entity->list);
 	entity->rq = NULL;
 	entity->guilty = guilty;
@@ -116,6 +123,56 @@ void drm_sched_entity_modify_sched(struct drm_sched_entity *entity,
 }
 EXPORT_SYMBOL(drm_sched_entity_modify_sched);
 
+struct drm_sched_entity_stats *
+drm_sched_entity_stats_get(struct drm_sched_entity_stats *stats)
+{
+	kref_get(&stats->kref);
+	return stats;
+}
+
+static void drm_sched_entity_stats_release(struct kref *kref)
+{
+	kfree(container_of(kref, struct drm_sched_entity_stats, kref));
+}
+
+void drm_sched_entity_stats_put(struct drm_sched_entity_stats *stats)
+{
+	kref_put(&stats->kref, drm_sched_entity_stats_release);
+}
+
+/**
+ * drm_sched_entity_print_stats - print the statistics of an entity
+ * @p: printer, e.g. for the fdinfo of the file owning @entity
+ * @entity: scheduler entity
+ * @name: name of the engine or queue @entity submits to
+ *
+ * Prints the GPU time of the jobs of @entity that finished, how many they
+ * were, and the total and longest time they waited in the entity queue
+ * before being pushed to the hardware.
+ */
+void drm_sched_entity_print_stats(struct drm_printer *p,
+				  struct drm_sched_entity *entity,
+				  const char *name)
+{
+	struct drm_sched_entity_stats *stats = entity->stats;
+	ktime_t runtime, queue_time, queue_time_max;
+	u64 jobs;
+
+	spin_lock(&stats->lock);
+	runtime = stats->runtime;
+	queue_time = stats->queue_time;
+	queue_time_max = stats->queue_time_max;
+	jobs = stats->jobs;
+	spin_unlock(&stats->lock);
+
+	drm_printf(p, "drm-sched-runtime-%s:\t%llu ns\n", name, ktime_to_ns(runtime));
+	drm_printf(p, "drm-sched-jobs-%s:\t%llu\n", name, jobs);
+	drm_printf(p, "drm-sched-queue-%s:\t%llu ns\n", name, ktime_to_ns(queue_time));
+	drm_printf(p, "drm-sched-queue-max-%s:\t%llu ns\n", name,
+		   ktime_to_ns(queue_time_max));
+}
+EXPORT_SYMBOL(drm_sched_entity_print_stats);
+
 static bool drm_sched_entity_is_idle(struct drm_sched_entity *entity)
 {
 	rmb(); /* for list_empty to work without lock */
@@ -282,6 +339,11 @@ void drm_sched_entity_fini(struct drm_sched_entity *entity)
 
 	dma_fence_put(entity->last_scheduled);
 	entity->last_scheduled = NULL;
+
+	if (entity->stats) {
+		drm_sched_entity_stats_put(entity->stats);
+		entity->stats = NULL;
+	}
 }
 EXPORT_SYMBOL(drm_sched_entity_fini);
 
@@ -530,6 +592,8 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job)
 
 		if (drm_sched_policy == DRM_SCHED_POLICY_FIFO)
 			drm_sched_rq_update_fifo(entity, sched_job->submit_ts);
+		else if (drm_sched_policy == DRM_SCHED_POLICY_FAIR)
+			drm_sched_rq_update_fair(entity);
 
 		drm_sched_wakeup(entity->rq->sched);
 	}
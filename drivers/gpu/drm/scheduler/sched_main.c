@@ -42,9 +42,14 @@
  *    the hardware.
  *
  * The jobs in a entity are always scheduled in the order that they were pushed.
+ *
+ * Jobs are pushed to the hardware, and freed once they are done, from two
+ * work items queued on the submit workqueue of the scheduler. Each pass of
+ * the run work pushes a single job and requeues itself, so schedulers that
+ * share a workqueue interleave at job granularity; within a scheduler the
+ * run queues and the scheduling policy decide which entity goes next.
  */
 
-#include <linux/kthread.h>
 #include <linux/wait.h>
 #include <linux/sched.h>
 #include <linux/completion.h>
@@ -68,7 +73,7 @@ int drm_sched_policy = DRM_SCHED_POLICY_FIFO;
  * DOC: sched_policy (int)
  * Used to override default entities scheduling policy in a run queue.
  */
-MODULE_PARM_DESC(sched_policy, "Specify the scheduling policy for entities on a run-queue, " __stringify(DRM_SCHED_POLICY_RR) " = Round Robin, " __stringify(DRM_SCHED_POLICY_FIFO) " = FIFO (default).");
+MODULE_PARM_DESC(sched_policy, "Specify the scheduling policy for entities on a run-queue, " __stringify(DRM_SCHED_POLICY_RR) " = Round Robin, " __stringify(DRM_SCHED_POLICY_FIFO) " = FIFO (default), " __stringify(DRM_SCHED_POLICY_FAIR) " = Fair share of GPU time.");
 module_param_named(sched_policy, drm_sched_policy, int, 0444);
 
 static __always_inline bool drm_sched_entity_compare_before(struct rb_node *a,
@@ -111,6 +116,31 @@ void drm_sched_rq_update_fifo(struct drm_sched_entity *entity, ktime_t ts)
 	spin_unlock(&entity->rq_lock);
 }
 
+/**
+ * drm_sched_rq_update_fair - an entity has jobs again
+ *
+ * @entity: scheduler entity
+ *
+ * An entity that was idle, or that comes from another run queue, would be
+ * picked until it caught up with the GPU time of the others; restart it
+ * from the entity that was picked last instead.
+ */
+void drm_sched_rq_update_fair(struct drm_sched_entity *entity)
+{
+	struct drm_sched_entity_stats *stats = entity->stats;
+
+	spin_lock(&entity->rq_lock);
+	spin_lock(&entity->rq->lock);
+	spin_lock(&stats->lock);
+
+	if (ktime_before(stats->vruntime, entity->rq->min_vruntime))
+		stats->vruntime = entity->rq->min_vruntime;
+
+	spin_unlock(&stats->lock);
+	spin_unlock(&entity->rq->lock);
+	spin_unlock(&entity->rq_lock);
+}
+
 /**
  * drm_sched_rq_init - initialize a given run queue struct
  *
@@ -126,6 +156,7 @@ static void drm_sched_rq_init(struct drm_gpu_scheduler *sched,
 	INIT_LIST_HEAD(&rq->entities);
 	rq->rb_tree_root = RB_ROOT_CACHED;
 	rq->current_entity = NULL;
+	rq->min_vruntime = 0;
 	rq->sched = sched;
 }
 
@@ -251,11 +282,127 @@ drm_sched_rq_select_entity_fifo(struct drm_sched_rq *rq)
 	return rb ? rb_entry(rb, struct drm_sched_entity, rb_tree_node) : NULL;
 }
 
+/**
+ * drm_sched_run_job_queue - enqueue run-job work
+ * @sched: scheduler instance
+ */
+static void drm_sched_run_job_queue(struct drm_gpu_scheduler *sched)
+{
+	if (!READ_ONCE(sched->pause_submit))
+		queue_work(sched->submit_wq, &sched->work_run_job);
+}
+
+/**
+ * drm_sched_free_job_queue - enqueue free-job work
+ * @sched: scheduler instance
+ */
+static void drm_sched_free_job_queue(struct drm_gpu_scheduler *sched)
+{
+	if (!READ_ONCE(sched->pause_submit))
+		queue_work(sched->submit_wq, &sched->work_free_job);
+}
+
+/**
+ * drm_sched_rq_select_entity_fair - Select the entity owed the most GPU time
+ *
+ * @rq: scheduler run queue to check.
+ *
+ * Find the ready entity with the least vruntime, the GPU time its jobs used
+ * plus an estimate for those still running, so that a client with a deep
+ * queue of long jobs can't starve the others at the same priority. Returns
+ * NULL if none found.
+ */
+static struct drm_sched_entity *
+drm_sched_rq_select_entity_fair(struct drm_sched_rq *rq)
+{
+	struct drm_sched_entity *entity, *best = NULL;
+	ktime_t vruntime, best_vruntime = 0;
+
+	spin_lock(&rq->lock);
+	list_for_each_entry(entity, &rq->entities, list) {
+		if (!drm_sched_entity_is_ready(entity))
+			continue;
+
+		spin_lock(&entity->stats->lock);
+		vruntime = entity->stats->vruntime;
+		spin_unlock(&entity->stats->lock);
+
+		if (!best || ktime_before(vruntime, best_vruntime)) {
+			best = entity;
+			best_vruntime = vruntime;
+		}
+	}
+
+	if (best) {
+		rq->current_entity = best;
+		reinit_completion(&best->entity_idle);
+		if (ktime_after(best_vruntime, rq->min_vruntime))
+			rq->min_vruntime = best_vruntime;
+	}
+	spin_unlock(&rq->lock);
+
+	return best;
+}
+
+/**
+ * drm_sched_job_stats_run - account a job that is pushed to the hardware
+ *
+ * @job: the job
+ *
+ * Records how long it was queued, and charges the average GPU time of a
+ * job of the entity until it is done.
+ */
+static void drm_sched_job_stats_run(struct drm_sched_job *job)
+{
+	struct drm_sched_entity_stats *stats = job->entity_stats;
+	ktime_t queued = ktime_sub(ktime_get(), job->submit_ts);
+
+	spin_lock(&stats->lock);
+	stats->queue_time = ktime_add(stats->queue_time, queued);
+	if (ktime_after(queued, stats->queue_time_max))
+		stats->queue_time_max = queued;
+	job->charged = stats->avg_job;
+	stats->vruntime = ktime_add(stats->vruntime, job->charged);
+	spin_unlock(&stats->lock);
+}
+
+/**
+ * drm_sched_job_stats_done - account a job that finished
+ *
+ * @job: the job
+ *
+ * Called before the job is freed; the scheduled timestamp of its fence has
+ * been moved to when the previous job finished, when it started on the
+ * hardware.
+ */
+static void drm_sched_job_stats_done(struct drm_sched_job *job)
+{
+	struct drm_sched_entity_stats *stats = job->entity_stats;
+	struct drm_sched_fence *s_fence = job->s_fence;
+	ktime_t runtime;
+
+	runtime = ktime_sub(s_fence->finished.timestamp,
+			    s_fence->scheduled.timestamp);
+	if (runtime < 0)
+		runtime = 0;
+
+	spin_lock(&stats->lock);
+	stats->runtime = ktime_add(stats->runtime, runtime);
+	stats->jobs++;
+	stats->vruntime = ktime_add(stats->vruntime,
+				    ktime_sub(runtime, job->charged));
+	if (stats->jobs == 1)
+		stats->avg_job = runtime;
+	else
+		stats->avg_job = (stats->avg_job * 7 + runtime) >> 3;
+	spin_unlock(&stats->lock);
+}
+
 /**
  * drm_sched_job_done - complete a job
  * @s_job: pointer to the job which is done
  *
- * Finish the job's fence and wake up the worker thread.
+ * Finish the job's fence and queue the work that frees it.
  */
 static void drm_sched_job_done(struct drm_sched_job *s_job)
 {
@@ -270,7 +417,7 @@ static void drm_sched_job_done(struct drm_sched_job *s_job)
 	dma_fence_get(&s_fence->finished);
 	drm_sched_fence_finished(s_fence);
 	dma_fence_put(&s_fence->finished);
-	wake_up_interruptible(&sched->wake_up_worker);
+	drm_sched_free_job_queue(sched);
 }
 
 /**
@@ -390,8 +537,8 @@ static void drm_sched_job_timedout(struct work_struct *work)
 	if (job) {
 		/*
 		 * Remove the bad job so it cannot be freed by concurrent
-		 * drm_sched_cleanup_jobs. It will be reinserted back after sched->thread
-		 * is parked at which point it's safe.
+		 * drm_sched_cleanup_jobs. It will be reinserted back after the
+		 * submission work is stopped at which point it's safe.
 		 */
 		list_del_init(&job->list);
 		spin_unlock(&sched->job_list_lock);
@@ -433,14 +580,14 @@ void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad)
 {
 	struct drm_sched_job *s_job, *tmp;
 
-	kthread_park(sched->thread);
+	drm_sched_wqueue_stop(sched);
 
 	/*
 	 * Reinsert back the bad job here - now it's safe as
 	 * drm_sched_get_cleanup_job cannot race against us and release the
 	 * bad job at this point - we parked (waited for) any in progress
 	 * (earlier) cleanups and drm_sched_get_cleanup_job will not be called
-	 * now until the scheduler thread is unparked.
+	 * now until the submission work is started again.
 	 */
 	if (bad && bad->sched == sched)
 		/*
@@ -453,7 +600,7 @@ void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad)
 	 * Iterate the job list from later to  earlier one and either deactive
 	 * their HW callbacks or remove them from pending list if they already
 	 * signaled.
-	 * This iteration is thread safe as sched thread is stopped.
+	 * This iteration is thread safe as the submission work is stopped.
 	 */
 	list_for_each_entry_safe_reverse(s_job, tmp, &sched->pending_list,
 					 list) {
@@ -516,8 +663,8 @@ void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery)
 	int r;
 
 	/*
-	 * Locking the list is not required here as the sched thread is parked
-	 * so no new jobs are being inserted or removed. Also concurrent
+	 * Locking the list is not required here as the submission work is
+	 * stopped so no new jobs are being inserted or removed. Also concurrent
 	 * GPU recovers can't run in parallel.
 	 */
 	list_for_each_entry_safe(s_job, tmp, &sched->pending_list, list) {
@@ -546,7 +693,7 @@ void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery)
 		spin_unlock(&sched->job_list_lock);
 	}
 
-	kthread_unpark(sched->thread);
+	drm_sched_wqueue_start(sched);
 }
 EXPORT_SYMBOL(drm_sched_start);
 
@@ -624,6 +771,7 @@ int drm_sched_job_init(struct drm_sched_job *job,
 		return -ENOMEM;
 
 	INIT_LIST_HEAD(&job->list);
+	job->entity_stats = NULL;
 
 	xa_init_flags(&job->dependencies, XA_FLAGS_ALLOC);
 
@@ -656,6 +804,7 @@ void drm_sched_job_arm(struct drm_sched_job *job)
 	job->sched = sched;
 	job->s_priority = entity->rq - sched->sched_rq;
 	job->id = atomic64_inc_return(&sched->job_id_count);
+	job->entity_stats = drm_sched_entity_stats_get(entity->stats);
 
 	drm_sched_fence_init(job->s_fence, job->entity);
 }
@@ -794,6 +943,11 @@ void drm_sched_job_cleanup(struct drm_sched_job *job)
 
 	job->s_fence = NULL;
 
+	if (job->entity_stats) {
+		drm_sched_entity_stats_put(job->entity_stats);
+		job->entity_stats = NULL;
+	}
+
 	xa_for_each(&job->dependencies, index, fence) {
 		dma_fence_put(fence);
 	}
@@ -824,7 +978,7 @@ static bool drm_sched_ready(struct drm_gpu_scheduler *sched)
 void drm_sched_wakeup(struct drm_gpu_scheduler *sched)
 {
 	if (drm_sched_ready(sched))
-		wake_up_interruptible(&sched->wake_up_worker);
+		drm_sched_run_job_queue(sched);
 }
 
 /**
@@ -845,9 +999,12 @@ drm_sched_select_entity(struct drm_gpu_scheduler *sched)
 
 	/* Kernel run queue has higher priority than normal run queue*/
 	for (i = DRM_SCHED_PRIORITY_COUNT - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
-		entity = drm_sched_policy == DRM_SCHED_POLICY_FIFO ?
-			drm_sched_rq_select_entity_fifo(&sched->sched_rq[i]) :
-			drm_sched_rq_select_entity_rr(&sched->sched_rq[i]);
+		if (drm_sched_policy == DRM_SCHED_POLICY_FIFO)
+			entity = drm_sched_rq_select_entity_fifo(&sched->sched_rq[i]);
+		else if (drm_sched_policy == DRM_SCHED_POLICY_FAIR)
+			entity = drm_sched_rq_select_entity_fair(&sched->sched_rq[i]);
+		else
+			entity = drm_sched_rq_select_entity_rr(&sched->sched_rq[i]);
 		if (entity)
 			break;
 	}
@@ -935,94 +1092,95 @@ drm_sched_pick_best(struct drm_gpu_scheduler **sched_list,
 EXPORT_SYMBOL(drm_sched_pick_best);
 
 /**
- * drm_sched_blocked - check if the scheduler is blocked
- *
- * @sched: scheduler instance
+ * drm_sched_free_job_work - worker to call free_job
  *
- * Returns true if blocked, otherwise false.
+ * @w: free job work
  */
-static bool drm_sched_blocked(struct drm_gpu_scheduler *sched)
+static void drm_sched_free_job_work(struct work_struct *w)
 {
-	if (kthread_should_park()) {
-		kthread_parkme();
-		return true;
-	}
+	struct drm_gpu_scheduler *sched =
+		container_of(w, struct drm_gpu_scheduler, work_free_job);
+	struct drm_sched_job *cleanup_job;
+
+	if (READ_ONCE(sched->pause_submit))
+		return;
+
+	cleanup_job = drm_sched_get_cleanup_job(sched);
+	if (!cleanup_job)
+		return;
 
-	return false;
+	drm_sched_job_stats_done(cleanup_job);
+	sched->ops->free_job(cleanup_job);
+
+	/* There may be more, and there is room for another job now. */
+	drm_sched_free_job_queue(sched);
+	drm_sched_wakeup(sched);
 }
 
 /**
- * drm_sched_main - main scheduler thread
+ * drm_sched_run_job_work - worker to call run_job
  *
- * @param: scheduler instance
+ * @w: run job work
  *
- * Returns 0.
+ * Pushes one job to the hardware and requeues itself while there are more.
  */
-static int drm_sched_main(void *param)
+static void drm_sched_run_job_work(struct work_struct *w)
 {
-	struct drm_gpu_scheduler *sched = (struct drm_gpu_scheduler *)param;
+	struct drm_gpu_scheduler *sched =
+		container_of(w, struct drm_gpu_scheduler, work_run_job);
+	struct drm_sched_entity *entity;
+	struct drm_sched_fence *s_fence;
+	struct drm_sched_job *sched_job;
+	struct dma_fence *fence;
 	int r;
 
-	sched_set_fifo_low(current);
-
-	while (!kthread_should_stop()) {
-		struct drm_sched_entity *entity = NULL;
-		struct drm_sched_fence *s_fence;
-		struct drm_sched_job *sched_job;
-		struct dma_fence *fence;
-		struct drm_sched_job *cleanup_job = NULL;
-
-		wait_event_interruptible(sched->wake_up_worker,
-					 (cleanup_job = drm_sched_get_cleanup_job(sched)) ||
-					 (!drm_sched_blocked(sched) &&
-					  (entity = drm_sched_select_entity(sched))) ||
-					 kthread_should_stop());
-
-		if (cleanup_job)
-			sched->ops->free_job(cleanup_job);
-
-		if (!entity)
-			continue;
-
-		sched_job = drm_sched_entity_pop_job(entity);
+	if (READ_ONCE(sched->pause_submit))
+		return;
 
-		if (!sched_job) {
-			complete_all(&entity->entity_idle);
-			continue;
-		}
+	entity = drm_sched_select_entity(sched);
+	if (!entity)
+		return;
 
-		s_fence = sched_job->s_fence;
+	sched_job = drm_sched_entity_pop_job(entity);
+	if (!sched_job) {
+		complete_all(&entity->entity_idle);
+		/* Another entity may be ready. */
+		drm_sched_run_job_queue(sched);
+		return;
+	}
 
-		atomic_inc(&sched->hw_rq_count);
-		drm_sched_job_begin(sched_job);
+	s_fence = sched_job->s_fence;
 
-		trace_drm_run_job(sched_job, entity);
-		fence = sched->ops->run_job(sched_job);
-		complete_all(&entity->entity_idle);
-		drm_sched_fence_scheduled(s_fence);
+	atomic_inc(&sched->hw_rq_count);
+	drm_sched_job_stats_run(sched_job);
+	drm_sched_job_begin(sched_job);
 
-		if (!IS_ERR_OR_NULL(fence)) {
-			s_fence->parent = dma_fence_get(fence);
-			/* Drop for original kref_init of the fence */
-			dma_fence_put(fence);
+	trace_drm_run_job(sched_job, entity);
+	fence = sched->ops->run_job(sched_job);
+	complete_all(&entity->entity_idle);
+	drm_sched_fence_scheduled(s_fence);
 
-			r = dma_fence_add_callback(fence, &sched_job->cb,
-						   drm_sched_job_done_cb);
-			if (r == -ENOENT)
-				drm_sched_job_done(sched_job);
-			else if (r)
-				DRM_DEV_ERROR(sched->dev, "fence add callback failed (%d)\n",
-					  r);
-		} else {
-			if (IS_ERR(fence))
-				dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
+	if (!IS_ERR_OR_NULL(fence)) {
+		s_fence->parent = dma_fence_get(fence);
+		/* Drop for original kref_init of the fence */
+		dma_fence_put(fence);
 
+		r = dma_fence_add_callback(fence, &sched_job->cb,
+					   drm_sched_job_done_cb);
+		if (r == -ENOENT)
 			drm_sched_job_done(sched_job);
-		}
+		else if (r)
+			DRM_DEV_ERROR(sched->dev, "fence add callback failed (%d)\n",
+				  r);
+	} else {
+		if (IS_ERR(fence))
+			dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
 
-		wake_up(&sched->job_scheduled);
+		drm_sched_job_done(sched_job);
 	}
-	return 0;
+
+	wake_up(&sched->job_scheduled);
+	drm_sched_wakeup(sched);
 }
 
 /**
@@ -1030,6 +1188,8 @@ static int drm_sched_main(void *param)
  *
  * @sched: scheduler instance
  * @ops: backend operations for this scheduler
+ * @submit_wq: workqueue to use for submission. If NULL, an ordered wq is
+ *	       allocated and used
  * @hw_submission: number of hw submissions that can be in flight
  * @hang_limit: number of times to allow a job to hang before dropping it
  * @timeout: timeout value in jiffies for the scheduler
@@ -1043,11 +1203,12 @@ static int drm_sched_main(void *param)
  */
 int drm_sched_init(struct drm_gpu_scheduler *sched,
 		   const struct drm_sched_backend_ops *ops,
+		   struct workqueue_struct *submit_wq,
 		   unsigned hw_submission, unsigned hang_limit,
 		   long timeout, struct workqueue_struct *timeout_wq,
 		   atomic_t *score, const char *name, struct device *dev)
 {
-	int i, ret;
+	int i;
 	sched->ops = ops;
 	sched->hw_submission_limit = hw_submission;
 	sched->name = name;
@@ -1056,26 +1217,34 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 	sched->hang_limit = hang_limit;
 	sched->score = score ? score : &sched->_score;
 	sched->dev = dev;
+
+	if (submit_wq) {
+		sched->submit_wq = submit_wq;
+		sched->own_submit_wq = false;
+	} else {
+		/* Ordered: the run and free work never run concurrently. */
+		sched->submit_wq = alloc_ordered_workqueue("%s", WQ_MEM_RECLAIM |
+							   WQ_HIGHPRI, name);
+		if (!sched->submit_wq) {
+			DRM_DEV_ERROR(sched->dev, "Failed to create scheduler for %s.\n", name);
+			return -ENOMEM;
+		}
+		sched->own_submit_wq = true;
+	}
+
 	for (i = DRM_SCHED_PRIORITY_MIN; i < DRM_SCHED_PRIORITY_COUNT; i++)
 		drm_sched_rq_init(sched, &sched->sched_rq[i]);
 
-	init_waitqueue_head(&sched->wake_up_worker);
 	init_waitqueue_head(&sched->job_scheduled);
 	INIT_LIST_HEAD(&sched->pending_list);
 	spin_lock_init(&sched->job_list_lock);
 	atomic_set(&sched->hw_rq_count, 0);
 	INIT_DELAYED_WORK(&sched->work_tdr, drm_sched_job_timedout);
+	INIT_WORK(&sched->work_run_job, drm_sched_run_job_work);
+	INIT_WORK(&sched->work_free_job, drm_sched_free_job_work);
 	atomic_set(&sched->_score, 0);
 	atomic64_set(&sched->job_id_count, 0);
-
-	/* Each scheduler will run on a seperate kernel thread */
-	sched->thread = kthread_run(drm_sched_main, sched, sched->name);
-	if (IS_ERR(sched->thread)) {
-		ret = PTR_ERR(sched->thread);
-		sched->thread = NULL;
-		DRM_DEV_ERROR(sched->dev, "Failed to create scheduler for %s.\n", name);
-		return ret;
-	}
+	sched->pause_submit = false;
 
 	sched->ready = true;
 	return 0;
@@ -1094,8 +1263,7 @@ void drm_sched_fini(struct drm_gpu_scheduler *sched)
 	struct drm_sched_entity *s_entity;
 	int i;
 
-	if (sched->thread)
-		kthread_stop(sched->thread);
+	drm_sched_wqueue_stop(sched);
 
 	for (i = DRM_SCHED_PRIORITY_COUNT - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
 		struct drm_sched_rq *rq = &sched->sched_rq[i];
@@ -1121,6 +1289,8 @@ void drm_sched_fini(struct drm_gpu_scheduler *sched)
 	/* Confirm no work left behind accessing device structures */
 	cancel_delayed_work_sync(&sched->work_tdr);
 
+	if (sched->own_submit_wq)
+		destroy_workqueue(sched->submit_wq);
 	sched->ready = false;
 }
 EXPORT_SYMBOL(drm_sched_fini);
@@ -1168,3 +1338,45 @@ void drm_sched_increase_karma(struct drm_sched_job *bad)
 	}
 }
 EXPORT_SYMBOL(drm_sched_increase_karma);
+
+/**
+ * drm_sched_wqueue_ready - Is the scheduler ready for submission
+ *
+ * @sched: scheduler instance
+ *
+ * Returns true if submission is ready
+ */
+bool drm_sched_wqueue_ready(struct drm_gpu_scheduler *sched)
+{
+	return sched->submit_wq;
+}
+EXPORT_SYMBOL(drm_sched_wqueue_ready);
+
+/**
+ * drm_sched_wqueue_stop - stop scheduler submission
+ *
+ * @sched: scheduler instance
+ *
+ * Waits for the submission and free work in flight; nothing is pushed to
+ * the hardware or freed until drm_sched_wqueue_start() is called.
+ */
+void drm_sched_wqueue_stop(struct drm_gpu_scheduler *sched)
+{
+	WRITE_ONCE(sched->pause_submit, true);
+	cancel_work_sync(&sched->work_run_job);
+	cancel_work_sync(&sched->work_free_job);
+}
+EXPORT_SYMBOL(drm_sched_wqueue_stop);
+
+/**
+ * drm_sched_wqueue_start - start scheduler submission
+ *
+ * @sched: scheduler instance
+ */
+void drm_sched_wqueue_start(struct drm_gpu_scheduler *sched)
+{
+	WRITE_ONCE(sched->pause_submit, false);
+	queue_work(sched->submit_wq, &sched->work_run_job);
+	queue_work(sched->submit_wq, &sched->work_free_job);
+}
+EXPORT_SYMBOL(drm_sched_wqueue_start);
@@ -453,14 +453,111 @@ static void complete_rdma_req(struct rtrs_clt_io_req *req, int errno,
 		req->conf(req->priv, errno);
 }
 
+static void rtrs_clt_flush_plug(struct rtrs_clt_plug *plug)
+{
+	const struct ib_send_wr *bad_wr;
+	int err;
+
+	if (!plug->head)
+		return;
+
+	err = ib_post_send(plug->con->c.qp, plug->head, &bad_wr);
+	if (err) {
+		/*
+		 * The requests are already accounted as inflight, so
+		 * reconnecting fails them over or completes them with an
+		 * error, as for requests lost with the connection.
+		 */
+		rtrs_err_rl(plug->con->c.path,
+			    "Failed to post batched requests: %d\n", err);
+		rtrs_rdma_error_recovery(plug->con);
+	}
+	plug->head = NULL;
+	plug->tail = NULL;
+}
+
+/**
+ * rtrs_clt_start_plug() - Start batching requests.
+ * @plug:	Plug to initialize.
+ */
+void rtrs_clt_start_plug(struct rtrs_clt_plug *plug)
+{
+	*plug = (struct rtrs_clt_plug) {};
+	/* Keeps the paths and their connections around until the flush */
+	rcu_read_lock();
+}
+EXPORT_SYMBOL(rtrs_clt_start_plug);
+
+/**
+ * rtrs_clt_finish_plug() - Post the requests batched in a plug.
+ * @plug:	Plug started with rtrs_clt_start_plug().
+ */
+void rtrs_clt_finish_plug(struct rtrs_clt_plug *plug)
+{
+	rtrs_clt_flush_plug(plug);
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL(rtrs_clt_finish_plug);
+
+/*
+ * Post the RDMA write with immediate of @req, preceded by @head and
+ * followed by @tail if not NULL, or add these to @plug if there is one.
+ */
+static int rtrs_clt_post_rdma_write_imm(struct rtrs_clt_con *con,
+					struct rtrs_clt_io_req *req,
+					struct rtrs_clt_plug *plug,
+					struct ib_sge *sge,
+					unsigned int num_sge, u32 rkey,
+					u64 rdma_addr, u32 imm,
+					enum ib_send_flags flags,
+					struct ib_send_wr *head,
+					struct ib_send_wr *tail)
+{
+	struct ib_send_wr *first, *last;
+	int err;
+
+	if (!plug)
+		return rtrs_iu_post_rdma_write_imm(&con->c, req->iu, sge,
+						    num_sge, rkey, rdma_addr,
+						    imm, flags, head, tail);
+
+	err = rtrs_iu_init_rdma_write_imm(req->iu, &req->rdma_wr, sge, num_sge,
+					  rkey, rdma_addr, imm, flags);
+	if (err)
+		return err;
+
+	first = last = &req->rdma_wr.wr;
+	if (head) {
+		head->next = first;
+		first = head;
+	}
+	if (tail) {
+		last->next = tail;
+		last = tail;
+	}
+
+	if (plug->con != con) {
+		rtrs_clt_flush_plug(plug);
+		plug->con = con;
+	}
+	if (plug->tail)
+		plug->tail->next = first;
+	else
+		plug->head = first;
+	plug->tail = last;
+
+	return 0;
+}
+
 static int rtrs_post_send_rdma(struct rtrs_clt_con *con,
 				struct rtrs_clt_io_req *req,
 				struct rtrs_rbuf *rbuf, u32 off,
-				u32 imm, struct ib_send_wr *wr)
+				u32 imm, struct ib_send_wr *wr,
+				struct rtrs_clt_plug *plug)
 {
 	struct rtrs_clt_path *clt_path = to_clt_path(con->c.path);
+	struct ib_sge *sge = req->sge;
 	enum ib_send_flags flags;
-	struct ib_sge sge;
 
 	if (!req->sg_size) {
 		rtrs_wrn(con->c.path,
@@ -469,9 +566,9 @@ static int rtrs_post_send_rdma(struct rtrs_clt_con *con,
 	}
 
 	/* user data and user message in the first list element */
-	sge.addr   = req->iu->dma_addr;
-	sge.length = req->sg_size;
-	sge.lkey   = clt_path->s.dev->ib_pd->local_dma_lkey;
+	sge->addr   = req->iu->dma_addr;
+	sge->length = req->sg_size;
+	sge->lkey   = clt_path->s.dev->ib_pd->local_dma_lkey;
 
 	/*
 	 * From time to time we have to post signalled sends,
@@ -484,9 +581,9 @@ static int rtrs_post_send_rdma(struct rtrs_clt_con *con,
 				      req->iu->dma_addr,
 				      req->sg_size, DMA_TO_DEVICE);
 
-	return rtrs_iu_post_rdma_write_imm(&con->c, req->iu, &sge, 1,
-					    rbuf->rkey, rbuf->addr + off,
-					    imm, flags, wr, NULL);
+	return rtrs_clt_post_rdma_write_imm(con, req, plug, sge, 1, rbuf->rkey,
+					    rbuf->addr + off, imm, flags, wr,
+					    NULL);
 }
 
 static void process_io_rsp(struct rtrs_clt_path *clt_path, u32 msg_id,
@@ -1012,7 +1109,8 @@ static int rtrs_post_rdma_write_sg(struct rtrs_clt_con *con,
 				   struct rtrs_rbuf *rbuf, bool fr_en,
 				   u32 count, u32 size, u32 imm,
 				   struct ib_send_wr *wr,
-				   struct ib_send_wr *tail)
+				   struct ib_send_wr *tail,
+				   struct rtrs_clt_plug *plug)
 {
 	struct rtrs_clt_path *clt_path = to_clt_path(con->c.path);
 	struct ib_sge *sge = req->sge;
@@ -1053,7 +1151,7 @@ static int rtrs_post_rdma_write_sg(struct rtrs_clt_con *con,
 				      req->iu->dma_addr,
 				      size, DMA_TO_DEVICE);
 
-	return rtrs_iu_post_rdma_write_imm(&con->c, req->iu, sge, num_sge,
+	return rtrs_clt_post_rdma_write_imm(con, req, plug, sge, num_sge,
 					    rbuf->rkey, rbuf->addr, imm,
 					    flags, wr, ptail);
 }
@@ -1071,7 +1169,8 @@ static int rtrs_map_sg_fr(struct rtrs_clt_io_req *req, size_t count)
 	return nr;
 }
 
-static int rtrs_clt_write_req(struct rtrs_clt_io_req *req)
+static int rtrs_clt_write_req(struct rtrs_clt_io_req *req,
+			      struct rtrs_clt_plug *plug)
 {
 	struct rtrs_clt_con *con = req->con;
 	struct rtrs_path *s = con->c.path;
@@ -1081,8 +1180,8 @@ static int rtrs_clt_write_req(struct rtrs_clt_io_req *req)
 	struct rtrs_rbuf *rbuf;
 	int ret, count = 0;
 	u32 imm, buf_id;
-	struct ib_reg_wr rwr;
-	struct ib_send_wr inv_wr;
+	struct ib_reg_wr *rwr = &req->reg_wr;
+	struct ib_send_wr *inv_wr = &req->inv_wr;
 	struct ib_send_wr *wr = NULL;
 	bool fr_en = false;
 
@@ -1123,21 +1222,21 @@ static int rtrs_clt_write_req(struct rtrs_clt_io_req *req)
 					req->sg_cnt, req->dir);
 			return ret;
 		}
-		inv_wr = (struct ib_send_wr) {
+		*inv_wr = (struct ib_send_wr) {
 			.opcode		    = IB_WR_LOCAL_INV,
 			.wr_cqe		    = &req->inv_cqe,
 			.send_flags	    = IB_SEND_SIGNALED,
 			.ex.invalidate_rkey = req->mr->rkey,
 		};
 		req->inv_cqe.done = rtrs_clt_inv_rkey_done;
-		rwr = (struct ib_reg_wr) {
+		*rwr = (struct ib_reg_wr) {
 			.wr.opcode = IB_WR_REG_MR,
 			.wr.wr_cqe = &fast_reg_cqe,
 			.mr = req->mr,
 			.key = req->mr->rkey,
 			.access = (IB_ACCESS_LOCAL_WRITE),
 		};
-		wr = &rwr.wr;
+		wr = &rwr->wr;
 		fr_en = true;
 		refcount_inc(&req->ref);
 	}
@@ -1149,7 +1248,7 @@ static int rtrs_clt_write_req(struct rtrs_clt_io_req *req)
 
 	ret = rtrs_post_rdma_write_sg(req->con, req, rbuf, fr_en, count,
 				      req->usr_len + sizeof(*msg),
-				      imm, wr, &inv_wr);
+				      imm, wr, inv_wr, plug);
 	if (ret) {
 		rtrs_err_rl(s,
 			    "Write request failed: error=%d path=%s [%s:%u]\n",
@@ -1165,7 +1264,8 @@ static int rtrs_clt_write_req(struct rtrs_clt_io_req *req)
 	return ret;
 }
 
-static int rtrs_clt_read_req(struct rtrs_clt_io_req *req)
+static int rtrs_clt_read_req(struct rtrs_clt_io_req *req,
+			     struct rtrs_clt_plug *plug)
 {
 	struct rtrs_clt_con *con = req->con;
 	struct rtrs_path *s = con->c.path;
@@ -1173,7 +1273,7 @@ static int rtrs_clt_read_req(struct rtrs_clt_io_req *req)
 	struct rtrs_msg_rdma_read *msg;
 	struct rtrs_ib_dev *dev = clt_path->s.dev;
 
-	struct ib_reg_wr rwr;
+	struct ib_reg_wr *rwr = &req->reg_wr;
 	struct ib_send_wr *wr = NULL;
 
 	int ret, count = 0;
@@ -1212,7 +1312,7 @@ static int rtrs_clt_read_req(struct rtrs_clt_io_req *req)
 					req->dir);
 			return ret;
 		}
-		rwr = (struct ib_reg_wr) {
+		*rwr = (struct ib_reg_wr) {
 			.wr.opcode = IB_WR_REG_MR,
 			.wr.wr_cqe = &fast_reg_cqe,
 			.mr = req->mr,
@@ -1220,7 +1320,7 @@ static int rtrs_clt_read_req(struct rtrs_clt_io_req *req)
 			.access = (IB_ACCESS_LOCAL_WRITE |
 				   IB_ACCESS_REMOTE_WRITE),
 		};
-		wr = &rwr.wr;
+		wr = &rwr->wr;
 
 		msg->sg_cnt = cpu_to_le16(1);
 		msg->flags = cpu_to_le16(RTRS_MSG_NEED_INVAL_F);
@@ -1255,7 +1355,7 @@ static int rtrs_clt_read_req(struct rtrs_clt_io_req *req)
 	rtrs_clt_update_all_stats(req, READ);
 
 	ret = rtrs_post_send_rdma(req->con, req, &clt_path->rbufs[buf_id],
-				   req->data_len, imm, wr);
+				   req->data_len, imm, wr, plug);
 	if (ret) {
 		rtrs_err_rl(s,
 			    "Read request failed: error=%d path=%s [%s:%u]\n",
@@ -1293,9 +1393,9 @@ static int rtrs_clt_failover_req(struct rtrs_clt_sess *clt,
 			continue;
 		req = rtrs_clt_get_copy_req(alive_path, fail_req);
 		if (req->dir == DMA_TO_DEVICE)
-			err = rtrs_clt_write_req(req);
+			err = rtrs_clt_write_req(req, NULL);
 		else
-			err = rtrs_clt_read_req(req);
+			err = rtrs_clt_read_req(req, NULL);
 		if (err) {
 			req->in_use = false;
 			continue;
@@ -2976,6 +3076,9 @@ int rtrs_clt_get_max_reconnect_attempts(const struct rtrs_clt_sess *clt)
  * @sg:		Pages to be sent/received to/from server.
  * @sg_cnt:	Number of elements in the @sg
  *
+ * With @ops->plug set, the request is posted by rtrs_clt_finish_plug() or
+ * with the next request for another connection.
+ *
  * Return:
  * 0:		Success
  * <0:		Error
@@ -3029,9 +3132,9 @@ int rtrs_clt_request(int dir, struct rtrs_clt_req_ops *ops,
 				       vec, usr_len, sg, sg_cnt, data_len,
 				       dma_dir);
 		if (dir == READ)
-			err = rtrs_clt_read_req(req);
+			err = rtrs_clt_read_req(req, ops->plug);
 		else
-			err = rtrs_clt_write_req(req);
+			err = rtrs_clt_write_req(req, ops->plug);
 		if (err) {
 			req->in_use = false;
 			continue;
@@ -110,6 +110,11 @@ struct rtrs_clt_io_req {
 	void			(*conf)(void *priv, int errno);
 	unsigned long		start_jiffies;
 
+	/* Work requests, kept here until a plug posts them */
+	struct ib_rdma_wr	rdma_wr;
+	struct ib_reg_wr	reg_wr;
+	struct ib_send_wr	inv_wr;
+
 	struct ib_mr		*mr;
 	struct ib_cqe		inv_cqe;
 	struct completion	inv_comp;
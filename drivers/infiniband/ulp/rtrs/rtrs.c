@@ -149,17 +149,14 @@ int rtrs_iu_post_send(struct rtrs_con *con, struct rtrs_iu *iu, size_t size,
 }
 EXPORT_SYMBOL_GPL(rtrs_iu_post_send);
 
-int rtrs_iu_post_rdma_write_imm(struct rtrs_con *con, struct rtrs_iu *iu,
+int rtrs_iu_init_rdma_write_imm(struct rtrs_iu *iu, struct ib_rdma_wr *wr,
 				struct ib_sge *sge, unsigned int num_sge,
 				u32 rkey, u64 rdma_addr, u32 imm_data,
-				enum ib_send_flags flags,
-				struct ib_send_wr *head,
-				struct ib_send_wr *tail)
+				enum ib_send_flags flags)
 {
-	struct ib_rdma_wr wr;
 	int i;
 
-	wr = (struct ib_rdma_wr) {
+	*wr = (struct ib_rdma_wr) {
 		.wr.wr_cqe	  = &iu->cqe,
 		.wr.sg_list	  = sge,
 		.wr.num_sge	  = num_sge,
@@ -178,6 +175,25 @@ int rtrs_iu_post_rdma_write_imm(struct rtrs_con *con, struct rtrs_iu *iu,
 		if (WARN_ONCE(sge[i].length == 0, "sg %d is zero length\n", i))
 			return -EINVAL;
 
+	return 0;
+}
+EXPORT_SYMBOL_GPL(rtrs_iu_init_rdma_write_imm);
+
+int rtrs_iu_post_rdma_write_imm(struct rtrs_con *con, struct rtrs_iu *iu,
+				struct ib_sge *sge, unsigned int num_sge,
+				u32 rkey, u64 rdma_addr, u32 imm_data,
+				enum ib_send_flags flags,
+				struct ib_send_wr *head,
+				struct ib_send_wr *tail)
+{
+	struct ib_rdma_wr wr;
+	int err;
+
+	err = rtrs_iu_init_rdma_write_imm(iu, &wr, sge, num_sge, rkey,
+					  rdma_addr, imm_data, flags);
+	if (err)
+		return err;
+
 	return rtrs_post_send(con->qp, head, &wr.wr, tail);
 }
 EXPORT_SYMBOL_GPL(rtrs_iu_post_rdma_write_imm);
@@ -17,6 +17,8 @@ struct rtrs_clt_sess;
 struct rtrs_srv_ctx;
 struct rtrs_srv_sess;
 struct rtrs_srv_op;
+struct rtrs_clt_con;
+struct ib_send_wr;
 
 /*
  * RDMA transport (RTRS) client API
@@ -92,12 +94,34 @@ void rtrs_clt_put_permit(struct rtrs_clt_sess *sess,
  *	@priv:	User provided data, passed back with corresponding
  *		@(conf) confirmation.
  *	@errno: error number.
+ * @plug:	Optional plug to batch the posting of the request with.
  */
 struct rtrs_clt_req_ops {
 	void	*priv;
 	void	(*conf_fn)(void *priv, int errno);
+	struct rtrs_clt_plug *plug;
 };
 
+/**
+ * rtrs_clt_plug - batch of work requests not yet posted
+ * @con:	Connection the work requests are for.
+ * @head:	First work request of the batch.
+ * @tail:	Last work request of the batch.
+ *
+ * Requests submitted with a plug in their &struct rtrs_clt_req_ops are
+ * posted together, with a single doorbell per connection, when the plug is
+ * finished or the next request goes to another connection.  The caller may
+ * not sleep between rtrs_clt_start_plug() and rtrs_clt_finish_plug().
+ */
+struct rtrs_clt_plug {
+	struct rtrs_clt_con	*con;
+	struct ib_send_wr	*head;
+	struct ib_send_wr	*tail;
+};
+
+void rtrs_clt_start_plug(struct rtrs_clt_plug *plug);
+void rtrs_clt_finish_plug(struct rtrs_clt_plug *plug);
+
 int rtrs_clt_request(int dir, struct rtrs_clt_req_ops *ops,
 		     struct rtrs_clt_sess *sess, struct rtrs_permit *permit,
 		     const struct kvec *vec, size_t nr, size_t len,
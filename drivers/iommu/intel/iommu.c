@@ -295,6 +295,7 @@ static int iommu_skip_te_disable;
 #define IDENTMAP_AZALIA		4
 
 const struct iommu_ops intel_iommu_ops;
+static const struct iommu_dirty_ops intel_dirty_ops;
 
 static bool translation_pre_enabled(struct intel_iommu *iommu)
 {
@@ -4185,6 +4186,10 @@ static struct iommu_domain *intel_iommu_domain_alloc(unsigned type)
 				__DOMAIN_MAX_ADDR(dmar_domain->gaw);
 		domain->geometry.force_aperture = true;
 
+		/* Only the second level page table has dirty bits */
+		if (!dmar_domain->use_first_level)
+			domain->dirty_ops = &intel_dirty_ops;
+
 		return domain;
 	case IOMMU_DOMAIN_IDENTITY:
 		return &si_domain->domain;
@@ -4217,6 +4222,10 @@ static int prepare_domain_attach_device(struct iommu_domain *domain,
 	if (dmar_domain->force_snooping && !ecap_sc_support(iommu->ecap))
 		return -EINVAL;
 
+	if (dmar_domain->dirty_tracking &&
+	    !(sm_supported(iommu) && ecap_slads(iommu->ecap)))
+		return -EINVAL;
+
 	/* check if this iommu agaw is sufficient for max mapped address */
 	addr_width = agaw_to_width(iommu->agaw);
 	if (addr_width > cap_mgaw(iommu->cap))
@@ -4457,6 +4466,105 @@ static bool intel_iommu_enforce_cache_coherency(struct iommu_domain *domain)
 	return true;
 }
 
+static bool domain_support_dirty_tracking(struct dmar_domain *domain)
+{
+	struct device_domain_info *info;
+
+	assert_spin_locked(&domain->lock);
+	if (domain->use_first_level)
+		return false;
+
+	list_for_each_entry(info, &domain->devices, link) {
+		if (!sm_supported(info->iommu) ||
+		    !ecap_slads(info->iommu->ecap))
+			return false;
+	}
+
+	return true;
+}
+
+static int intel_iommu_set_dirty_tracking(struct iommu_domain *domain,
+					  bool enable)
+{
+	struct dmar_domain *dmar_domain = to_dmar_domain(domain);
+	struct device_domain_info *info;
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&dmar_domain->lock, flags);
+	if (dmar_domain->dirty_tracking == enable)
+		goto out_unlock;
+
+	if (enable && !domain_support_dirty_tracking(dmar_domain)) {
+		ret = -EOPNOTSUPP;
+		goto out_unlock;
+	}
+
+	/* Devices attached from now on are set up accordingly */
+	WRITE_ONCE(dmar_domain->dirty_tracking, enable);
+
+	list_for_each_entry(info, &dmar_domain->devices, link) {
+		ret = intel_pasid_setup_dirty_tracking(info->iommu, info->dev,
+						       PASID_RID2PASID, enable);
+		if (ret)
+			break;
+	}
+
+	if (ret) {
+		WRITE_ONCE(dmar_domain->dirty_tracking, !enable);
+		list_for_each_entry(info, &dmar_domain->devices, link)
+			intel_pasid_setup_dirty_tracking(info->iommu, info->dev,
+							 PASID_RID2PASID,
+							 !enable);
+	}
+out_unlock:
+	spin_unlock_irqrestore(&dmar_domain->lock, flags);
+
+	return ret;
+}
+
+static int intel_iommu_read_and_clear_dirty(struct iommu_domain *domain,
+					    unsigned long iova, size_t size,
+					    unsigned long flags,
+					    struct iommu_dirty_bitmap *dirty)
+{
+	struct dmar_domain *dmar_domain = to_dmar_domain(domain);
+	unsigned long end = iova + size - 1;
+
+	/*
+	 * The hardware doesn't set the dirty bits unless tracking, so only
+	 * clearing them makes sense then.
+	 */
+	if (!READ_ONCE(dmar_domain->dirty_tracking) && dirty->bitmap)
+		return -EINVAL;
+
+	do {
+		struct dma_pte *pte;
+		unsigned long pgsize;
+		int level = 0;
+
+		pte = pfn_to_dma_pte(dmar_domain, iova >> VTD_PAGE_SHIFT,
+				     &level);
+		if (!pte)
+			return -EINVAL;
+
+		/* A superpage or a whole missing table at @level */
+		pgsize = level_size(level) << VTD_PAGE_SHIFT;
+		iova &= ~(pgsize - 1);
+		if (dma_pte_present(pte) &&
+		    dma_sl_pte_test_and_clear_dirty(pte, flags))
+			iommu_dirty_bitmap_record(dirty, iova, pgsize);
+		iova += pgsize;
+	} while (iova && iova - 1 < end);
+
+	return 0;
+}
+
+static const struct iommu_dirty_ops intel_dirty_ops = {
+	.set_dirty_tracking	= intel_iommu_set_dirty_tracking,
+	.read_and_clear_dirty	= intel_iommu_read_and_clear_dirty,
+};
+
 static bool intel_iommu_capable(struct device *dev, enum iommu_cap cap)
 {
 	struct device_domain_info *info = dev_iommu_priv_get(dev);
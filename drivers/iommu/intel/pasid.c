@@ -374,6 +374,15 @@ pasid_set_pgsnp(struct pasid_entry *pe)
 	pasid_set_bits(&pe->val[1], 1ULL << 24, 1ULL << 24);
 }
 
+/*
+ * Setup the SSADE(Second Stage Access/Dirty bit Enable) field (Bit 9)
+ * of a scalable mode PASID entry.
+ */
+static inline void pasid_set_ssade(struct pasid_entry *pe, bool value)
+{
+	pasid_set_bits(&pe->val[0], 1 << 9, value << 9);
+}
+
 /*
  * Setup the First Level Page table Pointer field (Bit 140~191)
  * of a scalable mode PASID entry.
@@ -639,6 +648,8 @@ int intel_pasid_setup_second_level(struct intel_iommu *iommu,
 	pasid_set_translation_type(pte, PASID_ENTRY_PGTT_SL_ONLY);
 	pasid_set_fault_enable(pte);
 	pasid_set_page_snoop(pte, !!ecap_smpwc(iommu->ecap));
+	if (READ_ONCE(domain->dirty_tracking))
+		pasid_set_ssade(pte, true);
 
 	/*
 	 * Since it is a second level only translation setup, we should
@@ -738,3 +749,48 @@ void intel_pasid_setup_page_snoop_control(struct intel_iommu *iommu,
 	if (!cap_caching_mode(iommu->cap))
 		devtlb_invalidation_with_pasid(iommu, dev, pasid);
 }
+
+/*
+ * Enable or disable the setting of the dirty bits of the second level page
+ * table for a pasid entry which has been set up.
+ */
+int intel_pasid_setup_dirty_tracking(struct intel_iommu *iommu,
+				     struct device *dev, u32 pasid,
+				     bool enabled)
+{
+	struct pasid_entry *pte;
+	u16 did;
+
+	spin_lock(&iommu->lock);
+	pte = intel_pasid_get_entry(dev, pasid);
+	if (!pte || !pasid_pte_is_present(pte)) {
+		/* Set up later, according to the domain */
+		spin_unlock(&iommu->lock);
+		return 0;
+	}
+
+	if (pasid_pte_get_pgtt(pte) != PASID_ENTRY_PGTT_SL_ONLY) {
+		spin_unlock(&iommu->lock);
+		return -EINVAL;
+	}
+
+	pasid_set_ssade(pte, enabled);
+	did = pasid_get_domain_id(pte);
+	spin_unlock(&iommu->lock);
+
+	if (!ecap_coherent(iommu->ecap))
+		clflush_cache_range(pte, sizeof(*pte));
+
+	/*
+	 * As for any change to a present pasid entry, the PASID cache, the
+	 * IOTLB and the Device-TLB entries cached from it have to go.
+	 */
+	pasid_cache_invalidation_with_pasid(iommu, did, pasid);
+	iommu->flush.flush_iotlb(iommu, did, 0, 0, DMA_TLB_DSI_FLUSH);
+
+	/* Device IOTLB doesn't need to be flushed in caching mode. */
+	if (!cap_caching_mode(iommu->cap))
+		devtlb_invalidation_with_pasid(iommu, dev, pasid);
+
+	return 0;
+}
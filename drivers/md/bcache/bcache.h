@@ -179,6 +179,7 @@
 #define pr_fmt(fmt) "bcache: %s() " fmt, __func__
 
 #include <linux/bio.h>
+#include <linux/hrtimer.h>
 #include <linux/kobject.h>
 #include <linux/list.h>
 #include <linux/mutex.h>
@@ -375,6 +376,12 @@ struct cached_dev {
 	unsigned int		writeback_consider_fragment:1;
 	unsigned char		writeback_percent;
 	unsigned int		writeback_delay;
+	unsigned int		writeback_max_gaps;
+
+	/* Writeback batching stats, only updated by the writeback thread */
+	uint64_t		writeback_passes;
+	uint64_t		writeback_keys_written;
+	uint64_t		writeback_keys_contiguous;
 
 	uint64_t		writeback_rate_target;
 	int64_t			writeback_rate_proportional;
@@ -726,6 +733,7 @@ struct cache_set {
 	unsigned int		error_decay;
 
 	unsigned short		journal_delay_ms;
+	unsigned int		journal_group_delay_us;
 	bool			expensive_debug_checks;
 	unsigned int		verify:1;
 	unsigned int		key_merging_disabled:1;
@@ -97,6 +97,13 @@
  * For this we use a sequence number that write locks and unlocks increment - to
  * insert the check key it unlocks the btree node and then takes a write lock,
  * and fails if the sequence number doesn't match.
+ *
+ * Lookups take read locks all the way down, including on the root, even though
+ * the sequence number could tell a reader that a node changed under it. That
+ * isn't enough to search a node without its lock: inserts shift keys around in
+ * place in the last bset and rebuild its auxiliary search tree, so an unlocked
+ * iterator can follow a torn key out of the node, and the node's memory may be
+ * freed by mca_reap() (which only excludes lock holders) while we look at it.
  */
 
 #include "bset.h"
@@ -915,6 +915,47 @@ static void journal_write_work(struct work_struct *work)
 		spin_unlock(&c->journal.lock);
 }
 
+void bch_journal_group_work(struct work_struct *work)
+{
+	struct cache_set *c = container_of(work, struct cache_set,
+					   journal.group_work);
+
+	spin_lock(&c->journal.lock);
+	c->journal.group_pending = false;
+	journal_try_write(c);
+}
+
+static enum hrtimer_restart journal_group_timer_fn(struct hrtimer *timer)
+{
+	struct cache_set *c = container_of(timer, struct cache_set,
+					   journal.group_timer);
+
+	queue_work(bch_journal_wq, &c->journal.group_work);
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * If a journal write is in flight, entries added now go out with the next
+ * one anyway. Otherwise, hold the write back for journal_group_delay_us so
+ * that the synchronous entries arriving meanwhile share its flush.
+ */
+static bool journal_group_commit(struct cache_set *c)
+{
+	struct journal *j = &c->journal;
+	unsigned int delay = READ_ONCE(c->journal_group_delay_us);
+
+	if (!delay || j->io_in_flight)
+		return false;
+
+	if (!j->group_pending) {
+		j->group_pending = true;
+		hrtimer_start(&j->group_timer, us_to_ktime(delay),
+			      HRTIMER_MODE_REL);
+	}
+
+	return true;
+}
+
 /*
  * Entry point to the journalling code - bio_insert() and btree_invalidate()
  * pass bch_journal() a list of keys to be journalled, and then
@@ -945,7 +986,10 @@ atomic_t *bch_journal(struct cache_set *c,
 
 	if (parent) {
 		closure_wait(&w->wait, parent);
-		journal_try_write(c);
+		if (journal_group_commit(c))
+			spin_unlock(&c->journal.lock);
+		else
+			journal_try_write(c);
 	} else if (!w->dirty) {
 		w->dirty = true;
 		queue_delayed_work(bch_flush_wq, &c->journal.work,
@@ -985,8 +1029,12 @@ int bch_journal_alloc(struct cache_set *c)
 	spin_lock_init(&j->lock);
 	spin_lock_init(&j->flush_write_lock);
 	INIT_DELAYED_WORK(&j->work, journal_write_work);
+	INIT_WORK(&j->group_work, bch_journal_group_work);
+	hrtimer_init(&j->group_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	j->group_timer.function = journal_group_timer_fn;
 
 	c->journal_delay_ms = 100;
+	c->journal_group_delay_us = 0;
 
 	j->w[0].c = c;
 	j->w[1].c = c;
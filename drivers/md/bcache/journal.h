@@ -112,6 +112,14 @@ struct journal {
 	int			io_in_flight;
 	struct delayed_work	work;
 
+	/*
+	 * Group commit: with journal_group_delay_us set, a synchronous entry
+	 * that finds the journal idle waits that long for others to join it.
+	 */
+	struct hrtimer		group_timer;
+	struct work_struct	group_work;
+	bool			group_pending;
+
 	/* Number of blocks free in the bucket(s) we're currently writing to */
 	unsigned int		blocks_free;
 	uint64_t		seq;
@@ -176,6 +184,7 @@ atomic_t *bch_journal(struct cache_set *c,
 		      struct keylist *keys,
 		      struct closure *parent);
 void bch_journal_next(struct journal *j);
+void bch_journal_group_work(struct work_struct *work);
 void bch_journal_mark(struct cache_set *c, struct list_head *list);
 void bch_journal_meta(struct cache_set *c, struct closure *cl);
 int bch_journal_read(struct cache_set *c, struct list_head *list);
@@ -1743,6 +1743,10 @@ static void cache_set_flush(struct closure *cl)
 		kthread_stop(ca->alloc_thread);
 
 	if (c->journal.cur) {
+		/* write out a pending group commit, it has waiters */
+		if (hrtimer_cancel(&c->journal.group_timer))
+			bch_journal_group_work(&c->journal.group_work);
+		flush_work(&c->journal.group_work);
 		cancel_delayed_work_sync(&c->journal.work);
 		/* flush last journal entry if needed */
 		c->journal.work.work.func(&c->journal.work.work);
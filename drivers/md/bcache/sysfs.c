@@ -118,6 +118,10 @@ rw_attribute(writeback_percent);
 rw_attribute(writeback_delay);
 rw_attribute(writeback_rate);
 rw_attribute(writeback_consider_fragment);
+rw_attribute(writeback_max_gaps);
+read_attribute(writeback_passes);
+read_attribute(writeback_keys_written);
+read_attribute(writeback_keys_contiguous);
 
 rw_attribute(writeback_rate_update_seconds);
 rw_attribute(writeback_rate_i_term_inverse);
@@ -133,6 +137,7 @@ read_attribute(partial_stripes_expensive);
 
 rw_attribute(synchronous);
 rw_attribute(journal_delay_ms);
+rw_attribute(journal_group_delay_us);
 rw_attribute(io_disable);
 rw_attribute(discard);
 rw_attribute(running);
@@ -201,6 +206,12 @@ SHOW(__bch_cached_dev)
 	var_printf(writeback_consider_fragment,	"%i");
 	var_print(writeback_delay);
 	var_print(writeback_percent);
+	var_print(writeback_max_gaps);
+	sysfs_print(writeback_passes,	READ_ONCE(dc->writeback_passes));
+	sysfs_print(writeback_keys_written,
+		    READ_ONCE(dc->writeback_keys_written));
+	sysfs_print(writeback_keys_contiguous,
+		    READ_ONCE(dc->writeback_keys_contiguous));
 	sysfs_hprint(writeback_rate,
 		     wb ? atomic_long_read(&dc->writeback_rate.rate) << 9 : 0);
 	sysfs_printf(io_errors,		"%i", atomic_read(&dc->io_errors));
@@ -311,6 +322,8 @@ STORE(__cached_dev)
 	sysfs_strtoul_bool(writeback_running, dc->writeback_running);
 	sysfs_strtoul_bool(writeback_consider_fragment, dc->writeback_consider_fragment);
 	sysfs_strtoul_clamp(writeback_delay, dc->writeback_delay, 0, UINT_MAX);
+	sysfs_strtoul_clamp(writeback_max_gaps, dc->writeback_max_gaps,
+			    0, MAX_WRITEBACKS_IN_PASS - 1);
 
 	sysfs_strtoul_clamp(writeback_percent, dc->writeback_percent,
 			    0, bch_cutoff_writeback);
@@ -516,6 +529,10 @@ static struct attribute *bch_cached_dev_attrs[] = {
 	&sysfs_writeback_percent,
 	&sysfs_writeback_rate,
 	&sysfs_writeback_consider_fragment,
+	&sysfs_writeback_max_gaps,
+	&sysfs_writeback_passes,
+	&sysfs_writeback_keys_written,
+	&sysfs_writeback_keys_contiguous,
 	&sysfs_writeback_rate_update_seconds,
 	&sysfs_writeback_rate_i_term_inverse,
 	&sysfs_writeback_rate_p_term_inverse,
@@ -734,6 +751,7 @@ SHOW(__bch_cache_set)
 
 	sysfs_print(synchronous,		CACHE_SYNC(&c->cache->sb));
 	sysfs_print(journal_delay_ms,		c->journal_delay_ms);
+	sysfs_print(journal_group_delay_us,	c->journal_group_delay_us);
 	sysfs_hprint(bucket_size,		bucket_bytes(c->cache));
 	sysfs_hprint(block_size,		block_bytes(c->cache));
 	sysfs_print(tree_depth,			c->root->level);
@@ -915,6 +933,9 @@ STORE(__bch_cache_set)
 	sysfs_strtoul_clamp(journal_delay_ms,
 			    c->journal_delay_ms,
 			    0, USHRT_MAX);
+	sysfs_strtoul_clamp(journal_group_delay_us,
+			    c->journal_group_delay_us,
+			    0, USEC_PER_SEC);
 	sysfs_strtoul_bool(verify,		c->verify);
 	sysfs_strtoul_bool(key_merging_disabled, c->key_merging_disabled);
 	sysfs_strtoul(expensive_debug_checks,	c->expensive_debug_checks);
@@ -962,6 +983,7 @@ static struct attribute *bch_cache_set_attrs[] = {
 	&sysfs_stop,
 	&sysfs_synchronous,
 	&sysfs_journal_delay_ms,
+	&sysfs_journal_group_delay_us,
 	&sysfs_flash_vol_create,
 
 	&sysfs_bucket_size,
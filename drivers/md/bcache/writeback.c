@@ -476,7 +476,7 @@ static void read_dirty(struct cached_dev *dc)
 	unsigned int delay = 0;
 	struct keybuf_key *next, *keys[MAX_WRITEBACKS_IN_PASS], *w;
 	size_t size;
-	int nk, i;
+	int nk, i, gaps;
 	struct dirty_io *io;
 	struct closure cl;
 	uint16_t sequence = 0;
@@ -497,6 +497,7 @@ static void read_dirty(struct cached_dev *dc)
 	       next) {
 		size = 0;
 		nk = 0;
+		gaps = 0;
 
 		do {
 			BUG_ON(ptr_stale(dc->disk.c, &next->key, 0));
@@ -516,22 +517,27 @@ static void read_dirty(struct cached_dev *dc)
 				break;
 
 			/*
-			 * Operations are only eligible to be combined
-			 * if they are contiguous.
-			 *
-			 * TODO: add a heuristic willing to fire a
-			 * certain amount of non-contiguous IO per pass,
-			 * so that we can benefit from backing device
-			 * command queueing.
+			 * Operations are combined if they are contiguous.
+			 * Up to writeback_max_gaps non-contiguous ones are
+			 * allowed per pass as well, so that we can benefit
+			 * from backing device command queueing. The keybuf
+			 * is sorted, so they are still written in LBA order.
 			 */
-			if ((nk != 0) && bkey_cmp(&keys[nk-1]->key,
-						&START_KEY(&next->key)))
-				break;
+			if (nk != 0) {
+				if (!bkey_cmp(&keys[nk-1]->key,
+					      &START_KEY(&next->key)))
+					dc->writeback_keys_contiguous++;
+				else if (gaps++ >= dc->writeback_max_gaps)
+					break;
+			}
 
 			size += KEY_SIZE(&next->key);
 			keys[nk++] = next;
 		} while ((next = bch_keybuf_next(&dc->writeback_keys)));
 
+		dc->writeback_passes++;
+		dc->writeback_keys_written += nk;
+
 		/* Now we have gathered a set of 1..5 keys to write back. */
 		for (i = 0; i < nk; i++) {
 			w = keys[i];
@@ -1034,6 +1040,7 @@ void bch_cached_dev_writeback_init(struct cached_dev *dc)
 	dc->writeback_consider_fragment = true;
 	dc->writeback_percent		= 10;
 	dc->writeback_delay		= 30;
+	dc->writeback_max_gaps		= 0;
 	atomic_long_set(&dc->writeback_rate.rate, 1024);
 	dc->writeback_rate_minimum	= 8;
 
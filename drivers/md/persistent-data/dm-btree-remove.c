@@ -122,26 +122,34 @@ static int node_copy(struct btree_node *left, struct btree_node *right, int shif
 }
 
 /*
- * Delete a specific entry from a leaf node.
+ * Delete @count consecutive entries, starting at @index, from a leaf node.
  */
-static void delete_at(struct btree_node *n, unsigned index)
+static void delete_range(struct btree_node *n, unsigned index, unsigned count)
 {
 	unsigned nr_entries = le32_to_cpu(n->header.nr_entries);
-	unsigned nr_to_copy = nr_entries - (index + 1);
+	unsigned nr_to_copy = nr_entries - (index + count);
 	uint32_t value_size = le32_to_cpu(n->header.value_size);
-	BUG_ON(index >= nr_entries);
+	BUG_ON(index + count > nr_entries);
 
 	if (nr_to_copy) {
 		memmove(key_ptr(n, index),
-			key_ptr(n, index + 1),
+			key_ptr(n, index + count),
 			nr_to_copy * sizeof(__le64));
 
 		memmove(value_ptr(n, index),
-			value_ptr(n, index + 1),
+			value_ptr(n, index + count),
 			nr_to_copy * value_size);
 	}
 
-	n->header.nr_entries = cpu_to_le32(nr_entries - 1);
+	n->header.nr_entries = cpu_to_le32(nr_entries - count);
+}
+
+/*
+ * Delete a specific entry from a leaf node.
+ */
+static void delete_at(struct btree_node *n, unsigned index)
+{
+	delete_range(n, index, 1);
 }
 
 static unsigned merge_threshold(struct btree_node *n)
@@ -688,6 +696,7 @@ static int remove_one(struct dm_btree_info *info, dm_block_t root,
 		      dm_block_t *new_root, unsigned *nr_removed)
 {
 	unsigned level, last_level = info->levels - 1;
+	unsigned nr_entries, count;
 	int index = 0, r = 0;
 	struct shadow_spine spine;
 	struct btree_node *n;
@@ -716,19 +725,34 @@ static int remove_one(struct dm_btree_info *info, dm_block_t root,
 	if (index < 0)
 		index = 0;
 
-	if (index >= le32_to_cpu(n->header.nr_entries)) {
+	nr_entries = le32_to_cpu(n->header.nr_entries);
+	if (index >= nr_entries) {
 		r = -ENODATA;
 		goto out;
 	}
 
 	k = le64_to_cpu(n->keys[index]);
 	if (k >= keys[last_level] && k < end_key) {
+		/*
+		 * Take out every entry of the range that is in this leaf
+		 * while we have it shadowed, rather than walking down the
+		 * spine again for each of them. The last entry of the leaf
+		 * is left for a later pass, which rebalances the leaf on its
+		 * way down.
+		 */
+		count = 1;
+		while (index + count < nr_entries - 1 &&
+		       le64_to_cpu(n->keys[index + count]) < end_key)
+			count++;
+		k = le64_to_cpu(n->keys[index + count - 1]);
+
 		if (info->value_type.dec)
 			info->value_type.dec(info->value_type.context,
-					     value_ptr(n, index), 1);
+					     value_ptr(n, index), count);
 
-		delete_at(n, index);
+		delete_range(n, index, count);
 		keys[last_level] = k + 1ull;
+		*nr_removed += count;
 
 	} else
 		r = -ENODATA;
@@ -749,8 +773,6 @@ int dm_btree_remove_leaves(struct dm_btree_info *info, dm_block_t root,
 	*nr_removed = 0;
 	do {
 		r = remove_one(info, root, first_key, end_key, &root, nr_removed);
-		if (!r)
-			(*nr_removed)++;
 	} while (!r);
 
 	*new_root = root;
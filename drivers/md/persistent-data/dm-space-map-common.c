@@ -167,6 +167,20 @@ static void sm_set_bitmap(void *addr, unsigned b, unsigned val)
 		__clear_bit_le(b + 1, (void *) w_le);
 }
 
+/*
+ * Words in which all ENTRIES_PER_WORD entries have a reference count of 1
+ * or 2 respectively.
+ */
+#define WORD_ALL_ONE	WORD_MASK_HIGH
+#define WORD_ALL_TWO	0x5555555555555555ULL
+
+static __le64 *sm_bitmap_word(void *addr, unsigned b)
+{
+	__le64 *words_le = addr;
+
+	return words_le + (b >> ENTRIES_SHIFT);
+}
+
 static int sm_find_free(void *addr, unsigned begin, unsigned end,
 			unsigned *result)
 {
@@ -639,6 +653,66 @@ static inline int ensure_bitmap(struct ll_disk *ll, struct inc_context *ic)
 	return 0;
 }
 
+/*
+ * Provisioning and snapshots inc and dec runs of blocks that mostly share
+ * the same small reference count, so when a whole bitmap word is in the
+ * range and all its entries are 0 or 1 (for inc), or 1 or 2 (for dec), it
+ * is updated at once.  Nothing in the overflow tree is involved in that.
+ */
+static bool sm_ll_inc_word(struct ll_disk *ll, uint32_t bit, uint32_t bit_end,
+			   int32_t *nr_allocations, struct inc_context *ic)
+{
+	__le64 *w_le = sm_bitmap_word(ic->bitmap, bit);
+	uint64_t w;
+
+	if ((bit & (ENTRIES_PER_WORD - 1)) || bit_end - bit < ENTRIES_PER_WORD)
+		return false;
+
+	w = le64_to_cpu(*w_le);
+	if (w == WORD_ALL_ONE) {
+		*w_le = cpu_to_le64(WORD_ALL_TWO);
+		return true;
+	}
+
+	if (w)
+		return false;
+
+	*w_le = cpu_to_le64(WORD_ALL_ONE);
+	*nr_allocations += ENTRIES_PER_WORD;
+	ll->nr_allocated += ENTRIES_PER_WORD;
+	le32_add_cpu(&ic->ie_disk.nr_free, -ENTRIES_PER_WORD);
+	if (le32_to_cpu(ic->ie_disk.none_free_before) == bit)
+		ic->ie_disk.none_free_before = cpu_to_le32(bit + ENTRIES_PER_WORD);
+	return true;
+}
+
+static bool sm_ll_dec_word(struct ll_disk *ll, uint32_t bit, uint32_t bit_end,
+			   int32_t *nr_allocations, struct inc_context *ic)
+{
+	__le64 *w_le = sm_bitmap_word(ic->bitmap, bit);
+	uint64_t w;
+
+	if ((bit & (ENTRIES_PER_WORD - 1)) || bit_end - bit < ENTRIES_PER_WORD)
+		return false;
+
+	w = le64_to_cpu(*w_le);
+	if (w == WORD_ALL_TWO) {
+		*w_le = cpu_to_le64(WORD_ALL_ONE);
+		return true;
+	}
+
+	if (w != WORD_ALL_ONE)
+		return false;
+
+	*w_le = 0;
+	*nr_allocations -= ENTRIES_PER_WORD;
+	ll->nr_allocated -= ENTRIES_PER_WORD;
+	le32_add_cpu(&ic->ie_disk.nr_free, ENTRIES_PER_WORD);
+	ic->ie_disk.none_free_before =
+		cpu_to_le32(min(le32_to_cpu(ic->ie_disk.none_free_before), bit));
+	return true;
+}
+
 /*
  * Loops round incrementing entries in a single bitmap.
  */
@@ -661,6 +735,12 @@ static inline int sm_ll_inc_bitmap(struct ll_disk *ll, dm_block_t b,
 		if (r)
 			return r;
 
+		if (sm_ll_inc_word(ll, bit, bit_end, nr_allocations, ic)) {
+			bit += ENTRIES_PER_WORD - 1;
+			b += ENTRIES_PER_WORD - 1;
+			continue;
+		}
+
 		old = sm_lookup_bitmap(ic->bitmap, bit);
 		switch (old) {
 		case 0:
@@ -853,6 +933,12 @@ static inline int sm_ll_dec_bitmap(struct ll_disk *ll, dm_block_t b,
 		if (r)
 			return r;
 
+		if (sm_ll_dec_word(ll, bit, bit_end, nr_allocations, ic)) {
+			bit += ENTRIES_PER_WORD - 1;
+			b += ENTRIES_PER_WORD - 1;
+			continue;
+		}
+
 		old = sm_lookup_bitmap(ic->bitmap, bit);
 		switch (old) {
 		case 0:
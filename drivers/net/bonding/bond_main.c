@@ -5001,17 +5001,18 @@ static void bond_skip_slave(struct bond_up_slave *slaves,
 	 * slave but allocation failed (most likely!). BTW this is
 	 * only possible when the call is initiated from
 	 * __bond_release_one(). In this situation; overwrite the
-	 * skipslave entry in the array with the last entry from the
+	 * skipslave entries in the array with the last entry from the
 	 * array to avoid a situation where the xmit path may choose
 	 * this to-be-skipped slave to send a packet out.
 	 */
-	for (idx = 0; slaves && idx < slaves->count; idx++) {
+	for (idx = 0; slaves && idx < slaves->count;) {
 		if (skipslave == slaves->arr[idx]) {
 			slaves->arr[idx] =
 				slaves->arr[slaves->count - 1];
 			slaves->count--;
-			break;
+			continue;
 		}
+		idx++;
 	}
 }
 
@@ -5047,26 +5048,38 @@ static void bond_reset_slave_arr(struct bonding *bond)
 	}
 }
 
+/* Entries of the usable slaves array each slave owns */
+#define BOND_TX_SLOTS	16
+
 /* Build the usable slaves array in control path for modes that use xmit-hash
  * to determine the slave interface -
  * (a) BOND_MODE_8023AD
  * (b) BOND_MODE_XOR
  * (c) (BOND_MODE_TLB || BOND_MODE_ALB) && tlb_dynamic_lb == 0
  *
+ * The array is indexed by hash % count, and every slave owns BOND_TX_SLOTS
+ * entries of it whether it can transmit or not, so that count only changes
+ * with the slave list.  The entries of a slave that can't transmit are
+ * handed out to the ones that can, and a link going down or up only moves
+ * the flows hashing to that slave.  Past count, the array keeps the list of
+ * the slaves that can transmit, used to build it.
+ *
  * The caller is expected to hold RTNL only and NO other lock!
  */
 int bond_update_slave_arr(struct bonding *bond, struct slave *skipslave)
 {
 	struct bond_up_slave *usable_slaves = NULL, *all_slaves = NULL;
-	struct slave *slave;
+	struct slave **up, *slave;
 	struct list_head *iter;
+	unsigned int i, nr_up = 0;
 	int agg_id = 0;
 	int ret = 0;
 
 	might_sleep();
 
 	usable_slaves = kzalloc(struct_size(usable_slaves, arr,
-					    bond->slave_cnt), GFP_KERNEL);
+					    bond->slave_cnt *
+					    (BOND_TX_SLOTS + 1)), GFP_KERNEL);
 	all_slaves = kzalloc(struct_size(all_slaves, arr,
 					 bond->slave_cnt), GFP_KERNEL);
 	if (!usable_slaves || !all_slaves) {
@@ -5089,11 +5102,13 @@ int bond_update_slave_arr(struct bonding *bond, struct slave *skipslave)
 		spin_unlock_bh(&bond->mode_lock);
 		agg_id = ad_info.aggregator_id;
 	}
+	up = &usable_slaves->arr[bond->slave_cnt * BOND_TX_SLOTS];
 	bond_for_each_slave(bond, slave, iter) {
 		if (skipslave == slave)
 			continue;
 
 		all_slaves->arr[all_slaves->count++] = slave;
+		usable_slaves->count += BOND_TX_SLOTS;
 		if (BOND_MODE(bond) == BOND_MODE_8023AD) {
 			struct aggregator *agg;
 
@@ -5105,9 +5120,21 @@ int bond_update_slave_arr(struct bonding *bond, struct slave *skipslave)
 			continue;
 
 		slave_dbg(bond->dev, slave->dev, "Adding slave to tx hash array[%d]\n",
-			  usable_slaves->count);
+			  usable_slaves->count - BOND_TX_SLOTS);
+
+		for (i = usable_slaves->count - BOND_TX_SLOTS;
+		     i < usable_slaves->count; i++)
+			usable_slaves->arr[i] = slave;
+		up[nr_up++] = slave;
+	}
 
-		usable_slaves->arr[usable_slaves->count++] = slave;
+	/* Spread the entries of each slave that can't transmit */
+	if (nr_up) {
+		for (i = 0; i < usable_slaves->count; i++)
+			if (!usable_slaves->arr[i])
+				usable_slaves->arr[i] = up[i % nr_up];
+	} else {
+		usable_slaves->count = 0;
 	}
 
 	bond_set_slave_arr(bond, usable_slaves, all_slaves);
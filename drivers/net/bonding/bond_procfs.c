@@ -211,6 +211,19 @@ static void bond_info_show_slave(struct seq_file *seq,
 		   slave->dev->addr_len, slave->perm_hwaddr);
 	seq_printf(seq, "Slave queue ID: %d\n", slave->queue_id);
 
+	if (bond_mode_can_use_xmit_hash(bond)) {
+		const struct bond_up_slave *slaves;
+		unsigned int i, count, owned = 0;
+
+		/* The share of the tx hash this slave gets */
+		slaves = rcu_dereference(bond->usable_slaves);
+		count = slaves ? READ_ONCE(slaves->count) : 0;
+		for (i = 0; i < count; i++)
+			if (slaves->arr[i] == slave)
+				owned++;
+		seq_printf(seq, "Tx Hash Slots: %u/%u\n", owned, count);
+	}
+
 	if (BOND_MODE(bond) == BOND_MODE_8023AD) {
 		const struct port *port = &SLAVE_AD_INFO(slave)->port;
 		const struct aggregator *agg = port->aggregator;
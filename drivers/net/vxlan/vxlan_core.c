@@ -65,6 +65,9 @@ static void vxlan_vs_del_dev(struct vxlan_dev *vxlan);
 /* salt for hash table */
 static u32 vxlan_salt __read_mostly;
 
+/* Forwarding entries of all the devices, for lookups by address */
+static struct rhashtable vxlan_fdb_rht;
+
 static inline bool vxlan_collect_metadata(struct vxlan_sock *vs)
 {
 	return vs->flags & VXLAN_F_COLLECT_METADATA ||
@@ -455,25 +458,80 @@ static inline struct hlist_head *vxlan_fdb_head(struct vxlan_dev *vxlan,
 	return &vxlan->fdb_head[fdb_head_index(vxlan, mac, vni)];
 }
 
+/* The fdb_head chains are fixed in size, and only serve walking the
+ * entries of a device and picking its hash_lock.  Lookups go through
+ * vxlan_fdb_rht, which grows with the number of entries and is keyed by
+ * the device as well.
+ */
+struct vxlan_fdb_key {
+	const struct vxlan_dev *vxlan;
+	const u8 *mac;
+	__be32 vni;
+};
+
+/* The VNI is only part of the key with collect metadata */
+static __be32 vxlan_fdb_key_vni(const struct vxlan_dev *vxlan, __be32 vni)
+{
+	return vxlan->cfg.flags & VXLAN_F_COLLECT_METADATA ? vni : 0;
+}
+
+static u32 vxlan_fdb_hash(const struct vxlan_dev *vxlan, const u8 *mac,
+			  __be32 vni, u32 seed)
+{
+	u32 a = get_unaligned((u32 *)mac);
+	u32 b = get_unaligned((u16 *)(mac + 4)) ^ (__force u32)vni;
+
+	return jhash_3words(a, b, hash_ptr(vxlan, 32), seed);
+}
+
+static u32 vxlan_fdb_key_hashfn(const void *data, u32 len, u32 seed)
+{
+	const struct vxlan_fdb_key *key = data;
+
+	return vxlan_fdb_hash(key->vxlan, key->mac, key->vni, seed);
+}
+
+static u32 vxlan_fdb_obj_hashfn(const void *data, u32 len, u32 seed)
+{
+	const struct vxlan_fdb *f = data;
+	const struct vxlan_dev *vxlan = rcu_access_pointer(f->vdev);
+
+	return vxlan_fdb_hash(vxlan, f->eth_addr,
+			      vxlan_fdb_key_vni(vxlan, f->vni), seed);
+}
+
+static int vxlan_fdb_obj_cmpfn(struct rhashtable_compare_arg *arg,
+			       const void *obj)
+{
+	const struct vxlan_fdb_key *key = arg->key;
+	const struct vxlan_fdb *f = obj;
+
+	return rcu_access_pointer(f->vdev) != key->vxlan ||
+	       !ether_addr_equal(key->mac, f->eth_addr) ||
+	       vxlan_fdb_key_vni(key->vxlan, f->vni) != key->vni;
+}
+
+static const struct rhashtable_params vxlan_fdb_rht_params = {
+	.head_offset = offsetof(struct vxlan_fdb, rhnode),
+	.key_len = sizeof(struct vxlan_fdb_key),
+	.hashfn = vxlan_fdb_key_hashfn,
+	.obj_hashfn = vxlan_fdb_obj_hashfn,
+	.obj_cmpfn = vxlan_fdb_obj_cmpfn,
+	.automatic_shrinking = true,
+};
+
 /* Look up Ethernet address in forwarding table */
 static struct vxlan_fdb *__vxlan_find_mac(struct vxlan_dev *vxlan,
 					  const u8 *mac, __be32 vni)
 {
-	struct hlist_head *head = vxlan_fdb_head(vxlan, mac, vni);
-	struct vxlan_fdb *f;
-
-	hlist_for_each_entry_rcu(f, head, hlist) {
-		if (ether_addr_equal(mac, f->eth_addr)) {
-			if (vxlan->cfg.flags & VXLAN_F_COLLECT_METADATA) {
-				if (vni == f->vni)
-					return f;
-			} else {
-				return f;
-			}
-		}
-	}
+	struct vxlan_fdb_key key = {
+		.vxlan = vxlan,
+		.mac = mac,
+		.vni = vxlan_fdb_key_vni(vxlan, vni),
+	};
 
-	return NULL;
+	return rhashtable_lookup_fast(&vxlan_fdb_rht, &key,
+				      vxlan_fdb_rht_params);
 }
 
 static struct vxlan_fdb *vxlan_find_mac(struct vxlan_dev *vxlan,
@@ -784,12 +842,20 @@ static struct vxlan_fdb *vxlan_fdb_alloc(struct vxlan_dev *vxlan, const u8 *mac,
 	return f;
 }
 
-static void vxlan_fdb_insert(struct vxlan_dev *vxlan, const u8 *mac,
-			     __be32 src_vni, struct vxlan_fdb *f)
+static int vxlan_fdb_insert(struct vxlan_dev *vxlan, const u8 *mac,
+			    __be32 src_vni, struct vxlan_fdb *f)
 {
+	int err;
+
+	err = rhashtable_insert_fast(&vxlan_fdb_rht, &f->rhnode,
+				     vxlan_fdb_rht_params);
+	if (err)
+		return err;
+
 	++vxlan->addrcnt;
 	hlist_add_head_rcu(&f->hlist,
 			   vxlan_fdb_head(vxlan, mac, src_vni));
+	return 0;
 }
 
 static int vxlan_fdb_nh_update(struct vxlan_dev *vxlan, struct vxlan_fdb *fdb,
@@ -934,6 +1000,8 @@ static void vxlan_fdb_destroy(struct vxlan_dev *vxlan, struct vxlan_fdb *f,
 						 swdev_notify, NULL);
 	}
 
+	rhashtable_remove_fast(&vxlan_fdb_rht, &f->rhnode,
+			       vxlan_fdb_rht_params);
 	hlist_del_rcu(&f->hlist);
 	list_del_rcu(&f->nh_list);
 	call_rcu(&f->rcu, vxlan_fdb_free);
@@ -1070,7 +1138,11 @@ static int vxlan_fdb_update_create(struct vxlan_dev *vxlan,
 	if (rc < 0)
 		return rc;
 
-	vxlan_fdb_insert(vxlan, mac, src_vni, f);
+	rc = vxlan_fdb_insert(vxlan, mac, src_vni, f);
+	if (rc) {
+		__vxlan_fdb_free(f);
+		return rc;
+	}
 	rc = vxlan_fdb_notify(vxlan, f, first_remote_rtnl(f), RTM_NEWNEIGH,
 			      swdev_notify, extack);
 	if (rc)
@@ -3806,7 +3878,10 @@ static int __vxlan_dev_create(struct net *net, struct net_device *dev,
 		goto unlink;
 
 	if (f) {
-		vxlan_fdb_insert(vxlan, all_zeros_mac, dst->remote_vni, f);
+		err = vxlan_fdb_insert(vxlan, all_zeros_mac, dst->remote_vni,
+				       f);
+		if (err)
+			goto unlink;
 
 		/* notify default fdb entry */
 		err = vxlan_fdb_notify(vxlan, f, first_remote_rtnl(f),
@@ -4717,6 +4792,10 @@ static int __init vxlan_init_module(void)
 
 	get_random_bytes(&vxlan_salt, sizeof(vxlan_salt));
 
+	rc = rhashtable_init(&vxlan_fdb_rht, &vxlan_fdb_rht_params);
+	if (rc)
+		return rc;
+
 	rc = register_pernet_subsys(&vxlan_net_ops);
 	if (rc)
 		goto out1;
@@ -4743,6 +4822,7 @@ static int __init vxlan_init_module(void)
 out2:
 	unregister_pernet_subsys(&vxlan_net_ops);
 out1:
+	rhashtable_destroy(&vxlan_fdb_rht);
 	return rc;
 }
 late_initcall(vxlan_init_module);
@@ -4755,6 +4835,7 @@ static void __exit vxlan_cleanup_module(void)
 	unregister_netdevice_notifier(&vxlan_notifier_block);
 	unregister_pernet_subsys(&vxlan_net_ops);
 	/* rcu_barrier() is called by netns */
+	rhashtable_destroy(&vxlan_fdb_rht);
 }
 module_exit(vxlan_cleanup_module);
 
@@ -27,6 +27,7 @@ struct vxlan_net {
 /* Forwarding table entry */
 struct vxlan_fdb {
 	struct hlist_node hlist;	/* linked list of entries */
+	struct rhash_head rhnode;	/* node in vxlan_fdb_rht */
 	struct rcu_head	  rcu;
 	unsigned long	  updated;	/* jiffies */
 	unsigned long	  used;
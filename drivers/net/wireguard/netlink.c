@@ -40,7 +40,8 @@ static const struct nla_policy peer_policy[WGPEER_A_MAX + 1] = {
 	[WGPEER_A_RX_BYTES]				= { .type = NLA_U64 },
 	[WGPEER_A_TX_BYTES]				= { .type = NLA_U64 },
 	[WGPEER_A_ALLOWEDIPS]				= { .type = NLA_NESTED },
-	[WGPEER_A_PROTOCOL_VERSION]			= { .type = NLA_U32 }
+	[WGPEER_A_PROTOCOL_VERSION]			= { .type = NLA_U32 },
+	[WGPEER_A_TX_QUEUES]				= NLA_POLICY_RANGE(NLA_U16, 1, MAX_PEER_TX_QUEUES)
 };
 
 static const struct nla_policy allowedip_policy[WGALLOWEDIP_A_MAX + 1] = {
@@ -142,7 +143,9 @@ get_peer(struct wg_peer *peer, struct sk_buff *skb, struct dump_ctx *ctx)
 				      WGPEER_A_UNSPEC) ||
 		    nla_put_u64_64bit(skb, WGPEER_A_RX_BYTES, peer->rx_bytes,
 				      WGPEER_A_UNSPEC) ||
-		    nla_put_u32(skb, WGPEER_A_PROTOCOL_VERSION, 1))
+		    nla_put_u32(skb, WGPEER_A_PROTOCOL_VERSION, 1) ||
+		    nla_put_u16(skb, WGPEER_A_TX_QUEUES,
+				READ_ONCE(peer->num_tx_queues)))
 			goto err;
 
 		read_lock_bh(&peer->endpoint_lock);
@@ -479,6 +482,10 @@ static int set_peer(struct wg_device *wg, struct nlattr **attrs)
 			wg_packet_send_keepalive(peer);
 	}
 
+	if (attrs[WGPEER_A_TX_QUEUES])
+		WRITE_ONCE(peer->num_tx_queues,
+			   nla_get_u16(attrs[WGPEER_A_TX_QUEUES]));
+
 	if (netif_running(wg->dev))
 		wg_packet_send_staged_packets(peer);
 
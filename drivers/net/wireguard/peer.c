@@ -23,7 +23,7 @@ struct wg_peer *wg_peer_create(struct wg_device *wg,
 			       const u8 preshared_key[NOISE_SYMMETRIC_KEY_LEN])
 {
 	struct wg_peer *peer;
-	int ret = -ENOMEM;
+	int ret = -ENOMEM, i;
 
 	lockdep_assert_held(&wg->device_update_lock);
 
@@ -40,14 +40,20 @@ struct wg_peer *wg_peer_create(struct wg_device *wg,
 	wg_noise_handshake_init(&peer->handshake, &wg->static_identity,
 				public_key, preshared_key, peer);
 	peer->internal_id = atomic64_inc_return(&peer_counter);
-	peer->serial_work_cpu = nr_cpumask_bits;
 	wg_cookie_init(&peer->latest_cookie);
 	wg_timers_init(peer);
 	wg_cookie_checker_precompute_peer_keys(peer);
 	spin_lock_init(&peer->keypairs.keypair_update_lock);
 	INIT_WORK(&peer->transmit_handshake_work, wg_packet_handshake_send_worker);
-	INIT_WORK(&peer->transmit_packet_work, wg_packet_tx_worker);
-	wg_prev_queue_init(&peer->tx_queue);
+	for (i = 0; i < MAX_PEER_TX_QUEUES; ++i) {
+		struct wg_peer_tx_queue *txq = &peer->tx_queues[i];
+
+		INIT_WORK(&txq->work, wg_packet_tx_worker);
+		wg_prev_queue_init(&txq->queue);
+		txq->serial_work_cpu = nr_cpumask_bits;
+		txq->peer = peer;
+	}
+	peer->num_tx_queues = 1;
 	wg_prev_queue_init(&peer->rx_queue);
 	rwlock_init(&peer->endpoint_lock);
 	kref_init(&peer->refcount);
@@ -186,9 +192,12 @@ void wg_peer_remove_all(struct wg_device *wg)
 static void rcu_release(struct rcu_head *rcu)
 {
 	struct wg_peer *peer = container_of(rcu, struct wg_peer, rcu);
+	int i;
 
 	dst_cache_destroy(&peer->endpoint_cache);
-	WARN_ON(wg_prev_queue_peek(&peer->tx_queue) || wg_prev_queue_peek(&peer->rx_queue));
+	for (i = 0; i < MAX_PEER_TX_QUEUES; ++i)
+		WARN_ON(wg_prev_queue_peek(&peer->tx_queues[i].queue));
+	WARN_ON(wg_prev_queue_peek(&peer->rx_queue));
 
 	/* The final zeroing takes care of clearing any remaining handshake key
 	 * material and other potentially sensitive information.
@@ -34,11 +34,22 @@ struct endpoint {
 	};
 };
 
+/* Packets of one flow always use the same tx queue, which keeps them in order
+ * while different flows of a peer are sent in parallel.
+ */
+struct wg_peer_tx_queue {
+	struct prev_queue queue;
+	struct work_struct work;
+	int serial_work_cpu;
+	struct wg_peer *peer;
+};
+
 struct wg_peer {
 	struct wg_device *device;
-	struct prev_queue tx_queue, rx_queue;
+	struct wg_peer_tx_queue tx_queues[MAX_PEER_TX_QUEUES];
+	unsigned int num_tx_queues;
+	struct prev_queue rx_queue;
 	struct sk_buff_head staged_packet_queue;
-	int serial_work_cpu;
 	bool is_dead;
 	struct noise_keypairs keypairs;
 	struct endpoint endpoint;
@@ -46,7 +57,7 @@ struct wg_peer {
 	rwlock_t endpoint_lock;
 	struct noise_handshake handshake;
 	atomic64_t last_sent_handshake;
-	struct work_struct transmit_handshake_work, clear_peer_work, transmit_packet_work;
+	struct work_struct transmit_handshake_work, clear_peer_work;
 	struct cookie latest_cookie;
 	struct hlist_node pubkey_hash;
 	u64 rx_bytes, tx_bytes;
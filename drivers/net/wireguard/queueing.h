@@ -62,6 +62,7 @@ struct packet_cb {
 	atomic_t state;
 	u32 mtu;
 	u8 ds;
+	u8 tx_queue;
 };
 
 #define PACKET_CB(skb) ((struct packet_cb *)((skb)->cb))
@@ -186,10 +187,13 @@ static inline void wg_queue_enqueue_per_peer_tx(struct sk_buff *skb, enum packet
 	 * peer can be freed from below us.
 	 */
 	struct wg_peer *peer = wg_peer_get(PACKET_PEER(skb));
+	unsigned int index = PACKET_CB(skb)->tx_queue;
+	struct wg_peer_tx_queue *txq = &peer->tx_queues[index];
 
 	atomic_set_release(&PACKET_CB(skb)->state, state);
-	queue_work_on(wg_cpumask_choose_online(&peer->serial_work_cpu, peer->internal_id),
-		      peer->device->packet_crypt_wq, &peer->transmit_packet_work);
+	queue_work_on(wg_cpumask_choose_online(&txq->serial_work_cpu,
+					       peer->internal_id + index),
+		      peer->device->packet_crypt_wq, &txq->work);
 	wg_peer_put(peer);
 }
 
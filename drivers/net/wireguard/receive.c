@@ -494,13 +494,26 @@ void wg_packet_decrypt_worker(struct work_struct *work)
 {
 	struct crypt_queue *queue = container_of(work, struct multicore_worker,
 						 work)->ptr;
-	struct sk_buff *skb;
-
-	while ((skb = ptr_ring_consume_bh(&queue->ring)) != NULL) {
-		enum packet_state state =
-			likely(decrypt_packet(skb, PACKET_CB(skb)->keypair)) ?
-				PACKET_STATE_CRYPTED : PACKET_STATE_DEAD;
-		wg_queue_enqueue_per_peer_rx(skb, state);
+	struct sk_buff *skbs[DECRYPT_BATCH_SIZE];
+	u8 states[DECRYPT_BATCH_SIZE];
+	int i, n;
+
+	while ((n = ptr_ring_consume_batched_bh(&queue->ring, (void **)skbs,
+						ARRAY_SIZE(skbs))) > 0) {
+		for (i = 0; i < n; ++i)
+			states[i] = likely(decrypt_packet(skbs[i],
+					PACKET_CB(skbs[i])->keypair)) ?
+					PACKET_STATE_CRYPTED : PACKET_STATE_DEAD;
+
+		/* Hand over the whole batch with bottom halves disabled, so
+		 * that the peer's NAPI poll runs once over all of it rather
+		 * than after every packet, which gives GRO something to
+		 * coalesce.
+		 */
+		local_bh_disable();
+		for (i = 0; i < n; ++i)
+			wg_queue_enqueue_per_peer_rx(skbs[i], states[i]);
+		local_bh_enable();
 		if (need_resched())
 			cond_resched();
 	}
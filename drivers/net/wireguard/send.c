@@ -261,15 +261,16 @@ static void wg_packet_create_data_done(struct wg_peer *peer, struct sk_buff *fir
 
 void wg_packet_tx_worker(struct work_struct *work)
 {
-	struct wg_peer *peer = container_of(work, struct wg_peer, transmit_packet_work);
+	struct wg_peer_tx_queue *txq = container_of(work, struct wg_peer_tx_queue, work);
+	struct wg_peer *peer = txq->peer;
 	struct noise_keypair *keypair;
 	enum packet_state state;
 	struct sk_buff *first;
 
-	while ((first = wg_prev_queue_peek(&peer->tx_queue)) != NULL &&
+	while ((first = wg_prev_queue_peek(&txq->queue)) != NULL &&
 	       (state = atomic_read_acquire(&PACKET_CB(first)->state)) !=
 		       PACKET_STATE_UNCRYPTED) {
-		wg_prev_queue_drop_peeked(&peer->tx_queue);
+		wg_prev_queue_drop_peeked(&txq->queue);
 		keypair = PACKET_CB(first)->keypair;
 
 		if (likely(state == PACKET_STATE_CRYPTED))
@@ -317,8 +318,10 @@ static void wg_packet_create_data(struct wg_peer *peer, struct sk_buff *first)
 	if (unlikely(READ_ONCE(peer->is_dead)))
 		goto err;
 
-	ret = wg_queue_enqueue_per_device_and_peer(&wg->encrypt_queue, &peer->tx_queue, first,
-						   wg->packet_crypt_wq, &wg->encrypt_queue.last_cpu);
+	ret = wg_queue_enqueue_per_device_and_peer(&wg->encrypt_queue,
+						   &peer->tx_queues[PACKET_CB(first)->tx_queue].queue,
+						   first, wg->packet_crypt_wq,
+						   &wg->encrypt_queue.last_cpu);
 	if (unlikely(ret == -EPIPE))
 		wg_queue_enqueue_per_peer_tx(first, PACKET_STATE_DEAD);
 err:
@@ -338,8 +341,41 @@ void wg_packet_purge_staged_packets(struct wg_peer *peer)
 	spin_unlock_bh(&peer->staged_packet_queue.lock);
 }
 
+/* Splits the packets between the peer's tx queues by flow hash, so that each
+ * flow stays ordered while the queues are transmitted independently. Each
+ * resulting list carries its own reference to the keypair and the peer.
+ */
+static void wg_packet_create_data_multiqueue(struct wg_peer *peer,
+					     struct sk_buff_head *packets,
+					     struct noise_keypair *keypair,
+					     unsigned int num_tx_queues)
+{
+	struct sk_buff_head queues[MAX_PEER_TX_QUEUES];
+	struct sk_buff *skb;
+	unsigned int i;
+
+	for (i = 0; i < num_tx_queues; ++i)
+		__skb_queue_head_init(&queues[i]);
+	while ((skb = __skb_dequeue(packets)) != NULL)
+		__skb_queue_tail(&queues[reciprocal_scale(skb_get_hash(skb),
+							  num_tx_queues)], skb);
+
+	for (i = 0; i < num_tx_queues; ++i) {
+		if (skb_queue_empty(&queues[i]))
+			continue;
+		queues[i].prev->next = NULL;
+		skb = queues[i].next;
+		wg_peer_get(keypair->entry.peer);
+		PACKET_CB(skb)->keypair = wg_noise_keypair_get(keypair);
+		PACKET_CB(skb)->tx_queue = i;
+		wg_packet_create_data(peer, skb);
+	}
+	wg_noise_keypair_put(keypair, false);
+}
+
 void wg_packet_send_staged_packets(struct wg_peer *peer)
 {
+	unsigned int num_tx_queues = READ_ONCE(peer->num_tx_queues);
 	struct noise_keypair *keypair;
 	struct sk_buff_head packets;
 	struct sk_buff *skb;
@@ -381,9 +417,16 @@ void wg_packet_send_staged_packets(struct wg_peer *peer)
 			goto out_invalid;
 	}
 
+	if (num_tx_queues > 1) {
+		wg_packet_create_data_multiqueue(peer, &packets, keypair,
+						 num_tx_queues);
+		return;
+	}
+
 	packets.prev->next = NULL;
 	wg_peer_get(keypair->entry.peer);
 	PACKET_CB(packets.next)->keypair = keypair;
+	PACKET_CB(packets.next)->tx_queue = 0;
 	wg_packet_create_data(peer, packets.next);
 	return;
 
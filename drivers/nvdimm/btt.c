@@ -16,9 +16,16 @@
 #include <linux/fs.h>
 #include <linux/nd.h>
 #include <linux/backing-dev.h>
+#include <linux/moduleparam.h>
+#include <linux/vmalloc.h>
 #include "btt.h"
 #include "nd.h"
 
+static bool map_cache = true;
+module_param(map_cache, bool, 0444);
+MODULE_PARM_DESC(map_cache,
+		"Keep a copy of the BTT map in DRAM, 4 bytes per block (default: true)");
+
 enum log_ent_request {
 	LOG_NEW_ENT = 0,
 	LOG_OLD_ENT
@@ -95,12 +102,21 @@ static int __btt_map_write(struct arena_info *arena, u32 lba, __le32 mapping,
 		unsigned long flags)
 {
 	u64 ns_off = arena->mapoff + (lba * MAP_ENT_SIZE);
+	int ret;
 
-	if (unlikely(lba >= arena->external_nlba))
+	if (unlikely(lba >= arena->external_nlba)) {
 		dev_err_ratelimited(to_dev(arena),
 			"%s: lba %#x out of range (max: %#x)\n",
 			__func__, lba, arena->external_nlba);
-	return arena_write_bytes(arena, ns_off, &mapping, MAP_ENT_SIZE, flags);
+		return arena_write_bytes(arena, ns_off, &mapping, MAP_ENT_SIZE,
+				flags);
+	}
+
+	ret = arena_write_bytes(arena, ns_off, &mapping, MAP_ENT_SIZE, flags);
+	/* Updates of an entry are serialized by lock_map() */
+	if (!ret && arena->map_cache)
+		WRITE_ONCE(arena->map_cache[lba], le32_to_cpu(mapping));
+	return ret;
 }
 
 static int btt_map_write(struct arena_info *arena, u32 lba, u32 mapping,
@@ -150,7 +166,7 @@ static int btt_map_write(struct arena_info *arena, u32 lba, u32 mapping,
 static int btt_map_read(struct arena_info *arena, u32 lba, u32 *mapping,
 			int *trim, int *error, unsigned long rwb_flags)
 {
-	int ret;
+	int ret = 0;
 	__le32 in;
 	u32 raw_mapping, postmap, ze, z_flag, e_flag;
 	u64 ns_off = arena->mapoff + (lba * MAP_ENT_SIZE);
@@ -159,12 +175,31 @@ static int btt_map_read(struct arena_info *arena, u32 lba, u32 *mapping,
 		dev_err_ratelimited(to_dev(arena),
 			"%s: lba %#x out of range (max: %#x)\n",
 			__func__, lba, arena->external_nlba);
+	else if (arena->map_cache) {
+		raw_mapping = READ_ONCE(arena->map_cache[lba]);
+		if (raw_mapping)
+			goto decode;
+	}
 
 	ret = arena_read_bytes(arena, ns_off, &in, MAP_ENT_SIZE, rwb_flags);
 	if (ret)
 		return ret;
 
 	raw_mapping = le32_to_cpu(in);
+	if (lba < arena->external_nlba && arena->map_cache) {
+		/*
+		 * An entry in its initial state maps to itself, which is
+		 * cached as a normal entry.  Don't overwrite what a map write
+		 * stored since the media was read.
+		 */
+		u32 cached = raw_mapping;
+
+		if (!(cached & MAP_ENT_NORMAL))
+			cached = lba | MAP_ENT_NORMAL;
+		cmpxchg(&arena->map_cache[lba], 0, cached);
+	}
+
+ decode:
 
 	z_flag = ent_z_flag(raw_mapping);
 	e_flag = ent_e_flag(raw_mapping);
@@ -720,13 +755,25 @@ static int log_set_indices(struct arena_info *arena)
 
 static int btt_rtt_init(struct arena_info *arena)
 {
-	arena->rtt = kcalloc(arena->nfree, sizeof(u32), GFP_KERNEL);
+	arena->rtt = kcalloc(nr_cpu_ids, sizeof(u32), GFP_KERNEL);
 	if (arena->rtt == NULL)
 		return -ENOMEM;
 
 	return 0;
 }
 
+static void btt_map_cache_init(struct arena_info *arena)
+{
+	if (!map_cache)
+		return;
+
+	/* Not worth failing the arena over, the map is still on media */
+	arena->map_cache = kvcalloc(arena->external_nlba, sizeof(u32),
+			GFP_KERNEL | __GFP_NOWARN);
+	if (!arena->map_cache)
+		dev_warn(to_dev(arena), "unable to cache the map in DRAM\n");
+}
+
 static int btt_maplocks_init(struct arena_info *arena)
 {
 	u32 i;
@@ -807,6 +854,7 @@ static void free_arenas(struct btt *btt)
 		list_del(&arena->list);
 		kfree(arena->rtt);
 		kfree(arena->map_locks);
+		kvfree(arena->map_cache);
 		kfree(arena->freelist);
 		debugfs_remove_recursive(arena->debugfs_dir);
 		kfree(arena);
@@ -905,6 +953,8 @@ static int discover_arenas(struct btt *btt)
 		if (ret)
 			goto out;
 
+		btt_map_cache_init(arena);
+
 		list_add_tail(&arena->list, &btt->arena_list);
 
 		remaining -= arena->size;
@@ -1044,6 +1094,8 @@ static int btt_meta_init(struct btt *btt)
 		ret = btt_maplocks_init(arena);
 		if (ret)
 			goto unlock;
+
+		btt_map_cache_init(arena);
 	}
 
 	btt->init_state = INIT_READY;
@@ -1199,23 +1251,27 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 	int ret = 0;
 	int t_flag, e_flag;
 	struct arena_info *arena = NULL;
-	u32 lane = 0, premap, postmap;
+	u32 cpu = 0, premap, postmap;
 
 	while (len) {
 		u32 cur_len;
 
-		lane = nd_region_acquire_lane(btt->nd_region);
+		/*
+		 * Reads don't touch the free list or the log, so instead of a
+		 * lane they only need an RTT slot that no one else uses.
+		 */
+		cpu = get_cpu();
 
 		ret = lba_to_arena(btt, sector, &premap, &arena);
 		if (ret)
-			goto out_lane;
+			goto out_cpu;
 
 		cur_len = min(btt->sector_size, len);
 
 		ret = btt_map_read(arena, premap, &postmap, &t_flag, &e_flag,
 				NVDIMM_IO_ATOMIC);
 		if (ret)
-			goto out_lane;
+			goto out_cpu;
 
 		/*
 		 * We loop to make sure that the post map LBA didn't change
@@ -1228,20 +1284,21 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 
 			if (t_flag) {
 				zero_fill_data(page, off, cur_len);
-				goto out_lane;
+				goto out_cpu;
 			}
 
 			if (e_flag) {
 				ret = -EIO;
-				goto out_lane;
+				goto out_cpu;
 			}
 
-			arena->rtt[lane] = RTT_VALID | postmap;
+			arena->rtt[cpu] = RTT_VALID | postmap;
 			/*
 			 * Barrier to make sure this write is not reordered
-			 * to do the verification map_read before the RTT store
+			 * to do the verification map_read before the RTT store,
+			 * which with the map cached is a plain load as well
 			 */
-			barrier();
+			smp_mb();
 
 			ret = btt_map_read(arena, premap, &new_map, &new_t,
 						&new_e, NVDIMM_IO_ATOMIC);
@@ -1260,10 +1317,12 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 		ret = btt_data_read(arena, page, off, postmap, cur_len);
 		if (ret) {
 			/* Media error - set the e_flag */
+			lock_map(arena, premap);
 			if (btt_map_write(arena, premap, postmap, 0, 1, NVDIMM_IO_ATOMIC))
 				dev_warn_ratelimited(to_dev(arena),
 					"Error persistently tracking bad blocks at %#x\n",
 					premap);
+			unlock_map(arena, premap);
 			goto out_rtt;
 		}
 
@@ -1273,8 +1332,8 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 				goto out_rtt;
 		}
 
-		arena->rtt[lane] = RTT_INVALID;
-		nd_region_release_lane(btt->nd_region, lane);
+		arena->rtt[cpu] = RTT_INVALID;
+		put_cpu();
 
 		len -= cur_len;
 		off += cur_len;
@@ -1284,9 +1343,9 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 	return 0;
 
  out_rtt:
-	arena->rtt[lane] = RTT_INVALID;
- out_lane:
-	nd_region_release_lane(btt->nd_region, lane);
+	arena->rtt[cpu] = RTT_INVALID;
+ out_cpu:
+	put_cpu();
 	return ret;
 }
 
@@ -1350,7 +1409,7 @@ static int btt_write_pg(struct btt *btt, struct bio_integrity_payload *bip,
 		new_postmap = arena->freelist[lane].block;
 
 		/* Wait if the new block is being read from */
-		for (i = 0; i < arena->nfree; i++)
+		for (i = 0; i < nr_cpu_ids; i++)
 			while (arena->rtt[i] == (RTT_VALID | new_postmap))
 				cpu_relax();
 
@@ -153,8 +153,12 @@ struct aligned_lock {
  * @logoff:		Offset in bytes to the log area of this arena.
  * @info2off:		Offset in bytes to the backup info block of this arena.
  * @freelist:		Pointer to in-memory list of free blocks
- * @rtt:		Pointer to in-memory "Read Tracking Table"
+ * @rtt:		Pointer to in-memory "Read Tracking Table", one entry
+ *			per CPU
  * @map_locks:		Spinlocks protecting concurrent map writes
+ * @map_cache:		Optional DRAM copy of the map, filled in as entries
+ *			are read and written through on updates.  Entries
+ *			always have a flag set, so zero means not cached.
  * @nd_btt:		Pointer to parent nd_btt structure.
  * @list:		List head for list of arenas
  * @debugfs_dir:	Debugfs dentry
@@ -187,6 +191,7 @@ struct arena_info {
 	struct free_entry *freelist;
 	u32 *rtt;
 	struct aligned_lock *map_locks;
+	u32 *map_cache;
 	struct nd_btt *nd_btt;
 	struct list_head list;
 	struct dentry *debugfs_dir;
@@ -9,6 +9,8 @@
 
 #include <linux/blkdev.h>
 #include <linux/pagemap.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
 #include <linux/hdreg.h>
 #include <linux/init.h>
 #include <linux/platform_device.h>
@@ -197,6 +199,182 @@ static blk_status_t pmem_do_write(struct pmem_device *pmem,
 	return BLK_STS_OK;
 }
 
+#ifdef CONFIG_DMA_ENGINE
+static unsigned int dma_threshold;
+module_param(dma_threshold, uint, 0444);
+MODULE_PARM_DESC(dma_threshold,
+		"Offload writes of at least this many bytes to a DMA engine (0: never)");
+
+/*
+ * A write copied by a DMA engine.  Every descriptor interrupts, as idxd may
+ * complete them out of order, and the last one to finish ends the bio.
+ * @pending holds an extra count until all of the bio is either with the
+ * engine or written by the CPU.
+ */
+struct pmem_dma_io {
+	struct bio		*bio;
+	struct device		*dev;
+	unsigned long		start;
+	bool			do_acct;
+	atomic_t		pending;
+	int			nr_maps;
+	struct pmem_dma_map {
+		dma_addr_t	src;
+		dma_addr_t	dst;
+		unsigned int	len;
+	} maps[];
+};
+
+static void pmem_dma_io_put(struct pmem_dma_io *io)
+{
+	struct pmem_dma_map *map;
+
+	if (!atomic_dec_and_test(&io->pending))
+		return;
+
+	for (map = io->maps; map < io->maps + io->nr_maps; map++) {
+		dma_unmap_page(io->dev, map->src, map->len, DMA_TO_DEVICE);
+		dma_unmap_resource(io->dev, map->dst, map->len,
+				DMA_FROM_DEVICE, 0);
+	}
+	if (io->do_acct)
+		bio_end_io_acct(io->bio, io->start);
+	bio_endio(io->bio);
+	kfree(io);
+}
+
+static void pmem_dma_callback(void *data, const struct dmaengine_result *res)
+{
+	struct pmem_dma_io *io = data;
+
+	if (res->result != DMA_TRANS_NOERROR)
+		io->bio->bi_status = BLK_STS_IOERR;
+	pmem_dma_io_put(io);
+}
+
+/*
+ * Hand a large write to the memcpy channel of this CPU, or return false with
+ * nothing done.  Once the engine has data, a segment it can't take is written
+ * by the CPU instead.  Bad blocks need their poison cleared first, and the
+ * flush for REQ_FUA may sleep, so such bios are left to the CPU as well.
+ *
+ * A completed transfer is in the persistence domain on platforms with ADR,
+ * the same guarantee memcpy_flushcache() gives.
+ */
+static bool pmem_submit_bio_dma(struct pmem_device *pmem, struct bio *bio,
+		bool do_acct)
+{
+	struct dma_async_tx_descriptor *tx;
+	struct pmem_dma_map *map;
+	struct pmem_dma_io *io;
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+	struct dma_chan *chan;
+	struct device *dev;
+	blk_status_t rc;
+	int nr = 0;
+
+	if (!dma_threshold || bio->bi_iter.bi_size < dma_threshold ||
+	    !op_is_write(bio_op(bio)) || (bio->bi_opf & REQ_FUA))
+		return false;
+	if (is_bad_pmem(&pmem->bb, bio->bi_iter.bi_sector,
+			bio->bi_iter.bi_size))
+		return false;
+
+	chan = dma_find_channel(DMA_MEMCPY);
+	if (!chan)
+		return false;
+	dev = chan->device->dev;
+
+	bio_for_each_bvec(bvec, bio, iter)
+		nr++;
+	io = kmalloc(struct_size(io, maps, nr), GFP_NOWAIT | __GFP_NOWARN);
+	if (!io)
+		return false;
+	io->bio = bio;
+	io->dev = dev;
+	io->do_acct = do_acct;
+	atomic_set(&io->pending, 1);
+	io->nr_maps = 0;
+	if (do_acct)
+		io->start = bio_start_io_acct(bio);
+
+	bio_for_each_bvec(bvec, bio, iter) {
+		phys_addr_t pmem_off = to_offset(pmem, iter.bi_sector);
+
+		if (!is_dma_copy_aligned(chan->device, bvec.bv_offset,
+					 offset_in_page(pmem_off), bvec.bv_len))
+			break;
+
+		map = &io->maps[io->nr_maps];
+		map->len = bvec.bv_len;
+		map->src = dma_map_page(dev, bvec.bv_page, bvec.bv_offset,
+				bvec.bv_len, DMA_TO_DEVICE);
+		if (dma_mapping_error(dev, map->src))
+			break;
+		map->dst = dma_map_resource(dev, pmem_to_phys(pmem, pmem_off),
+				bvec.bv_len, DMA_FROM_DEVICE, 0);
+		if (dma_mapping_error(dev, map->dst)) {
+			dma_unmap_page(dev, map->src, bvec.bv_len,
+					DMA_TO_DEVICE);
+			break;
+		}
+		io->nr_maps++;
+
+		tx = dmaengine_prep_dma_memcpy(chan, map->dst, map->src,
+				map->len, DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+		if (!tx)
+			break;
+		tx->callback_result = pmem_dma_callback;
+		tx->callback_param = io;
+		atomic_inc(&io->pending);
+		if (dma_submit_error(dmaengine_submit(tx))) {
+			atomic_dec(&io->pending);
+			break;
+		}
+	}
+	dma_async_issue_pending(chan);
+
+	/* Pick up where the engine stopped taking segments */
+	__bio_for_each_segment(bvec, bio, iter, iter) {
+		rc = pmem_do_write(pmem, bvec.bv_page, bvec.bv_offset,
+				iter.bi_sector, bvec.bv_len);
+		if (rc) {
+			bio->bi_status = rc;
+			break;
+		}
+	}
+
+	pmem_dma_io_put(io);
+	return true;
+}
+
+static void pmem_put_dma(void *unused)
+{
+	dmaengine_put();
+}
+
+static int pmem_get_dma(struct device *dev)
+{
+	if (!dma_threshold)
+		return 0;
+	/* Keeps the public memcpy channels, one per CPU, available */
+	dmaengine_get();
+	return devm_add_action_or_reset(dev, pmem_put_dma, NULL);
+}
+#else
+static bool pmem_submit_bio_dma(struct pmem_device *pmem, struct bio *bio,
+		bool do_acct)
+{
+	return false;
+}
+
+static int pmem_get_dma(struct device *dev)
+{
+	return 0;
+}
+#endif /* CONFIG_DMA_ENGINE */
+
 static void pmem_submit_bio(struct bio *bio)
 {
 	int ret = 0;
@@ -212,6 +390,8 @@ static void pmem_submit_bio(struct bio *bio)
 		ret = nvdimm_flush(nd_region, bio);
 
 	do_acct = blk_queue_io_stat(bio->bi_bdev->bd_disk->queue);
+	if (!ret && pmem_submit_bio_dma(pmem, bio, do_acct))
+		return;
 	if (do_acct)
 		start = bio_start_io_acct(bio);
 	bio_for_each_segment(bvec, bio, iter) {
@@ -519,6 +699,10 @@ static int pmem_attach_disk(struct device *dev,
 		return -EBUSY;
 	}
 
+	rc = pmem_get_dma(dev);
+	if (rc)
+		return rc;
+
 	disk = blk_alloc_disk(nid);
 	if (!disk)
 		return -ENOMEM;
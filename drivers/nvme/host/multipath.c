@@ -17,6 +17,8 @@ MODULE_PARM_DESC(multipath,
 static const char *nvme_iopolicy_names[] = {
 	[NVME_IOPOLICY_NUMA]	= "numa",
 	[NVME_IOPOLICY_RR]	= "round-robin",
+	[NVME_IOPOLICY_QD]	= "queue-depth",
+	[NVME_IOPOLICY_LAT]	= "latency",
 };
 
 static int iopolicy = NVME_IOPOLICY_NUMA;
@@ -29,6 +31,10 @@ static int nvme_set_iopolicy(const char *val, const struct kernel_param *kp)
 		iopolicy = NVME_IOPOLICY_NUMA;
 	else if (!strncmp(val, "round-robin", 11))
 		iopolicy = NVME_IOPOLICY_RR;
+	else if (!strncmp(val, "queue-depth", 11))
+		iopolicy = NVME_IOPOLICY_QD;
+	else if (!strncmp(val, "latency", 7))
+		iopolicy = NVME_IOPOLICY_LAT;
 	else
 		return -EINVAL;
 
@@ -43,7 +49,8 @@ static int nvme_get_iopolicy(char *buf, const struct kernel_param *kp)
 module_param_call(iopolicy, nvme_set_iopolicy, nvme_get_iopolicy,
 	&iopolicy, 0644);
 MODULE_PARM_DESC(iopolicy,
-	"Default multipath I/O policy; 'numa' (default) or 'round-robin'");
+	"Default multipath I/O policy; 'numa' (default), 'round-robin', "
+	"'queue-depth' or 'latency'");
 
 void nvme_mpath_default_iopolicy(struct nvme_subsystem *subsys)
 {
@@ -110,15 +117,35 @@ void nvme_failover_req(struct request *req)
 	blk_steal_bios(&ns->head->requeue_list, req);
 	spin_unlock_irqrestore(&ns->head->requeue_lock, flags);
 
+	nvme_mpath_end_request(req);
 	blk_mq_end_request(req, 0);
 	kblockd_schedule_work(&ns->head->requeue_work);
 }
 
+/* Weight of a new sample in the latency average, as a shift */
+#define NVME_PATH_LAT_WEIGHT	3
+
+/* Latencies older than this are forgotten, so that the path gets probed */
+#define NVME_PATH_LAT_AGE	HZ
+
+static inline bool nvme_iopolicy_counts(int iopolicy)
+{
+	return iopolicy == NVME_IOPOLICY_QD || iopolicy == NVME_IOPOLICY_LAT;
+}
+
 void nvme_mpath_start_request(struct request *rq)
 {
 	struct nvme_ns *ns = rq->q->queuedata;
 	struct gendisk *disk = ns->head->disk;
 
+	/* A retried request is still counted from its first start */
+	if (nvme_iopolicy_counts(READ_ONCE(ns->head->subsys->iopolicy)) &&
+	    !(nvme_req(rq)->flags & NVME_MPATH_CNT_ACTIVE)) {
+		atomic_inc(&ns->nr_active);
+		nvme_req(rq)->flags |= NVME_MPATH_CNT_ACTIVE;
+		nvme_req(rq)->path_start = ktime_get_ns();
+	}
+
 	if (!blk_queue_io_stat(disk->queue) || blk_rq_is_passthrough(rq))
 		return;
 
@@ -133,6 +160,20 @@ void nvme_mpath_end_request(struct request *rq)
 {
 	struct nvme_ns *ns = rq->q->queuedata;
 
+	if (nvme_req(rq)->flags & NVME_MPATH_CNT_ACTIVE) {
+		u64 lat = ktime_get_ns() - nvme_req(rq)->path_start;
+		u64 ewma = READ_ONCE(ns->lat_ewma);
+
+		/* Racing updates may lose a sample, which doesn't matter. */
+		if (ewma && time_before(jiffies,
+					READ_ONCE(ns->lat_stamp) + NVME_PATH_LAT_AGE))
+			lat = ewma - (ewma >> NVME_PATH_LAT_WEIGHT) +
+				(lat >> NVME_PATH_LAT_WEIGHT);
+		WRITE_ONCE(ns->lat_ewma, lat);
+		WRITE_ONCE(ns->lat_stamp, jiffies);
+		atomic_dec(&ns->nr_active);
+	}
+
 	if (!(nvme_req(rq)->flags & NVME_MPATH_IO_STATS))
 		return;
 	bdev_end_io_acct(ns->head->disk->part0, req_op(rq),
@@ -321,6 +362,60 @@ static struct nvme_ns *nvme_round_robin_path(struct nvme_ns_head *head,
 	return found;
 }
 
+/*
+ * Expected wait for an I/O on @ns: the number of I/Os in flight on it,
+ * scaled by its average latency for the latency iopolicy.  A path whose
+ * latency hasn't been measured lately is expected to be as fast as can be,
+ * so it is tried again once the congestion that made it slow may be gone.
+ */
+static u64 nvme_path_cost(struct nvme_ns *ns, int iopolicy)
+{
+	u64 depth = atomic_read(&ns->nr_active) + 1;
+
+	if (iopolicy != NVME_IOPOLICY_LAT)
+		return depth;
+	if (time_after_eq(jiffies,
+			  READ_ONCE(ns->lat_stamp) + NVME_PATH_LAT_AGE))
+		return 0;
+	return READ_ONCE(ns->lat_ewma) * depth;
+}
+
+static struct nvme_ns *nvme_least_loaded_path(struct nvme_ns_head *head,
+		int iopolicy)
+{
+	u64 min_opt = U64_MAX, min_nonopt = U64_MAX, cost;
+	struct nvme_ns *best_opt = NULL, *best_nonopt = NULL, *ns;
+
+	list_for_each_entry_rcu(ns, &head->list, siblings) {
+		if (nvme_path_is_disabled(ns))
+			continue;
+
+		cost = nvme_path_cost(ns, iopolicy);
+		switch (ns->ana_state) {
+		case NVME_ANA_OPTIMIZED:
+			if (cost < min_opt) {
+				min_opt = cost;
+				best_opt = ns;
+			}
+			break;
+		case NVME_ANA_NONOPTIMIZED:
+			if (cost < min_nonopt) {
+				min_nonopt = cost;
+				best_nonopt = ns;
+			}
+			break;
+		default:
+			break;
+		}
+
+		/* An unmeasured optimized path can't be beaten. */
+		if (!cost && ns == best_opt)
+			break;
+	}
+
+	return best_opt ? best_opt : best_nonopt;
+}
+
 static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 {
 	return ns->ctrl->state == NVME_CTRL_LIVE &&
@@ -329,14 +424,18 @@ static inline bool nvme_path_is_optimized(struct nvme_ns *ns)
 
 inline struct nvme_ns *nvme_find_path(struct nvme_ns_head *head)
 {
+	int iopolicy = READ_ONCE(head->subsys->iopolicy);
 	int node = numa_node_id();
 	struct nvme_ns *ns;
 
+	if (nvme_iopolicy_counts(iopolicy))
+		return nvme_least_loaded_path(head, iopolicy);
+
 	ns = srcu_dereference(head->current_path[node], &head->srcu);
 	if (unlikely(!ns))
 		return __nvme_find_path(head, node);
 
-	if (READ_ONCE(head->subsys->iopolicy) == NVME_IOPOLICY_RR)
+	if (iopolicy == NVME_IOPOLICY_RR)
 		return nvme_round_robin_path(head, node, ns);
 	if (unlikely(!nvme_path_is_optimized(ns)))
 		return __nvme_find_path(head, node);
@@ -823,6 +922,25 @@ static ssize_t ana_state_show(struct device *dev, struct device_attribute *attr,
 }
 DEVICE_ATTR_RO(ana_state);
 
+static ssize_t queue_depth_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_ns *ns = nvme_get_ns_from_dev(dev);
+
+	return sysfs_emit(buf, "%d\n", atomic_read(&ns->nr_active));
+}
+DEVICE_ATTR_RO(queue_depth);
+
+static ssize_t latency_us_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct nvme_ns *ns = nvme_get_ns_from_dev(dev);
+
+	return sysfs_emit(buf, "%llu\n",
+			  div_u64(READ_ONCE(ns->lat_ewma), NSEC_PER_USEC));
+}
+DEVICE_ATTR_RO(latency_us);
+
 static int nvme_lookup_ana_group_desc(struct nvme_ctrl *ctrl,
 		struct nvme_ana_group_desc *desc, void *data)
 {
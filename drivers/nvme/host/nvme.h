@@ -164,6 +164,7 @@ struct nvme_request {
 	u16			status;
 #ifdef CONFIG_NVME_MULTIPATH
 	unsigned long		start_time;
+	u64			path_start;
 #endif
 	struct nvme_ctrl	*ctrl;
 };
@@ -177,6 +178,7 @@ enum {
 	NVME_REQ_CANCELLED		= (1 << 0),
 	NVME_REQ_USERCMD		= (1 << 1),
 	NVME_MPATH_IO_STATS		= (1 << 2),
+	NVME_MPATH_CNT_ACTIVE		= (1 << 3),
 };
 
 static inline struct nvme_request *nvme_req(struct request *req)
@@ -379,6 +381,8 @@ struct nvme_ctrl {
 enum nvme_iopolicy {
 	NVME_IOPOLICY_NUMA,
 	NVME_IOPOLICY_RR,
+	NVME_IOPOLICY_QD,
+	NVME_IOPOLICY_LAT,
 };
 
 struct nvme_subsystem {
@@ -471,6 +475,10 @@ struct nvme_ns {
 #ifdef CONFIG_NVME_MULTIPATH
 	enum nvme_ana_state ana_state;
 	u32 ana_grpid;
+	/* Only kept with the queue-depth and latency iopolicies */
+	atomic_t nr_active;
+	u64 lat_ewma;		/* in ns */
+	unsigned long lat_stamp;
 #endif
 	struct list_head siblings;
 	struct kref kref;
@@ -900,6 +908,8 @@ static inline void nvme_trace_bio_complete(struct request *req)
 extern bool multipath;
 extern struct device_attribute dev_attr_ana_grpid;
 extern struct device_attribute dev_attr_ana_state;
+extern struct device_attribute dev_attr_queue_depth;
+extern struct device_attribute dev_attr_latency_us;
 extern struct device_attribute subsys_attr_iopolicy;
 
 #else
@@ -11,6 +11,7 @@
 #include <linux/blk-mq.h>
 #include <linux/blk-mq-pci.h>
 #include <linux/blk-integrity.h>
+#include <linux/dim.h>
 #include <linux/dmi.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
@@ -105,12 +106,37 @@ static bool noacpi;
 module_param(noacpi, bool, 0444);
 MODULE_PARM_DESC(noacpi, "disable acpi bios quirks");
 
+static bool adaptive_irq;
+module_param(adaptive_irq, bool, 0644);
+MODULE_PARM_DESC(adaptive_irq,
+	"adapt interrupt coalescing of the I/O queues to their load");
+
+static unsigned char irq_coalesce_thr = 8;
+module_param(irq_coalesce_thr, byte, 0644);
+MODULE_PARM_DESC(irq_coalesce_thr,
+	"completions to coalesce per interrupt with adaptive_irq (default 8)");
+
+static unsigned char irq_coalesce_time = 1;
+module_param(irq_coalesce_time, byte, 0644);
+MODULE_PARM_DESC(irq_coalesce_time,
+	"longest delay of a coalesced interrupt with adaptive_irq, in 100us "
+	"units (default 1)");
+
 struct nvme_dev;
 struct nvme_queue;
 
 static void nvme_dev_disable(struct nvme_dev *dev, bool shutdown);
 static void nvme_delete_io_queues(struct nvme_dev *dev);
 
+/*
+ * PRP and SGL list pools.  There is one set per NUMA node, so that the I/O
+ * queues of different nodes don't contend for the pool locks.
+ */
+struct nvme_descriptor_pools {
+	struct dma_pool *large;
+	struct dma_pool *small;
+};
+
 /*
  * Represents an NVM Express device.  Each nvme_dev is a PCI function.
  */
@@ -120,8 +146,6 @@ struct nvme_dev {
 	struct blk_mq_tag_set admin_tagset;
 	u32 __iomem *dbs;
 	struct device *dev;
-	struct dma_pool *prp_page_pool;
-	struct dma_pool *prp_small_pool;
 	unsigned online_queues;
 	unsigned max_qid;
 	unsigned io_queues[HCTX_MAX_TYPES];
@@ -158,6 +182,7 @@ struct nvme_dev {
 	unsigned int nr_allocated_queues;
 	unsigned int nr_write_queues;
 	unsigned int nr_poll_queues;
+	struct nvme_descriptor_pools descriptor_pools[];
 };
 
 static int io_queue_depth_set(const char *val, const struct kernel_param *kp)
@@ -187,6 +212,7 @@ static inline struct nvme_dev *to_nvme_dev(struct nvme_ctrl *ctrl)
  */
 struct nvme_queue {
 	struct nvme_dev *dev;
+	struct nvme_descriptor_pools *descriptor_pools;
 	spinlock_t sq_lock;
 	void *sq_cmds;
 	 /* only used for poll queues: */
@@ -208,11 +234,15 @@ struct nvme_queue {
 #define NVMEQ_SQ_CMB		1
 #define NVMEQ_DELETE_ERROR	2
 #define NVMEQ_POLLED		3
+#define NVMEQ_DIM		4
 	__le32 *dbbuf_sq_db;
 	__le32 *dbbuf_cq_db;
 	__le32 *dbbuf_sq_ei;
 	__le32 *dbbuf_cq_ei;
 	struct completion delete_done;
+	/* only used with adaptive_irq: */
+	struct dim dim;
+	bool coalesced;
 };
 
 /*
@@ -396,6 +426,22 @@ static int nvme_pci_npages_sgl(void)
 			NVME_CTRL_PAGE_SIZE);
 }
 
+static struct nvme_descriptor_pools *
+nvme_node_descriptor_pools(struct nvme_dev *dev, int node)
+{
+	if (node == NUMA_NO_NODE)
+		node = dev_to_node(dev->dev);
+	return &dev->descriptor_pools[node];
+}
+
+static inline struct nvme_descriptor_pools *
+nvme_req_descriptor_pools(struct request *req)
+{
+	struct nvme_queue *nvmeq = req->mq_hctx->driver_data;
+
+	return nvmeq->descriptor_pools;
+}
+
 static int nvme_admin_init_hctx(struct blk_mq_hw_ctx *hctx, void *data,
 				unsigned int hctx_idx)
 {
@@ -405,6 +451,7 @@ static int nvme_admin_init_hctx(struct blk_mq_hw_ctx *hctx, void *data,
 	WARN_ON(hctx_idx != 0);
 	WARN_ON(dev->admin_tagset.tags[0] != hctx->tags);
 
+	nvmeq->descriptor_pools = nvme_node_descriptor_pools(dev, hctx->numa_node);
 	hctx->driver_data = nvmeq;
 	return 0;
 }
@@ -416,6 +463,7 @@ static int nvme_init_hctx(struct blk_mq_hw_ctx *hctx, void *data,
 	struct nvme_queue *nvmeq = &dev->queues[hctx_idx + 1];
 
 	WARN_ON(dev->tagset.tags[hctx_idx] != hctx->tags);
+	nvmeq->descriptor_pools = nvme_node_descriptor_pools(dev, hctx->numa_node);
 	hctx->driver_data = nvmeq;
 	return 0;
 }
@@ -535,6 +583,7 @@ static inline bool nvme_pci_use_sgls(struct nvme_dev *dev, struct request *req)
 static void nvme_free_prps(struct nvme_dev *dev, struct request *req)
 {
 	const int last_prp = NVME_CTRL_PAGE_SIZE / sizeof(__le64) - 1;
+	struct nvme_descriptor_pools *pools = nvme_req_descriptor_pools(req);
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 	dma_addr_t dma_addr = iod->first_dma;
 	int i;
@@ -543,7 +592,7 @@ static void nvme_free_prps(struct nvme_dev *dev, struct request *req)
 		__le64 *prp_list = nvme_pci_iod_list(req)[i];
 		dma_addr_t next_dma_addr = le64_to_cpu(prp_list[last_prp]);
 
-		dma_pool_free(dev->prp_page_pool, prp_list, dma_addr);
+		dma_pool_free(pools->large, prp_list, dma_addr);
 		dma_addr = next_dma_addr;
 	}
 }
@@ -551,6 +600,7 @@ static void nvme_free_prps(struct nvme_dev *dev, struct request *req)
 static void nvme_free_sgls(struct nvme_dev *dev, struct request *req)
 {
 	const int last_sg = SGES_PER_PAGE - 1;
+	struct nvme_descriptor_pools *pools = nvme_req_descriptor_pools(req);
 	struct nvme_iod *iod = blk_mq_rq_to_pdu(req);
 	dma_addr_t dma_addr = iod->first_dma;
 	int i;
@@ -559,7 +609,7 @@ static void nvme_free_sgls(struct nvme_dev *dev, struct request *req)
 		struct nvme_sgl_desc *sg_list = nvme_pci_iod_list(req)[i];
 		dma_addr_t next_dma_addr = le64_to_cpu((sg_list[last_sg]).addr);
 
-		dma_pool_free(dev->prp_page_pool, sg_list, dma_addr);
+		dma_pool_free(pools->large, sg_list, dma_addr);
 		dma_addr = next_dma_addr;
 	}
 }
@@ -579,8 +629,8 @@ static void nvme_unmap_data(struct nvme_dev *dev, struct request *req)
 	dma_unmap_sgtable(dev->dev, &iod->sgt, rq_dma_dir(req), 0);
 
 	if (iod->nr_allocations == 0)
-		dma_pool_free(dev->prp_small_pool, nvme_pci_iod_list(req)[0],
-			      iod->first_dma);
+		dma_pool_free(nvme_req_descriptor_pools(req)->small,
+			      nvme_pci_iod_list(req)[0], iod->first_dma);
 	else if (iod->use_sgl)
 		nvme_free_sgls(dev, req);
 	else
@@ -639,10 +689,10 @@ static blk_status_t nvme_pci_setup_prps(struct nvme_dev *dev,
 
 	nprps = DIV_ROUND_UP(length, NVME_CTRL_PAGE_SIZE);
 	if (nprps <= (256 / 8)) {
-		pool = dev->prp_small_pool;
+		pool = nvme_req_descriptor_pools(req)->small;
 		iod->nr_allocations = 0;
 	} else {
-		pool = dev->prp_page_pool;
+		pool = nvme_req_descriptor_pools(req)->large;
 		iod->nr_allocations = 1;
 	}
 
@@ -734,10 +784,10 @@ static blk_status_t nvme_pci_setup_sgls(struct nvme_dev *dev,
 	}
 
 	if (entries <= (256 / sizeof(struct nvme_sgl_desc))) {
-		pool = dev->prp_small_pool;
+		pool = nvme_req_descriptor_pools(req)->small;
 		iod->nr_allocations = 0;
 	} else {
-		pool = dev->prp_page_pool;
+		pool = nvme_req_descriptor_pools(req)->large;
 		iod->nr_allocations = 1;
 	}
 
@@ -1131,10 +1181,14 @@ static irqreturn_t nvme_irq(int irq, void *data)
 {
 	struct nvme_queue *nvmeq = data;
 	DEFINE_IO_COMP_BATCH(iob);
+	int found;
 
-	if (nvme_poll_cq(nvmeq, &iob)) {
+	found = nvme_poll_cq(nvmeq, &iob);
+	if (found) {
 		if (!rq_list_empty(iob.req_list))
 			nvme_pci_complete_batch(&iob);
+		if (test_bit(NVMEQ_DIM, &nvmeq->flags))
+			rdma_dim(&nvmeq->dim, found);
 		return IRQ_HANDLED;
 	}
 	return IRQ_NONE;
@@ -1446,6 +1500,8 @@ static enum blk_eh_timer_return nvme_timeout(struct request *req)
 
 static void nvme_free_queue(struct nvme_queue *nvmeq)
 {
+	/* The controller is disabled, so a pending Set Features fails fast. */
+	cancel_work_sync(&nvmeq->dim.work);
 	dma_free_coherent(nvmeq->dev->dev, CQ_SIZE(nvmeq),
 				(void *)nvmeq->cqes, nvmeq->cq_dma_addr);
 	if (!nvmeq->sq_cmds)
@@ -1483,6 +1539,7 @@ static void nvme_suspend_queue(struct nvme_dev *dev, unsigned int qid)
 	nvmeq->dev->online_queues--;
 	if (!nvmeq->qid && nvmeq->dev->ctrl.admin_q)
 		nvme_quiesce_admin_queue(&nvmeq->dev->ctrl);
+	clear_bit(NVMEQ_DIM, &nvmeq->flags);
 	if (!test_and_clear_bit(NVMEQ_POLLED, &nvmeq->flags))
 		pci_free_irq(to_pci_dev(dev->dev), nvmeq->cq_vector, nvmeq);
 }
@@ -1563,6 +1620,69 @@ static int nvme_alloc_sq_cmds(struct nvme_dev *dev, struct nvme_queue *nvmeq,
 	return 0;
 }
 
+/*
+ * The aggregation threshold and time of interrupt coalescing are set for the
+ * whole controller, each interrupt vector can only turn it on or off.  DIM
+ * runs on the completions of each queue and turns coalescing on for the
+ * vector of the queue at any profile except the first one, i.e. when
+ * batching completions appears to get through more of them.
+ */
+static void nvme_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct nvme_queue *nvmeq = container_of(dim, struct nvme_queue, dim);
+	bool coalesce = dim->profile_ix > 0;
+	u32 dword11 = nvmeq->cq_vector;
+
+	if (coalesce != nvmeq->coalesced &&
+	    test_bit(NVMEQ_DIM, &nvmeq->flags)) {
+		if (!coalesce)
+			dword11 |= NVME_IRQ_CONFIG_CD;
+		if (!nvme_set_features(&nvmeq->dev->ctrl, NVME_FEAT_IRQ_CONFIG,
+				       dword11, NULL, 0, NULL))
+			nvmeq->coalesced = coalesce;
+	}
+
+	dim->state = DIM_START_MEASURE;
+}
+
+static void nvme_setup_irq_dim(struct nvme_dev *dev)
+{
+	u8 thr = irq_coalesce_thr, time = irq_coalesce_time;
+	u32 dword11;
+	int i, ret;
+
+	if (!adaptive_irq || !thr || !time)
+		return;
+
+	/* The threshold is 0's based; vector 0 belongs to the admin queue. */
+	dword11 = (thr - 1) | (time << NVME_IRQ_COALESCE_TIME_SHIFT);
+	ret = nvme_set_features(&dev->ctrl, NVME_FEAT_IRQ_COALESCE, dword11,
+				NULL, 0, NULL);
+	if (ret) {
+		dev_warn(dev->ctrl.device,
+			 "failed to set up interrupt coalescing: %d\n", ret);
+		return;
+	}
+
+	for (i = 1; i < dev->online_queues; i++) {
+		struct nvme_queue *nvmeq = &dev->queues[i];
+
+		if (test_bit(NVMEQ_POLLED, &nvmeq->flags) || !nvmeq->cq_vector)
+			continue;
+
+		/* Coalescing is on for all vectors after a reset. */
+		cancel_work_sync(&nvmeq->dim.work);
+		memset(&nvmeq->dim, 0, sizeof(nvmeq->dim));
+		INIT_WORK(&nvmeq->dim.work, nvme_dim_work);
+		nvmeq->dim.state = DIM_START_MEASURE;
+		nvmeq->dim.tune_state = DIM_GOING_RIGHT;
+		nvmeq->dim.profile_ix = 1;
+		nvmeq->coalesced = true;
+		set_bit(NVMEQ_DIM, &nvmeq->flags);
+	}
+}
+
 static int nvme_alloc_queue(struct nvme_dev *dev, int qid, int depth)
 {
 	struct nvme_queue *nvmeq = &dev->queues[qid];
@@ -1583,6 +1703,7 @@ static int nvme_alloc_queue(struct nvme_dev *dev, int qid, int depth)
 	nvmeq->dev = dev;
 	spin_lock_init(&nvmeq->sq_lock);
 	spin_lock_init(&nvmeq->cq_poll_lock);
+	INIT_WORK(&nvmeq->dim.work, nvme_dim_work);
 	nvmeq->cq_head = 0;
 	nvmeq->cq_phase = 1;
 	nvmeq->q_db = &dev->dbs[qid * 2 * dev->db_stride];
@@ -2399,6 +2520,7 @@ static int nvme_setup_io_queues(struct nvme_dev *dev)
 		nvme_suspend_io_queues(dev);
 		goto retry;
 	}
+	nvme_setup_irq_dim(dev);
 	dev_info(dev->ctrl.device, "%d/%d/%d default/read/poll queues\n",
 					dev->io_queues[HCTX_TYPE_DEFAULT],
 					dev->io_queues[HCTX_TYPE_READ],
@@ -2678,28 +2800,41 @@ static int nvme_disable_prepare_reset(struct nvme_dev *dev, bool shutdown)
 	return 0;
 }
 
+static void nvme_release_prp_pools(struct nvme_dev *dev)
+{
+	int node;
+
+	for_each_node(node) {
+		dma_pool_destroy(dev->descriptor_pools[node].large);
+		dma_pool_destroy(dev->descriptor_pools[node].small);
+	}
+}
+
 static int nvme_setup_prp_pools(struct nvme_dev *dev)
 {
-	dev->prp_page_pool = dma_pool_create("prp list page", dev->dev,
+	int node;
+
+	/* Pages are only allocated on use, so this is cheap for idle nodes. */
+	for_each_node(node) {
+		struct nvme_descriptor_pools *pools = &dev->descriptor_pools[node];
+
+		pools->large = dma_pool_create("prp list page", dev->dev,
 						NVME_CTRL_PAGE_SIZE,
 						NVME_CTRL_PAGE_SIZE, 0);
-	if (!dev->prp_page_pool)
-		return -ENOMEM;
+		if (!pools->large)
+			goto out_release;
 
-	/* Optimisation for I/Os between 4k and 128k */
-	dev->prp_small_pool = dma_pool_create("prp list 256", dev->dev,
+		/* Optimisation for I/Os between 4k and 128k */
+		pools->small = dma_pool_create("prp list 256", dev->dev,
 						256, 256, 0);
-	if (!dev->prp_small_pool) {
-		dma_pool_destroy(dev->prp_page_pool);
-		return -ENOMEM;
+		if (!pools->small)
+			goto out_release;
 	}
 	return 0;
-}
 
-static void nvme_release_prp_pools(struct nvme_dev *dev)
-{
-	dma_pool_destroy(dev->prp_page_pool);
-	dma_pool_destroy(dev->prp_small_pool);
+out_release:
+	nvme_release_prp_pools(dev);
+	return -ENOMEM;
 }
 
 static int nvme_pci_alloc_iod_mempool(struct nvme_dev *dev)
@@ -2968,7 +3103,8 @@ static struct nvme_dev *nvme_pci_alloc_dev(struct pci_dev *pdev,
 	if (node == NUMA_NO_NODE)
 		set_dev_node(&pdev->dev, first_memory_node);
 
-	dev = kzalloc_node(sizeof(*dev), GFP_KERNEL, node);
+	dev = kzalloc_node(struct_size(dev, descriptor_pools, nr_node_ids),
+			   GFP_KERNEL, node);
 	if (!dev)
 		return NULL;
 	INIT_WORK(&dev->ctrl.reset_work, nvme_reset_work);
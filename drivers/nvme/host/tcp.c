@@ -18,6 +18,9 @@
 #include "nvme.h"
 #include "fabrics.h"
 
+/* Command PDUs without data sent in one sendmsg */
+#define NVME_TCP_SEND_BATCH	16
+
 struct nvme_tcp_queue;
 
 /* Define the socket priority to use for connections were it is desirable
@@ -30,6 +33,16 @@ static int so_priority;
 module_param(so_priority, int, 0644);
 MODULE_PARM_DESC(so_priority, "nvme tcp socket optimize priority");
 
+/*
+ * Use an unbound workqueue for io_work, so that the scheduler spreads the
+ * receive processing of the queues over the cores instead of pinning each
+ * queue to the cpu of its index, which may also be busy with its NIC's
+ * softirqs.
+ */
+static bool wq_unbound;
+module_param(wq_unbound, bool, 0444);
+MODULE_PARM_DESC(wq_unbound, "Use unbound workqueue for nvme-tcp IO context (default false)");
+
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 /* lockdep can detect a circular dependency of the form
  *   sk_lock -> mmap_lock (page fault) -> fs locks -> sk_lock
@@ -1071,6 +1084,74 @@ static int nvme_tcp_try_send_cmd_pdu(struct nvme_tcp_request *req)
 	return -EAGAIN;
 }
 
+static inline bool nvme_tcp_batch_cmd_pdu(struct nvme_tcp_request *req)
+{
+	return req->state == NVME_TCP_SEND_CMD_PDU && !req->offset &&
+		!nvme_tcp_has_inline_data(req);
+}
+
+/*
+ * Send the command PDU of the current request together with those of the
+ * requests queued behind it that carry no data either, in a single
+ * sendmsg instead of a sendpage (and an skb frag) per PDU.  The requests
+ * that didn't make it out, including one that was cut short, are put back
+ * at the head of the send_list, the first of them as the current request.
+ */
+static int nvme_tcp_try_send_cmd_pdus(struct nvme_tcp_queue *queue)
+{
+	struct nvme_tcp_request *reqs[NVME_TCP_SEND_BATCH], *next;
+	struct kvec iov[NVME_TCP_SEND_BATCH];
+	struct msghdr msg = { .msg_flags = MSG_DONTWAIT };
+	size_t len = sizeof(struct nvme_tcp_cmd_pdu) +
+		     nvme_tcp_hdgst_len(queue);
+	int i, n = 0, ret;
+
+	reqs[0] = queue->request;
+	while (true) {
+		struct nvme_tcp_cmd_pdu *pdu = reqs[n]->pdu;
+
+		if (queue->hdr_digest)
+			nvme_tcp_hdgst(queue->snd_hash, pdu, sizeof(*pdu));
+		iov[n].iov_base = pdu;
+		iov[n].iov_len = len;
+		if (++n == NVME_TCP_SEND_BATCH)
+			break;
+
+		if (list_empty(&queue->send_list))
+			nvme_tcp_process_req_list(queue);
+		next = list_first_entry_or_null(&queue->send_list,
+				struct nvme_tcp_request, entry);
+		if (!next || !nvme_tcp_batch_cmd_pdu(next))
+			break;
+		list_del(&next->entry);
+		reqs[n] = next;
+	}
+
+	if (nvme_tcp_queue_more(queue))
+		msg.msg_flags |= MSG_MORE;
+	else
+		msg.msg_flags |= MSG_EOR;
+
+	ret = kernel_sendmsg(queue->sock, &msg, iov, n, n * len);
+
+	/* Skip the requests that were sent in full. */
+	for (i = 0; ret > 0 && i < n && ret >= len; i++)
+		ret -= len;
+	if (i == n) {
+		nvme_tcp_done_send_req(queue);
+		return 1;
+	}
+	if (ret > 0) {
+		reqs[i]->offset = ret;
+		ret = -EAGAIN;
+	}
+
+	queue->request = reqs[i];
+	while (--n > i)
+		list_add(&reqs[n]->entry, &queue->send_list);
+	return ret;
+}
+
 static int nvme_tcp_try_send_data_pdu(struct nvme_tcp_request *req)
 {
 	struct nvme_tcp_queue *queue = req->queue;
@@ -1152,6 +1233,11 @@ static int nvme_tcp_try_send(struct nvme_tcp_queue *queue)
 	req = queue->request;
 
 	noreclaim_flag = memalloc_noreclaim_save();
+	if (nvme_tcp_batch_cmd_pdu(req)) {
+		ret = nvme_tcp_try_send_cmd_pdus(queue);
+		goto done;
+	}
+
 	if (req->state == NVME_TCP_SEND_CMD_PDU) {
 		ret = nvme_tcp_try_send_cmd_pdu(req);
 		if (ret <= 0)
@@ -1474,6 +1560,11 @@ static void nvme_tcp_set_queue_io_cpu(struct nvme_tcp_queue *queue)
 	int qid = nvme_tcp_queue_id(queue);
 	int n = 0;
 
+	if (wq_unbound) {
+		queue->io_cpu = WORK_CPU_UNBOUND;
+		return;
+	}
+
 	if (nvme_tcp_default_queue(queue))
 		n = qid - 1;
 	else if (nvme_tcp_read_queue(queue))
@@ -2670,8 +2761,12 @@ static struct nvmf_transport_ops nvme_tcp_transport = {
 
 static int __init nvme_tcp_init_module(void)
 {
-	nvme_tcp_wq = alloc_workqueue("nvme_tcp_wq",
-			WQ_MEM_RECLAIM | WQ_HIGHPRI, 0);
+	unsigned int wq_flags = WQ_MEM_RECLAIM | WQ_HIGHPRI;
+
+	if (wq_unbound)
+		wq_flags |= WQ_UNBOUND;
+
+	nvme_tcp_wq = alloc_workqueue("nvme_tcp_wq", wq_flags, 0);
 	if (!nvme_tcp_wq)
 		return -ENOMEM;
 
@@ -13,6 +13,8 @@
 
 #define NVMET_MIN_MPOOL_OBJ		16
 
+static void nvmet_file_submit_buffered_io(struct nvmet_req *req);
+
 void nvmet_file_ns_revalidate(struct nvmet_ns *ns)
 {
 	ns->size = i_size_read(ns->file->f_mapping->host);
@@ -21,8 +23,7 @@ void nvmet_file_ns_revalidate(struct nvmet_ns *ns)
 void nvmet_file_ns_disable(struct nvmet_ns *ns)
 {
 	if (ns->file) {
-		if (ns->buffered_io)
-			flush_workqueue(buffered_io_wq);
+		flush_workqueue(buffered_io_wq);
 		mempool_destroy(ns->bvec_pool);
 		ns->bvec_pool = NULL;
 		fput(ns->file);
@@ -112,6 +113,15 @@ static void nvmet_file_io_done(struct kiocb *iocb, long ret)
 	struct nvmet_req *req = container_of(iocb, struct nvmet_req, f.iocb);
 	u16 status = NVME_SC_SUCCESS;
 
+	/*
+	 * A direct I/O issued with IOCB_NOWAIT may still find out that it
+	 * would block once it is queued, e.g. when running out of tags.
+	 */
+	if (unlikely(ret == -EAGAIN && (iocb->ki_flags & IOCB_NOWAIT))) {
+		nvmet_file_submit_buffered_io(req);
+		return;
+	}
+
 	if (req->f.bvec != req->inline_bvec) {
 		if (likely(req->f.mpool_alloc == false))
 			kfree(req->f.bvec);
@@ -178,9 +188,10 @@ static bool nvmet_file_execute_io(struct nvmet_req *req, int ki_flags)
 
 	/*
 	 * A NULL ki_complete ask for synchronous execution, which we want
-	 * for the IOCB_NOWAIT case.
+	 * for buffered I/O in the IOCB_NOWAIT case: it is either served from
+	 * the page cache right away or retried from buffered_io_wq.
 	 */
-	if (!(ki_flags & IOCB_NOWAIT))
+	if (!(ki_flags & IOCB_NOWAIT) || !req->ns->buffered_io)
 		req->f.iocb.ki_complete = nvmet_file_io_done;
 
 	ret = nvmet_file_submit_bvec(req, pos, bv_cnt, total_len, ki_flags);
@@ -224,6 +235,7 @@ static void nvmet_file_submit_buffered_io(struct nvmet_req *req)
 static void nvmet_file_execute_rw(struct nvmet_req *req)
 {
 	ssize_t nr_bvec = req->sg_cnt;
+	bool nowait;
 
 	if (!nvmet_check_transfer_len(req, nvmet_rw_data_len(req)))
 		return;
@@ -246,13 +258,20 @@ static void nvmet_file_execute_rw(struct nvmet_req *req)
 	} else
 		req->f.mpool_alloc = false;
 
-	if (req->ns->buffered_io) {
-		if (likely(!req->f.mpool_alloc) &&
-		    (req->ns->file->f_mode & FMODE_NOWAIT) &&
-		    nvmet_file_execute_io(req, IOCB_NOWAIT))
-			return;
+	/*
+	 * Like io_uring, try to issue the I/O without blocking first, so that
+	 * the transport isn't stalled by a file system that has to allocate
+	 * blocks or wait for a lock, and only hand it to a worker if that
+	 * fails.
+	 */
+	nowait = likely(!req->f.mpool_alloc) &&
+		(req->ns->file->f_mode & FMODE_NOWAIT);
+	if (nowait && nvmet_file_execute_io(req, IOCB_NOWAIT))
+		return;
+
+	if (req->ns->buffered_io || nowait)
 		nvmet_file_submit_buffered_io(req);
-	} else
+	else
 		nvmet_file_execute_io(req, 0);
 }
 
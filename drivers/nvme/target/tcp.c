@@ -8,6 +8,7 @@
 #include <linux/init.h>
 #include <linux/slab.h>
 #include <linux/err.h>
+#include <linux/blkdev.h>
 #include <linux/nvme-tcp.h>
 #include <net/sock.h>
 #include <net/tcp.h>
@@ -42,6 +43,7 @@ MODULE_PARM_DESC(idle_poll_period_usecs,
 #define NVMET_TCP_RECV_BUDGET		8
 #define NVMET_TCP_SEND_BUDGET		8
 #define NVMET_TCP_IO_WORK_BUDGET	64
+#define NVMET_TCP_RESP_BATCH		16
 
 enum nvmet_tcp_send_state {
 	NVMET_TCP_SEND_DATA_PDU,
@@ -649,6 +651,72 @@ static int nvmet_try_send_response(struct nvmet_tcp_cmd *cmd,
 	return 1;
 }
 
+/*
+ * Send the response of @cmd together with the responses of the commands
+ * queued behind it that have no data to transfer, in a single sendmsg
+ * instead of a sendpage per response.  The commands that didn't make it out
+ * go back to the head of the resp_send_list, except the first of them,
+ * which is left as snd_cmd with its offset set.
+ */
+static int nvmet_try_send_responses(struct nvmet_tcp_cmd *cmd,
+		bool last_in_batch)
+{
+	struct nvmet_tcp_queue *queue = cmd->queue;
+	struct nvmet_tcp_cmd *cmds[NVMET_TCP_RESP_BATCH], *next;
+	struct kvec iov[NVMET_TCP_RESP_BATCH];
+	struct msghdr msg = { .msg_flags = MSG_DONTWAIT };
+	int len = sizeof(*cmd->rsp_pdu) + nvmet_tcp_hdgst_len(queue);
+	int i, n = 0, ret;
+
+	cmds[0] = cmd;
+	while (true) {
+		iov[n].iov_base = cmds[n]->rsp_pdu;
+		iov[n].iov_len = len;
+		if (++n == NVMET_TCP_RESP_BATCH || last_in_batch)
+			break;
+
+		if (list_empty(&queue->resp_send_list))
+			nvmet_tcp_process_resp_list(queue);
+		next = list_first_entry_or_null(&queue->resp_send_list,
+				struct nvmet_tcp_cmd, entry);
+		if (!next || nvmet_tcp_need_data_out(next) ||
+		    nvmet_tcp_need_data_in(next))
+			break;
+		list_del_init(&next->entry);
+		queue->send_list_len--;
+		nvmet_setup_response_pdu(next);
+		cmds[n] = next;
+	}
+
+	if (!last_in_batch && queue->send_list_len)
+		msg.msg_flags |= MSG_MORE;
+	else
+		msg.msg_flags |= MSG_EOR;
+
+	ret = kernel_sendmsg(queue->sock, &msg, iov, n, n * len);
+
+	for (i = 0; ret >= len; i++) {
+		ret -= len;
+		nvmet_tcp_free_cmd_buffers(cmds[i]);
+		nvmet_tcp_put_cmd(cmds[i]);
+	}
+	if (i == n) {
+		queue->snd_cmd = NULL;
+		return 1;
+	}
+	if (ret > 0) {
+		cmds[i]->offset = ret;
+		ret = -EAGAIN;
+	}
+
+	queue->snd_cmd = cmds[i];
+	while (--n > i) {
+		list_add(&cmds[n]->entry, &queue->resp_send_list);
+		queue->send_list_len++;
+	}
+	return ret;
+}
+
 static int nvmet_try_send_r2t(struct nvmet_tcp_cmd *cmd, bool last_in_batch)
 {
 	u8 hdgst = nvmet_tcp_hdgst_len(cmd->queue);
@@ -746,8 +814,12 @@ static int nvmet_tcp_try_send_one(struct nvmet_tcp_queue *queue,
 			goto done_send;
 	}
 
-	if (cmd->state == NVMET_TCP_SEND_RESPONSE)
-		ret = nvmet_try_send_response(cmd, last_in_batch);
+	if (cmd->state == NVMET_TCP_SEND_RESPONSE) {
+		if (!cmd->offset)
+			ret = nvmet_try_send_responses(cmd, last_in_batch);
+		else
+			ret = nvmet_try_send_response(cmd, last_in_batch);
+	}
 
 done_send:
 	if (ret < 0) {
@@ -1276,13 +1348,21 @@ static void nvmet_tcp_io_work(struct work_struct *w)
 {
 	struct nvmet_tcp_queue *queue =
 		container_of(w, struct nvmet_tcp_queue, io_work);
+	struct blk_plug plug;
 	bool pending;
 	int ret, ops = 0;
 
 	do {
 		pending = false;
 
+		/*
+		 * Plug the commands received in one go, so that the backend
+		 * allocates and dispatches their requests in a batch, like
+		 * for local I/O.  This covers passthru requests as well.
+		 */
+		blk_start_plug_nr_ios(&plug, NVMET_TCP_RECV_BUDGET);
 		ret = nvmet_tcp_try_recv(queue, NVMET_TCP_RECV_BUDGET, &ops);
+		blk_finish_plug(&plug);
 		if (ret > 0)
 			pending = true;
 		else if (ret < 0)
@@ -113,6 +113,10 @@ struct iova_bitmap {
 
 	/* length of the IOVA range for the whole bitmap */
 	size_t length;
+
+	/* range set past the mapped range, to set once it gets mapped */
+	unsigned long set_ahead_iova;
+	size_t set_ahead_length;
 };
 
 /*
@@ -348,6 +352,8 @@ static int iova_bitmap_advance(struct iova_bitmap *bitmap)
 {
 	unsigned long iova = iova_bitmap_mapped_length(bitmap) - 1;
 	unsigned long count = iova_bitmap_offset_to_index(bitmap, iova) + 1;
+	size_t length = bitmap->set_ahead_length;
+	int ret;
 
 	bitmap->mapped_base_index += count;
 
@@ -356,7 +362,14 @@ static int iova_bitmap_advance(struct iova_bitmap *bitmap)
 		return 0;
 
 	/* When advancing the index we pin the next set of bitmap pages */
-	return iova_bitmap_get(bitmap);
+	ret = iova_bitmap_get(bitmap);
+	if (ret || !length)
+		return ret;
+
+	/* Now that it's mapped, set what was recorded ahead of it */
+	bitmap->set_ahead_length = 0;
+	iova_bitmap_set(bitmap, bitmap->set_ahead_iova, length);
+	return 0;
 }
 
 /**
@@ -402,10 +415,38 @@ void iova_bitmap_set(struct iova_bitmap *bitmap,
 		     unsigned long iova, size_t length)
 {
 	struct iova_bitmap_map *mapped = &bitmap->mapped;
-	unsigned long cur_bit = ((iova - mapped->iova) >>
-			mapped->pgshift) + mapped->pgoff * BITS_PER_BYTE;
-	unsigned long last_bit = (((iova + length - 1) - mapped->iova) >>
-			mapped->pgshift) + mapped->pgoff * BITS_PER_BYTE;
+	unsigned long last = iova + length - 1;
+	unsigned long mapped_last = mapped->iova +
+			iova_bitmap_mapped_length(bitmap) - 1;
+	unsigned long bitmap_last = bitmap->iova + bitmap->length - 1;
+	unsigned long cur_bit, last_bit;
+
+	/*
+	 * A range may start before the mapped range, which was set already
+	 * along with the previous one, or reach past it, e.g. for a huge
+	 * IOMMU page recorded as a whole: keep the part past it for when
+	 * iova_bitmap_for_each() gets there.
+	 */
+	if (iova < mapped->iova)
+		iova = mapped->iova;
+	if (last > mapped_last && mapped_last < bitmap_last) {
+		unsigned long ahead_last = min(last, bitmap_last);
+
+		if (!bitmap->set_ahead_length)
+			bitmap->set_ahead_iova = mapped_last + 1;
+		bitmap->set_ahead_length = max_t(size_t,
+				bitmap->set_ahead_length,
+				ahead_last - mapped_last);
+	}
+	if (last > mapped_last)
+		last = mapped_last;
+	if (iova > last)
+		return;
+
+	cur_bit = ((iova - mapped->iova) >> mapped->pgshift) +
+			mapped->pgoff * BITS_PER_BYTE;
+	last_bit = ((last - mapped->iova) >> mapped->pgshift) +
+			mapped->pgoff * BITS_PER_BYTE;
 
 	do {
 		unsigned int page_idx = cur_bit / BITS_PER_PAGE;
@@ -61,6 +61,13 @@ module_param_named(dma_entry_limit, dma_entry_limit, uint, 0644);
 MODULE_PARM_DESC(dma_entry_limit,
 		 "Maximum number of user DMA mappings per container (65535).");
 
+#define VFIO_DMA_MAP_MAX_THREADS	16
+
+static unsigned int dma_map_threads __read_mostly = 1;
+module_param_named(dma_map_threads, dma_map_threads, uint, 0644);
+MODULE_PARM_DESC(dma_map_threads,
+		 "Maximum number of threads pinning and mapping a large user DMA mapping (1).");
+
 struct vfio_iommu {
 	struct list_head	domain_list;
 	struct list_head	iova_list;
@@ -76,6 +83,7 @@ struct vfio_iommu {
 	bool			v2;
 	bool			nesting;
 	bool			dirty_page_tracking;
+	bool			dirty_hw;	/* by the IOMMUs, if they can */
 	bool			container_open;
 	struct list_head	emulated_iommu_groups;
 };
@@ -502,6 +510,29 @@ static void vfio_batch_fini(struct vfio_batch *batch)
 		free_page((unsigned long)batch->pages);
 }
 
+/*
+ * Number of pages, at most @npage, from the offset of the batch that are the
+ * following pages of the same large folio.  They continue the pfn run of the
+ * first one and none of them is reserved, so don't need checking one by one.
+ */
+static long vfio_batch_folio_run(struct vfio_batch *batch, long npage)
+{
+	struct page *page = batch->pages[batch->offset];
+	struct folio *folio = page_folio(page);
+	long i, nr;
+
+	if (!folio_test_large(folio))
+		return 1;
+
+	nr = min3(npage, (long)batch->size,
+		  (long)(folio_nr_pages(folio) - folio_page_idx(folio, page)));
+	for (i = 1; i < nr; i++) {
+		if (batch->pages[batch->offset + i] != nth_page(page, i))
+			break;
+	}
+	return i;
+}
+
 static int follow_fault_pfn(struct vm_area_struct *vma, struct mm_struct *mm,
 			    unsigned long vaddr, unsigned long *pfn,
 			    bool write_fault)
@@ -655,12 +686,12 @@ static int vfio_wait_all_valid(struct vfio_iommu *iommu)
  * the iommu can only map chunks of consecutive pfns anyway, so get the
  * first page and all consecutive pages with the same locking.
  */
-static long vfio_pin_pages_remote(struct vfio_dma *dma, unsigned long vaddr,
-				  long npage, unsigned long *pfn_base,
-				  unsigned long limit, struct vfio_batch *batch)
+static long vfio_pin_pages_remote(struct vfio_dma *dma, struct mm_struct *mm,
+				  unsigned long vaddr, long npage,
+				  unsigned long *pfn_base, unsigned long limit,
+				  struct vfio_batch *batch)
 {
 	unsigned long pfn;
-	struct mm_struct *mm = current->mm;
 	long ret, pinned = 0, lock_acct = 0;
 	bool rsvd;
 	dma_addr_t iova = vaddr - dma->vaddr + dma->iova;
@@ -706,32 +737,43 @@ static long vfio_pin_pages_remote(struct vfio_dma *dma, unsigned long vaddr,
 		 * !VM_PFNMAP vma.
 		 */
 		while (true) {
+			long nr = 1;
+
 			if (pfn != *pfn_base + pinned ||
 			    rsvd != is_invalid_reserved_pfn(pfn))
 				goto out;
 
+			/*
+			 * Without externally pinned pages, the rest of a large
+			 * folio can be taken at once.  As below, batch->pages
+			 * is only valid with more than one pfn in the batch.
+			 */
+			if (!rsvd && batch->size > 1 &&
+			    RB_EMPTY_ROOT(&dma->pfn_list))
+				nr = vfio_batch_folio_run(batch, npage);
+
 			/*
 			 * Reserved pages aren't counted against the user,
 			 * externally pinned pages are already counted against
 			 * the user.
 			 */
-			if (!rsvd && !vfio_find_vpfn(dma, iova)) {
+			if (!rsvd && (nr > 1 || !vfio_find_vpfn(dma, iova))) {
 				if (!dma->lock_cap &&
-				    mm->locked_vm + lock_acct + 1 > limit) {
+				    mm->locked_vm + lock_acct + nr > limit) {
 					pr_warn("%s: RLIMIT_MEMLOCK (%ld) exceeded\n",
 						__func__, limit << PAGE_SHIFT);
 					ret = -ENOMEM;
 					goto unpin_out;
 				}
-				lock_acct++;
+				lock_acct += nr;
 			}
 
-			pinned++;
-			npage--;
-			vaddr += PAGE_SIZE;
-			iova += PAGE_SIZE;
-			batch->offset++;
-			batch->size--;
+			pinned += nr;
+			npage -= nr;
+			vaddr += nr << PAGE_SHIFT;
+			iova += nr << PAGE_SHIFT;
+			batch->offset += nr;
+			batch->size -= nr;
 
 			if (!batch->size)
 				break;
@@ -1084,17 +1126,22 @@ static size_t unmap_unpin_slow(struct vfio_domain *domain,
 	return unmapped;
 }
 
-static long vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
-			     bool do_accounting)
+/*
+ * Unmap and unpin @size bytes of @dma from @start, which all have to be
+ * mapped.
+ */
+static long __vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			       dma_addr_t start, size_t size,
+			       bool do_accounting)
 {
-	dma_addr_t iova = dma->iova, end = dma->iova + dma->size;
+	dma_addr_t iova = start, end = start + size;
 	struct vfio_domain *domain, *d;
 	LIST_HEAD(unmapped_region_list);
 	struct iommu_iotlb_gather iotlb_gather;
 	int unmapped_region_cnt = 0;
 	long unlocked = 0;
 
-	if (!dma->size)
+	if (!size)
 		return 0;
 
 	if (list_empty(&iommu->domain_list))
@@ -1111,7 +1158,7 @@ static long vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
 				      struct vfio_domain, next);
 
 	list_for_each_entry_continue(d, &iommu->domain_list, next) {
-		iommu_unmap(d->domain, dma->iova, dma->size);
+		iommu_unmap(d->domain, start, size);
 		cond_resched();
 	}
 
@@ -1168,6 +1215,13 @@ static long vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
 	return unlocked;
 }
 
+static long vfio_unmap_unpin(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			     bool do_accounting)
+{
+	return __vfio_unmap_unpin(iommu, dma, dma->iova, dma->size,
+				  do_accounting);
+}
+
 static void vfio_remove_dma(struct vfio_iommu *iommu, struct vfio_dma *dma)
 {
 	WARN_ON(!RB_EMPTY_ROOT(&dma->pfn_list));
@@ -1206,6 +1260,137 @@ static void vfio_update_pgsize_bitmap(struct vfio_iommu *iommu)
 	}
 }
 
+static int vfio_domain_read_and_clear_dirty(struct vfio_domain *domain,
+					    unsigned long iova, size_t size,
+					    struct iova_bitmap *bitmap)
+{
+	const struct iommu_dirty_ops *ops = domain->domain->dirty_ops;
+	struct iommu_iotlb_gather gather;
+	struct iommu_dirty_bitmap dirty;
+	int ret;
+
+	iommu_dirty_bitmap_init(&dirty, bitmap, &gather);
+	ret = ops->read_and_clear_dirty(domain->domain, iova, size, 0, &dirty);
+
+	/* The IOTLB may cache the dirty bits that were cleared */
+	if (gather.start <= gather.end)
+		iommu_iotlb_sync(domain->domain, &gather);
+
+	return ret;
+}
+
+static void vfio_iommu_dirty_hw_stop(struct vfio_iommu *iommu)
+{
+	struct vfio_domain *d;
+
+	if (!iommu->dirty_hw)
+		return;
+
+	list_for_each_entry(d, &iommu->domain_list, next)
+		if (d->domain->dirty_ops)
+			d->domain->dirty_ops->set_dirty_tracking(d->domain,
+								 false);
+	iommu->dirty_hw = false;
+}
+
+/*
+ * Have the IOMMUs of all the domains record the pages written to, if every
+ * one of them can, and drop what they recorded before.
+ */
+static void vfio_iommu_dirty_hw_start(struct vfio_iommu *iommu)
+{
+	struct vfio_domain *d;
+	struct rb_node *n;
+
+	if (list_empty(&iommu->domain_list))
+		return;
+
+	list_for_each_entry(d, &iommu->domain_list, next) {
+		if (!d->domain->dirty_ops ||
+		    d->domain->dirty_ops->set_dirty_tracking(d->domain, true))
+			goto err_disable;
+	}
+
+	for (n = rb_first(&iommu->dma_list); n; n = rb_next(n)) {
+		struct vfio_dma *dma = rb_entry(n, struct vfio_dma, node);
+
+		if (!dma->iommu_mapped)
+			continue;
+		list_for_each_entry(d, &iommu->domain_list, next)
+			vfio_domain_read_and_clear_dirty(d, dma->iova,
+							 dma->size, NULL);
+	}
+
+	iommu->dirty_hw = true;
+	return;
+
+err_disable:
+	list_for_each_entry_continue_reverse(d, &iommu->domain_list, next)
+		d->domain->dirty_ops->set_dirty_tracking(d->domain, false);
+}
+
+struct vfio_dirty_range {
+	struct vfio_iommu	*iommu;
+	unsigned long		start;
+	unsigned long		last;
+};
+
+static int vfio_iommu_read_dirty(struct iova_bitmap *bitmap,
+				 unsigned long iova, size_t length,
+				 void *opaque)
+{
+	struct vfio_dirty_range *range = opaque;
+	unsigned long last = min(iova + length - 1, range->last);
+	struct vfio_domain *d;
+	int ret;
+
+	/* The bitmap may start before the range, in the same u64 */
+	iova = max(iova, range->start);
+	if (iova > last)
+		return 0;
+
+	list_for_each_entry(d, &range->iommu->domain_list, next) {
+		ret = vfio_domain_read_and_clear_dirty(d, iova, last - iova + 1,
+						       bitmap);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Set the bits of the pages of @dma that the IOMMUs found dirty in the user
+ * bitmap, in addition to the ones set from dma->bitmap.
+ */
+static int vfio_dma_read_dirty_hw(struct vfio_iommu *iommu,
+				  struct vfio_dma *dma, dma_addr_t base_iova,
+				  u64 __user *bitmap, size_t pgsize)
+{
+	unsigned long pgshift = __ffs(pgsize);
+	unsigned long copy_offset = ((dma->iova - base_iova) >> pgshift) /
+				    BITS_PER_TYPE(u64);
+	unsigned long iova = base_iova +
+			     ((copy_offset * BITS_PER_TYPE(u64)) << pgshift);
+	struct vfio_dirty_range range = {
+		.iommu	= iommu,
+		.start	= dma->iova,
+		.last	= dma->iova + dma->size - 1,
+	};
+	struct iova_bitmap *iova_bitmap;
+	int ret;
+
+	iova_bitmap = iova_bitmap_alloc(iova, range.last - iova + 1, pgsize,
+					bitmap + copy_offset);
+	if (IS_ERR(iova_bitmap))
+		return PTR_ERR(iova_bitmap);
+
+	ret = iova_bitmap_for_each(iova_bitmap, &range, vfio_iommu_read_dirty);
+	iova_bitmap_free(iova_bitmap);
+
+	return ret;
+}
+
 static int update_user_bitmap(u64 __user *bitmap, struct vfio_iommu *iommu,
 			      struct vfio_dma *dma, dma_addr_t base_iova,
 			      size_t pgsize)
@@ -1216,13 +1401,19 @@ static int update_user_bitmap(u64 __user *bitmap, struct vfio_iommu *iommu,
 	unsigned long copy_offset = bit_offset / BITS_PER_LONG;
 	unsigned long shift = bit_offset % BITS_PER_LONG;
 	unsigned long leftover;
+	bool read_hw = false;
 
 	/*
 	 * mark all pages dirty if any IOMMU capable device is not able
-	 * to report dirty pages and all pages are pinned and mapped.
+	 * to report dirty pages and all pages are pinned and mapped,
+	 * unless the IOMMUs can tell which ones were written to.
 	 */
-	if (iommu->num_non_pinned_groups && dma->iommu_mapped)
-		bitmap_set(dma->bitmap, 0, nbits);
+	if (iommu->num_non_pinned_groups && dma->iommu_mapped) {
+		if (iommu->dirty_hw)
+			read_hw = true;
+		else
+			bitmap_set(dma->bitmap, 0, nbits);
+	}
 
 	if (shift) {
 		bitmap_shift_left(dma->bitmap, dma->bitmap, shift,
@@ -1240,6 +1431,10 @@ static int update_user_bitmap(u64 __user *bitmap, struct vfio_iommu *iommu,
 			 DIRTY_BITMAP_BYTES(nbits + shift)))
 		return -EFAULT;
 
+	if (read_hw)
+		return vfio_dma_read_dirty_hw(iommu, dma, base_iova, bitmap,
+					      pgsize);
+
 	return 0;
 }
 
@@ -1498,24 +1693,27 @@ static int vfio_iommu_map(struct vfio_iommu *iommu, dma_addr_t iova,
 	return ret;
 }
 
-static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
-			    size_t map_size)
+/*
+ * Pin and map @size bytes of @dma from @offset, adding the bytes mapped so far
+ * to @mapped.  On failure, whatever was mapped stays mapped.
+ */
+static int vfio_pin_map_range(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			      struct mm_struct *mm, size_t offset, size_t size,
+			      unsigned long limit, size_t *mapped)
 {
-	dma_addr_t iova = dma->iova;
-	unsigned long vaddr = dma->vaddr;
+	dma_addr_t iova = dma->iova + offset;
+	unsigned long vaddr = dma->vaddr + offset;
 	struct vfio_batch batch;
-	size_t size = map_size;
 	long npage;
-	unsigned long pfn, limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+	unsigned long pfn;
 	int ret = 0;
 
 	vfio_batch_init(&batch);
 
 	while (size) {
 		/* Pin a contiguous chunk of memory */
-		npage = vfio_pin_pages_remote(dma, vaddr + dma->size,
-					      size >> PAGE_SHIFT, &pfn, limit,
-					      &batch);
+		npage = vfio_pin_pages_remote(dma, mm, vaddr, size >> PAGE_SHIFT,
+					      &pfn, limit, &batch);
 		if (npage <= 0) {
 			WARN_ON(!npage);
 			ret = (int)npage;
@@ -1523,20 +1721,139 @@ static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
 		}
 
 		/* Map it! */
-		ret = vfio_iommu_map(iommu, iova + dma->size, pfn, npage,
-				     dma->prot);
+		ret = vfio_iommu_map(iommu, iova, pfn, npage, dma->prot);
 		if (ret) {
-			vfio_unpin_pages_remote(dma, iova + dma->size, pfn,
-						npage, true);
+			vfio_unpin_pages_remote(dma, iova, pfn, npage, true);
 			vfio_batch_unpin(&batch, dma);
 			break;
 		}
 
 		size -= npage << PAGE_SHIFT;
-		dma->size += npage << PAGE_SHIFT;
+		vaddr += npage << PAGE_SHIFT;
+		iova += npage << PAGE_SHIFT;
+		*mapped += npage << PAGE_SHIFT;
 	}
 
 	vfio_batch_fini(&batch);
+
+	return ret;
+}
+
+/*
+ * Large mappings are split in this many bytes aligned pieces at least, so
+ * that no IOMMU huge page has to be split between two threads.
+ */
+#define VFIO_DMA_MAP_PIECE	SZ_1G
+
+struct vfio_pin_map_work {
+	struct work_struct	work;
+	struct vfio_iommu	*iommu;
+	struct vfio_dma		*dma;
+	struct mm_struct	*mm;
+	unsigned long		limit;
+	size_t			offset;
+	size_t			size;
+	size_t			mapped;
+	int			ret;
+};
+
+static void vfio_pin_map_work_fn(struct work_struct *work)
+{
+	struct vfio_pin_map_work *w = container_of(work,
+					struct vfio_pin_map_work, work);
+
+	w->ret = vfio_pin_map_range(w->iommu, w->dma, w->mm, w->offset,
+				    w->size, w->limit, &w->mapped);
+}
+
+/*
+ * Pin and map disjoint pieces of @dma on several CPUs, while the caller,
+ * holding iommu->lock, does the first one.  The pages are pinned through
+ * the caller's mm, which stays alive while it waits, and the accounting is
+ * serialized on its mmap_lock as for a single thread.  On failure, all the
+ * pieces mapped are torn down here.
+ */
+static int vfio_pin_map_dma_parallel(struct vfio_iommu *iommu,
+				     struct vfio_dma *dma, size_t map_size,
+				     unsigned long limit, int nr_threads)
+{
+	struct vfio_pin_map_work works[VFIO_DMA_MAP_MAX_THREADS];
+	size_t piece, size, offset = 0;
+	dma_addr_t end;
+	int i, ret = 0;
+
+	piece = ALIGN(DIV_ROUND_UP(map_size, nr_threads), VFIO_DMA_MAP_PIECE);
+	end = ALIGN_DOWN(dma->iova, VFIO_DMA_MAP_PIECE);
+
+	for (i = 0; i < nr_threads && offset < map_size; i++) {
+		/* All pieces but the last end on an aligned iova */
+		end += piece;
+		size = map_size - offset;
+		if (i < nr_threads - 1)
+			size = min_t(size_t, size, end - dma->iova - offset);
+
+		works[i] = (struct vfio_pin_map_work) {
+			.iommu	= iommu,
+			.dma	= dma,
+			.mm	= current->mm,
+			.limit	= limit,
+			.offset	= offset,
+			.size	= size,
+		};
+		offset += size;
+
+		if (!i)
+			continue;
+		INIT_WORK_ONSTACK(&works[i].work, vfio_pin_map_work_fn);
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+	nr_threads = i;
+
+	works[0].ret = vfio_pin_map_range(iommu, dma, current->mm, 0,
+					  works[0].size, limit,
+					  &works[0].mapped);
+
+	for (i = 1; i < nr_threads; i++) {
+		flush_work(&works[i].work);
+		destroy_work_on_stack(&works[i].work);
+	}
+
+	for (i = 0; i < nr_threads; i++)
+		if (works[i].ret && !ret)
+			ret = works[i].ret;
+
+	if (ret)
+		for (i = 0; i < nr_threads; i++)
+			__vfio_unmap_unpin(iommu, dma,
+					   dma->iova + works[i].offset,
+					   works[i].mapped, true);
+	else
+		dma->size = map_size;
+
+	return ret;
+}
+
+static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
+			    size_t map_size)
+{
+	unsigned long limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+	int nr_threads;
+	size_t mapped = 0;
+	int ret;
+
+	nr_threads = min3(READ_ONCE(dma_map_threads), num_online_cpus(),
+			  (unsigned int)VFIO_DMA_MAP_MAX_THREADS);
+	nr_threads = min_t(size_t, nr_threads, map_size / VFIO_DMA_MAP_PIECE);
+
+	if (nr_threads > 1 && current->mm) {
+		ret = vfio_pin_map_dma_parallel(iommu, dma, map_size, limit,
+						nr_threads);
+	} else {
+		ret = vfio_pin_map_range(iommu, dma, current->mm, 0, map_size,
+					 limit, &mapped);
+		dma->size = mapped;
+	}
+
 	dma->iommu_mapped = true;
 
 	if (ret)
@@ -1763,7 +2080,8 @@ static int vfio_iommu_replay(struct vfio_iommu *iommu,
 				size_t n = dma->iova + dma->size - iova;
 				long npage;
 
-				npage = vfio_pin_pages_remote(dma, vaddr,
+				npage = vfio_pin_pages_remote(dma, current->mm,
+							      vaddr,
 							      n >> PAGE_SHIFT,
 							      &pfn, limit,
 							      &batch);
@@ -2350,6 +2668,13 @@ static int vfio_iommu_type1_attach_group(void *iommu_data,
 
 	list_add(&domain->next, &iommu->domain_list);
 	vfio_update_pgsize_bitmap(iommu);
+
+	/* All the domains or none track dirty pages */
+	if (iommu->dirty_hw &&
+	    (!domain->domain->dirty_ops ||
+	     domain->domain->dirty_ops->set_dirty_tracking(domain->domain,
+							   true)))
+		vfio_iommu_dirty_hw_stop(iommu);
 done:
 	/* Delete the old one and insert new iova list */
 	vfio_iommu_iova_insert_copy(iommu, &iova_copy);
@@ -2948,8 +3273,10 @@ static int vfio_iommu_type1_dirty_pages(struct vfio_iommu *iommu,
 		pgsize = 1 << __ffs(iommu->pgsize_bitmap);
 		if (!iommu->dirty_page_tracking) {
 			ret = vfio_dma_bitmap_alloc_all(iommu, pgsize);
-			if (!ret)
+			if (!ret) {
 				iommu->dirty_page_tracking = true;
+				vfio_iommu_dirty_hw_start(iommu);
+			}
 		}
 		mutex_unlock(&iommu->lock);
 		return ret;
@@ -2957,6 +3284,7 @@ static int vfio_iommu_type1_dirty_pages(struct vfio_iommu *iommu,
 		mutex_lock(&iommu->lock);
 		if (iommu->dirty_page_tracking) {
 			iommu->dirty_page_tracking = false;
+			vfio_iommu_dirty_hw_stop(iommu);
 			vfio_dma_bitmap_free_all(iommu);
 		}
 		mutex_unlock(&iommu->lock);
@@ -40,6 +40,11 @@ module_param(experimental_zcopytx, int, 0444);
 MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 		                       " 1 -Enable; 0 - Disable");
 
+static unsigned int zcopytx_min_len = 256;
+module_param(zcopytx_min_len, uint, 0644);
+MODULE_PARM_DESC(zcopytx_min_len,
+		 "Minimum packet length for Zero Copy TX. (default: 256)");
+
 /* Max number of bytes transferred before requeueing the job.
  * Using this limit prevents one virtqueue from starving others. */
 #define VHOST_NET_WEIGHT 0x80000
@@ -52,7 +57,6 @@ MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 
 /* MAX number of TX used buffers for outstanding zerocopy */
 #define VHOST_MAX_PEND 128
-#define VHOST_GOODCOPY_LEN 256
 
 /*
  * For transmit, used buffer len is unused; we override it to track buffer
@@ -66,8 +70,11 @@ MODULE_PARM_DESC(experimental_zcopytx, "Enable Zero Copy TX;"
 #define VHOST_DMA_IN_PROGRESS	((__force __virtio32)1)
 /* Buffer unused */
 #define VHOST_DMA_CLEAR_LEN	((__force __virtio32)0)
+/* Lower device DMA done and buffer already returned to the guest */
+#define VHOST_DMA_USED_LEN	((__force __virtio32)4)
 
-#define VHOST_DMA_IS_DONE(len) ((__force u32)(len) >= (__force u32)VHOST_DMA_DONE_LEN)
+#define VHOST_DMA_IS_DONE(len) ((__force u32)(len) == (__force u32)VHOST_DMA_DONE_LEN || \
+				(__force u32)(len) == (__force u32)VHOST_DMA_FAILED_LEN)
 
 enum {
 	VHOST_NET_FEATURES = VHOST_FEATURES |
@@ -352,33 +359,42 @@ static bool vhost_sock_xdp(struct socket *sock)
 
 /* In case of DMA done not in order in lower device driver for some reason.
  * upend_idx is used to track end of used idx, done_idx is used to track head
- * of used idx. Once lower device DMA done contiguously, we will signal KVM
- * guest used idx.
+ * of used idx.  VIRTIO_F_IN_ORDER is never offered, so buffers whose DMA is
+ * done are returned to the guest right away, even if an earlier buffer is
+ * still stuck in a qdisc.  done_idx only moves past returned buffers.
  */
 static void vhost_zerocopy_signal_used(struct vhost_net *net,
 				       struct vhost_virtqueue *vq)
 {
 	struct vhost_net_virtqueue *nvq =
 		container_of(vq, struct vhost_net_virtqueue, vq);
-	int i, add;
-	int j = 0;
+	struct vring_used_elem used[VHOST_NET_BATCH];
+	bool contiguous = true;
+	int i, n = 0;
 
 	for (i = nvq->done_idx; i != nvq->upend_idx; i = (i + 1) % UIO_MAXIOV) {
 		if (vq->heads[i].len == VHOST_DMA_FAILED_LEN)
 			vhost_net_tx_err(net);
 		if (VHOST_DMA_IS_DONE(vq->heads[i].len)) {
+			used[n].id = vq->heads[i].id;
+			used[n].len = 0;
+			vq->heads[i].len = VHOST_DMA_USED_LEN;
+			if (++n == VHOST_NET_BATCH) {
+				vhost_add_used_and_signal_n(vq->dev, vq,
+							    used, n);
+				n = 0;
+			}
+		} else if (vq->heads[i].len != VHOST_DMA_USED_LEN) {
+			contiguous = false;
+			continue;
+		}
+		if (contiguous) {
 			vq->heads[i].len = VHOST_DMA_CLEAR_LEN;
-			++j;
-		} else
-			break;
-	}
-	while (j) {
-		add = min(UIO_MAXIOV - nvq->done_idx, j);
-		vhost_add_used_and_signal_n(vq->dev, vq,
-					    &vq->heads[nvq->done_idx], add);
-		nvq->done_idx = (nvq->done_idx + add) % UIO_MAXIOV;
-		j -= add;
+			nvq->done_idx = (i + 1) % UIO_MAXIOV;
+		}
 	}
+	if (n)
+		vhost_add_used_and_signal_n(vq->dev, vq, used, n);
 }
 
 static void vhost_zerocopy_callback(struct sk_buff *skb,
@@ -899,7 +915,7 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 			break;
 		}
 
-		zcopy_used = len >= VHOST_GOODCOPY_LEN
+		zcopy_used = len >= READ_ONCE(zcopytx_min_len)
 			     && !vhost_exceeds_maxpend(net)
 			     && vhost_net_tx_select_zcopy(net);
 
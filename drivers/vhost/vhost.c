@@ -41,6 +41,14 @@ static int max_iotlb_entries = 2048;
 module_param(max_iotlb_entries, int, 0444);
 MODULE_PARM_DESC(max_iotlb_entries,
 	"Maximum number of iotlb entries. (default: 2048)");
+static bool shared_worker;
+module_param(shared_worker, bool, 0644);
+MODULE_PARM_DESC(shared_worker,
+	"Share one worker thread between all devices of an owner. (default: N)");
+
+/* Shared workers, looked up by owner mm */
+static LIST_HEAD(vhost_workers);
+static DEFINE_MUTEX(vhost_workers_lock);
 
 enum {
 	VHOST_MEMORY_F_LOG = 0x1,
@@ -255,8 +263,8 @@ void vhost_work_queue(struct vhost_dev *dev, struct vhost_work *work)
 		 * sure it was not in the list.
 		 * test_and_set_bit() implies a memory barrier.
 		 */
-		llist_add(&work->node, &dev->work_list);
-		wake_up_process(dev->worker);
+		llist_add(&work->node, &dev->worker->work_list);
+		wake_up_process(dev->worker->task);
 	}
 }
 EXPORT_SYMBOL_GPL(vhost_work_queue);
@@ -264,7 +272,7 @@ EXPORT_SYMBOL_GPL(vhost_work_queue);
 /* A lockless hint for busy polling code to exit the loop */
 bool vhost_has_work(struct vhost_dev *dev)
 {
-	return !llist_empty(&dev->work_list);
+	return !llist_empty(&dev->worker->work_list);
 }
 EXPORT_SYMBOL_GPL(vhost_has_work);
 
@@ -335,11 +343,11 @@ static void vhost_vq_reset(struct vhost_dev *dev,
 
 static int vhost_worker(void *data)
 {
-	struct vhost_dev *dev = data;
+	struct vhost_worker *worker = data;
 	struct vhost_work *work, *work_next;
 	struct llist_node *node;
 
-	kthread_use_mm(dev->mm);
+	kthread_use_mm(worker->mm);
 
 	for (;;) {
 		/* mb paired w/ kthread_stop */
@@ -350,7 +358,7 @@ static int vhost_worker(void *data)
 			break;
 		}
 
-		node = llist_del_all(&dev->work_list);
+		node = llist_del_all(&worker->work_list);
 		if (!node)
 			schedule();
 
@@ -360,14 +368,14 @@ static int vhost_worker(void *data)
 		llist_for_each_entry_safe(work, work_next, node, node) {
 			clear_bit(VHOST_WORK_QUEUED, &work->flags);
 			__set_current_state(TASK_RUNNING);
-			kcov_remote_start_common(dev->kcov_handle);
+			kcov_remote_start_common(worker->kcov_handle);
 			work->fn(work);
 			kcov_remote_stop();
 			if (need_resched())
 				schedule();
 		}
 	}
-	kthread_unuse_mm(dev->mm);
+	kthread_unuse_mm(worker->mm);
 	return 0;
 }
 
@@ -479,7 +487,6 @@ void vhost_dev_init(struct vhost_dev *dev,
 	dev->byte_weight = byte_weight;
 	dev->use_worker = use_worker;
 	dev->msg_handler = msg_handler;
-	init_llist_head(&dev->work_list);
 	init_waitqueue_head(&dev->wait);
 	INIT_LIST_HEAD(&dev->read_list);
 	INIT_LIST_HEAD(&dev->pending_list);
@@ -571,10 +578,101 @@ static void vhost_detach_mm(struct vhost_dev *dev)
 	dev->mm = NULL;
 }
 
+static void vhost_worker_destroy(struct vhost_worker *worker)
+{
+	WARN_ON(!llist_empty(&worker->work_list));
+	kthread_stop(worker->task);
+	mmput(worker->mm);
+	kfree(worker);
+}
+
+static void vhost_worker_put(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker = dev->worker;
+
+	if (!worker)
+		return;
+
+	dev->worker = NULL;
+	if (refcount_dec_and_mutex_lock(&worker->refcount,
+					&vhost_workers_lock)) {
+		list_del(&worker->node);
+		mutex_unlock(&vhost_workers_lock);
+		vhost_worker_destroy(worker);
+	}
+}
+
+static int vhost_worker_create(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	struct task_struct *task;
+	int err;
+
+	worker = kzalloc(sizeof(*worker), GFP_KERNEL_ACCOUNT);
+	if (!worker)
+		return -ENOMEM;
+
+	init_llist_head(&worker->work_list);
+	refcount_set(&worker->refcount, 1);
+	INIT_LIST_HEAD(&worker->node);
+	worker->kcov_handle = kcov_common_handle();
+	worker->mm = dev->mm;
+	mmget(worker->mm);
+
+	task = kthread_create(vhost_worker, worker, "vhost-%d", current->pid);
+	if (IS_ERR(task)) {
+		mmput(worker->mm);
+		kfree(worker);
+		return PTR_ERR(task);
+	}
+
+	worker->task = task;
+	wake_up_process(task); /* avoid contributing to loadavg */
+	dev->worker = worker;
+
+	err = vhost_attach_cgroups(dev);
+	if (err) {
+		dev->worker = NULL;
+		vhost_worker_destroy(worker);
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * With shared_worker, all devices owned by the same process are served by
+ * one thread, so a wakeup runs the pending work of all of them.
+ */
+static int vhost_worker_get(struct vhost_dev *dev)
+{
+	struct vhost_worker *worker;
+	int err;
+
+	if (!shared_worker)
+		return vhost_worker_create(dev);
+
+	mutex_lock(&vhost_workers_lock);
+	list_for_each_entry(worker, &vhost_workers, node) {
+		if (worker->mm == dev->mm) {
+			refcount_inc(&worker->refcount);
+			dev->worker = worker;
+			mutex_unlock(&vhost_workers_lock);
+			return 0;
+		}
+	}
+
+	err = vhost_worker_create(dev);
+	if (!err)
+		list_add(&dev->worker->node, &vhost_workers);
+	mutex_unlock(&vhost_workers_lock);
+
+	return err;
+}
+
 /* Caller should have device mutex */
 long vhost_dev_set_owner(struct vhost_dev *dev)
 {
-	struct task_struct *worker;
 	int err;
 
 	/* Is there an owner already? */
@@ -585,36 +683,21 @@ long vhost_dev_set_owner(struct vhost_dev *dev)
 
 	vhost_attach_mm(dev);
 
-	dev->kcov_handle = kcov_common_handle();
 	if (dev->use_worker) {
-		worker = kthread_create(vhost_worker, dev,
-					"vhost-%d", current->pid);
-		if (IS_ERR(worker)) {
-			err = PTR_ERR(worker);
-			goto err_worker;
-		}
-
-		dev->worker = worker;
-		wake_up_process(worker); /* avoid contributing to loadavg */
-
-		err = vhost_attach_cgroups(dev);
+		err = vhost_worker_get(dev);
 		if (err)
-			goto err_cgroup;
+			goto err_worker;
 	}
 
 	err = vhost_dev_alloc_iovecs(dev);
 	if (err)
-		goto err_cgroup;
+		goto err_iovecs;
 
 	return 0;
-err_cgroup:
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
-	}
+err_iovecs:
+	vhost_worker_put(dev);
 err_worker:
 	vhost_detach_mm(dev);
-	dev->kcov_handle = 0;
 err_mm:
 	return err;
 }
@@ -705,12 +788,7 @@ void vhost_dev_cleanup(struct vhost_dev *dev)
 	dev->iotlb = NULL;
 	vhost_clear_msg(dev);
 	wake_up_interruptible_poll(&dev->wait, EPOLLIN | EPOLLRDNORM);
-	WARN_ON(!llist_empty(&dev->work_list));
-	if (dev->worker) {
-		kthread_stop(dev->worker);
-		dev->worker = NULL;
-		dev->kcov_handle = 0;
-	}
+	vhost_worker_put(dev);
 	vhost_detach_mm(dev);
 }
 EXPORT_SYMBOL_GPL(vhost_dev_cleanup);
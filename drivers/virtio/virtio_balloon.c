@@ -18,6 +18,8 @@
 #include <linux/wait.h>
 #include <linux/mm.h>
 #include <linux/page_reporting.h>
+#include <linux/debugfs.h>
+#include <linux/sched/clock.h>
 
 /*
  * Balloon device works in 4K page units.  So each page is pointed to by
@@ -26,6 +28,8 @@
  */
 #define VIRTIO_BALLOON_PAGES_PER_PAGE (unsigned int)(PAGE_SIZE >> VIRTIO_BALLOON_PFN_SHIFT)
 #define VIRTIO_BALLOON_ARRAY_PFNS_MAX 256
+/* Upper bound for array_pfns, a 64KB array */
+#define VIRTIO_BALLOON_ARRAY_PFNS_LIMIT 16384
 /* Maximum number of (4k) pages to deflate on OOM notifications. */
 #define VIRTIO_BALLOON_OOM_NR_PAGES 256
 #define VIRTIO_BALLOON_OOM_NOTIFY_PRIORITY 80
@@ -39,6 +43,16 @@
 	(1 << (VIRTIO_BALLOON_HINT_BLOCK_ORDER + PAGE_SHIFT))
 #define VIRTIO_BALLOON_HINT_BLOCK_PAGES (1 << VIRTIO_BALLOON_HINT_BLOCK_ORDER)
 
+/* Number of pfns told to the host per inflate or deflate request */
+static unsigned int array_pfns = VIRTIO_BALLOON_ARRAY_PFNS_MAX;
+module_param(array_pfns, uint, 0444);
+MODULE_PARM_DESC(array_pfns, "Number of 4k pfns per inflate/deflate request");
+
+/* Minimal order of the free pages reported to the host, 0 for the default */
+static unsigned int report_order;
+module_param(report_order, uint, 0444);
+MODULE_PARM_DESC(report_order, "Minimal order of reported free pages");
+
 enum virtio_balloon_vq {
 	VIRTIO_BALLOON_VQ_INFLATE,
 	VIRTIO_BALLOON_VQ_DEFLATE,
@@ -105,7 +119,8 @@ struct virtio_balloon {
 
 	/* The array of pfns we tell the Host about. */
 	unsigned int num_pfns;
-	__virtio32 pfns[VIRTIO_BALLOON_ARRAY_PFNS_MAX];
+	unsigned int max_pfns;
+	__virtio32 *pfns;
 
 	/* Memory statistics */
 	struct virtio_balloon_stat stats[VIRTIO_BALLOON_S_NR];
@@ -119,6 +134,12 @@ struct virtio_balloon {
 	/* Free page reporting device */
 	struct virtqueue *reporting_vq;
 	struct page_reporting_dev_info pr_dev_info;
+
+	/* Free page reporting statistics, exposed in debugfs */
+	u64 reports;
+	u64 reported_bytes;
+	u64 report_ns;
+	struct dentry *debugfs_dir;
 };
 
 static const struct virtio_device_id id_table[] = {
@@ -164,7 +185,9 @@ static int virtballoon_free_page_report(struct page_reporting_dev_info *pr_dev_i
 	struct virtio_balloon *vb =
 		container_of(pr_dev_info, struct virtio_balloon, pr_dev_info);
 	struct virtqueue *vq = vb->reporting_vq;
-	unsigned int unused, err;
+	unsigned int unused, err, i;
+	struct scatterlist *s;
+	u64 start;
 
 	/* We should always be able to add these buffers to an empty queue. */
 	err = virtqueue_add_inbuf(vq, sg, nents, vb, GFP_NOWAIT | __GFP_NOWARN);
@@ -177,11 +200,18 @@ static int virtballoon_free_page_report(struct page_reporting_dev_info *pr_dev_i
 	if (WARN_ON_ONCE(err))
 		return err;
 
+	start = local_clock();
 	virtqueue_kick(vq);
 
 	/* When host has read buffer, this completes via balloon_ack */
 	wait_event(vb->acked, virtqueue_get_buf(vq, &unused));
 
+	/* Only the page reporting worker updates these */
+	for_each_sg(sg, s, nents, i)
+		vb->reported_bytes += s->length;
+	vb->report_ns += local_clock() - start;
+	vb->reports++;
+
 	return 0;
 }
 
@@ -191,6 +221,7 @@ static void set_page_pfns(struct virtio_balloon *vb,
 	unsigned int i;
 
 	BUILD_BUG_ON(VIRTIO_BALLOON_PAGES_PER_PAGE > VIRTIO_BALLOON_ARRAY_PFNS_MAX);
+	BUILD_BUG_ON(VIRTIO_BALLOON_ARRAY_PFNS_MAX % VIRTIO_BALLOON_PAGES_PER_PAGE);
 
 	/*
 	 * Set balloon pfns pointing at this page.
@@ -209,7 +240,7 @@ static unsigned int fill_balloon(struct virtio_balloon *vb, size_t num)
 	LIST_HEAD(pages);
 
 	/* We can only do one array worth at a time. */
-	num = min(num, ARRAY_SIZE(vb->pfns));
+	num = min_t(size_t, num, vb->max_pfns);
 
 	for (num_pfns = 0; num_pfns < num;
 	     num_pfns += VIRTIO_BALLOON_PAGES_PER_PAGE) {
@@ -273,7 +304,7 @@ static unsigned int leak_balloon(struct virtio_balloon *vb, size_t num)
 	LIST_HEAD(pages);
 
 	/* We can only do one array worth at a time. */
-	num = min(num, ARRAY_SIZE(vb->pfns));
+	num = min_t(size_t, num, vb->max_pfns);
 
 	mutex_lock(&vb->balloon_lock);
 	/* We can't release more pages than taken */
@@ -876,6 +907,19 @@ static int virtballoon_probe(struct virtio_device *vdev)
 		goto out;
 	}
 
+	/*
+	 * Larger requests mean fewer round trips to the host when the balloon
+	 * moves a lot of memory.  Keep whole pages in the array.
+	 */
+	vb->max_pfns = clamp(array_pfns, VIRTIO_BALLOON_ARRAY_PFNS_MAX,
+			     VIRTIO_BALLOON_ARRAY_PFNS_LIMIT);
+	vb->max_pfns = rounddown(vb->max_pfns, VIRTIO_BALLOON_PAGES_PER_PAGE);
+	vb->pfns = kmalloc_array(vb->max_pfns, sizeof(*vb->pfns), GFP_KERNEL);
+	if (!vb->pfns) {
+		err = -ENOMEM;
+		goto out_free_vb;
+	}
+
 	INIT_WORK(&vb->update_balloon_stats_work, update_balloon_stats_func);
 	INIT_WORK(&vb->update_balloon_size_work, update_balloon_size_func);
 	spin_lock_init(&vb->stop_update_lock);
@@ -955,6 +999,7 @@ static int virtballoon_probe(struct virtio_device *vdev)
 	vb->pr_dev_info.report = virtballoon_free_page_report;
 	if (virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_REPORTING)) {
 		unsigned int capacity;
+		char name[32];
 
 		capacity = virtqueue_get_vring_size(vb->reporting_vq);
 		if (capacity < PAGE_REPORTING_CAPACITY) {
@@ -978,10 +1023,29 @@ static int virtballoon_probe(struct virtio_device *vdev)
 #if defined(CONFIG_ARM64) && defined(CONFIG_ARM64_64K_PAGES)
 		vb->pr_dev_info.order = 5;
 #endif
+		/*
+		 * Let the admin match the order to the host's backing, e.g. 9
+		 * for 2MB huge pages with 4KB base pages.  The buddy allocator
+		 * doesn't track free areas past MAX_ORDER - 1, so that is the
+		 * largest unit we can report.
+		 */
+		if (report_order)
+			vb->pr_dev_info.order = min_t(unsigned int, report_order,
+						      MAX_ORDER - 1);
 
 		err = page_reporting_register(&vb->pr_dev_info);
 		if (err)
 			goto out_unregister_oom;
+
+		snprintf(name, sizeof(name), "virtio_balloon-%s",
+			 dev_name(&vdev->dev));
+		vb->debugfs_dir = debugfs_create_dir(name, NULL);
+		debugfs_create_u64("reports", 0444, vb->debugfs_dir,
+				   &vb->reports);
+		debugfs_create_u64("reported_bytes", 0444, vb->debugfs_dir,
+				   &vb->reported_bytes);
+		debugfs_create_u64("report_ns", 0444, vb->debugfs_dir,
+				   &vb->report_ns);
 	}
 
 	virtio_device_ready(vdev);
@@ -1002,6 +1066,7 @@ static int virtballoon_probe(struct virtio_device *vdev)
 out_del_vqs:
 	vdev->config->del_vqs(vdev);
 out_free_vb:
+	kfree(vb->pfns);
 	kfree(vb);
 out:
 	return err;
@@ -1028,8 +1093,10 @@ static void virtballoon_remove(struct virtio_device *vdev)
 {
 	struct virtio_balloon *vb = vdev->priv;
 
-	if (virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_REPORTING))
+	if (virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_REPORTING)) {
 		page_reporting_unregister(&vb->pr_dev_info);
+		debugfs_remove(vb->debugfs_dir);
+	}
 	if (virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_DEFLATE_ON_OOM))
 		unregister_oom_notifier(&vb->oom_nb);
 	if (virtio_has_feature(vb->vdev, VIRTIO_BALLOON_F_FREE_PAGE_HINT))
@@ -1046,6 +1113,7 @@ static void virtballoon_remove(struct virtio_device *vdev)
 	}
 
 	remove_common(vb);
+	kfree(vb->pfns);
 	kfree(vb);
 }
 
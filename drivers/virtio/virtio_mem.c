@@ -43,6 +43,11 @@ module_param(bbm_safe_unplug, bool, 0444);
 MODULE_PARM_DESC(bbm_safe_unplug,
 	     "Use a safe unplug mechanism in BBM, avoiding long/endless loops");
 
+static unsigned int plug_batch = 16;
+module_param(plug_batch, uint, 0644);
+MODULE_PARM_DESC(plug_batch,
+		 "Maximum number of new (big) blocks to plug with a single request");
+
 /*
  * virtio-mem currently supports the following modes of operation:
  *
@@ -1592,28 +1597,16 @@ static int virtio_mem_sbm_prepare_next_mb(struct virtio_mem *vm,
 }
 
 /*
- * Try to plug the desired number of subblocks and add the memory block
- * to Linux.
+ * Add a memory block whose first @count subblocks are plugged to Linux. If
+ * that fails, try to unplug them again.
  *
  * Will modify the state of the memory block.
  */
-static int virtio_mem_sbm_plug_and_add_mb(struct virtio_mem *vm,
-					  unsigned long mb_id, uint64_t *nb_sb)
+static int virtio_mem_sbm_add_plugged_mb(struct virtio_mem *vm,
+					 unsigned long mb_id, int count)
 {
-	const int count = min_t(int, *nb_sb, vm->sbm.sbs_per_mb);
 	int rc;
 
-	if (WARN_ON_ONCE(!count))
-		return -EINVAL;
-
-	/*
-	 * Plug the requested number of subblocks before adding it to linux,
-	 * so that onlining will directly online all plugged subblocks.
-	 */
-	rc = virtio_mem_sbm_plug_sb(vm, mb_id, 0, count);
-	if (rc)
-		return rc;
-
 	/*
 	 * Mark the block properly offline before adding it to Linux,
 	 * so the memory notifiers will find the block in the right state.
@@ -1635,11 +1628,131 @@ static int virtio_mem_sbm_plug_and_add_mb(struct virtio_mem *vm,
 		virtio_mem_sbm_set_mb_state(vm, mb_id, new_state);
 		return rc;
 	}
+	return 0;
+}
+
+/*
+ * Try to plug the desired number of subblocks and add the memory block
+ * to Linux.
+ *
+ * Will modify the state of the memory block.
+ */
+static int virtio_mem_sbm_plug_and_add_mb(struct virtio_mem *vm,
+					  unsigned long mb_id, uint64_t *nb_sb)
+{
+	const int count = min_t(int, *nb_sb, vm->sbm.sbs_per_mb);
+	int rc;
+
+	if (WARN_ON_ONCE(!count))
+		return -EINVAL;
+
+	/*
+	 * Plug the requested number of subblocks before adding it to linux,
+	 * so that onlining will directly online all plugged subblocks.
+	 */
+	rc = virtio_mem_sbm_plug_sb(vm, mb_id, 0, count);
+	if (rc)
+		return rc;
+
+	rc = virtio_mem_sbm_add_plugged_mb(vm, mb_id, count);
+	if (rc)
+		return rc;
 
 	*nb_sb -= count;
 	return 0;
 }
 
+/*
+ * Plug a run of new memory blocks, all subblocks of each, with a single
+ * request and add them to Linux one by one. Stops at the first block that
+ * cannot be added.
+ *
+ * Will modify the state of the memory blocks.
+ */
+static int virtio_mem_sbm_plug_and_add_mbs(struct virtio_mem *vm,
+					   unsigned long first_mb_id,
+					   int nb_mb, uint64_t *nb_sb)
+{
+	const uint64_t addr = virtio_mem_mb_id_to_phys(first_mb_id);
+	const uint64_t size = nb_mb * memory_block_size_bytes();
+	unsigned long mb_id;
+	int rc;
+
+	rc = virtio_mem_send_plug_request(vm, addr, size);
+	if (rc)
+		return rc;
+	for (mb_id = first_mb_id; mb_id < first_mb_id + nb_mb; mb_id++)
+		virtio_mem_sbm_set_sb_plugged(vm, mb_id, 0, vm->sbm.sbs_per_mb);
+
+	for (mb_id = first_mb_id; mb_id < first_mb_id + nb_mb; mb_id++) {
+		rc = virtio_mem_sbm_add_plugged_mb(vm, mb_id,
+						   vm->sbm.sbs_per_mb);
+		if (rc)
+			break;
+		*nb_sb -= vm->sbm.sbs_per_mb;
+	}
+
+	/* Don't leave the memory we couldn't add plugged. */
+	while (rc && ++mb_id < first_mb_id + nb_mb) {
+		if (virtio_mem_sbm_unplug_sb(vm, mb_id, 0, vm->sbm.sbs_per_mb))
+			virtio_mem_sbm_set_mb_state(vm, mb_id,
+						    VIRTIO_MEM_SBM_MB_PLUGGED);
+	}
+	return rc;
+}
+
+/*
+ * Plug the new memory blocks still needed for @nb_sb subblocks, batching
+ * the requests for fully plugged blocks.
+ */
+static int virtio_mem_sbm_plug_new_mbs(struct virtio_mem *vm, uint64_t *nb_sb)
+{
+	const uint64_t mb_size = memory_block_size_bytes();
+	unsigned long first_mb_id = 0, mb_id;
+	int nb_mb, rc;
+
+	while (*nb_sb >= vm->sbm.sbs_per_mb) {
+		rc = -ENOSPC;
+		nb_mb = 0;
+		while (*nb_sb >= (nb_mb + 1) * vm->sbm.sbs_per_mb &&
+		       nb_mb < max(plug_batch, 1U) &&
+		       (nb_mb + 1) * mb_size / vm->device_block_size <= U16_MAX &&
+		       (!nb_mb || (nb_mb + 1) * mb_size <= vm->offline_threshold) &&
+		       virtio_mem_could_add_memory(vm, (nb_mb + 1) * mb_size)) {
+			rc = virtio_mem_sbm_prepare_next_mb(vm, &mb_id);
+			if (rc)
+				break;
+			if (!nb_mb)
+				first_mb_id = mb_id;
+			nb_mb++;
+		}
+		if (!nb_mb)
+			return rc;
+
+		/* On failure, the prepared blocks remain unused. */
+		rc = virtio_mem_sbm_plug_and_add_mbs(vm, first_mb_id, nb_mb,
+						     nb_sb);
+		if (rc)
+			return rc;
+		cond_resched();
+	}
+
+	/* The remaining subblocks go into one last, partially plugged block */
+	while (*nb_sb) {
+		if (!virtio_mem_could_add_memory(vm, mb_size))
+			return -ENOSPC;
+
+		rc = virtio_mem_sbm_prepare_next_mb(vm, &mb_id);
+		if (rc)
+			return rc;
+		rc = virtio_mem_sbm_plug_and_add_mb(vm, mb_id, nb_sb);
+		if (rc)
+			return rc;
+		cond_resched();
+	}
+	return 0;
+}
+
 /*
  * Try to plug the desired number of subblocks of a memory block that
  * is already added to Linux.
@@ -1733,42 +1846,22 @@ static int virtio_mem_sbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 	}
 
 	/* Try to prepare, plug and add new blocks */
-	while (nb_sb) {
-		if (!virtio_mem_could_add_memory(vm, memory_block_size_bytes()))
-			return -ENOSPC;
-
-		rc = virtio_mem_sbm_prepare_next_mb(vm, &mb_id);
-		if (rc)
-			return rc;
-		rc = virtio_mem_sbm_plug_and_add_mb(vm, mb_id, &nb_sb);
-		if (rc)
-			return rc;
-		cond_resched();
-	}
-
-	return 0;
+	return virtio_mem_sbm_plug_new_mbs(vm, &nb_sb);
 out_unlock:
 	mutex_unlock(&vm->hotplug_mutex);
 	return rc;
 }
 
 /*
- * Plug a big block and add it to Linux.
+ * Add a plugged big block to Linux. If that fails, try to unplug it again.
  *
  * Will modify the state of the big block.
  */
-static int virtio_mem_bbm_plug_and_add_bb(struct virtio_mem *vm,
-					  unsigned long bb_id)
+static int virtio_mem_bbm_add_plugged_bb(struct virtio_mem *vm,
+					 unsigned long bb_id)
 {
 	int rc;
 
-	if (WARN_ON_ONCE(virtio_mem_bbm_get_bb_state(vm, bb_id) !=
-			 VIRTIO_MEM_BBM_BB_UNUSED))
-		return -EINVAL;
-
-	rc = virtio_mem_bbm_plug_bb(vm, bb_id);
-	if (rc)
-		return rc;
 	virtio_mem_bbm_set_bb_state(vm, bb_id, VIRTIO_MEM_BBM_BB_ADDED);
 
 	rc = virtio_mem_bbm_add_bb(vm, bb_id);
@@ -1785,6 +1878,60 @@ static int virtio_mem_bbm_plug_and_add_bb(struct virtio_mem *vm,
 	return 0;
 }
 
+/*
+ * Plug a big block and add it to Linux.
+ *
+ * Will modify the state of the big block.
+ */
+static int virtio_mem_bbm_plug_and_add_bb(struct virtio_mem *vm,
+					  unsigned long bb_id)
+{
+	int rc;
+
+	if (WARN_ON_ONCE(virtio_mem_bbm_get_bb_state(vm, bb_id) !=
+			 VIRTIO_MEM_BBM_BB_UNUSED))
+		return -EINVAL;
+
+	rc = virtio_mem_bbm_plug_bb(vm, bb_id);
+	if (rc)
+		return rc;
+	return virtio_mem_bbm_add_plugged_bb(vm, bb_id);
+}
+
+/*
+ * Plug a run of new big blocks with a single request and add them to Linux
+ * one by one. Stops at the first big block that cannot be added.
+ *
+ * Will modify the state of the big blocks.
+ */
+static int virtio_mem_bbm_plug_and_add_bbs(struct virtio_mem *vm,
+					   unsigned long first_bb_id,
+					   int nb_bb, uint64_t *nb_left)
+{
+	const uint64_t addr = virtio_mem_bb_id_to_phys(vm, first_bb_id);
+	unsigned long bb_id;
+	int rc;
+
+	rc = virtio_mem_send_plug_request(vm, addr, nb_bb * vm->bbm.bb_size);
+	if (rc)
+		return rc;
+
+	for (bb_id = first_bb_id; bb_id < first_bb_id + nb_bb; bb_id++) {
+		rc = virtio_mem_bbm_add_plugged_bb(vm, bb_id);
+		if (rc)
+			break;
+		(*nb_left)--;
+	}
+
+	/* Don't leave the memory we couldn't add plugged. */
+	while (rc && ++bb_id < first_bb_id + nb_bb) {
+		if (virtio_mem_bbm_unplug_bb(vm, bb_id))
+			virtio_mem_bbm_set_bb_state(vm, bb_id,
+						    VIRTIO_MEM_BBM_BB_PLUGGED);
+	}
+	return rc;
+}
+
 /*
  * Prepare tracking data for the next big block.
  */
@@ -1810,8 +1957,8 @@ static int virtio_mem_bbm_prepare_next_bb(struct virtio_mem *vm,
 static int virtio_mem_bbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 {
 	uint64_t nb_bb = diff / vm->bbm.bb_size;
-	unsigned long bb_id;
-	int rc;
+	unsigned long bb_id, first_bb_id = 0;
+	int rc, count;
 
 	if (!nb_bb)
 		return 0;
@@ -1829,17 +1976,27 @@ static int virtio_mem_bbm_plug_request(struct virtio_mem *vm, uint64_t diff)
 		cond_resched();
 	}
 
-	/* Try to prepare, plug and add new big blocks */
+	/* Try to prepare, plug and add new big blocks, a batch at a time */
 	while (nb_bb) {
-		if (!virtio_mem_could_add_memory(vm, vm->bbm.bb_size))
-			return -ENOSPC;
-
-		rc = virtio_mem_bbm_prepare_next_bb(vm, &bb_id);
-		if (rc)
+		rc = -ENOSPC;
+		count = 0;
+		while (count < nb_bb && count < max(plug_batch, 1U) &&
+		       (count + 1) * vm->bbm.bb_size / vm->device_block_size <= U16_MAX &&
+		       (!count || (count + 1) * vm->bbm.bb_size <= vm->offline_threshold) &&
+		       virtio_mem_could_add_memory(vm, (count + 1) * vm->bbm.bb_size)) {
+			rc = virtio_mem_bbm_prepare_next_bb(vm, &bb_id);
+			if (rc)
+				break;
+			if (!count)
+				first_bb_id = bb_id;
+			count++;
+		}
+		if (!count)
 			return rc;
-		rc = virtio_mem_bbm_plug_and_add_bb(vm, bb_id);
-		if (!rc)
-			nb_bb--;
+
+		/* On failure, the prepared big blocks remain unused. */
+		rc = virtio_mem_bbm_plug_and_add_bbs(vm, first_bb_id, count,
+						     &nb_bb);
 		if (rc)
 			return rc;
 		cond_resched();
@@ -70,11 +70,14 @@
 struct vring_desc_state_split {
 	void *data;			/* Data for callback. */
 	struct vring_desc *indir_desc;	/* Indirect descriptor, if any. */
+	u32 total_in_len;		/* Device writable length (in order). */
+	u16 num;			/* Descriptor list length. */
 };
 
 struct vring_desc_state_packed {
 	void *data;			/* Data for callback. */
 	struct vring_packed_desc *indir_desc; /* Indirect descriptor, if any. */
+	u32 total_in_len;		/* Device writable length (in order). */
 	u16 num;			/* Descriptor list length. */
 	u16 last;			/* The last desc state in a list. */
 };
@@ -99,6 +102,15 @@ struct vring_virtqueue_split {
 	 */
 	u16 avail_idx_shadow;
 
+	/*
+	 * The used entry of the in-order batch being consumed: it has been
+	 * consumed from the used ring already, so its slot may be reused
+	 * before the buffers it implies are all returned.
+	 */
+	bool in_order_batch;
+	u16 in_order_last_id;
+	u32 in_order_last_len;
+
 	/* Per-descriptor state. */
 	struct vring_desc_state_split *desc_state;
 	struct vring_desc_extra *desc_extra;
@@ -139,6 +151,16 @@ struct vring_virtqueue_packed {
 	 */
 	u16 event_flags_shadow;
 
+	/*
+	 * Descriptors of in-order buffers consumed ahead of the used
+	 * descriptor that completes their batch, and that descriptor's
+	 * content: its ring slot may be reused once the skipped ones are
+	 * freed.  A batch is in progress while in_order_skip is non-zero.
+	 */
+	u16 in_order_skip;
+	u16 in_order_last_id;
+	u32 in_order_last_len;
+
 	/* Per-descriptor state. */
 	struct vring_desc_state_packed *desc_state;
 	struct vring_desc_extra *desc_extra;
@@ -160,6 +182,9 @@ struct vring_virtqueue {
 	/* Is DMA API used? */
 	bool use_dma_api;
 
+	/* Does the driver map the buffers itself? */
+	bool premapped;
+
 	/* Can we use weak barriers? */
 	bool weak_barriers;
 
@@ -172,6 +197,9 @@ struct vring_virtqueue {
 	/* Host publishes avail event idx */
 	bool event;
 
+	/* Buffers are used in the order they were made available */
+	bool in_order;
+
 	/* Head of free buffer list. */
 	unsigned int free_head;
 	/* Number we've added since last sync. */
@@ -363,6 +391,10 @@ static dma_addr_t vring_map_one_sg(const struct vring_virtqueue *vq,
 		return (dma_addr_t)sg_phys(sg);
 	}
 
+	/* The driver has already mapped the buffer, see virtqueue_set_dma_premapped() */
+	if (vq->premapped)
+		return sg_dma_address(sg);
+
 	/*
 	 * We can't use dma_map_sg, because we don't use scatterlists in
 	 * the way it expects (we don't guarantee that the scatterlist
@@ -412,6 +444,18 @@ static void virtqueue_init(struct vring_virtqueue *vq, u32 num)
 }
 
 
+/*
+ * With VIRTIO_F_IN_ORDER descriptors are never put back on the free list:
+ * they are handed out in ring order and reclaimed in the same order, so the
+ * oldest outstanding buffer starts right after the free ones.  The device
+ * may return a whole batch with a single used entry for its last buffer.
+ */
+static inline unsigned int in_order_next_head(const struct vring_virtqueue *vq,
+					      unsigned int num)
+{
+	return (vq->free_head + vq->vq.num_free) % num;
+}
+
 /*
  * Split ring specific functions - *_split().
  */
@@ -421,7 +465,7 @@ static void vring_unmap_one_split_indirect(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = virtio16_to_cpu(vq->vq.vdev, desc->flags);
@@ -450,7 +494,7 @@ static unsigned int vring_unmap_one_split(const struct vring_virtqueue *vq,
 				 extra[i].len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra[i].addr,
 			       extra[i].len,
@@ -527,6 +571,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 	struct scatterlist *sg;
 	struct vring_desc *desc;
 	unsigned int i, n, avail, descs_used, prev, err_idx;
+	u32 total_in_len = 0;
 	int head;
 	bool indirect;
 
@@ -610,6 +655,7 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 						     VRING_DESC_F_NEXT |
 						     VRING_DESC_F_WRITE,
 						     indirect);
+			total_in_len += sg->length;
 		}
 	}
 	/* Last one doesn't continue. */
@@ -644,6 +690,8 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 
 	/* Store token and indirect buffer state. */
 	vq->split.desc_state[head].data = data;
+	vq->split.desc_state[head].num = descs_used;
+	vq->split.desc_state[head].total_in_len = total_in_len;
 	if (indirect)
 		vq->split.desc_state[head].indir_desc = desc;
 	else
@@ -737,6 +785,17 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 	/* Clear data ptr. */
 	vq->split.desc_state[head].data = NULL;
 
+	if (vq->in_order) {
+		/* The whole chain is reclaimed at once, no free list to fix */
+		j = vq->split.desc_state[head].num;
+		vq->vq.num_free += j;
+		if (vq->use_dma_api) {
+			for (i = head; j; j--)
+				i = vring_unmap_one_split(vq, i);
+		}
+		goto free_indirect;
+	}
+
 	/* Put back on free list: unmap first-level descriptors and find end */
 	i = head;
 
@@ -753,6 +812,7 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 	/* Plus final descriptor */
 	vq->vq.num_free++;
 
+free_indirect:
 	if (vq->indirect) {
 		struct vring_desc *indir_desc =
 				vq->split.desc_state[head].indir_desc;
@@ -780,6 +840,9 @@ static void detach_buf_split(struct vring_virtqueue *vq, unsigned int head,
 
 static inline bool more_used_split(const struct vring_virtqueue *vq)
 {
+	if (vq->split.in_order_batch)
+		return true;
+
 	return vq->last_used_idx != virtio16_to_cpu(vq->vq.vdev,
 			vq->split.vring.used->idx);
 }
@@ -789,6 +852,7 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 					 void **ctx)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
+	bool from_ring = !vq->split.in_order_batch;
 	void *ret;
 	unsigned int i;
 	u16 last_used;
@@ -809,16 +873,36 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 	/* Only get used array entries after they have been exposed by host. */
 	virtio_rmb(vq->weak_barriers);
 
-	last_used = (vq->last_used_idx & (vq->split.vring.num - 1));
-	i = virtio32_to_cpu(_vq->vdev,
-			vq->split.vring.used->ring[last_used].id);
-	*len = virtio32_to_cpu(_vq->vdev,
-			vq->split.vring.used->ring[last_used].len);
+	if (from_ring) {
+		last_used = (vq->last_used_idx & (vq->split.vring.num - 1));
+		i = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].id);
+		*len = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].len);
+	} else {
+		i = vq->split.in_order_last_id;
+		*len = vq->split.in_order_last_len;
+	}
 
 	if (unlikely(i >= vq->split.vring.num)) {
 		BAD_RING(vq, "id %u out of range\n", i);
 		return NULL;
 	}
+	if (vq->in_order) {
+		unsigned int head = in_order_next_head(vq, vq->split.vring.num);
+
+		/*
+		 * Buffers before the batch's last one are implicitly used,
+		 * return them one at a time and the last one with its entry.
+		 */
+		vq->split.in_order_batch = head != i;
+		if (vq->split.in_order_batch) {
+			vq->split.in_order_last_id = i;
+			vq->split.in_order_last_len = *len;
+			*len = vq->split.desc_state[head].total_in_len;
+			i = head;
+		}
+	}
 	if (unlikely(!vq->split.desc_state[i].data)) {
 		BAD_RING(vq, "id %u is not a head!\n", i);
 		return NULL;
@@ -827,7 +911,9 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 	/* detach_buf_split clears data, so grab it now. */
 	ret = vq->split.desc_state[i].data;
 	detach_buf_split(vq, i, ctx);
-	vq->last_used_idx++;
+	/* A batch's used entry is consumed once, when it is first read */
+	if (from_ring)
+		vq->last_used_idx++;
 	/* If we expect an interrupt for the next entry, tell host
 	 * by writing event index and flush out the write before
 	 * the read in the next get_buf call. */
@@ -887,6 +973,10 @@ static bool virtqueue_poll_split(struct virtqueue *_vq, unsigned int last_used_i
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
 
+	/* The rest of an in-order batch is still to be consumed */
+	if (vq->split.in_order_batch)
+		return true;
+
 	return (u16)last_used_idx != virtio16_to_cpu(_vq->vdev,
 			vq->split.vring.used->idx);
 }
@@ -917,7 +1007,8 @@ static bool virtqueue_enable_cb_delayed_split(struct virtqueue *_vq)
 			&vring_used_event(&vq->split.vring),
 			cpu_to_virtio16(_vq->vdev, vq->last_used_idx + bufs));
 
-	if (unlikely((u16)(virtio16_to_cpu(_vq->vdev, vq->split.vring.used->idx)
+	if (unlikely(vq->split.in_order_batch ||
+		     (u16)(virtio16_to_cpu(_vq->vdev, vq->split.vring.used->idx)
 					- vq->last_used_idx) > bufs)) {
 		END_USE(vq);
 		return false;
@@ -963,6 +1054,7 @@ static void virtqueue_vring_init_split(struct vring_virtqueue_split *vring_split
 
 	vring_split->avail_flags_shadow = 0;
 	vring_split->avail_idx_shadow = 0;
+	vring_split->in_order_batch = false;
 
 	/* No callback?  Tell other side not to bother us. */
 	if (!vq->vq.callback) {
@@ -991,6 +1083,10 @@ static void virtqueue_reinit_split(struct vring_virtqueue *vq)
 	/* reset used event */
 	*(__virtio16 *)&(vq->split.vring.used->ring[num]) = 0;
 
+	/* In-order descriptors restart from the beginning of the table */
+	if (vq->in_order)
+		vq->free_head = 0;
+
 	virtqueue_init(vq, num);
 
 	virtqueue_vring_init_split(&vq->split, vq);
@@ -1185,7 +1281,7 @@ static void vring_unmap_extra_packed(const struct vring_virtqueue *vq,
 				 extra->addr, extra->len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra->addr, extra->len,
 			       (flags & VRING_DESC_F_WRITE) ?
@@ -1198,7 +1294,7 @@ static void vring_unmap_desc_packed(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = le16_to_cpu(desc->flags);
@@ -1238,6 +1334,7 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	struct vring_packed_desc *desc;
 	struct scatterlist *sg;
 	unsigned int i, n, err_idx;
+	u32 total_in_len = 0;
 	u16 head, id;
 	dma_addr_t addr;
 
@@ -1268,6 +1365,8 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 						0 : VRING_DESC_F_WRITE);
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
+			if (n >= out_sgs)
+				total_in_len += sg->length;
 			i++;
 		}
 	}
@@ -1321,6 +1420,7 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = desc;
 	vq->packed.desc_state[id].last = id;
+	vq->packed.desc_state[id].total_in_len = total_in_len;
 
 	vq->num_added += 1;
 
@@ -1354,6 +1454,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	struct vring_packed_desc *desc;
 	struct scatterlist *sg;
 	unsigned int i, n, c, descs_used, err_idx;
+	u32 total_in_len = 0;
 	__le16 head_flags, flags;
 	u16 head, id, prev, curr, avail_used_flags;
 	int err;
@@ -1422,6 +1523,8 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
 			desc[i].id = cpu_to_le16(id);
+			if (n >= out_sgs)
+				total_in_len += sg->length;
 
 			if (unlikely(vq->use_dma_api)) {
 				vq->packed.desc_extra[curr].addr = addr;
@@ -1456,6 +1559,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = ctx;
 	vq->packed.desc_state[id].last = prev;
+	vq->packed.desc_state[id].total_in_len = total_in_len;
 
 	/*
 	 * A driver MUST NOT make the first descriptor in the list
@@ -1553,8 +1657,11 @@ static void detach_buf_packed(struct vring_virtqueue *vq,
 	/* Clear data ptr. */
 	state->data = NULL;
 
-	vq->packed.desc_extra[state->last].next = vq->free_head;
-	vq->free_head = id;
+	/* In-order ids are reclaimed in ring order, keep the list as is */
+	if (!vq->in_order) {
+		vq->packed.desc_extra[state->last].next = vq->free_head;
+		vq->free_head = id;
+	}
 	vq->vq.num_free += state->num;
 
 	if (unlikely(vq->use_dma_api)) {
@@ -1606,6 +1713,9 @@ static inline bool more_used_packed(const struct vring_virtqueue *vq)
 	u16 last_used_idx;
 	bool used_wrap_counter;
 
+	if (vq->packed.in_order_skip)
+		return true;
+
 	last_used_idx = READ_ONCE(vq->last_used_idx);
 	last_used = packed_last_used(last_used_idx);
 	used_wrap_counter = packed_used_wrap_counter(last_used_idx);
@@ -1619,6 +1729,7 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 	struct vring_virtqueue *vq = to_vvq(_vq);
 	u16 last_used, id, last_used_idx;
 	bool used_wrap_counter;
+	bool batch_end = true;
 	void *ret;
 
 	START_USE(vq);
@@ -1640,13 +1751,32 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 	last_used_idx = READ_ONCE(vq->last_used_idx);
 	used_wrap_counter = packed_used_wrap_counter(last_used_idx);
 	last_used = packed_last_used(last_used_idx);
-	id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
-	*len = le32_to_cpu(vq->packed.vring.desc[last_used].len);
+	if (vq->packed.in_order_skip) {
+		id = vq->packed.in_order_last_id;
+		*len = vq->packed.in_order_last_len;
+	} else {
+		id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
+		*len = le32_to_cpu(vq->packed.vring.desc[last_used].len);
+	}
 
 	if (unlikely(id >= vq->packed.vring.num)) {
 		BAD_RING(vq, "id %u out of range\n", id);
 		return NULL;
 	}
+	if (vq->in_order) {
+		u16 head = in_order_next_head(vq, vq->packed.vring.num);
+
+		/* Buffers before the batch's last one are implicitly used */
+		if (head != id) {
+			if (!vq->packed.in_order_skip) {
+				vq->packed.in_order_last_id = id;
+				vq->packed.in_order_last_len = *len;
+			}
+			*len = vq->packed.desc_state[head].total_in_len;
+			id = head;
+			batch_end = false;
+		}
+	}
 	if (unlikely(!vq->packed.desc_state[id].data)) {
 		BAD_RING(vq, "id %u is not a head!\n", id);
 		return NULL;
@@ -1656,7 +1786,17 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 	ret = vq->packed.desc_state[id].data;
 	detach_buf_packed(vq, id, ctx);
 
-	last_used += vq->packed.desc_state[id].num;
+	/*
+	 * Stay on the used descriptor until its batch is fully consumed, the
+	 * device skips the ring forward by the size of the whole batch.
+	 */
+	if (!batch_end) {
+		vq->packed.in_order_skip += vq->packed.desc_state[id].num;
+		goto out;
+	}
+
+	last_used += vq->packed.desc_state[id].num + vq->packed.in_order_skip;
+	vq->packed.in_order_skip = 0;
 	if (unlikely(last_used >= vq->packed.vring.num)) {
 		last_used -= vq->packed.vring.num;
 		used_wrap_counter ^= 1;
@@ -1675,6 +1815,7 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 				&vq->packed.vring.driver->off_wrap,
 				cpu_to_le16(vq->last_used_idx));
 
+out:
 	LAST_ADD_TIME_INVALID(vq);
 
 	END_USE(vq);
@@ -1731,6 +1872,10 @@ static bool virtqueue_poll_packed(struct virtqueue *_vq, u16 off_wrap)
 	bool wrap_counter;
 	u16 used_idx;
 
+	/* The rest of an in-order batch is still to be consumed */
+	if (vq->packed.in_order_skip)
+		return true;
+
 	wrap_counter = off_wrap >> VRING_PACKED_EVENT_F_WRAP_CTR;
 	used_idx = off_wrap & ~(1 << VRING_PACKED_EVENT_F_WRAP_CTR);
 
@@ -1786,10 +1931,7 @@ static bool virtqueue_enable_cb_delayed_packed(struct virtqueue *_vq)
 	 */
 	virtio_mb(vq->weak_barriers);
 
-	last_used_idx = READ_ONCE(vq->last_used_idx);
-	wrap_counter = packed_used_wrap_counter(last_used_idx);
-	used_idx = packed_last_used(last_used_idx);
-	if (is_used_desc_packed(vq, used_idx, wrap_counter)) {
+	if (more_used_packed(vq)) {
 		END_USE(vq);
 		return false;
 	}
@@ -1946,6 +2088,7 @@ static void virtqueue_vring_init_packed(struct vring_virtqueue_packed *vring_pac
 	vring_packed->next_avail_idx = 0;
 	vring_packed->avail_wrap_counter = 1;
 	vring_packed->event_flags_shadow = 0;
+	vring_packed->in_order_skip = 0;
 	vring_packed->avail_used_flags = 1 << VRING_PACKED_DESC_F_AVAIL;
 
 	/* No callback?  Tell other side not to bother us. */
@@ -1973,6 +2116,10 @@ static void virtqueue_reinit_packed(struct vring_virtqueue *vq)
 	/* we need to reset the desc.flags. For more, see is_used_desc_packed() */
 	memset(vq->packed.vring.desc, 0, vq->packed.ring_size_in_bytes);
 
+	/* In-order ids restart from the beginning of the table */
+	if (vq->in_order)
+		vq->free_head = 0;
+
 	virtqueue_init(vq, vq->packed.vring.num);
 	virtqueue_vring_init_packed(&vq->packed, !!vq->vq.callback);
 }
@@ -2015,10 +2162,12 @@ static struct virtqueue *vring_create_virtqueue_packed(
 #endif
 	vq->packed_ring = true;
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->premapped = false;
 
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
@@ -2508,10 +2657,12 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->broken = false;
 #endif
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->premapped = false;
 
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
 	vq->event = virtio_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX);
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 
 	if (virtio_has_feature(vdev, VIRTIO_F_ORDER_PLATFORM))
 		vq->weak_barriers = false;
@@ -2557,6 +2708,68 @@ struct virtqueue *vring_create_virtqueue(
 }
 EXPORT_SYMBOL_GPL(vring_create_virtqueue);
 
+/**
+ * virtqueue_set_dma_premapped - let the driver map buffers of vq itself
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * After this, virtqueue_add_*() take the DMA address of every sg from
+ * sg_dma_address() and detach never unmaps them.  The driver maps its
+ * buffers once against virtqueue_dma_dev(), e.g. a long-lived pool, and
+ * unmaps them when it is done with them.  Indirect tables are still mapped
+ * by the ring.
+ *
+ * Must be called before any buffer is added.
+ *
+ * Returns zero or a negative error.
+ * 0: success.
+ * -EINVAL: the vq does not use the DMA API.
+ * -EBUSY: the vq is not empty.
+ */
+int virtqueue_set_dma_premapped(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	u32 num;
+
+	START_USE(vq);
+
+	num = vq->packed_ring ? vq->packed.vring.num : vq->split.vring.num;
+
+	if (num != vq->vq.num_free) {
+		END_USE(vq);
+		return -EBUSY;
+	}
+
+	if (!vq->use_dma_api) {
+		END_USE(vq);
+		return -EINVAL;
+	}
+
+	vq->premapped = true;
+
+	END_USE(vq);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(virtqueue_set_dma_premapped);
+
+/**
+ * virtqueue_dma_dev - get the device to map the buffers of vq against
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Returns NULL if the vq does not use the DMA API, in which case buffers
+ * are passed to the device by physical address.
+ */
+struct device *virtqueue_dma_dev(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	if (vq->use_dma_api)
+		return vring_dma_dev(vq);
+
+	return NULL;
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_dev);
+
 /**
  * virtqueue_resize - resize the vring of vq
  * @_vq: the struct virtqueue we're talking about.
@@ -2718,6 +2931,8 @@ void vring_transport_features(struct virtio_device *vdev)
 			break;
 		case VIRTIO_F_ORDER_PLATFORM:
 			break;
+		case VIRTIO_F_IN_ORDER:
+			break;
 		default:
 			/* We don't understand this bit. */
 			__virtio_clear_bit(vdev, i);
@@ -17,6 +17,7 @@
 #include <linux/sched.h>
 #include <linux/swap.h>
 #include <linux/uio.h>
+#include <linux/sizes.h>
 #include <linux/netfs.h>
 #include <net/9p/9p.h>
 #include <net/9p/client.h>
@@ -51,16 +52,65 @@ static void v9fs_issue_read(struct netfs_io_subrequest *subreq)
 }
 
 /**
- * v9fs_init_request - Initialise a read request
- * @rreq: The read request
- * @file: The file being read from
+ * v9fs_clamp_length - Limit the size of an upload
+ * @subreq: The write to make
+ *
+ * Writeback is cut into pieces of a few RPCs each so that several of them
+ * can be in flight on the transport at once.  Reads are left alone.
+ */
+static bool v9fs_clamp_length(struct netfs_io_subrequest *subreq)
+{
+	struct p9_fid *fid = subreq->rreq->netfs_priv;
+	size_t rsize = fid->iounit;
+
+	if (subreq->rreq->origin != NETFS_WRITEBACK)
+		return true;
+
+	if (!rsize || rsize > fid->clnt->msize - P9_IOHDRSZ)
+		rsize = fid->clnt->msize - P9_IOHDRSZ;
+	subreq->len = min_t(size_t, subreq->len, max_t(size_t, rsize, SZ_1M));
+	return true;
+}
+
+/**
+ * v9fs_issue_write - Issue a writeback upload to 9P
+ * @subreq: The write to make
+ */
+static void v9fs_issue_write(struct netfs_io_subrequest *subreq)
+{
+	struct netfs_io_request *wreq = subreq->rreq;
+	struct p9_fid *fid = wreq->netfs_priv;
+	struct iov_iter from;
+	int total, err;
+
+	iov_iter_xarray(&from, ITER_SOURCE, &wreq->mapping->i_pages,
+			subreq->start, subreq->len);
+
+	total = p9_client_write(fid, subreq->start, &from, &err);
+
+	netfs_write_subrequest_terminated(subreq, err ?: total, false);
+}
+
+/**
+ * v9fs_init_request - Initialise a read or writeback request
+ * @rreq: The I/O request
+ * @file: The file being read from (NULL for writeback)
  */
 static int v9fs_init_request(struct netfs_io_request *rreq, struct file *file)
 {
-	struct inode *inode = file_inode(file);
-	struct v9fs_inode *v9inode = V9FS_I(inode);
-	struct p9_fid *fid = file->private_data;
+	struct v9fs_inode *v9inode = V9FS_I(rreq->inode);
+	struct p9_fid *fid;
+
+	if (rreq->origin == NETFS_WRITEBACK) {
+		fid = v9inode->writeback_fid;
+		if (!fid)
+			return -EIO;
+		p9_fid_get(fid);
+		rreq->netfs_priv = fid;
+		return 0;
+	}
 
+	fid = file->private_data;
 	BUG_ON(!fid);
 
 	/* we might need to read from a fid that was opened write-only
@@ -107,7 +157,9 @@ const struct netfs_request_ops v9fs_req_ops = {
 	.init_request		= v9fs_init_request,
 	.free_request		= v9fs_free_request,
 	.begin_cache_operation	= v9fs_begin_cache_operation,
+	.clamp_length		= v9fs_clamp_length,
 	.issue_read		= v9fs_issue_read,
+	.issue_write		= v9fs_issue_write,
 };
 
 /**
@@ -350,6 +402,7 @@ const struct address_space_operations v9fs_addr_operations = {
 	.readahead = netfs_readahead,
 	.dirty_folio = v9fs_dirty_folio,
 	.writepage = v9fs_vfs_writepage,
+	.writepages = netfs_writepages,
 	.write_begin = v9fs_write_begin,
 	.write_end = v9fs_write_end,
 	.release_folio = v9fs_release_folio,
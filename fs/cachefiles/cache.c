@@ -274,6 +274,7 @@ int cachefiles_has_space(struct cachefiles_cache *cache,
 		_debug("### CULL CACHE ###");
 		cachefiles_state_changed(cache);
 	}
+	cachefiles_cull_kick(cache);
 
 	_leave(" = %d", ret);
 	return ret;
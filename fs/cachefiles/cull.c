@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* In-kernel background culling.
+ *
+ * The kernel remembers the data files that it has recently finished with in an
+ * LRU list.  If the daemon has enabled it with the "kcull" command, then when
+ * space runs short a worker evicts batches of files from the cold end of that
+ * list, preferring larger files amongst the oldest, until the cache is back
+ * above the brun/frun limits.  The number of files culled per second is
+ * limited by the rate given to the command.
+ *
+ * Only files the kernel has seen since the cache was bound are known about;
+ * the daemon is still needed to deal with anything older.
+ */
+
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/dcache.h>
+#include <linux/stringhash.h>
+#include "internal.h"
+
+#define CACHEFILES_CULL_LRU_MAX	65536	/* Most files we'll remember */
+#define CACHEFILES_CULL_BATCH	32	/* Most files to cull per pass */
+#define CACHEFILES_CULL_SCAN	4	/* Pick each batch from this many times
+					 * its size at the cold end of the LRU */
+
+struct cachefiles_cull_record {
+	struct list_head	lru_link;	/* Link in cache->cull_lru */
+	struct hlist_node	hash_link;	/* Link in cache->cull_hash */
+	struct dentry		*dir;		/* Directory holding the file */
+	blkcnt_t		blocks;		/* Size of the file when released */
+	u64			seq;		/* Order of release */
+	unsigned int		hash;
+	char			name[];
+};
+
+static unsigned int cachefiles_cull_hash(const struct dentry *dir,
+					 const char *name, unsigned int len)
+{
+	return hash_ptr(dir, 32) ^ full_name_hash(dir, name, len);
+}
+
+static void cachefiles_cull_free_record(struct cachefiles_cull_record *rec)
+{
+	dput(rec->dir);
+	kfree(rec);
+}
+
+/*
+ * Unlink a record from the LRU and the hash.  The caller must hold the lock.
+ */
+static void cachefiles_cull_unlink_record(struct cachefiles_cache *cache,
+					  struct cachefiles_cull_record *rec)
+{
+	list_del(&rec->lru_link);
+	hlist_del(&rec->hash_link);
+	cache->cull_lru_nr--;
+}
+
+/*
+ * Note that the kernel has finished with a data file that is being kept in the
+ * cache, making it a candidate for culling.  If the file is already known
+ * about, it is moved to the warm end of the LRU.
+ */
+void cachefiles_cull_note_release(struct cachefiles_object *object)
+{
+	struct cachefiles_cache *cache = object->volume->cache;
+	struct cachefiles_cull_record *rec, *old = NULL, *drop = NULL;
+	struct hlist_head *head;
+	struct dentry *fan;
+	unsigned int hash;
+
+	/* A tmpfile that didn't get linked in isn't going to stick around. */
+	if (!READ_ONCE(cache->cull_rate) ||
+	    test_bit(CACHEFILES_OBJECT_USING_TMPFILE, &object->flags))
+		return;
+
+	rec = kmalloc(struct_size(rec, name, object->d_name_len + 1), GFP_KERNEL);
+	if (!rec)
+		return;
+
+	fan = object->volume->fanout[(u8)object->cookie->key_hash];
+	rec->dir = dget(fan);
+	rec->blocks = file_inode(object->file)->i_blocks;
+	rec->hash = hash = cachefiles_cull_hash(fan, object->d_name,
+						object->d_name_len);
+	memcpy(rec->name, object->d_name, object->d_name_len);
+	rec->name[object->d_name_len] = 0;
+	head = &cache->cull_hash[hash_min(hash, CACHEFILES_CULL_HASH_BITS)];
+
+	spin_lock(&cache->cull_lock);
+	hlist_for_each_entry(old, head, hash_link) {
+		if (old->hash == hash && old->dir == rec->dir &&
+		    strcmp(old->name, rec->name) == 0) {
+			cachefiles_cull_unlink_record(cache, old);
+			break;
+		}
+	}
+
+	rec->seq = cache->cull_seq++;
+	list_add_tail(&rec->lru_link, &cache->cull_lru);
+	hlist_add_head(&rec->hash_link, head);
+	cache->cull_lru_nr++;
+
+	if (!old && cache->cull_lru_nr > CACHEFILES_CULL_LRU_MAX) {
+		drop = list_first_entry(&cache->cull_lru,
+					struct cachefiles_cull_record, lru_link);
+		cachefiles_cull_unlink_record(cache, drop);
+	}
+	spin_unlock(&cache->cull_lock);
+
+	if (old)
+		cachefiles_cull_free_record(old);
+	if (drop)
+		cachefiles_cull_free_record(drop);
+}
+
+/*
+ * Start the culling worker if it's enabled and not already going.
+ */
+void cachefiles_cull_kick(struct cachefiles_cache *cache)
+{
+	if (READ_ONCE(cache->cull_rate) &&
+	    !list_empty(&cache->cull_lru) &&
+	    !test_and_set_bit(CACHEFILES_KCULL_ACTIVE, &cache->flags))
+		queue_delayed_work(system_long_wq, &cache->cull_work, 0);
+}
+
+static int cachefiles_cull_cmp_blocks(const void *a, const void *b)
+{
+	const struct cachefiles_cull_record *ra = *(void **)a, *rb = *(void **)b;
+
+	if (ra->blocks != rb->blocks)
+		return ra->blocks > rb->blocks ? -1 : 1;
+	return 0;
+}
+
+static int cachefiles_cull_cmp_seq(const void *a, const void *b)
+{
+	const struct cachefiles_cull_record *ra = *(void **)a, *rb = *(void **)b;
+
+	if (ra->seq != rb->seq)
+		return ra->seq < rb->seq ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Return records we decided not to cull to the cold end of the LRU in their
+ * original order.  Any that were released again in the meantime have been
+ * superseded and are discarded.
+ */
+static void cachefiles_cull_put_back(struct cachefiles_cache *cache,
+				     struct cachefiles_cull_record **recs,
+				     unsigned int nr)
+{
+	struct cachefiles_cull_record *rec, *old;
+	struct hlist_head *head;
+	unsigned int i;
+
+	sort(recs, nr, sizeof(recs[0]), cachefiles_cull_cmp_seq, NULL);
+
+	spin_lock(&cache->cull_lock);
+	for (i = nr; i > 0; i--) {
+		rec = recs[i - 1];
+		head = &cache->cull_hash[hash_min(rec->hash, CACHEFILES_CULL_HASH_BITS)];
+		hlist_for_each_entry(old, head, hash_link) {
+			if (old->hash == rec->hash && old->dir == rec->dir &&
+			    strcmp(old->name, rec->name) == 0)
+				break;
+		}
+		if (old) {
+			INIT_LIST_HEAD(&rec->lru_link);
+			continue;
+		}
+		list_add(&rec->lru_link, &cache->cull_lru);
+		hlist_add_head(&rec->hash_link, head);
+		cache->cull_lru_nr++;
+	}
+	spin_unlock(&cache->cull_lock);
+
+	for (i = 0; i < nr; i++)
+		if (list_empty(&recs[i]->lru_link))
+			cachefiles_cull_free_record(recs[i]);
+}
+
+/*
+ * Cull a batch of files and then reschedule if we're still short of space,
+ * spacing the passes out to honour the rate limit.
+ */
+static void cachefiles_cull_worker(struct work_struct *work)
+{
+	struct cachefiles_cache *cache =
+		container_of(work, struct cachefiles_cache, cull_work.work);
+	struct cachefiles_cull_record *recs[CACHEFILES_CULL_BATCH * CACHEFILES_CULL_SCAN];
+	const struct cred *saved_cred;
+	unsigned int rate = READ_ONCE(cache->cull_rate);
+	unsigned int batch, nr = 0, i;
+
+	if (!rate ||
+	    !test_bit(CACHEFILES_READY, &cache->flags) ||
+	    test_bit(CACHEFILES_DEAD, &cache->flags))
+		goto stop;
+
+	batch = min_t(unsigned int, rate, CACHEFILES_CULL_BATCH);
+
+	/* Take the coldest files off the LRU and pick out the largest. */
+	spin_lock(&cache->cull_lock);
+	while (nr < ARRAY_SIZE(recs) && !list_empty(&cache->cull_lru)) {
+		recs[nr] = list_first_entry(&cache->cull_lru,
+					    struct cachefiles_cull_record, lru_link);
+		cachefiles_cull_unlink_record(cache, recs[nr]);
+		nr++;
+	}
+	spin_unlock(&cache->cull_lock);
+
+	if (nr > batch) {
+		sort(recs, nr, sizeof(recs[0]), cachefiles_cull_cmp_blocks, NULL);
+		cachefiles_cull_put_back(cache, recs + batch, nr - batch);
+		nr = batch;
+	}
+
+	cachefiles_begin_secure(cache, &saved_cred);
+	for (i = 0; i < nr; i++) {
+		if (cachefiles_check_in_use(cache, recs[i]->dir, recs[i]->name) == 0)
+			cachefiles_cull(cache, recs[i]->dir, recs[i]->name);
+		cachefiles_cull_free_record(recs[i]);
+	}
+	cachefiles_has_space(cache, 0, 0, cachefiles_has_space_check);
+	cachefiles_end_secure(cache, saved_cred);
+
+	if (test_bit(CACHEFILES_CULLING, &cache->flags) &&
+	    !list_empty(&cache->cull_lru)) {
+		queue_delayed_work(system_long_wq, &cache->cull_work,
+				   max_t(unsigned long, 1, HZ * batch / rate));
+		return;
+	}
+
+stop:
+	clear_bit(CACHEFILES_KCULL_ACTIVE, &cache->flags);
+	/* Catch anyone who tried to kick us whilst we were finishing. */
+	if (test_bit(CACHEFILES_CULLING, &cache->flags))
+		cachefiles_cull_kick(cache);
+}
+
+/*
+ * Initialise the culling state for a cache.
+ */
+void cachefiles_cull_init(struct cachefiles_cache *cache)
+{
+	spin_lock_init(&cache->cull_lock);
+	INIT_LIST_HEAD(&cache->cull_lru);
+	hash_init(cache->cull_hash);
+	INIT_DELAYED_WORK(&cache->cull_work, cachefiles_cull_worker);
+}
+
+/*
+ * Turn off in-kernel culling and forget everything we knew.
+ */
+void cachefiles_cull_stop(struct cachefiles_cache *cache)
+{
+	struct cachefiles_cull_record *rec;
+
+	WRITE_ONCE(cache->cull_rate, 0);
+	cancel_delayed_work_sync(&cache->cull_work);
+	clear_bit(CACHEFILES_KCULL_ACTIVE, &cache->flags);
+
+	spin_lock(&cache->cull_lock);
+	while (!list_empty(&cache->cull_lru)) {
+		rec = list_first_entry(&cache->cull_lru,
+				       struct cachefiles_cull_record, lru_link);
+		cachefiles_cull_unlink_record(cache, rec);
+		spin_unlock(&cache->cull_lock);
+		cachefiles_cull_free_record(rec);
+		spin_lock(&cache->cull_lock);
+	}
+	spin_unlock(&cache->cull_lock);
+}
@@ -39,6 +39,7 @@ static int cachefiles_daemon_cull(struct cachefiles_cache *, char *);
 static int cachefiles_daemon_debug(struct cachefiles_cache *, char *);
 static int cachefiles_daemon_dir(struct cachefiles_cache *, char *);
 static int cachefiles_daemon_inuse(struct cachefiles_cache *, char *);
+static int cachefiles_daemon_kcull(struct cachefiles_cache *, char *);
 static int cachefiles_daemon_secctx(struct cachefiles_cache *, char *);
 static int cachefiles_daemon_tag(struct cachefiles_cache *, char *);
 static int cachefiles_daemon_bind(struct cachefiles_cache *, char *);
@@ -73,6 +74,7 @@ static const struct cachefiles_daemon_cmd cachefiles_daemon_cmds[] = {
 	{ "fcull",	cachefiles_daemon_fcull		},
 	{ "fstop",	cachefiles_daemon_fstop		},
 	{ "inuse",	cachefiles_daemon_inuse		},
+	{ "kcull",	cachefiles_daemon_kcull		},
 	{ "secctx",	cachefiles_daemon_secctx	},
 	{ "tag",	cachefiles_daemon_tag		},
 #ifdef CONFIG_CACHEFILES_ONDEMAND
@@ -114,6 +116,7 @@ static int cachefiles_daemon_open(struct inode *inode, struct file *file)
 	refcount_set(&cache->unbind_pincount, 1);
 	xa_init_flags(&cache->reqs, XA_FLAGS_ALLOC);
 	xa_init_flags(&cache->ondemand_ids, XA_FLAGS_ALLOC1);
+	cachefiles_cull_init(cache);
 
 	/* set default caching limits
 	 * - limit at 1% free space and/or free files
@@ -157,7 +160,7 @@ static void cachefiles_flush_reqs(struct cachefiles_cache *cache)
 	xa_lock(xa);
 	xa_for_each(xa, index, req) {
 		req->error = -EIO;
-		complete(&req->done);
+		complete_all(&req->done);
 	}
 	xa_unlock(xa);
 
@@ -660,6 +663,39 @@ static int cachefiles_daemon_cull(struct cachefiles_cache *cache, char *args)
 	return -EINVAL;
 }
 
+/*
+ * Set the rate at which the kernel may cull files by itself when space runs
+ * short, or turn in-kernel culling off
+ * - command: "kcull <files-per-second>"
+ */
+static int cachefiles_daemon_kcull(struct cachefiles_cache *cache, char *args)
+{
+	unsigned long rate;
+
+	_enter(",%s", args);
+
+	if (!*args)
+		goto inval;
+
+	rate = simple_strtoul(args, &args, 10);
+	if (args[0] != '\0' || rate > UINT_MAX)
+		goto inval;
+
+	if (!rate) {
+		cachefiles_cull_stop(cache);
+		return 0;
+	}
+
+	WRITE_ONCE(cache->cull_rate, rate);
+	if (test_bit(CACHEFILES_CULLING, &cache->flags))
+		cachefiles_cull_kick(cache);
+	return 0;
+
+inval:
+	pr_err("kcull command requires a rate\n");
+	return -EINVAL;
+}
+
 /*
  * Set debugging mode
  * - command: "debug <mask>"
@@ -799,8 +835,13 @@ static void cachefiles_daemon_unbind(struct cachefiles_cache *cache)
 {
 	_enter("");
 
+	/* Stop the culler before withdrawing the objects and then discard
+	 * anything they added to the LRU on the way out.
+	 */
+	cachefiles_cull_stop(cache);
 	if (test_bit(CACHEFILES_READY, &cache->flags))
 		cachefiles_withdraw_cache(cache);
+	cachefiles_cull_stop(cache);
 
 	cachefiles_put_directory(cache->graveyard);
 	cachefiles_put_directory(cache->store);
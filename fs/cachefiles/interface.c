@@ -334,6 +334,7 @@ static void cachefiles_clean_up_object(struct cachefiles_object *object,
 	} else {
 		cachefiles_see_object(object, cachefiles_obj_see_clean_commit);
 		cachefiles_commit_object(object, cache);
+		cachefiles_cull_note_release(object);
 	}
 
 	cachefiles_unmark_inode_in_use(object, object->file);
@@ -16,9 +16,11 @@
 #include <linux/cred.h>
 #include <linux/security.h>
 #include <linux/xarray.h>
+#include <linux/hashtable.h>
 #include <linux/cachefiles.h>
 
 #define CACHEFILES_DIO_BLOCK_SIZE 4096
+#define CACHEFILES_CULL_HASH_BITS 10
 
 struct cachefiles_cache;
 struct cachefiles_object;
@@ -62,6 +64,8 @@ struct cachefiles_object {
 #define CACHEFILES_OBJECT_USING_TMPFILE	0		/* Have an unlinked tmpfile */
 #ifdef CONFIG_CACHEFILES_ONDEMAND
 	int				ondemand_id;
+	loff_t				ondemand_ra_next; /* Expected start of next sequential miss */
+	size_t				ondemand_ra_size; /* Current miss readahead window */
 #endif
 };
 
@@ -106,6 +110,7 @@ struct cachefiles_cache {
 #define CACHEFILES_CULLING		2	/* T if cull engaged */
 #define CACHEFILES_STATE_CHANGED	3	/* T if state changed (poll trigger) */
 #define CACHEFILES_ONDEMAND_MODE	4	/* T if in on-demand read mode */
+#define CACHEFILES_KCULL_ACTIVE		5	/* T if in-kernel culling worker is running */
 	char				*rootdirname;	/* name of cache root directory */
 	char				*secctx;	/* LSM security context */
 	char				*tag;		/* cache binding tag */
@@ -114,6 +119,13 @@ struct cachefiles_cache {
 	unsigned long			req_id_next;
 	struct xarray			ondemand_ids;	/* xarray for ondemand_id allocation */
 	u32				ondemand_id_next;
+	unsigned int			cull_rate;	/* In-kernel cull limit (files/s, 0 = off) */
+	spinlock_t			cull_lock;	/* Lock for cull_lru and cull_hash */
+	struct list_head		cull_lru;	/* Released files, coldest first */
+	DECLARE_HASHTABLE(cull_hash, CACHEFILES_CULL_HASH_BITS);
+	unsigned int			cull_lru_nr;	/* Number of files in cull_lru */
+	u64				cull_seq;	/* Release sequence counter */
+	struct delayed_work		cull_work;	/* In-kernel culling worker */
 };
 
 static inline bool cachefiles_in_ondemand_mode(struct cachefiles_cache *cache)
@@ -125,6 +137,7 @@ static inline bool cachefiles_in_ondemand_mode(struct cachefiles_cache *cache)
 struct cachefiles_req {
 	struct cachefiles_object *object;
 	struct completion done;
+	refcount_t ref;
 	int error;
 	struct cachefiles_msg msg;
 };
@@ -169,6 +182,14 @@ extern int cachefiles_has_space(struct cachefiles_cache *cache,
 				unsigned fnr, unsigned bnr,
 				enum cachefiles_has_space_for reason);
 
+/*
+ * cull.c
+ */
+extern void cachefiles_cull_init(struct cachefiles_cache *cache);
+extern void cachefiles_cull_stop(struct cachefiles_cache *cache);
+extern void cachefiles_cull_kick(struct cachefiles_cache *cache);
+extern void cachefiles_cull_note_release(struct cachefiles_object *object);
+
 /*
  * daemon.c
  */
@@ -294,7 +315,7 @@ extern int cachefiles_ondemand_init_object(struct cachefiles_object *object);
 extern void cachefiles_ondemand_clean_object(struct cachefiles_object *object);
 
 extern int cachefiles_ondemand_read(struct cachefiles_object *object,
-				    loff_t pos, size_t len);
+				    loff_t pos, size_t len, loff_t limit);
 
 #else
 static inline ssize_t cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
@@ -313,7 +334,7 @@ static inline void cachefiles_ondemand_clean_object(struct cachefiles_object *ob
 }
 
 static inline int cachefiles_ondemand_read(struct cachefiles_object *object,
-					   loff_t pos, size_t len)
+					   loff_t pos, size_t len, loff_t limit)
 {
 	return -EOPNOTSUPP;
 }
@@ -28,6 +28,7 @@ struct cachefiles_kiocb {
 	bool			was_async;
 	unsigned int		inval_counter;	/* Copy of cookie->inval_counter */
 	u64			b_writing;
+	ktime_t			issued;		/* When the I/O was started */
 };
 
 static inline void cachefiles_put_kiocb(struct cachefiles_kiocb *ki)
@@ -53,6 +54,9 @@ static void cachefiles_read_complete(struct kiocb *iocb, long ret)
 		trace_cachefiles_io_error(ki->object, inode, ret,
 					  cachefiles_trace_read_error);
 
+	fscache_count_io_done(ki->object->cookie, FSCACHE_LAT_READ,
+			      ki->issued, ret);
+
 	if (ki->term_func) {
 		if (ret >= 0) {
 			if (ki->object->cookie->inval_counter == ki->inval_counter)
@@ -145,6 +149,7 @@ static int cachefiles_read(struct netfs_cache_resources *cres,
 	ki->term_func		= term_func;
 	ki->term_func_priv	= term_func_priv;
 	ki->was_async		= true;
+	ki->issued		= ktime_get();
 
 	if (ki->term_func)
 		ki->iocb.ki_complete = cachefiles_read_complete;
@@ -269,6 +274,7 @@ static void cachefiles_write_complete(struct kiocb *iocb, long ret)
 
 	atomic_long_sub(ki->b_writing, &object->volume->cache->b_writing);
 	set_bit(FSCACHE_COOKIE_HAVE_DATA, &object->cookie->flags);
+	fscache_count_io_done(object->cookie, FSCACHE_LAT_WRITE, ki->issued, ret);
 	if (ki->term_func)
 		ki->term_func(ki->term_func_priv, ret, ki->was_async);
 	cachefiles_put_kiocb(ki);
@@ -317,6 +323,7 @@ int __cachefiles_write(struct cachefiles_object *object,
 	ki->term_func_priv	= term_func_priv;
 	ki->was_async		= true;
 	ki->b_writing		= (len + (1 << cache->bshift) - 1) >> cache->bshift;
+	ki->issued		= ktime_get();
 
 	if (ki->term_func)
 		ki->iocb.ki_complete = cachefiles_write_complete;
@@ -398,7 +405,7 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 	struct file *file = cachefiles_cres_file(cres);
 	enum netfs_io_source ret = NETFS_DOWNLOAD_FROM_SERVER;
 	size_t len = *_len;
-	loff_t off, to;
+	loff_t off, to, ra_limit;
 	ino_t ino = file ? file_inode(file)->i_ino : 0;
 	int rc;
 
@@ -438,6 +445,7 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 	if (off < 0 && off >= (loff_t)-MAX_ERRNO) {
 		if (off == (loff_t)-ENXIO) {
 			why = cachefiles_trace_read_seek_nxio;
+			ra_limit = i_size;
 			goto download_and_store;
 		}
 		trace_cachefiles_io_error(object, file_inode(file), off,
@@ -448,6 +456,7 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 
 	if (off >= start + len) {
 		why = cachefiles_trace_read_found_hole;
+		ra_limit = off;
 		goto download_and_store;
 	}
 
@@ -456,6 +465,7 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 		len = off - start;
 		*_len = len;
 		why = cachefiles_trace_read_found_part;
+		ra_limit = off;
 		goto download_and_store;
 	}
 
@@ -485,7 +495,7 @@ cachefiles_do_prepare_read(struct netfs_cache_resources *cres,
 download_and_store:
 	__set_bit(NETFS_SREQ_COPY_TO_CACHE, _flags);
 	if (test_bit(NETFS_SREQ_ONDEMAND, _flags)) {
-		rc = cachefiles_ondemand_read(object, start, len);
+		rc = cachefiles_ondemand_read(object, start, len, ra_limit);
 		if (!rc) {
 			__clear_bit(NETFS_SREQ_ONDEMAND, _flags);
 			goto retry;
@@ -4,6 +4,24 @@
 #include <linux/uio.h>
 #include "internal.h"
 
+/*
+ * On-demand miss readahead.  A miss that starts where the previous one ended
+ * grows the window up to CACHEFILES_ONDEMAND_RA_MAX, any other miss resets it,
+ * so lazily pulled sequential reads ask the daemon for large ranges while
+ * random reads keep their original size.
+ */
+#define CACHEFILES_ONDEMAND_RA_MIN	SZ_128K
+#define CACHEFILES_ONDEMAND_RA_MAX	SZ_2M
+
+/* Largest READ request that may be built by merging adjacent misses */
+#define CACHEFILES_ONDEMAND_READ_MAX	SZ_8M
+
+static void cachefiles_req_put(struct cachefiles_req *req)
+{
+	if (refcount_dec_and_test(&req->ref))
+		kfree(req);
+}
+
 static int cachefiles_ondemand_fd_release(struct inode *inode,
 					  struct file *file)
 {
@@ -24,7 +42,7 @@ static int cachefiles_ondemand_fd_release(struct inode *inode,
 		if (req->msg.object_id == object_id &&
 		    req->msg.opcode == CACHEFILES_OP_READ) {
 			req->error = -EIO;
-			complete(&req->done);
+			complete_all(&req->done);
 			xas_store(&xas, NULL);
 		}
 	}
@@ -97,7 +115,7 @@ static long cachefiles_ondemand_fd_ioctl(struct file *filp, unsigned int ioctl,
 		return -EINVAL;
 
 	trace_cachefiles_ondemand_cread(object, id);
-	complete(&req->done);
+	complete_all(&req->done);
 	return 0;
 }
 
@@ -300,7 +318,7 @@ ssize_t cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
 error:
 	xa_erase(&cache->reqs, id);
 	req->error = ret;
-	complete(&req->done);
+	complete_all(&req->done);
 	return ret;
 }
 
@@ -329,6 +347,7 @@ static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
 
 	req->object = object;
 	init_completion(&req->done);
+	refcount_set(&req->ref, 1);
 	req->msg.opcode = opcode;
 	req->msg.len = sizeof(struct cachefiles_msg) + data_len;
 
@@ -388,7 +407,7 @@ static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
 	wait_for_completion(&req->done);
 	ret = req->error;
 out:
-	kfree(req);
+	cachefiles_req_put(req);
 	return ret;
 }
 
@@ -503,11 +522,108 @@ void cachefiles_ondemand_clean_object(struct cachefiles_object *object)
 			cachefiles_ondemand_init_close_req, NULL);
 }
 
+/*
+ * Work out how much to ask the daemon for on a miss at @pos.  The range is
+ * never extended past @limit, which is the start of the next cached data or
+ * the end of the object.
+ */
+static size_t cachefiles_ondemand_ra_len(struct cachefiles_object *object,
+					 loff_t pos, size_t len, loff_t limit)
+{
+	loff_t end = pos + len;
+	size_t ra;
+
+	spin_lock(&object->lock);
+	if (pos == object->ondemand_ra_next)
+		ra = clamp_t(size_t, object->ondemand_ra_size * 2,
+			     CACHEFILES_ONDEMAND_RA_MIN,
+			     CACHEFILES_ONDEMAND_RA_MAX);
+	else
+		ra = 0;
+	object->ondemand_ra_size = ra;
+
+	if (ra > len && limit > end) {
+		end = min_t(loff_t, pos + ra, limit);
+		if (end < limit)
+			end = max_t(loff_t, round_down(end, PAGE_SIZE),
+				    pos + len);
+	}
+	object->ondemand_ra_next = end;
+	spin_unlock(&object->lock);
+	return end - pos;
+}
+
+/*
+ * Piggyback a miss on a READ request that is already queued for the same
+ * object.  A request the daemon has not picked up yet is extended to cover an
+ * overlapping or adjacent miss, so that several small misses reach the daemon
+ * as a single message.  A request already being served is only reused if it
+ * covers the whole range.  Return -ENOENT if no request could be shared.
+ */
+static int cachefiles_ondemand_join_read(struct cachefiles_object *object,
+					 loff_t pos, size_t len)
+{
+	struct cachefiles_cache *cache = object->volume->cache;
+	struct cachefiles_read *load;
+	struct cachefiles_req *req;
+	u64 start, end;
+	int ret;
+	XA_STATE(xas, &cache->reqs, 0);
+
+	xa_lock(&cache->reqs);
+	/* requests left in the xarray by cachefiles_flush_reqs() are stale */
+	if (test_bit(CACHEFILES_DEAD, &cache->flags)) {
+		xa_unlock(&cache->reqs);
+		return -EIO;
+	}
+
+	xas_for_each(&xas, req, ULONG_MAX) {
+		if (req->object != object ||
+		    req->msg.opcode != CACHEFILES_OP_READ)
+			continue;
+
+		load = (void *)req->msg.data;
+		if (load->off <= pos && pos + len <= load->off + load->len)
+			goto join;
+
+		if (!xas_get_mark(&xas, CACHEFILES_REQ_NEW))
+			continue;
+		if (pos > load->off + load->len || pos + len < load->off)
+			continue;
+		start = min_t(u64, load->off, pos);
+		end = max_t(u64, load->off + load->len, pos + len);
+		if (end - start > CACHEFILES_ONDEMAND_READ_MAX)
+			continue;
+
+		load->off = start;
+		load->len = end - start;
+		goto join;
+	}
+	xa_unlock(&cache->reqs);
+	return -ENOENT;
+
+join:
+	refcount_inc(&req->ref);
+	xa_unlock(&cache->reqs);
+
+	wait_for_completion(&req->done);
+	ret = req->error;
+	cachefiles_req_put(req);
+	return ret;
+}
+
 int cachefiles_ondemand_read(struct cachefiles_object *object,
-			     loff_t pos, size_t len)
+			     loff_t pos, size_t len, loff_t limit)
 {
-	struct cachefiles_read_ctx read_ctx = {pos, len};
+	struct cachefiles_read_ctx read_ctx;
+	int ret;
+
+	ret = cachefiles_ondemand_join_read(object, pos, len);
+	if (ret != -ENOENT)
+		return ret;
 
+	read_ctx.off = pos;
+	read_ctx.len = cachefiles_ondemand_ra_len(object, pos, len, limit);
 	return cachefiles_ondemand_send_req(object, CACHEFILES_OP_READ,
 			sizeof(struct cachefiles_read),
 			cachefiles_ondemand_init_read_req, &read_ctx);
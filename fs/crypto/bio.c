@@ -25,23 +25,38 @@
  * then this function isn't applicable.  This function may sleep, so it must be
  * called from a workqueue rather than from the bio's bi_end_io callback.
  *
+ * The blocks of the whole bio are decrypted as one batch, so that several
+ * can be in flight at once when the cipher is asynchronous.
+ *
  * Return: %true on success; %false on failure.  On failure, bio->bi_status is
  *	   also set to an error status.
  */
 bool fscrypt_decrypt_bio(struct bio *bio)
 {
+	const struct inode *inode = bio_first_page_all(bio)->mapping->host;
+	struct fscrypt_crypt_batch batch;
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
+	int err;
+
+	err = fscrypt_crypt_batch_init(&batch, inode, FS_DECRYPT, GFP_NOFS);
+	if (err)
+		goto out;
 
 	bio_for_each_segment_all(bv, bio, iter_all) {
 		struct page *page = bv->bv_page;
-		int err = fscrypt_decrypt_pagecache_blocks(page, bv->bv_len,
-							   bv->bv_offset);
 
-		if (err) {
-			bio->bi_status = errno_to_blk_status(err);
-			return false;
-		}
+		err = fscrypt_crypt_batch_add_pagecache(&batch, page, page,
+							bv->bv_len,
+							bv->bv_offset);
+		if (err)
+			break;
+	}
+	err = fscrypt_crypt_batch_finish(&batch) ?: err;
+out:
+	if (err) {
+		bio->bi_status = errno_to_blk_status(err);
+		return false;
 	}
 	return true;
 }
@@ -118,6 +133,7 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 	const unsigned int blocks_per_page_bits = PAGE_SHIFT - blockbits;
 	const unsigned int blocks_per_page = 1 << blocks_per_page_bits;
 	struct page *pages[16]; /* write up to 16 pages at a time */
+	struct fscrypt_crypt_batch batch;
 	unsigned int nr_pages;
 	unsigned int i;
 	unsigned int offset;
@@ -152,18 +168,26 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 	if (WARN_ON(nr_pages <= 0))
 		return -EINVAL;
 
+	err = fscrypt_crypt_batch_init(&batch, inode, FS_ENCRYPT, GFP_NOFS);
+	if (err)
+		goto out_free_pages;
+
 	/* This always succeeds since __GFP_DIRECT_RECLAIM is set. */
 	bio = bio_alloc(inode->i_sb->s_bdev, nr_pages, REQ_OP_WRITE, GFP_NOFS);
 
 	do {
 		bio->bi_iter.bi_sector = pblk << (blockbits - 9);
 
+		/*
+		 * Encrypt all the blocks for this bio as one batch, then wait
+		 * for them before submitting it.
+		 */
 		i = 0;
 		offset = 0;
 		do {
-			err = fscrypt_crypt_block(inode, FS_ENCRYPT, lblk,
-						  ZERO_PAGE(0), pages[i],
-						  blocksize, offset, GFP_NOFS);
+			err = fscrypt_crypt_batch_add(&batch, lblk, ZERO_PAGE(0),
+						      pages[i], blocksize,
+						      offset);
 			if (err)
 				goto out;
 			lblk++;
@@ -180,6 +204,9 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 			}
 		} while (i != nr_pages && len != 0);
 
+		err = fscrypt_crypt_batch_wait(&batch);
+		if (err)
+			goto out;
 		err = submit_bio_wait(bio);
 		if (err)
 			goto out;
@@ -188,6 +215,8 @@ int fscrypt_zeroout_range(const struct inode *inode, pgoff_t lblk,
 	err = 0;
 out:
 	bio_put(bio);
+	err = fscrypt_crypt_batch_finish(&batch) ?: err;
+out_free_pages:
 	for (i = 0; i < nr_pages; i++)
 		fscrypt_free_bounce_page(pages[i]);
 	return err;
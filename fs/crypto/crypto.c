@@ -144,6 +144,217 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 	return 0;
 }
 
+/* One block's worth of state in a struct fscrypt_crypt_batch */
+struct fscrypt_crypt_req {
+	struct fscrypt_crypt_batch *batch;
+	u64 lblk_num;
+	union fscrypt_iv iv;
+	struct scatterlist src, dst;
+	struct skcipher_request req;	/* Must be last; has the tfm context */
+};
+
+static struct fscrypt_crypt_req *
+fscrypt_alloc_crypt_req(struct fscrypt_crypt_batch *batch, gfp_t gfp_flags)
+{
+	struct crypto_skcipher *tfm = batch->inode->i_crypt_info->ci_enc_key.tfm;
+	struct fscrypt_crypt_req *creq;
+
+	creq = kmalloc(sizeof(*creq) + crypto_skcipher_reqsize(tfm), gfp_flags);
+	if (!creq)
+		return NULL;
+	creq->batch = batch;
+	skcipher_request_set_tfm(&creq->req, tfm);
+	return creq;
+}
+
+static void fscrypt_crypt_req_end(struct fscrypt_crypt_req *creq, int err)
+{
+	struct fscrypt_crypt_batch *batch = creq->batch;
+
+	if (err && cmpxchg(&batch->err, 0, err) == 0)
+		fscrypt_err(batch->inode, "%scryption failed for block %llu: %d",
+			    (batch->rw == FS_DECRYPT ? "De" : "En"),
+			    creq->lblk_num, err);
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
+static void fscrypt_crypt_req_done(struct crypto_async_request *areq, int err)
+{
+	/* A backlogged request has merely started; wait for the real end. */
+	if (err == -EINPROGRESS)
+		return;
+	fscrypt_crypt_req_end(areq->data, err);
+}
+
+/**
+ * fscrypt_crypt_batch_init() - prepare to encrypt or decrypt a batch of blocks
+ * @batch:     The batch to initialize
+ * @inode:     The inode to which the blocks belong
+ * @rw:        FS_ENCRYPT or FS_DECRYPT
+ * @gfp_flags: Memory allocation flags for the first request
+ *
+ * Only the first request is allocated with @gfp_flags; any more are allocated
+ * opportunistically with GFP_NOWAIT as the batch grows, as they only help
+ * performance.
+ *
+ * Return: 0 on success; -ENOMEM if the first request can't be allocated
+ */
+int fscrypt_crypt_batch_init(struct fscrypt_crypt_batch *batch,
+			     const struct inode *inode,
+			     fscrypt_direction_t rw, gfp_t gfp_flags)
+{
+	batch->inode = inode;
+	batch->rw = rw;
+	batch->nr_used = 0;
+	batch->err = 0;
+	atomic_set(&batch->pending, 1);
+	init_completion(&batch->done);
+	batch->reqs[0] = fscrypt_alloc_crypt_req(batch, gfp_flags);
+	batch->nr_reqs = batch->reqs[0] ? 1 : 0;
+	return batch->nr_reqs ? 0 : -ENOMEM;
+}
+
+/**
+ * fscrypt_crypt_batch_wait() - wait for a batch's requests to complete
+ * @batch: The batch to wait for
+ *
+ * Wait for all the blocks added so far to be processed, after which their
+ * destination pages may be used and the batch may be added to again.
+ *
+ * Return: 0 on success; the first error encountered on failure
+ */
+int fscrypt_crypt_batch_wait(struct fscrypt_crypt_batch *batch)
+{
+	if (!atomic_dec_and_test(&batch->pending))
+		wait_for_completion(&batch->done);
+	reinit_completion(&batch->done);
+	atomic_set(&batch->pending, 1);
+	batch->nr_used = 0;
+	return batch->err;
+}
+
+/**
+ * fscrypt_crypt_batch_add() - add a block to a batch
+ * @batch:     The batch to add to
+ * @lblk_num:  Filesystem logical block number of the block
+ * @src_page:  The page containing the input block
+ * @dest_page: The page to which the output block is written (may be @src_page)
+ * @len:       Size of the block.  This must be a multiple of
+ *		FSCRYPT_CONTENTS_ALIGNMENT.
+ * @offs:      Byte offset of the block within both pages
+ *
+ * Start encrypting or decrypting a block.  The operation may complete
+ * asynchronously, so the destination mustn't be used until
+ * fscrypt_crypt_batch_wait() or fscrypt_crypt_batch_finish() has been called.
+ * If all the batch's requests are in flight, this waits for them first.
+ *
+ * Return: 0 on success; -errno on failure
+ */
+int fscrypt_crypt_batch_add(struct fscrypt_crypt_batch *batch, u64 lblk_num,
+			    struct page *src_page, struct page *dest_page,
+			    unsigned int len, unsigned int offs)
+{
+	struct fscrypt_crypt_req *creq;
+	int res;
+
+	if (WARN_ON_ONCE(len <= 0))
+		return -EINVAL;
+	if (WARN_ON_ONCE(len % FSCRYPT_CONTENTS_ALIGNMENT != 0))
+		return -EINVAL;
+
+	if (batch->nr_used == batch->nr_reqs) {
+		creq = NULL;
+		if (batch->nr_reqs < FSCRYPT_MAX_INFLIGHT_REQS)
+			creq = fscrypt_alloc_crypt_req(batch,
+						GFP_NOWAIT | __GFP_NOWARN);
+		if (creq) {
+			batch->reqs[batch->nr_reqs++] = creq;
+		} else {
+			res = fscrypt_crypt_batch_wait(batch);
+			if (res)
+				return res;
+		}
+	}
+	if (READ_ONCE(batch->err))
+		return fscrypt_crypt_batch_wait(batch);
+
+	creq = batch->reqs[batch->nr_used++];
+	creq->lblk_num = lblk_num;
+	fscrypt_generate_iv(&creq->iv, lblk_num, batch->inode->i_crypt_info);
+	sg_init_table(&creq->dst, 1);
+	sg_set_page(&creq->dst, dest_page, len, offs);
+	sg_init_table(&creq->src, 1);
+	sg_set_page(&creq->src, src_page, len, offs);
+	skcipher_request_set_callback(
+		&creq->req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
+		fscrypt_crypt_req_done, creq);
+	skcipher_request_set_crypt(&creq->req, &creq->src, &creq->dst, len,
+				   &creq->iv);
+
+	atomic_inc(&batch->pending);
+	if (batch->rw == FS_DECRYPT)
+		res = crypto_skcipher_decrypt(&creq->req);
+	else
+		res = crypto_skcipher_encrypt(&creq->req);
+	if (res != -EINPROGRESS && res != -EBUSY)
+		fscrypt_crypt_req_end(creq, res);
+	return 0;
+}
+
+/**
+ * fscrypt_crypt_batch_add_pagecache() - add pagecache blocks to a batch
+ * @batch:     The batch to add to
+ * @page:      The locked pagecache page containing the input block(s)
+ * @dest_page: The page to which the output is written (may be @page)
+ * @len:       Total size of the block(s).  Must be a nonzero multiple of the
+ *		filesystem's block size.
+ * @offs:      Byte offset within @page of the first block.  Must be a multiple
+ *		of the filesystem's block size.
+ *
+ * Return: 0 on success; -errno on failure
+ */
+int fscrypt_crypt_batch_add_pagecache(struct fscrypt_crypt_batch *batch,
+				      struct page *page, struct page *dest_page,
+				      unsigned int len, unsigned int offs)
+{
+	const unsigned int blockbits = batch->inode->i_blkbits;
+	const unsigned int blocksize = 1 << blockbits;
+	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
+		       (offs >> blockbits);
+	unsigned int i;
+	int err;
+
+	if (WARN_ON_ONCE(!PageLocked(page)))
+		return -EINVAL;
+
+	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offs, blocksize)))
+		return -EINVAL;
+
+	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
+		err = fscrypt_crypt_batch_add(batch, lblk_num, page, dest_page,
+					      blocksize, i);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+/**
+ * fscrypt_crypt_batch_finish() - complete a batch and release its resources
+ * @batch: The batch to finish
+ *
+ * Return: 0 on success; the first error encountered on failure
+ */
+int fscrypt_crypt_batch_finish(struct fscrypt_crypt_batch *batch)
+{
+	int err = fscrypt_crypt_batch_wait(batch);
+
+	while (batch->nr_reqs)
+		kfree_sensitive(batch->reqs[--batch->nr_reqs]);
+	return err;
+}
+
 /**
  * fscrypt_encrypt_pagecache_blocks() - Encrypt filesystem blocks from a
  *					pagecache page
@@ -176,12 +387,9 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 
 {
 	const struct inode *inode = page->mapping->host;
-	const unsigned int blockbits = inode->i_blkbits;
-	const unsigned int blocksize = 1 << blockbits;
+	const unsigned int blocksize = 1 << inode->i_blkbits;
+	struct fscrypt_crypt_batch batch;
 	struct page *ciphertext_page;
-	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
-		       (offs >> blockbits);
-	unsigned int i;
 	int err;
 
 	if (WARN_ON_ONCE(!PageLocked(page)))
@@ -194,14 +402,16 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	if (!ciphertext_page)
 		return ERR_PTR(-ENOMEM);
 
-	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_ENCRYPT, lblk_num,
-					  page, ciphertext_page,
-					  blocksize, i, gfp_flags);
-		if (err) {
-			fscrypt_free_bounce_page(ciphertext_page);
-			return ERR_PTR(err);
-		}
+	err = fscrypt_crypt_batch_init(&batch, inode, FS_ENCRYPT, gfp_flags);
+	if (!err) {
+		err = fscrypt_crypt_batch_add_pagecache(&batch, page,
+							ciphertext_page,
+							len, offs);
+		err = fscrypt_crypt_batch_finish(&batch) ?: err;
+	}
+	if (err) {
+		fscrypt_free_bounce_page(ciphertext_page);
+		return ERR_PTR(err);
 	}
 	SetPagePrivate(ciphertext_page);
 	set_page_private(ciphertext_page, (unsigned long)page);
@@ -255,27 +465,15 @@ EXPORT_SYMBOL(fscrypt_encrypt_block_inplace);
 int fscrypt_decrypt_pagecache_blocks(struct page *page, unsigned int len,
 				     unsigned int offs)
 {
-	const struct inode *inode = page->mapping->host;
-	const unsigned int blockbits = inode->i_blkbits;
-	const unsigned int blocksize = 1 << blockbits;
-	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
-		       (offs >> blockbits);
-	unsigned int i;
+	struct fscrypt_crypt_batch batch;
 	int err;
 
-	if (WARN_ON_ONCE(!PageLocked(page)))
-		return -EINVAL;
-
-	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offs, blocksize)))
-		return -EINVAL;
-
-	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_DECRYPT, lblk_num, page,
-					  page, blocksize, i, GFP_NOFS);
-		if (err)
-			return err;
-	}
-	return 0;
+	err = fscrypt_crypt_batch_init(&batch, page->mapping->host, FS_DECRYPT,
+				       GFP_NOFS);
+	if (err)
+		return err;
+	err = fscrypt_crypt_batch_add_pagecache(&batch, page, page, len, offs);
+	return fscrypt_crypt_batch_finish(&batch) ?: err;
 }
 EXPORT_SYMBOL(fscrypt_decrypt_pagecache_blocks);
 
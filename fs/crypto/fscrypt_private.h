@@ -15,6 +15,7 @@
 #include <linux/siphash.h>
 #include <crypto/hash.h>
 #include <linux/blk-crypto.h>
+#include <linux/completion.h>
 
 #define CONST_STRLEN(str)	(sizeof(str) - 1)
 
@@ -262,6 +263,26 @@ typedef enum {
 	FS_ENCRYPT,
 } fscrypt_direction_t;
 
+/* Most skcipher requests a batch keeps in flight at once */
+#define FSCRYPT_MAX_INFLIGHT_REQS	16
+
+/*
+ * A batch of file contents blocks being encrypted or decrypted.  Each block
+ * needs its own IV and so its own skcipher request, but the requests are
+ * allocated once per batch and reused, and with an asynchronous cipher up to
+ * FSCRYPT_MAX_INFLIGHT_REQS of them are in flight at the same time.
+ */
+struct fscrypt_crypt_batch {
+	const struct inode *inode;
+	fscrypt_direction_t rw;
+	struct fscrypt_crypt_req *reqs[FSCRYPT_MAX_INFLIGHT_REQS];
+	unsigned int nr_reqs;		/* Number of requests allocated */
+	unsigned int nr_used;		/* Number submitted since last wait */
+	atomic_t pending;		/* In flight, plus one whilst adding */
+	struct completion done;
+	int err;			/* First error seen */
+};
+
 /* crypto.c */
 extern struct kmem_cache *fscrypt_info_cachep;
 int fscrypt_initialize(unsigned int cop_flags);
@@ -269,6 +290,17 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 			u64 lblk_num, struct page *src_page,
 			struct page *dest_page, unsigned int len,
 			unsigned int offs, gfp_t gfp_flags);
+int fscrypt_crypt_batch_init(struct fscrypt_crypt_batch *batch,
+			     const struct inode *inode,
+			     fscrypt_direction_t rw, gfp_t gfp_flags);
+int fscrypt_crypt_batch_add(struct fscrypt_crypt_batch *batch, u64 lblk_num,
+			    struct page *src_page, struct page *dest_page,
+			    unsigned int len, unsigned int offs);
+int fscrypt_crypt_batch_add_pagecache(struct fscrypt_crypt_batch *batch,
+				      struct page *page, struct page *dest_page,
+				      unsigned int len, unsigned int offs);
+int fscrypt_crypt_batch_wait(struct fscrypt_crypt_batch *batch);
+int fscrypt_crypt_batch_finish(struct fscrypt_crypt_batch *batch);
 struct page *fscrypt_alloc_bounce_page(gfp_t gfp_flags);
 
 void __printf(3, 4) __cold
@@ -8,6 +8,7 @@
 #include "compress.h"
 #include <linux/prefetch.h>
 #include <linux/psi.h>
+#include <linux/cpuhotplug.h>
 
 #include <trace/events/erofs.h>
 
@@ -186,8 +187,124 @@ typedef tagptr1_t compressed_page_t;
 
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
 
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+static struct kthread_worker __rcu **z_erofs_pcpu_workers;
+
+static void erofs_destroy_percpu_workers(void)
+{
+	struct kthread_worker *worker;
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu) {
+		worker = rcu_dereference_protected(
+					z_erofs_pcpu_workers[cpu], 1);
+		rcu_assign_pointer(z_erofs_pcpu_workers[cpu], NULL);
+		if (worker)
+			kthread_destroy_worker(worker);
+	}
+	kfree(z_erofs_pcpu_workers);
+}
+
+static struct kthread_worker *erofs_init_percpu_worker(int cpu)
+{
+	struct kthread_worker *worker =
+		kthread_create_worker_on_cpu(cpu, 0, "erofs_worker/%u", cpu);
+
+	if (IS_ERR(worker))
+		return worker;
+	if (IS_ENABLED(CONFIG_EROFS_FS_PCPU_KTHREAD_HIPRI))
+		sched_set_fifo_low(worker->task);
+	return worker;
+}
+
+static int erofs_init_percpu_workers(void)
+{
+	struct kthread_worker *worker;
+	unsigned int cpu;
+
+	z_erofs_pcpu_workers = kcalloc(nr_cpu_ids,
+			sizeof(struct kthread_worker *), GFP_ATOMIC);
+	if (!z_erofs_pcpu_workers)
+		return -ENOMEM;
+
+	for_each_online_cpu(cpu) {	/* could miss cpu{off,on}line? */
+		worker = erofs_init_percpu_worker(cpu);
+		if (!IS_ERR(worker))
+			rcu_assign_pointer(z_erofs_pcpu_workers[cpu], worker);
+	}
+	return 0;
+}
+#else
+static inline void erofs_destroy_percpu_workers(void) {}
+static inline int erofs_init_percpu_workers(void) { return 0; }
+#endif
+
+#if defined(CONFIG_HOTPLUG_CPU) && defined(CONFIG_EROFS_FS_PCPU_KTHREAD)
+static DEFINE_SPINLOCK(z_erofs_pcpu_worker_lock);
+static enum cpuhp_state erofs_cpuhp_state;
+
+static int erofs_cpu_online(unsigned int cpu)
+{
+	struct kthread_worker *worker, *old;
+
+	worker = erofs_init_percpu_worker(cpu);
+	if (IS_ERR(worker))
+		return PTR_ERR(worker);
+
+	spin_lock(&z_erofs_pcpu_worker_lock);
+	old = rcu_dereference_protected(z_erofs_pcpu_workers[cpu],
+			lockdep_is_held(&z_erofs_pcpu_worker_lock));
+	if (!old)
+		rcu_assign_pointer(z_erofs_pcpu_workers[cpu], worker);
+	spin_unlock(&z_erofs_pcpu_worker_lock);
+	if (old)
+		kthread_destroy_worker(worker);
+	return 0;
+}
+
+static int erofs_cpu_offline(unsigned int cpu)
+{
+	struct kthread_worker *worker;
+
+	spin_lock(&z_erofs_pcpu_worker_lock);
+	worker = rcu_dereference_protected(z_erofs_pcpu_workers[cpu],
+			lockdep_is_held(&z_erofs_pcpu_worker_lock));
+	rcu_assign_pointer(z_erofs_pcpu_workers[cpu], NULL);
+	spin_unlock(&z_erofs_pcpu_worker_lock);
+
+	synchronize_rcu();
+	if (worker)
+		kthread_destroy_worker(worker);
+	return 0;
+}
+
+static int erofs_cpu_hotplug_init(void)
+{
+	int state;
+
+	state = cpuhp_setup_state_nocalls(CPUHP_AP_ONLINE_DYN,
+			"fs/erofs:online", erofs_cpu_online, erofs_cpu_offline);
+	if (state < 0)
+		return state;
+
+	erofs_cpuhp_state = state;
+	return 0;
+}
+
+static void erofs_cpu_hotplug_destroy(void)
+{
+	if (erofs_cpuhp_state)
+		cpuhp_remove_state_nocalls(erofs_cpuhp_state);
+}
+#else /* !CONFIG_HOTPLUG_CPU || !CONFIG_EROFS_FS_PCPU_KTHREAD */
+static inline int erofs_cpu_hotplug_init(void) { return 0; }
+static inline void erofs_cpu_hotplug_destroy(void) {}
+#endif
+
 void z_erofs_exit_zip_subsystem(void)
 {
+	erofs_cpu_hotplug_destroy();
+	erofs_destroy_percpu_workers();
 	destroy_workqueue(z_erofs_workqueue);
 	z_erofs_destroy_pcluster_pool();
 }
@@ -214,7 +331,23 @@ int __init z_erofs_init_zip_subsystem(void)
 		return err;
 	err = z_erofs_init_workqueue();
 	if (err)
-		z_erofs_destroy_pcluster_pool();
+		goto out_error_workqueue_init;
+
+	err = erofs_init_percpu_workers();
+	if (err)
+		goto out_error_pcpu_worker;
+
+	err = erofs_cpu_hotplug_init();
+	if (err < 0)
+		goto out_error_cpuhp_init;
+	return err;
+
+out_error_cpuhp_init:
+	erofs_destroy_percpu_workers();
+out_error_pcpu_worker:
+	destroy_workqueue(z_erofs_workqueue);
+out_error_workqueue_init:
+	z_erofs_destroy_pcluster_pool();
 	return err;
 }
 
@@ -1118,18 +1251,20 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	return err;
 }
 
-static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
+/* decompress at most @nr pclusters of the chain starting at @owned */
+static void z_erofs_decompress_chain(struct super_block *sb,
+				     z_erofs_next_pcluster_t owned,
+				     unsigned int nr, bool eio,
 				     struct page **pagepool)
 {
 	struct z_erofs_decompress_backend be = {
-		.sb = io->sb,
+		.sb = sb,
 		.pagepool = pagepool,
 		.decompressed_secondary_bvecs =
 			LIST_HEAD_INIT(be.decompressed_secondary_bvecs),
 	};
-	z_erofs_next_pcluster_t owned = io->head;
 
-	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+	while (nr-- && owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
 		/* impossible that 'owned' equals Z_EROFS_WORK_TPTR_TAIL */
 		DBG_BUGON(owned == Z_EROFS_PCLUSTER_TAIL);
 		/* impossible that 'owned' equals Z_EROFS_PCLUSTER_NIL */
@@ -1138,24 +1273,143 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 		be.pcl = container_of(owned, struct z_erofs_pcluster, next);
 		owned = READ_ONCE(be.pcl->next);
 
-		z_erofs_decompress_pcluster(&be, io->eio ? -EIO : 0);
+		z_erofs_decompress_pcluster(&be, eio ? -EIO : 0);
 		erofs_workgroup_put(&be.pcl->obj);
 	}
 }
 
-static void z_erofs_decompressqueue_work(struct work_struct *work)
+static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
+				     struct page **pagepool)
+{
+	z_erofs_decompress_chain(io->sb, io->head, UINT_MAX, io->eio, pagepool);
+}
+
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+#define Z_EROFS_MAX_FANOUT	16
+
+struct z_erofs_decompress_seg {
+	struct kthread_work work;
+	struct super_block *sb;
+	z_erofs_next_pcluster_t head;
+	unsigned int nr;
+	bool eio;
+};
+
+static void z_erofs_decompress_seg_work(struct kthread_work *work)
 {
-	struct z_erofs_decompressqueue *bgq =
-		container_of(work, struct z_erofs_decompressqueue, u.work);
+	struct z_erofs_decompress_seg *seg =
+		container_of(work, struct z_erofs_decompress_seg, work);
 	struct page *pagepool = NULL;
 
+	z_erofs_decompress_chain(seg->sb, seg->head, seg->nr, seg->eio,
+				 &pagepool);
+	erofs_release_pages(&pagepool);
+	kfree(seg);
+}
+
+/*
+ * Split the chain of a background queue into contiguous segments and hand
+ * all but the first one to the workers of other online CPUs, so that large
+ * reads are not decompressed on a single CPU.  Each pcluster still unlocks
+ * its own pages as soon as it is done.  Returns the number of pclusters
+ * left to the caller, counted from @io->head.
+ */
+static unsigned int z_erofs_fanout_queue(const struct z_erofs_decompressqueue *io)
+{
+	struct z_erofs_decompress_seg *segs[Z_EROFS_MAX_FANOUT];
+	z_erofs_next_pcluster_t owned = io->head;
+	unsigned int nr = 0, nsegs, per, i, cpu;
+
+	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+		owned = READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+					       next)->next);
+		++nr;
+	}
+
+	nsegs = min3(nr, num_online_cpus(), (unsigned int)Z_EROFS_MAX_FANOUT);
+	if (nsegs <= 1)
+		return nr;
+	per = DIV_ROUND_UP(nr, nsegs);
+	nsegs = DIV_ROUND_UP(nr, per);
+
+	for (i = 1; i < nsegs; ++i) {
+		segs[i] = kmalloc(sizeof(*segs[i]), GFP_NOIO | __GFP_NOWARN);
+		if (!segs[i]) {
+			while (--i)
+				kfree(segs[i]);
+			return nr;
+		}
+	}
+
+	/* record every segment head before any pcluster gets decompressed */
+	owned = io->head;
+	for (i = 0; i < nr; ++i) {
+		if (i && !(i % per)) {
+			struct z_erofs_decompress_seg *seg = segs[i / per];
+
+			kthread_init_work(&seg->work,
+					  z_erofs_decompress_seg_work);
+			seg->sb = io->sb;
+			seg->head = owned;
+			seg->nr = min(per, nr - i);
+			seg->eio = io->eio;
+		}
+		owned = READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+					       next)->next);
+	}
+
+	cpu = raw_smp_processor_id();
+	for (i = 1; i < nsegs; ++i) {
+		struct kthread_worker *worker;
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+
+		rcu_read_lock();
+		worker = rcu_dereference(z_erofs_pcpu_workers[cpu]);
+		if (worker)
+			kthread_queue_work(worker, &segs[i]->work);
+		rcu_read_unlock();
+		if (!worker)
+			z_erofs_decompress_seg_work(&segs[i]->work);
+	}
+	return per;
+}
+#else
+static unsigned int z_erofs_fanout_queue(const struct z_erofs_decompressqueue *io)
+{
+	return UINT_MAX;
+}
+#endif
+
+static void z_erofs_decompress_bgq(struct z_erofs_decompressqueue *bgq)
+{
+	struct page *pagepool = NULL;
+	unsigned int nr;
+
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
-	z_erofs_decompress_queue(bgq, &pagepool);
+	nr = z_erofs_fanout_queue(bgq);
+	z_erofs_decompress_chain(bgq->sb, bgq->head, nr, bgq->eio, &pagepool);
 
 	erofs_release_pages(&pagepool);
 	kvfree(bgq);
 }
 
+static void z_erofs_decompressqueue_work(struct work_struct *work)
+{
+	z_erofs_decompress_bgq(container_of(work,
+			struct z_erofs_decompressqueue, u.work));
+}
+
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work)
+{
+	z_erofs_decompress_bgq(container_of(work,
+			struct z_erofs_decompressqueue, u.kthread_work));
+}
+#endif
+
 static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 				       bool sync, int bios)
 {
@@ -1172,13 +1426,30 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 		return;
 	/* Use workqueue and sync decompression for atomic contexts only */
 	if (in_atomic() || irqs_disabled()) {
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+		struct kthread_worker *worker;
+
+		rcu_read_lock();
+		worker = rcu_dereference(
+				z_erofs_pcpu_workers[raw_smp_processor_id()]);
+		if (!worker) {
+			INIT_WORK(&io->u.work, z_erofs_decompressqueue_work);
+			queue_work(z_erofs_workqueue, &io->u.work);
+		} else {
+			kthread_init_work(&io->u.kthread_work,
+					  z_erofs_decompressqueue_kthread_work);
+			kthread_queue_work(worker, &io->u.kthread_work);
+		}
+		rcu_read_unlock();
+#else
 		queue_work(z_erofs_workqueue, &io->u.work);
+#endif
 		/* enable sync decompression for readahead */
 		if (sbi->opt.sync_decompress == EROFS_SYNC_DECOMPRESS_AUTO)
 			sbi->opt.sync_decompress = EROFS_SYNC_DECOMPRESS_FORCE_ON;
 		return;
 	}
-	z_erofs_decompressqueue_work(&io->u.work);
+	z_erofs_decompress_bgq(io);
 }
 
 static struct page *pickup_page_for_submission(struct z_erofs_pcluster *pcl,
@@ -8,6 +8,7 @@
 
 #include "internal.h"
 #include "tagptr.h"
+#include <linux/kthread.h>
 
 #define Z_EROFS_PCLUSTER_MAX_PAGES	(Z_EROFS_PCLUSTER_MAX_SIZE / PAGE_SIZE)
 #define Z_EROFS_INLINE_BVECS		2
@@ -108,6 +109,9 @@ struct z_erofs_decompressqueue {
 	union {
 		struct completion done;
 		struct work_struct work;
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+		struct kthread_work kthread_work;
+#endif
 	} u;
 
 	bool eio;
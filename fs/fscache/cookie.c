@@ -503,6 +503,7 @@ static void fscache_prepare_to_write(struct fscache_cookie *cookie)
 static void fscache_perform_lookup(struct fscache_cookie *cookie)
 {
 	enum fscache_access_trace trace = fscache_access_lookup_cookie_end_failed;
+	ktime_t issued = ktime_get();
 	bool need_withdraw = false;
 
 	_enter("");
@@ -516,6 +517,7 @@ static void fscache_perform_lookup(struct fscache_cookie *cookie)
 	}
 
 	if (!cookie->volume->cache->ops->lookup_cookie(cookie)) {
+		fscache_stat_latency(cookie->volume, FSCACHE_LAT_LOOKUP, issued);
 		if (cookie->state != FSCACHE_COOKIE_STATE_FAILED)
 			fscache_set_cookie_state(cookie, FSCACHE_COOKIE_STATE_QUIESCENT);
 		need_withdraw = true;
@@ -523,6 +525,7 @@ static void fscache_perform_lookup(struct fscache_cookie *cookie)
 		goto out;
 	}
 
+	fscache_stat_latency(cookie->volume, FSCACHE_LAT_LOOKUP, issued);
 	fscache_see_cookie(cookie, fscache_cookie_see_active);
 	spin_lock(&cookie->lock);
 	if (test_and_clear_bit(FSCACHE_COOKIE_DO_INVALIDATE, &cookie->flags))
@@ -1066,6 +1069,7 @@ void __fscache_invalidate(struct fscache_cookie *cookie,
 	set_bit(FSCACHE_COOKIE_NO_DATA_TO_READ, &cookie->flags);
 	fscache_update_aux(cookie, aux_data, &new_size);
 	cookie->inval_counter++;
+	fscache_stat(&cookie->volume->stats.n_invalidates);
 	trace_fscache_invalidate(cookie, new_size);
 
 	switch (cookie->state) {
@@ -1112,8 +1116,8 @@ static int fscache_cookies_seq_show(struct seq_file *m, void *v)
 
 	if (v == &fscache_cookies) {
 		seq_puts(m,
-			 "COOKIE   VOLUME   REF ACT ACC S FL DEF             \n"
-			 "======== ======== === === === = == ================\n"
+			 "COOKIE   VOLUME   REF ACT ACC S FL INV DEF             \n"
+			 "======== ======== === === === = == === ================\n"
 			 );
 		return 0;
 	}
@@ -1121,14 +1125,15 @@ static int fscache_cookies_seq_show(struct seq_file *m, void *v)
 	cookie = list_entry(v, struct fscache_cookie, proc_link);
 
 	seq_printf(m,
-		   "%08x %08x %3d %3d %3d %c %02lx",
+		   "%08x %08x %3d %3d %3d %c %02lx %3u",
 		   cookie->debug_id,
 		   cookie->volume->debug_id,
 		   refcount_read(&cookie->ref),
 		   atomic_read(&cookie->n_active),
 		   atomic_read(&cookie->n_accesses),
 		   fscache_cookie_states[cookie->state],
-		   cookie->flags);
+		   cookie->flags,
+		   cookie->inval_counter);
 
 	keylen = cookie->key_len;
 	auxlen = cookie->aux_len;
@@ -128,12 +128,15 @@ static inline void fscache_stat_d(atomic_t *stat)
 
 #define __fscache_stat(stat) (stat)
 
+void fscache_stat_latency(struct fscache_volume *volume,
+			  enum fscache_latency op, ktime_t issued);
 int fscache_stats_show(struct seq_file *m, void *v);
 #else
 
 #define __fscache_stat(stat) (NULL)
 #define fscache_stat(stat) do {} while (0)
 #define fscache_stat_d(stat) do {} while (0)
+#define fscache_stat_latency(volume, op, issued) do {} while (0)
 #endif
 
 /*
@@ -141,6 +144,9 @@ int fscache_stats_show(struct seq_file *m, void *v);
  */
 #ifdef CONFIG_PROC_FS
 extern const struct seq_operations fscache_volumes_seq_ops;
+#ifdef CONFIG_FSCACHE_STATS
+extern const struct seq_operations fscache_volume_stats_seq_ops;
+#endif
 #endif
 
 struct fscache_volume *fscache_get_volume(struct fscache_volume *volume,
@@ -35,6 +35,10 @@ int __init fscache_proc_init(void)
 	if (!proc_create_single("fs/fscache/stats", S_IFREG | 0444, NULL,
 				fscache_stats_show))
 		goto error;
+
+	if (!proc_create_seq("fs/fscache/volume_stats", S_IFREG | 0444, NULL,
+			     &fscache_volume_stats_seq_ops))
+		goto error;
 #endif
 
 	return 0;
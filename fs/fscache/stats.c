@@ -49,6 +49,47 @@ EXPORT_SYMBOL(fscache_n_no_create_space);
 atomic_t fscache_n_culled;
 EXPORT_SYMBOL(fscache_n_culled);
 
+/*
+ * Note how long an operation on a volume took.
+ */
+void fscache_stat_latency(struct fscache_volume *volume,
+			  enum fscache_latency op, ktime_t issued)
+{
+	s64 us = ktime_us_delta(ktime_get(), issued);
+	unsigned int bucket = 0;
+
+	if (us >= 16)
+		bucket = min_t(unsigned int, (ilog2((u64)us) - 4) / 2 + 1,
+			       FSCACHE_LAT_NR_BUCKETS - 1);
+	atomic_inc(&volume->stats.latency[op][bucket]);
+}
+
+/**
+ * fscache_count_io_done - Account a completed cache read or write
+ * @cookie: The cookie the I/O was done for
+ * @op: FSCACHE_LAT_READ or FSCACHE_LAT_WRITE
+ * @issued: When the I/O was issued
+ * @transferred_or_error: The amount of data transferred or an error code
+ *
+ * Add a completed I/O operation to the latency histogram and byte counts of
+ * the volume the cookie belongs to.
+ */
+void fscache_count_io_done(struct fscache_cookie *cookie,
+			   enum fscache_latency op, ktime_t issued,
+			   ssize_t transferred_or_error)
+{
+	struct fscache_volume *volume = cookie->volume;
+
+	fscache_stat_latency(volume, op, issued);
+	if (transferred_or_error <= 0)
+		return;
+	if (op == FSCACHE_LAT_READ)
+		atomic64_add(transferred_or_error, &volume->stats.read_bytes);
+	else
+		atomic64_add(transferred_or_error, &volume->stats.write_bytes);
+}
+EXPORT_SYMBOL(fscache_count_io_done);
+
 /*
  * display the general statistics
  */
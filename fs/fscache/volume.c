@@ -517,4 +517,59 @@ const struct seq_operations fscache_volumes_seq_ops = {
 	.stop   = fscache_volumes_seq_stop,
 	.show   = fscache_volumes_seq_show,
 };
+
+#ifdef CONFIG_FSCACHE_STATS
+/*
+ * Generate per-volume statistics in /proc/fs/fscache/volume_stats.  The hit
+ * ratio is the proportion of data read that was served from the cache rather
+ * than fetched from the server.
+ */
+static int fscache_volume_stats_seq_show(struct seq_file *m, void *v)
+{
+	static const char *const lat_names[FSCACHE_LAT__NR] = {
+		[FSCACHE_LAT_LOOKUP]	= "lkup",
+		[FSCACHE_LAT_READ]	= "read",
+		[FSCACHE_LAT_WRITE]	= "wrte",
+	};
+	struct fscache_volume_stats *stats;
+	struct fscache_volume *volume;
+	u64 rd, dl;
+	int i, j;
+
+	if (v == &fscache_volumes) {
+		seq_puts(m,
+			 "VOLUME   HIT% READ_BYTES   DL_BYTES     WRITE_BYTES  INVAL KEY\n"
+			 "         LAT  <16us <64us <256us <1ms <4ms <16ms <64ms >=64ms\n");
+		return 0;
+	}
+
+	volume = list_entry(v, struct fscache_volume, proc_link);
+	stats = &volume->stats;
+	rd = atomic64_read(&stats->read_bytes);
+	dl = atomic64_read(&stats->download_bytes);
+
+	seq_printf(m, "%08x %4llu %-12llu %-12llu %-12llu %5u %s\n",
+		   volume->debug_id,
+		   rd + dl ? div64_u64(rd * 100, rd + dl) : 0,
+		   rd, dl,
+		   atomic64_read(&stats->write_bytes),
+		   atomic_read(&stats->n_invalidates),
+		   volume->key + 1);
+
+	for (i = 0; i < FSCACHE_LAT__NR; i++) {
+		seq_printf(m, "         %s", lat_names[i]);
+		for (j = 0; j < FSCACHE_LAT_NR_BUCKETS; j++)
+			seq_printf(m, " %u", atomic_read(&stats->latency[i][j]));
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+
+const struct seq_operations fscache_volume_stats_seq_ops = {
+	.start  = fscache_volumes_seq_start,
+	.next   = fscache_volumes_seq_next,
+	.stop   = fscache_volumes_seq_stop,
+	.show   = fscache_volume_stats_seq_show,
+};
+#endif
 #endif /* CONFIG_PROC_FS */
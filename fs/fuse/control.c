@@ -11,6 +11,7 @@
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/fs_context.h>
+#include <linux/seq_file.h>
 
 #define FUSE_CTL_SUPER_MAGIC 0x65735543
 
@@ -184,6 +185,35 @@ static ssize_t fuse_conn_congestion_threshold_write(struct file *file,
 	return ret;
 }
 
+static int fuse_conn_dax_ranges_show(struct seq_file *m, void *v)
+{
+	return fuse_dax_show_ranges(m, m->private);
+}
+
+static int fuse_conn_dax_ranges_open(struct inode *inode, struct file *file)
+{
+	struct fuse_conn *fc = fuse_ctl_file_conn_get(file);
+	int err;
+
+	if (!fc)
+		return -ENOTCONN;
+
+	err = single_open(file, fuse_conn_dax_ranges_show, fc);
+	if (err)
+		fuse_conn_put(fc);
+	return err;
+}
+
+static int fuse_conn_dax_ranges_release(struct inode *inode,
+					struct file *file)
+{
+	struct fuse_conn *fc = ((struct seq_file *)file->private_data)->private;
+
+	single_release(inode, file);
+	fuse_conn_put(fc);
+	return 0;
+}
+
 static const struct file_operations fuse_ctl_abort_ops = {
 	.open = nonseekable_open,
 	.write = fuse_conn_abort_write,
@@ -210,6 +240,13 @@ static const struct file_operations fuse_conn_congestion_threshold_ops = {
 	.llseek = no_llseek,
 };
 
+static const struct file_operations fuse_conn_dax_ranges_ops = {
+	.open = fuse_conn_dax_ranges_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = fuse_conn_dax_ranges_release,
+};
+
 static struct dentry *fuse_ctl_add_dentry(struct dentry *parent,
 					  struct fuse_conn *fc,
 					  const char *name,
@@ -281,6 +318,11 @@ int fuse_ctl_add_conn(struct fuse_conn *fc)
 				 &fuse_conn_congestion_threshold_ops))
 		goto err;
 
+	if (IS_ENABLED(CONFIG_FUSE_DAX) && fc->dax &&
+	    !fuse_ctl_add_dentry(parent, fc, "dax_ranges", S_IFREG | 0400, 1,
+				 NULL, &fuse_conn_dax_ranges_ops))
+		goto err;
+
 	return 0;
 
  err:
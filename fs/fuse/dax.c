@@ -13,6 +13,7 @@
 #include <linux/pfn_t.h>
 #include <linux/iomap.h>
 #include <linux/interval_tree.h>
+#include <linux/seq_file.h>
 
 /*
  * Default memory range size.  A power of 2 so it agrees with common FUSE_INIT
@@ -32,6 +33,13 @@
  */
 #define FUSE_DAX_RECLAIM_THRESHOLD	(20)
 
+/*
+ * Once triggered, the reclaim worker frees ranges until this percentage of
+ * total ranges is free again, so that it runs in batches rather than once
+ * per allocation.
+ */
+#define FUSE_DAX_RECLAIM_TARGET		(30)
+
 /** Translation information for file offsets to DAX window offsets */
 struct fuse_dax_mapping {
 	/* Pointer to inode where this memory range is mapped */
@@ -57,6 +65,15 @@ struct fuse_dax_mapping {
 
 	/* reference count when the mapping is used by dax iomap. */
 	refcount_t refcnt;
+
+	/* Set on use, cleared by the reclaim worker to give a second chance */
+	bool referenced;
+
+	/* Number of iomap lookups served by this range */
+	atomic_long_t hits;
+
+	/* Number of times this range was reclaimed for reuse */
+	unsigned long nr_reclaims;
 };
 
 /* Per-inode dax map */
@@ -67,6 +84,13 @@ struct fuse_inode_dax {
 	/* Sorted rb tree of struct fuse_dax_mapping elements */
 	struct rb_root_cached tree;
 	unsigned long nr;
+
+	/* Sequential access detection and background mapping of next range */
+	struct inode *inode;
+	unsigned long last_idx;
+	unsigned long prefetch_idx;
+	bool prefetch_writable;
+	struct work_struct prefetch_work;
 };
 
 struct fuse_conn_dax {
@@ -91,6 +115,11 @@ struct fuse_conn_dax {
 	struct list_head free_ranges;
 
 	unsigned long nr_ranges;
+
+	/* Statistics */
+	atomic_long_t nr_setups;
+	atomic_long_t nr_prefetched;
+	atomic_long_t nr_reclaimed;
 };
 
 static inline struct fuse_dax_mapping *
@@ -105,14 +134,20 @@ node_to_dmap(struct interval_tree_node *node)
 static struct fuse_dax_mapping *
 alloc_dax_mapping_reclaim(struct fuse_conn_dax *fcd, struct inode *inode);
 
+static unsigned long fuse_dax_free_threshold(struct fuse_conn_dax *fcd,
+					     unsigned int percent)
+{
+	return max_t(unsigned long, fcd->nr_ranges * percent / 100, 1);
+}
+
 static void
 __kick_dmap_free_worker(struct fuse_conn_dax *fcd, unsigned long delay_ms)
 {
 	unsigned long free_threshold;
 
 	/* If number of free ranges are below threshold, start reclaim */
-	free_threshold = max_t(unsigned long, fcd->nr_ranges * FUSE_DAX_RECLAIM_THRESHOLD / 100,
-			     1);
+	free_threshold = fuse_dax_free_threshold(fcd,
+						 FUSE_DAX_RECLAIM_THRESHOLD);
 	if (fcd->nr_free_ranges < free_threshold)
 		queue_delayed_work(system_long_wq, &fcd->free_work,
 				   msecs_to_jiffies(delay_ms));
@@ -219,6 +254,7 @@ static int fuse_setup_one_mapping(struct inode *inode, unsigned long start_idx,
 		 */
 		dmap->inode = inode;
 		dmap->itn.start = dmap->itn.last = start_idx;
+		dmap->referenced = false;
 		/* Protected by fi->dax->sem */
 		interval_tree_insert(&dmap->itn, &fi->dax->tree);
 		fi->dax->nr++;
@@ -381,6 +417,7 @@ void fuse_dax_inode_cleanup(struct inode *inode)
 	 * before we arrive here. So we should not have to worry about any
 	 * pages/exception entries still associated with inode.
 	 */
+	cancel_work_sync(&fi->dax->prefetch_work);
 	inode_reclaim_dmap_range(fc->dax, inode, 0, -1);
 	WARN_ON(fi->dax->nr);
 }
@@ -428,6 +465,74 @@ static void fuse_fill_iomap(struct inode *inode, loff_t pos, loff_t length,
 	}
 }
 
+/*
+ * Only map ahead while there are more free ranges than the reclaim threshold,
+ * so that speculative mappings never push demand allocations into reclaim.
+ */
+static bool fuse_dax_can_prefetch(struct fuse_conn_dax *fcd)
+{
+	return READ_ONCE(fcd->nr_free_ranges) >
+		fuse_dax_free_threshold(fcd, FUSE_DAX_RECLAIM_THRESHOLD);
+}
+
+static void fuse_dax_prefetch_worker(struct work_struct *work)
+{
+	struct fuse_inode_dax *dax = container_of(work, struct fuse_inode_dax,
+						  prefetch_work);
+	struct inode *inode = dax->inode;
+	struct fuse_conn_dax *fcd = get_fuse_conn(inode)->dax;
+	unsigned long idx = READ_ONCE(dax->prefetch_idx);
+	bool writable = READ_ONCE(dax->prefetch_writable);
+	struct fuse_dax_mapping *dmap;
+
+	/* Keep truncation away while setting up the mapping */
+	inode_lock_shared(inode);
+	if (((loff_t)idx << FUSE_DAX_SHIFT) >= i_size_read(inode) ||
+	    !fuse_dax_can_prefetch(fcd))
+		goto out;
+
+	dmap = alloc_dax_mapping(fcd);
+	if (!dmap)
+		goto out;
+
+	down_write(&dax->sem);
+	if (interval_tree_iter_first(&dax->tree, idx, idx) ||
+	    fuse_setup_one_mapping(inode, idx, dmap, writable, false) < 0)
+		dmap_add_to_free_pool(fcd, dmap);
+	else
+		atomic_long_inc(&fcd->nr_prefetched);
+	up_write(&dax->sem);
+out:
+	inode_unlock_shared(inode);
+}
+
+/*
+ * If the range at @idx continues a sequential stream, set up the mapping for
+ * the next range in the background so that the following access does not
+ * have to wait for FUSE_SETUPMAPPING.  Caller holds fi->dax->sem.
+ */
+static void fuse_dax_maybe_prefetch(struct inode *inode, unsigned long idx,
+				    bool writable)
+{
+	struct fuse_inode_dax *dax = get_fuse_inode(inode)->dax;
+	unsigned long last = READ_ONCE(dax->last_idx);
+
+	if (last == idx)
+		return;
+	WRITE_ONCE(dax->last_idx, idx);
+	if (idx != last + 1)
+		return;
+
+	if (((loff_t)(idx + 1) << FUSE_DAX_SHIFT) >= i_size_read(inode) ||
+	    interval_tree_iter_first(&dax->tree, idx + 1, idx + 1) ||
+	    !fuse_dax_can_prefetch(get_fuse_conn(inode)->dax))
+		return;
+
+	WRITE_ONCE(dax->prefetch_idx, idx + 1);
+	WRITE_ONCE(dax->prefetch_writable, writable);
+	queue_work(system_unbound_wq, &dax->prefetch_work);
+}
+
 static int fuse_setup_new_dax_mapping(struct inode *inode, loff_t pos,
 				      loff_t length, unsigned int flags,
 				      struct iomap *iomap)
@@ -491,7 +596,10 @@ static int fuse_setup_new_dax_mapping(struct inode *inode, loff_t pos,
 		up_write(&fi->dax->sem);
 		return ret;
 	}
+	atomic_long_inc(&fcd->nr_setups);
+	alloc_dmap->referenced = true;
 	fuse_fill_iomap(inode, pos, length, iomap, alloc_dmap, flags);
+	fuse_dax_maybe_prefetch(inode, start_idx, writable);
 	up_write(&fi->dax->sem);
 	return 0;
 }
@@ -606,7 +714,10 @@ static int fuse_iomap_begin(struct inode *inode, loff_t pos, loff_t length,
 			return fuse_upgrade_dax_mapping(inode, pos, length,
 							flags, iomap);
 		} else {
+			WRITE_ONCE(dmap->referenced, true);
+			atomic_long_inc(&dmap->hits);
 			fuse_fill_iomap(inode, pos, length, iomap, dmap, flags);
+			fuse_dax_maybe_prefetch(inode, start_idx, writable);
 			up_read(&fi->dax->sem);
 			return 0;
 		}
@@ -905,6 +1016,8 @@ static int reclaim_one_dmap_locked(struct inode *inode,
 	/* Remove dax mapping from inode interval tree now */
 	interval_tree_remove(&dmap->itn, &fi->dax->tree);
 	fi->dax->nr--;
+	dmap->nr_reclaims++;
+	atomic_long_inc(&get_fuse_conn(inode)->dax->nr_reclaimed);
 
 	/* It is possible that umount/shutdown has killed the fuse connection
 	 * and worker thread is trying to reclaim memory in parallel.  Don't
@@ -918,13 +1031,14 @@ static int reclaim_one_dmap_locked(struct inode *inode,
 	return 0;
 }
 
-/* Find first mapped dmap for an inode and return file offset. Caller needs
- * to hold fi->dax->sem lock either shared or exclusive.
+/* Find first mapped dmap for an inode and return file offset. Prefer a
+ * range that was not used since the reclaim worker last looked at it.
+ * Caller needs to hold fi->dax->sem lock either shared or exclusive.
  */
 static struct fuse_dax_mapping *inode_lookup_first_dmap(struct inode *inode)
 {
 	struct fuse_inode *fi = get_fuse_inode(inode);
-	struct fuse_dax_mapping *dmap;
+	struct fuse_dax_mapping *dmap, *first = NULL;
 	struct interval_tree_node *node;
 
 	for (node = interval_tree_iter_first(&fi->dax->tree, 0, -1); node;
@@ -934,10 +1048,13 @@ static struct fuse_dax_mapping *inode_lookup_first_dmap(struct inode *inode)
 		if (refcount_read(&dmap->refcnt) > 1)
 			continue;
 
-		return dmap;
+		if (!READ_ONCE(dmap->referenced))
+			return dmap;
+		if (!first)
+			first = dmap;
 	}
 
-	return NULL;
+	return first;
 }
 
 /*
@@ -1160,6 +1277,18 @@ static int try_to_free_dmap_chunks(struct fuse_conn_dax *fcd,
 			if (refcount_read(&pos->refcnt) > 1)
 				continue;
 
+			/*
+			 * Used since we last looked: clear the bit and move it
+			 * to the tail, so that ranges are reclaimed roughly in
+			 * LRU order instead of the order they were set up in.
+			 */
+			if (READ_ONCE(pos->referenced)) {
+				WRITE_ONCE(pos->referenced, false);
+				list_move_tail(&pos->busy_list,
+					       &fcd->busy_ranges);
+				continue;
+			}
+
 			inode = igrab(pos->inode);
 			/*
 			 * This inode is going away. That will free
@@ -1196,7 +1325,16 @@ static void fuse_dax_free_mem_worker(struct work_struct *work)
 	int ret;
 	struct fuse_conn_dax *fcd = container_of(work, struct fuse_conn_dax,
 						 free_work.work);
-	ret = try_to_free_dmap_chunks(fcd, FUSE_DAX_RECLAIM_CHUNK);
+	unsigned long target, nr_to_free = FUSE_DAX_RECLAIM_CHUNK;
+
+	/* Free up to the reclaim target in one go */
+	target = fuse_dax_free_threshold(fcd, FUSE_DAX_RECLAIM_TARGET);
+	spin_lock(&fcd->lock);
+	if (fcd->nr_free_ranges >= 0 && target > fcd->nr_free_ranges)
+		nr_to_free = max(nr_to_free, target - fcd->nr_free_ranges);
+	spin_unlock(&fcd->lock);
+
+	ret = try_to_free_dmap_chunks(fcd, nr_to_free);
 	if (ret) {
 		pr_debug("fuse: try_to_free_dmap_chunks() failed with err=%d\n",
 			 ret);
@@ -1267,6 +1405,7 @@ static int fuse_dax_mem_range_init(struct fuse_conn_dax *fcd)
 		range->length = FUSE_DAX_SZ;
 		INIT_LIST_HEAD(&range->busy_list);
 		refcount_set(&range->refcnt, 1);
+		atomic_long_set(&range->hits, 0);
 		list_add_tail(&range->list, &fcd->free_ranges);
 	}
 
@@ -1318,6 +1457,9 @@ bool fuse_dax_inode_alloc(struct super_block *sb, struct fuse_inode *fi)
 
 		init_rwsem(&fi->dax->sem);
 		fi->dax->tree = RB_ROOT_CACHED;
+		fi->dax->inode = &fi->inode;
+		fi->dax->last_idx = ULONG_MAX;
+		INIT_WORK(&fi->dax->prefetch_work, fuse_dax_prefetch_worker);
 	}
 
 	return true;
@@ -1379,6 +1521,48 @@ bool fuse_dax_check_alignment(struct fuse_conn *fc, unsigned int map_alignment)
 	return true;
 }
 
+static void fuse_dax_show_range(struct seq_file *m,
+				struct fuse_dax_mapping *dmap)
+{
+	seq_printf(m, "0x%llx ", dmap->window_offset);
+	if (dmap->inode)
+		seq_printf(m, "%llu 0x%llx ",
+			   get_fuse_inode(dmap->inode)->nodeid,
+			   (u64)dmap->itn.start << FUSE_DAX_SHIFT);
+	else
+		seq_puts(m, "- - ");
+	seq_printf(m, "%ld %lu\n", atomic_long_read(&dmap->hits),
+		   dmap->nr_reclaims);
+}
+
+/*
+ * Dump DAX window usage: totals first, then one line per range with its
+ * window offset, owning node and file offset (if mapped), hits and reclaims.
+ */
+int fuse_dax_show_ranges(struct seq_file *m, struct fuse_conn *fc)
+{
+	struct fuse_conn_dax *fcd = fc->dax;
+	struct fuse_dax_mapping *dmap;
+
+	if (!fcd)
+		return 0;
+
+	spin_lock(&fcd->lock);
+	seq_printf(m, "ranges: %lu\nfree: %ld\nbusy: %lu\n",
+		   fcd->nr_ranges, fcd->nr_free_ranges, fcd->nr_busy_ranges);
+	seq_printf(m, "setups: %ld\nprefetched: %ld\nreclaimed: %ld\n",
+		   atomic_long_read(&fcd->nr_setups),
+		   atomic_long_read(&fcd->nr_prefetched),
+		   atomic_long_read(&fcd->nr_reclaimed));
+	list_for_each_entry(dmap, &fcd->busy_ranges, busy_list)
+		fuse_dax_show_range(m, dmap);
+	list_for_each_entry(dmap, &fcd->free_ranges, list)
+		fuse_dax_show_range(m, dmap);
+	spin_unlock(&fcd->lock);
+
+	return 0;
+}
+
 void fuse_dax_cancel_work(struct fuse_conn *fc)
 {
 	struct fuse_conn_dax *fcd = fc->dax;
@@ -194,8 +194,8 @@ EXPORT_SYMBOL_GPL(fuse_len_args);
 
 u64 fuse_get_unique(struct fuse_iqueue *fiq)
 {
-	fiq->reqctr += FUSE_REQ_ID_STEP;
-	return fiq->reqctr;
+	/* Atomic, so that per-CPU queueing can do without fiq->lock */
+	return atomic64_add_return(FUSE_REQ_ID_STEP, &fiq->reqctr);
 }
 EXPORT_SYMBOL_GPL(fuse_get_unique);
 
@@ -222,17 +222,86 @@ const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
 };
 EXPORT_SYMBOL_GPL(fuse_dev_fiq_ops);
 
-static void queue_request_and_unlock(struct fuse_iqueue *fiq,
-				     struct fuse_req *req)
-__releases(fiq->lock)
+static void fuse_req_set_in_len(struct fuse_req *req)
 {
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		fuse_len_args(req->args->in_numargs,
 			      (struct fuse_arg *) req->args->in_args);
+}
+
+static void queue_request_and_unlock(struct fuse_iqueue *fiq,
+				     struct fuse_req *req)
+__releases(fiq->lock)
+{
+	fuse_req_set_in_len(req);
 	list_add_tail(&req->list, &fiq->pending);
 	fiq->ops->wake_pending_and_unlock(fiq);
 }
 
+/*
+ * Queue a new request on the per-CPU queue of the submitting CPU, if any
+ * device is bound to it.  Returns false if the request has to go through
+ * fiq->pending instead.
+ */
+static bool fuse_cpu_queue_request(struct fuse_iqueue *fiq,
+				   struct fuse_req *req)
+{
+	struct fuse_cpu_queue __percpu *queues;
+	struct fuse_cpu_queue *cq;
+
+	/* Pairs with smp_store_release() in fuse_dev_bind_cpu() */
+	queues = smp_load_acquire(&fiq->cpu_queues);
+	if (!queues)
+		return false;
+
+	cq = raw_cpu_ptr(queues);
+	if (!READ_ONCE(cq->nr_readers))
+		return false;
+
+	spin_lock(&cq->lock);
+	if (!cq->connected || !cq->nr_readers) {
+		spin_unlock(&cq->lock);
+		return false;
+	}
+	req->in.h.unique = fuse_get_unique(fiq);
+	fuse_req_set_in_len(req);
+	req->cpu_queue = cq;
+	list_add_tail(&req->list, &cq->pending);
+	spin_unlock(&cq->lock);
+
+	wake_up(&cq->waitq);
+	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+	return true;
+}
+
+/*
+ * Take a request that the daemon has not read yet off its input queue.
+ * req->cpu_queue only ever changes from a queue to NULL, with both that
+ * queue's lock and fiq->lock held, see fuse_cpu_queue_unbind().
+ */
+static bool fuse_remove_pending(struct fuse_iqueue *fiq, struct fuse_req *req)
+{
+	struct fuse_cpu_queue *cq;
+	spinlock_t *lock;
+	bool pending;
+
+	for (;;) {
+		cq = READ_ONCE(req->cpu_queue);
+		lock = cq ? &cq->lock : &fiq->lock;
+		spin_lock(lock);
+		if (READ_ONCE(req->cpu_queue) == cq)
+			break;
+		spin_unlock(lock);
+	}
+
+	pending = test_bit(FR_PENDING, &req->flags);
+	if (pending)
+		list_del(&req->list);
+	spin_unlock(lock);
+
+	return pending;
+}
+
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 		       u64 nodeid, u64 nlookup)
 {
@@ -263,6 +332,8 @@ static void flush_bg_queue(struct fuse_conn *fc)
 		req = list_first_entry(&fc->bg_queue, struct fuse_req, list);
 		list_del(&req->list);
 		fc->active_background++;
+		if (fuse_cpu_queue_request(fiq, req))
+			continue;
 		spin_lock(&fiq->lock);
 		req->in.h.unique = fuse_get_unique(fiq);
 		queue_request_and_unlock(fiq, req);
@@ -388,16 +459,12 @@ static void request_wait_answer(struct fuse_req *req)
 		if (!err)
 			return;
 
-		spin_lock(&fiq->lock);
 		/* Request is not yet in userspace, bail out */
-		if (test_bit(FR_PENDING, &req->flags)) {
-			list_del(&req->list);
-			spin_unlock(&fiq->lock);
+		if (fuse_remove_pending(fiq, req)) {
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
 			return;
 		}
-		spin_unlock(&fiq->lock);
 	}
 
 	/*
@@ -412,21 +479,24 @@ static void __fuse_request_send(struct fuse_req *req)
 	struct fuse_iqueue *fiq = &req->fm->fc->iq;
 
 	BUG_ON(test_bit(FR_BACKGROUND, &req->flags));
-	spin_lock(&fiq->lock);
-	if (!fiq->connected) {
-		spin_unlock(&fiq->lock);
-		req->out.h.error = -ENOTCONN;
-	} else {
+	/* acquire extra reference, since request is still needed
+	   after fuse_request_end() */
+	__fuse_get_request(req);
+	if (!fuse_cpu_queue_request(fiq, req)) {
+		spin_lock(&fiq->lock);
+		if (!fiq->connected) {
+			spin_unlock(&fiq->lock);
+			__fuse_put_request(req);
+			req->out.h.error = -ENOTCONN;
+			return;
+		}
 		req->in.h.unique = fuse_get_unique(fiq);
-		/* acquire extra reference, since request is still needed
-		   after fuse_request_end() */
-		__fuse_get_request(req);
 		queue_request_and_unlock(fiq, req);
-
-		request_wait_answer(req);
-		/* Pairs with smp_wmb() in fuse_request_end() */
-		smp_rmb();
 	}
+
+	request_wait_answer(req);
+	/* Pairs with smp_wmb() in fuse_request_end() */
+	smp_rmb();
 }
 
 static void fuse_adjust_compat(struct fuse_conn *fc, struct fuse_args *args)
@@ -1190,6 +1260,68 @@ __releases(fiq->lock)
 		return fuse_read_batch_forget(fiq, cs, nbytes);
 }
 
+/*
+ * Wait for a request on either the per-CPU queue a device is bound to or
+ * the shared input queue, which still carries interrupts, forgets and
+ * requests submitted on CPUs without bound devices.
+ */
+static int fuse_cpu_queue_wait(struct fuse_iqueue *fiq,
+			       struct fuse_cpu_queue *cq)
+{
+	struct wait_queue_entry cq_wait, fiq_wait;
+	int err = 0;
+
+	init_waitqueue_entry(&cq_wait, current);
+	init_waitqueue_entry(&fiq_wait, current);
+	add_wait_queue_exclusive(&cq->waitq, &cq_wait);
+	add_wait_queue_exclusive(&fiq->waitq, &fiq_wait);
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!list_empty_careful(&cq->pending) || !fiq->connected ||
+		    request_pending(fiq))
+			break;
+		if (signal_pending(current)) {
+			err = -ERESTARTSYS;
+			break;
+		}
+		schedule();
+	}
+	__set_current_state(TASK_RUNNING);
+	remove_wait_queue(&fiq->waitq, &fiq_wait);
+	remove_wait_queue(&cq->waitq, &cq_wait);
+
+	return err;
+}
+
+/*
+ * Take the first request off the per-CPU queue a device is bound to.
+ */
+static struct fuse_req *fuse_cpu_queue_dequeue(struct fuse_iqueue *fiq,
+					       struct fuse_cpu_queue *cq)
+{
+	struct fuse_req *req;
+
+	if (list_empty_careful(&cq->pending))
+		return NULL;
+
+	spin_lock(&cq->lock);
+	req = list_first_entry_or_null(&cq->pending, struct fuse_req, list);
+	if (req) {
+		clear_bit(FR_PENDING, &req->flags);
+		list_del_init(&req->list);
+	}
+	spin_unlock(&cq->lock);
+
+	/*
+	 * A wakeup on fiq->waitq may have been consumed by this reader, hand
+	 * it on if shared work is still pending.
+	 */
+	if (req && request_pending(fiq))
+		wake_up(&fiq->waitq);
+
+	return req;
+}
+
 /*
  * Read a single request into the userspace filesystem's buffer.  This
  * function waits until a request is available, then removes it from
@@ -1206,6 +1338,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	struct fuse_conn *fc = fud->fc;
 	struct fuse_iqueue *fiq = &fc->iq;
 	struct fuse_pqueue *fpq = &fud->pq;
+	struct fuse_cpu_queue *cq = READ_ONCE(fud->cpu_queue);
 	struct fuse_req *req;
 	struct fuse_args *args;
 	unsigned reqsize;
@@ -1231,6 +1364,12 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 
  restart:
 	for (;;) {
+		if (cq) {
+			req = fuse_cpu_queue_dequeue(fiq, cq);
+			if (req)
+				goto have_req;
+		}
+
 		spin_lock(&fiq->lock);
 		if (!fiq->connected || request_pending(fiq))
 			break;
@@ -1238,7 +1377,10 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 
 		if (file->f_flags & O_NONBLOCK)
 			return -EAGAIN;
-		err = wait_event_interruptible_exclusive(fiq->waitq,
+		if (cq)
+			err = fuse_cpu_queue_wait(fiq, cq);
+		else
+			err = wait_event_interruptible_exclusive(fiq->waitq,
 				!fiq->connected || request_pending(fiq));
 		if (err)
 			return err;
@@ -1268,6 +1410,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	list_del_init(&req->list);
 	spin_unlock(&fiq->lock);
 
+ have_req:
 	args = req->args;
 	reqsize = req->in.h.len;
 
@@ -1653,7 +1796,7 @@ static void fuse_retrieve_end(struct fuse_mount *fm, struct fuse_args *args,
 		container_of(args, typeof(*ra), ap.args);
 
 	release_pages(ra->ap.pages, ra->ap.num_pages);
-	kfree(ra);
+	kvfree(ra);
 }
 
 static int fuse_retrieve(struct fuse_mount *fm, struct inode *inode,
@@ -1687,7 +1830,7 @@ static int fuse_retrieve(struct fuse_mount *fm, struct inode *inode,
 
 	args_size += num_pages * (sizeof(ap->pages[0]) + sizeof(ap->descs[0]));
 
-	ra = kzalloc(args_size, GFP_KERNEL);
+	ra = kvzalloc(args_size, GFP_KERNEL);
 	if (!ra)
 		return -ENOMEM;
 
@@ -2056,24 +2199,80 @@ static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
 	struct fuse_iqueue *fiq;
+	struct fuse_cpu_queue *cq;
 	struct fuse_dev *fud = fuse_get_dev(file);
 
 	if (!fud)
 		return EPOLLERR;
 
 	fiq = &fud->fc->iq;
+	cq = READ_ONCE(fud->cpu_queue);
 	poll_wait(file, &fiq->waitq, wait);
+	if (cq)
+		poll_wait(file, &cq->waitq, wait);
 
 	spin_lock(&fiq->lock);
 	if (!fiq->connected)
 		mask = EPOLLERR;
-	else if (request_pending(fiq))
+	else if (request_pending(fiq) ||
+		 (cq && !list_empty_careful(&cq->pending)))
 		mask |= EPOLLIN | EPOLLRDNORM;
 	spin_unlock(&fiq->lock);
 
 	return mask;
 }
 
+/*
+ * Disconnect the per-CPU queues and move their pending requests to @to_end.
+ * Called with fiq->lock held.
+ */
+static void fuse_cpu_queues_abort(struct fuse_iqueue *fiq,
+				  struct list_head *to_end)
+{
+	struct fuse_req *req;
+	int cpu;
+
+	if (!fiq->cpu_queues)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct fuse_cpu_queue *cq = per_cpu_ptr(fiq->cpu_queues, cpu);
+
+		spin_lock(&cq->lock);
+		cq->connected = 0;
+		list_for_each_entry(req, &cq->pending, list)
+			clear_bit(FR_PENDING, &req->flags);
+		list_splice_tail_init(&cq->pending, to_end);
+		spin_unlock(&cq->lock);
+		wake_up_all(&cq->waitq);
+	}
+}
+
+/*
+ * Drop a device from the per-CPU queue it is bound to.  Requests left on a
+ * queue that lost its last reader are moved to fiq->pending, so that the
+ * remaining devices pick them up.
+ */
+static void fuse_cpu_queue_unbind(struct fuse_iqueue *fiq,
+				  struct fuse_cpu_queue *cq)
+{
+	struct fuse_req *req;
+	bool moved = false;
+
+	spin_lock(&fiq->lock);
+	spin_lock(&cq->lock);
+	if (!--cq->nr_readers && !list_empty(&cq->pending)) {
+		list_for_each_entry(req, &cq->pending, list)
+			WRITE_ONCE(req->cpu_queue, NULL);
+		list_splice_tail_init(&cq->pending, &fiq->pending);
+		moved = true;
+	}
+	spin_unlock(&cq->lock);
+	if (moved)
+		wake_up_all(&fiq->waitq);
+	spin_unlock(&fiq->lock);
+}
+
 /* Abort all requests on the given list (pending or processing) */
 static void end_requests(struct list_head *head)
 {
@@ -2169,6 +2368,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		list_for_each_entry(req, &fiq->pending, list)
 			clear_bit(FR_PENDING, &req->flags);
 		list_splice_tail_init(&fiq->pending, &to_end);
+		fuse_cpu_queues_abort(fiq, &to_end);
 		while (forget_pending(fiq))
 			kfree(fuse_dequeue_forget(fiq, 1, NULL));
 		wake_up_all(&fiq->waitq);
@@ -2202,6 +2402,9 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 		LIST_HEAD(to_end);
 		unsigned int i;
 
+		if (fud->cpu_queue)
+			fuse_cpu_queue_unbind(&fc->iq, fud->cpu_queue);
+
 		spin_lock(&fpq->lock);
 		WARN_ON(!list_empty(&fpq->io));
 		for (i = 0; i < FUSE_PQ_HASH_SIZE; i++)
@@ -2249,11 +2452,73 @@ static int fuse_device_clone(struct fuse_conn *fc, struct file *new)
 	return 0;
 }
 
+static int fuse_dev_bind_cpu(struct fuse_dev *fud, u32 cpu)
+{
+	struct fuse_iqueue *fiq = &fud->fc->iq;
+	struct fuse_cpu_queue __percpu *queues;
+	struct fuse_cpu_queue *cq;
+	int i, res = 0;
+
+	if (fiq->ops != &fuse_dev_fiq_ops)
+		return -EOPNOTSUPP;
+
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -EINVAL;
+
+	mutex_lock(&fuse_mutex);
+	if (fud->cpu_queue) {
+		res = -EBUSY;
+		goto out;
+	}
+
+	queues = fiq->cpu_queues;
+	if (!queues) {
+		queues = alloc_percpu(struct fuse_cpu_queue);
+		if (!queues) {
+			res = -ENOMEM;
+			goto out;
+		}
+		for_each_possible_cpu(i) {
+			cq = per_cpu_ptr(queues, i);
+			spin_lock_init(&cq->lock);
+			cq->connected = 1;
+			init_waitqueue_head(&cq->waitq);
+			INIT_LIST_HEAD(&cq->pending);
+		}
+
+		/* fuse_abort_conn() only flushes queues it can see */
+		spin_lock(&fiq->lock);
+		if (!fiq->connected) {
+			spin_unlock(&fiq->lock);
+			free_percpu(queues);
+			res = -ENOTCONN;
+			goto out;
+		}
+		/* Pairs with smp_load_acquire() in fuse_cpu_queue_request() */
+		smp_store_release(&fiq->cpu_queues, queues);
+		spin_unlock(&fiq->lock);
+	}
+
+	cq = per_cpu_ptr(queues, cpu);
+	spin_lock(&cq->lock);
+	if (cq->connected) {
+		cq->nr_readers++;
+		WRITE_ONCE(fud->cpu_queue, cq);
+	} else {
+		res = -ENOTCONN;
+	}
+	spin_unlock(&cq->lock);
+out:
+	mutex_unlock(&fuse_mutex);
+	return res;
+}
+
 static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			   unsigned long arg)
 {
 	int res;
 	int oldfd;
+	u32 cpu;
 	struct fuse_dev *fud = NULL;
 
 	switch (cmd) {
@@ -2280,6 +2545,13 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 			}
 		}
 		break;
+	case FUSE_DEV_IOC_BIND_CPU:
+		res = -EFAULT;
+		if (!get_user(cpu, (__u32 __user *)arg)) {
+			fud = fuse_get_dev(file);
+			res = fud ? fuse_dev_bind_cpu(fud, cpu) : -EPERM;
+		}
+		break;
 	default:
 		res = -ENOTTY;
 		break;
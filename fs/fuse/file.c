@@ -722,7 +722,7 @@ static struct fuse_io_args *fuse_io_alloc(struct fuse_io_priv *io,
 
 static void fuse_io_free(struct fuse_io_args *ia)
 {
-	kfree(ia->ap.pages);
+	kvfree(ia->ap.pages);
 	kfree(ia);
 }
 
@@ -1285,7 +1285,7 @@ static ssize_t fuse_perform_write(struct kiocb *iocb,
 					err = -EIO;
 			}
 		}
-		kfree(ap->pages);
+		kvfree(ap->pages);
 	} while (!err && iov_iter_count(ii));
 
 	fuse_write_update_attr(inode, pos, res);
@@ -1672,7 +1672,7 @@ static void fuse_writepage_free(struct fuse_writepage_args *wpa)
 	if (wpa->ia.ff)
 		fuse_file_put(wpa->ia.ff, false, false);
 
-	kfree(ap->pages);
+	kvfree(ap->pages);
 	kfree(wpa);
 }
 
@@ -2068,7 +2068,7 @@ static bool fuse_pages_realloc(struct fuse_fill_wb_data *data)
 
 	memcpy(pages, ap->pages, sizeof(struct page *) * ap->num_pages);
 	memcpy(descs, ap->descs, sizeof(struct fuse_page_desc) * ap->num_pages);
-	kfree(ap->pages);
+	kvfree(ap->pages);
 	ap->pages = pages;
 	ap->descs = descs;
 	data->max_pages = npages;
@@ -2298,9 +2298,9 @@ static int fuse_writepages(struct address_space *mapping,
 	data.ff = NULL;
 
 	err = -ENOMEM;
-	data.orig_pages = kcalloc(fc->max_pages,
-				  sizeof(struct page *),
-				  GFP_NOFS);
+	data.orig_pages = kvcalloc(fc->max_pages,
+				   sizeof(struct page *),
+				   GFP_NOFS);
 	if (!data.orig_pages)
 		goto out;
 
@@ -2312,7 +2312,7 @@ static int fuse_writepages(struct address_space *mapping,
 	if (data.ff)
 		fuse_file_put(data.ff, false, false);
 
-	kfree(data.orig_pages);
+	kvfree(data.orig_pages);
 out:
 	return err;
 }
@@ -35,8 +35,11 @@
 /** Default max number of pages that can be used in a single read request */
 #define FUSE_DEFAULT_MAX_PAGES_PER_REQ 32
 
+/** Default limit on max_pages received in init_out */
+#define FUSE_DEFAULT_MAX_PAGES_LIMIT 256
+
 /** Maximum of max_pages received in init_out */
-#define FUSE_MAX_MAX_PAGES 256
+#define FUSE_MAX_MAX_PAGES 65535
 
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
@@ -45,7 +48,7 @@
 #define FUSE_NAME_MAX 1024
 
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 6
 
 /** List of active connections */
 extern struct list_head fuse_conn_list;
@@ -216,6 +219,9 @@ struct fuse_file {
 		/* Version of cache we are reading */
 		u64 version;
 
+		/* Bypassing the cache to prefetch attributes */
+		bool plus;
+
 	} readdir;
 
 	/** RB node to be linked on fuse_conn->polled_files */
@@ -367,6 +373,10 @@ struct fuse_req {
 	/** Used to wake up the task waiting for completion of request*/
 	wait_queue_head_t waitq;
 
+	/** Per-CPU input queue holding the request while it is pending, or
+	    NULL if it is on fiq->pending */
+	struct fuse_cpu_queue *cpu_queue;
+
 #if IS_ENABLED(CONFIG_VIRTIO_FS)
 	/** virtio-fs's physically contiguous buffer for in and out args */
 	void *argbuf;
@@ -414,6 +424,31 @@ struct fuse_iqueue_ops {
 /** /dev/fuse input queue operations */
 extern const struct fuse_iqueue_ops fuse_dev_fiq_ops;
 
+/**
+ * Per-CPU input queue
+ *
+ * Devices bound to a CPU with FUSE_DEV_IOC_BIND_CPU read from the queue of
+ * that CPU.  Regular requests submitted on a CPU with bound devices are put
+ * here instead of on fiq->pending, so that submitters and readers on
+ * different CPUs do not contend on fiq->lock.
+ */
+struct fuse_cpu_queue {
+	/** Lock protecting accesses to members of this structure */
+	spinlock_t lock;
+
+	/** Connection established */
+	unsigned connected;
+
+	/** Number of devices bound to this queue */
+	unsigned nr_readers;
+
+	/** Readers bound to this queue are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** The list of pending requests */
+	struct list_head pending;
+};
+
 struct fuse_iqueue {
 	/** Connection established */
 	unsigned connected;
@@ -425,7 +460,7 @@ struct fuse_iqueue {
 	wait_queue_head_t waitq;
 
 	/** The next unique request id */
-	u64 reqctr;
+	atomic64_t reqctr;
 
 	/** The list of pending requests */
 	struct list_head pending;
@@ -448,6 +483,9 @@ struct fuse_iqueue {
 
 	/** Device-specific state */
 	void *priv;
+
+	/** Per-CPU input queues, allocated on the first FUSE_DEV_IOC_BIND_CPU */
+	struct fuse_cpu_queue __percpu *cpu_queues;
 };
 
 #define FUSE_PQ_HASH_BITS 8
@@ -479,6 +517,9 @@ struct fuse_dev {
 
 	/** list entry on fc->devices */
 	struct list_head entry;
+
+	/** Per-CPU input queue this device is bound to, if any */
+	struct fuse_cpu_queue *cpu_queue;
 };
 
 enum fuse_dax_mode {
@@ -922,8 +963,8 @@ static inline struct page **fuse_pages_alloc(unsigned int npages, gfp_t flags,
 {
 	struct page **pages;
 
-	pages = kzalloc(npages * (sizeof(struct page *) +
-				  sizeof(struct fuse_page_desc)), flags);
+	pages = kvzalloc(npages * (sizeof(struct page *) +
+				   sizeof(struct fuse_page_desc)), flags);
 	*desc = (void *) (pages + npages);
 
 	return pages;
@@ -1303,6 +1344,7 @@ void fuse_dax_inode_cleanup(struct inode *inode);
 void fuse_dax_dontcache(struct inode *inode, unsigned int flags);
 bool fuse_dax_check_alignment(struct fuse_conn *fc, unsigned int map_alignment);
 void fuse_dax_cancel_work(struct fuse_conn *fc);
+int fuse_dax_show_ranges(struct seq_file *m, struct fuse_conn *fc);
 
 /* ioctl.c */
 long fuse_file_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
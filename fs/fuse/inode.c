@@ -51,6 +51,20 @@ MODULE_PARM_DESC(max_user_congthresh,
  "Global limit for the maximum congestion threshold an "
  "unprivileged user can set");
 
+static unsigned int fuse_max_pages_limit = FUSE_DEFAULT_MAX_PAGES_LIMIT;
+
+static int set_max_pages_limit(const char *val, const struct kernel_param *kp)
+{
+	return param_set_uint_minmax(val, kp, 1, FUSE_MAX_MAX_PAGES);
+}
+
+module_param_call(max_pages_limit, set_max_pages_limit, param_get_uint,
+		  &fuse_max_pages_limit, 0644);
+__MODULE_PARM_TYPE(max_pages_limit, "uint");
+MODULE_PARM_DESC(max_pages_limit,
+ "Upper bound for the number of pages per request a server can request "
+ "with FUSE_MAX_PAGES");
+
 #define FUSE_DEFAULT_BLKSIZE 512
 
 /** Maximum number of outstanding background requests */
@@ -853,7 +867,7 @@ void fuse_conn_init(struct fuse_conn *fc, struct fuse_mount *fm,
 	fc->pid_ns = get_pid_ns(task_active_pid_ns(current));
 	fc->user_ns = get_user_ns(user_ns);
 	fc->max_pages = FUSE_DEFAULT_MAX_PAGES_PER_REQ;
-	fc->max_pages_limit = FUSE_MAX_MAX_PAGES;
+	fc->max_pages_limit = READ_ONCE(fuse_max_pages_limit);
 
 	INIT_LIST_HEAD(&fc->mounts);
 	list_add(&fm->fc_entry, &fc->mounts);
@@ -871,6 +885,7 @@ void fuse_conn_put(struct fuse_conn *fc)
 			fuse_dax_conn_free(fc);
 		if (fiq->ops->release)
 			fiq->ops->release(fiq);
+		free_percpu(fiq->cpu_queues);
 		put_pid_ns(fc->pid_ns);
 		put_user_ns(fc->user_ns);
 		bucket = rcu_dereference_protected(fc->curr_bucket, 1);
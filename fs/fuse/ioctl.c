@@ -335,7 +335,7 @@ long fuse_do_ioctl(struct file *file, unsigned int cmd, unsigned long arg,
 	free_page((unsigned long) iov_page);
 	while (ap.num_pages)
 		__free_page(ap.pages[--ap.num_pages]);
-	kfree(ap.pages);
+	kvfree(ap.pages);
 
 	return err ? err : outarg.result;
 }
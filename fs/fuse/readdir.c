@@ -13,14 +13,16 @@
 #include <linux/pagemap.h>
 #include <linux/highmem.h>
 
-static bool fuse_use_readdirplus(struct inode *dir, struct dir_context *ctx)
+static bool fuse_use_readdirplus(struct file *file, struct dir_context *ctx)
 {
+	struct fuse_file *ff = file->private_data;
+	struct inode *dir = file_inode(file);
 	struct fuse_conn *fc = get_fuse_conn(dir);
 	struct fuse_inode *fi = get_fuse_inode(dir);
 
 	if (!fc->do_readdirplus)
 		return false;
-	if (!fc->readdirplus_auto)
+	if (!fc->readdirplus_auto || ff->readdir.plus)
 		return true;
 	if (test_and_clear_bit(FUSE_I_ADVISE_RDPLUS, &fi->state))
 		return true;
@@ -336,7 +338,7 @@ static int fuse_readdir_uncached(struct file *file, struct dir_context *ctx)
 	if (!page)
 		return -ENOMEM;
 
-	plus = fuse_use_readdirplus(inode, ctx);
+	plus = fuse_use_readdirplus(file, ctx);
 	ap->args.out_pages = true;
 	ap->num_pages = 1;
 	ap->pages = &page;
@@ -445,6 +447,15 @@ static int fuse_readdir_cached(struct file *file, struct dir_context *ctx)
 	struct page *page;
 	void *addr;
 
+	/*
+	 * Stream was diverted to READDIRPLUS to refresh attributes; keep going
+	 * uncached until the next rewind.
+	 */
+	if (!ctx->pos)
+		ff->readdir.plus = false;
+	else if (ff->readdir.plus)
+		return UNCACHED;
+
 	/* Seeked?  If so, reset the cache stream */
 	if (ff->readdir.pos != ctx->pos) {
 		ff->readdir.pos = 0;
@@ -485,6 +496,19 @@ static int fuse_readdir_cached(struct file *file, struct dir_context *ctx)
 			fuse_rdc_reset(inode);
 			goto retry_locked;
 		}
+		/*
+		 * Cached entries carry no attributes.  If lookups were needed
+		 * since the directory was last read with READDIRPLUS, then the
+		 * caller is likely to stat every entry: fetch the listing with
+		 * READDIRPLUS instead, so that the dentries and attributes are
+		 * populated in bulk rather than with one LOOKUP per entry.
+		 */
+		if (fc->do_readdirplus &&
+		    test_and_clear_bit(FUSE_I_ADVISE_RDPLUS, &fi->state)) {
+			ff->readdir.plus = true;
+			spin_unlock(&fi->rdc.lock);
+			return UNCACHED;
+		}
 	}
 
 	/*
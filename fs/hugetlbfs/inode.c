@@ -38,6 +38,7 @@
 
 #include <linux/uaccess.h>
 #include <linux/sched/mm.h>
+#include <linux/workqueue.h>
 
 static const struct address_space_operations hugetlbfs_aops;
 const struct file_operations hugetlbfs_file_operations;
@@ -766,6 +767,85 @@ static long hugetlbfs_punch_hole(struct inode *inode, loff_t offset, loff_t len)
 	return 0;
 }
 
+/* Most huge pages zeroed at the same time by fallocate */
+/* Bounded by the locks lockdep lets a task hold, as each takes a mutex */
+#define HUGETLBFS_FALLOC_BATCH	32
+
+struct hugetlbfs_falloc_page {
+	struct work_struct work;
+	struct page *page;
+	unsigned long addr;
+	pgoff_t index;
+	unsigned int nr_pages;
+	u32 hash;
+	bool locked;	/* this entry took hugetlb_fault_mutex_table[hash] */
+};
+
+static void hugetlbfs_falloc_clear(struct work_struct *work)
+{
+	struct hugetlbfs_falloc_page *fp =
+		container_of(work, struct hugetlbfs_falloc_page, work);
+
+	clear_huge_page(fp->page, fp->addr, fp->nr_pages);
+}
+
+/*
+ * Add the pages of a batch to the page cache once they are zeroed, then
+ * drop the fault mutexes that the batch holds.  Returns the first error.
+ */
+static int hugetlbfs_falloc_add(struct hstate *h,
+				struct vm_area_struct *pseudo_vma,
+				struct hugetlbfs_falloc_page *batch,
+				unsigned int nr)
+{
+	struct address_space *mapping = pseudo_vma->vm_file->f_mapping;
+	struct hugetlbfs_falloc_page *fp;
+	int ret, error = 0;
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		fp = &batch[i];
+		flush_work(&fp->work);
+
+		__SetPageUptodate(fp->page);
+		ret = hugetlb_add_to_page_cache(fp->page, mapping, fp->index);
+		if (unlikely(ret)) {
+			restore_reserve_on_error(h, pseudo_vma, fp->addr,
+						 fp->page);
+			put_page(fp->page);
+			if (!error)
+				error = ret;
+			continue;
+		}
+
+		SetHPageMigratable(fp->page);
+		/*
+		 * unlock_page because locked by hugetlb_add_to_page_cache()
+		 * put_page() due to reference from alloc_huge_page()
+		 */
+		unlock_page(fp->page);
+		put_page(fp->page);
+	}
+
+	for (i = 0; i < nr; i++)
+		if (batch[i].locked)
+			mutex_unlock(&hugetlb_fault_mutex_table[batch[i].hash]);
+
+	return error;
+}
+
+/* Whether an earlier entry of the batch already holds fault mutex @hash */
+static bool hugetlbfs_falloc_held(struct hugetlbfs_falloc_page *batch,
+				  unsigned int nr, u32 hash)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		if (batch[i].locked && batch[i].hash == hash)
+			return true;
+	return false;
+}
+
 static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
 				loff_t len)
 {
@@ -777,8 +857,10 @@ static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
 	struct mm_struct *mm = current->mm;
 	loff_t hpage_size = huge_page_size(h);
 	unsigned long hpage_shift = huge_page_shift(h);
+	struct hugetlbfs_falloc_page *batch;
+	unsigned int nr, nr_batch;
 	pgoff_t start, index, end;
-	int error;
+	int err, error;
 	u32 hash;
 
 	if (mode & ~(FALLOC_FL_KEEP_SIZE | FALLOC_FL_PUNCH_HOLE))
@@ -816,79 +898,115 @@ static long hugetlbfs_fallocate(struct file *file, int mode, loff_t offset,
 	pseudo_vma.vm_flags = (VM_HUGETLB | VM_MAYSHARE | VM_SHARED);
 	pseudo_vma.vm_file = file;
 
-	for (index = start; index < end; index++) {
-		/*
-		 * This is supposed to be the vaddr where the page is being
-		 * faulted in, but we have no vaddr here.
-		 */
-		struct page *page;
-		unsigned long addr;
+	/*
+	 * Zeroing the pages takes most of the time, so allocate a batch of
+	 * them and zero them in parallel, each on its own node.  The fault
+	 * mutex of each index is held until its page is in the page cache, so
+	 * a fault on it waits rather than allocating a page of its own.  Only
+	 * the first mutex of a batch is waited for; when a later one is busy
+	 * the batch ends there, so two tasks filling batches cannot deadlock.
+	 * Indices whose hashes collide share the mutex taken for the first.
+	 */
+	nr_batch = clamp_t(unsigned int, num_online_cpus(), 1,
+			   HUGETLBFS_FALLOC_BATCH);
+	nr_batch = min_t(unsigned long, nr_batch, end - start);
+	batch = kmalloc_array(nr_batch, sizeof(*batch), GFP_KERNEL);
+	if (!batch) {
+		error = -ENOMEM;
+		goto out;
+	}
 
-		cond_resched();
+	for (index = start; index < end && !error; ) {
+		for (nr = 0; index < end && nr < nr_batch; index++) {
+			/*
+			 * This is supposed to be the vaddr where the page is
+			 * being faulted in, but we have no vaddr here.
+			 */
+			struct page *page;
+			unsigned long addr;
+			bool locked;
 
-		/*
-		 * fallocate(2) manpage permits EINTR; we may have been
-		 * interrupted because we are using up too much memory.
-		 */
-		if (signal_pending(current)) {
-			error = -EINTR;
-			break;
-		}
+			cond_resched();
 
-		/* Set numa allocation policy based on index */
-		hugetlb_set_vma_policy(&pseudo_vma, inode, index);
+			/*
+			 * fallocate(2) manpage permits EINTR; we may have been
+			 * interrupted because we are using up too much memory.
+			 */
+			if (signal_pending(current)) {
+				error = -EINTR;
+				break;
+			}
 
-		/* addr is the offset within the file (zero based) */
-		addr = index * hpage_size;
+			/* Set numa allocation policy based on index */
+			hugetlb_set_vma_policy(&pseudo_vma, inode, index);
 
-		/* mutex taken here, fault path and hole punch */
-		hash = hugetlb_fault_mutex_hash(mapping, index);
-		mutex_lock(&hugetlb_fault_mutex_table[hash]);
+			/* addr is the offset within the file (zero based) */
+			addr = index * hpage_size;
 
-		/* See if already present in mapping to avoid alloc/free */
-		page = find_get_page(mapping, index);
-		if (page) {
-			put_page(page);
-			mutex_unlock(&hugetlb_fault_mutex_table[hash]);
+			/* mutex taken here, fault path and hole punch */
+			hash = hugetlb_fault_mutex_hash(mapping, index);
+			locked = !hugetlbfs_falloc_held(batch, nr, hash);
+			if (locked) {
+				if (!nr) {
+					mutex_lock(&hugetlb_fault_mutex_table[hash]);
+				} else if (!mutex_trylock(&hugetlb_fault_mutex_table[hash])) {
+					hugetlb_drop_vma_policy(&pseudo_vma);
+					break;
+				}
+			}
+
+			/* See if already present in mapping to avoid alloc/free */
+			page = find_get_page(mapping, index);
+			if (page) {
+				put_page(page);
+				if (locked)
+					mutex_unlock(&hugetlb_fault_mutex_table[hash]);
+				hugetlb_drop_vma_policy(&pseudo_vma);
+				continue;
+			}
+
+			/*
+			 * Allocate page without setting the avoid_reserve
+			 * argument.  There certainly are no reserves associated
+			 * with the pseudo_vma.  However, there could be shared
+			 * mappings with reserves for the file at the inode
+			 * level.  If we fallocate pages in these areas, we need
+			 * to consume the reserves to keep reservation
+			 * accounting consistent.
+			 */
+			page = alloc_huge_page(&pseudo_vma, addr, 0);
 			hugetlb_drop_vma_policy(&pseudo_vma);
-			continue;
-		}
+			if (IS_ERR(page)) {
+				if (locked)
+					mutex_unlock(&hugetlb_fault_mutex_table[hash]);
+				error = PTR_ERR(page);
+				break;
+			}
 
-		/*
-		 * Allocate page without setting the avoid_reserve argument.
-		 * There certainly are no reserves associated with the
-		 * pseudo_vma.  However, there could be shared mappings with
-		 * reserves for the file at the inode level.  If we fallocate
-		 * pages in these areas, we need to consume the reserves
-		 * to keep reservation accounting consistent.
-		 */
-		page = alloc_huge_page(&pseudo_vma, addr, 0);
-		hugetlb_drop_vma_policy(&pseudo_vma);
-		if (IS_ERR(page)) {
-			mutex_unlock(&hugetlb_fault_mutex_table[hash]);
-			error = PTR_ERR(page);
-			goto out;
-		}
-		clear_huge_page(page, addr, pages_per_huge_page(h));
-		__SetPageUptodate(page);
-		error = hugetlb_add_to_page_cache(page, mapping, index);
-		if (unlikely(error)) {
-			restore_reserve_on_error(h, &pseudo_vma, addr, page);
-			put_page(page);
-			mutex_unlock(&hugetlb_fault_mutex_table[hash]);
-			goto out;
+			batch[nr] = (struct hugetlbfs_falloc_page) {
+				.page = page,
+				.addr = addr,
+				.index = index,
+				.nr_pages = pages_per_huge_page(h),
+				.hash = hash,
+				.locked = locked,
+			};
+			INIT_WORK(&batch[nr].work, hugetlbfs_falloc_clear);
+			queue_work_node(page_to_nid(page), system_unbound_wq,
+					&batch[nr].work);
+			nr++;
 		}
 
-		mutex_unlock(&hugetlb_fault_mutex_table[hash]);
-
-		SetHPageMigratable(page);
-		/*
-		 * unlock_page because locked by hugetlb_add_to_page_cache()
-		 * put_page() due to reference from alloc_huge_page()
-		 */
-		unlock_page(page);
-		put_page(page);
+		/* The pages allocated before an error are still added */
+		err = hugetlbfs_falloc_add(h, &pseudo_vma, batch, nr);
+		if (err && !error)
+			error = err;
 	}
+	kfree(batch);
+
+	/* An interrupted fallocate still sets the size for what it did */
+	if (error && error != -EINTR)
+		goto out;
 
 	if (!(mode & FALLOC_FL_KEEP_SIZE) && offset + len > inode->i_size)
 		i_size_write(inode, offset + len);
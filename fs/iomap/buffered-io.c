@@ -23,15 +23,26 @@
 
 #define IOEND_BATCH_SIZE	4096
 
+/* Largest folio the buffered write path will allocate, as for readahead */
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#define IOMAP_MAX_FOLIO_ORDER	HPAGE_PMD_ORDER
+#else
+#define IOMAP_MAX_FOLIO_ORDER	8
+#endif
+
 /*
  * Structure allocated for each folio when block size < folio size
- * to track sub-folio uptodate status and I/O completions.
+ * to track sub-folio uptodate and dirty status and I/O completions.
+ *
+ * @state holds a bit per block for uptodate status, followed by a bit per
+ * block for dirty status, so that writeback only has to write the blocks of
+ * a large folio that were actually dirtied.
  */
 struct iomap_page {
 	atomic_t		read_bytes_pending;
 	atomic_t		write_bytes_pending;
-	spinlock_t		uptodate_lock;
-	unsigned long		uptodate[];
+	spinlock_t		state_lock;
+	unsigned long		state[];
 };
 
 static inline struct iomap_page *to_iomap_page(struct folio *folio)
@@ -58,12 +69,14 @@ iomap_page_create(struct inode *inode, struct folio *folio, unsigned int flags)
 	else
 		gfp = GFP_NOFS | __GFP_NOFAIL;
 
-	iop = kzalloc(struct_size(iop, uptodate, BITS_TO_LONGS(nr_blocks)),
+	iop = kzalloc(struct_size(iop, state, BITS_TO_LONGS(2 * nr_blocks)),
 		      gfp);
 	if (iop) {
-		spin_lock_init(&iop->uptodate_lock);
+		spin_lock_init(&iop->state_lock);
 		if (folio_test_uptodate(folio))
-			bitmap_fill(iop->uptodate, nr_blocks);
+			bitmap_set(iop->state, 0, nr_blocks);
+		if (folio_test_dirty(folio))
+			bitmap_set(iop->state, nr_blocks, nr_blocks);
 		folio_attach_private(folio, iop);
 	}
 	return iop;
@@ -79,7 +92,7 @@ static void iomap_page_release(struct folio *folio)
 		return;
 	WARN_ON_ONCE(atomic_read(&iop->read_bytes_pending));
 	WARN_ON_ONCE(atomic_read(&iop->write_bytes_pending));
-	WARN_ON_ONCE(bitmap_full(iop->uptodate, nr_blocks) !=
+	WARN_ON_ONCE(bitmap_full(iop->state, nr_blocks) !=
 			folio_test_uptodate(folio));
 	kfree(iop);
 }
@@ -110,7 +123,7 @@ static void iomap_adjust_read_range(struct inode *inode, struct folio *folio,
 
 		/* move forward for each leading block marked uptodate */
 		for (i = first; i <= last; i++) {
-			if (!test_bit(i, iop->uptodate))
+			if (!test_bit(i, iop->state))
 				break;
 			*pos += block_size;
 			poff += block_size;
@@ -120,7 +133,7 @@ static void iomap_adjust_read_range(struct inode *inode, struct folio *folio,
 
 		/* truncate len if we find any trailing uptodate block(s) */
 		for ( ; i <= last; i++) {
-			if (test_bit(i, iop->uptodate)) {
+			if (test_bit(i, iop->state)) {
 				plen -= (last - i + 1) * block_size;
 				last = i - 1;
 				break;
@@ -152,11 +165,11 @@ static void iomap_iop_set_range_uptodate(struct folio *folio,
 	unsigned last = (off + len - 1) >> inode->i_blkbits;
 	unsigned long flags;
 
-	spin_lock_irqsave(&iop->uptodate_lock, flags);
-	bitmap_set(iop->uptodate, first, last - first + 1);
-	if (bitmap_full(iop->uptodate, i_blocks_per_folio(inode, folio)))
+	spin_lock_irqsave(&iop->state_lock, flags);
+	bitmap_set(iop->state, first, last - first + 1);
+	if (bitmap_full(iop->state, i_blocks_per_folio(inode, folio)))
 		folio_mark_uptodate(folio);
-	spin_unlock_irqrestore(&iop->uptodate_lock, flags);
+	spin_unlock_irqrestore(&iop->state_lock, flags);
 }
 
 static void iomap_set_range_uptodate(struct folio *folio,
@@ -168,6 +181,61 @@ static void iomap_set_range_uptodate(struct folio *folio,
 		folio_mark_uptodate(folio);
 }
 
+static inline bool iomap_iop_is_block_dirty(struct folio *folio,
+		struct iomap_page *iop, unsigned int block)
+{
+	struct inode *inode = folio->mapping->host;
+
+	return test_bit(block + i_blocks_per_folio(inode, folio), iop->state);
+}
+
+static void iomap_iop_update_range_dirty(struct folio *folio,
+		struct iomap_page *iop, size_t off, size_t len, bool dirty)
+{
+	struct inode *inode = folio->mapping->host;
+	unsigned int nr_blocks = i_blocks_per_folio(inode, folio);
+	unsigned first = off >> inode->i_blkbits;
+	unsigned last = (off + len - 1) >> inode->i_blkbits;
+	unsigned long flags;
+
+	spin_lock_irqsave(&iop->state_lock, flags);
+	if (dirty)
+		bitmap_set(iop->state, nr_blocks + first, last - first + 1);
+	else
+		bitmap_clear(iop->state, nr_blocks + first, last - first + 1);
+	spin_unlock_irqrestore(&iop->state_lock, flags);
+}
+
+static void iomap_set_range_dirty(struct folio *folio,
+		struct iomap_page *iop, size_t off, size_t len)
+{
+	if (iop && len)
+		iomap_iop_update_range_dirty(folio, iop, off, len, true);
+}
+
+static void iomap_clear_range_dirty(struct folio *folio,
+		struct iomap_page *iop, size_t off, size_t len)
+{
+	if (iop && len)
+		iomap_iop_update_range_dirty(folio, iop, off, len, false);
+}
+
+/**
+ * iomap_dirty_folio - mark a whole folio dirty
+ * @mapping: the mapping the folio belongs to
+ * @folio: the folio to dirty
+ *
+ * For use as ->dirty_folio by filesystems using the iomap buffered write
+ * path; it keeps the per-block dirty state in step with the folio's.
+ */
+bool iomap_dirty_folio(struct address_space *mapping, struct folio *folio)
+{
+	iomap_set_range_dirty(folio, to_iomap_page(folio), 0,
+			      folio_size(folio));
+	return filemap_dirty_folio(mapping, folio);
+}
+EXPORT_SYMBOL_GPL(iomap_dirty_folio);
+
 static void iomap_finish_folio_read(struct folio *folio, size_t offset,
 		size_t len, int error)
 {
@@ -451,7 +519,7 @@ bool iomap_is_partially_uptodate(struct folio *folio, size_t from, size_t count)
 	last = (from + count - 1) >> inode->i_blkbits;
 
 	for (i = first; i <= last; i++)
-		if (!test_bit(i, iop->uptodate))
+		if (!test_bit(i, iop->state))
 			return false;
 	return true;
 }
@@ -584,18 +652,85 @@ static int iomap_write_begin_inline(const struct iomap_iter *iter,
 	return iomap_read_inline_data(iter, folio);
 }
 
+/*
+ * Create a locked folio covering as much of the write as the alignment of @pos
+ * allows, so that large writes don't go through the page cache a page at a
+ * time.  Returns NULL if we should just fall back to __filemap_get_folio().
+ */
+static struct folio *iomap_create_large_folio(struct iomap_iter *iter,
+		loff_t pos, size_t len, unsigned fgp)
+{
+	struct address_space *mapping = iter->inode->i_mapping;
+	pgoff_t index = pos >> PAGE_SHIFT;
+	gfp_t gfp = mapping_gfp_mask(mapping);
+	unsigned int order;
+	struct folio *folio;
+	int err;
+
+	order = min_t(unsigned int, IOMAP_MAX_FOLIO_ORDER,
+		      ilog2((offset_in_page(pos) + len) >> PAGE_SHIFT));
+	/* The folio must be naturally aligned in the file. */
+	if (index)
+		order = min_t(unsigned int, order, __ffs(index));
+
+	if (mapping_can_writeback(mapping))
+		gfp |= __GFP_WRITE;
+	if (fgp & FGP_NOFS)
+		gfp &= ~__GFP_FS;
+	if (fgp & FGP_NOWAIT) {
+		gfp &= ~GFP_KERNEL;
+		gfp |= GFP_NOWAIT;
+	}
+	gfp |= __GFP_NORETRY | __GFP_NOWARN;
+
+	/* The THP machinery doesn't support order-1 folios. */
+	for (; order > 1; order--) {
+		folio = filemap_alloc_folio(gfp, order);
+		if (!folio)
+			continue;
+		err = filemap_add_folio(mapping, folio, index, gfp);
+		if (!err)
+			return folio;
+		folio_put(folio);
+		/* Someone else added a folio here; go and look it up. */
+		if (err == -EEXIST)
+			break;
+	}
+	return NULL;
+}
+
+static struct folio *iomap_get_folio(struct iomap_iter *iter, loff_t pos,
+		size_t len)
+{
+	struct address_space *mapping = iter->inode->i_mapping;
+	unsigned fgp = FGP_LOCK | FGP_WRITE | FGP_CREAT | FGP_STABLE | FGP_NOFS;
+	gfp_t gfp = mapping_gfp_mask(mapping);
+	struct folio *folio;
+
+	if (iter->flags & IOMAP_NOWAIT)
+		fgp |= FGP_NOWAIT;
+
+	/* Only large folio mappings get asked for more than a page. */
+	if (len >= 4 * PAGE_SIZE) {
+		folio = __filemap_get_folio(mapping, pos >> PAGE_SHIFT,
+					    fgp & ~FGP_CREAT, gfp);
+		if (folio)
+			return folio;
+		folio = iomap_create_large_folio(iter, pos, len, fgp);
+		if (folio)
+			return folio;
+	}
+	return __filemap_get_folio(mapping, pos >> PAGE_SHIFT, fgp, gfp);
+}
+
 static int iomap_write_begin(struct iomap_iter *iter, loff_t pos,
 		size_t len, struct folio **foliop)
 {
 	const struct iomap_page_ops *page_ops = iter->iomap.page_ops;
 	const struct iomap *srcmap = iomap_iter_srcmap(iter);
 	struct folio *folio;
-	unsigned fgp = FGP_LOCK | FGP_WRITE | FGP_CREAT | FGP_STABLE | FGP_NOFS;
 	int status = 0;
 
-	if (iter->flags & IOMAP_NOWAIT)
-		fgp |= FGP_NOWAIT;
-
 	BUG_ON(pos + len > iter->iomap.offset + iter->iomap.length);
 	if (srcmap != &iter->iomap)
 		BUG_ON(pos + len > srcmap->offset + srcmap->length);
@@ -612,8 +747,7 @@ static int iomap_write_begin(struct iomap_iter *iter, loff_t pos,
 			return status;
 	}
 
-	folio = __filemap_get_folio(iter->inode->i_mapping, pos >> PAGE_SHIFT,
-			fgp, mapping_gfp_mask(iter->inode->i_mapping));
+	folio = iomap_get_folio(iter, pos, len);
 	if (!folio) {
 		status = (iter->flags & IOMAP_NOWAIT) ? -EAGAIN : -ENOMEM;
 		goto out_no_page;
@@ -686,6 +820,7 @@ static size_t __iomap_write_end(struct inode *inode, loff_t pos, size_t len,
 	if (unlikely(copied < len && !folio_test_uptodate(folio)))
 		return 0;
 	iomap_set_range_uptodate(folio, iop, offset_in_folio(folio, pos), len);
+	iomap_set_range_dirty(folio, iop, offset_in_folio(folio, pos), copied);
 	filemap_dirty_folio(inode->i_mapping, folio);
 	return copied;
 }
@@ -748,6 +883,30 @@ static size_t iomap_write_end(struct iomap_iter *iter, loff_t pos, size_t len,
 	return ret;
 }
 
+/*
+ * Copy user data into a folio, which may span several pages.  Returns the
+ * number of bytes copied, which is short if we faulted partway through.
+ */
+static size_t iomap_copy_from_iter(struct folio *folio, size_t offset,
+		size_t bytes, struct iov_iter *i)
+{
+	size_t copied = 0;
+
+	do {
+		struct page *page = folio_page(folio, offset >> PAGE_SHIFT);
+		size_t poff = offset_in_page(offset);
+		size_t n = min_t(size_t, bytes - copied, PAGE_SIZE - poff);
+		size_t ret = copy_page_from_iter_atomic(page, poff, n, i);
+
+		copied += ret;
+		offset += ret;
+		if (ret < n)
+			break;
+	} while (copied < bytes);
+
+	return copied;
+}
+
 static loff_t iomap_write_iter(struct iomap_iter *iter, struct iov_iter *i)
 {
 	loff_t length = iomap_length(iter);
@@ -756,17 +915,17 @@ static loff_t iomap_write_iter(struct iomap_iter *iter, struct iov_iter *i)
 	long status = 0;
 	struct address_space *mapping = iter->inode->i_mapping;
 	unsigned int bdp_flags = (iter->flags & IOMAP_NOWAIT) ? BDP_ASYNC : 0;
+	size_t chunk = mapping_large_folio_support(mapping) ?
+			PAGE_SIZE << IOMAP_MAX_FOLIO_ORDER : PAGE_SIZE;
 
 	do {
 		struct folio *folio;
-		struct page *page;
-		unsigned long offset;	/* Offset into pagecache page */
-		unsigned long bytes;	/* Bytes to write to page */
+		size_t offset;		/* Offset into folio */
+		size_t bytes;		/* Bytes to write to folio */
 		size_t copied;		/* Bytes copied from user */
 
-		offset = offset_in_page(pos);
-		bytes = min_t(unsigned long, PAGE_SIZE - offset,
-						iov_iter_count(i));
+		offset = pos & (chunk - 1);
+		bytes = min(chunk - offset, iov_iter_count(i));
 again:
 		status = balance_dirty_pages_ratelimited_flags(mapping,
 							       bdp_flags);
@@ -797,11 +956,15 @@ static loff_t iomap_write_iter(struct iomap_iter *iter, struct iov_iter *i)
 		if (iter->iomap.flags & IOMAP_F_STALE)
 			break;
 
-		page = folio_file_page(folio, pos >> PAGE_SHIFT);
+		/* A whole run of pages may have been given to us at once. */
+		offset = offset_in_folio(folio, pos);
+		if (bytes > folio_size(folio) - offset)
+			bytes = folio_size(folio) - offset;
+
 		if (mapping_writably_mapped(mapping))
-			flush_dcache_page(page);
+			flush_dcache_folio(folio);
 
-		copied = copy_page_from_iter_atomic(page, offset, bytes, i);
+		copied = iomap_copy_from_iter(folio, offset, bytes, i);
 
 		status = iomap_write_end(iter, pos, bytes, copied, folio);
 
@@ -816,9 +979,14 @@ static loff_t iomap_write_iter(struct iomap_iter *iter, struct iov_iter *i)
 			 * halfway through, might be a race with munmap,
 			 * might be severe memory pressure.
 			 */
-			if (copied)
+			if (chunk > PAGE_SIZE)
+				chunk /= 2;
+			if (copied) {
 				bytes = copied;
-			goto again;
+				goto again;
+			}
+			/* Size the next attempt from the smaller chunk. */
+			continue;
 		}
 		pos += status;
 		written += status;
@@ -872,12 +1040,46 @@ EXPORT_SYMBOL_GPL(iomap_file_buffered_write);
  * This function uses [start_byte, end_byte) intervals (i.e. open ended) to
  * simplify range iterations.
  */
+/*
+ * With per-block dirty tracking, a dirty folio can contain blocks that are
+ * uptodate but not dirty.  Any delalloc reservation behind those must be
+ * punched out too, or it would be leaked.
+ */
+static int iomap_write_delalloc_iop_punch(struct inode *inode,
+		struct folio *folio, loff_t start_byte, loff_t end_byte,
+		int (*punch)(struct inode *inode, loff_t offset, loff_t length))
+{
+	struct iomap_page *iop = to_iomap_page(folio);
+	unsigned int blkbits = inode->i_blkbits;
+	unsigned int first_blk, last_blk, i;
+	loff_t last_byte;
+	int error;
+
+	if (!iop)
+		return 0;
+
+	last_byte = min_t(loff_t, end_byte - 1,
+			folio_pos(folio) + folio_size(folio) - 1);
+	first_blk = offset_in_folio(folio, start_byte) >> blkbits;
+	last_blk = offset_in_folio(folio, last_byte) >> blkbits;
+	for (i = first_blk; i <= last_blk; i++) {
+		if (iomap_iop_is_block_dirty(folio, iop, i))
+			continue;
+		error = punch(inode, folio_pos(folio) + (i << blkbits),
+				1 << blkbits);
+		if (error)
+			return error;
+	}
+	return 0;
+}
+
 static int iomap_write_delalloc_scan(struct inode *inode,
 		loff_t *punch_start_byte, loff_t start_byte, loff_t end_byte,
 		int (*punch)(struct inode *inode, loff_t offset, loff_t length))
 {
 	while (start_byte < end_byte) {
 		struct folio	*folio;
+		int		error;
 
 		/* grab locked page */
 		folio = filemap_lock_folio(inode->i_mapping,
@@ -891,8 +1093,6 @@ static int iomap_write_delalloc_scan(struct inode *inode,
 		/* if dirty, punch up to offset */
 		if (folio_test_dirty(folio)) {
 			if (start_byte > *punch_start_byte) {
-				int	error;
-
 				error = punch(inode, *punch_start_byte,
 						start_byte - *punch_start_byte);
 				if (error) {
@@ -902,6 +1102,14 @@ static int iomap_write_delalloc_scan(struct inode *inode,
 				}
 			}
 
+			error = iomap_write_delalloc_iop_punch(inode, folio,
+					start_byte, end_byte, punch);
+			if (error) {
+				folio_unlock(folio);
+				folio_put(folio);
+				return error;
+			}
+
 			/*
 			 * Make sure the next punch start is correctly bound to
 			 * the end of this data range, not the end of the folio.
@@ -1231,6 +1439,8 @@ static loff_t iomap_folio_mkwrite_iter(struct iomap_iter *iter,
 		block_commit_write(&folio->page, 0, length);
 	} else {
 		WARN_ON_ONCE(!folio_test_uptodate(folio));
+		iomap_set_range_dirty(folio, to_iomap_page(folio),
+				offset_in_folio(folio, iter->pos), length);
 		folio_mark_dirty(folio);
 	}
 
@@ -1590,7 +1800,7 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 		struct writeback_control *wbc, struct inode *inode,
 		struct folio *folio, u64 end_pos)
 {
-	struct iomap_page *iop = iomap_page_create(inode, folio, 0);
+	struct iomap_page *iop = to_iomap_page(folio);
 	struct iomap_ioend *ioend, *next;
 	unsigned len = i_blocksize(inode);
 	unsigned nblocks = i_blocks_per_folio(inode, folio);
@@ -1598,6 +1808,15 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	int error = 0, count = 0, i;
 	LIST_HEAD(submit_list);
 
+	/*
+	 * A folio without block state was dirtied as a whole, so all of its
+	 * blocks need writing back.
+	 */
+	if (!iop) {
+		iop = iomap_page_create(inode, folio, 0);
+		iomap_set_range_dirty(folio, iop, 0, folio_size(folio));
+	}
+
 	WARN_ON_ONCE(iop && atomic_read(&iop->write_bytes_pending) != 0);
 
 	/*
@@ -1606,7 +1825,8 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	 * invalid, grab a new one.
 	 */
 	for (i = 0; i < nblocks && pos < end_pos; i++, pos += len) {
-		if (iop && !test_bit(i, iop->uptodate))
+		if (iop && (!test_bit(i, iop->state) ||
+			    !iomap_iop_is_block_dirty(folio, iop, i)))
 			continue;
 
 		error = wpc->ops->map_blocks(wpc, inode, pos);
@@ -1624,6 +1844,13 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	if (count)
 		wpc->ioend->io_folios++;
 
+	/*
+	 * page_mkwrite can dirty blocks past EOF in the last partial folio, so
+	 * clear the dirty state of the whole folio rather than just what we
+	 * looked at.
+	 */
+	iomap_clear_range_dirty(folio, iop, 0, folio_size(folio));
+
 	WARN_ON_ONCE(!wpc->ioend && !list_empty(&submit_list));
 	WARN_ON_ONCE(!folio_test_locked(folio));
 	WARN_ON_ONCE(folio_test_writeback(folio));
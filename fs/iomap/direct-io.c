@@ -20,6 +20,7 @@
  * Private flags for iomap_dio, must not overlap with the public ones in
  * iomap.h:
  */
+#define IOMAP_DIO_INLINE_COMP	(1 << 27)
 #define IOMAP_DIO_WRITE_FUA	(1 << 28)
 #define IOMAP_DIO_NEED_SYNC	(1 << 29)
 #define IOMAP_DIO_WRITE		(1 << 30)
@@ -154,6 +155,21 @@ static inline void iomap_dio_set_error(struct iomap_dio *dio, int ret)
 	cmpxchg(&dio->error, 0, ret);
 }
 
+/*
+ * A polled write that needs no more IO or metadata updates to complete can be
+ * completed by the task that polled for it, rather than bouncing through the
+ * completion workqueue.  Polled completions run in task context; a bio that
+ * fell back to interrupt driven completion has had REQ_POLLED cleared.
+ * Invalidating the page cache may block, so only do this if there is none.
+ */
+static inline bool iomap_dio_write_can_complete_inline(struct iomap_dio *dio,
+		struct bio *bio)
+{
+	return (dio->flags & IOMAP_DIO_INLINE_COMP) &&
+		(bio->bi_opf & REQ_POLLED) &&
+		!file_inode(dio->iocb->ki_filp)->i_mapping->nrpages;
+}
+
 void iomap_dio_bio_end_io(struct bio *bio)
 {
 	struct iomap_dio *dio = bio->bi_private;
@@ -167,7 +183,8 @@ void iomap_dio_bio_end_io(struct bio *bio)
 			struct task_struct *waiter = dio->submit.waiter;
 			WRITE_ONCE(dio->submit.waiter, NULL);
 			blk_wake_io_task(waiter);
-		} else if (dio->flags & IOMAP_DIO_WRITE) {
+		} else if ((dio->flags & IOMAP_DIO_WRITE) &&
+			   !iomap_dio_write_can_complete_inline(dio, bio)) {
 			struct inode *inode = file_inode(dio->iocb->ki_filp);
 
 			WRITE_ONCE(dio->iocb->private, NULL);
@@ -296,6 +313,16 @@ static loff_t iomap_dio_bio_iter(const struct iomap_iter *iter,
 	    ((dio->flags & IOMAP_DIO_WRITE) && pos >= i_size_read(inode)))
 		dio->iocb->ki_flags &= ~IOCB_HIPRI;
 
+	/*
+	 * Inline completion is only for pure overwrites: nothing to convert,
+	 * remap or zero, no size update and no cache flush at completion.
+	 */
+	if (need_zeroout ||
+	    (iomap->flags & (IOMAP_F_SHARED | IOMAP_F_ZONE_APPEND)) ||
+	    ((dio->flags & IOMAP_DIO_NEED_SYNC) && !use_fua) ||
+	    pos + length > i_size_read(inode))
+		dio->flags &= ~IOMAP_DIO_INLINE_COMP;
+
 	if (need_zeroout) {
 		/* zero out from the start of the block to the write offset */
 		pad = pos & (fs_block_size - 1);
@@ -559,6 +586,13 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 			if (!(iocb->ki_flags & IOCB_SYNC))
 				dio->flags |= IOMAP_DIO_WRITE_FUA;
 		}
+
+		/*
+		 * Polled writes may be completed inline by the poller; this is
+		 * cleared again by any extent that needs completion work.
+		 */
+		if (iocb->ki_flags & IOCB_HIPRI)
+			dio->flags |= IOMAP_DIO_INLINE_COMP;
 	}
 
 	if (dio_flags & IOMAP_DIO_OVERWRITE_ONLY) {
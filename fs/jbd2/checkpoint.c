@@ -168,6 +168,51 @@ __releases(&journal->j_state_lock)
 	}
 }
 
+/*
+ * Background checkpointing starts once less than this many times the maximum
+ * transaction size is free in the log, and carries on until there's that much
+ * free again.  __jbd2_log_wait_for_space() only steps in below one times.
+ */
+#define JBD2_BG_CHECKPOINT_FACTOR	2
+
+static bool jbd2_log_want_checkpoint(journal_t *journal)
+{
+	bool want;
+
+	read_lock(&journal->j_state_lock);
+	spin_lock(&journal->j_list_lock);
+	want = journal->j_checkpoint_transactions &&
+		!(journal->j_flags & JBD2_ABORT) &&
+		jbd2_log_space_left(journal) <
+		JBD2_BG_CHECKPOINT_FACTOR * journal->j_max_transaction_buffers;
+	spin_unlock(&journal->j_list_lock);
+	read_unlock(&journal->j_state_lock);
+	return want;
+}
+
+/*
+ * Start background checkpointing if the log is getting full.  Called by the
+ * commit code once a transaction has been added to the checkpoint list.
+ */
+void jbd2_log_kick_checkpoint(journal_t *journal)
+{
+	if (jbd2_log_want_checkpoint(journal))
+		queue_work(system_unbound_wq, &journal->j_checkpoint_work);
+}
+
+void jbd2_checkpoint_work(struct work_struct *work)
+{
+	journal_t *journal = container_of(work, journal_t, j_checkpoint_work);
+
+	mutex_lock_io(&journal->j_checkpoint_mutex);
+	while (jbd2_log_want_checkpoint(journal)) {
+		if (jbd2_log_do_checkpoint(journal))
+			break;
+		cond_resched();
+	}
+	mutex_unlock(&journal->j_checkpoint_mutex);
+}
+
 static void
 __flush_batch(journal_t *journal, int *batch_count)
 {
@@ -187,10 +232,52 @@ __flush_batch(journal_t *journal, int *batch_count)
 	*batch_count = 0;
 }
 
+/*
+ * Most batches of the following transaction's buffers to start writing while
+ * we wait on the oldest one's.
+ */
+#define JBD2_CHECKPOINT_AHEAD_BATCHES	4
+
+/*
+ * Queue up dirty buffers of the transaction after @transaction for writeback,
+ * so that the device still has checkpoint IO to do while we wait for the
+ * oldest transaction's buffers.  They move to their own transaction's io list
+ * and are waited for when its turn comes.  Stops at the first buffer that
+ * can't be written straight away.
+ *
+ * Called with j_list_lock held; returns the number of buffers queued in
+ * j_chkpt_bhs.
+ */
+static int __jbd2_checkpoint_queue_ahead(journal_t *journal,
+					 transaction_t *transaction)
+{
+	transaction_t *next = transaction->t_cpnext;
+	struct journal_head *jh;
+	struct buffer_head *bh;
+	int batch_count = 0;
+
+	if (next == journal->j_checkpoint_transactions)
+		return 0;
+
+	while ((jh = next->t_checkpoint_list) && batch_count < JBD2_NR_BATCH) {
+		bh = jh2bh(jh);
+		if (jh->b_transaction || buffer_locked(bh) || !buffer_dirty(bh))
+			break;
+		BUFFER_TRACE(bh, "queue ahead");
+		get_bh(bh);
+		J_ASSERT_BH(bh, !buffer_jwrite(bh));
+		journal->j_chkpt_bhs[batch_count++] = bh;
+		__buffer_relink_io(jh);
+		next->t_chp_stats.cs_written++;
+	}
+	return batch_count;
+}
+
 /*
  * Perform an actual checkpoint. We take the first transaction on the
  * list of transactions to be checkpointed and send all its buffers
- * to disk. We submit larger chunks of data at once.
+ * to disk. We submit larger chunks of data at once.  While waiting for
+ * them, we start on the next transaction's buffers too.
  *
  * The journal should be locked before calling this function.
  * Called with j_checkpoint_mutex held.
@@ -202,6 +289,7 @@ int jbd2_log_do_checkpoint(journal_t *journal)
 	transaction_t		*transaction;
 	tid_t			this_tid;
 	int			result, batch_count = 0;
+	int			ahead = JBD2_CHECKPOINT_AHEAD_BATCHES;
 
 	jbd2_debug(1, "Start checkpoint\n");
 
@@ -323,8 +411,24 @@ int jbd2_log_do_checkpoint(journal_t *journal)
 	}
 
 	/*
-	 * Now we issued all of the transaction's buffers, let's deal
-	 * with the buffers that are out for I/O.
+	 * Now we issued all of the transaction's buffers, keep the device
+	 * busy with the next transaction's while we wait for them.
+	 */
+	while (ahead > 0) {
+		ahead--;
+		batch_count = __jbd2_checkpoint_queue_ahead(journal, transaction);
+		if (!batch_count)
+			break;
+		spin_unlock(&journal->j_list_lock);
+		__flush_batch(journal, &batch_count);
+		spin_lock(&journal->j_list_lock);
+		if (journal->j_checkpoint_transactions != transaction ||
+		    transaction->t_tid != this_tid)
+			goto out;
+	}
+
+	/*
+	 * Let's deal with the buffers that are out for I/O.
 	 */
 restart2:
 	/* Did somebody clean up the transaction in the meanwhile? */
@@ -1180,6 +1180,8 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	wake_up(&journal->j_wait_done_commit);
 	wake_up(&journal->j_fc_wait);
 
+	jbd2_log_kick_checkpoint(journal);
+
 	/*
 	 * Calculate overall stats
 	 */
@@ -1165,6 +1165,26 @@ static void *jbd2_seq_info_next(struct seq_file *seq, void *v, loff_t *pos)
 	return NULL;
 }
 
+static void jbd2_seq_access_stats_show(struct seq_file *seq,
+				       journal_t *journal)
+{
+	struct jbd2_access_stats sum = {};
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct jbd2_access_stats *as =
+			per_cpu_ptr(journal->j_access_stats, cpu);
+
+		sum.as_fast += as->as_fast;
+		sum.as_slow += as->as_slow;
+		sum.as_contended += as->as_contended;
+		sum.as_waited += as->as_waited;
+	}
+	seq_printf(seq, "write access: %lu lockless, %lu locked, "
+		   "%lu contended (%lu resolved by waiting)\n",
+		   sum.as_fast, sum.as_slow, sum.as_contended, sum.as_waited);
+}
+
 static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 {
 	struct jbd2_stats_proc_session *s = seq->private;
@@ -1175,6 +1195,7 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 		   "each up to %u blocks\n",
 		   s->stats->ts_tid, s->stats->ts_requested,
 		   s->journal->j_max_transaction_buffers);
+	jbd2_seq_access_stats_show(seq, s->journal);
 	if (s->stats->ts_tid == 0)
 		return 0;
 	seq_printf(seq, "average: \n  %ums waiting for transaction\n",
@@ -1366,6 +1387,7 @@ static journal_t *journal_init_common(struct block_device *bdev,
 	mutex_init(&journal->j_abort_mutex);
 	mutex_init(&journal->j_barrier);
 	mutex_init(&journal->j_checkpoint_mutex);
+	INIT_WORK(&journal->j_checkpoint_work, jbd2_checkpoint_work);
 	spin_lock_init(&journal->j_revoke_lock);
 	spin_lock_init(&journal->j_list_lock);
 	rwlock_init(&journal->j_state_lock);
@@ -1418,6 +1440,10 @@ static journal_t *journal_init_common(struct block_device *bdev,
 	journal->j_shrinker.seeks = DEFAULT_SEEKS;
 	journal->j_shrinker.batch = journal->j_max_transaction_buffers;
 
+	journal->j_access_stats = alloc_percpu(struct jbd2_access_stats);
+	if (!journal->j_access_stats)
+		goto err_cleanup;
+
 	if (percpu_counter_init(&journal->j_checkpoint_jh_count, 0, GFP_KERNEL))
 		goto err_cleanup;
 
@@ -1429,6 +1455,7 @@ static journal_t *journal_init_common(struct block_device *bdev,
 	return journal;
 
 err_cleanup:
+	free_percpu(journal->j_access_stats);
 	brelse(journal->j_sb_buffer);
 	kfree(journal->j_wbuf);
 	jbd2_journal_destroy_revoke(journal);
@@ -2131,6 +2158,9 @@ int jbd2_journal_destroy(journal_t *journal)
 	if (journal->j_running_transaction)
 		jbd2_journal_commit_transaction(journal);
 
+	/* No more commits, so nothing can kick the checkpoint worker again */
+	cancel_work_sync(&journal->j_checkpoint_work);
+
 	/* Force any old transactions to disk */
 
 	/* Totally anal locking here... */
@@ -2190,6 +2220,7 @@ int jbd2_journal_destroy(journal_t *journal)
 	}
 	if (journal->j_proc_entry)
 		jbd2_stats_proc_exit(journal);
+	free_percpu(journal->j_access_stats);
 	iput(journal->j_inode);
 	if (journal->j_revoke)
 		jbd2_journal_destroy_revoke(journal);
@@ -21,6 +21,12 @@
 #include <linux/blkdev.h>
 #endif
 
+/* Number of replayed blocks we collect before starting writeback on them */
+#define JBD2_REPLAY_BATCH	32
+
+/* How often to report on the progress of a long replay */
+#define JBD2_REPLAY_REPORT_INTERVAL	(10 * HZ)
+
 /*
  * Maintain information about the progress of the recovery job, so that
  * the different passes can carry information between them.
@@ -33,6 +39,12 @@ struct recovery_info
 	int		nr_replays;
 	int		nr_revokes;
 	int		nr_revoke_hits;
+
+#ifdef __KERNEL__
+	unsigned long	next_report;	/* jiffies of the next progress report */
+	int		nr_pending;
+	struct buffer_head *pending[JBD2_REPLAY_BATCH];
+#endif
 };
 
 static int do_one_pass(journal_t *journal,
@@ -58,11 +70,12 @@ static void journal_brelse_array(struct buffer_head *b[], int n)
  * do the IO in reasonably large chunks.
  *
  * This is not so critical that we need to be enormously clever about
- * the readahead size, though.  128K is a purely arbitrary, good-enough
- * fixed value.
+ * the readahead size, though.  1M is a purely arbitrary, good-enough
+ * fixed value that keeps large journals streaming off the device.
  */
 
-#define MAXBUF 8
+#define MAXBUF 32
+#define JBD2_READAHEAD_SIZE	(1024 * 1024)
 static int do_readahead(journal_t *journal, unsigned int start)
 {
 	int err;
@@ -72,8 +85,8 @@ static int do_readahead(journal_t *journal, unsigned int start)
 
 	struct buffer_head * bufs[MAXBUF];
 
-	/* Do up to 128K of readahead */
-	max = start + (128 * 1024 / journal->j_blocksize);
+	/* Do up to JBD2_READAHEAD_SIZE of readahead */
+	max = start + (JBD2_READAHEAD_SIZE / journal->j_blocksize);
 	if (max > journal->j_total_len)
 		max = journal->j_total_len;
 
@@ -118,6 +131,70 @@ static int do_readahead(journal_t *journal, unsigned int start)
 	return err;
 }
 
+/*
+ * Start writeback on the replayed blocks collected so far.  Replay used to
+ * leave everything dirty in the page cache until the final sync_blockdev(),
+ * which meant the filesystem device sat idle while we read the whole log.
+ * Writing back in batches overlaps the two.  A block that is replayed again
+ * by a later transaction simply waits for this write under the buffer lock
+ * and is redirtied; write errors are caught by the sync at the end.
+ */
+static void replay_flush_pending(struct recovery_info *info)
+{
+	struct blk_plug plug;
+	int i;
+
+	if (!info->nr_pending)
+		return;
+
+	blk_start_plug(&plug);
+	for (i = 0; i < info->nr_pending; i++) {
+		write_dirty_buffer(info->pending[i], 0);
+		brelse(info->pending[i]);
+	}
+	blk_finish_plug(&plug);
+	info->nr_pending = 0;
+}
+
+/* Queue a replayed block for writeback, taking over the caller's reference */
+static void replay_queue_write(struct recovery_info *info,
+			       struct buffer_head *bh)
+{
+	info->pending[info->nr_pending++] = bh;
+	if (info->nr_pending == JBD2_REPLAY_BATCH)
+		replay_flush_pending(info);
+}
+
+static void replay_report_progress(journal_t *journal,
+				   struct recovery_info *info, tid_t tid)
+{
+	if (time_before(jiffies, info->next_report))
+		return;
+
+	pr_info("JBD2: %s: recovery replayed %u of %u transactions, %d blocks\n",
+		journal->j_devname, tid - info->start_transaction,
+		info->end_transaction - info->start_transaction,
+		info->nr_replays);
+	info->next_report = jiffies + JBD2_REPLAY_REPORT_INTERVAL;
+}
+
+#else
+
+static inline void replay_flush_pending(struct recovery_info *info)
+{
+}
+
+static inline void replay_queue_write(struct recovery_info *info,
+				      struct buffer_head *bh)
+{
+	brelse(bh);
+}
+
+static inline void replay_report_progress(journal_t *journal,
+					  struct recovery_info *info, tid_t tid)
+{
+}
+
 #endif /* __KERNEL__ */
 
 
@@ -312,8 +389,13 @@ int jbd2_journal_recover(journal_t *journal)
 	err = do_one_pass(journal, &info, PASS_SCAN);
 	if (!err)
 		err = do_one_pass(journal, &info, PASS_REVOKE);
-	if (!err)
+	if (!err) {
+#ifdef __KERNEL__
+		info.next_report = jiffies + JBD2_REPLAY_REPORT_INTERVAL;
+#endif
 		err = do_one_pass(journal, &info, PASS_REPLAY);
+	}
+	replay_flush_pending(&info);
 
 	jbd2_debug(1, "JBD2: recovery, exit status %d, "
 		  "recovered transactions %u to %u\n",
@@ -516,6 +598,9 @@ static int do_one_pass(journal_t *journal,
 			if (tid_geq(next_commit_ID, info->end_transaction))
 				break;
 
+		if (pass == PASS_REPLAY)
+			replay_report_progress(journal, info, next_commit_ID);
+
 		jbd2_debug(2, "Scanning for sequence ID %u at %lu/%lu\n",
 			  next_commit_ID, next_log_block,
 			  jbd2_has_feature_fast_commit(journal) ?
@@ -695,7 +780,7 @@ static int do_one_pass(journal_t *journal,
 					++info->nr_replays;
 					unlock_buffer(nbh);
 					brelse(obh);
-					brelse(nbh);
+					replay_queue_write(info, nbh);
 				}
 
 			skip_write:
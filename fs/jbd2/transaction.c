@@ -956,6 +956,9 @@ static void jbd2_freeze_jh_data(struct journal_head *jh)
 	jh->b_frozen_triggers = jh->b_triggers;
 }
 
+static bool jbd2_write_access_granted(handle_t *handle, struct buffer_head *bh,
+				      bool undo);
+
 /*
  * If the buffer is already part of the current transaction, then there
  * is nothing we need to do.  If it is already part of a prior
@@ -988,7 +991,22 @@ do_get_write_access(handle_t *handle, struct journal_head *jh,
 	/* @@@ Need to check for errors here at some point. */
 
  	start_lock = jiffies;
-	lock_buffer(bh);
+	if (!trylock_buffer(bh)) {
+		jbd2_access_stat_inc(journal, as_contended);
+		/*
+		 * Very often whoever holds the buffer is another handle
+		 * getting write access to it for this same transaction.
+		 * Wait for them and see if that has done the job, rather
+		 * than queueing up for the locks just to find it has.
+		 */
+		wait_on_buffer(bh);
+		if (jbd2_write_access_granted(handle, bh, force_copy)) {
+			jbd2_access_stat_inc(journal, as_waited);
+			error = 0;
+			goto out;
+		}
+		lock_buffer(bh);
+	}
 	spin_lock(&jh->b_state_lock);
 
 	/* If it takes too long to lock the buffer, trace it */
@@ -1232,9 +1250,13 @@ int jbd2_journal_get_write_access(handle_t *handle, struct buffer_head *bh)
 	if (is_handle_aborted(handle))
 		return -EROFS;
 
-	if (jbd2_write_access_granted(handle, bh, false))
+	if (jbd2_write_access_granted(handle, bh, false)) {
+		jbd2_access_stat_inc(handle->h_transaction->t_journal,
+				     as_fast);
 		return 0;
+	}
 
+	jbd2_access_stat_inc(handle->h_transaction->t_journal, as_slow);
 	jh = jbd2_journal_add_journal_head(bh);
 	/* We do not want to get caught playing with fields which the
 	 * log thread also manipulates.  Make sure that the buffer
@@ -11,7 +11,8 @@
 
 /*
  * Unlock the folios in a read operation.  We need to set PG_fscache on any
- * folios we're going to write back before we unlock them.
+ * folios we're going to write back before we unlock them.  Folios belonging to
+ * subrequests that were dealt with as they completed are skipped.
  */
 void netfs_rreq_unlock_folios(struct netfs_io_request *rreq)
 {
@@ -46,12 +47,14 @@ void netfs_rreq_unlock_folios(struct netfs_io_request *rreq)
 	rcu_read_lock();
 	xas_for_each(&xas, folio, last_page) {
 		loff_t pg_end;
-		bool pg_failed = false;
+		bool pg_failed = false, unlocked;
 
 		if (xas_retry(&xas, folio))
 			continue;
 
 		pg_end = folio_pos(folio) + folio_size(folio) - 1;
+		unlocked = subreq &&
+			test_bit(NETFS_SREQ_FOLIOS_UNLOCKED, &subreq->flags);
 
 		for (;;) {
 			loff_t sreq_end;
@@ -80,6 +83,9 @@ void netfs_rreq_unlock_folios(struct netfs_io_request *rreq)
 				break;
 		}
 
+		if (unlocked)
+			continue;
+
 		if (!pg_failed) {
 			flush_dcache_folio(folio);
 			folio_mark_uptodate(folio);
@@ -0,0 +1,514 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/* Network filesystem high-level write support.
+ *
+ * Dirty folios are gathered into contiguous runs, each of which is uploaded
+ * to the server as one or more subrequests whilst being speculatively written
+ * to the cache in parallel.
+ */
+
+#include <linux/export.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/pagevec.h>
+#include <linux/sizes.h>
+#include <linux/writeback.h>
+#include "internal.h"
+
+/* The most data we'll gather into a single writeback request */
+#define NETFS_WRITEBACK_MAX_LEN	SZ_64M
+
+/*
+ * End writeback on all the folios spanned by a write request.  Each of them
+ * had writeback set when the request was assembled.
+ */
+static void netfs_wreq_end_writeback(struct netfs_io_request *wreq)
+{
+	struct folio *folio;
+	pgoff_t last = (wreq->start + wreq->len - 1) / PAGE_SIZE;
+
+	XA_STATE(xas, &wreq->mapping->i_pages, wreq->start / PAGE_SIZE);
+
+	rcu_read_lock();
+	xas_for_each(&xas, folio, last) {
+		if (xas_retry(&xas, folio))
+			continue;
+		if (WARN_ON_ONCE(xa_is_value(folio)))
+			continue;
+		folio_end_writeback(folio);
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * Note the completion of the upload of a write request.  If any part of it
+ * failed, the data we wrote to the cache can no longer be trusted.
+ */
+static void netfs_wreq_completed(struct netfs_io_request *wreq, bool was_async)
+{
+	struct netfs_inode *ctx = netfs_inode(wreq->inode);
+
+	if (wreq->error) {
+		mapping_set_error(wreq->mapping, wreq->error);
+		if (test_bit(NETFS_RREQ_COPY_TO_CACHE, &wreq->flags))
+			fscache_invalidate(netfs_i_cookie(ctx), NULL,
+					   i_size_read(wreq->inode), 0);
+	}
+
+	netfs_wreq_end_writeback(wreq);
+	trace_netfs_rreq(wreq, netfs_rreq_trace_done);
+	clear_bit_unlock(NETFS_RREQ_IN_PROGRESS, &wreq->flags);
+	wake_up_bit(&wreq->flags, NETFS_RREQ_IN_PROGRESS);
+	netfs_clear_subrequests(wreq, was_async);
+	netfs_put_request(wreq, was_async, netfs_rreq_trace_put_complete);
+}
+
+static void netfs_wreq_completed_worker(struct work_struct *work)
+{
+	struct netfs_io_request *wreq =
+		container_of(work, struct netfs_io_request, work);
+
+	netfs_wreq_completed(wreq, false);
+}
+
+/**
+ * netfs_write_subrequest_terminated - Note the termination of an upload
+ * @_op: The netfs_io_subrequest that has terminated.
+ * @transferred_or_error: The amount of data transferred or an error code.
+ * @was_async: The termination was asynchronous
+ *
+ * This tells the write helper that a contributory upload operation has
+ * terminated, one way or another.  A short write is treated as an error as
+ * the folios it covers are about to be marked clean.
+ *
+ * Once the last outstanding subrequest of a request terminates, writeback is
+ * ended on the folios concerned.  If that happens in softirq context, the
+ * completion is punted to a worker thread.
+ */
+void netfs_write_subrequest_terminated(void *_op, ssize_t transferred_or_error,
+				       bool was_async)
+{
+	struct netfs_io_subrequest *subreq = _op;
+	struct netfs_io_request *wreq = subreq->rreq;
+
+	if (IS_ERR_VALUE(transferred_or_error)) {
+		subreq->error = transferred_or_error;
+	} else {
+		subreq->transferred = transferred_or_error;
+		if (subreq->transferred < subreq->len)
+			subreq->error = -EIO;
+	}
+
+	if (subreq->error) {
+		netfs_stat(&netfs_n_wh_upload_failed);
+		WRITE_ONCE(wreq->error, subreq->error);
+		set_bit(NETFS_RREQ_FAILED, &wreq->flags);
+	} else {
+		netfs_stat(&netfs_n_wh_upload_done);
+	}
+
+	trace_netfs_sreq(subreq, netfs_sreq_trace_terminated);
+
+	if (atomic_dec_and_test(&wreq->nr_outstanding)) {
+		if (was_async) {
+			wreq->work.func = netfs_wreq_completed_worker;
+			if (!queue_work(system_unbound_wq, &wreq->work))
+				BUG();
+		} else {
+			netfs_wreq_completed(wreq, false);
+		}
+	}
+
+	netfs_put_subrequest(subreq, was_async, netfs_sreq_trace_put_terminated);
+}
+EXPORT_SYMBOL(netfs_write_subrequest_terminated);
+
+static void netfs_upload_to_server(struct netfs_io_subrequest *subreq)
+{
+	netfs_stat(&netfs_n_wh_upload);
+	trace_netfs_sreq(subreq, netfs_sreq_trace_submit);
+	subreq->rreq->netfs_ops->issue_write(subreq);
+}
+
+static void netfs_upload_worker(struct work_struct *work)
+{
+	struct netfs_io_subrequest *subreq =
+		container_of(work, struct netfs_io_subrequest, work);
+
+	netfs_upload_to_server(subreq);
+}
+
+/*
+ * Slice a write request up into uploads, allowing the netfs to limit the size
+ * of each.  All but the last slice are handed off to worker threads so that
+ * they can be in flight concurrently; the last is issued from here.
+ */
+static void netfs_wreq_submit(struct netfs_io_request *wreq)
+{
+	struct netfs_io_subrequest *subreq, *prev = NULL;
+	unsigned short debug_index = 0;
+
+	/* Hold a count on the request until we've issued everything. */
+	atomic_set(&wreq->nr_outstanding, 1);
+
+	while (wreq->submitted < wreq->len) {
+		subreq = netfs_alloc_subrequest(wreq);
+		if (!subreq) {
+			wreq->error = -ENOMEM;
+			break;
+		}
+
+		subreq->source		= NETFS_UPLOAD_TO_SERVER;
+		subreq->start		= wreq->start + wreq->submitted;
+		subreq->len		= wreq->len - wreq->submitted;
+		subreq->debug_index	= debug_index++;
+		subreq->work.func	= netfs_upload_worker;
+		list_add_tail(&subreq->rreq_link, &wreq->subrequests);
+
+		if (wreq->netfs_ops->clamp_length &&
+		    !wreq->netfs_ops->clamp_length(subreq)) {
+			wreq->error = -EIO;
+			netfs_put_subrequest(subreq, false,
+					     netfs_sreq_trace_put_failed);
+			break;
+		}
+
+		trace_netfs_sreq(subreq, netfs_sreq_trace_prepare);
+		wreq->submitted += subreq->len;
+		atomic_inc(&wreq->nr_outstanding);
+
+		if (prev)
+			queue_work(system_unbound_wq, &prev->work);
+		prev = subreq;
+	}
+
+	if (prev)
+		netfs_upload_to_server(prev);
+
+	if (atomic_dec_and_test(&wreq->nr_outstanding))
+		netfs_wreq_completed(wreq, false);
+}
+
+static void netfs_write_to_cache_done(void *priv, ssize_t transferred_or_error,
+				      bool was_async)
+{
+	struct netfs_inode *ctx = priv;
+
+	if (IS_ERR_VALUE(transferred_or_error) &&
+	    transferred_or_error != -ENOBUFS)
+		fscache_invalidate(netfs_i_cookie(ctx), NULL,
+				   i_size_read(&ctx->inode), 0);
+}
+
+/*
+ * Extend the region to be written back to include subsequent contiguously
+ * dirty folios that we can lock without waiting.  Large folios are taken
+ * whole.
+ */
+static void netfs_extend_writeback(struct address_space *mapping,
+				   long *_count, loff_t start, loff_t max_len,
+				   bool caching, size_t *_len)
+{
+	struct folio_batch fbatch;
+	struct folio *folio;
+	loff_t len = *_len;
+	pgoff_t index = (start + len) / PAGE_SIZE;
+	bool stop = true;
+	unsigned int i;
+
+	XA_STATE(xas, &mapping->i_pages, index);
+	folio_batch_init(&fbatch);
+
+	do {
+		/* Firstly, we gather up a batch of contiguous dirty folios
+		 * under the RCU read lock - but we can't clear the dirty flags
+		 * there if any of those folios are mapped.
+		 */
+		rcu_read_lock();
+
+		xas_for_each(&xas, folio, ULONG_MAX) {
+			stop = true;
+			if (xas_retry(&xas, folio))
+				continue;
+			if (xa_is_value(folio))
+				break;
+			if (folio_index(folio) != index)
+				break;
+
+			if (!folio_try_get_rcu(folio)) {
+				xas_reset(&xas);
+				continue;
+			}
+
+			/* Has the folio moved or been split? */
+			if (unlikely(folio != xas_reload(&xas))) {
+				folio_put(folio);
+				break;
+			}
+
+			if (!folio_trylock(folio)) {
+				folio_put(folio);
+				break;
+			}
+			if (!folio_test_dirty(folio) ||
+			    folio_test_writeback(folio) ||
+			    folio_test_fscache(folio)) {
+				folio_unlock(folio);
+				folio_put(folio);
+				break;
+			}
+
+			len += folio_size(folio);
+			stop = len >= max_len || *_count <= 0;
+			index += folio_nr_pages(folio);
+			if (!folio_batch_add(&fbatch, folio))
+				break;
+			if (stop)
+				break;
+		}
+
+		if (!stop)
+			xas_pause(&xas);
+		rcu_read_unlock();
+
+		/* Now, if we obtained any folios, we can shift them to being
+		 * writable and mark them for caching.
+		 */
+		if (!folio_batch_count(&fbatch))
+			break;
+
+		for (i = 0; i < folio_batch_count(&fbatch); i++) {
+			folio = fbatch.folios[i];
+
+			if (!folio_clear_dirty_for_io(folio))
+				BUG();
+			if (folio_start_writeback(folio))
+				BUG();
+			if (caching)
+				folio_start_fscache(folio);
+
+			*_count -= folio_nr_pages(folio);
+			folio_unlock(folio);
+		}
+
+		folio_batch_release(&fbatch);
+		cond_resched();
+	} while (!stop);
+
+	*_len = len;
+}
+
+/*
+ * Write back the locked folio and any subsequent non-locked dirty folios.
+ * Returns the amount of the file covered or a negative error if we couldn't
+ * get the writeback started, in which case the folio is left dirty.
+ */
+static ssize_t netfs_write_back_from_locked_folio(struct address_space *mapping,
+						  struct writeback_control *wbc,
+						  struct folio *folio,
+						  loff_t start, loff_t end)
+{
+	struct netfs_inode *ctx = netfs_inode(mapping->host);
+	struct fscache_cookie *cookie = netfs_i_cookie(ctx);
+	struct netfs_io_request *wreq;
+	loff_t i_size = i_size_read(mapping->host);
+	loff_t max_len;
+	size_t len;
+	bool caching = fscache_cookie_enabled(cookie) &&
+		test_bit(FSCACHE_COOKIE_IS_CACHING, &cookie->flags);
+	long count = wbc->nr_to_write;
+
+	wreq = netfs_alloc_request(mapping, NULL, start, 0, NETFS_WRITEBACK);
+	if (IS_ERR(wreq)) {
+		folio_unlock(folio);
+		return PTR_ERR(wreq);
+	}
+
+	netfs_stat(&netfs_n_wh_writepages);
+
+	if (!folio_clear_dirty_for_io(folio))
+		BUG();
+	if (folio_start_writeback(folio))
+		BUG();
+	if (caching)
+		folio_start_fscache(folio);
+
+	count -= folio_nr_pages(folio);
+	len = folio_size(folio);
+
+	/* Find all consecutive lockable dirty folios, stopping when we find
+	 * one that is not immediately lockable, is not dirty or is missing, or
+	 * we reach the end of the range.
+	 */
+	if (start < i_size) {
+		/* Trim the write to the EOF; the extra data is ignored.  Also
+		 * put an upper limit on the size of a single request.
+		 */
+		max_len = NETFS_WRITEBACK_MAX_LEN;
+		max_len = min_t(unsigned long long, max_len, end - start + 1);
+		max_len = min_t(unsigned long long, max_len, i_size - start);
+
+		if (len < max_len)
+			netfs_extend_writeback(mapping, &count, start, max_len,
+					       caching, &len);
+		len = min_t(loff_t, len, max_len);
+	}
+
+	/* We now have a contiguous set of dirty folios, each with writeback
+	 * set; the first folio is still locked at this point, but all the rest
+	 * have been unlocked.
+	 */
+	folio_unlock(folio);
+	wbc->nr_to_write = count;
+	wreq->len = len;
+
+	if (start >= i_size) {
+		/* The dirty region was entirely beyond the EOF. */
+		fscache_clear_page_bits(mapping, start, len, caching);
+		netfs_wreq_completed(wreq, false);
+		return len;
+	}
+
+	/* Speculatively write to the cache whilst the upload is in progress.
+	 * We have to fix this up later if the upload fails.
+	 */
+	if (caching) {
+		__set_bit(NETFS_RREQ_COPY_TO_CACHE, &wreq->flags);
+		fscache_write_to_cache(cookie, mapping, start, len, i_size,
+				       netfs_write_to_cache_done, ctx, caching);
+	}
+
+	trace_netfs_rreq(wreq, netfs_rreq_trace_submit);
+	netfs_wreq_submit(wreq);
+	return len;
+}
+
+/*
+ * Write a region of folios back to the server.
+ */
+static int netfs_writepages_region(struct address_space *mapping,
+				   struct writeback_control *wbc,
+				   loff_t start, loff_t end, loff_t *_next)
+{
+	struct folio *folio;
+	struct page *head_page;
+	ssize_t ret;
+	int n, skips = 0;
+
+	do {
+		pgoff_t index = start / PAGE_SIZE;
+
+		n = find_get_pages_range_tag(mapping, &index, end / PAGE_SIZE,
+					     PAGECACHE_TAG_DIRTY, 1, &head_page);
+		if (!n)
+			break;
+
+		folio = page_folio(head_page);
+		start = folio_pos(folio); /* May regress with THPs */
+
+		/* At this point we hold neither the i_pages lock nor the
+		 * folio lock: the folio may be truncated or invalidated
+		 * (changing folio->mapping to NULL).
+		 */
+		if (wbc->sync_mode != WB_SYNC_NONE) {
+			ret = folio_lock_killable(folio);
+			if (ret < 0) {
+				folio_put(folio);
+				return ret;
+			}
+		} else {
+			if (!folio_trylock(folio)) {
+				folio_put(folio);
+				return 0;
+			}
+		}
+
+		if (folio_mapping(folio) != mapping ||
+		    !folio_test_dirty(folio)) {
+			start += folio_size(folio);
+			folio_unlock(folio);
+			folio_put(folio);
+			continue;
+		}
+
+		if (folio_test_writeback(folio) ||
+		    folio_test_fscache(folio)) {
+			folio_unlock(folio);
+			if (wbc->sync_mode != WB_SYNC_NONE) {
+				folio_wait_writeback(folio);
+				folio_wait_fscache(folio);
+			} else {
+				start += folio_size(folio);
+			}
+			folio_put(folio);
+			if (wbc->sync_mode == WB_SYNC_NONE) {
+				if (skips >= 5 || need_resched())
+					break;
+				skips++;
+			}
+			continue;
+		}
+
+		ret = netfs_write_back_from_locked_folio(mapping, wbc, folio,
+							 start, end);
+		folio_put(folio);
+		if (ret < 0)
+			return ret;
+
+		start += ret;
+		cond_resched();
+	} while (wbc->nr_to_write > 0);
+
+	*_next = start;
+	return 0;
+}
+
+/**
+ * netfs_writepages - Write back dirty data from the pagecache
+ * @mapping: The mapping to write back
+ * @wbc: The writeback control
+ *
+ * Write back runs of contiguous dirty folios from the pagecache of a network
+ * filesystem inode.  Each run is handed to the filesystem's ->issue_write()
+ * op as one or more subrequests, cut to size by ->clamp_length() if the
+ * filesystem supplies it; these may be in progress concurrently.  If the
+ * inode is being cached, the data is written to the cache at the same time.
+ *
+ * Writeback is ended on the folios once all the uploads covering them have
+ * terminated; errors are recorded against the mapping.  For data integrity
+ * writeback, the caller is expected to wait on the folios in the usual way.
+ */
+int netfs_writepages(struct address_space *mapping,
+		     struct writeback_control *wbc)
+{
+	loff_t start, next;
+	int ret;
+
+	if (wbc->range_cyclic) {
+		start = mapping->writeback_index * PAGE_SIZE;
+		ret = netfs_writepages_region(mapping, wbc, start, LLONG_MAX,
+					      &next);
+		if (ret == 0) {
+			mapping->writeback_index = next / PAGE_SIZE;
+			if (start > 0 && wbc->nr_to_write > 0) {
+				ret = netfs_writepages_region(mapping, wbc, 0,
+							      start, &next);
+				if (ret == 0)
+					mapping->writeback_index =
+						next / PAGE_SIZE;
+			}
+		}
+	} else if (wbc->range_start == 0 && wbc->range_end == LLONG_MAX) {
+		ret = netfs_writepages_region(mapping, wbc, 0, LLONG_MAX,
+					      &next);
+		if (wbc->nr_to_write > 0 && ret == 0)
+			mapping->writeback_index = next / PAGE_SIZE;
+	} else {
+		ret = netfs_writepages_region(mapping, wbc,
+					      wbc->range_start, wbc->range_end,
+					      &next);
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL(netfs_writepages);
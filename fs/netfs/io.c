@@ -91,6 +91,155 @@ static void netfs_read_from_server(struct netfs_io_request *rreq,
 	rreq->netfs_ops->issue_read(subreq);
 }
 
+static void netfs_read_from_server_worker(struct work_struct *work)
+{
+	struct netfs_io_subrequest *subreq =
+		container_of(work, struct netfs_io_subrequest, work);
+
+	netfs_read_from_server(subreq->rreq, subreq);
+}
+
+/*
+ * Clear PG_fscache on the folios covered by a subrequest whose data was
+ * written to the cache as soon as it was downloaded.
+ */
+static void netfs_subreq_end_fscache(struct netfs_io_subrequest *subreq)
+{
+	struct folio *folio;
+
+	XA_STATE(xas, &subreq->rreq->mapping->i_pages, subreq->start / PAGE_SIZE);
+
+	rcu_read_lock();
+	xas_for_each(&xas, folio, (subreq->start + subreq->len - 1) / PAGE_SIZE) {
+		if (xas_retry(&xas, folio))
+			continue;
+		folio_end_fscache(folio);
+	}
+	rcu_read_unlock();
+}
+
+static void netfs_subreq_copy_terminated(void *priv, ssize_t transferred_or_error,
+					 bool was_async)
+{
+	struct netfs_io_subrequest *subreq = priv;
+
+	if (IS_ERR_VALUE(transferred_or_error)) {
+		netfs_stat(&netfs_n_rh_write_failed);
+		trace_netfs_failure(subreq->rreq, subreq, transferred_or_error,
+				    netfs_fail_copy_to_cache);
+	} else {
+		netfs_stat(&netfs_n_rh_write_done);
+	}
+
+	trace_netfs_sreq(subreq, netfs_sreq_trace_write_term);
+	netfs_subreq_end_fscache(subreq);
+	netfs_put_subrequest(subreq, was_async, netfs_sreq_trace_put_terminated);
+}
+
+/*
+ * Write a downloaded subrequest to the cache whilst the rest of the request
+ * is still in progress.  The folios were marked PG_fscache before they were
+ * unlocked.  We inherit a ref on the subrequest from the caller.
+ */
+static void netfs_subreq_write_to_cache_worker(struct work_struct *work)
+{
+	struct netfs_io_subrequest *subreq =
+		container_of(work, struct netfs_io_subrequest, work);
+	struct netfs_io_request *rreq = subreq->rreq;
+	struct netfs_cache_resources *cres = &rreq->cache_resources;
+	struct iov_iter iter;
+	loff_t start = subreq->start;
+	size_t len = subreq->len;
+	int ret;
+
+	/* The write mustn't spill onto folios we haven't marked. */
+	ret = cres->ops->prepare_write(cres, &start, &len, rreq->i_size, true);
+	if (ret == 0 && (start != subreq->start || len > subreq->len))
+		ret = -ENOBUFS;
+	if (ret < 0) {
+		trace_netfs_failure(rreq, subreq, ret, netfs_fail_prepare_write);
+		trace_netfs_sreq(subreq, netfs_sreq_trace_write_skip);
+		netfs_subreq_end_fscache(subreq);
+		netfs_put_subrequest(subreq, false, netfs_sreq_trace_put_no_copy);
+		return;
+	}
+
+	iov_iter_xarray(&iter, ITER_SOURCE, &rreq->mapping->i_pages, start, len);
+
+	netfs_stat(&netfs_n_rh_write);
+	trace_netfs_sreq(subreq, netfs_sreq_trace_write);
+	cres->ops->write(cres, start, &iter, netfs_subreq_copy_terminated, subreq);
+}
+
+/*
+ * Determine whether the folios covered by a completed subrequest can be
+ * unlocked now rather than when the whole request is done.  This is only
+ * possible if the subrequest starts and ends on folio boundaries.  Data read
+ * from the cache has to wait if the netfs may yet declare it stale.
+ */
+static bool netfs_subreq_can_unlock_early(struct netfs_io_subrequest *subreq)
+{
+	struct netfs_io_request *rreq = subreq->rreq;
+	struct folio *folio;
+	loff_t pos = subreq->start, end = subreq->start + subreq->len;
+
+	XA_STATE(xas, &rreq->mapping->i_pages, subreq->start / PAGE_SIZE);
+
+	if (test_bit(NETFS_RREQ_DONT_UNLOCK_FOLIOS, &rreq->flags) ||
+	    test_bit(NETFS_RREQ_NO_UNLOCK_FOLIO, &rreq->flags))
+		return false;
+	if (subreq->source == NETFS_READ_FROM_CACHE &&
+	    rreq->netfs_ops->is_still_valid)
+		return false;
+
+	/* Walk the folios, checking that they tile the subrequest exactly. */
+	rcu_read_lock();
+	xas_for_each(&xas, folio, (end - 1) / PAGE_SIZE) {
+		if (xas_retry(&xas, folio))
+			continue;
+		if (folio_pos(folio) != pos)
+			break;
+		pos += folio_size(folio);
+	}
+	rcu_read_unlock();
+	return pos == end;
+}
+
+/*
+ * Unlock the folios of a completed subrequest and, if its data needs to go to
+ * the cache, start writing it there immediately rather than waiting for the
+ * rest of the request.
+ */
+static void netfs_subreq_unlock_folios(struct netfs_io_subrequest *subreq)
+{
+	struct netfs_io_request *rreq = subreq->rreq;
+	struct folio *folio;
+	bool copy = test_bit(NETFS_SREQ_COPY_TO_CACHE, &subreq->flags);
+
+	XA_STATE(xas, &rreq->mapping->i_pages, subreq->start / PAGE_SIZE);
+
+	rcu_read_lock();
+	xas_for_each(&xas, folio, (subreq->start + subreq->len - 1) / PAGE_SIZE) {
+		if (xas_retry(&xas, folio))
+			continue;
+		if (copy)
+			folio_start_fscache(folio);
+		flush_dcache_folio(folio);
+		folio_mark_uptodate(folio);
+		folio_unlock(folio);
+	}
+	rcu_read_unlock();
+
+	__set_bit(NETFS_SREQ_FOLIOS_UNLOCKED, &subreq->flags);
+	if (copy) {
+		__clear_bit(NETFS_SREQ_COPY_TO_CACHE, &subreq->flags);
+		netfs_get_subrequest(subreq, netfs_sreq_trace_get_copy_to_cache);
+		subreq->work.func = netfs_subreq_write_to_cache_worker;
+		if (!queue_work(system_unbound_wq, &subreq->work))
+			BUG();
+	}
+}
+
 /*
  * Release those waiting.
  */
@@ -409,6 +558,9 @@ void netfs_subreq_terminated(struct netfs_io_subrequest *subreq,
 		break;
 	case NETFS_DOWNLOAD_FROM_SERVER:
 		netfs_stat(&netfs_n_rh_download_done);
+		if (transferred_or_error > 0)
+			fscache_note_download(netfs_i_cookie(netfs_inode(rreq->inode)),
+					      transferred_or_error);
 		break;
 	default:
 		break;
@@ -434,6 +586,8 @@ void netfs_subreq_terminated(struct netfs_io_subrequest *subreq,
 
 complete:
 	__clear_bit(NETFS_SREQ_NO_PROGRESS, &subreq->flags);
+	if (netfs_subreq_can_unlock_early(subreq))
+		netfs_subreq_unlock_folios(subreq);
 	if (test_bit(NETFS_SREQ_COPY_TO_CACHE, &subreq->flags))
 		set_bit(NETFS_RREQ_COPY_TO_CACHE, &rreq->flags);
 
@@ -579,7 +733,9 @@ static bool netfs_rreq_submit_slice(struct netfs_io_request *rreq,
 		netfs_fill_with_zeroes(rreq, subreq);
 		break;
 	case NETFS_DOWNLOAD_FROM_SERVER:
-		netfs_read_from_server(rreq, subreq);
+		/* Issued by netfs_rreq_issue_downloads() once the whole
+		 * request has been sliced up.
+		 */
 		break;
 	case NETFS_READ_FROM_CACHE:
 		netfs_read_from_cache(rreq, subreq, NETFS_READ_HOLE_IGNORE);
@@ -596,6 +752,31 @@ static bool netfs_rreq_submit_slice(struct netfs_io_request *rreq,
 	return false;
 }
 
+/*
+ * Issue the server downloads for a request after all the cache reads have been
+ * dispatched so that the latter aren't left waiting behind a netfs that does
+ * its I/O synchronously.  All but the last download are handed off to worker
+ * threads so that they can be in progress at the same time.
+ */
+static void netfs_rreq_issue_downloads(struct netfs_io_request *rreq)
+{
+	struct netfs_io_subrequest *subreq, *prev = NULL;
+
+	list_for_each_entry(subreq, &rreq->subrequests, rreq_link) {
+		if (subreq->source != NETFS_DOWNLOAD_FROM_SERVER)
+			continue;
+		if (prev) {
+			prev->work.func = netfs_read_from_server_worker;
+			if (!queue_work(system_unbound_wq, &prev->work))
+				BUG();
+		}
+		prev = subreq;
+	}
+
+	if (prev)
+		netfs_read_from_server(rreq, prev);
+}
+
 /*
  * Begin the process of reading in a chunk of data, where that data may be
  * stitched together from multiple sources, including multiple servers and the
@@ -630,6 +811,8 @@ int netfs_begin_read(struct netfs_io_request *rreq, bool sync)
 
 	} while (rreq->submitted < rreq->len);
 
+	netfs_rreq_issue_downloads(rreq);
+
 	if (sync) {
 		/* Keep nr_outstanding incremented so that the ref always belongs to
 		 * us, and the service code isn't punted off to a random thread pool to
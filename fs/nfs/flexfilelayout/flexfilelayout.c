@@ -678,10 +678,18 @@ nfs4_ff_layout_stat_io_end_read(struct rpc_task *task,
 		__u64 requested,
 		__u64 completed)
 {
+	ktime_t now = ktime_get();
+	u32 latency;
+
+	latency = min_t(s64, ktime_us_delta(now, task->tk_start), U32_MAX >> 3);
 	spin_lock(&mirror->lock);
 	nfs4_ff_layout_stat_io_update_completed(&mirror->read_stat,
-			requested, completed,
-			ktime_get(), task->tk_start);
+			requested, completed, now, task->tk_start);
+	/* the same 1/8 gain as the TCP srtt */
+	if (mirror->read_latency_us)
+		mirror->read_latency_us += latency - (mirror->read_latency_us >> 3);
+	else
+		mirror->read_latency_us = latency << 3;
 	set_bit(NFS4_FF_MIRROR_STAT_AVAIL, &mirror->flags);
 	spin_unlock(&mirror->lock);
 }
@@ -738,6 +746,19 @@ ff_layout_mark_ds_reachable(struct pnfs_layout_segment *lseg, u32 idx)
 		nfs4_mark_deviceid_available(devid);
 }
 
+/*
+ * The expected wait for a new read on @mirror: its smoothed read latency
+ * times the reads it already has in flight, plus this one.  A mirror that
+ * has not completed a read yet costs nothing, so that it gets measured.
+ */
+static u64
+ff_layout_mirror_read_cost(struct nfs4_ff_layout_mirror *mirror)
+{
+	u64 inflight = atomic_read(&mirror->read_stat.busy_timer.n_ops);
+
+	return (u64)READ_ONCE(mirror->read_latency_us) * (inflight + 1);
+}
+
 static struct nfs4_pnfs_ds *
 ff_layout_choose_ds_for_read(struct pnfs_layout_segment *lseg,
 			     u32 start_idx, u32 *best_idx,
@@ -745,25 +766,41 @@ ff_layout_choose_ds_for_read(struct pnfs_layout_segment *lseg,
 {
 	struct nfs4_ff_layout_segment *fls = FF_LAYOUT_LSEG(lseg);
 	struct nfs4_ff_layout_mirror *mirror;
-	struct nfs4_pnfs_ds *ds;
+	struct nfs4_pnfs_ds *ds, *best_ds = NULL;
+	u64 cost, best_cost = U64_MAX;
 	u32 idx;
 
-	/* mirrors are initially sorted by efficiency */
+	/*
+	 * Mirrors are initially sorted by efficiency.  Among the usable ones,
+	 * read from the one expected to answer first, the earlier one on a
+	 * tie.  Any mirror will do when the devices are not checked, as then
+	 * we are only looking for one that can be tried at all.
+	 */
 	for (idx = start_idx; idx < fls->mirror_array_cnt; idx++) {
 		mirror = FF_LAYOUT_COMP(lseg, idx);
 		ds = nfs4_ff_layout_prepare_ds(lseg, mirror, false);
 		if (!ds)
 			continue;
 
-		if (check_device &&
-		    nfs4_test_deviceid_unavailable(&mirror->mirror_ds->id_node))
+		if (!check_device) {
+			*best_idx = idx;
+			return ds;
+		}
+
+		if (nfs4_test_deviceid_unavailable(&mirror->mirror_ds->id_node))
 			continue;
 
-		*best_idx = idx;
-		return ds;
+		cost = ff_layout_mirror_read_cost(mirror);
+		if (cost < best_cost) {
+			best_cost = cost;
+			best_ds = ds;
+			*best_idx = idx;
+			if (!cost)
+				break;
+		}
 	}
 
-	return NULL;
+	return best_ds;
 }
 
 static struct nfs4_pnfs_ds *
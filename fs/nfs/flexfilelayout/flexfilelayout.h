@@ -90,6 +90,7 @@ struct nfs4_ff_layout_mirror {
 	struct nfs4_ff_layoutstat	write_stat;
 	ktime_t				start_time;
 	u32				report_interval;
+	u32				read_latency_us; /* smoothed, << 3 */
 };
 
 #define NFS4_FF_MIRROR_STAT_AVAIL	(0)
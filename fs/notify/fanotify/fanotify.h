@@ -463,11 +463,12 @@ static inline const struct path *fanotify_event_path(struct fanotify_event *even
 }
 
 /*
- * Use 128 size hash table to speed up events merge.
+ * Use a hash table to speed up events merge.  It has 128 buckets for the
+ * default queue size and grows with the queue limit of the group, so that
+ * the chains stay short on groups with large or unlimited queues.
  */
-#define FANOTIFY_HTABLE_BITS	(7)
-#define FANOTIFY_HTABLE_SIZE	(1 << FANOTIFY_HTABLE_BITS)
-#define FANOTIFY_HTABLE_MASK	(FANOTIFY_HTABLE_SIZE - 1)
+#define FANOTIFY_HTABLE_BITS		(7)
+#define FANOTIFY_HTABLE_MAX_BITS	(12)
 
 /*
  * Permission events and overflow event do not get merged - don't hash them.
@@ -482,7 +483,8 @@ static inline unsigned int fanotify_event_hash_bucket(
 						struct fsnotify_group *group,
 						struct fanotify_event *event)
 {
-	return event->hash & FANOTIFY_HTABLE_MASK;
+	return event->hash &
+		((1U << group->fanotify_data.merge_hash_bits) - 1);
 }
 
 static inline unsigned int fanotify_mark_user_flags(struct fsnotify_mark *mark)
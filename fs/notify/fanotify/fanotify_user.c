@@ -206,47 +206,88 @@ static void fanotify_unhash_event(struct fsnotify_group *group,
 	hlist_del_init(&event->merge_list);
 }
 
+/* Most events we take off the queue with one acquisition of the lock */
+#define FANOTIFY_READ_BATCH	16
+
 /*
- * Get an fanotify notification event if one exists and is small
- * enough to fit in "count". Return an error pointer if the count
- * is not large enough. When permission event is dequeued, its state is
- * updated accordingly.
+ * Move as many fanotify notification events as fit in "count" onto "batch",
+ * up to FANOTIFY_READ_BATCH of them.  Return the number of events taken, or
+ * -EINVAL if the first event does not fit in "count".  When permission event
+ * is dequeued, its state is updated accordingly.  A permission event is only
+ * ever taken on its own, so that it is always reported once it is dequeued.
  */
-static struct fanotify_event *get_one_event(struct fsnotify_group *group,
-					    size_t count)
+static int get_events(struct fsnotify_group *group, size_t count,
+		      struct list_head *batch)
 {
 	size_t event_size;
-	struct fanotify_event *event = NULL;
+	struct fanotify_event *event;
 	struct fsnotify_event *fsn_event;
 	unsigned int info_mode = FAN_GROUP_FLAG(group, FANOTIFY_INFO_MODES);
+	int nr = 0;
 
 	pr_debug("%s: group=%p count=%zd\n", __func__, group, count);
 
 	spin_lock(&group->notification_lock);
-	fsn_event = fsnotify_peek_first_event(group);
-	if (!fsn_event)
-		goto out;
+	while (nr < FANOTIFY_READ_BATCH) {
+		fsn_event = fsnotify_peek_first_event(group);
+		if (!fsn_event)
+			break;
 
-	event = FANOTIFY_E(fsn_event);
-	event_size = fanotify_event_len(info_mode, event);
+		event = FANOTIFY_E(fsn_event);
+		event_size = fanotify_event_len(info_mode, event);
 
-	if (event_size > count) {
-		event = ERR_PTR(-EINVAL);
-		goto out;
+		if (event_size > count) {
+			if (!nr)
+				nr = -EINVAL;
+			break;
+		}
+		if (nr && fanotify_is_perm_event(event->mask))
+			break;
+
+		/*
+		 * Held the notification_lock the whole time, so this is the
+		 * same event we peeked above.
+		 */
+		fsnotify_remove_first_event(group);
+		list_add_tail(&fsn_event->list, batch);
+		nr++;
+		count -= event_size;
+
+		if (fanotify_is_perm_event(event->mask)) {
+			FANOTIFY_PERM(event)->state = FAN_EVENT_REPORTED;
+			break;
+		}
+		if (fanotify_is_hashed_event(event->mask))
+			fanotify_unhash_event(group, event);
 	}
+	spin_unlock(&group->notification_lock);
+	return nr;
+}
 
-	/*
-	 * Held the notification_lock the whole time, so this is the
-	 * same event we peeked above.
-	 */
-	fsnotify_remove_first_event(group);
-	if (fanotify_is_perm_event(event->mask))
-		FANOTIFY_PERM(event)->state = FAN_EVENT_REPORTED;
-	if (fanotify_is_hashed_event(event->mask))
-		fanotify_unhash_event(group, event);
-out:
+/*
+ * Put events we took off the queue but did not get to report back at the
+ * head of the queue in their original order.  These are never permission
+ * events.
+ */
+static void requeue_events(struct fsnotify_group *group,
+			   struct list_head *batch)
+{
+	struct fanotify_event *event;
+	struct hlist_head *hlist;
+
+	spin_lock(&group->notification_lock);
+	while (!list_empty(batch)) {
+		event = FANOTIFY_E(list_last_entry(batch, struct fsnotify_event,
+						   list));
+		list_del_init(&event->fse.list);
+		fsnotify_requeue_event(group, &event->fse);
+		if (fanotify_is_hashed_event(event->mask)) {
+			hlist = &group->fanotify_data.merge_hash[
+				fanotify_event_hash_bucket(group, event)];
+			hlist_add_head(&event->merge_list, hlist);
+		}
+	}
 	spin_unlock(&group->notification_lock);
-	return event;
 }
 
 static int create_fd(struct fsnotify_group *group, const struct path *path,
@@ -686,7 +727,7 @@ static ssize_t copy_event_to_user(struct fsnotify_group *group,
 
 	ret = -EFAULT;
 	/*
-	 * Sanity check copy size in case get_one_event() and
+	 * Sanity check copy size in case get_events() and
 	 * event_len sizes ever get out of sync.
 	 */
 	if (WARN_ON_ONCE(metadata.event_len > count))
@@ -746,6 +787,7 @@ static ssize_t fanotify_read(struct file *file, char __user *buf,
 	struct fsnotify_group *group;
 	struct fanotify_event *event;
 	char __user *start;
+	LIST_HEAD(batch);
 	int ret;
 	DEFINE_WAIT_FUNC(wait, woken_wake_function);
 
@@ -761,13 +803,13 @@ static ssize_t fanotify_read(struct file *file, char __user *buf,
 		 * in case there are lots of available events.
 		 */
 		cond_resched();
-		event = get_one_event(group, count);
-		if (IS_ERR(event)) {
-			ret = PTR_ERR(event);
-			break;
+		if (list_empty(&batch)) {
+			ret = get_events(group, count, &batch);
+			if (ret < 0)
+				break;
 		}
 
-		if (!event) {
+		if (list_empty(&batch)) {
 			ret = -EAGAIN;
 			if (file->f_flags & O_NONBLOCK)
 				break;
@@ -783,6 +825,9 @@ static ssize_t fanotify_read(struct file *file, char __user *buf,
 			continue;
 		}
 
+		event = FANOTIFY_E(list_first_entry(&batch,
+						    struct fsnotify_event, list));
+		list_del_init(&event->fse.list);
 		ret = copy_event_to_user(group, event, buf, count);
 		if (unlikely(ret == -EOPENSTALE)) {
 			/*
@@ -820,6 +865,9 @@ static ssize_t fanotify_read(struct file *file, char __user *buf,
 	}
 	remove_wait_queue(&group->notification_waitq, &wait);
 
+	if (!list_empty(&batch))
+		requeue_events(group, &batch);
+
 	if (start != buf && ret != -EFAULT)
 		ret = buf - start;
 	return ret;
@@ -1326,18 +1374,27 @@ static struct fsnotify_event *fanotify_alloc_overflow_event(void)
 	return &oevent->fse;
 }
 
-static struct hlist_head *fanotify_alloc_merge_hash(void)
+/*
+ * Size the merge hash so that a full queue averages about 128 events per
+ * bucket, which is the most fanotify_merge() will look at.
+ */
+static int fanotify_alloc_merge_hash(struct fsnotify_group *group)
 {
 	struct hlist_head *hash;
+	unsigned int bits;
 
-	hash = kmalloc(sizeof(struct hlist_head) << FANOTIFY_HTABLE_BITS,
-		       GFP_KERNEL_ACCOUNT);
+	bits = clamp_t(int, ilog2(max(group->max_events, 1U)) - 7,
+		       FANOTIFY_HTABLE_BITS, FANOTIFY_HTABLE_MAX_BITS);
+	hash = kvmalloc_array(1U << bits, sizeof(struct hlist_head),
+			      GFP_KERNEL_ACCOUNT);
 	if (!hash)
-		return NULL;
+		return -ENOMEM;
 
-	__hash_init(hash, FANOTIFY_HTABLE_SIZE);
+	__hash_init(hash, 1U << bits);
+	group->fanotify_data.merge_hash = hash;
+	group->fanotify_data.merge_hash_bits = bits;
 
-	return hash;
+	return 0;
 }
 
 /* fanotify syscalls */
@@ -1441,12 +1498,6 @@ SYSCALL_DEFINE2(fanotify_init, unsigned int, flags, unsigned int, event_f_flags)
 	group->fanotify_data.flags = flags | internal_flags;
 	group->memcg = get_mem_cgroup_from_mm(current->mm);
 
-	group->fanotify_data.merge_hash = fanotify_alloc_merge_hash();
-	if (!group->fanotify_data.merge_hash) {
-		fd = -ENOMEM;
-		goto out_destroy_group;
-	}
-
 	group->overflow_event = fanotify_alloc_overflow_event();
 	if (unlikely(!group->overflow_event)) {
 		fd = -ENOMEM;
@@ -1482,6 +1533,10 @@ SYSCALL_DEFINE2(fanotify_init, unsigned int, flags, unsigned int, event_f_flags)
 		group->max_events = fanotify_max_queued_events;
 	}
 
+	fd = fanotify_alloc_merge_hash(group);
+	if (fd)
+		goto out_destroy_group;
+
 	if (flags & FAN_UNLIMITED_MARKS) {
 		fd = -EPERM;
 		if (!capable(CAP_SYS_ADMIN))
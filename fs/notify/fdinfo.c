@@ -137,6 +137,8 @@ void fanotify_show_fdinfo(struct seq_file *m, struct file *f)
 	seq_printf(m, "fanotify flags:%x event-flags:%x\n",
 		   group->fanotify_data.flags & FANOTIFY_INIT_FLAGS,
 		   group->fanotify_data.f_flags);
+	seq_printf(m, "fanotify queued:%u dropped:%lu\n",
+		   READ_ONCE(group->q_len), READ_ONCE(group->q_dropped));
 
 	show_fdinfo(m, f, fanotify_fdinfo);
 }
@@ -116,6 +116,46 @@ __u32 fsnotify_conn_mask(struct fsnotify_mark_connector *conn)
 	return *fsnotify_conn_mask_p(conn);
 }
 
+/*
+ * Add the mask of a watched object to the interest mask of its sb.  The
+ * object has already been counted in s_fsnotify_connectors; order that before
+ * we look at the mask, even when it turns out to hold our events already, so
+ * that fsnotify_put_sb_watch() either sees the count or clears the mask before
+ * we read it.
+ */
+static void fsnotify_update_sb_interest(struct super_block *sb, __u32 mask)
+{
+	mask &= ALL_FSNOTIFY_EVENTS;
+	if (!sb)
+		return;
+
+	/* Pairs with smp_mb() in fsnotify_put_sb_watch() */
+	smp_mb();
+	if (!(mask & ~atomic_read(&sb->s_fsnotify_interest)))
+		return;
+
+	atomic_or(mask, &sb->s_fsnotify_interest);
+}
+
+/*
+ * Drop the count of watched objects on an sb.  Once nothing is watched, the
+ * interest mask starts again from scratch.  If a new watch raced with us and
+ * we can't tell whether its mask made it in, assume interest in everything
+ * until the sb is unwatched again.
+ */
+static void fsnotify_put_sb_watch(struct super_block *sb)
+{
+	if (!atomic_long_dec_and_test(&sb->s_fsnotify_connectors))
+		return;
+
+	atomic_set(&sb->s_fsnotify_interest, 0);
+	/* Pairs with smp_mb() in fsnotify_update_sb_interest() */
+	smp_mb();
+	if (atomic_long_read(&sb->s_fsnotify_connectors))
+		atomic_set(&sb->s_fsnotify_interest, ALL_FSNOTIFY_EVENTS);
+	wake_up_var(&sb->s_fsnotify_connectors);
+}
+
 static void fsnotify_get_inode_ref(struct inode *inode)
 {
 	ihold(inode);
@@ -172,6 +212,7 @@ static void *__fsnotify_recalc_mask(struct fsnotify_mark_connector *conn)
 			want_iref = true;
 	}
 	*fsnotify_conn_mask_p(conn) = new_mask;
+	fsnotify_update_sb_interest(fsnotify_connector_sb(conn), new_mask);
 
 	return fsnotify_update_iref(conn, want_iref);
 }
@@ -218,8 +259,7 @@ static void fsnotify_put_inode_ref(struct inode *inode)
 	struct super_block *sb = inode->i_sb;
 
 	iput(inode);
-	if (atomic_long_dec_and_test(&sb->s_fsnotify_connectors))
-		wake_up_var(&sb->s_fsnotify_connectors);
+	fsnotify_put_sb_watch(sb);
 }
 
 static void fsnotify_get_sb_connectors(struct fsnotify_mark_connector *conn)
@@ -234,8 +274,8 @@ static void fsnotify_put_sb_connectors(struct fsnotify_mark_connector *conn)
 {
 	struct super_block *sb = fsnotify_connector_sb(conn);
 
-	if (sb && atomic_long_dec_and_test(&sb->s_fsnotify_connectors))
-		wake_up_var(&sb->s_fsnotify_connectors);
+	if (sb)
+		fsnotify_put_sb_watch(sb);
 }
 
 static void *fsnotify_detach_connector_from_object(
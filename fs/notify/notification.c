@@ -100,6 +100,8 @@ int fsnotify_insert_event(struct fsnotify_group *group,
 	if (event == group->overflow_event ||
 	    group->q_len >= group->max_events) {
 		ret = 2;
+		if (event != group->overflow_event)
+			group->q_dropped++;
 		/* Queue overflow event only if it isn't already queued */
 		if (!list_empty(&group->overflow_event->list)) {
 			spin_unlock(&group->notification_lock);
@@ -141,6 +143,18 @@ void fsnotify_remove_queued_event(struct fsnotify_group *group,
 	group->q_len--;
 }
 
+/*
+ * Put an event that was taken off the notification list but not consumed back
+ * at the head of the list, so that it is the next one to be read.
+ */
+void fsnotify_requeue_event(struct fsnotify_group *group,
+			    struct fsnotify_event *event)
+{
+	assert_spin_locked(&group->notification_lock);
+	list_add(&event->list, &group->notification_list);
+	group->q_len++;
+}
+
 /*
  * Return the first event on the notification list without removing it.
  * Returns NULL if the list is empty.
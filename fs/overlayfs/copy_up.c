@@ -1117,11 +1117,31 @@ static bool ovl_open_need_copy_up(struct dentry *dentry, int flags)
 	return true;
 }
 
+/*
+ * With metacopy, opening a large file write-only (e.g. to append to a log)
+ * only needs the metadata copied up; data copy-up is deferred until the file
+ * is actually modified, which may be never.  Write-only files cannot be
+ * mmapped, so every modification goes through ovl file operations that copy
+ * up data first.
+ */
+static bool ovl_open_defer_data_copy_up(struct dentry *dentry, int flags)
+{
+	struct ovl_fs *ofs = OVL_FS(dentry->d_sb);
+
+	if (!ofs->config.metacopy || !d_is_reg(dentry))
+		return false;
+
+	return (flags & O_ACCMODE) == O_WRONLY && !(flags & O_TRUNC);
+}
+
 int ovl_maybe_copy_up(struct dentry *dentry, int flags)
 {
 	int err = 0;
 
 	if (ovl_open_need_copy_up(dentry, flags)) {
+		if (ovl_open_defer_data_copy_up(dentry, flags))
+			flags = 0;
+
 		err = ovl_want_write(dentry);
 		if (!err) {
 			err = ovl_copy_up_flags(dentry, flags);
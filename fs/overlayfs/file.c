@@ -24,6 +24,13 @@ struct ovl_aio_req {
 
 static struct kmem_cache *ovl_aio_request_cachep;
 
+struct ovl_file {
+	/* Real file opened by ovl_open() */
+	struct file *realfile;
+	/* Upper file opened if the inode was copied up after ovl_open() */
+	struct file *upperfile;
+};
+
 static char ovl_whatisit(struct inode *inode, struct inode *realinode)
 {
 	if (realinode != ovl_inode_upper(inode))
@@ -46,9 +53,19 @@ static struct file *ovl_open_realfile(const struct file *file,
 	struct file *realfile;
 	const struct cred *old_cred;
 	int flags = file->f_flags | OVL_OPEN_FLAGS;
-	int acc_mode = ACC_MODE(flags);
+	int acc_mode;
 	int err;
 
+	/*
+	 * Data copy-up of a write-only file may be deferred until its first
+	 * modification (see ovl_maybe_copy_up()).  Until then only the lower
+	 * data is there to back the file, so open it read-only.
+	 */
+	if ((OPEN_FMODE(flags) & FMODE_WRITE) &&
+	    realinode != ovl_inode_upper(inode))
+		flags = (flags & ~O_ACCMODE) | O_RDONLY;
+
+	acc_mode = ACC_MODE(flags);
 	if (flags & O_APPEND)
 		acc_mode |= MAY_APPEND;
 
@@ -106,26 +123,44 @@ static int ovl_real_fdget_meta(const struct file *file, struct fd *real,
 			       bool allow_meta)
 {
 	struct dentry *dentry = file_dentry(file);
+	struct ovl_file *of = file->private_data;
+	struct file *upperfile, *old;
 	struct path realpath;
 
 	real->flags = 0;
-	real->file = file->private_data;
+	real->file = of->realfile;
 
 	if (allow_meta)
 		ovl_path_real(dentry, &realpath);
 	else
 		ovl_path_realdata(dentry, &realpath);
 
-	/* Has it been copied up since we'd opened it? */
+	/*
+	 * Has it been copied up since we'd opened it?  Open the upper file
+	 * once and keep it around for the following operations.
+	 */
 	if (unlikely(file_inode(real->file) != d_inode(realpath.dentry))) {
-		real->flags = FDPUT_FPUT;
-		real->file = ovl_open_realfile(file, &realpath);
-
-		return PTR_ERR_OR_ZERO(real->file);
+		upperfile = READ_ONCE(of->upperfile);
+		if (!upperfile) {
+			upperfile = ovl_open_realfile(file, &realpath);
+			if (IS_ERR(upperfile))
+				return PTR_ERR(upperfile);
+
+			old = cmpxchg(&of->upperfile, NULL, upperfile);
+			if (old) {
+				fput(upperfile);
+				upperfile = old;
+			}
+		}
+		real->file = upperfile;
 	}
 
-	/* Did the flags change since open? */
-	if (unlikely((file->f_flags ^ real->file->f_flags) & ~OVL_OPEN_FLAGS))
+	/*
+	 * Did the flags change since open?  The access mode cannot change, but
+	 * may legitimately differ for a write-only file backed by lower data.
+	 */
+	if (unlikely((file->f_flags ^ real->file->f_flags) &
+		     ~(OVL_OPEN_FLAGS | O_ACCMODE)))
 		return ovl_change_flags(real->file, file->f_flags);
 
 	return 0;
@@ -143,9 +178,31 @@ static int ovl_real_fdget(const struct file *file, struct fd *real)
 	return ovl_real_fdget_meta(file, real, false);
 }
 
+/*
+ * Copy up data deferred by ovl_maybe_copy_up() before the file is modified.
+ * Write-only files cannot be mmapped, so every modification goes through one
+ * of the file operations calling this.
+ */
+static int ovl_copy_up_deferred(struct file *file)
+{
+	struct dentry *dentry = file_dentry(file);
+	int err;
+
+	if (ovl_has_upperdata(file_inode(file)))
+		return 0;
+
+	err = ovl_want_write(dentry);
+	if (!err) {
+		err = ovl_copy_up_with_data(dentry);
+		ovl_drop_write(dentry);
+	}
+	return err;
+}
+
 static int ovl_open(struct inode *inode, struct file *file)
 {
 	struct dentry *dentry = file_dentry(file);
+	struct ovl_file *of;
 	struct file *realfile;
 	struct path realpath;
 	int err;
@@ -157,19 +214,31 @@ static int ovl_open(struct inode *inode, struct file *file)
 	/* No longer need these flags, so don't pass them on to underlying fs */
 	file->f_flags &= ~(O_CREAT | O_EXCL | O_NOCTTY | O_TRUNC);
 
+	of = kzalloc(sizeof(*of), GFP_KERNEL);
+	if (!of)
+		return -ENOMEM;
+
 	ovl_path_realdata(dentry, &realpath);
 	realfile = ovl_open_realfile(file, &realpath);
-	if (IS_ERR(realfile))
+	if (IS_ERR(realfile)) {
+		kfree(of);
 		return PTR_ERR(realfile);
+	}
 
-	file->private_data = realfile;
+	of->realfile = realfile;
+	file->private_data = of;
 
 	return 0;
 }
 
 static int ovl_release(struct inode *inode, struct file *file)
 {
-	fput(file->private_data);
+	struct ovl_file *of = file->private_data;
+
+	fput(of->realfile);
+	if (of->upperfile)
+		fput(of->upperfile);
+	kfree(of);
 
 	return 0;
 }
@@ -364,6 +433,10 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 	if (ret)
 		goto out_unlock;
 
+	ret = ovl_copy_up_deferred(file);
+	if (ret)
+		goto out_unlock;
+
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
 		goto out_unlock;
@@ -442,6 +515,10 @@ static ssize_t ovl_splice_write(struct pipe_inode_info *pipe, struct file *out,
 	if (ret)
 		goto out_unlock;
 
+	ret = ovl_copy_up_deferred(out);
+	if (ret)
+		goto out_unlock;
+
 	ret = ovl_real_fdget(out, &real);
 	if (ret)
 		goto out_unlock;
@@ -491,7 +568,8 @@ static int ovl_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 
 static int ovl_mmap(struct file *file, struct vm_area_struct *vma)
 {
-	struct file *realfile = file->private_data;
+	struct ovl_file *of = file->private_data;
+	struct file *realfile = of->realfile;
 	const struct cred *old_cred;
 	int ret;
 
@@ -525,6 +603,10 @@ static long ovl_fallocate(struct file *file, int mode, loff_t offset, loff_t len
 	if (ret)
 		goto out_unlock;
 
+	ret = ovl_copy_up_deferred(file);
+	if (ret)
+		goto out_unlock;
+
 	ret = ovl_real_fdget(file, &real);
 	if (ret)
 		goto out_unlock;
@@ -585,6 +667,10 @@ static loff_t ovl_copyfile(struct file *file_in, loff_t pos_in,
 		ret = file_remove_privs(file_out);
 		if (ret)
 			goto out_unlock;
+
+		ret = ovl_copy_up_deferred(file_out);
+		if (ret)
+			goto out_unlock;
 	}
 
 	ret = ovl_real_fdget(file_out, &real_out);
@@ -657,7 +743,8 @@ static loff_t ovl_remap_file_range(struct file *file_in, loff_t pos_in,
 	 */
 	if (op == OVL_DEDUPE &&
 	    (!ovl_inode_upper(file_inode(file_in)) ||
-	     !ovl_inode_upper(file_inode(file_out))))
+	     !ovl_inode_upper(file_inode(file_out)) ||
+	     !ovl_has_upperdata(file_inode(file_out))))
 		return -EPERM;
 
 	return ovl_copyfile(file_in, pos_in, file_out, pos_out, len,
@@ -126,7 +126,10 @@ static inline struct ovl_entry *OVL_E(struct dentry *dentry)
 
 struct ovl_inode {
 	union {
-		struct ovl_dir_cache *cache;	/* directory */
+		struct {
+			struct ovl_dir_cache *cache;	/* directory */
+			struct ovl_dir_cache *lowercache; /* merged lower dirs */
+		};
 		struct inode *lowerdata;	/* regular file */
 	};
 	const char *redirect;
@@ -33,6 +33,7 @@ struct ovl_dir_cache {
 	u64 version;
 	struct list_head entries;
 	struct rb_root root;
+	unsigned int nr_lowest;	/* lower cache: entries of the lowest layer */
 };
 
 struct ovl_readdir_data {
@@ -43,6 +44,7 @@ struct ovl_readdir_data {
 	struct list_head *list;
 	struct list_head middle;
 	struct ovl_cache_entry *first_maybe_whiteout;
+	unsigned int nr_lowest;
 	int count;
 	int err;
 	bool is_upper;
@@ -170,6 +172,18 @@ static struct ovl_cache_entry *ovl_cache_entry_new(struct ovl_readdir_data *rdd,
 	return p;
 }
 
+static struct ovl_cache_entry *
+ovl_cache_entry_dup(const struct ovl_cache_entry *p)
+{
+	size_t size = offsetof(struct ovl_cache_entry, name[p->len + 1]);
+	struct ovl_cache_entry *q;
+
+	q = kmemdup(p, size, GFP_KERNEL);
+	if (q)
+		q->next_maybe_whiteout = NULL;
+	return q;
+}
+
 static bool ovl_cache_entry_add_rb(struct ovl_readdir_data *rdd,
 				  const char *name, int len, u64 ino,
 				  unsigned int d_type)
@@ -210,6 +224,8 @@ static bool ovl_fill_lowest(struct ovl_readdir_data *rdd,
 		else
 			list_add_tail(&p->l_node, &rdd->middle);
 	}
+	if (!rdd->err)
+		rdd->nr_lowest++;
 
 	return rdd->err == 0;
 }
@@ -228,11 +244,17 @@ void ovl_cache_free(struct list_head *list)
 void ovl_dir_cache_free(struct inode *inode)
 {
 	struct ovl_dir_cache *cache = ovl_dir_cache(inode);
+	struct ovl_dir_cache *lowercache = ovl_dir_lower_cache(inode);
 
 	if (cache) {
 		ovl_cache_free(&cache->entries);
 		kfree(cache);
 	}
+	if (lowercache) {
+		ovl_cache_free(&lowercache->entries);
+		kfree(lowercache);
+		ovl_set_dir_lower_cache(inode, NULL);
+	}
 }
 
 static void ovl_cache_put(struct ovl_dir_file *od, struct inode *inode)
@@ -340,8 +362,9 @@ static void ovl_dir_reset(struct file *file)
 	}
 }
 
-static int ovl_dir_read_merged(struct dentry *dentry, struct list_head *list,
-	struct rb_root *root)
+static int ovl_dir_read_layers(struct dentry *dentry, struct list_head *list,
+			       struct rb_root *root, bool skip_upper,
+			       unsigned int *nr_lowest)
 {
 	int err;
 	struct path realpath;
@@ -357,6 +380,8 @@ static int ovl_dir_read_merged(struct dentry *dentry, struct list_head *list,
 	for (idx = 0; idx != -1; idx = next) {
 		next = ovl_path_next(idx, dentry, &realpath);
 		rdd.is_upper = ovl_dentry_upper(dentry) == realpath.dentry;
+		if (rdd.is_upper && skip_upper)
+			continue;
 
 		if (next != -1) {
 			err = ovl_dir_read(&realpath, &rdd);
@@ -373,6 +398,100 @@ static int ovl_dir_read_merged(struct dentry *dentry, struct list_head *list,
 			list_del(&rdd.middle);
 		}
 	}
+	if (nr_lowest)
+		*nr_lowest = rdd.nr_lowest;
+	return err;
+}
+
+static int ovl_dir_read_merged(struct dentry *dentry, struct list_head *list,
+	struct rb_root *root)
+{
+	return ovl_dir_read_layers(dentry, list, root, false, NULL);
+}
+
+/*
+ * Lower layers cannot change while the overlay is mounted, so for directories
+ * merged from several lower layers keep the merged lower entries for the
+ * lifetime of the inode.  Invalidating the merged cache (by modifying the
+ * directory) then only costs re-reading the upper directory.
+ */
+static bool ovl_dir_use_lower_cache(struct dentry *dentry)
+{
+	return OVL_E(dentry)->numlower > 1;
+}
+
+static int ovl_dir_read_merged_cached(struct dentry *dentry,
+				      struct list_head *list,
+				      struct rb_root *root)
+{
+	struct inode *inode = d_inode(dentry);
+	struct ovl_dir_cache *lowercache = ovl_dir_lower_cache(inode);
+	struct ovl_cache_entry *p, *q;
+	struct path upperpath;
+	unsigned int i = 0;
+	LIST_HEAD(middle);
+	int err = 0;
+
+	if (!lowercache) {
+		lowercache = kzalloc(sizeof(*lowercache), GFP_KERNEL);
+		if (!lowercache)
+			return -ENOMEM;
+
+		INIT_LIST_HEAD(&lowercache->entries);
+		lowercache->root = RB_ROOT;
+		err = ovl_dir_read_layers(dentry, &lowercache->entries,
+					  &lowercache->root, true,
+					  &lowercache->nr_lowest);
+		if (err) {
+			ovl_cache_free(&lowercache->entries);
+			kfree(lowercache);
+			return err;
+		}
+		ovl_set_dir_lower_cache(inode, lowercache);
+	}
+
+	ovl_path_upper(dentry, &upperpath);
+	if (upperpath.dentry) {
+		struct ovl_readdir_data rdd = {
+			.ctx.actor = ovl_fill_merge,
+			.dentry = dentry,
+			.list = list,
+			.root = root,
+			.is_lowest = false,
+			.is_upper = true,
+		};
+
+		err = ovl_dir_read(&upperpath, &rdd);
+		if (err)
+			return err;
+	}
+
+	/*
+	 * Same order as ovl_dir_read_layers(): the names of the lowest layer
+	 * first, in its order, then the upper entries, then the entries of
+	 * the other lower layers.  The lower cache starts with the nr_lowest
+	 * names of the lowest layer and goes on with those of the other lower
+	 * layers, in the order that the full merge adds them.  An upper entry
+	 * takes the place of the lower entry of the same name.
+	 */
+	list_for_each_entry(p, &lowercache->entries, l_node) {
+		bool lowest = i++ < lowercache->nr_lowest;
+
+		q = ovl_cache_entry_find(root, p->name, p->len);
+		if (q) {
+			if (lowest)
+				list_move_tail(&q->l_node, &middle);
+			continue;
+		}
+		q = ovl_cache_entry_dup(p);
+		if (!q) {
+			err = -ENOMEM;
+			break;
+		}
+		list_add_tail(&q->l_node, lowest ? &middle : list);
+	}
+	list_splice(&middle, list);
+
 	return err;
 }
 
@@ -412,7 +531,12 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 	INIT_LIST_HEAD(&cache->entries);
 	cache->root = RB_ROOT;
 
-	res = ovl_dir_read_merged(dentry, &cache->entries, &cache->root);
+	if (ovl_dir_use_lower_cache(dentry))
+		res = ovl_dir_read_merged_cached(dentry, &cache->entries,
+						 &cache->root);
+	else
+		res = ovl_dir_read_merged(dentry, &cache->entries,
+					  &cache->root);
 	if (res) {
 		ovl_cache_free(&cache->entries);
 		kfree(cache);
@@ -186,6 +186,7 @@ static struct inode *ovl_alloc_inode(struct super_block *sb)
 		return NULL;
 
 	oi->cache = NULL;
+	oi->lowercache = NULL;
 	oi->redirect = NULL;
 	oi->version = 0;
 	oi->flags = 0;
@@ -311,6 +311,16 @@ void ovl_set_dir_cache(struct inode *inode, struct ovl_dir_cache *cache)
 	OVL_I(inode)->cache = cache;
 }
 
+struct ovl_dir_cache *ovl_dir_lower_cache(struct inode *inode)
+{
+	return OVL_I(inode)->lowercache;
+}
+
+void ovl_set_dir_lower_cache(struct inode *inode, struct ovl_dir_cache *cache)
+{
+	OVL_I(inode)->lowercache = cache;
+}
+
 void ovl_dentry_set_flag(unsigned long flag, struct dentry *dentry)
 {
 	set_bit(flag, &OVL_E(dentry)->flags);
@@ -19,6 +19,7 @@
 #include <linux/shmem_fs.h>
 #include <linux/uaccess.h>
 #include <linux/pkeys.h>
+#include <uapi/linux/smaps_summary.h>
 
 #include <asm/elf.h>
 #include <asm/tlb.h>
@@ -882,41 +883,36 @@ static int show_smap(struct seq_file *m, void *v)
 	return 0;
 }
 
-static int show_smaps_rollup(struct seq_file *m, void *v)
+/*
+ * Walk all the VMAs of @mm and add up their stats in @mss.  The caller holds a
+ * reference on @mm and has priv->task set.  On return @vma_start and
+ * @last_vma_end give the range that was covered.
+ */
+static int smap_gather_rollup(struct proc_maps_private *priv,
+			      struct mm_struct *mm, struct mem_size_stats *mss,
+			      unsigned long *vma_start,
+			      unsigned long *last_vma_end)
 {
-	struct proc_maps_private *priv = m->private;
-	struct mem_size_stats mss;
-	struct mm_struct *mm = priv->mm;
 	struct vm_area_struct *vma;
-	unsigned long vma_start = 0, last_vma_end = 0;
-	int ret = 0;
+	int ret;
 	MA_STATE(mas, &mm->mm_mt, 0, 0);
 
-	priv->task = get_proc_task(priv->inode);
-	if (!priv->task)
-		return -ESRCH;
-
-	if (!mm || !mmget_not_zero(mm)) {
-		ret = -ESRCH;
-		goto out_put_task;
-	}
-
-	memset(&mss, 0, sizeof(mss));
+	*vma_start = *last_vma_end = 0;
 
 	ret = mmap_read_lock_killable(mm);
 	if (ret)
-		goto out_put_mm;
+		return ret;
 
 	hold_task_mempolicy(priv);
 	vma = mas_find(&mas, ULONG_MAX);
 
 	if (unlikely(!vma))
-		goto empty_set;
+		goto out_unlock;
 
-	vma_start = vma->vm_start;
+	*vma_start = vma->vm_start;
 	do {
-		smap_gather_stats(vma, &mss, 0);
-		last_vma_end = vma->vm_end;
+		smap_gather_stats(vma, mss, 0);
+		*last_vma_end = vma->vm_end;
 
 		/*
 		 * Release mmap_lock temporarily if someone wants to
@@ -928,7 +924,7 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 			ret = mmap_read_lock_killable(mm);
 			if (ret) {
 				release_task_mempolicy(priv);
-				goto out_put_mm;
+				return ret;
 			}
 
 			/*
@@ -944,7 +940,7 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 			 * Suppose we drop the lock after reading VMA2 due to
 			 * contention, then we get:
 			 *
-			 *	last_vma_end = 16k
+			 *	*last_vma_end = 16k
 			 *
 			 * 1) VMA2 is freed, but VMA3 exists:
 			 *
@@ -964,8 +960,8 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 			 * 4) (last_vma_end - 1) is the middle of a vma (VMA'):
 			 *
 			 *    find_vma(mm, 16k - 1) will return VMA' whose range
-			 *    contains last_vma_end.
-			 *    Iterate VMA' from last_vma_end.
+			 *    contains *last_vma_end.
+			 *    Iterate VMA' from *last_vma_end.
 			 */
 			vma = mas_find(&mas, ULONG_MAX);
 			/* Case 3 above */
@@ -973,26 +969,51 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 				break;
 
 			/* Case 1 above */
-			if (vma->vm_start >= last_vma_end)
+			if (vma->vm_start >= *last_vma_end)
 				continue;
 
 			/* Case 4 above */
-			if (vma->vm_end > last_vma_end)
-				smap_gather_stats(vma, &mss, last_vma_end);
+			if (vma->vm_end > *last_vma_end)
+				smap_gather_stats(vma, mss, *last_vma_end);
 		}
 		/* Case 2 above */
 	} while ((vma = mas_find(&mas, ULONG_MAX)) != NULL);
 
-empty_set:
+out_unlock:
+	release_task_mempolicy(priv);
+	mmap_read_unlock(mm);
+	return 0;
+}
+
+static int show_smaps_rollup(struct seq_file *m, void *v)
+{
+	struct proc_maps_private *priv = m->private;
+	struct mem_size_stats mss;
+	struct mm_struct *mm = priv->mm;
+	unsigned long vma_start, last_vma_end;
+	int ret = 0;
+
+	priv->task = get_proc_task(priv->inode);
+	if (!priv->task)
+		return -ESRCH;
+
+	if (!mm || !mmget_not_zero(mm)) {
+		ret = -ESRCH;
+		goto out_put_task;
+	}
+
+	memset(&mss, 0, sizeof(mss));
+
+	ret = smap_gather_rollup(priv, mm, &mss, &vma_start, &last_vma_end);
+	if (ret)
+		goto out_put_mm;
+
 	show_vma_header_prefix(m, vma_start, last_vma_end, 0, 0, 0, 0);
 	seq_pad(m, ' ');
 	seq_puts(m, "[rollup]\n");
 
 	__show_smap(m, &mss, true);
 
-	release_task_mempolicy(priv);
-	mmap_read_unlock(mm);
-
 out_put_mm:
 	mmput(mm);
 out_put_task:
@@ -1070,6 +1091,218 @@ const struct file_operations proc_pid_smaps_rollup_operations = {
 	.release	= smaps_rollup_release,
 };
 
+#define SMAPS_SUMMARY_WALK_FIELDS \
+	GENMASK_ULL(SMAPS_SUMMARY_NR_FIELDS - 1, SMAPS_SUMMARY_RSS)
+#define SMAPS_SUMMARY_VALID_FIELDS \
+	(GENMASK_ULL(SMAPS_SUMMARY_PGTABLES, 0) | SMAPS_SUMMARY_WALK_FIELDS)
+
+struct smaps_summary_private {
+	struct proc_maps_private maps;
+	struct mutex lock;	/* Serialises reads, which use maps.task */
+	u64 mask;
+};
+
+static u64 smaps_summary_value(struct mm_struct *mm,
+			       const struct mem_size_stats *mss, int field)
+{
+	unsigned long rss;
+
+	switch (field) {
+	case SMAPS_SUMMARY_VM_SIZE:
+		return (u64)mm->total_vm << PAGE_SHIFT;
+	case SMAPS_SUMMARY_VM_PEAK:
+		return (u64)max(mm->total_vm, mm->hiwater_vm) << PAGE_SHIFT;
+	case SMAPS_SUMMARY_VM_LOCKED:
+		return (u64)mm->locked_vm << PAGE_SHIFT;
+	case SMAPS_SUMMARY_VM_PINNED:
+		return (u64)atomic64_read(&mm->pinned_vm) << PAGE_SHIFT;
+	case SMAPS_SUMMARY_RSS_PEAK:
+		rss = get_mm_rss(mm);
+		return (u64)max(rss, mm->hiwater_rss) << PAGE_SHIFT;
+	case SMAPS_SUMMARY_RSS_ANON:
+		return (u64)get_mm_counter(mm, MM_ANONPAGES) << PAGE_SHIFT;
+	case SMAPS_SUMMARY_RSS_FILE:
+		return (u64)get_mm_counter(mm, MM_FILEPAGES) << PAGE_SHIFT;
+	case SMAPS_SUMMARY_RSS_SHMEM:
+		return (u64)get_mm_counter(mm, MM_SHMEMPAGES) << PAGE_SHIFT;
+	case SMAPS_SUMMARY_SWAP:
+		return (u64)get_mm_counter(mm, MM_SWAPENTS) << PAGE_SHIFT;
+	case SMAPS_SUMMARY_PGTABLES:
+		return mm_pgtables_bytes(mm);
+	case SMAPS_SUMMARY_RSS:
+		return mss->resident;
+	case SMAPS_SUMMARY_PSS:
+		return mss->pss >> PSS_SHIFT;
+	case SMAPS_SUMMARY_PSS_DIRTY:
+		return mss->pss_dirty >> PSS_SHIFT;
+	case SMAPS_SUMMARY_PSS_ANON:
+		return mss->pss_anon >> PSS_SHIFT;
+	case SMAPS_SUMMARY_PSS_FILE:
+		return mss->pss_file >> PSS_SHIFT;
+	case SMAPS_SUMMARY_PSS_SHMEM:
+		return mss->pss_shmem >> PSS_SHIFT;
+	case SMAPS_SUMMARY_SHARED_CLEAN:
+		return mss->shared_clean;
+	case SMAPS_SUMMARY_SHARED_DIRTY:
+		return mss->shared_dirty;
+	case SMAPS_SUMMARY_PRIVATE_CLEAN:
+		return mss->private_clean;
+	case SMAPS_SUMMARY_PRIVATE_DIRTY:
+		return mss->private_dirty;
+	case SMAPS_SUMMARY_REFERENCED:
+		return mss->referenced;
+	case SMAPS_SUMMARY_ANONYMOUS:
+		return mss->anonymous;
+	case SMAPS_SUMMARY_LAZYFREE:
+		return mss->lazyfree;
+	case SMAPS_SUMMARY_ANON_THP:
+		return mss->anonymous_thp;
+	case SMAPS_SUMMARY_SHMEM_THP:
+		return mss->shmem_thp;
+	case SMAPS_SUMMARY_FILE_THP:
+		return mss->file_thp;
+	case SMAPS_SUMMARY_SHARED_HUGETLB:
+		return mss->shared_hugetlb;
+	case SMAPS_SUMMARY_PRIVATE_HUGETLB:
+		return mss->private_hugetlb;
+	case SMAPS_SUMMARY_SWAP_PSS:
+		return mss->swap_pss >> PSS_SHIFT;
+	case SMAPS_SUMMARY_PSS_LOCKED:
+		return mss->pss_locked >> PSS_SHIFT;
+	}
+	return 0;
+}
+
+static int smaps_summary_open(struct inode *inode, struct file *file)
+{
+	struct smaps_summary_private *priv;
+
+	priv = kzalloc(sizeof(*priv), GFP_KERNEL_ACCOUNT);
+	if (!priv)
+		return -ENOMEM;
+
+	priv->maps.inode = inode;
+	priv->maps.mm = proc_mem_open(inode, PTRACE_MODE_READ);
+	if (IS_ERR(priv->maps.mm)) {
+		int ret = PTR_ERR(priv->maps.mm);
+
+		kfree(priv);
+		return ret;
+	}
+	mutex_init(&priv->lock);
+	priv->mask = SMAPS_SUMMARY_COUNTERS;
+	file->private_data = priv;
+	return 0;
+}
+
+/*
+ * Take a snapshot of the fields selected for this file.  Only offset 0 has
+ * anything in it; the whole summary must be read at once.
+ */
+static ssize_t smaps_summary_read(struct file *file, char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	struct smaps_summary_private *priv = file->private_data;
+	struct mm_struct *mm = priv->maps.mm;
+	struct mem_size_stats mss;
+	struct smaps_summary *sum;
+	unsigned long vma_start, last_vma_end;
+	size_t size;
+	u64 mask;
+	int i, n = 0;
+	ssize_t ret;
+
+	if (*ppos)
+		return 0;
+
+	mask = READ_ONCE(priv->mask) & SMAPS_SUMMARY_VALID_FIELDS;
+	size = struct_size(sum, values, hweight64(mask));
+	if (count < size)
+		return -EINVAL;
+
+	sum = kzalloc(size, GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	ret = mutex_lock_killable(&priv->lock);
+	if (ret)
+		goto out_free;
+
+	ret = -ESRCH;
+	priv->maps.task = get_proc_task(priv->maps.inode);
+	if (!priv->maps.task)
+		goto out_unlock;
+	if (!mm || !mmget_not_zero(mm))
+		goto out_put_task;
+
+	memset(&mss, 0, sizeof(mss));
+	if (mask & SMAPS_SUMMARY_WALK_FIELDS) {
+		ret = smap_gather_rollup(&priv->maps, mm, &mss, &vma_start,
+					 &last_vma_end);
+		if (ret)
+			goto out_put_mm;
+	}
+
+	sum->version = SMAPS_SUMMARY_VERSION;
+	sum->size = size;
+	sum->mask = mask;
+	for (i = 0; i < SMAPS_SUMMARY_NR_FIELDS; i++)
+		if (mask & BIT_ULL(i))
+			sum->values[n++] = smaps_summary_value(mm, &mss, i);
+
+	ret = size;
+	if (copy_to_user(buf, sum, size))
+		ret = -EFAULT;
+	else
+		*ppos += size;
+
+out_put_mm:
+	mmput(mm);
+out_put_task:
+	put_task_struct(priv->maps.task);
+	priv->maps.task = NULL;
+out_unlock:
+	mutex_unlock(&priv->lock);
+out_free:
+	kfree(sum);
+	return ret;
+}
+
+/* Select the fields that reads will return */
+static ssize_t smaps_summary_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct smaps_summary_private *priv = file->private_data;
+	u64 mask;
+
+	if (count < sizeof(mask))
+		return -EINVAL;
+	if (copy_from_user(&mask, buf, sizeof(mask)))
+		return -EFAULT;
+
+	WRITE_ONCE(priv->mask, mask);
+	return count;
+}
+
+static int smaps_summary_release(struct inode *inode, struct file *file)
+{
+	struct smaps_summary_private *priv = file->private_data;
+
+	if (priv->maps.mm)
+		mmdrop(priv->maps.mm);
+
+	kfree(priv);
+	return 0;
+}
+
+const struct file_operations proc_pid_smaps_summary_operations = {
+	.open		= smaps_summary_open,
+	.read		= smaps_summary_read,
+	.write		= smaps_summary_write,
+	.llseek		= default_llseek,
+	.release	= smaps_summary_release,
+};
+
 enum clear_refs_types {
 	CLEAR_REFS_ALL = 1,
 	CLEAR_REFS_ANON,
@@ -1334,10 +1567,13 @@ typedef struct {
 	u64 pme;
 } pagemap_entry_t;
 
+struct pagemap_scan_private;
+
 struct pagemapread {
 	int pos, len;		/* units: PM_ENTRY_BYTES, not bytes */
 	pagemap_entry_t *buffer;
 	bool show_pfn;
+	struct pagemap_scan_private *scan;	/* PAGEMAP_SCAN rather than read */
 };
 
 #define PAGEMAP_WALK_SIZE	(PMD_SIZE)
@@ -1349,6 +1585,7 @@ struct pagemapread {
 #define PM_SOFT_DIRTY		BIT_ULL(55)
 #define PM_MMAP_EXCLUSIVE	BIT_ULL(56)
 #define PM_UFFD_WP		BIT_ULL(57)
+#define PM_SCAN_HUGE		BIT_ULL(58)	/* Only for PAGEMAP_SCAN */
 #define PM_FILE			BIT_ULL(61)
 #define PM_SWAP			BIT_ULL(62)
 #define PM_PRESENT		BIT_ULL(63)
@@ -1360,15 +1597,131 @@ static inline pagemap_entry_t make_pme(u64 frame, u64 flags)
 	return (pagemap_entry_t) { .pme = (frame & PM_PFRAME_MASK) | flags };
 }
 
+struct pagemap_scan_private {
+	struct pm_scan_arg arg;
+	struct page_region *vec;	/* vec[nr_regions - 1] is still growing */
+	unsigned long vec_len;
+	unsigned long nr_regions;
+	unsigned long nr_pages;
+	unsigned long walk_end;
+	bool matched;			/* All of the last range was reported */
+	bool cleared;			/* Some soft-dirty bit was cleared */
+};
+
+#define PAGEMAP_SCAN_MAX_REGIONS	4096	/* Most regions per ioctl */
+#define PAGE_IS_ALL	(PAGE_IS_PRESENT | PAGE_IS_SWAPPED | PAGE_IS_FILE | \
+			 PAGE_IS_SOFT_DIRTY | PAGE_IS_EXCLUSIVE |	    \
+			 PAGE_IS_HUGE | PAGE_IS_UFFD_WP)
+
+static u64 pagemap_scan_categories(u64 pme)
+{
+	u64 categories = 0;
+
+	if (pme & PM_PRESENT)
+		categories |= PAGE_IS_PRESENT;
+	if (pme & PM_SWAP)
+		categories |= PAGE_IS_SWAPPED;
+	if (pme & PM_FILE)
+		categories |= PAGE_IS_FILE;
+	if (pme & PM_SOFT_DIRTY)
+		categories |= PAGE_IS_SOFT_DIRTY;
+	if (pme & PM_MMAP_EXCLUSIVE)
+		categories |= PAGE_IS_EXCLUSIVE;
+	if (pme & PM_SCAN_HUGE)
+		categories |= PAGE_IS_HUGE;
+	if (pme & PM_UFFD_WP)
+		categories |= PAGE_IS_UFFD_WP;
+	return categories;
+}
+
+/*
+ * Account for the range [@addr, @end) of pages that all have the pagemap
+ * entry @pme.  Returns PM_END_OF_BUFFER if the scan has to stop, in which case
+ * ->walk_end says how far we got.  ->matched is set if the whole range was
+ * reported, so that the caller can clear soft-dirty on it.
+ */
+static int pagemap_scan_add(struct pagemap_scan_private *s,
+			    unsigned long addr, unsigned long end, u64 pme)
+{
+	u64 categories = pagemap_scan_categories(pme);
+	u64 c = categories ^ s->arg.category_inverted;
+	struct page_region *cur;
+	unsigned long nr = (end - addr) >> PAGE_SHIFT;
+
+	s->matched = false;
+	if ((c & s->arg.category_mask) != s->arg.category_mask ||
+	    (s->arg.category_anyof_mask && !(c & s->arg.category_anyof_mask))) {
+		s->walk_end = end;
+		return 0;
+	}
+
+	if (s->arg.max_pages) {
+		if (s->nr_pages >= s->arg.max_pages)
+			return PM_END_OF_BUFFER;
+		nr = min_t(unsigned long, nr, s->arg.max_pages - s->nr_pages);
+	}
+
+	categories &= s->arg.return_mask;
+	cur = s->nr_regions ? &s->vec[s->nr_regions - 1] : NULL;
+	if (!cur || cur->end != addr || cur->categories != categories) {
+		if (s->nr_regions == s->vec_len)
+			return PM_END_OF_BUFFER;
+		cur = &s->vec[s->nr_regions++];
+		cur->start = cur->end = addr;
+		cur->categories = categories;
+	}
+
+	cur->end += nr << PAGE_SHIFT;
+	s->nr_pages += nr;
+	s->walk_end = cur->end;
+	if (cur->end != end)
+		return PM_END_OF_BUFFER;
+	s->matched = true;
+	return 0;
+}
+
 static int add_to_pagemap(unsigned long addr, pagemap_entry_t *pme,
 			  struct pagemapread *pm)
 {
+	if (pm->scan)
+		return pagemap_scan_add(pm->scan, addr, addr + PAGE_SIZE,
+					pme->pme);
+
 	pm->buffer[pm->pos++] = *pme;
 	if (pm->pos >= pm->len)
 		return PM_END_OF_BUFFER;
 	return 0;
 }
 
+/* Add the same entry for every page in [@addr, @end) */
+static int add_range_to_pagemap(unsigned long addr, unsigned long end,
+				pagemap_entry_t *pme, struct pagemapread *pm)
+{
+	int err;
+
+	if (pm->scan)
+		return pagemap_scan_add(pm->scan, addr, end, pme->pme);
+
+	for (; addr < end; addr += PAGE_SIZE) {
+		err = add_to_pagemap(addr, pme, pm);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+/* Should we clear soft-dirty on what pagemap_scan_add() just reported? */
+static inline bool pagemap_scan_clear(struct pagemapread *pm, u64 flags)
+{
+	struct pagemap_scan_private *s = pm->scan;
+
+	if (!s || !s->matched || !(flags & PM_SOFT_DIRTY) ||
+	    !(s->arg.flags & PM_SCAN_CLEAR_SOFT_DIRTY))
+		return false;
+	s->cleared = true;
+	return true;
+}
+
 static int pagemap_pte_hole(unsigned long start, unsigned long end,
 			    __always_unused int depth, struct mm_walk *walk)
 {
@@ -1387,10 +1740,11 @@ static int pagemap_pte_hole(unsigned long start, unsigned long end,
 		else
 			hole_end = end;
 
-		for (; addr < hole_end; addr += PAGE_SIZE) {
-			err = add_to_pagemap(addr, &pme, pm);
+		if (addr < hole_end) {
+			err = add_range_to_pagemap(addr, hole_end, &pme, pm);
 			if (err)
 				goto out;
+			addr = hole_end;
 		}
 
 		if (!vma)
@@ -1399,10 +1753,12 @@ static int pagemap_pte_hole(unsigned long start, unsigned long end,
 		/* Addresses in the VMA. */
 		if (vma->vm_flags & VM_SOFTDIRTY)
 			pme = make_pme(0, PM_SOFT_DIRTY);
-		for (; addr < min(end, vma->vm_end); addr += PAGE_SIZE) {
-			err = add_to_pagemap(addr, &pme, pm);
+		hole_end = min(end, vma->vm_end);
+		if (addr < hole_end) {
+			err = add_range_to_pagemap(addr, hole_end, &pme, pm);
 			if (err)
 				goto out;
+			addr = hole_end;
 		}
 	}
 out:
@@ -1524,6 +1880,18 @@ static int pagemap_pmd_range(pmd_t *pmdp, unsigned long addr, unsigned long end,
 		if (page && !migration && page_mapcount(page) == 1)
 			flags |= PM_MMAP_EXCLUSIVE;
 
+		if (pm->scan) {
+			pagemap_entry_t pme = make_pme(0, flags | PM_SCAN_HUGE);
+
+			err = add_range_to_pagemap(addr, end, &pme, pm);
+			/* Only clear soft-dirty if all of the THP was reported */
+			if (pagemap_scan_clear(pm, flags) &&
+			    !(addr & ~HPAGE_PMD_MASK) && end == addr + HPAGE_PMD_SIZE)
+				clear_soft_dirty_pmd(vma, addr, pmdp);
+			spin_unlock(ptl);
+			return err;
+		}
+
 		for (; addr != end; addr += PAGE_SIZE) {
 			pagemap_entry_t pme = make_pme(frame, flags);
 
@@ -1557,6 +1925,8 @@ static int pagemap_pmd_range(pmd_t *pmdp, unsigned long addr, unsigned long end,
 		err = add_to_pagemap(addr, &pme, pm);
 		if (err)
 			break;
+		if (pagemap_scan_clear(pm, pme.pme))
+			clear_soft_dirty(vma, addr, pte);
 	}
 	pte_unmap_unlock(orig_pte, ptl);
 
@@ -1601,6 +1971,12 @@ static int pagemap_hugetlb_range(pte_t *ptep, unsigned long hmask,
 		flags |= PM_UFFD_WP;
 	}
 
+	if (pm->scan) {
+		pagemap_entry_t pme = make_pme(0, flags | PM_SCAN_HUGE);
+
+		return add_range_to_pagemap(addr, end, &pme, pm);
+	}
+
 	for (; addr != end; addr += PAGE_SIZE) {
 		pagemap_entry_t pme = make_pme(frame, flags);
 
@@ -1677,6 +2053,7 @@ static ssize_t pagemap_read(struct file *file, char __user *buf,
 
 	/* do not disclose physical addresses: attack vector */
 	pm.show_pfn = file_ns_capable(file, &init_user_ns, CAP_SYS_ADMIN);
+	pm.scan = NULL;
 
 	pm.len = (PAGEMAP_WALK_SIZE >> PAGE_SHIFT);
 	pm.buffer = kmalloc_array(pm.len, PM_ENTRY_BYTES, GFP_KERNEL);
@@ -1741,6 +2118,143 @@ static ssize_t pagemap_read(struct file *file, char __user *buf,
 	return ret;
 }
 
+/*
+ * Clear VM_SOFTDIRTY on the VMAs that the scan covered completely, now that
+ * all their pages have been reported.  VMAs only partly covered keep it, so
+ * their unreported pages still show up as soft-dirty next time.
+ */
+static void pagemap_scan_clear_vmas(struct mm_struct *mm, unsigned long start,
+				    unsigned long end)
+{
+	struct vm_area_struct *vma;
+	VMA_ITERATOR(vmi, mm, start);
+
+	for_each_vma_range(vmi, vma, end) {
+		if (vma->vm_start < start || vma->vm_end > end)
+			continue;
+		if (!(vma->vm_flags & VM_SOFTDIRTY))
+			continue;
+		vma->vm_flags &= ~VM_SOFTDIRTY;
+		vma_set_page_prot(vma);
+	}
+}
+
+/*
+ * PAGEMAP_SCAN: report the pages in a range that match a set of categories
+ * as a list of regions rather than one entry per page, optionally clearing
+ * soft-dirty on them at the same time.  The clear happens under the page
+ * table lock as the page is reported, so no write can slip in between.
+ */
+static long do_pagemap_scan(struct mm_struct *mm, struct pm_scan_arg __user *uarg)
+{
+	struct pagemap_scan_private s = {};
+	struct mmu_notifier_range range;
+	struct pagemapread pm = {};
+	unsigned long start, end;
+	bool clear;
+	long ret;
+
+	if (copy_from_user(&s.arg, uarg, sizeof(s.arg)))
+		return -EFAULT;
+	if (s.arg.size != sizeof(s.arg))
+		return -EINVAL;
+	if (s.arg.flags & ~PM_SCAN_CLEAR_SOFT_DIRTY)
+		return -EINVAL;
+	if ((s.arg.category_inverted | s.arg.category_mask |
+	     s.arg.category_anyof_mask | s.arg.return_mask) & ~PAGE_IS_ALL)
+		return -EINVAL;
+	clear = s.arg.flags & PM_SCAN_CLEAR_SOFT_DIRTY;
+	if (clear && !IS_ENABLED(CONFIG_MEM_SOFT_DIRTY))
+		return -EOPNOTSUPP;
+
+	start = untagged_addr((unsigned long)s.arg.start);
+	end = untagged_addr((unsigned long)s.arg.end);
+	if (!PAGE_ALIGNED(start) || !PAGE_ALIGNED(end) || start > end ||
+	    s.arg.start != start || s.arg.end != end)
+		return -EINVAL;
+	if (!s.arg.vec_len ||
+	    !access_ok(u64_to_user_ptr(s.arg.vec),
+		       array_size(s.arg.vec_len, sizeof(struct page_region))))
+		return -EINVAL;
+
+	if (!mm || !mmget_not_zero(mm))
+		return -ESRCH;
+
+	end = min(end, mm->task_size);
+	s.walk_end = start;
+	s.vec_len = min_t(u64, s.arg.vec_len, PAGEMAP_SCAN_MAX_REGIONS);
+	s.vec = kvmalloc_array(s.vec_len, sizeof(*s.vec), GFP_KERNEL);
+	ret = -ENOMEM;
+	if (!s.vec)
+		goto out_mm;
+	pm.scan = &s;
+
+	/*
+	 * Regions are collected in a kernel buffer and copied out once we've
+	 * dropped mmap_lock, since @vec may be in @mm.  Clearing soft-dirty
+	 * needs the write lock to clear VM_SOFTDIRTY, as clear_refs does.
+	 */
+	if (clear) {
+		ret = mmap_write_lock_killable(mm);
+		if (ret)
+			goto out_free;
+		inc_tlb_flush_pending(mm);
+		mmu_notifier_range_init(&range, MMU_NOTIFY_SOFT_DIRTY, 0, NULL,
+					mm, start, end);
+		mmu_notifier_invalidate_range_start(&range);
+	} else {
+		ret = mmap_read_lock_killable(mm);
+		if (ret)
+			goto out_free;
+	}
+
+	ret = 0;
+	if (start < end)
+		ret = walk_page_range(mm, start, end, &pagemap_ops, &pm);
+	if (!ret)
+		s.walk_end = end;
+
+	if (clear) {
+		pagemap_scan_clear_vmas(mm, start, s.walk_end);
+		mmu_notifier_invalidate_range_end(&range);
+		if (s.cleared)
+			flush_tlb_mm(mm);
+		dec_tlb_flush_pending(mm);
+		mmap_write_unlock(mm);
+	} else {
+		mmap_read_unlock(mm);
+	}
+
+	if (ret < 0)
+		goto out_free;
+
+	ret = -EFAULT;
+	if (copy_to_user(u64_to_user_ptr(s.arg.vec), s.vec,
+			 s.nr_regions * sizeof(*s.vec)) ||
+	    put_user(s.walk_end, &uarg->walk_end))
+		goto out_free;
+	ret = s.nr_regions;
+
+out_free:
+	kvfree(s.vec);
+out_mm:
+	mmput(mm);
+	return ret;
+}
+
+static long pagemap_ioctl(struct file *file, unsigned int cmd,
+			  unsigned long arg)
+{
+	struct mm_struct *mm = file->private_data;
+
+	switch (cmd) {
+	case PAGEMAP_SCAN:
+		return do_pagemap_scan(mm, (struct pm_scan_arg __user *)arg);
+	default:
+		return -EINVAL;
+	}
+}
+
 static int pagemap_open(struct inode *inode, struct file *file)
 {
 	struct mm_struct *mm;
@@ -1766,6 +2280,8 @@ const struct file_operations proc_pagemap_operations = {
 	.read		= pagemap_read,
 	.open		= pagemap_open,
 	.release	= pagemap_release,
+	.unlocked_ioctl	= pagemap_ioctl,
+	.compat_ioctl	= compat_ptr_ioctl,
 };
 #endif /* CONFIG_PROC_PAGE_MONITOR */
 
@@ -17,12 +17,10 @@
 #include <linux/err.h>
 #include <linux/cache.h>
 #include <linux/slab.h>
+#include <linux/sched/clock.h>
 #include <asm/barrier.h>
 #include "internal.h"
 
-/* This doesn't need to be atomic: speed is chosen over correctness here. */
-static u64 pstore_ftrace_stamp;
-
 static void notrace pstore_ftrace_call(unsigned long ip,
 				       unsigned long parent_ip,
 				       struct ftrace_ops *op,
@@ -49,7 +47,13 @@ static void notrace pstore_ftrace_call(unsigned long ip,
 
 	rec.ip = ip;
 	rec.parent_ip = parent_ip;
-	pstore_ftrace_write_timestamp(&rec, pstore_ftrace_stamp++);
+	/*
+	 * A shared sequence counter would bounce between all the CPUs on
+	 * every traced call, even with per-CPU zones.  The local clock is
+	 * close enough across CPUs to merge the zones, and tells how long
+	 * before the crash a call was made.
+	 */
+	pstore_ftrace_write_timestamp(&rec, local_clock());
 	pstore_ftrace_encode_cpu(&rec, raw_smp_processor_id());
 	psinfo->write(&record);
 
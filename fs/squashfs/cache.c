@@ -39,12 +39,26 @@
 #include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/pagemap.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "squashfs.h"
 #include "page_actor.h"
 
+/*
+ * Find the shard a block belongs to.  Each shard has its own lock, entries
+ * and LRU list, so lookups of unrelated blocks do not contend.
+ */
+static struct squashfs_cache_shard *squashfs_cache_shard(
+	struct squashfs_cache *cache, u64 block)
+{
+	if (!cache->shard_bits)
+		return cache->shard;
+	return &cache->shard[hash_64(block, cache->shard_bits)];
+}
+
 /*
  * Look-up block in cache, and increment usage count.  If not in cache, read
  * and decompress it from disk.
@@ -52,65 +66,58 @@
 struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	struct squashfs_cache *cache, u64 block, int length)
 {
-	int i, n;
+	struct squashfs_cache_shard *shard = squashfs_cache_shard(cache, block);
 	struct squashfs_cache_entry *entry;
+	int i;
 
-	spin_lock(&cache->lock);
+	spin_lock(&shard->lock);
 
 	while (1) {
-		for (i = cache->curr_blk, n = 0; n < cache->entries; n++) {
-			if (cache->entry[i].block == block) {
-				cache->curr_blk = i;
+		for (i = 0; i < shard->entries; i++)
+			if (shard->entry[i].block == block)
 				break;
-			}
-			i = (i + 1) % cache->entries;
-		}
 
-		if (n == cache->entries) {
+		if (i == shard->entries) {
 			/*
 			 * Block not in cache, if all cache entries are used
 			 * go to sleep waiting for one to become available.
 			 */
-			if (cache->unused == 0) {
-				cache->num_waiters++;
-				spin_unlock(&cache->lock);
-				wait_event(cache->wait_queue, cache->unused);
-				spin_lock(&cache->lock);
-				cache->num_waiters--;
+			if (shard->unused == 0) {
+				shard->waits++;
+				shard->num_waiters++;
+				spin_unlock(&shard->lock);
+				wait_event(shard->wait_queue, shard->unused);
+				spin_lock(&shard->lock);
+				shard->num_waiters--;
 				continue;
 			}
 
 			/*
-			 * At least one unused cache entry.  A simple
-			 * round-robin strategy is used to choose the entry to
-			 * be evicted from the cache.
+			 * At least one unused cache entry.  Evict the least
+			 * recently released one.
 			 */
-			i = cache->next_blk;
-			for (n = 0; n < cache->entries; n++) {
-				if (cache->entry[i].refcount == 0)
-					break;
-				i = (i + 1) % cache->entries;
-			}
-
-			cache->next_blk = (i + 1) % cache->entries;
-			entry = &cache->entry[i];
+			entry = list_first_entry(&shard->lru,
+					struct squashfs_cache_entry, lru);
+			list_del_init(&entry->lru);
+			i = entry - shard->entry;
 
 			/*
 			 * Initialise chosen cache entry, and fill it in from
 			 * disk.
 			 */
-			cache->unused--;
+			shard->unused--;
+			shard->misses++;
 			entry->block = block;
 			entry->refcount = 1;
 			entry->pending = 1;
 			entry->num_waiters = 0;
 			entry->error = 0;
-			spin_unlock(&cache->lock);
+			spin_unlock(&shard->lock);
 
 			entry->length = squashfs_read_data(sb, block, length,
 				&entry->next_index, entry->actor);
 
-			spin_lock(&cache->lock);
+			spin_lock(&shard->lock);
 
 			if (entry->length < 0)
 				entry->error = entry->length;
@@ -123,10 +130,10 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			 * waiting for it to become available.
 			 */
 			if (entry->num_waiters) {
-				spin_unlock(&cache->lock);
+				spin_unlock(&shard->lock);
 				wake_up_all(&entry->wait_queue);
 			} else
-				spin_unlock(&cache->lock);
+				spin_unlock(&shard->lock);
 
 			goto out;
 		}
@@ -137,10 +144,13 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		 * previously unused there's one less cache entry available
 		 * for reuse.
 		 */
-		entry = &cache->entry[i];
-		if (entry->refcount == 0)
-			cache->unused--;
+		entry = &shard->entry[i];
+		if (entry->refcount == 0) {
+			list_del_init(&entry->lru);
+			shard->unused--;
+		}
 		entry->refcount++;
+		shard->hits++;
 
 		/*
 		 * If the entry is currently being filled in by another process
@@ -148,10 +158,10 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		 */
 		if (entry->pending) {
 			entry->num_waiters++;
-			spin_unlock(&cache->lock);
+			spin_unlock(&shard->lock);
 			wait_event(entry->wait_queue, !entry->pending);
 		} else
-			spin_unlock(&cache->lock);
+			spin_unlock(&shard->lock);
 
 		goto out;
 	}
@@ -172,23 +182,48 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
  */
 void squashfs_cache_put(struct squashfs_cache_entry *entry)
 {
-	struct squashfs_cache *cache = entry->cache;
+	struct squashfs_cache_shard *shard = entry->shard;
 
-	spin_lock(&cache->lock);
+	spin_lock(&shard->lock);
 	entry->refcount--;
 	if (entry->refcount == 0) {
-		cache->unused++;
+		list_add_tail(&entry->lru, &shard->lru);
+		shard->unused++;
 		/*
 		 * If there's any processes waiting for a block to become
 		 * available, wake one up.
 		 */
-		if (cache->num_waiters) {
-			spin_unlock(&cache->lock);
-			wake_up(&cache->wait_queue);
+		if (shard->num_waiters) {
+			spin_unlock(&shard->lock);
+			wake_up(&shard->wait_queue);
 			return;
 		}
 	}
-	spin_unlock(&cache->lock);
+	spin_unlock(&shard->lock);
+}
+
+
+/*
+ * Sum the hit, miss and wait counters of all shards.
+ */
+void squashfs_cache_stats(struct squashfs_cache *cache,
+	struct squashfs_cache_stats *stats)
+{
+	int i;
+
+	memset(stats, 0, sizeof(*stats));
+	if (cache == NULL)
+		return;
+
+	for (i = 0; i < 1 << cache->shard_bits; i++) {
+		struct squashfs_cache_shard *shard = &cache->shard[i];
+
+		spin_lock(&shard->lock);
+		stats->hits += shard->hits;
+		stats->misses += shard->misses;
+		stats->waits += shard->waits;
+		spin_unlock(&shard->lock);
+	}
 }
 
 /*
@@ -210,6 +245,7 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 		kfree(cache->entry[i].actor);
 	}
 
+	kfree(cache->shard);
 	kfree(cache->entry);
 	kfree(cache);
 }
@@ -219,11 +255,16 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
  * Initialise cache allocating the specified number of entries, each of
  * size block_size.  To avoid vmalloc fragmentation issues each entry
  * is allocated as a sequence of kmalloced PAGE_SIZE buffers.
+ *
+ * Caches with more than SQUASHFS_CACHE_SHARD_ENTRIES entries are split into
+ * a power of two number of shards, at most one per possible CPU, each
+ * owning a contiguous range of the entries.  Small caches keep a single
+ * shard so that every entry is available to every block.
  */
 struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	int block_size)
 {
-	int i, j;
+	int i, j, shards;
 	struct squashfs_cache *cache = kzalloc(sizeof(*cache), GFP_KERNEL);
 
 	if (cache == NULL) {
@@ -237,17 +278,38 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		goto cleanup;
 	}
 
-	cache->curr_blk = 0;
-	cache->next_blk = 0;
-	cache->unused = entries;
+	shards = entries / SQUASHFS_CACHE_SHARD_ENTRIES;
+	shards = shards > 1 ? rounddown_pow_of_two(shards) : 1;
+	shards = min_t(int, shards, roundup_pow_of_two(num_possible_cpus()));
+	cache->shard = kcalloc(shards, sizeof(*(cache->shard)), GFP_KERNEL);
+	if (cache->shard == NULL) {
+		ERROR("Failed to allocate %s cache\n", name);
+		goto cleanup;
+	}
+
+	cache->shard_bits = ilog2(shards);
 	cache->entries = entries;
 	cache->block_size = block_size;
 	cache->pages = block_size >> PAGE_SHIFT;
 	cache->pages = cache->pages ? cache->pages : 1;
 	cache->name = name;
-	cache->num_waiters = 0;
-	spin_lock_init(&cache->lock);
-	init_waitqueue_head(&cache->wait_queue);
+
+	for (i = 0; i < shards; i++) {
+		struct squashfs_cache_shard *shard = &cache->shard[i];
+		int first = i * entries / shards;
+
+		spin_lock_init(&shard->lock);
+		init_waitqueue_head(&shard->wait_queue);
+		INIT_LIST_HEAD(&shard->lru);
+		shard->entry = &cache->entry[first];
+		shard->entries = (i + 1) * entries / shards - first;
+		shard->unused = shard->entries;
+
+		for (j = 0; j < shard->entries; j++) {
+			shard->entry[j].shard = shard;
+			list_add_tail(&shard->entry[j].lru, &shard->lru);
+		}
+	}
 
 	for (i = 0; i < entries; i++) {
 		struct squashfs_cache_entry *entry = &cache->entry[i];
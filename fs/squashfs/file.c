@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -533,6 +534,104 @@ static int squashfs_readahead_fragment(struct page **page,
 	return error;
 }
 
+/*
+ * Readahead of a multi-block window decompresses the datablocks in parallel
+ * when the mount can run more than one decompressor.  Every datablock but
+ * the first is handed to squashfs_read_wq, where each worker issues its own
+ * read and decompresses into its own pages, and the reader decompresses the
+ * first block itself once the others are queued.
+ */
+static struct workqueue_struct *squashfs_read_wq;
+
+struct squashfs_ra_block {
+	struct work_struct work;
+	struct inode *inode;
+	u64 block;
+	int bsize;
+	unsigned int expected;
+	bool last;
+	unsigned int nr_pages;
+	struct page *pages[];
+};
+
+/*
+ * Read and decompress one datablock into @pages, mark them uptodate if the
+ * whole block was decompressed and release them.
+ */
+static int squashfs_readahead_block(struct inode *inode, struct page **pages,
+	unsigned int nr_pages, u64 block, int bsize, unsigned int expected,
+	bool last)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	struct squashfs_page_actor *actor;
+	struct page *last_page;
+	int i, res = -ENOMEM;
+
+	actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
+						 expected);
+	if (!actor)
+		goto out;
+
+	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+
+	last_page = squashfs_page_actor_free(actor);
+
+	if (res == expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (last && bytes && last_page)
+			memzero_page(last_page, bytes, PAGE_SIZE - bytes);
+
+		for (i = 0; i < nr_pages; i++) {
+			flush_dcache_page(pages[i]);
+			SetPageUptodate(pages[i]);
+		}
+	}
+
+out:
+	for (i = 0; i < nr_pages; i++) {
+		unlock_page(pages[i]);
+		put_page(pages[i]);
+	}
+	return res < 0 ? res : 0;
+}
+
+static void squashfs_readahead_run(struct squashfs_ra_block *ra)
+{
+	squashfs_readahead_block(ra->inode, ra->pages, ra->nr_pages, ra->block,
+				 ra->bsize, ra->expected, ra->last);
+	kfree(ra);
+}
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	squashfs_readahead_run(container_of(work, struct squashfs_ra_block,
+					    work));
+}
+
+static struct squashfs_ra_block *squashfs_readahead_alloc(struct inode *inode,
+	struct page **pages, unsigned int nr_pages, u64 block, int bsize,
+	unsigned int expected, bool last)
+{
+	struct squashfs_ra_block *ra;
+
+	ra = kmalloc(struct_size(ra, pages, nr_pages), GFP_KERNEL);
+	if (!ra)
+		return NULL;
+
+	INIT_WORK(&ra->work, squashfs_readahead_work);
+	ra->inode = inode;
+	ra->block = block;
+	ra->bsize = bsize;
+	ra->expected = expected;
+	ra->last = last;
+	ra->nr_pages = nr_pages;
+	memcpy(ra->pages, pages, nr_pages * sizeof(*pages));
+	return ra;
+}
+
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -541,14 +640,18 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
+	struct squashfs_ra_block *first = NULL;
 	unsigned int nr_pages = 0;
 	struct page **pages;
 	int i, file_end = i_size_read(inode) >> msblk->block_log;
 	unsigned int max_pages = 1UL << shift;
+	bool parallel;
 
 	readahead_expand(ractl, start, (len | mask) + 1);
 
+	parallel = msblk->max_thread_num > 1 &&
+		   readahead_length(ractl) > msblk->block_size;
+
 	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
 	if (!pages)
 		return;
@@ -558,7 +661,7 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		int res, bsize;
 		u64 block = 0;
 		unsigned int expected;
-		struct page *last_page;
+		struct squashfs_ra_block *ra;
 
 		expected = start >> msblk->block_log == file_end ?
 			   (i_size_read(inode) & (msblk->block_size - 1)) :
@@ -591,36 +694,27 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		last_page = squashfs_page_actor_free(actor);
-
-		if (res == expected) {
-			int bytes;
-
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (index == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
-
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
+		ra = parallel ? squashfs_readahead_alloc(inode, pages,
+				nr_pages, block, bsize, expected,
+				index == file_end) : NULL;
+		if (ra) {
+			if (!first)
+				first = ra;
+			else
+				queue_work(squashfs_read_wq, &ra->work);
+			continue;
 		}
 
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
-		}
+		res = squashfs_readahead_block(inode, pages, nr_pages, block,
+					       bsize, expected,
+					       index == file_end);
+		nr_pages = 0;
+		if (res == -ENOMEM)
+			goto skip_pages;
 	}
 
+	if (first)
+		squashfs_readahead_run(first);
 	kfree(pages);
 	return;
 
@@ -629,9 +723,23 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		unlock_page(pages[i]);
 		put_page(pages[i]);
 	}
+	if (first)
+		squashfs_readahead_run(first);
 	kfree(pages);
 }
 
+int __init squashfs_readahead_init(void)
+{
+	squashfs_read_wq = alloc_workqueue("squashfs_read",
+					   WQ_UNBOUND | WQ_HIGHPRI, 0);
+	return squashfs_read_wq ? 0 : -ENOMEM;
+}
+
+void squashfs_readahead_destroy(void)
+{
+	destroy_workqueue(squashfs_read_wq);
+}
+
 const struct address_space_operations squashfs_aops = {
 	.read_folio = squashfs_read_folio,
 	.readahead = squashfs_readahead
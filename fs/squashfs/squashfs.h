@@ -24,6 +24,8 @@ extern void squashfs_cache_delete(struct squashfs_cache *);
 extern struct squashfs_cache_entry *squashfs_cache_get(struct super_block *,
 				struct squashfs_cache *, u64, int);
 extern void squashfs_cache_put(struct squashfs_cache_entry *);
+extern void squashfs_cache_stats(struct squashfs_cache *,
+				struct squashfs_cache_stats *);
 extern int squashfs_copy_data(void *, struct squashfs_cache_entry *, int, int);
 extern int squashfs_read_metadata(struct super_block *, void *, u64 *,
 				int *, int);
@@ -70,6 +72,8 @@ extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
 void squashfs_fill_page(struct page *, struct squashfs_cache_entry *, int, int);
 void squashfs_copy_cache(struct page *, struct squashfs_cache_entry *, int,
 				int);
+extern int squashfs_readahead_init(void);
+extern void squashfs_readahead_destroy(void);
 
 /* file_xxx.c */
 extern int squashfs_readpage_block(struct page *, u64, int, int);
@@ -84,6 +88,12 @@ extern struct inode *squashfs_iget(struct super_block *, long long,
 				unsigned int);
 extern int squashfs_read_inode(struct inode *, long long);
 
+/* sysfs.c */
+extern int squashfs_register_sysfs(struct super_block *);
+extern void squashfs_unregister_sysfs(struct super_block *);
+extern int __init squashfs_init_sysfs(void);
+extern void squashfs_exit_sysfs(void);
+
 /* xattr.c */
 extern ssize_t squashfs_listxattr(struct dentry *, char *, size_t);
 
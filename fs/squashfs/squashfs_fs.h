@@ -204,6 +204,12 @@ static inline int squashfs_block_size(__le32 raw)
 /* cached data constants for filesystem */
 #define SQUASHFS_CACHED_BLKS		8
 
+/* upper bound on the fragment and metadata cache sizes set at mount */
+#define SQUASHFS_CACHE_MAX_ENTRIES	256
+
+/* caches are split into shards of at least this many entries */
+#define SQUASHFS_CACHE_SHARD_ENTRIES	8
+
 /* meta index cache */
 #define SQUASHFS_META_INDEXES	(SQUASHFS_METADATA_SIZE / sizeof(unsigned int))
 #define SQUASHFS_META_ENTRIES	127
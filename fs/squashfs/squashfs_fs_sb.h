@@ -10,22 +10,40 @@
  * squashfs_fs_sb.h
  */
 
+#include <linux/kobject.h>
+#include <linux/completion.h>
+
 #include "squashfs_fs.h"
 
+struct squashfs_cache_shard {
+	spinlock_t		lock;
+	int			num_waiters;
+	int			unused;
+	int			entries;
+	wait_queue_head_t	wait_queue;
+	struct list_head	lru;		/* unused entries, oldest first */
+	struct squashfs_cache_entry *entry;
+	u64			hits;
+	u64			misses;
+	u64			waits;
+} ____cacheline_aligned_in_smp;
+
 struct squashfs_cache {
 	char			*name;
 	int			entries;
-	int			curr_blk;
-	int			next_blk;
-	int			num_waiters;
-	int			unused;
 	int			block_size;
 	int			pages;
-	spinlock_t		lock;
-	wait_queue_head_t	wait_queue;
+	unsigned int		shard_bits;
+	struct squashfs_cache_shard *shard;
 	struct squashfs_cache_entry *entry;
 };
 
+struct squashfs_cache_stats {
+	u64			hits;
+	u64			misses;
+	u64			waits;
+};
+
 struct squashfs_cache_entry {
 	u64			block;
 	int			length;
@@ -35,7 +53,9 @@ struct squashfs_cache_entry {
 	int			error;
 	int			num_waiters;
 	wait_queue_head_t	wait_queue;
+	struct list_head	lru;
 	struct squashfs_cache	*cache;
+	struct squashfs_cache_shard *shard;
 	void			**data;
 	struct squashfs_page_actor	*actor;
 };
@@ -68,5 +88,7 @@ struct squashfs_sb_info {
 	bool					panic_on_errors;
 	const struct squashfs_decompressor_thread_ops *thread_ops;
 	int					max_thread_num;
+	struct kobject				s_kobj;
+	struct completion			s_kobj_unregister;
 };
 #endif
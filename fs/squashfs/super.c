@@ -48,12 +48,16 @@ enum Opt_errors {
 enum squashfs_param {
 	Opt_errors,
 	Opt_threads,
+	Opt_fragment_cache,
+	Opt_metadata_cache,
 };
 
 struct squashfs_mount_opts {
 	enum Opt_errors errors;
 	const struct squashfs_decompressor_thread_ops *thread_ops;
 	int thread_num;
+	unsigned int fragment_cache;
+	unsigned int metadata_cache;
 };
 
 static const struct constant_table squashfs_param_errors[] = {
@@ -65,6 +69,8 @@ static const struct constant_table squashfs_param_errors[] = {
 static const struct fs_parameter_spec squashfs_fs_parameters[] = {
 	fsparam_enum("errors", Opt_errors, squashfs_param_errors),
 	fsparam_string("threads", Opt_threads),
+	fsparam_u32("fragment_cache", Opt_fragment_cache),
+	fsparam_u32("metadata_cache", Opt_metadata_cache),
 	{}
 };
 
@@ -142,6 +148,22 @@ static int squashfs_parse_param(struct fs_context *fc, struct fs_parameter *para
 		if (squashfs_parse_param_threads(param->string, opts) != 0)
 			return -EINVAL;
 		break;
+	case Opt_fragment_cache:
+		if (result.uint_32 < 1 ||
+		    result.uint_32 > SQUASHFS_CACHE_MAX_ENTRIES)
+			return invalfc(fc, "fragment_cache must be between 1 and %d",
+				       SQUASHFS_CACHE_MAX_ENTRIES);
+		opts->fragment_cache = result.uint_32;
+		break;
+	case Opt_metadata_cache:
+		/* the meta index skip logic in file.c relies on this minimum */
+		if (result.uint_32 < SQUASHFS_CACHED_BLKS ||
+		    result.uint_32 > SQUASHFS_CACHE_MAX_ENTRIES)
+			return invalfc(fc, "metadata_cache must be between %d and %d",
+				       SQUASHFS_CACHED_BLKS,
+				       SQUASHFS_CACHE_MAX_ENTRIES);
+		opts->metadata_cache = result.uint_32;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -317,7 +339,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	err = -ENOMEM;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			opts->metadata_cache, SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
@@ -392,7 +414,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		opts->fragment_cache, msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -444,6 +466,13 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto failed_mount;
 	}
 
+	/* With the root in place, put_super() undoes the rest on failure */
+	err = squashfs_register_sysfs(sb);
+	if (err) {
+		kfree(sblk);
+		return err;
+	}
+
 	TRACE("Leaving squashfs_fill_super\n");
 	kfree(sblk);
 	return 0;
@@ -506,6 +535,14 @@ static int squashfs_show_options(struct seq_file *s, struct dentry *root)
 	else
 		seq_puts(s, ",errors=continue");
 
+	if (msblk->fragment_cache &&
+	    msblk->fragment_cache->entries != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(s, ",fragment_cache=%d",
+			   msblk->fragment_cache->entries);
+	if (msblk->block_cache->entries != SQUASHFS_CACHED_BLKS)
+		seq_printf(s, ",metadata_cache=%d",
+			   msblk->block_cache->entries);
+
 #ifdef CONFIG_SQUASHFS_CHOICE_DECOMP_BY_MOUNT
 	if (msblk->thread_ops == &squashfs_decompressor_single) {
 		seq_puts(s, ",threads=single");
@@ -540,6 +577,8 @@ static int squashfs_init_fs_context(struct fs_context *fc)
 #error "fail: unknown squashfs decompression thread mode?"
 #endif
 	opts->thread_num = 0;
+	opts->fragment_cache = SQUASHFS_CACHED_FRAGMENTS;
+	opts->metadata_cache = SQUASHFS_CACHED_BLKS;
 	fc->fs_private = opts;
 	fc->ops = &squashfs_context_ops;
 	return 0;
@@ -569,6 +608,7 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+		squashfs_unregister_sysfs(sb);
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
@@ -623,8 +663,23 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_readahead_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
+	err = squashfs_init_sysfs();
+	if (err) {
+		squashfs_readahead_destroy();
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_exit_sysfs();
+		squashfs_readahead_destroy();
 		destroy_inodecache();
 		return err;
 	}
@@ -638,6 +693,8 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_exit_sysfs();
+	squashfs_readahead_destroy();
 	destroy_inodecache();
 }
 
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * sysfs.c
+ */
+
+/*
+ * This file exports per-mount cache statistics under
+ * /sys/fs/squashfs/<dev>/.  For each of the fragment and metadata caches
+ * there is the number of entries and the number of lookups that hit, missed
+ * and had to wait for an entry to be released.
+ */
+
+#include <linux/fs.h>
+#include <linux/slab.h>
+#include <linux/sysfs.h>
+#include <linux/kobject.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs.h"
+
+enum {
+	attr_cache_size,
+	attr_cache_hits,
+	attr_cache_misses,
+	attr_cache_waits,
+};
+
+struct squashfs_attr {
+	struct attribute attr;
+	short attr_id;
+	int offset;
+};
+
+#define SQUASHFS_CACHE_ATTR(_cache, _name, _field)			\
+static struct squashfs_attr squashfs_attr_##_cache##_##_name = {	\
+	.attr = {.name = __stringify(_cache##_##_name), .mode = 0444 },	\
+	.attr_id = attr_cache_##_name,					\
+	.offset = offsetof(struct squashfs_sb_info, _field),		\
+}
+
+#define SQUASHFS_CACHE_ATTRS(_cache, _field)				\
+	SQUASHFS_CACHE_ATTR(_cache, size, _field);			\
+	SQUASHFS_CACHE_ATTR(_cache, hits, _field);			\
+	SQUASHFS_CACHE_ATTR(_cache, misses, _field);			\
+	SQUASHFS_CACHE_ATTR(_cache, waits, _field)
+
+#define ATTR_LIST(name) (&squashfs_attr_##name.attr)
+
+SQUASHFS_CACHE_ATTRS(fragment_cache, fragment_cache);
+SQUASHFS_CACHE_ATTRS(metadata_cache, block_cache);
+
+static struct attribute *squashfs_attrs[] = {
+	ATTR_LIST(fragment_cache_size),
+	ATTR_LIST(fragment_cache_hits),
+	ATTR_LIST(fragment_cache_misses),
+	ATTR_LIST(fragment_cache_waits),
+	ATTR_LIST(metadata_cache_size),
+	ATTR_LIST(metadata_cache_hits),
+	ATTR_LIST(metadata_cache_misses),
+	ATTR_LIST(metadata_cache_waits),
+	NULL,
+};
+ATTRIBUTE_GROUPS(squashfs);
+
+static ssize_t squashfs_attr_show(struct kobject *kobj,
+				  struct attribute *attr, char *buf)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+				struct squashfs_sb_info, s_kobj);
+	struct squashfs_attr *a = container_of(attr, struct squashfs_attr,
+					       attr);
+	struct squashfs_cache *cache =
+		*(struct squashfs_cache **)((char *)msblk + a->offset);
+	struct squashfs_cache_stats stats;
+
+	squashfs_cache_stats(cache, &stats);
+
+	switch (a->attr_id) {
+	case attr_cache_size:
+		return sysfs_emit(buf, "%d\n", cache ? cache->entries : 0);
+	case attr_cache_hits:
+		return sysfs_emit(buf, "%llu\n", stats.hits);
+	case attr_cache_misses:
+		return sysfs_emit(buf, "%llu\n", stats.misses);
+	case attr_cache_waits:
+		return sysfs_emit(buf, "%llu\n", stats.waits);
+	}
+	return 0;
+}
+
+static void squashfs_sb_release(struct kobject *kobj)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+				struct squashfs_sb_info, s_kobj);
+
+	complete(&msblk->s_kobj_unregister);
+}
+
+static const struct sysfs_ops squashfs_attr_ops = {
+	.show	= squashfs_attr_show,
+};
+
+static struct kobj_type squashfs_sb_ktype = {
+	.default_groups = squashfs_groups,
+	.sysfs_ops	= &squashfs_attr_ops,
+	.release	= squashfs_sb_release,
+};
+
+static struct kset *squashfs_root;
+
+int squashfs_register_sysfs(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int err;
+
+	msblk->s_kobj.kset = squashfs_root;
+	init_completion(&msblk->s_kobj_unregister);
+	err = kobject_init_and_add(&msblk->s_kobj, &squashfs_sb_ktype, NULL,
+				   "%s", sb->s_id);
+	if (err) {
+		kobject_put(&msblk->s_kobj);
+		wait_for_completion(&msblk->s_kobj_unregister);
+	}
+	return err;
+}
+
+void squashfs_unregister_sysfs(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+
+	if (msblk->s_kobj.state_in_sysfs) {
+		kobject_del(&msblk->s_kobj);
+		kobject_put(&msblk->s_kobj);
+		wait_for_completion(&msblk->s_kobj_unregister);
+	}
+}
+
+int __init squashfs_init_sysfs(void)
+{
+	squashfs_root = kset_create_and_add("squashfs", NULL, fs_kobj);
+	return squashfs_root ? 0 : -ENOMEM;
+}
+
+void squashfs_exit_sysfs(void)
+{
+	kset_unregister(squashfs_root);
+}
@@ -54,9 +54,6 @@ static int build_merkle_tree_level(struct file *filp, unsigned int level,
 	u64 i;
 	int err;
 
-	if (WARN_ON(params->block_size != PAGE_SIZE)) /* checked earlier too */
-		return -EINVAL;
-
 	if (level < params->num_levels) {
 		dst_block_num = params->level_start[level];
 	} else {
@@ -68,7 +65,11 @@ static int build_merkle_tree_level(struct file *filp, unsigned int level,
 	file_ra_state_init(&ra, filp->f_mapping);
 
 	for (i = 0; i < num_blocks_to_hash; i++) {
+		const unsigned int log_bpp = params->log_blocks_per_page;
+		unsigned long remaining_pages =
+			((num_blocks_to_hash - i - 1) >> log_bpp) + 1;
 		struct page *src_page;
+		u64 src_block;
 
 		if ((pgoff_t)i % 10000 == 0 || i + 1 == num_blocks_to_hash)
 			pr_debug("Hashing block %llu of %llu for level %u\n",
@@ -76,35 +77,38 @@ static int build_merkle_tree_level(struct file *filp, unsigned int level,
 
 		if (level == 0) {
 			/* Leaf: hashing a data block */
-			src_page = read_file_data_page(filp, i, &ra,
-						       num_blocks_to_hash - i);
+			src_block = i;
+			src_page = read_file_data_page(filp, i >> log_bpp, &ra,
+						       remaining_pages);
 			if (IS_ERR(src_page)) {
 				err = PTR_ERR(src_page);
 				fsverity_err(inode,
 					     "Error %d reading data page %llu",
-					     err, i);
+					     err, i >> log_bpp);
 				return err;
 			}
 		} else {
 			unsigned long num_ra_pages =
-				min_t(unsigned long, num_blocks_to_hash - i,
+				min_t(unsigned long, remaining_pages,
 				      inode->i_sb->s_bdi->io_pages);
 
 			/* Non-leaf: hashing hash block from level below */
+			src_block = params->level_start[level - 1] + i;
 			src_page = vops->read_merkle_tree_page(inode,
-					params->level_start[level - 1] + i,
-					num_ra_pages);
+					src_block >> log_bpp, num_ra_pages);
 			if (IS_ERR(src_page)) {
 				err = PTR_ERR(src_page);
 				fsverity_err(inode,
 					     "Error %d reading Merkle tree page %llu",
-					     err, params->level_start[level - 1] + i);
+					     err, src_block >> log_bpp);
 				return err;
 			}
 		}
 
-		err = fsverity_hash_page(params, inode, req, src_page,
-					 &pending_hashes[pending_size]);
+		err = fsverity_hash_block(params, inode, req, src_page,
+					  (src_block & ((1 << log_bpp) - 1)) <<
+					  params->log_blocksize,
+					  &pending_hashes[pending_size]);
 		put_page(src_page);
 		if (err)
 			return err;
@@ -352,7 +356,7 @@ int fsverity_ioctl_enable(struct file *filp, const void __user *uarg)
 	    memchr_inv(arg.__reserved2, 0, sizeof(arg.__reserved2)))
 		return -EINVAL;
 
-	if (arg.block_size != PAGE_SIZE)
+	if (!is_power_of_2(arg.block_size) || arg.block_size > PAGE_SIZE)
 		return -EINVAL;
 
 	if (arg.salt_size > sizeof_field(struct fsverity_descriptor, salt))
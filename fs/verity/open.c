@@ -54,7 +54,12 @@ int fsverity_init_merkle_tree_params(struct merkle_tree_params *params,
 		goto out_err;
 	}
 
-	if (log_blocksize != PAGE_SHIFT) {
+	/*
+	 * The Merkle tree block size must be a power of 2 that fits in a page,
+	 * since hash blocks are accessed through the page cache.  Blocks
+	 * smaller than a page are tracked by the bitmap in fsverity_info.
+	 */
+	if (log_blocksize < 10 || log_blocksize > PAGE_SHIFT) {
 		fsverity_warn(inode, "Unsupported log_blocksize: %u",
 			      log_blocksize);
 		err = -EINVAL;
@@ -76,6 +81,7 @@ int fsverity_init_merkle_tree_params(struct merkle_tree_params *params,
 	}
 	params->log_arity = params->log_blocksize - ilog2(params->digest_size);
 	params->hashes_per_block = 1 << params->log_arity;
+	params->log_blocks_per_page = PAGE_SHIFT - log_blocksize;
 
 	pr_debug("Merkle tree uses %s with %u-byte blocks (%u hashes/block), salt=%*phN\n",
 		 hash_alg->name, params->block_size, params->hashes_per_block,
@@ -170,6 +176,22 @@ struct fsverity_info *fsverity_create_info(const struct inode *inode,
 
 	memcpy(vi->root_hash, desc->root_hash, vi->tree_params.digest_size);
 
+	if (vi->tree_params.log_blocks_per_page) {
+		/* Whole pages' worth, as bits are cleared a page at a time */
+		unsigned long nr_blocks =
+			round_up(vi->tree_params.tree_size, PAGE_SIZE) >>
+			vi->tree_params.log_blocksize;
+
+		vi->hash_block_verified = kvcalloc(BITS_TO_LONGS(nr_blocks),
+						   sizeof(unsigned long),
+						   GFP_KERNEL);
+		if (!vi->hash_block_verified) {
+			err = -ENOMEM;
+			goto out;
+		}
+		spin_lock_init(&vi->hash_page_init_lock);
+	}
+
 	err = compute_file_digest(vi->tree_params.hash_alg, desc,
 				  vi->file_digest);
 	if (err) {
@@ -214,6 +236,7 @@ void fsverity_free_info(struct fsverity_info *vi)
 	if (!vi)
 		return;
 	kfree(vi->tree_params.hashstate);
+	kvfree(vi->hash_block_verified);
 	kmem_cache_free(fsverity_info_cachep, vi);
 }
 
@@ -23,10 +23,10 @@ static struct workqueue_struct *fsverity_read_workqueue;
  * @hoffset:	(out) the byte offset to the wanted hash within the hash block
  */
 static void hash_at_level(const struct merkle_tree_params *params,
-			  pgoff_t dindex, unsigned int level, pgoff_t *hindex,
-			  unsigned int *hoffset)
+			  unsigned long dindex, unsigned int level,
+			  unsigned long *hindex, unsigned int *hoffset)
 {
-	pgoff_t position;
+	unsigned long position;
 
 	/* Offset of the hash within the level's region, in hashes */
 	position = dindex >> (level * params->log_arity);
@@ -41,7 +41,7 @@ static void hash_at_level(const struct merkle_tree_params *params,
 
 static inline int cmp_hashes(const struct fsverity_info *vi,
 			     const u8 *want_hash, const u8 *real_hash,
-			     pgoff_t index, int level)
+			     u64 data_pos, int level)
 {
 	const unsigned int hsize = vi->tree_params.digest_size;
 
@@ -49,124 +49,283 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
 		return 0;
 
 	fsverity_err(vi->inode,
-		     "FILE CORRUPTED! index=%lu, level=%d, want_hash=%s:%*phN, real_hash=%s:%*phN",
-		     index, level,
+		     "FILE CORRUPTED! pos=%llu, level=%d, want_hash=%s:%*phN, real_hash=%s:%*phN",
+		     data_pos, level,
 		     vi->tree_params.hash_alg->name, hsize, want_hash,
 		     vi->tree_params.hash_alg->name, hsize, real_hash);
 	return -EBADMSG;
 }
 
 /*
- * Verify a single data page against the file's Merkle tree.
+ * Return true if the hash block with index @hblock_idx, which is contained in
+ * @hpage, has already been verified.
+ */
+static bool is_hash_block_verified(struct fsverity_info *vi, struct page *hpage,
+				   unsigned long hblock_idx)
+{
+	const unsigned int log_bpp = vi->tree_params.log_blocks_per_page;
+	unsigned long first = round_down(hblock_idx, 1UL << log_bpp);
+	unsigned long i;
+	bool verified;
+
+	/* When blocks and pages are the same size, PageChecked says it all. */
+	if (!vi->hash_block_verified)
+		return PageChecked(hpage);
+
+	/*
+	 * The bits in the bitmap only hold for as long as the page stays in
+	 * the page cache.  If it gets evicted and read in again, the new copy
+	 * hasn't been checked, but its bits may still be set.  A freshly read
+	 * page doesn't have PageChecked set, so the first time we see it we
+	 * clear the bits for all its blocks, then set PageChecked to say that
+	 * they are meaningful again.
+	 */
+	if (PageChecked(hpage)) {
+		/* Pairs with the smp_wmb() below. */
+		smp_rmb();
+		return test_bit(hblock_idx, vi->hash_block_verified);
+	}
+
+	spin_lock(&vi->hash_page_init_lock);
+	if (PageChecked(hpage)) {
+		verified = test_bit(hblock_idx, vi->hash_block_verified);
+	} else {
+		for (i = first; i < first + (1UL << log_bpp); i++)
+			clear_bit(i, vi->hash_block_verified);
+		smp_wmb();
+		SetPageChecked(hpage);
+		verified = false;
+	}
+	spin_unlock(&vi->hash_page_init_lock);
+	return verified;
+}
+
+static void set_hash_block_verified(struct fsverity_info *vi,
+				    struct page *hpage,
+				    unsigned long hblock_idx)
+{
+	if (vi->hash_block_verified)
+		set_bit(hblock_idx, vi->hash_block_verified);
+	else
+		SetPageChecked(hpage);
+}
+
+/*
+ * State carried between the data blocks of a batch (a page or a bio) being
+ * verified.  Data blocks that are adjacent in the file share their level 0
+ * hash block, so we keep hold of the page containing the last one that we know
+ * to be verified and reuse it rather than getting it from the filesystem again
+ * for every data block.
+ */
+struct verify_batch {
+	struct page	*hpage;		/* Page of verified level 0 hash block */
+	unsigned long	hindex;		/* Index of that block in the tree */
+};
+
+/* Remember a verified level 0 hash block; takes over the caller's page ref. */
+static void verify_batch_keep(struct verify_batch *batch, struct page *hpage,
+			      unsigned long hindex)
+{
+	if (batch->hpage)
+		put_page(batch->hpage);
+	batch->hpage = hpage;
+	batch->hindex = hindex;
+}
+
+static void verify_batch_end(struct verify_batch *batch)
+{
+	if (batch->hpage)
+		put_page(batch->hpage);
+	batch->hpage = NULL;
+}
+
+/*
+ * A data block fully past EOF isn't covered by the Merkle tree.  This can only
+ * happen in the page spanning EOF when the block size is less than the page
+ * size; the whole page may be mapped by userspace, so the part past EOF must
+ * be all zeroes.
+ */
+static bool data_block_is_zeroed(struct inode *inode, struct page *page,
+				 unsigned int len, unsigned int offset)
+{
+	void *virt = kmap_local_page(page);
+	bool zeroed = !memchr_inv(virt + offset, 0, len);
+
+	kunmap_local(virt);
+	if (!zeroed)
+		fsverity_err(inode,
+			     "FILE CORRUPTED!  Data past EOF is not zeroed");
+	return zeroed;
+}
+
+/*
+ * Verify a single data block against the file's Merkle tree.
  *
  * In principle, we need to verify the entire path to the root node.  However,
  * for efficiency the filesystem may cache the hash pages.  Therefore we need
- * only ascend the tree until an already-verified page is seen, as indicated by
- * the PageChecked bit being set; then verify the path to that page.
+ * only ascend the tree until an already-verified hash block is seen, as
+ * indicated by is_hash_block_verified(); then verify the path to that block.
  *
- * This code currently only supports the case where the verity block size is
- * equal to PAGE_SIZE.  Doing otherwise would be possible but tricky, since we
- * wouldn't be able to use the PageChecked bit.
+ * Note that multiple processes may race to verify a hash block and mark it
+ * verified, but it doesn't matter; the result will be the same either way.
  *
- * Note that multiple processes may race to verify a hash page and mark it
- * Checked, but it doesn't matter; the result will be the same either way.
+ * The level 0 hash block that @batch holds is used if it covers the data
+ * block, and the level 0 hash block used for the data block is left in it.
  *
- * Return: true if the page is valid, else false.
+ * Return: true if the data block is valid, else false.
  */
-static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
-			struct ahash_request *req, struct page *data_page,
-			unsigned long level0_ra_pages)
+static bool verify_data_block(struct inode *inode, struct fsverity_info *vi,
+			      struct ahash_request *req, struct page *data_page,
+			      u64 data_pos, unsigned int doffset,
+			      unsigned long level0_ra_pages,
+			      struct verify_batch *batch)
 {
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
-	const pgoff_t index = data_page->index;
+	const unsigned int log_bpp = params->log_blocks_per_page;
+	const unsigned long dindex = data_pos >> params->log_blocksize;
 	int level;
 	u8 _want_hash[FS_VERITY_MAX_DIGEST_SIZE];
 	const u8 *want_hash;
 	u8 real_hash[FS_VERITY_MAX_DIGEST_SIZE];
-	struct page *hpages[FS_VERITY_MAX_LEVELS];
-	unsigned int hoffsets[FS_VERITY_MAX_LEVELS];
+	/* The hash blocks that are traversed, indexed by level */
+	struct {
+		struct page *page;	/* Page containing the hash block */
+		unsigned long index;	/* Index of the block in the tree */
+		unsigned int boffset;	/* Offset of the block in the page */
+		unsigned int hoffset;	/* Offset of the wanted hash in page */
+	} hblocks[FS_VERITY_MAX_LEVELS];
 	int err;
 
-	if (WARN_ON_ONCE(!PageLocked(data_page) || PageUptodate(data_page)))
-		return false;
+	if (unlikely(data_pos >= inode->i_size))
+		return data_block_is_zeroed(inode, data_page,
+					    params->block_size, doffset);
 
-	pr_debug_ratelimited("Verifying data page %lu...\n", index);
+	pr_debug_ratelimited("Verifying data block at %llu...\n", data_pos);
 
 	/*
-	 * Starting at the leaf level, ascend the tree saving hash pages along
-	 * the way until we find a verified hash page, indicated by PageChecked;
-	 * or until we reach the root.
+	 * Starting at the leaf level, ascend the tree saving hash blocks along
+	 * the way until we find a verified hash block or until we reach the
+	 * root.
 	 */
 	for (level = 0; level < params->num_levels; level++) {
-		pgoff_t hindex;
-		unsigned int hoffset;
+		unsigned long hindex;
+		unsigned int boffset, hoffset;
 		struct page *hpage;
 
-		hash_at_level(params, index, level, &hindex, &hoffset);
+		hash_at_level(params, dindex, level, &hindex, &hoffset);
+		boffset = (hindex & ((1UL << log_bpp) - 1)) <<
+			  params->log_blocksize;
+		hoffset += boffset;
 
 		pr_debug_ratelimited("Level %d: hindex=%lu, hoffset=%u\n",
 				     level, hindex, hoffset);
 
-		hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode, hindex,
+		if (level == 0 && batch->hpage && batch->hindex == hindex) {
+			memcpy_from_page(_want_hash, batch->hpage, hoffset,
+					 hsize);
+			want_hash = _want_hash;
+			goto descend;
+		}
+
+		hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode,
+				hindex >> log_bpp,
 				level == 0 ? level0_ra_pages : 0);
 		if (IS_ERR(hpage)) {
 			err = PTR_ERR(hpage);
 			fsverity_err(inode,
 				     "Error %d reading Merkle tree page %lu",
-				     err, hindex);
+				     err, hindex >> log_bpp);
 			goto out;
 		}
 
-		if (PageChecked(hpage)) {
+		if (is_hash_block_verified(vi, hpage, hindex)) {
 			memcpy_from_page(_want_hash, hpage, hoffset, hsize);
 			want_hash = _want_hash;
-			put_page(hpage);
-			pr_debug_ratelimited("Hash page already checked, want %s:%*phN\n",
+			if (level == 0)
+				verify_batch_keep(batch, hpage, hindex);
+			else
+				put_page(hpage);
+			pr_debug_ratelimited("Hash block already checked, want %s:%*phN\n",
 					     params->hash_alg->name,
 					     hsize, want_hash);
 			goto descend;
 		}
-		pr_debug_ratelimited("Hash page not yet checked\n");
-		hpages[level] = hpage;
-		hoffsets[level] = hoffset;
+		pr_debug_ratelimited("Hash block not yet checked\n");
+		hblocks[level].page = hpage;
+		hblocks[level].index = hindex;
+		hblocks[level].boffset = boffset;
+		hblocks[level].hoffset = hoffset;
 	}
 
 	want_hash = vi->root_hash;
 	pr_debug("Want root hash: %s:%*phN\n",
 		 params->hash_alg->name, hsize, want_hash);
 descend:
-	/* Descend the tree verifying hash pages */
+	/* Descend the tree verifying hash blocks */
 	for (; level > 0; level--) {
-		struct page *hpage = hpages[level - 1];
-		unsigned int hoffset = hoffsets[level - 1];
+		struct page *hpage = hblocks[level - 1].page;
+		unsigned long hindex = hblocks[level - 1].index;
 
-		err = fsverity_hash_page(params, inode, req, hpage, real_hash);
+		err = fsverity_hash_block(params, inode, req, hpage,
+					  hblocks[level - 1].boffset,
+					  real_hash);
 		if (err)
 			goto out;
-		err = cmp_hashes(vi, want_hash, real_hash, index, level - 1);
+		err = cmp_hashes(vi, want_hash, real_hash, data_pos, level - 1);
 		if (err)
 			goto out;
-		SetPageChecked(hpage);
-		memcpy_from_page(_want_hash, hpage, hoffset, hsize);
+		set_hash_block_verified(vi, hpage, hindex);
+		memcpy_from_page(_want_hash, hpage, hblocks[level - 1].hoffset,
+				 hsize);
 		want_hash = _want_hash;
-		put_page(hpage);
-		pr_debug("Verified hash page at level %d, now want %s:%*phN\n",
+		if (level == 1)
+			verify_batch_keep(batch, hpage, hindex);
+		else
+			put_page(hpage);
+		pr_debug("Verified hash block at level %d, now want %s:%*phN\n",
 			 level - 1, params->hash_alg->name, hsize, want_hash);
 	}
 
-	/* Finally, verify the data page */
-	err = fsverity_hash_page(params, inode, req, data_page, real_hash);
+	/* Finally, verify the data block */
+	err = fsverity_hash_block(params, inode, req, data_page, doffset,
+				  real_hash);
 	if (err)
 		goto out;
-	err = cmp_hashes(vi, want_hash, real_hash, index, -1);
+	err = cmp_hashes(vi, want_hash, real_hash, data_pos, -1);
 out:
 	for (; level > 0; level--)
-		put_page(hpages[level - 1]);
+		put_page(hblocks[level - 1].page);
 
 	return err == 0;
 }
 
+/*
+ * Verify all the data blocks in a data page.
+ *
+ * Return: true if the page is valid, else false.
+ */
+static bool verify_data_page(struct inode *inode, struct fsverity_info *vi,
+			     struct ahash_request *req, struct page *data_page,
+			     unsigned long level0_ra_pages,
+			     struct verify_batch *batch)
+{
+	const unsigned int block_size = vi->tree_params.block_size;
+	u64 pos = (u64)data_page->index << PAGE_SHIFT;
+	unsigned int offset;
+
+	if (WARN_ON_ONCE(!PageLocked(data_page) || PageUptodate(data_page)))
+		return false;
+
+	for (offset = 0; offset < PAGE_SIZE; offset += block_size) {
+		if (!verify_data_block(inode, vi, req, data_page,
+				       pos + offset, offset, level0_ra_pages,
+				       batch))
+			return false;
+	}
+	return true;
+}
+
 /**
  * fsverity_verify_page() - verify a data page
  * @page: the page to verity
@@ -179,14 +338,16 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 bool fsverity_verify_page(struct page *page)
 {
 	struct inode *inode = page->mapping->host;
-	const struct fsverity_info *vi = inode->i_verity_info;
+	struct fsverity_info *vi = inode->i_verity_info;
+	struct verify_batch batch = { NULL };
 	struct ahash_request *req;
 	bool valid;
 
 	/* This allocation never fails, since it's mempool-backed. */
 	req = fsverity_alloc_hash_request(vi->tree_params.hash_alg, GFP_NOFS);
 
-	valid = verify_page(inode, vi, req, page, 0);
+	valid = verify_data_page(inode, vi, req, page, 0, &batch);
+	verify_batch_end(&batch);
 
 	fsverity_free_hash_request(vi->tree_params.hash_alg, req);
 
@@ -212,8 +373,9 @@ EXPORT_SYMBOL_GPL(fsverity_verify_page);
 void fsverity_verify_bio(struct bio *bio)
 {
 	struct inode *inode = bio_first_page_all(bio)->mapping->host;
-	const struct fsverity_info *vi = inode->i_verity_info;
+	struct fsverity_info *vi = inode->i_verity_info;
 	const struct merkle_tree_params *params = &vi->tree_params;
+	struct verify_batch batch = { NULL };
 	struct ahash_request *req;
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
@@ -239,16 +401,21 @@ void fsverity_verify_bio(struct bio *bio)
 
 	bio_for_each_segment_all(bv, bio, iter_all) {
 		struct page *page = bv->bv_page;
-		unsigned long level0_index = page->index >> params->log_arity;
+		unsigned long level0_index =
+			(page->index << params->log_blocks_per_page) >>
+			params->log_arity;
 		unsigned long level0_ra_pages =
-			min(max_ra_pages, params->level0_blocks - level0_index);
+			min(max_ra_pages, (params->level0_blocks - level0_index) >>
+					  params->log_blocks_per_page);
 
-		if (!verify_page(inode, vi, req, page, level0_ra_pages)) {
+		if (!verify_data_page(inode, vi, req, page, level0_ra_pages,
+				      &batch)) {
 			bio->bi_status = BLK_STS_IOERR;
 			break;
 		}
 	}
 
+	verify_batch_end(&batch);
 	fsverity_free_hash_request(params->hash_alg, req);
 }
 EXPORT_SYMBOL_GPL(fsverity_verify_bio);
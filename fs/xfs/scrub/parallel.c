@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: GPL-2.0+
+#include "xfs.h"
+#include "xfs_fs.h"
+#include "xfs_shared.h"
+#include "xfs_format.h"
+#include "xfs_trans_resv.h"
+#include "xfs_mount.h"
+#include "xfs_inode.h"
+#include "xfs_scrub.h"
+#include "scrub/scrub.h"
+
+#include <linux/task_io_accounting_ops.h>
+
+/*
+ * Parallel Scrub of the Per-AG Metadata
+ * =====================================
+ *
+ * Each scrub call checks one metadata object, so a caller walking every AG
+ * one ioctl at a time checks the AGs one after the other.  The per-AG
+ * scrubbers only lock the headers of the AG they check (and of higher AGs,
+ * when cross-referencing requires it), so different AGs can be scrubbed at
+ * the same time.  Here we queue one work item per AG on an unbound
+ * workqueue; each item scrubs one per-AG metadata type, or all of them in
+ * the same order that xfs_scrub uses, for its AG.
+ *
+ * Userspace gets here by asking for a per-AG metadata type with sm_agno set
+ * to NULLAGNUMBER.  The outcomes of all the AGs are merged into its sm_flags.
+ *
+ * To keep background checking from starving foreground I/O, an in-kernel
+ * caller can set a read budget in bytes per second that all the workers
+ * share.  Each worker charges the bytes that its task read while scrubbing
+ * an object (from the task I/O accounting) and sleeps until the whole run
+ * is back under budget.  Without CONFIG_TASK_IO_ACCOUNTING nothing is
+ * charged and the budget has no effect.
+ *
+ * The progress counters in struct xfs_scrub_ags are updated as each
+ * object is checked, so that whoever started the run can report them
+ * while it goes on.  A fatal signal to the caller stops the run after the
+ * objects being scrubbed.
+ */
+
+/* Per-AG metadata, in the order xfs_scrub checks it. */
+static const unsigned int xchk_ags_types[] = {
+	XFS_SCRUB_TYPE_SB,
+	XFS_SCRUB_TYPE_AGF,
+	XFS_SCRUB_TYPE_AGFL,
+	XFS_SCRUB_TYPE_AGI,
+	XFS_SCRUB_TYPE_BNOBT,
+	XFS_SCRUB_TYPE_CNTBT,
+	XFS_SCRUB_TYPE_INOBT,
+	XFS_SCRUB_TYPE_FINOBT,
+	XFS_SCRUB_TYPE_RMAPBT,
+	XFS_SCRUB_TYPE_REFCNTBT,
+};
+
+struct xchk_ags_ctl {
+	struct workqueue_struct	*wq;
+	struct file		*file;
+	struct xfs_scrub_ags	*xsa;
+
+	/* Task that started the run and waits for it. */
+	struct task_struct	*owner;
+
+	/* When the run started, for the read budget. */
+	unsigned long		start;
+
+	/* Work items not done yet, and the first error any of them hit. */
+	atomic_t		nr_work;
+	wait_queue_head_t	wait;
+	int			error;
+};
+
+struct xchk_ags_work {
+	struct work_struct	work;
+	struct xchk_ags_ctl	*ctl;
+	xfs_agnumber_t		agno;
+};
+
+static inline bool
+xchk_ags_want_abort(
+	struct xchk_ags_ctl	*ctl)
+{
+	return READ_ONCE(ctl->error) || fatal_signal_pending(ctl->owner);
+}
+
+/* Charge what we just read and wait until the run is back under budget. */
+STATIC void
+xchk_ags_throttle(
+	struct xchk_ags_ctl	*ctl,
+	u64			bytes)
+{
+	struct xfs_scrub_ags	*xsa = ctl->xsa;
+	unsigned long		due;
+	u64			total;
+
+	total = atomic64_add_return(bytes, &xsa->bytes_read);
+	if (!xsa->bytes_per_sec)
+		return;
+
+	due = ctl->start + msecs_to_jiffies(div64_u64(total * MSEC_PER_SEC,
+			xsa->bytes_per_sec));
+	while (time_before(jiffies, due) && !xchk_ags_want_abort(ctl))
+		schedule_timeout_idle(min_t(unsigned long, due - jiffies, HZ));
+}
+
+/* Scrub one type of per-AG metadata of an AG. */
+STATIC int
+xchk_ags_one(
+	struct xchk_ags_ctl		*ctl,
+	xfs_agnumber_t			agno,
+	unsigned int			type)
+{
+	struct xfs_scrub_ags		*xsa = ctl->xsa;
+	struct xfs_scrub_metadata	sm = {
+		.sm_type		= type,
+		.sm_agno		= agno,
+		.sm_flags		= xsa->flags,
+	};
+	unsigned long			inblock;
+	int				error;
+
+	inblock = task_io_get_inblock(current);
+	error = xfs_scrub_metadata(ctl->file, &sm);
+	xchk_ags_throttle(ctl,
+		(u64)(task_io_get_inblock(current) - inblock) << 9);
+
+	/* This fs doesn't have this kind of metadata. */
+	if (error == -ENOENT)
+		return 0;
+	if (error)
+		return error;
+
+	atomic_inc(&xsa->objects_done);
+	atomic_or(sm.sm_flags & XFS_SCRUB_FLAGS_OUT, &xsa->oflags);
+	if (sm.sm_flags & (XFS_SCRUB_OFLAG_CORRUPT | XFS_SCRUB_OFLAG_XCORRUPT))
+		atomic_inc(&xsa->nr_corrupt);
+	else if (sm.sm_flags & XFS_SCRUB_OFLAG_PREEN)
+		atomic_inc(&xsa->nr_preen);
+	if (sm.sm_flags & XFS_SCRUB_OFLAG_INCOMPLETE)
+		atomic_inc(&xsa->nr_incomplete);
+	return 0;
+}
+
+/* Scrub the requested per-AG metadata of one AG. */
+STATIC void
+xchk_ags_worker(
+	struct work_struct	*work)
+{
+	struct xchk_ags_work	*xaw;
+	struct xchk_ags_ctl	*ctl;
+	unsigned int		i;
+	int			error = 0;
+
+	xaw = container_of(work, struct xchk_ags_work, work);
+	ctl = xaw->ctl;
+
+	if (ctl->xsa->type) {
+		if (!xchk_ags_want_abort(ctl))
+			error = xchk_ags_one(ctl, xaw->agno, ctl->xsa->type);
+	} else {
+		for (i = 0; i < ARRAY_SIZE(xchk_ags_types) && !error; i++) {
+			if (xchk_ags_want_abort(ctl))
+				break;
+			error = xchk_ags_one(ctl, xaw->agno,
+					xchk_ags_types[i]);
+		}
+	}
+
+	if (error)
+		cmpxchg(&ctl->error, 0, error);
+	else if (!xchk_ags_want_abort(ctl))
+		atomic_inc(&ctl->xsa->ags_done);
+
+	if (atomic_dec_and_test(&ctl->nr_work))
+		wake_up(&ctl->wait);
+}
+
+/*
+ * Scrub the per-AG metadata of every AG, with up to @xsa->nr_threads AGs
+ * being checked at a time.  Returns the first operational error that any
+ * worker hit; corruptions are only counted in @xsa.
+ */
+int
+xfs_scrub_ags(
+	struct file		*file,
+	struct xfs_scrub_ags	*xsa)
+{
+	struct xfs_mount	*mp = XFS_I(file_inode(file))->i_mount;
+	struct xchk_ags_ctl	ctl = {
+		.file		= file,
+		.xsa		= xsa,
+		.owner		= current,
+	};
+	struct xchk_ags_work	*works;
+	xfs_agnumber_t		agcount = mp->m_sb.sb_agcount;
+	xfs_agnumber_t		agno;
+	unsigned int		nr_threads = xsa->nr_threads;
+	int			error = 0;
+
+	if (xsa->flags & ~XFS_SCRUB_FLAGS_IN)
+		return -EINVAL;
+
+	works = kvcalloc(agcount, sizeof(*works), XCHK_GFP_FLAGS);
+	if (!works)
+		return -ENOMEM;
+
+	/* One AG per CPU unless told otherwise. */
+	if (!nr_threads)
+		nr_threads = min_t(unsigned int, agcount, num_online_cpus());
+	nr_threads = clamp_t(unsigned int, nr_threads, 1, WQ_MAX_ACTIVE);
+
+	ctl.wq = alloc_workqueue("xfs-scrub/%s", WQ_UNBOUND | WQ_FREEZABLE,
+			nr_threads, mp->m_super->s_id);
+	if (!ctl.wq) {
+		error = -ENOMEM;
+		goto out_free;
+	}
+	init_waitqueue_head(&ctl.wait);
+	atomic_set(&ctl.nr_work, agcount);
+
+	ctl.start = jiffies;
+	for (agno = 0; agno < agcount; agno++) {
+		works[agno].ctl = &ctl;
+		works[agno].agno = agno;
+		INIT_WORK(&works[agno].work, xchk_ags_worker);
+		queue_work(ctl.wq, &works[agno].work);
+	}
+
+	/* Wake up now and then so that we don't look like a hung task. */
+	while (!wait_event_timeout(ctl.wait, !atomic_read(&ctl.nr_work), HZ))
+		;
+
+	destroy_workqueue(ctl.wq);
+	error = ctl.error;
+	if (!error && fatal_signal_pending(current))
+		error = -EINTR;
+out_free:
+	kvfree(works);
+	return error;
+}
+
+/*
+ * Scrub @sm->sm_type on every AG in parallel, for a scrub call that asked
+ * for a per-AG type with sm_agno set to NULLAGNUMBER.  Repairs take locks
+ * across AGs, so they are only done one AG at a time.
+ */
+int
+xchk_all_ags(
+	struct file			*file,
+	struct xfs_scrub_metadata	*sm)
+{
+	struct xfs_scrub_ags		xsa = {
+		.type			= sm->sm_type,
+		.flags			= sm->sm_flags,
+	};
+	int				error;
+
+	if (sm->sm_flags & XFS_SCRUB_IFLAG_REPAIR)
+		return -EINVAL;
+
+	error = xfs_scrub_ags(file, &xsa);
+	sm->sm_flags |= atomic_read(&xsa.oflags);
+	return error;
+}
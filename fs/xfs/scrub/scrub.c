@@ -377,8 +377,10 @@ xchk_validate_inputs(
 			goto out;
 		break;
 	case ST_PERAG:
+		/* NULLAGNUMBER asks for all AGs, see xchk_all_ags() */
 		if (sm->sm_ino || sm->sm_gen ||
-		    sm->sm_agno >= mp->m_sb.sb_agcount)
+		    (sm->sm_agno >= mp->m_sb.sb_agcount &&
+		     sm->sm_agno != NULLAGNUMBER))
 			goto out;
 		break;
 	case ST_INODE:
@@ -467,6 +469,12 @@ xfs_scrub_metadata(
 	xfs_warn_mount(mp, XFS_OPSTATE_WARNED_SCRUB,
  "EXPERIMENTAL online scrub feature in use. Use at your own risk!");
 
+	if (meta_scrub_ops[sm->sm_type].type == ST_PERAG &&
+	    sm->sm_agno == NULLAGNUMBER) {
+		error = xchk_all_ags(file, sm);
+		goto out;
+	}
+
 	sc = kzalloc(sizeof(struct xfs_scrub), XCHK_GFP_FLAGS);
 	if (!sc) {
 		error = -ENOMEM;
@@ -99,6 +99,9 @@ struct xfs_scrub {
 #define XCHK_REAPING_DISABLED	(1 << 2)  /* background block reaping paused */
 #define XREP_ALREADY_FIXED	(1 << 31) /* checking our repair work */
 
+/* Scrub a per-AG type on all AGs in parallel */
+int xchk_all_ags(struct file *file, struct xfs_scrub_metadata *sm);
+
 /* Metadata scrubbers */
 int xchk_tester(struct xfs_scrub *sc);
 int xchk_superblock(struct xfs_scrub *sc);
@@ -6,10 +6,38 @@
 #ifndef __XFS_SCRUB_H__
 #define __XFS_SCRUB_H__
 
+/*
+ * Scrub of the per-AG metadata of all AGs in parallel.  The caller fills in
+ * the first four fields; the others count the progress of the run.
+ */
+struct xfs_scrub_ags {
+	/* XFS_SCRUB_TYPE_* to scrub, or zero for all the per-AG types. */
+	unsigned int	type;
+
+	/* AGs scrubbed at a time, or zero for one per CPU. */
+	unsigned int	nr_threads;
+
+	/* XFS_SCRUB_IFLAG_* for each scrub. */
+	__u32		flags;
+
+	/* Metadata read budget of all the workers, or zero for no limit. */
+	u64		bytes_per_sec;
+
+	atomic_t	ags_done;
+	atomic_t	objects_done;
+	atomic_t	nr_corrupt;
+	atomic_t	nr_preen;
+	atomic_t	nr_incomplete;
+	atomic_t	oflags;		/* XFS_SCRUB_OFLAG_* of all the scrubs */
+	atomic64_t	bytes_read;
+};
+
 #ifndef CONFIG_XFS_ONLINE_SCRUB
 # define xfs_scrub_metadata(file, sm)	(-ENOTTY)
+# define xfs_scrub_ags(file, xsa)	(-ENOTTY)
 #else
 int xfs_scrub_metadata(struct file *file, struct xfs_scrub_metadata *sm);
+int xfs_scrub_ags(struct file *file, struct xfs_scrub_ags *xsa);
 #endif /* CONFIG_XFS_ONLINE_SCRUB */
 
 #endif	/* __XFS_SCRUB_H__ */
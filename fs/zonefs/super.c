@@ -267,7 +267,7 @@ static const struct address_space_operations zonefs_file_aops = {
 	.read_folio		= zonefs_read_folio,
 	.readahead		= zonefs_readahead,
 	.writepages		= zonefs_writepages,
-	.dirty_folio		= filemap_dirty_folio,
+	.dirty_folio		= iomap_dirty_folio,
 	.release_folio		= iomap_release_folio,
 	.invalidate_folio	= iomap_invalidate_folio,
 	.migrate_folio		= filemap_migrate_folio,
@@ -772,12 +772,114 @@ static const struct iomap_dio_ops zonefs_write_dio_ops = {
 	.end_io			= zonefs_file_write_dio_end_io,
 };
 
+/*
+ * Asynchronous zone append writes to sequential zone files. The inode lock
+ * is only held while the BIO is submitted, so several appends to one file
+ * can be in flight. The device decides where each of them lands, so the
+ * order in which they are issued does not matter, and on completion the
+ * kiocb position is set to where the data was actually written.
+ */
+struct zonefs_append_io {
+	struct kiocb		*iocb;
+	ssize_t			size;
+	struct work_struct	work;
+	struct bio		bio;
+};
+
+static struct bio_set zonefs_append_bio_set;
+static struct workqueue_struct *zonefs_append_wq;
+
+/*
+ * Check that a zone append BIO of @size bytes landed within the part of the
+ * zone that we accounted for, that is, below @wpoffset. Without other appends
+ * in flight, it must have been written exactly at the end of that range.
+ */
+static int zonefs_file_dio_append_check(struct inode *inode, struct bio *bio,
+					ssize_t size, loff_t wpoffset,
+					bool exact)
+{
+	struct zonefs_inode_info *zi = ZONEFS_I(inode);
+	sector_t wpsector = zi->i_zsector + (wpoffset >> SECTOR_SHIFT);
+	sector_t sector = bio->bi_iter.bi_sector;
+	sector_t end = sector + (size >> SECTOR_SHIFT);
+
+	if (exact ? end != wpsector :
+	    sector < zi->i_zsector || end > wpsector) {
+		zonefs_warn(inode->i_sb,
+			"Corrupted write pointer %llu for zone at %llu\n",
+			wpsector - (size >> SECTOR_SHIFT), zi->i_zsector);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void zonefs_file_dio_append_work(struct work_struct *work)
+{
+	struct zonefs_append_io *io =
+		container_of(work, struct zonefs_append_io, work);
+	struct kiocb *iocb = io->iocb;
+	struct inode *inode = file_inode(iocb->ki_filp);
+	struct zonefs_inode_info *zi = ZONEFS_I(inode);
+	struct bio *bio = &io->bio;
+	ssize_t size = io->size;
+	int ret = blk_status_to_errno(bio->bi_status);
+
+	mutex_lock(&zi->i_truncate_mutex);
+	if (!ret)
+		ret = zonefs_file_dio_append_check(inode, bio, size,
+						   zi->i_wpoffset, false);
+	zi->i_wr_appends--;
+	mutex_unlock(&zi->i_truncate_mutex);
+
+	if (!ret)
+		iocb->ki_pos = (bio->bi_iter.bi_sector - zi->i_zsector)
+			<< SECTOR_SHIFT;
+	zonefs_file_write_dio_end_io(iocb, size, ret, 0);
+	trace_zonefs_file_dio_append(inode, size, ret);
+	if (!ret)
+		iocb->ki_pos += size;
+
+	bio_release_pages(bio, false);
+	bio_put(bio);
+	inode_dio_end(inode);
+
+	iocb->ki_complete(iocb, ret ? ret : size);
+}
+
+static void zonefs_file_dio_append_end_io(struct bio *bio)
+{
+	struct zonefs_append_io *io =
+		container_of(bio, struct zonefs_append_io, bio);
+
+	/* Completion needs i_truncate_mutex, so it can't be done here. */
+	queue_work(zonefs_append_wq, &io->work);
+}
+
+/* Take i_truncate_mutex, without waiting for it for IOCB_NOWAIT. */
+static int zonefs_lock_truncate_mutex(struct zonefs_inode_info *zi,
+				      struct kiocb *iocb)
+{
+	if (iocb->ki_flags & IOCB_NOWAIT) {
+		if (!mutex_trylock(&zi->i_truncate_mutex))
+			return -EAGAIN;
+	} else {
+		mutex_lock(&zi->i_truncate_mutex);
+	}
+
+	return 0;
+}
+
 static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct inode *inode = file_inode(iocb->ki_filp);
 	struct zonefs_inode_info *zi = ZONEFS_I(inode);
 	struct block_device *bdev = inode->i_sb->s_bdev;
 	unsigned int max = bdev_max_zone_append_sectors(bdev);
+	blk_opf_t opf = REQ_OP_ZONE_APPEND | REQ_SYNC | REQ_IDLE;
+	gfp_t gfp = GFP_NOFS;
+	struct zonefs_append_io *io;
+	unsigned int inflight;
 	struct bio *bio;
 	ssize_t size;
 	int nr_pages;
@@ -790,8 +892,14 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 	if (!nr_pages)
 		return 0;
 
-	bio = bio_alloc(bdev, nr_pages,
-			REQ_OP_ZONE_APPEND | REQ_SYNC | REQ_IDLE, GFP_NOFS);
+	if (iocb->ki_flags & IOCB_NOWAIT) {
+		opf |= REQ_NOWAIT;
+		gfp = GFP_NOWAIT;
+	}
+
+	bio = bio_alloc_bioset(bdev, nr_pages, opf, gfp, &zonefs_append_bio_set);
+	if (!bio)
+		return -EAGAIN;
 	bio->bi_iter.bi_sector = zi->i_zsector;
 	bio->bi_ioprio = iocb->ki_ioprio;
 	if (iocb_is_dsync(iocb))
@@ -804,6 +912,43 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 	size = bio->bi_iter.bi_size;
 	task_io_account_write(size);
 
+	if (!is_sync_kiocb(iocb)) {
+		io = container_of(bio, struct zonefs_append_io, bio);
+		io->iocb = iocb;
+		io->size = size;
+		INIT_WORK(&io->work, zonefs_file_dio_append_work);
+		bio->bi_end_io = zonefs_file_dio_append_end_io;
+
+		/*
+		 * Account for the write before issuing it, so that the next
+		 * append can be submitted while this one is in flight. If it
+		 * fails, the error recovery path will correct the write
+		 * pointer offset.
+		 */
+		ret = zonefs_lock_truncate_mutex(zi, iocb);
+		if (ret)
+			goto out_release;
+		zi->i_wpoffset += size;
+		zi->i_wr_appends++;
+		zonefs_account_active(inode);
+		mutex_unlock(&zi->i_truncate_mutex);
+
+		inode_dio_begin(inode);
+		submit_bio(bio);
+		return -EIOCBQUEUED;
+	}
+
+	/*
+	 * Asynchronous appends that are in flight when this one is issued may
+	 * be placed after it, those issued later can't be as we hold the inode
+	 * lock.
+	 */
+	ret = zonefs_lock_truncate_mutex(zi, iocb);
+	if (ret)
+		goto out_release;
+	inflight = zi->i_wr_appends;
+	mutex_unlock(&zi->i_truncate_mutex);
+
 	if (iocb->ki_flags & IOCB_HIPRI)
 		bio_set_polled(bio, iocb);
 
@@ -813,18 +958,18 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 	 * If the file zone was written underneath the file system, the zone
 	 * write pointer may not be where we expect it to be, but the zone
 	 * append write can still succeed. So check manually that we wrote where
-	 * we intended to, that is, at zi->i_wpoffset.
+	 * we intended to, that is, at zi->i_wpoffset, or at least below it if
+	 * asynchronous appends are in flight.
 	 */
 	if (!ret) {
-		sector_t wpsector =
-			zi->i_zsector + (zi->i_wpoffset >> SECTOR_SHIFT);
-
-		if (bio->bi_iter.bi_sector != wpsector) {
-			zonefs_warn(inode->i_sb,
-				"Corrupted write pointer %llu for zone at %llu\n",
-				wpsector, zi->i_zsector);
-			ret = -EIO;
-		}
+		mutex_lock(&zi->i_truncate_mutex);
+		ret = zonefs_file_dio_append_check(inode, bio, size,
+						   zi->i_wpoffset + size,
+						   !inflight);
+		mutex_unlock(&zi->i_truncate_mutex);
+		if (!ret && inflight)
+			iocb->ki_pos = (bio->bi_iter.bi_sector -
+					zi->i_zsector) << SECTOR_SHIFT;
 	}
 
 	zonefs_file_write_dio_end_io(iocb, size, ret, 0);
@@ -927,9 +1072,11 @@ static ssize_t zonefs_file_dio_write(struct kiocb *iocb, struct iov_iter *from)
 	 * For async direct IOs to sequential zone files, refuse IOCB_NOWAIT
 	 * as this can cause write reordering (e.g. the first aio gets EAGAIN
 	 * on the inode lock but the second goes through but is now unaligned).
+	 * This does not apply to IOCB_APPEND writes, which are issued as zone
+	 * appends and placed by the device.
 	 */
 	if (zi->i_ztype == ZONEFS_ZTYPE_SEQ && !sync &&
-	    (iocb->ki_flags & IOCB_NOWAIT))
+	    (iocb->ki_flags & IOCB_NOWAIT) && !(iocb->ki_flags & IOCB_APPEND))
 		return -EOPNOTSUPP;
 
 	if (iocb->ki_flags & IOCB_NOWAIT) {
@@ -952,23 +1099,26 @@ static ssize_t zonefs_file_dio_write(struct kiocb *iocb, struct iov_iter *from)
 
 	/* Enforce sequential writes (append only) in sequential zones */
 	if (zi->i_ztype == ZONEFS_ZTYPE_SEQ) {
-		mutex_lock(&zi->i_truncate_mutex);
+		ret = zonefs_lock_truncate_mutex(zi, iocb);
+		if (ret)
+			goto inode_unlock;
 		if (iocb->ki_pos != zi->i_wpoffset) {
 			mutex_unlock(&zi->i_truncate_mutex);
 			ret = -EINVAL;
 			goto inode_unlock;
 		}
 		mutex_unlock(&zi->i_truncate_mutex);
-		append = sync;
+		append = sync || (iocb->ki_flags & IOCB_APPEND);
 	}
 
+	/* Async zone appends account for themselves when submitted. */
 	if (append)
 		ret = zonefs_file_dio_append(iocb, from);
 	else
 		ret = iomap_dio_rw(iocb, from, &zonefs_write_iomap_ops,
 				   &zonefs_write_dio_ops, 0, NULL, 0);
 	if (zi->i_ztype == ZONEFS_ZTYPE_SEQ &&
-	    (ret > 0 || ret == -EIOCBQUEUED)) {
+	    (ret > 0 || (ret == -EIOCBQUEUED && !append))) {
 		if (ret > 0)
 			count = ret;
 
@@ -1282,6 +1432,7 @@ static struct inode *zonefs_alloc_inode(struct super_block *sb)
 	inode_init_once(&zi->i_vnode);
 	mutex_init(&zi->i_truncate_mutex);
 	zi->i_wr_refcnt = 0;
+	zi->i_wr_appends = 0;
 	zi->i_flags = 0;
 
 	return &zi->i_vnode;
@@ -1955,10 +2106,22 @@ static int __init zonefs_init(void)
 	if (ret)
 		return ret;
 
-	ret = zonefs_sysfs_init();
+	ret = bioset_init(&zonefs_append_bio_set, 4,
+			  offsetof(struct zonefs_append_io, bio),
+			  BIOSET_NEED_BVECS);
 	if (ret)
 		goto destroy_inodecache;
 
+	zonefs_append_wq = alloc_workqueue("zonefs_append", WQ_MEM_RECLAIM, 0);
+	if (!zonefs_append_wq) {
+		ret = -ENOMEM;
+		goto exit_bioset;
+	}
+
+	ret = zonefs_sysfs_init();
+	if (ret)
+		goto destroy_wq;
+
 	ret = register_filesystem(&zonefs_type);
 	if (ret)
 		goto sysfs_exit;
@@ -1967,6 +2130,10 @@ static int __init zonefs_init(void)
 
 sysfs_exit:
 	zonefs_sysfs_exit();
+destroy_wq:
+	destroy_workqueue(zonefs_append_wq);
+exit_bioset:
+	bioset_exit(&zonefs_append_bio_set);
 destroy_inodecache:
 	zonefs_destroy_inodecache();
 
@@ -1977,6 +2144,8 @@ static void __exit zonefs_exit(void)
 {
 	unregister_filesystem(&zonefs_type);
 	zonefs_sysfs_exit();
+	destroy_workqueue(zonefs_append_wq);
+	bioset_exit(&zonefs_append_bio_set);
 	zonefs_destroy_inodecache();
 }
 
@@ -82,6 +82,7 @@ struct zonefs_inode_info {
 
 	/* guarded by i_truncate_mutex */
 	unsigned int		i_wr_refcnt;
+	unsigned int		i_wr_appends;
 	unsigned int		i_flags;
 };
 
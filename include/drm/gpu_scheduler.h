@@ -47,6 +47,7 @@ struct drm_gem_object;
 
 struct drm_gpu_scheduler;
 struct drm_sched_rq;
+struct drm_printer;
 
 /* These are often used as an (initial) index
  * to an array, and as such should start at 0.
@@ -61,11 +62,39 @@ enum drm_sched_priority {
 	DRM_SCHED_PRIORITY_UNSET = -2
 };
 
-/* Used to chose between FIFO and RR jobs scheduling */
+/* Used to chose between FIFO, RR and fair jobs scheduling */
 extern int drm_sched_policy;
 
 #define DRM_SCHED_POLICY_RR    0
 #define DRM_SCHED_POLICY_FIFO  1
+#define DRM_SCHED_POLICY_FAIR  2
+
+/**
+ * struct drm_sched_entity_stats - execution statistics of an entity
+ *
+ * @kref: jobs hold a reference until they are freed, which can be after
+ *        their entity is gone.
+ * @lock: protects the fields below.
+ * @runtime: GPU time of the jobs that finished, from the scheduled to the
+ *           finished timestamp of their fences.
+ * @queue_time: time the jobs spent in the entity queue before being run.
+ * @queue_time_max: the longest time a job spent in the entity queue.
+ * @jobs: number of jobs that finished.
+ * @vruntime: GPU time as seen by the fair policy; see
+ *            drm_sched_rq_select_entity_fair().
+ * @avg_job: running average of the GPU time of a job, charged to @vruntime
+ *           when a job is run until its actual time is known.
+ */
+struct drm_sched_entity_stats {
+	struct kref			kref;
+	spinlock_t			lock;
+	ktime_t				runtime;
+	ktime_t				queue_time;
+	ktime_t				queue_time_max;
+	u64				jobs;
+	ktime_t				vruntime;
+	ktime_t				avg_job;
+};
 
 /**
  * struct drm_sched_entity - A wrapper around a job queue (typically
@@ -228,6 +257,14 @@ struct drm_sched_entity {
 	 */
 	struct rb_node			rb_tree_node;
 
+	/**
+	 * @stats:
+	 *
+	 * Execution statistics, used by the fair policy and reported with
+	 * drm_sched_entity_print_stats().
+	 */
+	struct drm_sched_entity_stats	*stats;
+
 };
 
 /**
@@ -238,6 +275,7 @@ struct drm_sched_entity {
  * @entities: list of the entities to be scheduled.
  * @current_entity: the entity which is to be scheduled.
  * @rb_tree_root: root of time based priory queue of entities for FIFO scheduling
+ * @min_vruntime: vruntime of the last entity picked by the fair policy
  *
  * Run queue is a set of entities scheduling command submissions for
  * one specific ring. It implements the scheduling policy that selects
@@ -249,6 +287,7 @@ struct drm_sched_rq {
 	struct list_head		entities;
 	struct drm_sched_entity		*current_entity;
 	struct rb_root_cached		rb_tree_root;
+	ktime_t				min_vruntime;
 };
 
 /**
@@ -355,6 +394,17 @@ struct drm_sched_job {
 	 * When the job was pushed into the entity queue.
 	 */
 	ktime_t                         submit_ts;
+
+	/**
+	 * @entity_stats:
+	 *
+	 * Statistics of @entity, referenced from drm_sched_job_arm() until
+	 * drm_sched_job_cleanup().
+	 */
+	struct drm_sched_entity_stats	*entity_stats;
+
+	/** @charged: the estimate of its GPU time charged when it was run */
+	ktime_t				charged;
 };
 
 static inline bool drm_sched_invalidate_job(struct drm_sched_job *s_job,
@@ -406,14 +456,14 @@ struct drm_sched_backend_ops {
 	 * Drivers typically issue a reset to recover from GPU hangs, and this
 	 * procedure usually follows the following workflow:
 	 *
-	 * 1. Stop the scheduler using drm_sched_stop(). This will park the
-	 *    scheduler thread and cancel the timeout work, guaranteeing that
+	 * 1. Stop the scheduler using drm_sched_stop(). This will stop the
+	 *    submission work and cancel the timeout work, guaranteeing that
 	 *    nothing is queued while we reset the hardware queue
 	 * 2. Try to gracefully stop non-faulty jobs (optional)
 	 * 3. Issue a GPU reset (driver-specific)
 	 * 4. Re-submit jobs using drm_sched_resubmit_jobs()
 	 * 5. Restart the scheduler using drm_sched_start(). At that point, new
-	 *    jobs can be queued, and the scheduler thread is unblocked
+	 *    jobs can be queued, and the submission work is restarted
 	 *
 	 * Note that some GPUs have distinct hardware queues but need to reset
 	 * the GPU globally, which requires extra synchronization between the
@@ -456,8 +506,6 @@ struct drm_sched_backend_ops {
  * @timeout: the time after which a job is removed from the scheduler.
  * @name: name of the ring for which this scheduler is being used.
  * @sched_rq: priority wise array of run queues.
- * @wake_up_worker: the wait queue on which the scheduler sleeps until a job
- *                  is ready to be scheduled.
  * @job_scheduled: once @drm_sched_entity_do_release is called the scheduler
  *                 waits on this wait queue until all the scheduled jobs are
  *                 finished.
@@ -466,7 +514,9 @@ struct drm_sched_backend_ops {
  * @timeout_wq: workqueue used to queue @work_tdr
  * @work_tdr: schedules a delayed call to @drm_sched_job_timedout after the
  *            timeout interval is over.
- * @thread: the kthread on which the scheduler which run.
+ * @submit_wq: workqueue on which @work_run_job and @work_free_job run.
+ * @work_run_job: work which calls run_job op of each scheduler.
+ * @work_free_job: work which calls free_job op of each scheduler.
  * @pending_list: the list of jobs which are currently in the job queue.
  * @job_list_lock: lock to protect the pending_list.
  * @hang_limit: once the hangs by a job crosses this limit then it is marked
@@ -475,6 +525,8 @@ struct drm_sched_backend_ops {
  * @_score: score used when the driver doesn't provide one
  * @ready: marks if the underlying HW is ready to work
  * @free_guilty: A hit to time out handler to free the guilty job.
+ * @pause_submit: pause queuing of @work_run_job and @work_free_job.
+ * @own_submit_wq: we own @submit_wq, allocated by drm_sched_init().
  * @dev: system &struct device
  *
  * One scheduler is implemented for each hardware ring.
@@ -485,13 +537,14 @@ struct drm_gpu_scheduler {
 	long				timeout;
 	const char			*name;
 	struct drm_sched_rq		sched_rq[DRM_SCHED_PRIORITY_COUNT];
-	wait_queue_head_t		wake_up_worker;
 	wait_queue_head_t		job_scheduled;
 	atomic_t			hw_rq_count;
 	atomic64_t			job_id_count;
 	struct workqueue_struct		*timeout_wq;
 	struct delayed_work		work_tdr;
-	struct task_struct		*thread;
+	struct workqueue_struct		*submit_wq;
+	struct work_struct		work_run_job;
+	struct work_struct		work_free_job;
 	struct list_head		pending_list;
 	spinlock_t			job_list_lock;
 	int				hang_limit;
@@ -499,11 +552,14 @@ struct drm_gpu_scheduler {
 	atomic_t                        _score;
 	bool				ready;
 	bool				free_guilty;
+	bool				pause_submit;
+	bool				own_submit_wq;
 	struct device			*dev;
 };
 
 int drm_sched_init(struct drm_gpu_scheduler *sched,
 		   const struct drm_sched_backend_ops *ops,
+		   struct workqueue_struct *submit_wq,
 		   uint32_t hw_submission, unsigned hang_limit,
 		   long timeout, struct workqueue_struct *timeout_wq,
 		   atomic_t *score, const char *name, struct device *dev);
@@ -529,6 +585,9 @@ void drm_sched_entity_modify_sched(struct drm_sched_entity *entity,
 
 void drm_sched_job_cleanup(struct drm_sched_job *job);
 void drm_sched_wakeup(struct drm_gpu_scheduler *sched);
+bool drm_sched_wqueue_ready(struct drm_gpu_scheduler *sched);
+void drm_sched_wqueue_stop(struct drm_gpu_scheduler *sched);
+void drm_sched_wqueue_start(struct drm_gpu_scheduler *sched);
 void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad);
 void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery);
 void drm_sched_resubmit_jobs(struct drm_gpu_scheduler *sched);
@@ -546,6 +605,7 @@ void drm_sched_rq_remove_entity(struct drm_sched_rq *rq,
 				struct drm_sched_entity *entity);
 
 void drm_sched_rq_update_fifo(struct drm_sched_entity *entity, ktime_t ts);
+void drm_sched_rq_update_fair(struct drm_sched_entity *entity);
 
 int drm_sched_entity_init(struct drm_sched_entity *entity,
 			  enum drm_sched_priority priority,
@@ -561,6 +621,12 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job);
 void drm_sched_entity_set_priority(struct drm_sched_entity *entity,
 				   enum drm_sched_priority priority);
 bool drm_sched_entity_is_ready(struct drm_sched_entity *entity);
+struct drm_sched_entity_stats *
+drm_sched_entity_stats_get(struct drm_sched_entity_stats *stats);
+void drm_sched_entity_stats_put(struct drm_sched_entity_stats *stats);
+void drm_sched_entity_print_stats(struct drm_printer *p,
+				  struct drm_sched_entity *entity,
+				  const char *name);
 
 struct drm_sched_fence *drm_sched_fence_alloc(
 	struct drm_sched_entity *s_entity, void *owner);
@@ -482,6 +482,11 @@ struct cgroup {
 	struct cgroup_base_stat bstat;
 	struct prev_cputime prev_cputime;	/* for printing out cputime */
 
+	/* rstat flushes of this subtree, protected by cgroup_rstat_lock */
+	u64 rstat_flush_nr;
+	u64 rstat_flush_shared;		/* skipped, covered by another */
+	u64 rstat_flush_time;		/* in nsecs */
+
 	/*
 	 * list of pidlists, up to two for each namespace (one for procs, one
 	 * for tasks); created on demand.
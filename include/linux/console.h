@@ -154,6 +154,7 @@ struct console {
 	uint	ospeed;
 	u64	seq;
 	unsigned long dropped;
+	struct task_struct *thread;	/* printing thread, see printk() */
 	void	*data;
 	struct hlist_node node;
 };
@@ -88,6 +88,10 @@ struct damon_target {
  * @DAMOS_NOHUGEPAGE:	Call ``madvise()`` for the region with MADV_NOHUGEPAGE.
  * @DAMOS_LRU_PRIO:	Prioritize the region on its LRU lists.
  * @DAMOS_LRU_DEPRIO:	Deprioritize the region on its LRU lists.
+ * @DAMOS_MIGRATE_HOT:	Migrate the region to &damos->target_nid, for
+ *			promotion of hot memory.
+ * @DAMOS_MIGRATE_COLD:	Migrate the region to &damos->target_nid, for
+ *			demotion of cold memory.
  * @DAMOS_STAT:		Do nothing but count the stat.
  * @NR_DAMOS_ACTIONS:	Total number of DAMOS actions
  */
@@ -99,6 +103,8 @@ enum damos_action {
 	DAMOS_NOHUGEPAGE,
 	DAMOS_LRU_PRIO,
 	DAMOS_LRU_DEPRIO,
+	DAMOS_MIGRATE_HOT,
+	DAMOS_MIGRATE_COLD,
 	DAMOS_STAT,		/* Do nothing but only record the stat */
 	NR_DAMOS_ACTIONS,
 };
@@ -240,6 +246,7 @@ struct damos_access_pattern {
  * @quota:		Control the aggressiveness of this scheme.
  * @wmarks:		Watermarks for automated (in)activation of this scheme.
  * @stat:		Statistics of this scheme.
+ * @target_nid:		Destination node of the migrate actions.
  * @list:		List head for siblings.
  *
  * For each aggregation interval, DAMON finds regions which fit in the
@@ -256,7 +263,8 @@ struct damos_access_pattern {
  *
  * After applying the &action to each region, &stat_count and &stat_sz is
  * updated to reflect the number of regions and total size of regions that the
- * &action is applied.
+ * &action is applied.  For %DAMOS_MIGRATE_HOT and %DAMOS_MIGRATE_COLD,
+ * the size applied is that of the pages actually migrated to &target_nid.
  */
 struct damos {
 	struct damos_access_pattern pattern;
@@ -264,6 +272,7 @@ struct damos {
 	struct damos_quota quota;
 	struct damos_watermarks wmarks;
 	struct damos_stat stat;
+	int target_nid;
 	struct list_head list;
 };
 
@@ -274,12 +283,15 @@ struct damos {
  * @DAMON_OPS_FVADDR:	Monitoring operations for only fixed ranges of virtual
  *			address spaces
  * @DAMON_OPS_PADDR:	Monitoring operations for the physical address space
+ * @DAMON_OPS_PSAMPLE:	Monitoring operations for the physical address space
+ *			based on PMU data address samples
  * @NR_DAMON_OPS:	Number of monitoring operations implementations
  */
 enum damon_ops_id {
 	DAMON_OPS_VADDR,
 	DAMON_OPS_FVADDR,
 	DAMON_OPS_PADDR,
+	DAMON_OPS_PSAMPLE,
 	NR_DAMON_OPS,
 };
 
@@ -403,6 +415,8 @@ struct damon_callback {
  *				regions.
  * @max_nr_regions:		The maximum number of adaptive monitoring
  *				regions.
+ * @nr_workers:			The number of threads sharing the access
+ *				checks, or zero for kdamond alone.
  *
  * For each @sample_interval, DAMON checks whether each region is accessed or
  * not.  It aggregates and keeps the access information (number of accesses to
@@ -410,6 +424,14 @@ struct damon_callback {
  * memory regions need update (e.g., by ``mmap()`` calls from the application,
  * in case of virtual memory monitoring) and applies the changes for each
  * @ops_update_interval.  All time intervals are in micro-seconds.
+ *
+ * If @nr_workers is more than one, the operations sets that support it (only
+ * &DAMON_OPS_PADDR for now) split the regions of each target into that many
+ * contiguous runs, and prepare and check the accesses of each run on a thread
+ * of its own, kdamond taking the first one.  This is for the physical address
+ * space of large machines, where one thread can't get through all regions
+ * within @sample_interval.  Merging and splitting of the regions and
+ * application of the schemes are still done by kdamond alone.
  * Please refer to &struct damon_operations and &struct damon_callback for more
  * detail.
  */
@@ -419,6 +441,7 @@ struct damon_attrs {
 	unsigned long ops_update_interval;
 	unsigned long min_nr_regions;
 	unsigned long max_nr_regions;
+	unsigned long nr_workers;
 };
 
 /**
@@ -1561,6 +1561,12 @@ struct super_block {
 	 * inodes objects are currently double-accounted.
 	 */
 	atomic_long_t s_fsnotify_connectors;
+	/*
+	 * Union of the event masks of all the objects above, so that events
+	 * nobody on this sb is interested in can be dropped early.  It may
+	 * contain stale bits until the count above drops back to zero.
+	 */
+	atomic_t s_fsnotify_interest;
 
 	/* Being remounted read-only */
 	int s_readonly_remount;
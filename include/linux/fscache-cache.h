@@ -194,12 +194,16 @@ extern atomic_t fscache_n_culled;
 #define fscache_count_no_write_space() atomic_inc(&fscache_n_no_write_space)
 #define fscache_count_no_create_space() atomic_inc(&fscache_n_no_create_space)
 #define fscache_count_culled() atomic_inc(&fscache_n_culled)
+extern void fscache_count_io_done(struct fscache_cookie *cookie,
+				  enum fscache_latency op, ktime_t issued,
+				  ssize_t transferred_or_error);
 #else
 #define fscache_count_read() do {} while(0)
 #define fscache_count_write() do {} while(0)
 #define fscache_count_no_write_space() do {} while(0)
 #define fscache_count_no_create_space() do {} while(0)
 #define fscache_count_culled() do {} while(0)
+#define fscache_count_io_done(cookie, op, issued, ret) do {} while(0)
 #endif
 
 #endif /* _LINUX_FSCACHE_CACHE_H */
@@ -66,6 +66,27 @@ enum fscache_cookie_state {
 #define FSCACHE_COOKIE_STATE__NR (FSCACHE_COOKIE_STATE_DROPPED + 1)
 } __attribute__((mode(byte)));
 
+/*
+ * Per-volume statistics.  Latencies are kept as histograms with buckets of
+ * <16us, <64us, <256us, <1ms, <4ms, <16ms, <64ms and the rest.
+ */
+enum fscache_latency {
+	FSCACHE_LAT_LOOKUP,		/* Object lookup/creation in the cache */
+	FSCACHE_LAT_READ,		/* Read from the cache */
+	FSCACHE_LAT_WRITE,		/* Write to the cache */
+	FSCACHE_LAT__NR
+};
+
+#define FSCACHE_LAT_NR_BUCKETS	8
+
+struct fscache_volume_stats {
+	atomic64_t			read_bytes;	/* Data served from the cache */
+	atomic64_t			write_bytes;	/* Data stored in the cache */
+	atomic64_t			download_bytes;	/* Data the netfs had to fetch */
+	atomic_t			n_invalidates;	/* Number of cookie invalidations */
+	atomic_t			latency[FSCACHE_LAT__NR][FSCACHE_LAT_NR_BUCKETS];
+};
+
 /*
  * Volume representation cookie.
  */
@@ -88,6 +109,9 @@ struct fscache_volume {
 #define FSCACHE_VOLUME_COLLIDED_WITH	2	/* Volume was collided with */
 #define FSCACHE_VOLUME_ACQUIRE_PENDING	3	/* Volume is waiting to complete acquisition */
 #define FSCACHE_VOLUME_CREATING		4	/* Volume is being created on disk */
+#ifdef CONFIG_FSCACHE_STATS
+	struct fscache_volume_stats	stats;
+#endif
 	u8				coherency_len;	/* Length of the coherency data */
 	u8				coherency[];	/* Coherency data */
 };
@@ -692,4 +716,21 @@ void fscache_note_page_release(struct fscache_cookie *cookie)
 		clear_bit(FSCACHE_COOKIE_NO_DATA_TO_READ, &cookie->flags);
 }
 
+/**
+ * fscache_note_download - Note data that had to be fetched from the server
+ * @cookie: The cookie corresponding to the file
+ * @len: The amount of data fetched
+ *
+ * Account data that the netfs read from the server rather than the cache
+ * against the volume so that the volume's cache hit ratio can be reported.
+ */
+static inline
+void fscache_note_download(struct fscache_cookie *cookie, size_t len)
+{
+#ifdef CONFIG_FSCACHE_STATS
+	if (fscache_cookie_valid(cookie))
+		atomic64_add(len, &cookie->volume->stats.download_bytes);
+#endif
+}
+
 #endif /* _LINUX_FSCACHE_H */
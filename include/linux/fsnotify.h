@@ -17,6 +17,21 @@
 #include <linux/slab.h>
 #include <linux/bug.h>
 
+/*
+ * Is anything on @sb possibly interested in events in @mask?  This is a cheap
+ * check for the hot paths: it doesn't look at any marks, only at the union of
+ * the masks of all the objects watched on the sb.
+ */
+static inline bool fsnotify_sb_has_interest(struct super_block *sb,
+					    __u32 mask)
+{
+	if (atomic_long_read(&sb->s_fsnotify_connectors) == 0)
+		return false;
+
+	return atomic_read(&sb->s_fsnotify_interest) &
+		mask & ALL_FSNOTIFY_EVENTS;
+}
+
 /*
  * Notify this @dir inode about a change in a child directory entry.
  * The directory entry may have turned positive or negative or its inode may
@@ -30,7 +45,7 @@ static inline int fsnotify_name(__u32 mask, const void *data, int data_type,
 				struct inode *dir, const struct qstr *name,
 				u32 cookie)
 {
-	if (atomic_long_read(&dir->i_sb->s_fsnotify_connectors) == 0)
+	if (!fsnotify_sb_has_interest(dir->i_sb, mask))
 		return 0;
 
 	return fsnotify(mask, data, data_type, dir, name, NULL, cookie);
@@ -44,7 +59,7 @@ static inline void fsnotify_dirent(struct inode *dir, struct dentry *dentry,
 
 static inline void fsnotify_inode(struct inode *inode, __u32 mask)
 {
-	if (atomic_long_read(&inode->i_sb->s_fsnotify_connectors) == 0)
+	if (!fsnotify_sb_has_interest(inode->i_sb, mask))
 		return;
 
 	if (S_ISDIR(inode->i_mode))
@@ -59,7 +74,7 @@ static inline int fsnotify_parent(struct dentry *dentry, __u32 mask,
 {
 	struct inode *inode = d_inode(dentry);
 
-	if (atomic_long_read(&inode->i_sb->s_fsnotify_connectors) == 0)
+	if (!fsnotify_sb_has_interest(inode->i_sb, mask))
 		return 0;
 
 	if (S_ISDIR(inode->i_mode)) {
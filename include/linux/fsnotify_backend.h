@@ -201,6 +201,7 @@ struct fsnotify_group {
 	wait_queue_head_t notification_waitq;	/* read() on the notification file blocks on this waitq */
 	unsigned int q_len;			/* events on the queue */
 	unsigned int max_events;		/* maximum events allowed on the list */
+	unsigned long q_dropped;		/* events lost to queue overflow */
 	/*
 	 * Valid fsnotify group priorities.  Events are send in order from highest
 	 * priority to lowest priority.  We default to the lowest priority.
@@ -245,6 +246,7 @@ struct fsnotify_group {
 		struct fanotify_group_private_data {
 			/* Hash table of events for merge */
 			struct hlist_head *merge_hash;
+			unsigned int merge_hash_bits;
 			/* allows a group to block waiting for a userspace response */
 			struct list_head access_list;
 			wait_queue_head_t access_waitq;
@@ -653,6 +655,9 @@ extern struct fsnotify_event *fsnotify_remove_first_event(struct fsnotify_group
 /* Remove event queued in the notification list */
 extern void fsnotify_remove_queued_event(struct fsnotify_group *group,
 					 struct fsnotify_event *event);
+/* Put a dequeued event back at the head of the notification list */
+extern void fsnotify_requeue_event(struct fsnotify_group *group,
+				   struct fsnotify_event *event);
 
 /* functions used to manipulate the marks attached to inodes */
 
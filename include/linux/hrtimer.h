@@ -195,6 +195,8 @@ enum  hrtimer_base_type {
  * @nr_retries:		Total number of hrtimer interrupt retries
  * @nr_hangs:		Total number of hrtimer interrupt hangs
  * @max_hang_time:	Maximum time spent in hrtimer_interrupt
+ * @nr_expired:		Total number of timers expired by hrtimer_interrupt
+ * @max_expired:	Maximum number of timers expired by one interrupt
  * @softirq_expiry_lock: Lock which is taken while softirq based hrtimer are
  *			 expired
  * @timer_waiters:	A hrtimer_cancel() invocation waits for the timer
@@ -225,6 +227,8 @@ struct hrtimer_cpu_base {
 	unsigned short			nr_retries;
 	unsigned short			nr_hangs;
 	unsigned int			max_hang_time;
+	unsigned int			nr_expired;
+	unsigned int			max_expired;
 #endif
 #ifdef CONFIG_PREEMPT_RT
 	spinlock_t			softirq_expiry_lock;
@@ -173,6 +173,8 @@ struct io_submit_state {
 
 	bool			plug_started;
 	bool			need_plug;
+	/* aux CQEs were committed without a wakeup, see io_aux_cqe() */
+	bool			cqes_posted;
 	unsigned short		submit_nr;
 	unsigned int		cqes_count;
 	struct blk_plug		plug;
@@ -190,6 +192,9 @@ struct io_ev_fd {
 struct io_alloc_cache {
 	struct hlist_head	list;
 	unsigned int		nr_cached;
+	unsigned int		max_cached;
+	unsigned long		hits;
+	unsigned long		misses;
 };
 
 struct io_ring_ctx {
@@ -254,6 +259,8 @@ struct io_ring_ctx {
 		struct list_head	cq_overflow_list;
 		struct io_alloc_cache	apoll_cache;
 		struct io_alloc_cache	netmsg_cache;
+		/* generic ->async_data caches, indexed by opcode */
+		struct io_alloc_cache	async_data_cache[IORING_OP_LAST];
 	} ____cacheline_aligned_in_smp;
 
 	/* IRQ completion list, under ->completion_lock */
@@ -266,6 +273,13 @@ struct io_ring_ctx {
 	struct wait_queue_head	sqo_sq_wait;
 	struct list_head	sqd_list;
 
+	/* SQPOLL per-ring scheduling state and stats, owned by the sq thread */
+	unsigned int		sq_idle_polls;
+	unsigned int		sq_skip_polls;
+	unsigned int		sq_cap;
+	u64			sq_busy_time;
+	u64			sq_idle_time;
+
 	unsigned long		check_cq;
 
 	unsigned int		file_alloc_start;
@@ -14,6 +14,7 @@
 #include <linux/err.h>
 #include <linux/of.h>
 #include <linux/ioasid.h>
+#include <linux/iova_bitmap.h>
 #include <uapi/linux/iommu.h>
 
 #define IOMMU_READ	(1 << 0)
@@ -95,6 +96,7 @@ struct iommu_domain_geometry {
 struct iommu_domain {
 	unsigned type;
 	const struct iommu_domain_ops *ops;
+	const struct iommu_dirty_ops *dirty_ops;
 	unsigned long pgsize_bitmap;	/* Bitmap of page sizes in use */
 	struct iommu_domain_geometry geometry;
 	struct iommu_dma_cookie *iova_cookie;
@@ -220,6 +222,43 @@ struct iommu_iotlb_gather {
 	bool			queued;
 };
 
+/**
+ * struct iommu_dirty_bitmap - Dirty IOVA bitmap state
+ * @bitmap: IOVA bitmap to record dirty IOVAs in, or NULL to only clear
+ * @record: Records a range in @bitmap, iova_bitmap_set() as set up by
+ *          iommu_dirty_bitmap_init()
+ * @gather: Range of IOTLB entries to flush for the dirty bits cleared
+ */
+struct iommu_dirty_bitmap {
+	struct iova_bitmap *bitmap;
+	void (*record)(struct iova_bitmap *bitmap, unsigned long iova,
+		       size_t length);
+	struct iommu_iotlb_gather *gather;
+};
+
+/* Read the dirty bits without clearing them */
+#define IOMMU_DIRTY_NO_CLEAR	(1 << 0)
+
+/**
+ * struct iommu_dirty_ops - domain specific dirty tracking operations
+ * @set_dirty_tracking: Enable or disable the hardware updating dirty bits in
+ *                      the page tables of the domain, for all the devices
+ *                      attached to it and any attached later
+ * @read_and_clear_dirty: Walk the page tables of the domain over the range
+ *                        and record the IOVAs with the dirty bit set in
+ *                        @dirty, clearing the bit unless
+ *                        %IOMMU_DIRTY_NO_CLEAR is set in @flags.  The IOTLB
+ *                        entries of the bits cleared are added to
+ *                        @dirty->gather, for the caller to sync.
+ */
+struct iommu_dirty_ops {
+	int (*set_dirty_tracking)(struct iommu_domain *domain, bool enabled);
+	int (*read_and_clear_dirty)(struct iommu_domain *domain,
+				    unsigned long iova, size_t size,
+				    unsigned long flags,
+				    struct iommu_dirty_bitmap *dirty);
+};
+
 /**
  * struct iommu_ops - iommu ops and capabilities
  * @capable: check capability
@@ -627,6 +666,37 @@ static inline bool iommu_iotlb_gather_queued(struct iommu_iotlb_gather *gather)
 	return gather && gather->queued;
 }
 
+static inline void iommu_dirty_bitmap_init(struct iommu_dirty_bitmap *dirty,
+					   struct iova_bitmap *bitmap,
+					   struct iommu_iotlb_gather *gather)
+{
+	if (gather)
+		iommu_iotlb_gather_init(gather);
+
+	dirty->bitmap = bitmap;
+	dirty->record = bitmap ? iova_bitmap_set : NULL;
+	dirty->gather = gather;
+}
+
+/**
+ * iommu_dirty_bitmap_record - Record a dirty IOVA range
+ * @dirty: Dirty bitmap state passed to ->read_and_clear_dirty()
+ * @iova: Start of the range, e.g. of a page with its dirty bit set
+ * @length: Length of the range
+ *
+ * Helper for IOMMU drivers to report a dirty range and gather its IOTLB
+ * entries for invalidation.  The range may extend past the one being read.
+ */
+static inline void iommu_dirty_bitmap_record(struct iommu_dirty_bitmap *dirty,
+					     unsigned long iova,
+					     unsigned long length)
+{
+	if (dirty->bitmap)
+		dirty->record(dirty->bitmap, iova, length);
+	if (dirty->gather)
+		iommu_iotlb_gather_add_range(dirty->gather, iova, length);
+}
+
 /* PCI device grouping function */
 extern struct iommu_group *pci_device_group(struct device *dev);
 /* Generic device grouping function */
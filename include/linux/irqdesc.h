@@ -37,6 +37,8 @@ struct pt_regs;
  * @affinity_hint:	hint to user space for preferred irq affinity
  * @affinity_notify:	context for notification of affinity changes
  * @pending_mask:	pending rebalanced interrupts
+ * @balance_count:	@tot_count at the last in-kernel balancing pass
+ * @balance_delta:	interrupts between the last two balancing passes
  * @threads_oneshot:	bitfield to handle shared oneshot threads
  * @threads_active:	number of irqaction threads currently running
  * @wait_for_threads:	wait queue for sync_irq to wait for threaded handlers
@@ -77,6 +79,10 @@ struct irq_desc {
 #ifdef CONFIG_GENERIC_PENDING_IRQ
 	cpumask_var_t		pending_mask;
 #endif
+#ifdef CONFIG_GENERIC_IRQ_BALANCE
+	unsigned int		balance_count;
+	unsigned int		balance_delta;
+#endif
 #endif
 	unsigned long		threads_oneshot;
 	atomic_t		threads_active;
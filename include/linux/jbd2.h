@@ -747,6 +747,17 @@ struct transaction_stats_s {
 	struct transaction_run_stats_s run;
 };
 
+/* Per-cpu counts of how jbd2_journal_get_write_access() calls were handled */
+struct jbd2_access_stats {
+	unsigned long		as_fast;	/* Granted without any locks */
+	unsigned long		as_slow;	/* Went through the locks */
+	unsigned long		as_contended;	/* Found the buffer locked */
+	unsigned long		as_waited;	/* Granted after waiting for it */
+};
+
+#define jbd2_access_stat_inc(journal, field) \
+	this_cpu_inc((journal)->j_access_stats->field)
+
 static inline unsigned long
 jbd2_time_diff(unsigned long start, unsigned long end)
 {
@@ -905,6 +916,14 @@ struct journal_s
 	 */
 	struct buffer_head	*j_chkpt_bhs[JBD2_NR_BATCH];
 
+	/**
+	 * @j_checkpoint_work:
+	 *
+	 * Background checkpointing, started after a commit when the free log
+	 * space runs low so that handles don't have to stall waiting for it.
+	 */
+	struct work_struct	j_checkpoint_work;
+
 	/**
 	 * @j_shrinker:
 	 *
@@ -1234,6 +1253,11 @@ struct journal_s
 	 */
 	spinlock_t		j_history_lock;
 
+	/**
+	 * @j_access_stats: Per-cpu write access fast/slow path counts.
+	 */
+	struct jbd2_access_stats __percpu *j_access_stats;
+
 	/**
 	 * @j_proc_entry: procfs entry for the jbd statistics directory.
 	 */
@@ -1651,6 +1675,8 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
 int jbd2_transaction_committed(journal_t *journal, tid_t tid);
 int jbd2_complete_transaction(journal_t *journal, tid_t tid);
 int jbd2_log_do_checkpoint(journal_t *journal);
+void jbd2_log_kick_checkpoint(journal_t *journal);
+void jbd2_checkpoint_work(struct work_struct *work);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
 
 void __jbd2_log_wait_for_space(journal_t *journal);
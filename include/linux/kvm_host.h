@@ -381,6 +381,9 @@ struct kvm_vcpu {
 	struct kvm_vcpu_stat stat;
 	char stats_id[KVM_STATS_NAME_SIZE];
 	struct kvm_dirty_ring dirty_ring;
+#ifdef CONFIG_KVM_MMIO
+	struct kvm_coalesced_mmio_vcpu_ring *coalesced_mmio_ring;
+#endif
 
 	/*
 	 * The most recently used memslot by this vCPU and the slots generation
@@ -736,7 +739,7 @@ struct kvm {
 
 	/* For management / invalidation of gfn_to_pfn_caches */
 	spinlock_t gpc_lock;
-	struct list_head gpc_list;
+	struct rb_root_cached gpc_tree;
 
 	/*
 	 * created_vcpus is protected by kvm->lock, and is incremented
@@ -767,6 +770,8 @@ struct kvm {
 	struct kvm_coalesced_mmio_ring *coalesced_mmio_ring;
 	spinlock_t ring_lock;
 	struct list_head coalesced_zones;
+	bool coalesced_mmio_vcpu_ring;
+	atomic64_t coalesced_mmio_seq;
 #endif
 
 	struct mutex irq_lock;
@@ -1292,7 +1297,7 @@ void kvm_gpc_init(struct gfn_to_pfn_cache *gpc, struct kvm *kvm,
  *		   -EINVAL for a mapping which would cross a page boundary.
  *		   -EFAULT for an untranslatable guest physical address.
  *
- * This primes a gfn_to_pfn_cache and links it into the @gpc->kvm's list for
+ * This primes a gfn_to_pfn_cache and links it into the @gpc->kvm's gpc_tree for
  * invalidations to be processed.  Callers are required to use kvm_gpc_check()
  * to ensure that the cache is valid before accessing the target page.
  */
@@ -1375,6 +1380,10 @@ long kvm_arch_dev_ioctl(struct file *filp,
 			unsigned int ioctl, unsigned long arg);
 long kvm_arch_vcpu_ioctl(struct file *filp,
 			 unsigned int ioctl, unsigned long arg);
+#ifdef CONFIG_HAVE_KVM_PRE_FAULT_MEMORY
+long kvm_arch_vcpu_pre_fault_memory(struct kvm_vcpu *vcpu,
+				    struct kvm_pre_fault_memory *range);
+#endif
 vm_fault_t kvm_arch_vcpu_fault(struct kvm_vcpu *vcpu, struct vm_fault *vmf);
 
 int kvm_vm_ioctl_check_extension(struct kvm *kvm, long ext);
@@ -1863,7 +1872,10 @@ struct _kvm_stats_desc {
 			HALT_POLL_HIST_COUNT),				       \
 	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_wait_hist,	       \
 			HALT_POLL_HIST_COUNT),				       \
-	STATS_DESC_IBOOLEAN(VCPU_GENERIC, blocking)
+	STATS_DESC_IBOOLEAN(VCPU_GENERIC, blocking),			       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, dirty_ring_full_exits),	       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, dirty_ring_harvested),		       \
+	STATS_DESC_PCOUNTER(VCPU_GENERIC, dirty_ring_max_used)
 
 extern struct dentry *kvm_debugfs_dir;
 
@@ -19,6 +19,7 @@ struct kvm_memslots;
 enum kvm_mr_change;
 
 #include <linux/bits.h>
+#include <linux/interval_tree.h>
 #include <linux/mutex.h>
 #include <linux/types.h>
 #include <linux/spinlock_types.h>
@@ -69,7 +70,7 @@ struct gfn_to_pfn_cache {
 	struct kvm_memory_slot *memslot;
 	struct kvm *kvm;
 	struct kvm_vcpu *vcpu;
-	struct list_head list;
+	struct interval_tree_node node;
 	rwlock_t lock;
 	struct mutex refresh_lock;
 	void *khva;
@@ -119,6 +120,9 @@ struct kvm_vcpu_stat_generic {
 	u64 halt_poll_fail_hist[HALT_POLL_HIST_COUNT];
 	u64 halt_wait_hist[HALT_POLL_HIST_COUNT];
 	u64 blocking;
+	u64 dirty_ring_full_exits;
+	u64 dirty_ring_harvested;
+	u64 dirty_ring_max_used;
 };
 
 #define KVM_STATS_NAME_SIZE	48
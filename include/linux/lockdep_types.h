@@ -76,6 +76,9 @@ struct lock_class_key {
 		struct hlist_node		hash_entry;
 		struct lockdep_subclass_key	subkeys[MAX_LOCKDEP_SUBCLASSES];
 	};
+#ifdef CONFIG_LOCK_CLASS_STATS
+	unsigned int			class_stats_id;
+#endif
 };
 
 extern struct lock_class_key __lockdep_no_validate__;
@@ -194,7 +197,11 @@ struct pin_cookie { unsigned int val; };
 /*
  * The class key takes no space if lockdep is disabled:
  */
-struct lock_class_key { };
+struct lock_class_key {
+#ifdef CONFIG_LOCK_CLASS_STATS
+	unsigned int			class_stats_id;
+#endif
+};
 
 /*
  * The lockdep_map takes no space if lockdep is disabled:
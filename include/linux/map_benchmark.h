@@ -15,6 +15,14 @@
 #define DMA_MAP_TO_DEVICE       1
 #define DMA_MAP_FROM_DEVICE     2
 
+#define DMA_MAP_BENCH_SINGLE    0 /* dma_map_single() */
+#define DMA_MAP_BENCH_SG        1 /* dma_map_sg() with nents segments */
+#define DMA_MAP_BENCH_COHERENT  2 /* dma_alloc_coherent() */
+
+#define DMA_MAP_MAX_NENTS       128
+/* latency histogram has one 100ns bucket each, the last one is the overflow */
+#define DMA_MAP_HIST_BUCKETS    1024
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -27,5 +35,13 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;  /* how many PAGE_SIZE will do map/unmap once a time */
+	__u32 mode; /* DMA_MAP_BENCH_* */
+	__u32 nents; /* number of granule sized segments for DMA_MAP_BENCH_SG */
+	__u64 map_p50_100ns; /* map latency percentiles in 100ns */
+	__u64 map_p99_100ns;
+	__u64 map_p999_100ns;
+	__u64 unmap_p50_100ns; /* as above */
+	__u64 unmap_p99_100ns;
+	__u64 unmap_p999_100ns;
 };
 #endif /* _KERNEL_DMA_BENCHMARK_H */
@@ -411,6 +411,11 @@ struct module {
 
 	bool async_probe_requested;
 
+	/* How long each step of loading took, in microseconds. */
+	struct {
+		u32 read, decompress, sig, layout, init;
+	} load_us;
+
 	/* Exception table */
 	unsigned int num_exentries;
 	struct exception_table_entry *extable;
@@ -70,6 +70,9 @@ struct mutex {
 #ifdef CONFIG_DEBUG_MUTEXES
 	void			*magic;
 #endif
+#ifdef CONFIG_LOCK_CLASS_STATS
+	unsigned int		class_stats_id;
+#endif
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	struct lockdep_map	dep_map;
 #endif
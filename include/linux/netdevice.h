@@ -1990,6 +1990,9 @@ enum netdev_ml_priv_type {
  *				offload capabilities of the device
  *	@udp_tunnel_nic:	UDP tunnel offload state
  *	@xdp_state:		stores info on attached XDP BPF programs
+ *	@xdp_zc_max_segs:	Maximum number of buffers per packet the driver
+ *				accepts in AF_XDP zero-copy mode, 0 or 1 if
+ *				it does not support multi-buffer packets
  *
  *	@nested_level:	Used as a parameter of spin_lock_nested() of
  *			dev->addr_list_lock.
@@ -2354,6 +2357,7 @@ struct net_device {
 
 	/* protected by rtnl_lock */
 	struct bpf_xdp_entity	xdp_state[__MAX_XDP_MODE];
+	u32			xdp_zc_max_segs;
 
 	u8 dev_addr_shadow[MAX_ADDR_LEN];
 	netdevice_tracker	linkwatch_dev_tracker;
@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_NUMA_RWSEM_H
+#define _LINUX_NUMA_RWSEM_H
+
+#include <linux/atomic.h>
+#include <linux/cache.h>
+#include <linux/rwsem.h>
+#include <linux/rcuwait.h>
+#include <linux/topology.h>
+#include <linux/lockdep.h>
+
+/*
+ * A reader-biased rwsem for read-mostly locks.
+ *
+ * Readers only touch a counter of their own NUMA node, so that cacheline
+ * is shared by the CPUs of one node instead of the whole machine.  Unlike
+ * a percpu_rw_semaphore, writers don't wait for an RCU grace period: they
+ * block new readers and wait for the counters to drain, which costs a walk
+ * over the nodes plus the longest reader critical section in flight.
+ *
+ * Readers that find a writer active park on the inner rwsem until it is
+ * done, so writers are not starved.
+ */
+struct numa_rwsem_node {
+	atomic_long_t		read_count;
+} ____cacheline_aligned_in_smp;
+
+struct numa_rw_semaphore {
+	struct numa_rwsem_node	**nodes;
+	struct rcuwait		writer;
+	atomic_t		block;
+	struct rw_semaphore	rw_sem;
+#ifdef CONFIG_DEBUG_LOCK_ALLOC
+	struct lockdep_map	dep_map;
+#endif
+};
+
+/*
+ * Readers may increment the counter of one node and decrement the counter
+ * of another after migrating; only the sum over the nodes means anything.
+ */
+static inline atomic_long_t *__numa_rwsem_count(struct numa_rw_semaphore *sem)
+{
+	return &sem->nodes[numa_node_id()]->read_count;
+}
+
+static inline bool __numa_down_read_trylock(struct numa_rw_semaphore *sem)
+{
+	atomic_long_t *count = __numa_rwsem_count(sem);
+
+	atomic_long_inc(count);
+	/*
+	 * If the reader misses the writer's assignment of sem->block, then
+	 * the writer is guaranteed to see the reader's increment.
+	 */
+	smp_mb__after_atomic(); /* A matches D */
+
+	/*
+	 * If !sem->block the critical section starts here, matched by the
+	 * release in numa_up_write().
+	 */
+	if (likely(!atomic_read_acquire(&sem->block)))
+		return true;
+
+	/* Preemption is off, so this is the counter we incremented. */
+	atomic_long_dec(count);
+	return false;
+}
+
+extern bool __numa_down_read(struct numa_rw_semaphore *sem, bool try);
+
+static inline void numa_down_read(struct numa_rw_semaphore *sem)
+{
+	bool ret;
+
+	might_sleep();
+
+	rwsem_acquire_read(&sem->dep_map, 0, 0, _RET_IP_);
+
+	preempt_disable();
+	ret = __numa_down_read_trylock(sem);
+	preempt_enable();
+
+	if (unlikely(!ret))
+		__numa_down_read(sem, false);
+}
+
+static inline bool numa_down_read_trylock(struct numa_rw_semaphore *sem)
+{
+	bool ret;
+
+	preempt_disable();
+	ret = __numa_down_read_trylock(sem);
+	preempt_enable();
+
+	if (unlikely(!ret))
+		ret = __numa_down_read(sem, true);
+
+	if (ret)
+		rwsem_acquire_read(&sem->dep_map, 0, 1, _RET_IP_);
+
+	return ret;
+}
+
+static inline void numa_up_read(struct numa_rw_semaphore *sem)
+{
+	rwsem_release(&sem->dep_map, _RET_IP_);
+
+	/*
+	 * If the writer sees our decrement, it also sees our critical
+	 * section.
+	 */
+	smp_mb__before_atomic(); /* B matches C */
+	atomic_long_dec(__numa_rwsem_count(sem));
+	smp_mb__after_atomic();
+
+	/* A writer may be waiting for the readers to drain. */
+	if (unlikely(atomic_read(&sem->block)))
+		rcuwait_wake_up(&sem->writer);
+}
+
+extern void numa_down_write(struct numa_rw_semaphore *);
+extern void numa_up_write(struct numa_rw_semaphore *);
+
+static inline bool numa_is_write_locked(struct numa_rw_semaphore *sem)
+{
+	return atomic_read(&sem->block);
+}
+
+extern int __numa_init_rwsem(struct numa_rw_semaphore *,
+			     const char *, struct lock_class_key *);
+
+extern void numa_free_rwsem(struct numa_rw_semaphore *);
+
+#define numa_init_rwsem(sem)					\
+({								\
+	static struct lock_class_key rwsem_key;			\
+	__numa_init_rwsem(sem, #sem, &rwsem_key);		\
+})
+
+#define numa_rwsem_is_held(sem)		lockdep_is_held(sem)
+#define numa_rwsem_assert_held(sem)	lockdep_assert_held(sem)
+
+#endif
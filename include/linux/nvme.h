@@ -1074,6 +1074,11 @@ enum {
 	NVME_TEMP_THRESH_TYPE_UNDER	= 0x100000,
 };
 
+enum {
+	NVME_IRQ_COALESCE_TIME_SHIFT	= 8,
+	NVME_IRQ_CONFIG_CD		= 1 << 16,
+};
+
 struct nvme_feat_auto_pst {
 	__le64 entries[32];
 };
@@ -1129,6 +1129,8 @@ struct perf_sample_data {
 		u32	reserved;
 	}				cpu_entry;
 	struct perf_callchain_entry	*callchain;
+	u64				callchain_id;
+	bool				callchain_id_sent;
 	u64				aux_size;
 
 	struct perf_regs		regs_user;
@@ -19,6 +19,7 @@
 #include <linux/sunrpc/svcauth.h>
 #include <linux/wait.h>
 #include <linux/mm.h>
+#include <linux/llist.h>
 #include <linux/pagevec.h>
 
 /* statistics for svc_pool structures */
@@ -45,6 +46,7 @@ struct svc_pool {
 	struct list_head	sp_sockets;	/* pending sockets */
 	unsigned int		sp_nrthreads;	/* # of threads in pool */
 	struct list_head	sp_all_threads;	/* all server threads */
+	struct llist_head	sp_idle_threads; /* idle server threads */
 	struct svc_pool_stats	sp_stats;	/* statistics on pool operation */
 #define	SP_TASK_PENDING		(0)		/* still work to do even if no
 						 * xprt is queued. */
@@ -233,6 +235,7 @@ static inline void svc_putu32(struct kvec *iov, __be32 val)
  */
 struct svc_rqst {
 	struct list_head	rq_all;		/* all threads list */
+	struct llist_node	rq_idle;	/* on the idle list */
 	struct rcu_head		rq_rcu_head;	/* for RCU deferred kfree */
 	struct svc_xprt *	rq_xprt;	/* transport ptr */
 
@@ -312,6 +315,20 @@ struct svc_rqst {
 
 #define SVC_NET(rqst) (rqst->rq_xprt ? rqst->rq_xprt->xpt_net : rqst->rq_bc_net)
 
+/*
+ * A thread is on sp_idle_threads until a waker takes it off, after which
+ * rq_idle points to itself.
+ */
+static inline void svc_thread_set_busy(struct svc_rqst *rqstp)
+{
+	WRITE_ONCE(rqstp->rq_idle.next, &rqstp->rq_idle);
+}
+
+static inline bool svc_thread_busy(const struct svc_rqst *rqstp)
+{
+	return READ_ONCE(rqstp->rq_idle.next) == &rqstp->rq_idle;
+}
+
 /*
  * Rigorous type checking on sockaddr type conversions
  */
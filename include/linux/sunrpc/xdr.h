@@ -338,6 +338,9 @@ xdr_stream_remaining(const struct xdr_stream *xdr)
 	return xdr->nwords << 2;
 }
 
+int xdr_stream_read_bytes(struct xdr_stream *xdr, void *ptr, size_t len);
+int xdr_stream_decode_u32s(struct xdr_stream *xdr, u32 *array,
+		size_t nstore, size_t count);
 ssize_t xdr_stream_decode_opaque(struct xdr_stream *xdr, void *ptr,
 		size_t size);
 ssize_t xdr_stream_decode_opaque_dup(struct xdr_stream *xdr, void **ptr,
@@ -744,28 +747,23 @@ static inline ssize_t
 xdr_stream_decode_uint32_array(struct xdr_stream *xdr,
 		__u32 *array, size_t array_size)
 {
-	__be32 *p;
 	__u32 len;
 	ssize_t retval;
 
 	if (unlikely(xdr_stream_decode_u32(xdr, &len) < 0))
 		return -EBADMSG;
-	if (len > SIZE_MAX / sizeof(*p))
-		return -EBADMSG;
-	p = xdr_inline_decode(xdr, len * sizeof(*p));
-	if (unlikely(!p))
-		return -EBADMSG;
-	if (array == NULL)
-		return len;
-	if (len <= array_size) {
+	if (array == NULL) {
+		array_size = 0;
+		retval = len;
+	} else if (len <= array_size) {
 		if (len < array_size)
 			memset(array+len, 0, (array_size-len)*sizeof(*array));
 		array_size = len;
 		retval = len;
 	} else
 		retval = -EMSGSIZE;
-	for (; array_size > 0; p++, array++, array_size--)
-		*array = be32_to_cpup(p);
+	if (unlikely(xdr_stream_decode_u32s(xdr, array, array_size, len) < 0))
+		return -EBADMSG;
 	return retval;
 }
 
@@ -87,6 +87,15 @@ dma_addr_t swiotlb_map(struct device *dev, phys_addr_t phys,
  * @for_alloc:  %true if the pool is used for memory allocation
  * @nareas:  The area number in the pool.
  * @area_nslabs: The slot number in the area.
+ * @total_used:	The total number of slots in the pool that are currently used
+ *		across all areas. Used only for calculating used_hiwater in
+ *		debugfs.
+ * @used_hiwater: The high water mark for total_used.  Used only for reporting
+ *		in debugfs.
+ * @contended:	The number of times an area was skipped because its lock was
+ *		contended.  Used only for reporting in debugfs.
+ * @full:	The number of mapping requests that found no free slots.  Used
+ *		only for reporting in debugfs.
  */
 struct io_tlb_mem {
 	phys_addr_t start;
@@ -102,6 +111,12 @@ struct io_tlb_mem {
 	unsigned int area_nslabs;
 	struct io_tlb_area *areas;
 	struct io_tlb_slot *slots;
+#ifdef CONFIG_DEBUG_FS
+	atomic_long_t total_used;
+	atomic_long_t used_hiwater;
+	atomic_long_t contended;
+	atomic_long_t full;
+#endif
 };
 extern struct io_tlb_mem io_tlb_default_mem;
 
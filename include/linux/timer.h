@@ -172,6 +172,8 @@ extern void add_timer_on(struct timer_list *timer, int cpu);
 extern int mod_timer(struct timer_list *timer, unsigned long expires);
 extern int mod_timer_pending(struct timer_list *timer, unsigned long expires);
 extern int timer_reduce(struct timer_list *timer, unsigned long expires);
+extern unsigned int mod_timer_batch(struct timer_list **timers,
+				    const unsigned long *expires, unsigned int nr);
 
 /*
  * The jiffies value which is added to now, when there is no timer
@@ -180,6 +180,42 @@ zstd_cctx *zstd_init_cctx(void *workspace, size_t workspace_size);
 size_t zstd_compress_cctx(zstd_cctx *cctx, void *dst, size_t dst_capacity,
 	const void *src, size_t src_size, const zstd_parameters *parameters);
 
+/* ======   Parallel Compression   ====== */
+
+/**
+ * zstd_compress_parallel() - compress src into dst on several CPUs
+ * @dst:          The buffer to compress src into.
+ * @dst_capacity: The size of the destination buffer. May be any size, but
+ *                zstd_compress_parallel_bound() is guaranteed to be large
+ *                enough.
+ * @src:          The data to compress.
+ * @src_size:     The size of the data to compress.
+ * @parameters:   The compression parameters to be used for each frame.
+ * @chunk_size:   The amount of src compressed into each frame.
+ * @nr_workers:   The maximum number of chunks compressed at the same time.
+ *
+ * src is cut into chunks of chunk_size bytes, the last one possibly
+ * shorter, that are compressed as independent frames by up to nr_workers
+ * work items on an unbound workqueue. The frames are concatenated in order
+ * into dst, which any zstd decompressor reads back as src. Each worker
+ * allocates its own context workspace, so this may sleep.
+ *
+ * Return:        The compressed size or an error, which can be checked using
+ *                zstd_is_error().
+ */
+size_t zstd_compress_parallel(void *dst, size_t dst_capacity,
+	const void *src, size_t src_size, const zstd_parameters *parameters,
+	size_t chunk_size, unsigned int nr_workers);
+
+/**
+ * zstd_compress_parallel_bound() - maximum size zstd_compress_parallel() needs
+ * @src_size:   The size of the data to compress.
+ * @chunk_size: The chunk size that will be passed to zstd_compress_parallel().
+ *
+ * Return:      The maximum compressed size in the worst case scenario.
+ */
+size_t zstd_compress_parallel_bound(size_t src_size, size_t chunk_size);
+
 /* ======   Single-pass Decompression   ====== */
 
 typedef ZSTD_DCtx zstd_dctx;
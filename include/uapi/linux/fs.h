@@ -305,4 +305,67 @@ typedef int __bitwise __kernel_rwf_t;
 #define RWF_SUPPORTED	(RWF_HIPRI | RWF_DSYNC | RWF_SYNC | RWF_NOWAIT |\
 			 RWF_APPEND)
 
+/* Pagemap ioctl */
+#define PAGEMAP_SCAN	_IOWR('f', 16, struct pm_scan_arg)
+
+/* Bitmasks provided in pm_scan_arg masks and reported in page_region */
+#define PAGE_IS_PRESENT		(1 << 0)
+#define PAGE_IS_SWAPPED		(1 << 1)
+#define PAGE_IS_FILE		(1 << 2)
+#define PAGE_IS_SOFT_DIRTY	(1 << 3)
+#define PAGE_IS_EXCLUSIVE	(1 << 4)
+#define PAGE_IS_HUGE		(1 << 5)
+#define PAGE_IS_UFFD_WP		(1 << 6)
+
+/*
+ * struct page_region - Page region with flags
+ * @start:	Start of the region
+ * @end:	End of the region (exclusive)
+ * @categories:	PAGE_IS_* category bitmask for the region
+ */
+struct page_region {
+	__u64 start;
+	__u64 end;
+	__u64 categories;
+};
+
+/* Flags for PAGEMAP_SCAN ioctl */
+#define PM_SCAN_CLEAR_SOFT_DIRTY	(1 << 0)	/* Clear soft-dirty on the pages reported */
+
+/*
+ * struct pm_scan_arg - Pagemap ioctl argument
+ * @size:		Size of the structure
+ * @flags:		Flags for the IOCTL
+ * @start:		Starting address of the scan
+ * @end:		Ending address of the scan
+ * @walk_end:		Set by the kernel to where the scan stopped; resume
+ *			from here if it is short of @end
+ * @vec:		Address of page_region struct array for output
+ * @vec_len:		Length of the page_region struct array
+ * @max_pages:		Optional limit for the number of pages reported
+ * @category_inverted:	PAGE_IS_* categories whose meaning is inverted
+ * @category_mask:	Pages must have all of these categories
+ * @category_anyof_mask: Pages must have at least one of these, if non-zero
+ * @return_mask:	PAGE_IS_* categories reported in the regions
+ *
+ * A page is reported once its categories, after inverting those in
+ * @category_inverted, pass both masks.  Adjacent reported pages with the same
+ * categories in @return_mask are coalesced into one region.  The ioctl
+ * returns the number of regions written to @vec.
+ */
+struct pm_scan_arg {
+	__u64 size;
+	__u64 flags;
+	__u64 start;
+	__u64 end;
+	__u64 walk_end;
+	__u64 vec;
+	__u64 vec_len;
+	__u64 max_pages;
+	__u64 category_inverted;
+	__u64 category_mask;
+	__u64 category_anyof_mask;
+	__u64 return_mask;
+};
+
 #endif /* _UAPI_LINUX_FS_H */
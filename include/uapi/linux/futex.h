@@ -50,14 +50,16 @@
 #define FUTEX_32		2
 
 /*
- * Max numbers of elements in a futex_waitv array
+ * Max numbers of elements in a futex_waitv array, for futex_waitv() and
+ * futex_wakev()
  */
 #define FUTEX_WAITV_MAX		128
 
 /**
- * struct futex_waitv - A waiter for vectorized wait
- * @val:	Expected value at uaddr
- * @uaddr:	User address to wait on
+ * struct futex_waitv - A waiter for vectorized wait, or a vectorized wake
+ * @val:	Expected value at uaddr, or for futex_wakev() the maximum
+ *		number of waiters to wake at uaddr
+ * @uaddr:	User address to wait on, or to wake
  * @flags:	Flags for this waiter
  * @__reserved:	Reserved member to preserve data alignment. Should be 0.
  */
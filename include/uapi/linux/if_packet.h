@@ -129,6 +129,10 @@ struct tpacket_auxdata {
 
 /* Rx ring - feature request bits */
 #define TP_FT_REQ_FILL_RXHASH	0x1
+/* The blocks are split in equal rings, the n-th filled on CPU n only:
+ * tp_block_nr must be a multiple of the number of possible CPU ids.
+ */
+#define TP_FT_REQ_PER_CPU	0x2
 
 struct tpacket_hdr {
 	unsigned long	tp_status;
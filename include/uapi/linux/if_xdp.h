@@ -25,9 +25,21 @@
  * application.
  */
 #define XDP_USE_NEED_WAKEUP (1 << 3)
+/* Together with XDP_SHARED_UMEM on another queue id and/or device, draw Rx
+ * buffers from the fill ring of the socket in sxdp_shared_umem_fd instead
+ * of registering a fill ring of its own. Only a completion ring is needed.
+ * The XDP_RING_NEED_WAKEUP flag of a shared fill ring does not tell which
+ * queue wants to be woken up, so all of them should be kicked.
+ */
+#define XDP_SHARED_UMEM_FQ (1 << 4)
 
 /* Flags for xsk_umem_config flags */
 #define XDP_UMEM_UNALIGNED_CHUNK_FLAG (1 << 0)
+/* If this flag is set, packets larger than a chunk are spread over several
+ * chunks. Every descriptor of such a packet but the last one has the
+ * XDP_PKT_CONTD option set, both on the Rx and on the Tx ring.
+ */
+#define XDP_UMEM_SG_FLAG (1 << 1)
 
 struct sockaddr_xdp {
 	__u16 sxdp_family;
@@ -63,6 +75,7 @@ struct xdp_mmap_offsets {
 #define XDP_UMEM_COMPLETION_RING	6
 #define XDP_STATISTICS			7
 #define XDP_OPTIONS			8
+#define XDP_TX_WAKEUP_BATCH		9
 
 struct xdp_umem_reg {
 	__u64 addr; /* Start of packet data area */
@@ -88,6 +101,11 @@ struct xdp_options {
 /* Flags for the flags field of struct xdp_options */
 #define XDP_OPTIONS_ZEROCOPY (1 << 0)
 
+/* XDP_TX_WAKEUP_BATCH takes a __u32. When it is non-zero, sendto() only
+ * wakes up the driver once that many descriptors are pending in the Tx
+ * ring. poll() always wakes it up.
+ */
+
 /* Pgoff for mmaping the rings */
 #define XDP_PGOFF_RX_RING			  0
 #define XDP_PGOFF_TX_RING		 0x80000000
@@ -106,6 +124,9 @@ struct xdp_desc {
 	__u32 options;
 };
 
+/* Flag indicating that the packet continues in the next descriptor */
+#define XDP_PKT_CONTD (1 << 0)
+
 /* UMEM descriptor is __u64 */
 
 #endif /* _LINUX_IF_XDP_H */
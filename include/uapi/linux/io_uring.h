@@ -303,7 +303,10 @@ enum io_uring_op {
  *				CQEs on behalf of the same SQE.
  *
  * IORING_RECVSEND_FIXED_BUF	Use registered buffers, the index is stored in
- *				the buf_index field.
+ *				the buf_index field. Supported for SEND_ZC,
+ *				where the pages are sent without a copy, and
+ *				for RECV, where the payload is received
+ *				straight into the pinned buffer pages.
  *
  * IORING_SEND_ZC_REPORT_USAGE
  *				If set, SEND[MSG]_ZC should report
@@ -516,6 +519,12 @@ enum {
 	/* register a range of fixed file slots for automatic slot allocation */
 	IORING_REGISTER_FILE_ALLOC_RANGE	= 25,
 
+	/* set/get io-wq work stealing between NUMA nodes */
+	IORING_REGISTER_IOWQ_STEAL		= 26,
+
+	/* register a copy of another ring's fixed file table */
+	IORING_REGISTER_FILES_CLONE		= 27,
+
 	/* this goes last */
 	IORING_REGISTER_LAST
 };
@@ -685,6 +694,15 @@ struct io_uring_file_index_range {
 	__u64	resv;
 };
 
+/*
+ * Argument for IORING_REGISTER_FILES_CLONE
+ */
+struct io_uring_files_clone {
+	__u32	src_fd;
+	__u32	flags;
+	__u64	resv[3];
+};
+
 struct io_uring_recvmsg_out {
 	__u32 namelen;
 	__u32 controllen;
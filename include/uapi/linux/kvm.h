@@ -558,6 +558,27 @@ struct kvm_coalesced_mmio_ring {
 	((PAGE_SIZE - sizeof(struct kvm_coalesced_mmio_ring)) / \
 	 sizeof(struct kvm_coalesced_mmio))
 
+/*
+ * Per-vCPU coalesced MMIO ring, see KVM_CAP_COALESCED_MMIO_VCPU_RING.  @seq
+ * orders entries across the rings of all vCPUs of a VM.
+ */
+struct kvm_coalesced_mmio_seq {
+	__u64 phys_addr;
+	__u32 len;
+	__u32 pio;
+	__u64 seq;
+	__u8  data[8];
+};
+
+struct kvm_coalesced_mmio_vcpu_ring {
+	__u32 first, last;
+	struct kvm_coalesced_mmio_seq coalesced_mmio[];
+};
+
+#define KVM_COALESCED_MMIO_VCPU_MAX \
+	((PAGE_SIZE - sizeof(struct kvm_coalesced_mmio_vcpu_ring)) / \
+	 sizeof(struct kvm_coalesced_mmio_seq))
+
 /* for KVM_TRANSLATE */
 struct kvm_translation {
 	/* in */
@@ -1175,6 +1196,8 @@ struct kvm_ppc_resize_hpt {
 #define KVM_CAP_DIRTY_LOG_RING_ACQ_REL 223
 #define KVM_CAP_S390_PROTECTED_ASYNC_DISABLE 224
 #define KVM_CAP_DIRTY_LOG_RING_WITH_BITMAP 225
+#define KVM_CAP_PRE_FAULT_MEMORY 226
+#define KVM_CAP_COALESCED_MMIO_VCPU_RING 227
 
 #ifdef KVM_CAP_IRQ_ROUTING
 
@@ -2228,4 +2251,14 @@ struct kvm_s390_zpci_op {
 /* flags for kvm_s390_zpci_op->u.reg_aen.flags */
 #define KVM_S390_ZPCIOP_REGAEN_HOST    (1 << 0)
 
+/* Available with KVM_CAP_PRE_FAULT_MEMORY */
+#define KVM_PRE_FAULT_MEMORY	_IOWR(KVMIO, 0xd5, struct kvm_pre_fault_memory)
+
+struct kvm_pre_fault_memory {
+	__u64 gpa;
+	__u64 size;
+	__u64 flags;
+	__u64 padding[5];
+};
+
 #endif /* __LINUX_KVM_H */
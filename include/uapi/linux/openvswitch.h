@@ -78,6 +78,13 @@ enum ovs_datapath_cmd {
  * datapath. Always present in notifications.
  * @OVS_DP_ATTR_IFINDEX: Interface index for a new datapath netdev. Only
  * valid for %OVS_DP_CMD_NEW requests.
+ * @OVS_DP_ATTR_UPCALL_BATCH_SIZE: Maximum number of bytes of upcall messages
+ * queued per CPU before they are sent to userspace as one multi-message
+ * Netlink datagram.  Zero, the default, disables batching.
+ * @OVS_DP_ATTR_UPCALL_BATCH_USECS: Maximum time in microseconds an upcall may
+ * stay queued in a batch before the batch is sent.
+ * @OVS_DP_ATTR_UPCALL_BATCH_STATS: &struct ovs_dp_upcall_batch_stats summed
+ * over all CPUs.  Always present in notifications.
  *
  * These attributes follow the &struct ovs_header within the Generic Netlink
  * payload for %OVS_DP_* commands.
@@ -95,6 +102,9 @@ enum ovs_datapath_attr {
 				     * per-cpu dispatch mode
 				     */
 	OVS_DP_ATTR_IFINDEX,
+	OVS_DP_ATTR_UPCALL_BATCH_SIZE,	/* u32 bytes, 0 disables batching */
+	OVS_DP_ATTR_UPCALL_BATCH_USECS,	/* u32 maximum batching delay */
+	OVS_DP_ATTR_UPCALL_BATCH_STATS,	/* struct ovs_dp_upcall_batch_stats */
 	__OVS_DP_ATTR_MAX
 };
 
@@ -115,6 +125,14 @@ struct ovs_dp_megaflow_stats {
 	__u64 pad1;		 /* Pad for future expension. */
 };
 
+struct ovs_dp_upcall_batch_stats {
+	__u64 n_batches;	 /* Number of batches sent to userspace. */
+	__u64 n_upcalls;	 /* Number of upcalls queued in batches. */
+	__u64 n_lost;		 /* Number of batched upcalls not delivered. */
+	__u64 wait_ns;		 /* Total time batches spent queued. */
+	__u64 max_wait_ns;	 /* Longest time a batch spent queued on any CPU. */
+};
+
 struct ovs_vport_stats {
 	__u64   rx_packets;		/* total packets received       */
 	__u64   tx_packets;		/* total packets transmitted    */
@@ -455,7 +455,8 @@ struct perf_event_attr {
 				inherit_thread :  1, /* children only inherit if cloned with CLONE_THREAD */
 				remove_on_exec :  1, /* event is removed from task on exec */
 				sigtrap        :  1, /* send synchronous SIGTRAP on event */
-				__reserved_1   : 26;
+				callchain_id   :  1, /* send each callchain once per buffer */
+				__reserved_1   : 25;
 
 	union {
 		__u32		wakeup_events;	  /* wakeup every n events */
@@ -963,6 +964,15 @@ enum perf_event_type {
 	 *	  u64			ips[nr];  } && PERF_SAMPLE_CALLCHAIN
 	 *
 	 *	#
+	 *	# With attr.callchain_id, ips[] starts with PERF_CONTEXT_STACK_ID
+	 *	# and a non-zero stack id. The callchain follows the first time
+	 *	# the id is written to the buffer, and is left out (nr == 2)
+	 *	# afterwards. A record that raced with the first one may come
+	 *	# before it, and after lost records the callchain is sent again.
+	 *	# Overwritable buffers always hold the full callchain.
+	 *	#
+	 *
+	 *	#
 	 *	# The RAW record below is opaque data wrt the ABI
 	 *	#
 	 *	# That is, the ABI doesn't make any promises wrt to
@@ -1234,6 +1244,7 @@ enum perf_callchain_context {
 	PERF_CONTEXT_HV			= (__u64)-32,
 	PERF_CONTEXT_KERNEL		= (__u64)-128,
 	PERF_CONTEXT_USER		= (__u64)-512,
+	PERF_CONTEXT_STACK_ID		= (__u64)-1024,
 
 	PERF_CONTEXT_GUEST		= (__u64)-2048,
 	PERF_CONTEXT_GUEST_KERNEL	= (__u64)-2176,
@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_SMAPS_SUMMARY_H
+#define _UAPI_LINUX_SMAPS_SUMMARY_H
+
+#include <linux/types.h>
+
+/*
+ * Binary per-process memory summary, read from /proc/<pid>/smaps_summary.
+ *
+ * A read at offset 0 returns a struct smaps_summary followed by one __u64 for
+ * each bit set in @mask, in increasing bit order.  All values are in bytes.
+ * Reading at offset 0 again (e.g. with pread()) takes a fresh snapshot, so
+ * a monitor can keep the file open.
+ *
+ * The fields reported are chosen by writing a __u64 mask of
+ * SMAPS_SUMMARY_* bits to the file; unknown bits are ignored, and the mask
+ * in the header says what was actually returned.  By default only the
+ * fields in SMAPS_SUMMARY_COUNTERS are reported: those come straight from
+ * the mm counters and are cheap.  The others need a walk of the page tables
+ * of the process, like smaps_rollup does.
+ */
+
+#define SMAPS_SUMMARY_VERSION		1
+
+enum smaps_summary_field {
+	/* From the mm counters */
+	SMAPS_SUMMARY_VM_SIZE,
+	SMAPS_SUMMARY_VM_PEAK,
+	SMAPS_SUMMARY_VM_LOCKED,
+	SMAPS_SUMMARY_VM_PINNED,
+	SMAPS_SUMMARY_RSS_PEAK,
+	SMAPS_SUMMARY_RSS_ANON,
+	SMAPS_SUMMARY_RSS_FILE,
+	SMAPS_SUMMARY_RSS_SHMEM,
+	SMAPS_SUMMARY_SWAP,
+	SMAPS_SUMMARY_PGTABLES,
+
+	/* From a page table walk */
+	SMAPS_SUMMARY_RSS = 32,
+	SMAPS_SUMMARY_PSS,
+	SMAPS_SUMMARY_PSS_DIRTY,
+	SMAPS_SUMMARY_PSS_ANON,
+	SMAPS_SUMMARY_PSS_FILE,
+	SMAPS_SUMMARY_PSS_SHMEM,
+	SMAPS_SUMMARY_SHARED_CLEAN,
+	SMAPS_SUMMARY_SHARED_DIRTY,
+	SMAPS_SUMMARY_PRIVATE_CLEAN,
+	SMAPS_SUMMARY_PRIVATE_DIRTY,
+	SMAPS_SUMMARY_REFERENCED,
+	SMAPS_SUMMARY_ANONYMOUS,
+	SMAPS_SUMMARY_LAZYFREE,
+	SMAPS_SUMMARY_ANON_THP,
+	SMAPS_SUMMARY_SHMEM_THP,
+	SMAPS_SUMMARY_FILE_THP,
+	SMAPS_SUMMARY_SHARED_HUGETLB,
+	SMAPS_SUMMARY_PRIVATE_HUGETLB,
+	SMAPS_SUMMARY_SWAP_PSS,
+	SMAPS_SUMMARY_PSS_LOCKED,
+
+	SMAPS_SUMMARY_NR_FIELDS
+};
+
+#define SMAPS_SUMMARY_COUNTERS		0xffffffffULL
+
+struct smaps_summary {
+	__u32	version;	/* SMAPS_SUMMARY_VERSION */
+	__u32	size;		/* Of the header and the values that follow */
+	__u64	mask;		/* Fields present */
+	__u64	values[];
+};
+
+#endif /* _UAPI_LINUX_SMAPS_SUMMARY_H */
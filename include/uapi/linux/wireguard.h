@@ -49,6 +49,7 @@
  *                    ...
  *                ...
  *            WGPEER_A_PROTOCOL_VERSION: NLA_U32
+ *            WGPEER_A_TX_QUEUES: NLA_U16
  *        0: NLA_NESTED
  *            ...
  *        ...
@@ -111,6 +112,11 @@
  *                                       most recent protocol will be used when
  *                                       this is unset. Otherwise, must be set
  *                                       to 1.
+ *            WGPEER_A_TX_QUEUES: NLA_U16, number of independently ordered
+ *                                transmit queues, from 1 to 8. Packets are
+ *                                spread between them by flow hash, so that
+ *                                ordering is kept per flow rather than per
+ *                                peer. Defaults to 1.
  *        0: NLA_NESTED
  *            ...
  *        ...
@@ -180,6 +186,7 @@ enum wgpeer_attribute {
 	WGPEER_A_TX_BYTES,
 	WGPEER_A_ALLOWEDIPS,
 	WGPEER_A_PROTOCOL_VERSION,
+	WGPEER_A_TX_QUEUES,
 	__WGPEER_A_LAST
 };
 #define WGPEER_A_MAX (__WGPEER_A_LAST - 1)
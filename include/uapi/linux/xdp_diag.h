@@ -78,6 +78,9 @@ struct xdp_diag_stats {
 	__u64	n_fill_ring_empty;
 	__u64	n_tx_invalid;
 	__u64	n_tx_ring_empty;
+	__u64	n_rx_wakeups;
+	__u64	n_tx_wakeups;
+	__u64	n_tx_descs;
 };
 
 #endif /* _LINUX_XDP_DIAG_H */
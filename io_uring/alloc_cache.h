@@ -5,6 +5,10 @@
  * Don't allow the cache to grow beyond this size.
  */
 #define IO_ALLOC_CACHE_MAX	512
+/*
+ * Per opcode bound on the memory held by a ring's ->async_data cache.
+ */
+#define IO_ASYNC_DATA_CACHE_BYTES	(64 * 1024)
 
 struct io_cache_entry {
 	struct hlist_node	node;
@@ -13,7 +17,7 @@ struct io_cache_entry {
 static inline bool io_alloc_cache_put(struct io_alloc_cache *cache,
 				      struct io_cache_entry *entry)
 {
-	if (cache->nr_cached < IO_ALLOC_CACHE_MAX) {
+	if (cache->nr_cached < cache->max_cached) {
 		cache->nr_cached++;
 		hlist_add_head(&entry->node, &cache->list);
 		return true;
@@ -27,16 +31,22 @@ static inline struct io_cache_entry *io_alloc_cache_get(struct io_alloc_cache *c
 		struct hlist_node *node = cache->list.first;
 
 		hlist_del(node);
+		cache->nr_cached--;
+		cache->hits++;
 		return container_of(node, struct io_cache_entry, node);
 	}
 
+	cache->misses++;
 	return NULL;
 }
 
-static inline void io_alloc_cache_init(struct io_alloc_cache *cache)
+static inline void io_alloc_cache_init(struct io_alloc_cache *cache,
+				       unsigned int max_nr)
 {
 	INIT_HLIST_HEAD(&cache->list);
 	cache->nr_cached = 0;
+	cache->max_cached = max_nr;
+	cache->hits = cache->misses = 0;
 }
 
 static inline void io_alloc_cache_free(struct io_alloc_cache *cache,
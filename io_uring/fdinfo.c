@@ -146,6 +146,11 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 	seq_printf(m, "SqThread:\t%d\n", sq ? task_pid_nr(sq->thread) : -1);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq ? task_cpu(sq->thread) : -1);
+	if (ctx->flags & IORING_SETUP_SQPOLL) {
+		seq_printf(m, "SqBusyTime:\t%llu\n", READ_ONCE(ctx->sq_busy_time));
+		seq_printf(m, "SqIdleTime:\t%llu\n", READ_ONCE(ctx->sq_idle_time));
+		seq_printf(m, "SqSubmitCap:\t%u\n", READ_ONCE(ctx->sq_cap));
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
@@ -162,6 +167,16 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 		seq_printf(m, "%5u: 0x%llx/%u\n", i, buf->ubuf, len);
 	}
+	seq_puts(m, "AsyncDataCache:\n");
+	for (i = 0; has_lock && i < IORING_OP_LAST; i++) {
+		struct io_alloc_cache *cache = &ctx->async_data_cache[i];
+
+		if (!cache->hits && !cache->misses)
+			continue;
+		seq_printf(m, "  op=%s, cached=%u/%u, hits=%lu, misses=%lu\n",
+			   io_uring_get_opcode(i), cache->nr_cached,
+			   cache->max_cached, cache->hits, cache->misses);
+	}
 	if (has_lock && !xa_empty(&ctx->personalities)) {
 		unsigned long index;
 		const struct cred *cred;
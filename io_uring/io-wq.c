@@ -32,6 +32,7 @@ enum {
 
 enum {
 	IO_WQ_BIT_EXIT		= 0,	/* wq exiting */
+	IO_WQ_BIT_STEAL		= 1,	/* idle workers steal remote work */
 };
 
 enum {
@@ -463,14 +464,13 @@ static bool io_wait_on_hash(struct io_wqe *wqe, unsigned int hash)
 	return ret;
 }
 
-static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
-					   struct io_worker *worker)
+static struct io_wq_work *__io_get_next_work(struct io_wqe *wqe,
+					     struct io_wqe_acct *acct,
+					     unsigned int *stall_hash)
 	__must_hold(acct->lock)
 {
 	struct io_wq_work_node *node, *prev;
 	struct io_wq_work *work, *tail;
-	unsigned int stall_hash = -1U;
-	struct io_wqe *wqe = worker->wqe;
 
 	wq_list_for_each(node, prev, &acct->work_list) {
 		unsigned int hash;
@@ -493,12 +493,27 @@ static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
 			wq_list_cut(&acct->work_list, &tail->list, prev);
 			return work;
 		}
-		if (stall_hash == -1U)
-			stall_hash = hash;
+		if (*stall_hash == -1U)
+			*stall_hash = hash;
 		/* fast forward to a next hash, for-each will fix up @prev */
 		node = &tail->list;
 	}
 
+	return NULL;
+}
+
+static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
+					   struct io_worker *worker)
+	__must_hold(acct->lock)
+{
+	unsigned int stall_hash = -1U;
+	struct io_wqe *wqe = worker->wqe;
+	struct io_wq_work *work;
+
+	work = __io_get_next_work(wqe, acct, &stall_hash);
+	if (work)
+		return work;
+
 	if (stall_hash != -1U) {
 		bool unstalled;
 
@@ -536,13 +551,67 @@ static void io_assign_current_work(struct io_worker *worker,
 
 static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work);
 
-static void io_worker_handle_work(struct io_worker *worker)
+static void io_worker_run_work(struct io_worker *worker,
+			       struct io_wqe_acct *acct,
+			       struct io_wq_work *work)
 {
-	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
 	struct io_wqe *wqe = worker->wqe;
 	struct io_wq *wq = wqe->wq;
 	bool do_kill = test_bit(IO_WQ_BIT_EXIT, &wq->state);
 
+	__io_worker_busy(wqe, worker);
+
+	/*
+	 * Make sure cancelation can find this, even before it becomes the
+	 * active work. That avoids a window where the work has been removed
+	 * from our general work list, but isn't yet discoverable as the
+	 * current work item for this worker.
+	 */
+	raw_spin_lock(&worker->lock);
+	worker->next_work = work;
+	raw_spin_unlock(&worker->lock);
+
+	io_assign_current_work(worker, work);
+	__set_current_state(TASK_RUNNING);
+
+	/* handle a whole dependent link */
+	do {
+		struct io_wq_work *next_hashed, *linked;
+		unsigned int hash = io_get_work_hash(work);
+
+		next_hashed = wq_next_work(work);
+
+		if (unlikely(do_kill) && (work->flags & IO_WQ_WORK_UNBOUND))
+			work->flags |= IO_WQ_WORK_CANCEL;
+		wq->do_work(work);
+		io_assign_current_work(worker, NULL);
+
+		linked = wq->free_work(work);
+		work = next_hashed;
+		if (!work && linked && !io_wq_is_hashed(linked)) {
+			work = linked;
+			linked = NULL;
+		}
+		io_assign_current_work(worker, work);
+		if (linked)
+			io_wqe_enqueue(wqe, linked);
+
+		if (hash != -1U && !next_hashed) {
+			/* serialize hash clear with wake_up() */
+			spin_lock_irq(&wq->hash->wait.lock);
+			clear_bit(hash, &wq->hash->map);
+			clear_bit(IO_ACCT_STALLED_BIT, &acct->flags);
+			spin_unlock_irq(&wq->hash->wait.lock);
+			if (wq_has_sleeper(&wq->hash->wait))
+				wake_up(&wq->hash->wait);
+		}
+	} while (work);
+}
+
+static void io_worker_handle_work(struct io_worker *worker)
+{
+	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
+
 	do {
 		struct io_wq_work *work;
 
@@ -556,60 +625,51 @@ static void io_worker_handle_work(struct io_worker *worker)
 		raw_spin_lock(&acct->lock);
 		work = io_get_next_work(acct, worker);
 		raw_spin_unlock(&acct->lock);
-		if (work) {
-			__io_worker_busy(wqe, worker);
-
-			/*
-			 * Make sure cancelation can find this, even before
-			 * it becomes the active work. That avoids a window
-			 * where the work has been removed from our general
-			 * work list, but isn't yet discoverable as the
-			 * current work item for this worker.
-			 */
-			raw_spin_lock(&worker->lock);
-			worker->next_work = work;
-			raw_spin_unlock(&worker->lock);
-		} else {
+		if (!work)
 			break;
-		}
-		io_assign_current_work(worker, work);
-		__set_current_state(TASK_RUNNING);
-
-		/* handle a whole dependent link */
-		do {
-			struct io_wq_work *next_hashed, *linked;
-			unsigned int hash = io_get_work_hash(work);
-
-			next_hashed = wq_next_work(work);
-
-			if (unlikely(do_kill) && (work->flags & IO_WQ_WORK_UNBOUND))
-				work->flags |= IO_WQ_WORK_CANCEL;
-			wq->do_work(work);
-			io_assign_current_work(worker, NULL);
-
-			linked = wq->free_work(work);
-			work = next_hashed;
-			if (!work && linked && !io_wq_is_hashed(linked)) {
-				work = linked;
-				linked = NULL;
-			}
-			io_assign_current_work(worker, work);
-			if (linked)
-				io_wqe_enqueue(wqe, linked);
-
-			if (hash != -1U && !next_hashed) {
-				/* serialize hash clear with wake_up() */
-				spin_lock_irq(&wq->hash->wait.lock);
-				clear_bit(hash, &wq->hash->map);
-				clear_bit(IO_ACCT_STALLED_BIT, &acct->flags);
-				spin_unlock_irq(&wq->hash->wait.lock);
-				if (wq_has_sleeper(&wq->hash->wait))
-					wake_up(&wq->hash->wait);
-			}
-		} while (work);
+		io_worker_run_work(worker, acct, work);
 	} while (1);
 }
 
+/*
+ * Our own node has nothing runnable. If stealing is enabled, look at the
+ * same class of work on the other nodes and run one item (or one hashed
+ * chain) from there. Hashed work is only taken if no one is currently
+ * running that hash, the hash map is shared between all nodes of an io_wq
+ * so serialization per hash is retained. Returns true if work was run.
+ */
+static bool io_worker_steal_work(struct io_worker *worker)
+{
+	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
+	struct io_wqe *wqe = worker->wqe;
+	struct io_wq *wq = wqe->wq;
+	int node;
+
+	if (!test_bit(IO_WQ_BIT_STEAL, &wq->state) ||
+	    test_bit(IO_WQ_BIT_EXIT, &wq->state))
+		return false;
+
+	for_each_node(node) {
+		struct io_wqe *victim = wq->wqes[node];
+		struct io_wqe_acct *vacct = &victim->acct[acct->index];
+		unsigned int stall_hash = -1U;
+		struct io_wq_work *work;
+
+		if (victim == wqe || wq_list_empty(&vacct->work_list))
+			continue;
+
+		raw_spin_lock(&vacct->lock);
+		work = __io_get_next_work(victim, vacct, &stall_hash);
+		raw_spin_unlock(&vacct->lock);
+		if (work) {
+			io_worker_run_work(worker, acct, work);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static int io_wqe_worker(void *data)
 {
 	struct io_worker *worker = data;
@@ -630,6 +690,8 @@ static int io_wqe_worker(void *data)
 		set_current_state(TASK_INTERRUPTIBLE);
 		while (io_acct_run_queue(acct))
 			io_worker_handle_work(worker);
+		if (io_worker_steal_work(worker))
+			continue;
 
 		raw_spin_lock(&wqe->lock);
 		/* timed out, exit unless we're the last worker */
@@ -900,12 +962,41 @@ static bool io_wq_work_match_item(struct io_wq_work *work, void *data)
 	return work == data;
 }
 
+/*
+ * Local node is out of free workers and can't create more. With stealing
+ * enabled, kick an idle worker of the same class on another node instead,
+ * it'll pick up the work through io_worker_steal_work().
+ */
+static bool io_wqe_wake_remote_worker(struct io_wqe *wqe,
+				      struct io_wqe_acct *acct)
+{
+	struct io_wq *wq = wqe->wq;
+	bool ret = false;
+	int node;
+
+	rcu_read_lock();
+	for_each_node(node) {
+		struct io_wqe *remote = wq->wqes[node];
+
+		if (remote == wqe)
+			continue;
+		raw_spin_lock(&remote->lock);
+		ret = io_wqe_activate_free_worker(remote,
+						  &remote->acct[acct->index]);
+		raw_spin_unlock(&remote->lock);
+		if (ret)
+			break;
+	}
+	rcu_read_unlock();
+	return ret;
+}
+
 static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work)
 {
 	struct io_wqe_acct *acct = io_work_get_acct(wqe, work);
 	struct io_cb_cancel_data match;
 	unsigned work_flags = work->flags;
-	bool do_create;
+	bool do_create, at_limit;
 
 	/*
 	 * If io-wq is exiting for this task, or if the request has explicitly
@@ -926,9 +1017,13 @@ static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work)
 	rcu_read_lock();
 	do_create = !io_wqe_activate_free_worker(wqe, acct);
 	rcu_read_unlock();
-
+	at_limit = acct->nr_workers >= acct->max_workers;
 	raw_spin_unlock(&wqe->lock);
 
+	if (do_create && at_limit && test_bit(IO_WQ_BIT_STEAL, &wqe->wq->state) &&
+	    io_wqe_wake_remote_worker(wqe, acct))
+		return;
+
 	if (do_create && ((work_flags & IO_WQ_WORK_CONCURRENT) ||
 	    !atomic_read(&acct->nr_running))) {
 		bool did_create;
@@ -1357,6 +1452,17 @@ int io_wq_cpu_affinity(struct io_wq *wq, cpumask_var_t mask)
 	return 0;
 }
 
+/*
+ * Enable or disable work stealing between the per-node pools, returns the
+ * previous setting.
+ */
+bool io_wq_set_steal(struct io_wq *wq, bool enable)
+{
+	if (enable)
+		return test_and_set_bit(IO_WQ_BIT_STEAL, &wq->state);
+	return test_and_clear_bit(IO_WQ_BIT_STEAL, &wq->state);
+}
+
 /*
  * Set max number of unbounded workers, returns old value. If new_count is 0,
  * then just return the old value.
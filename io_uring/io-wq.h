@@ -52,6 +52,7 @@ void io_wq_hash_work(struct io_wq_work *work, void *val);
 
 int io_wq_cpu_affinity(struct io_wq *wq, cpumask_var_t mask);
 int io_wq_max_workers(struct io_wq *wq, int *new_count);
+bool io_wq_set_steal(struct io_wq *wq, bool enable);
 
 static inline bool io_wq_is_hashed(struct io_wq_work *work)
 {
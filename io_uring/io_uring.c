@@ -145,7 +145,7 @@ static bool io_uring_try_cancel_requests(struct io_ring_ctx *ctx,
 					 bool cancel_all);
 
 static void io_dismantle_req(struct io_kiocb *req);
-static void io_clean_op(struct io_kiocb *req);
+static void io_clean_op(struct io_kiocb *req, bool locked);
 static void io_queue_sqe(struct io_kiocb *req);
 static void io_move_task_work_from_local(struct io_ring_ctx *ctx);
 static void __io_submit_flush_completions(struct io_ring_ctx *ctx);
@@ -272,6 +272,27 @@ static int io_alloc_hash_table(struct io_hash_table *table, unsigned bits)
 	return 0;
 }
 
+static __cold void io_async_data_cache_init(struct io_ring_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < IORING_OP_LAST; i++) {
+		unsigned int size = io_op_defs[i].async_size;
+		unsigned int max_nr = 0;
+
+		/* freed entries are reused in place to link the cache */
+		if (size >= sizeof(struct io_cache_entry))
+			max_nr = min_t(unsigned int, IO_ALLOC_CACHE_MAX,
+				       IO_ASYNC_DATA_CACHE_BYTES / size);
+		io_alloc_cache_init(&ctx->async_data_cache[i], max_nr);
+	}
+}
+
+static void io_async_data_cache_free(struct io_cache_entry *entry)
+{
+	kfree(entry);
+}
+
 static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 {
 	struct io_ring_ctx *ctx;
@@ -310,8 +331,9 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_LIST_HEAD(&ctx->sqd_list);
 	INIT_LIST_HEAD(&ctx->cq_overflow_list);
 	INIT_LIST_HEAD(&ctx->io_buffers_cache);
-	io_alloc_cache_init(&ctx->apoll_cache);
-	io_alloc_cache_init(&ctx->netmsg_cache);
+	io_alloc_cache_init(&ctx->apoll_cache, IO_ALLOC_CACHE_MAX);
+	io_alloc_cache_init(&ctx->netmsg_cache, IO_ALLOC_CACHE_MAX);
+	io_async_data_cache_init(ctx);
 	init_completion(&ctx->ref_comp);
 	xa_init_flags(&ctx->personalities, XA_FLAGS_ALLOC1);
 	mutex_init(&ctx->uring_lock);
@@ -618,6 +640,18 @@ static inline void __io_cq_unlock_post(struct io_ring_ctx *ctx)
 	io_cqring_wake(ctx);
 }
 
+/*
+ * Publish the new CQ tail but leave eventfd signalling and waking of waiters
+ * to the caller, who is expected to post a whole batch of completions first
+ * with __io_cq_unlock_post().
+ */
+static inline void __io_cq_unlock_commit(struct io_ring_ctx *ctx)
+	__releases(ctx->completion_lock)
+{
+	io_commit_cqring(ctx);
+	__io_cq_unlock(ctx);
+}
+
 void io_cq_unlock_post(struct io_ring_ctx *ctx)
 	__releases(ctx->completion_lock)
 {
@@ -906,8 +940,12 @@ bool io_aux_cqe(struct io_ring_ctx *ctx, bool defer, u64 user_data, s32 res, u32
 	if (ctx->submit_state.cqes_count == length) {
 		__io_cq_lock(ctx);
 		__io_flush_post_cqes(ctx);
-		/* no need to flush - flush is deferred */
-		__io_cq_unlock_post(ctx);
+		/*
+		 * no need to flush or wake - the deferred completion flush
+		 * signals once for the whole burst
+		 */
+		__io_cq_unlock_commit(ctx);
+		ctx->submit_state.cqes_posted = true;
 	}
 
 	/* For defered completions this is not as strict as it is otherwise,
@@ -1065,7 +1103,7 @@ static inline void io_dismantle_req(struct io_kiocb *req)
 	unsigned int flags = req->flags;
 
 	if (unlikely(flags & IO_REQ_CLEAN_FLAGS))
-		io_clean_op(req);
+		io_clean_op(req, false);
 	if (!(flags & REQ_F_FIXED_FILE))
 		io_put_file(req->file);
 }
@@ -1420,7 +1458,7 @@ void io_free_batch_list(struct io_ring_ctx *ctx, struct io_wq_work_node *node)
 			if (req->flags & IO_REQ_LINK_FLAGS)
 				io_queue_next(req);
 			if (unlikely(req->flags & IO_REQ_CLEAN_FLAGS))
-				io_clean_op(req);
+				io_clean_op(req, true);
 		}
 		if (!(req->flags & REQ_F_FIXED_FILE))
 			io_put_file(req->file);
@@ -1447,8 +1485,10 @@ static void __io_submit_flush_completions(struct io_ring_ctx *ctx)
 {
 	struct io_wq_work_node *node, *prev;
 	struct io_submit_state *state = &ctx->submit_state;
+	unsigned int cq_tail;
 
 	__io_cq_lock(ctx);
+	cq_tail = ctx->cached_cq_tail;
 	/* must come first to preserve CQE ordering in failure cases */
 	if (state->cqes_count)
 		__io_flush_post_cqes(ctx);
@@ -1467,7 +1507,22 @@ static void __io_submit_flush_completions(struct io_ring_ctx *ctx)
 			}
 		}
 	}
-	__io_cq_unlock_post(ctx);
+
+	/*
+	 * A batch made up purely of CQE_SKIP requests, e.g. the head of a
+	 * linked chain with IOSQE_CQE_SKIP_SUCCESS set, posted nothing and has
+	 * nobody to wake. Anything that was posted, including aux CQEs that
+	 * io_aux_cqe() committed early, is signalled here exactly once.
+	 */
+	if (ctx->cached_cq_tail == cq_tail && !state->cqes_posted &&
+	    !test_bit(IO_CHECK_CQ_OVERFLOW_BIT, &ctx->check_cq)) {
+		io_commit_cqring(ctx);
+		__io_cq_unlock(ctx);
+		io_commit_cqring_flush(ctx);
+	} else {
+		__io_cq_unlock_post(ctx);
+	}
+	state->cqes_posted = false;
 
 	if (!wq_list_empty(&ctx->submit_state.compl_reqs)) {
 		io_free_batch_list(ctx, state->compl_reqs.first);
@@ -1706,10 +1761,30 @@ unsigned int io_file_get_flags(struct file *file)
 	return res;
 }
 
-bool io_alloc_async_data(struct io_kiocb *req)
+/*
+ * Allocate ->async_data for the request. If the caller holds ->uring_lock,
+ * as indicated by !IO_URING_F_UNLOCKED, it's taken from the per-opcode cache
+ * of the ring if possible.
+ */
+bool io_alloc_async_data(struct io_kiocb *req, unsigned int issue_flags)
 {
-	WARN_ON_ONCE(!io_op_defs[req->opcode].async_size);
-	req->async_data = kmalloc(io_op_defs[req->opcode].async_size, GFP_KERNEL);
+	const struct io_op_def *def = &io_op_defs[req->opcode];
+
+	WARN_ON_ONCE(!def->async_size);
+	if (!(issue_flags & IO_URING_F_UNLOCKED)) {
+		struct io_alloc_cache *cache;
+		struct io_cache_entry *entry;
+
+		cache = &req->ctx->async_data_cache[req->opcode];
+		entry = io_alloc_cache_get(cache);
+		if (entry) {
+			req->async_data = entry;
+			req->flags |= REQ_F_ASYNC_DATA;
+			return false;
+		}
+	}
+
+	req->async_data = kmalloc(def->async_size, GFP_KERNEL);
 	if (req->async_data) {
 		req->flags |= REQ_F_ASYNC_DATA;
 		return false;
@@ -1717,7 +1792,7 @@ bool io_alloc_async_data(struct io_kiocb *req)
 	return true;
 }
 
-int io_req_prep_async(struct io_kiocb *req)
+int io_req_prep_async(struct io_kiocb *req, unsigned int issue_flags)
 {
 	const struct io_op_def *def = &io_op_defs[req->opcode];
 
@@ -1729,7 +1804,7 @@ int io_req_prep_async(struct io_kiocb *req)
 	if (WARN_ON_ONCE(req_has_async_data(req)))
 		return -EFAULT;
 	if (!io_op_defs[req->opcode].manual_alloc) {
-		if (io_alloc_async_data(req))
+		if (io_alloc_async_data(req, issue_flags))
 			return -EAGAIN;
 	}
 	return def->prep_async(req);
@@ -1787,7 +1862,7 @@ static __cold void io_drain_req(struct io_kiocb *req)
 	spin_unlock(&ctx->completion_lock);
 }
 
-static void io_clean_op(struct io_kiocb *req)
+static void io_clean_op(struct io_kiocb *req, bool locked)
 {
 	if (req->flags & REQ_F_BUFFER_SELECTED) {
 		spin_lock(&req->ctx->completion_lock);
@@ -1814,7 +1889,11 @@ static void io_clean_op(struct io_kiocb *req)
 	if (req->flags & REQ_F_CREDS)
 		put_cred(req->creds);
 	if (req->flags & REQ_F_ASYNC_DATA) {
-		kfree(req->async_data);
+		struct io_alloc_cache *cache;
+
+		cache = &req->ctx->async_data_cache[req->opcode];
+		if (!locked || !io_alloc_cache_put(cache, req->async_data))
+			kfree(req->async_data);
 		req->async_data = NULL;
 	}
 	req->flags &= ~IO_REQ_CLEAN_FLAGS;
@@ -2044,7 +2123,7 @@ static void io_queue_sqe_fallback(struct io_kiocb *req)
 		req->flags |= REQ_F_LINK;
 		io_req_defer_failed(req, req->cqe.res);
 	} else {
-		int ret = io_req_prep_async(req);
+		int ret = io_req_prep_async(req, 0);
 
 		if (unlikely(ret)) {
 			io_req_defer_failed(req, ret);
@@ -2253,7 +2332,7 @@ static inline int io_submit_sqe(struct io_ring_ctx *ctx, struct io_kiocb *req,
 	 * conditions are true (normal request), then just queue it.
 	 */
 	if (unlikely(link->head)) {
-		ret = io_req_prep_async(req);
+		ret = io_req_prep_async(req, 0);
 		if (unlikely(ret))
 			return io_submit_fail_init(sqe, req, ret);
 
@@ -2701,6 +2780,8 @@ static void io_req_caches_free(struct io_ring_ctx *ctx)
 
 static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 {
+	int i;
+
 	io_sq_thread_finish(ctx);
 	io_rsrc_refs_drop(ctx);
 	/* __io_rsrc_put_work() may need uring_lock to progress, wait w/o it */
@@ -2716,6 +2797,9 @@ static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 	io_eventfd_unregister(ctx);
 	io_alloc_cache_free(&ctx->apoll_cache, io_apoll_cache_free);
 	io_alloc_cache_free(&ctx->netmsg_cache, io_netmsg_cache_free);
+	for (i = 0; i < IORING_OP_LAST; i++)
+		io_alloc_cache_free(&ctx->async_data_cache[i],
+				    io_async_data_cache_free);
 	mutex_unlock(&ctx->uring_lock);
 	io_destroy_buffers(ctx);
 	if (ctx->sq_creds)
@@ -3922,6 +4006,25 @@ static __cold int io_unregister_iowq_aff(struct io_ring_ctx *ctx)
 	return io_wq_cpu_affinity(tctx->io_wq, NULL);
 }
 
+static __cold int io_register_iowq_steal(struct io_ring_ctx *ctx,
+					 void __user *arg)
+{
+	struct io_uring_task *tctx = current->io_uring;
+	__u32 enable;
+
+	if (!tctx || !tctx->io_wq)
+		return -EINVAL;
+	if (copy_from_user(&enable, arg, sizeof(enable)))
+		return -EFAULT;
+	if (enable > 1)
+		return -EINVAL;
+
+	enable = io_wq_set_steal(tctx->io_wq, enable);
+	if (copy_to_user(arg, &enable, sizeof(enable)))
+		return -EFAULT;
+	return 0;
+}
+
 static __cold int io_register_iowq_max_workers(struct io_ring_ctx *ctx,
 					       void __user *arg)
 	__must_hold(&ctx->uring_lock)
@@ -4133,6 +4236,12 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_iowq_max_workers(ctx, arg);
 		break;
+	case IORING_REGISTER_IOWQ_STEAL:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_register_iowq_steal(ctx, arg);
+		break;
 	case IORING_REGISTER_RING_FDS:
 		ret = io_ringfd_register(ctx, arg, nr_args);
 		break;
@@ -4163,6 +4272,12 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_register_file_alloc_range(ctx, arg);
 		break;
+	case IORING_REGISTER_FILES_CLONE:
+		ret = -EINVAL;
+		if (!arg || nr_args)
+			break;
+		ret = io_sqe_files_clone(ctx, arg);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -150,7 +150,7 @@ static struct io_async_msghdr *io_msg_alloc_async(struct io_kiocb *req,
 		}
 	}
 
-	if (!io_alloc_async_data(req)) {
+	if (!io_alloc_async_data(req, issue_flags)) {
 		hdr = req->async_data;
 		hdr->free_iov = NULL;
 		return hdr;
@@ -555,6 +555,7 @@ int io_recvmsg_prep_async(struct io_kiocb *req)
 }
 
 #define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT)
+#define RECV_FLAGS (RECVMSG_FLAGS | IORING_RECVSEND_FIXED_BUF)
 
 int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
@@ -566,8 +567,23 @@ int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	sr->umsg = u64_to_user_ptr(READ_ONCE(sqe->addr));
 	sr->len = READ_ONCE(sqe->len);
 	sr->flags = READ_ONCE(sqe->ioprio);
-	if (sr->flags & ~(RECVMSG_FLAGS))
-		return -EINVAL;
+	if (sr->flags & ~(RECVMSG_FLAGS)) {
+		if (req->opcode != IORING_OP_RECV || (sr->flags & ~RECV_FLAGS))
+			return -EINVAL;
+	}
+	if (sr->flags & IORING_RECVSEND_FIXED_BUF) {
+		struct io_ring_ctx *ctx = req->ctx;
+		unsigned idx = READ_ONCE(sqe->buf_index);
+
+		/* the registered buffer is the target, nothing to select */
+		if (req->flags & REQ_F_BUFFER_SELECT)
+			return -EINVAL;
+		if (unlikely(idx >= ctx->nr_user_bufs))
+			return -EFAULT;
+		idx = array_index_nospec(idx, ctx->nr_user_bufs);
+		req->imu = READ_ONCE(ctx->user_bufs[idx]);
+		io_req_set_rsrc_node(req, ctx, 0);
+	}
 	sr->msg_flags = READ_ONCE(sqe->msg_flags) | MSG_NOSIGNAL;
 	if (sr->msg_flags & MSG_DONTWAIT)
 		req->flags |= REQ_F_NOWAIT;
@@ -874,7 +890,12 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		sr->buf = buf;
 	}
 
-	ret = import_single_range(ITER_DEST, sr->buf, len, &iov, &msg.msg_iter);
+	if (sr->flags & IORING_RECVSEND_FIXED_BUF)
+		ret = io_import_fixed(ITER_DEST, &msg.msg_iter, req->imu,
+					(u64)(uintptr_t)sr->buf, len);
+	else
+		ret = import_single_range(ITER_DEST, sr->buf, len, &iov,
+					  &msg.msg_iter);
 	if (unlikely(ret))
 		goto out_free;
 
@@ -1474,7 +1495,7 @@ int io_connect(struct io_kiocb *req, unsigned int issue_flags)
 		} else {
 			if (req_has_async_data(req))
 				return -EAGAIN;
-			if (io_alloc_async_data(req)) {
+			if (io_alloc_async_data(req, issue_flags)) {
 				ret = -ENOMEM;
 				goto out;
 			}
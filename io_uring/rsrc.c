@@ -1029,6 +1029,110 @@ int io_sqe_files_register(struct io_ring_ctx *ctx, void __user *arg,
 	return ret;
 }
 
+static int __io_sqe_files_clone(struct io_ring_ctx *ctx,
+				struct io_ring_ctx *src_ctx)
+{
+	unsigned int i, nr;
+	int ret;
+
+	if (ctx->file_data)
+		return -EBUSY;
+	if (!src_ctx->file_data)
+		return -ENXIO;
+	nr = src_ctx->nr_user_files;
+	if (nr > rlimit(RLIMIT_NOFILE))
+		return -EMFILE;
+	ret = io_rsrc_node_switch_start(ctx);
+	if (ret)
+		return ret;
+	ret = io_rsrc_data_alloc(ctx, io_rsrc_file_put, NULL, nr,
+				 &ctx->file_data);
+	if (ret)
+		return ret;
+
+	if (!io_alloc_file_tables(&ctx->file_table, nr)) {
+		io_rsrc_data_free(ctx->file_data);
+		ctx->file_data = NULL;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < nr; i++, ctx->nr_user_files++) {
+		struct io_fixed_file *src_slot;
+		struct file *file;
+
+		file = io_file_from_index(&src_ctx->file_table, i);
+		if (!file)
+			continue;
+
+		get_file(file);
+		ret = io_scm_file_account(ctx, file);
+		if (ret) {
+			fput(file);
+			goto fail;
+		}
+		/* copy the cached FFS_* flags along with the file */
+		src_slot = io_fixed_file_slot(&src_ctx->file_table, i);
+		io_fixed_file_slot(&ctx->file_table, i)->file_ptr =
+							src_slot->file_ptr;
+		io_file_bitmap_set(&ctx->file_table, i);
+	}
+
+	io_file_table_set_alloc_range(ctx, src_ctx->file_alloc_start,
+			src_ctx->file_alloc_end - src_ctx->file_alloc_start);
+	io_rsrc_node_switch(ctx, NULL);
+	return 0;
+fail:
+	__io_sqe_files_unregister(ctx);
+	return ret;
+}
+
+/*
+ * Populate the fixed file table of @ctx from the table of another ring,
+ * without going through the task's file descriptor table. Tags are not
+ * inherited. Both rings end up with their own references to every file, so
+ * later updates on either side don't affect the other.
+ */
+int io_sqe_files_clone(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_files_clone clone;
+	struct io_ring_ctx *src_ctx;
+	struct fd f;
+	int ret;
+
+	if (copy_from_user(&clone, arg, sizeof(clone)))
+		return -EFAULT;
+	if (clone.flags || clone.resv[0] || clone.resv[1] || clone.resv[2])
+		return -EINVAL;
+
+	f = fdget(clone.src_fd);
+	if (!f.file)
+		return -EBADF;
+	ret = -EINVAL;
+	if (!io_is_uring_fops(f.file))
+		goto out;
+	src_ctx = f.file->private_data;
+	if (src_ctx == ctx)
+		goto out;
+
+	/*
+	 * Take both ->uring_lock in address order, so two rings cloning from
+	 * each other can't deadlock. We're called with ctx locked and return
+	 * the same way.
+	 */
+	if (ctx > src_ctx) {
+		mutex_unlock(&ctx->uring_lock);
+		mutex_lock(&src_ctx->uring_lock);
+		mutex_lock_nested(&ctx->uring_lock, SINGLE_DEPTH_NESTING);
+	} else {
+		mutex_lock_nested(&src_ctx->uring_lock, SINGLE_DEPTH_NESTING);
+	}
+	ret = __io_sqe_files_clone(ctx, src_ctx);
+	mutex_unlock(&src_ctx->uring_lock);
+out:
+	fdput(f);
+	return ret;
+}
+
 static void io_rsrc_buf_put(struct io_ring_ctx *ctx, struct io_rsrc_put *prsrc)
 {
 	io_buffer_unmap(ctx, &prsrc->buf);
@@ -1198,12 +1302,115 @@ struct page **io_pin_pages(unsigned long ubuf, unsigned long len, int *npages)
 	return pages;
 }
 
+struct io_imu_folio_data {
+	/* head folio can be partially included in the fixed buf */
+	unsigned int	nr_pages_head;
+	/* for non-head/tail folios, must be fully included */
+	unsigned int	nr_pages_mid;
+	unsigned int	nr_folios;
+	unsigned int	folio_shift;
+};
+
+/*
+ * Check if the pinned pages can be represented by one bvec per folio. That's
+ * the case for buffers backed by huge pages (hugetlb or THP), as long as all
+ * pages of a folio are pinned in order and every folio but the first and the
+ * last one is fully covered and of the same size.
+ */
+static bool io_check_coalesce_buffer(struct page **pages, int nr_pages,
+				     struct io_imu_folio_data *data)
+{
+	struct folio *folio = page_folio(pages[0]);
+	unsigned int count = 1, nr_folios = 1;
+	int i;
+
+	if (nr_pages <= 1)
+		return false;
+
+	data->nr_pages_mid = folio_nr_pages(folio);
+	if (data->nr_pages_mid == 1)
+		return false;
+	data->folio_shift = folio_shift(folio);
+
+	for (i = 1; i < nr_pages; i++) {
+		if (page_folio(pages[i]) == folio &&
+		    folio_page_idx(folio, pages[i]) ==
+		    folio_page_idx(folio, pages[i - 1]) + 1) {
+			count++;
+			continue;
+		}
+
+		if (nr_folios == 1) {
+			if (folio_page_idx(folio, pages[i - 1]) !=
+			    data->nr_pages_mid - 1)
+				return false;
+			data->nr_pages_head = count;
+		} else if (count != data->nr_pages_mid) {
+			return false;
+		}
+
+		folio = page_folio(pages[i]);
+		if (folio_size(folio) != (1UL << data->folio_shift) ||
+		    folio_page_idx(folio, pages[i]) != 0)
+			return false;
+
+		count = 1;
+		nr_folios++;
+	}
+	if (nr_folios == 1)
+		data->nr_pages_head = count;
+
+	data->nr_folios = nr_folios;
+	return true;
+}
+
+/*
+ * Replace the page array with one entry per folio. Every page got its own
+ * pin, drop all but one per folio, the remaining one is put by
+ * io_buffer_unmap() like for any other page.
+ */
+static bool io_coalesce_buffer(struct page ***pages, int *nr_pages,
+			       struct io_imu_folio_data *data)
+{
+	struct page **page_array = *pages, **new_array;
+	int nr_pages_left = *nr_pages, i, j;
+
+	new_array = kvmalloc_array(data->nr_folios, sizeof(struct page *),
+				   GFP_KERNEL);
+	if (!new_array)
+		return false;
+
+	new_array[0] = page_array[0];
+	if (data->nr_pages_head > 1)
+		unpin_user_pages(&page_array[1], data->nr_pages_head - 1);
+
+	j = data->nr_pages_head;
+	nr_pages_left -= data->nr_pages_head;
+	for (i = 1; i < data->nr_folios; i++) {
+		unsigned int nr_unpin;
+
+		new_array[i] = page_array[j];
+		nr_unpin = min_t(unsigned int, nr_pages_left - 1,
+				 data->nr_pages_mid - 1);
+		if (nr_unpin)
+			unpin_user_pages(&page_array[j + 1], nr_unpin);
+		j += data->nr_pages_mid;
+		nr_pages_left -= data->nr_pages_mid;
+	}
+	kvfree(page_array);
+	*pages = new_array;
+	*nr_pages = data->nr_folios;
+	return true;
+}
+
 static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 				  struct io_mapped_ubuf **pimu,
 				  struct page **last_hpage)
 {
 	struct io_mapped_ubuf *imu = NULL;
 	struct page **pages = NULL;
+	struct io_imu_folio_data data;
+	unsigned int folio_shift = PAGE_SHIFT;
 	unsigned long off;
 	size_t size;
 	int ret, nr_pages, i;
@@ -1221,9 +1428,29 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 		goto done;
 	}
 
+	off = (unsigned long) iov->iov_base & ~PAGE_MASK;
+
+	/*
+	 * If the buffer is backed by huge pages, collapse it to one bvec per
+	 * folio. That shrinks the bvec array and makes io_import_fixed() skip
+	 * through the buffer in folio sized steps.
+	 */
+	if (io_check_coalesce_buffer(pages, nr_pages, &data)) {
+		struct folio *folio = page_folio(pages[0]);
+		unsigned long idx = folio_page_idx(folio, pages[0]);
+
+		if (io_coalesce_buffer(&pages, &nr_pages, &data)) {
+			pages[0] = folio_page(folio, 0);
+			off += idx << PAGE_SHIFT;
+			folio_shift = data.folio_shift;
+		}
+	}
+
 	imu = kvmalloc(struct_size(imu, bvec, nr_pages), GFP_KERNEL);
-	if (!imu)
+	if (!imu) {
+		unpin_user_pages(pages, nr_pages);
 		goto done;
+	}
 
 	ret = io_buffer_account_pin(ctx, pages, nr_pages, imu, last_hpage);
 	if (ret) {
@@ -1231,12 +1458,11 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 		goto done;
 	}
 
-	off = (unsigned long) iov->iov_base & ~PAGE_MASK;
 	size = iov->iov_len;
 	for (i = 0; i < nr_pages; i++) {
 		size_t vec_len;
 
-		vec_len = min_t(size_t, size, PAGE_SIZE - off);
+		vec_len = min_t(size_t, size, (1UL << folio_shift) - off);
 		imu->bvec[i].bv_page = pages[i];
 		imu->bvec[i].bv_len = vec_len;
 		imu->bvec[i].bv_offset = off;
@@ -1247,6 +1473,7 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	imu->ubuf = (unsigned long) iov->iov_base;
 	imu->ubuf_end = imu->ubuf + iov->iov_len;
 	imu->nr_bvecs = nr_pages;
+	imu->folio_shift = folio_shift;
 	*pimu = imu;
 	ret = 0;
 done:
@@ -1351,8 +1578,8 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 		 * we know that:
 		 *
 		 * 1) it's a BVEC iter, we set it up
-		 * 2) all bvecs are PAGE_SIZE in size, except potentially the
-		 *    first and last bvec
+		 * 2) all bvecs are 1 << imu->folio_shift in size, except
+		 *    potentially the first and last bvec
 		 *
 		 * So just find our index, and adjust the iterator afterwards.
 		 * If the offset is within the first bvec (or the whole first
@@ -1369,12 +1596,12 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 
 			/* skip first vec */
 			offset -= bvec->bv_len;
-			seg_skip = 1 + (offset >> PAGE_SHIFT);
+			seg_skip = 1 + (offset >> imu->folio_shift);
 
 			iter->bvec = bvec + seg_skip;
 			iter->nr_segs -= seg_skip;
 			iter->count -= bvec->bv_len + offset;
-			iter->iov_offset = offset & ~PAGE_MASK;
+			iter->iov_offset = offset & ((1UL << imu->folio_shift) - 1);
 		}
 	}
 
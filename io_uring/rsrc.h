@@ -49,6 +49,8 @@ struct io_mapped_ubuf {
 	u64		ubuf;
 	u64		ubuf_end;
 	unsigned int	nr_bvecs;
+	/* each bvec but the first and last covers 1 << folio_shift bytes */
+	unsigned int	folio_shift;
 	unsigned long	acct_pages;
 	struct bio_vec	bvec[];
 };
@@ -75,6 +77,7 @@ int io_sqe_buffers_register(struct io_ring_ctx *ctx, void __user *arg,
 			    unsigned int nr_args, u64 __user *tags);
 void __io_sqe_files_unregister(struct io_ring_ctx *ctx);
 int io_sqe_files_unregister(struct io_ring_ctx *ctx);
+int io_sqe_files_clone(struct io_ring_ctx *ctx, void __user *arg);
 int io_sqe_files_register(struct io_ring_ctx *ctx, void __user *arg,
 			  unsigned nr_args, u64 __user *tags);
 
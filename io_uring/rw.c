@@ -174,12 +174,12 @@ static void io_req_task_queue_reissue(struct io_kiocb *req)
 }
 
 #ifdef CONFIG_BLOCK
-static bool io_resubmit_prep(struct io_kiocb *req)
+static bool io_resubmit_prep(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct io_async_rw *io = req->async_data;
 
 	if (!req_has_async_data(req))
-		return !io_req_prep_async(req);
+		return !io_req_prep_async(req, issue_flags);
 	iov_iter_restore(&io->s.iter, &io->s.iter_state);
 	return true;
 }
@@ -210,7 +210,7 @@ static bool io_rw_should_reissue(struct io_kiocb *req)
 	return true;
 }
 #else
-static bool io_resubmit_prep(struct io_kiocb *req)
+static bool io_resubmit_prep(struct io_kiocb *req, unsigned int issue_flags)
 {
 	return false;
 }
@@ -351,7 +351,7 @@ static int kiocb_done(struct io_kiocb *req, ssize_t ret,
 
 	if (req->flags & REQ_F_REISSUE) {
 		req->flags &= ~REQ_F_REISSUE;
-		if (io_resubmit_prep(req))
+		if (io_resubmit_prep(req, issue_flags))
 			io_req_task_queue_reissue(req);
 		else
 			io_req_task_queue_fail(req, final_ret);
@@ -514,14 +514,15 @@ static void io_req_map_rw(struct io_kiocb *req, const struct iovec *iovec,
 }
 
 static int io_setup_async_rw(struct io_kiocb *req, const struct iovec *iovec,
-			     struct io_rw_state *s, bool force)
+			     struct io_rw_state *s, bool force,
+			     unsigned int issue_flags)
 {
 	if (!force && !io_op_defs[req->opcode].prep_async)
 		return 0;
 	if (!req_has_async_data(req)) {
 		struct io_async_rw *iorw;
 
-		if (io_alloc_async_data(req)) {
+		if (io_alloc_async_data(req, issue_flags)) {
 			kfree(iovec);
 			return -ENOMEM;
 		}
@@ -746,7 +747,7 @@ int io_read(struct io_kiocb *req, unsigned int issue_flags)
 	if (force_nonblock) {
 		/* If the file doesn't support async, just async punt */
 		if (unlikely(!io_file_supports_nowait(req))) {
-			ret = io_setup_async_rw(req, iovec, s, true);
+			ret = io_setup_async_rw(req, iovec, s, true, issue_flags);
 			return ret ?: -EAGAIN;
 		}
 		kiocb->ki_flags |= IOCB_NOWAIT;
@@ -794,7 +795,7 @@ int io_read(struct io_kiocb *req, unsigned int issue_flags)
 	 */
 	iov_iter_restore(&s->iter, &s->iter_state);
 
-	ret2 = io_setup_async_rw(req, iovec, s, true);
+	ret2 = io_setup_async_rw(req, iovec, s, true, issue_flags);
 	iovec = NULL;
 	if (ret2) {
 		ret = ret > 0 ? ret : ret2;
@@ -952,7 +953,7 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 			 * the bytes already written.
 			 */
 			iov_iter_save_state(&s->iter, &s->iter_state);
-			ret = io_setup_async_rw(req, iovec, s, true);
+			ret = io_setup_async_rw(req, iovec, s, true, issue_flags);
 
 			io = req->async_data;
 			if (io)
@@ -967,7 +968,7 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 	} else {
 copy_iov:
 		iov_iter_restore(&s->iter, &s->iter_state);
-		ret = io_setup_async_rw(req, iovec, s, false);
+		ret = io_setup_async_rw(req, iovec, s, false, issue_flags);
 		if (!ret) {
 			if (kiocb->ki_flags & IOCB_WRITE)
 				kiocb_end_write(req);
@@ -996,10 +997,29 @@ void io_rw_fail(struct io_kiocb *req)
 	io_req_set_res(req, res, req->cqe.flags);
 }
 
+/*
+ * Number of distinct files io_do_iopoll() remembers as already polled in a
+ * single pass over ->iopoll_list.
+ */
+#define IO_IOPOLL_MAX_FILES	8
+
+static bool io_iopoll_file_polled(struct file **polled, unsigned int nr,
+				  struct file *file)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		if (polled[i] == file)
+			return true;
+	return false;
+}
+
 int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 {
 	struct io_wq_work_node *pos, *start, *prev;
 	unsigned int poll_flags = BLK_POLL_NOSLEEP;
+	struct file *polled[IO_IOPOLL_MAX_FILES];
+	unsigned int nr_polled = 0;
 	DEFINE_IO_COMP_BATCH(iob);
 	int nr_events = 0;
 
@@ -1023,6 +1043,15 @@ int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 		if (READ_ONCE(req->iopoll_completed))
 			break;
 
+		/*
+		 * Polling reaps every completion on the queue backing the
+		 * file, not just the one for this request. If we already
+		 * polled it in this pass and came up empty, don't hit the
+		 * same queue again for every other request that targets it.
+		 */
+		if (io_iopoll_file_polled(polled, nr_polled, file))
+			continue;
+
 		if (req->opcode == IORING_OP_URING_CMD) {
 			struct io_uring_cmd *ioucmd;
 
@@ -1043,6 +1072,9 @@ int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 		if (!rq_list_empty(iob.req_list) ||
 		    READ_ONCE(req->iopoll_completed))
 			break;
+
+		if (nr_polled < IO_IOPOLL_MAX_FILES)
+			polled[nr_polled++] = file;
 	}
 
 	if (!rq_list_empty(iob.req_list))
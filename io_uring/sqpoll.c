@@ -10,6 +10,7 @@
 #include <linux/slab.h>
 #include <linux/audit.h>
 #include <linux/security.h>
+#include <linux/sched/clock.h>
 #include <linux/io_uring.h>
 
 #include <uapi/linux/io_uring.h>
@@ -18,6 +19,11 @@
 #include "sqpoll.h"
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
+/* hot rings may grow their per-pass submit cap up to this */
+#define IORING_SQPOLL_CAP_ENTRIES_MAX	64
+/* after this many idle polls a ring starts getting skipped */
+#define IORING_SQPOLL_IDLE_SHIFT	4
+#define IORING_SQPOLL_MAX_SKIP		16
 
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
@@ -171,8 +177,8 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 
 	to_submit = io_sqring_entries(ctx);
 	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	if (cap_entries && to_submit > ctx->sq_cap)
+		to_submit = ctx->sq_cap;
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
@@ -202,6 +208,44 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	return ret;
 }
 
+/*
+ * With multiple rings attached, rings that keep coming up empty are polled
+ * less and less often, and rings that keep filling their submit cap are
+ * allowed to submit more per pass. Any activity resets a ring back to
+ * being polled every pass.
+ */
+static bool io_sq_ring_skip(struct io_ring_ctx *ctx)
+{
+	if (!ctx->sq_skip_polls)
+		return false;
+	ctx->sq_skip_polls--;
+	return true;
+}
+
+static void io_sq_ring_account(struct io_ring_ctx *ctx, int ret, bool busy,
+			       u64 start)
+{
+	u64 delta = local_clock() - start;
+
+	if (busy) {
+		ctx->sq_busy_time += delta;
+		ctx->sq_idle_polls = 0;
+		ctx->sq_skip_polls = 0;
+		if (ret > 0 && ret >= ctx->sq_cap)
+			ctx->sq_cap = min_t(unsigned int, ctx->sq_cap * 2,
+					    IORING_SQPOLL_CAP_ENTRIES_MAX);
+		else if (ret < IORING_SQPOLL_CAP_ENTRIES_VALUE)
+			ctx->sq_cap = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+		return;
+	}
+
+	ctx->sq_idle_time += delta;
+	ctx->sq_idle_polls++;
+	ctx->sq_cap = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	ctx->sq_skip_polls = min_t(unsigned int, IORING_SQPOLL_MAX_SKIP,
+				   ctx->sq_idle_polls >> IORING_SQPOLL_IDLE_SHIFT);
+}
+
 static bool io_sqd_handle_event(struct io_sq_data *sqd)
 {
 	bool did_sig = false;
@@ -247,9 +291,18 @@ static int io_sq_thread(void *data)
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
 		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
-			int ret = __io_sq_thread(ctx, cap_entries);
-
-			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
+			u64 start;
+			bool busy;
+			int ret;
+
+			if (cap_entries && io_sq_ring_skip(ctx))
+				continue;
+
+			start = local_clock();
+			ret = __io_sq_thread(ctx, cap_entries);
+			busy = ret > 0 || !wq_list_empty(&ctx->iopoll_list);
+			io_sq_ring_account(ctx, ret, busy, start);
+			if (busy)
 				sqt_spin = true;
 		}
 		if (io_run_task_work())
@@ -292,9 +345,12 @@ static int io_sq_thread(void *data)
 				schedule();
 				mutex_lock(&sqd->lock);
 			}
-			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
+			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 				atomic_andnot(IORING_SQ_NEED_WAKEUP,
 						&ctx->rings->sq_flags);
+				/* whoever woke us up must not be skipped */
+				ctx->sq_skip_polls = 0;
+			}
 		}
 
 		finish_wait(&sqd->wait, &wait);
@@ -369,6 +425,7 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
+		ctx->sq_cap = IORING_SQPOLL_CAP_ENTRIES_VALUE;
 
 		io_sq_thread_park(sqd);
 		list_add(&ctx->sqd_list, &sqd->ctx_list);
@@ -483,7 +483,7 @@ static int __io_timeout_prep(struct io_kiocb *req,
 
 	if (WARN_ON_ONCE(req_has_async_data(req)))
 		return -EFAULT;
-	if (io_alloc_async_data(req))
+	if (io_alloc_async_data(req, 0))
 		return -ENOMEM;
 
 	data = req->async_data;
@@ -131,7 +131,7 @@ int io_uring_cmd(struct io_kiocb *req, unsigned int issue_flags)
 	ret = file->f_op->uring_cmd(ioucmd, issue_flags);
 	if (ret == -EAGAIN) {
 		if (!req_has_async_data(req)) {
-			if (io_alloc_async_data(req))
+			if (io_alloc_async_data(req, issue_flags))
 				return -ENOMEM;
 			io_uring_cmd_prep_async(req);
 		}
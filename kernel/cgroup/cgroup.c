@@ -2917,33 +2917,21 @@ int cgroup_attach_task(struct cgroup *dst_cgrp, struct task_struct *leader,
 	return ret;
 }
 
-struct task_struct *cgroup_procs_write_start(char *buf, bool threadgroup,
-					     bool *threadgroup_locked)
+/*
+ * Look up the task or the leader of the process to migrate and get a
+ * reference to it.  Call holding cgroup_mutex and the locks of
+ * cgroup_attach_lock() as needed by @pid and @threadgroup.
+ */
+static struct task_struct *cgroup_procs_find_task(pid_t pid, bool threadgroup)
 {
 	struct task_struct *tsk;
-	pid_t pid;
-
-	if (kstrtoint(strstrip(buf), 0, &pid) || pid < 0)
-		return ERR_PTR(-EINVAL);
-
-	/*
-	 * If we migrate a single thread, we don't care about threadgroup
-	 * stability. If the thread is `current`, it won't exit(2) under our
-	 * hands or change PID through exec(2). We exclude
-	 * cgroup_update_dfl_csses and other cgroup_{proc,thread}s_write
-	 * callers by cgroup_mutex.
-	 * Therefore, we can skip the global lock.
-	 */
-	lockdep_assert_held(&cgroup_mutex);
-	*threadgroup_locked = pid || threadgroup;
-	cgroup_attach_lock(*threadgroup_locked);
 
 	rcu_read_lock();
 	if (pid) {
 		tsk = find_task_by_vpid(pid);
 		if (!tsk) {
 			tsk = ERR_PTR(-ESRCH);
-			goto out_unlock_threadgroup;
+			goto out_unlock_rcu;
 		}
 	} else {
 		tsk = current;
@@ -2960,33 +2948,62 @@ struct task_struct *cgroup_procs_write_start(char *buf, bool threadgroup,
 	 */
 	if (tsk->no_cgroup_migration || (tsk->flags & PF_NO_SETAFFINITY)) {
 		tsk = ERR_PTR(-EINVAL);
-		goto out_unlock_threadgroup;
+		goto out_unlock_rcu;
 	}
 
 	get_task_struct(tsk);
-	goto out_unlock_rcu;
-
-out_unlock_threadgroup:
-	cgroup_attach_unlock(*threadgroup_locked);
-	*threadgroup_locked = false;
 out_unlock_rcu:
 	rcu_read_unlock();
 	return tsk;
 }
 
-void cgroup_procs_write_finish(struct task_struct *task, bool threadgroup_locked)
+struct task_struct *cgroup_procs_write_start(char *buf, bool threadgroup,
+					     bool *threadgroup_locked)
+{
+	struct task_struct *tsk;
+	pid_t pid;
+
+	if (kstrtoint(strstrip(buf), 0, &pid) || pid < 0)
+		return ERR_PTR(-EINVAL);
+
+	/*
+	 * If we migrate a single thread, we don't care about threadgroup
+	 * stability. If the thread is `current`, it won't exit(2) under our
+	 * hands or change PID through exec(2). We exclude
+	 * cgroup_update_dfl_csses and other cgroup_{proc,thread}s_write
+	 * callers by cgroup_mutex.
+	 * Therefore, we can skip the global lock.
+	 */
+	lockdep_assert_held(&cgroup_mutex);
+	*threadgroup_locked = pid || threadgroup;
+	cgroup_attach_lock(*threadgroup_locked);
+
+	tsk = cgroup_procs_find_task(pid, threadgroup);
+	if (IS_ERR(tsk)) {
+		cgroup_attach_unlock(*threadgroup_locked);
+		*threadgroup_locked = false;
+	}
+	return tsk;
+}
+
+static void cgroup_post_attach(void)
 {
 	struct cgroup_subsys *ss;
 	int ssid;
 
+	for_each_subsys(ss, ssid)
+		if (ss->post_attach)
+			ss->post_attach();
+}
+
+void cgroup_procs_write_finish(struct task_struct *task, bool threadgroup_locked)
+{
 	/* release reference from cgroup_procs_write_start() */
 	put_task_struct(task);
 
 	cgroup_attach_unlock(threadgroup_locked);
 
-	for_each_subsys(ss, ssid)
-		if (ss->post_attach)
-			ss->post_attach();
+	cgroup_post_attach();
 }
 
 static void cgroup_print_ss_mask(struct seq_file *seq, u16 ss_mask)
@@ -3681,6 +3698,12 @@ static int cgroup_stat_show(struct seq_file *seq, void *v)
 		   cgroup->nr_descendants);
 	seq_printf(seq, "nr_dying_descendants %d\n",
 		   cgroup->nr_dying_descendants);
+	seq_printf(seq, "rstat_flush_nr %llu\n",
+		   data_race(cgroup->rstat_flush_nr));
+	seq_printf(seq, "rstat_flush_shared %llu\n",
+		   data_race(cgroup->rstat_flush_shared));
+	seq_printf(seq, "rstat_flush_usec %llu\n",
+		   div_u64(data_race(cgroup->rstat_flush_time), NSEC_PER_USEC));
 
 	return 0;
 }
@@ -5122,6 +5145,123 @@ static int cgroup_attach_permissions(struct cgroup *src_cgrp,
 	return ret;
 }
 
+/* The most PIDs a single write to cgroup.procs or cgroup.threads can name */
+#define CGROUP_PROCS_WRITE_MAX	512
+
+/*
+ * Migrate all the processes or threads of a whitespace separated list of
+ * PIDs in one go: cgroup_threadgroup_rwsem is write-locked, and the
+ * controllers' ->can_attach() and ->attach() called, once for the lot
+ * instead of once per PID.  Either all of them are migrated or none is.
+ */
+static ssize_t cgroup_procs_write_batch(struct kernfs_open_file *of,
+					struct cgroup *dst_cgrp, char *buf,
+					bool threadgroup)
+{
+	struct cgroup_file_ctx *ctx = of->priv;
+	DEFINE_CGROUP_MGCTX(mgctx);
+	struct task_struct **tasks, *task, *t;
+	const struct cred *saved_cred;
+	struct cgroup *src_cgrp;
+	int i, nr = 0;
+	ssize_t ret = 0;
+	char *tok;
+	pid_t pid;
+
+	tasks = kcalloc(CGROUP_PROCS_WRITE_MAX, sizeof(*tasks), GFP_KERNEL);
+	if (!tasks)
+		return -ENOMEM;
+
+	cgroup_attach_lock(true);
+
+	while ((tok = strsep(&buf, " \t\n"))) {
+		if (!*tok)
+			continue;
+		if (nr == CGROUP_PROCS_WRITE_MAX) {
+			ret = -E2BIG;
+			goto out_put;
+		}
+		if (kstrtoint(tok, 0, &pid) || pid < 0) {
+			ret = -EINVAL;
+			goto out_put;
+		}
+
+		task = cgroup_procs_find_task(pid, threadgroup);
+		if (IS_ERR(task)) {
+			ret = PTR_ERR(task);
+			goto out_put;
+		}
+
+		/* the same process may be named through several of its threads */
+		for (i = 0; i < nr && tasks[i] != task; i++)
+			;
+		if (i < nr) {
+			put_task_struct(task);
+			continue;
+		}
+		tasks[nr++] = task;
+
+		spin_lock_irq(&css_set_lock);
+		src_cgrp = task_cgroup_from_root(task, &cgrp_dfl_root);
+		spin_unlock_irq(&css_set_lock);
+
+		/* as in __cgroup_procs_write() */
+		saved_cred = override_creds(of->file->f_cred);
+		ret = cgroup_attach_permissions(src_cgrp, dst_cgrp,
+						of->file->f_path.dentry->d_sb,
+						threadgroup, ctx->ns);
+		revert_creds(saved_cred);
+		if (ret)
+			goto out_put;
+	}
+
+	/* look up all src csets */
+	spin_lock_irq(&css_set_lock);
+	rcu_read_lock();
+	for (i = 0; i < nr; i++) {
+		t = tasks[i];
+		do {
+			cgroup_migrate_add_src(task_css_set(t), dst_cgrp, &mgctx);
+			if (!threadgroup)
+				break;
+		} while_each_thread(tasks[i], t);
+	}
+	rcu_read_unlock();
+	spin_unlock_irq(&css_set_lock);
+
+	/* prepare dst csets and commit */
+	ret = cgroup_migrate_prepare_dst(&mgctx);
+	if (!ret) {
+		spin_lock_irq(&css_set_lock);
+		for (i = 0; i < nr; i++) {
+			t = tasks[i];
+			do {
+				cgroup_migrate_add_task(t, &mgctx);
+				if (!threadgroup)
+					break;
+			} while_each_thread(tasks[i], t);
+		}
+		spin_unlock_irq(&css_set_lock);
+
+		ret = cgroup_migrate_execute(&mgctx);
+	}
+
+	cgroup_migrate_finish(&mgctx);
+
+	if (!ret)
+		for (i = 0; i < nr; i++)
+			TRACE_CGROUP_PATH(attach_task, dst_cgrp, tasks[i],
+					  threadgroup);
+
+out_put:
+	for (i = 0; i < nr; i++)
+		put_task_struct(tasks[i]);
+	cgroup_attach_unlock(true);
+	cgroup_post_attach();
+	kfree(tasks);
+	return ret;
+}
+
 static ssize_t __cgroup_procs_write(struct kernfs_open_file *of, char *buf,
 				    bool threadgroup)
 {
@@ -5136,6 +5276,13 @@ static ssize_t __cgroup_procs_write(struct kernfs_open_file *of, char *buf,
 	if (!dst_cgrp)
 		return -ENODEV;
 
+	/* more than one PID */
+	buf = strstrip(buf);
+	if (strpbrk(buf, " \t\n")) {
+		ret = cgroup_procs_write_batch(of, dst_cgrp, buf, threadgroup);
+		goto out_unlock;
+	}
+
 	task = cgroup_procs_write_start(buf, threadgroup, &threadgroup_locked);
 	ret = PTR_ERR_OR_ZERO(task);
 	if (ret)
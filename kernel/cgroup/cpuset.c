@@ -791,6 +791,18 @@ static int validate_change(struct cpuset *cur, struct cpuset *trial)
 	return ret;
 }
 
+/*
+ * Sched domain rebuilds asked for, those found not to change anything, and
+ * the time spent in the others.  Protected by cpuset_rwsem.
+ */
+static struct {
+	u64 nr;
+	u64 nr_skipped;
+	u64 time_ns;
+	u64 last_ns;
+	u64 max_ns;
+} sched_domains_stat;
+
 #ifdef CONFIG_SMP
 /*
  * Helper routine for generate_sched_domains().
@@ -1115,6 +1127,78 @@ static void rebuild_root_domains(void)
 	rcu_read_unlock();
 }
 
+/*
+ * A copy of the sched domains cpuset last had the scheduler build, so that a
+ * change to the cpusets that leaves them as they are doesn't tear down and
+ * rebuild the root domains of every CPU.  Not valid after the scheduler may
+ * have built domains of its own, e.g. around CPU hotplug, or when asked to
+ * rebuild from outside cpuset.  Protected by cpuset_rwsem.
+ */
+static cpumask_var_t *doms_cur;
+static struct sched_domain_attr *dattr_cur;
+static int ndoms_cur;
+
+static void invalidate_sched_domains_copy(void)
+{
+	if (doms_cur)
+		free_sched_domains(doms_cur, ndoms_cur);
+	kfree(dattr_cur);
+	doms_cur = NULL;
+	dattr_cur = NULL;
+	ndoms_cur = 0;
+}
+
+static int dattr_relax_level(struct sched_domain_attr *dattr, int i)
+{
+	return dattr ? dattr[i].relax_domain_level : -1;
+}
+
+static bool sched_domains_unchanged(int ndoms, cpumask_var_t doms[],
+				    struct sched_domain_attr *dattr)
+{
+	int i, j;
+
+	if (!doms || !doms_cur || ndoms != ndoms_cur)
+		return false;
+
+	for (i = 0; i < ndoms; i++) {
+		for (j = 0; j < ndoms_cur; j++) {
+			if (cpumask_equal(doms[i], doms_cur[j]) &&
+			    dattr_relax_level(dattr, i) ==
+			    dattr_relax_level(dattr_cur, j))
+				break;
+		}
+		if (j == ndoms_cur)
+			return false;
+	}
+	return true;
+}
+
+static void copy_sched_domains(int ndoms, cpumask_var_t doms[],
+			       struct sched_domain_attr *dattr)
+{
+	int i;
+
+	invalidate_sched_domains_copy();
+	if (!doms)
+		return;
+
+	doms_cur = alloc_sched_domains(ndoms);
+	if (!doms_cur)
+		return;
+	if (dattr) {
+		dattr_cur = kmemdup(dattr, ndoms * sizeof(*dattr), GFP_KERNEL);
+		if (!dattr_cur) {
+			free_sched_domains(doms_cur, ndoms);
+			doms_cur = NULL;
+			return;
+		}
+	}
+	for (i = 0; i < ndoms; i++)
+		cpumask_copy(doms_cur[i], doms[i]);
+	ndoms_cur = ndoms;
+}
+
 static void
 partition_and_rebuild_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
 				    struct sched_domain_attr *dattr_new)
@@ -1143,6 +1227,7 @@ static void rebuild_sched_domains_locked(void)
 	cpumask_var_t *doms;
 	struct cpuset *cs;
 	int ndoms;
+	u64 start, delta;
 
 	lockdep_assert_cpus_held();
 	percpu_rwsem_assert_held(&cpuset_rwsem);
@@ -1184,19 +1269,45 @@ static void rebuild_sched_domains_locked(void)
 	/* Generate domain masks and attrs */
 	ndoms = generate_sched_domains(&doms, &attr);
 
+	sched_domains_stat.nr++;
+	if (sched_domains_unchanged(ndoms, doms, attr)) {
+		sched_domains_stat.nr_skipped++;
+		free_sched_domains(doms, ndoms);
+		kfree(attr);
+		return;
+	}
+
+	/* The scheduler takes ownership of doms and attr */
+	copy_sched_domains(ndoms, doms, attr);
+
 	/* Have scheduler rebuild the domains */
+	start = ktime_get_ns();
 	partition_and_rebuild_sched_domains(ndoms, doms, attr);
+	delta = ktime_get_ns() - start;
+
+	sched_domains_stat.time_ns += delta;
+	sched_domains_stat.last_ns = delta;
+	sched_domains_stat.max_ns = max(sched_domains_stat.max_ns, delta);
 }
 #else /* !CONFIG_SMP */
 static void rebuild_sched_domains_locked(void)
 {
 }
+
+static void invalidate_sched_domains_copy(void)
+{
+}
 #endif /* CONFIG_SMP */
 
+/*
+ * Rebuild the sched domains even if the cpusets didn't change them: this is
+ * called after CPU hotplug and by architectures whose topology flags changed.
+ */
 void rebuild_sched_domains(void)
 {
 	cpus_read_lock();
 	percpu_down_write(&cpuset_rwsem);
+	invalidate_sched_domains_copy();
 	rebuild_sched_domains_locked();
 	percpu_up_write(&cpuset_rwsem);
 	cpus_read_unlock();
@@ -2804,6 +2915,21 @@ static int cpuset_common_seq_show(struct seq_file *sf, void *v)
 	return ret;
 }
 
+static int sched_domains_stat_show(struct seq_file *sf, void *v)
+{
+	percpu_down_read(&cpuset_rwsem);
+	seq_printf(sf, "rebuilds %llu\n", sched_domains_stat.nr);
+	seq_printf(sf, "rebuilds_skipped %llu\n", sched_domains_stat.nr_skipped);
+	seq_printf(sf, "rebuild_usec %llu\n",
+		   div_u64(sched_domains_stat.time_ns, NSEC_PER_USEC));
+	seq_printf(sf, "last_rebuild_usec %llu\n",
+		   div_u64(sched_domains_stat.last_ns, NSEC_PER_USEC));
+	seq_printf(sf, "max_rebuild_usec %llu\n",
+		   div_u64(sched_domains_stat.max_ns, NSEC_PER_USEC));
+	percpu_up_read(&cpuset_rwsem);
+	return 0;
+}
+
 static u64 cpuset_read_u64(struct cgroup_subsys_state *css, struct cftype *cft)
 {
 	struct cpuset *cs = css_cs(css);
@@ -3073,6 +3199,12 @@ static struct cftype dfl_files[] = {
 		.flags = CFTYPE_DEBUG,
 	},
 
+	{
+		.name = "sched_domains.stat",
+		.seq_show = sched_domains_stat_show,
+		.flags = CFTYPE_ONLY_ON_ROOT,
+	},
+
 	{ }	/* terminate */
 };
 
@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: GPL-2.0-only
 #include "cgroup-internal.h"
 
+#include <linux/sched/clock.h>
 #include <linux/sched/cputime.h>
+#include <linux/moduleparam.h>
 
 #include <linux/bpf.h>
 #include <linux/btf.h>
@@ -10,6 +12,27 @@
 static DEFINE_SPINLOCK(cgroup_rstat_lock);
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
 
+/*
+ * Flushes are numbered as they start.  The last one to get through all CPUs
+ * is remembered so that a flush that was waiting for cgroup_rstat_lock can
+ * be skipped if that one started after it and covered its subtree: all the
+ * updates it had to flush have been.  All protected by cgroup_rstat_lock.
+ */
+static unsigned long cgroup_rstat_flush_seq;
+static struct {
+	unsigned long seq;
+	unsigned long start;		/* jiffies */
+	struct cgroup *root;
+	int level;
+} cgroup_rstat_last_flush;
+
+/*
+ * Also skip flushes of a subtree flushed less than this many milliseconds
+ * ago, trading staleness of the stats for less time under the lock.
+ */
+static unsigned int cgroup_rstat_flush_delay_ms;
+core_param(cgroup_rstat_flush_delay_ms, cgroup_rstat_flush_delay_ms, uint, 0644);
+
 static void cgroup_base_stat_flush(struct cgroup *cgrp, int cpu);
 
 static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
@@ -218,6 +241,58 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 	}
 }
 
+/* Did the last complete flush cover @cgrp, for a caller that came at @seq? */
+static bool cgroup_rstat_flush_covered(struct cgroup *cgrp, unsigned long seq)
+{
+	unsigned int delay_ms = READ_ONCE(cgroup_rstat_flush_delay_ms);
+
+	lockdep_assert_held(&cgroup_rstat_lock);
+
+	if (!cgroup_rstat_last_flush.root ||
+	    cgroup_ancestor(cgrp, cgroup_rstat_last_flush.level) !=
+	    cgroup_rstat_last_flush.root)
+		return false;
+
+	if ((long)(cgroup_rstat_last_flush.seq - seq) > 0)
+		return true;
+
+	return delay_ms && time_before(jiffies, cgroup_rstat_last_flush.start +
+				       msecs_to_jiffies(delay_ms));
+}
+
+/*
+ * cgroup_rstat_flush_locked() unless a flush which started after the caller
+ * read @seq, or a recent enough one, already did the job.  The time spent is
+ * accounted to @cgrp.
+ */
+static void cgroup_rstat_flush_shared(struct cgroup *cgrp, bool may_sleep,
+				      unsigned long seq)
+{
+	unsigned long start = jiffies;
+	u64 now;
+
+	lockdep_assert_held(&cgroup_rstat_lock);
+
+	if (cgroup_rstat_flush_covered(cgrp, seq)) {
+		cgrp->rstat_flush_shared++;
+		return;
+	}
+
+	seq = ++cgroup_rstat_flush_seq;
+	now = local_clock();
+	cgroup_rstat_flush_locked(cgrp, may_sleep);
+	cgrp->rstat_flush_nr++;
+	cgrp->rstat_flush_time += local_clock() - now;
+
+	/* Another flush may have started and completed while we yielded */
+	if ((long)(seq - cgroup_rstat_last_flush.seq) > 0) {
+		cgroup_rstat_last_flush.seq = seq;
+		cgroup_rstat_last_flush.start = start;
+		cgroup_rstat_last_flush.root = cgrp;
+		cgroup_rstat_last_flush.level = cgrp->level;
+	}
+}
+
 /**
  * cgroup_rstat_flush - flush stats in @cgrp's subtree
  * @cgrp: target cgroup
@@ -229,14 +304,19 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
  * This also gets all cgroups in the subtree including @cgrp off the
  * ->updated_children lists.
  *
+ * Callers that find a flush in flight share its result if it covers their
+ * subtree, and so do those within cgroup_rstat_flush_delay_ms of one.
+ *
  * This function may block.
  */
 void cgroup_rstat_flush(struct cgroup *cgrp)
 {
+	unsigned long seq = READ_ONCE(cgroup_rstat_flush_seq);
+
 	might_sleep();
 
 	spin_lock_irq(&cgroup_rstat_lock);
-	cgroup_rstat_flush_locked(cgrp, true);
+	cgroup_rstat_flush_shared(cgrp, true, seq);
 	spin_unlock_irq(&cgroup_rstat_lock);
 }
 
@@ -248,10 +328,11 @@ void cgroup_rstat_flush(struct cgroup *cgrp)
  */
 void cgroup_rstat_flush_irqsafe(struct cgroup *cgrp)
 {
+	unsigned long seq = READ_ONCE(cgroup_rstat_flush_seq);
 	unsigned long flags;
 
 	spin_lock_irqsave(&cgroup_rstat_lock, flags);
-	cgroup_rstat_flush_locked(cgrp, false);
+	cgroup_rstat_flush_shared(cgrp, false, seq);
 	spin_unlock_irqrestore(&cgroup_rstat_lock, flags);
 }
 
@@ -267,9 +348,11 @@ void cgroup_rstat_flush_irqsafe(struct cgroup *cgrp)
 void cgroup_rstat_flush_hold(struct cgroup *cgrp)
 	__acquires(&cgroup_rstat_lock)
 {
+	unsigned long seq = READ_ONCE(cgroup_rstat_flush_seq);
+
 	might_sleep();
 	spin_lock_irq(&cgroup_rstat_lock);
-	cgroup_rstat_flush_locked(cgrp, true);
+	cgroup_rstat_flush_shared(cgrp, true, seq);
 }
 
 /**
@@ -307,7 +390,12 @@ void cgroup_rstat_exit(struct cgroup *cgrp)
 {
 	int cpu;
 
-	cgroup_rstat_flush(cgrp);
+	/* @cgrp must come off all updated lists, don't skip */
+	spin_lock_irq(&cgroup_rstat_lock);
+	cgroup_rstat_flush_locked(cgrp, true);
+	if (cgroup_rstat_last_flush.root == cgrp)
+		cgroup_rstat_last_flush.root = NULL;
+	spin_unlock_irq(&cgroup_rstat_lock);
 
 	/* sanity check */
 	for_each_possible_cpu(cpu) {
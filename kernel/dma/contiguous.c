@@ -50,6 +50,8 @@
 #include <linux/sizes.h>
 #include <linux/dma-map-ops.h>
 #include <linux/cma.h>
+#include <linux/genalloc.h>
+#include <linux/workqueue.h>
 
 #ifdef CONFIG_CMA_SIZE_MBYTES
 #define CMA_SIZE_MBYTES CONFIG_CMA_SIZE_MBYTES
@@ -109,6 +111,36 @@ static int __init early_cma_pernuma(char *p)
 early_param("cma_pernuma", early_cma_pernuma);
 #endif
 
+/*
+ * Allocating from a CMA area migrates the pages in the range out first, on
+ * the allocating thread, which takes long for large buffers.  With
+ * cma_warm=size, that much of the default and of each per-numa area is
+ * allocated in the background after boot, and dma_alloc_contiguous() carves
+ * buffers out of these "warm" ranges before falling back to cma_alloc().
+ * Buffers freed to a warm range stay allocated from CMA, ready for the next
+ * user.
+ */
+struct dma_cma_warm {
+	struct cma *cma;
+	struct gen_pool *pool;
+	struct work_struct work;
+	int nid;
+};
+
+static phys_addr_t warm_size_bytes __ro_after_init;
+static struct dma_cma_warm dma_cma_warm_default;
+
+static int __init early_cma_warm(char *p)
+{
+	warm_size_bytes = memparse(p, &p);
+	return 0;
+}
+early_param("cma_warm", early_cma_warm);
+
+#ifdef CONFIG_DMA_PERNUMA_CMA
+static struct dma_cma_warm dma_cma_warm_pernuma[MAX_NUMNODES];
+#endif
+
 #ifdef CONFIG_CMA_SIZE_PERCENTAGE
 
 static phys_addr_t __init __maybe_unused cma_early_percent_memory(void)
@@ -286,6 +318,38 @@ static struct page *cma_alloc_aligned(struct cma *cma, size_t size, gfp_t gfp)
 	return cma_alloc(cma, size >> PAGE_SHIFT, align, gfp & __GFP_NOWARN);
 }
 
+static struct page *dma_cma_alloc(struct dma_cma_warm *warm, struct cma *cma,
+				  size_t size, gfp_t gfp)
+{
+	struct genpool_data_align data;
+	unsigned long phys;
+
+	if (warm->pool) {
+		data.align = PAGE_SIZE << min(get_order(size),
+					      CONFIG_CMA_ALIGNMENT);
+		phys = gen_pool_alloc_algo(warm->pool, PAGE_ALIGN(size),
+					   gen_pool_first_fit_align, &data);
+		if (phys)
+			return phys_to_page(phys);
+	}
+
+	return cma_alloc_aligned(cma, size, gfp);
+}
+
+static bool dma_cma_release(struct dma_cma_warm *warm, struct cma *cma,
+			    struct page *page, unsigned int count)
+{
+	unsigned long phys = page_to_phys(page);
+	size_t size = (size_t)count << PAGE_SHIFT;
+
+	if (warm->pool && gen_pool_has_addr(warm->pool, phys, size)) {
+		gen_pool_free(warm->pool, phys, size);
+		return true;
+	}
+
+	return cma_release(cma, page, count);
+}
+
 /**
  * dma_alloc_contiguous() - allocate contiguous pages
  * @dev:   Pointer to device for which the allocation is performed.
@@ -294,7 +358,8 @@ static struct page *cma_alloc_aligned(struct cma *cma, size_t size, gfp_t gfp)
  *
  * tries to use device specific contiguous memory area if available, or it
  * tries to use per-numa cma, if the allocation fails, it will fallback to
- * try default global one.
+ * try default global one.  The warm ranges of the per-numa and global areas
+ * are tried before the rest of the area, see cma_warm=.
  *
  * Note that it bypass one-page size of allocations from the per-numa and
  * global area as the addresses within one page are always contiguous, so
@@ -321,7 +386,8 @@ struct page *dma_alloc_contiguous(struct device *dev, size_t size, gfp_t gfp)
 		struct page *page;
 
 		if (cma) {
-			page = cma_alloc_aligned(cma, size, gfp);
+			page = dma_cma_alloc(&dma_cma_warm_pernuma[nid], cma,
+					     size, gfp);
 			if (page)
 				return page;
 		}
@@ -330,7 +396,8 @@ struct page *dma_alloc_contiguous(struct device *dev, size_t size, gfp_t gfp)
 	if (!dma_contiguous_default_area)
 		return NULL;
 
-	return cma_alloc_aligned(dma_contiguous_default_area, size, gfp);
+	return dma_cma_alloc(&dma_cma_warm_default,
+			     dma_contiguous_default_area, size, gfp);
 }
 
 /**
@@ -357,11 +424,15 @@ void dma_free_contiguous(struct device *dev, struct page *page, size_t size)
 		 * otherwise, page is from either per-numa cma or default cma
 		 */
 #ifdef CONFIG_DMA_PERNUMA_CMA
-		if (cma_release(dma_contiguous_pernuma_area[page_to_nid(page)],
-					page, count))
+		int nid = page_to_nid(page);
+
+		if (dma_cma_release(&dma_cma_warm_pernuma[nid],
+				    dma_contiguous_pernuma_area[nid],
+				    page, count))
 			return;
 #endif
-		if (cma_release(dma_contiguous_default_area, page, count))
+		if (dma_cma_release(&dma_cma_warm_default,
+				    dma_contiguous_default_area, page, count))
 			return;
 	}
 
@@ -369,6 +440,83 @@ void dma_free_contiguous(struct device *dev, struct page *page, size_t size)
 	__free_pages(page, get_order(size));
 }
 
+static void dma_cma_warm_fill(struct work_struct *work)
+{
+	struct dma_cma_warm *warm = container_of(work, struct dma_cma_warm,
+						 work);
+	size_t left, size, chunk;
+	struct page *page;
+
+	left = ALIGN_DOWN(min_t(phys_addr_t, warm_size_bytes,
+				cma_get_size(warm->cma)),
+			  CMA_MIN_ALIGNMENT_BYTES);
+	chunk = left;
+
+	/*
+	 * Take the range in one piece if possible.  Pinned pages can make the
+	 * migration fail, so retry with smaller chunks down to a pageblock.
+	 */
+	while (left && chunk) {
+		size = min(chunk, left);
+		page = cma_alloc(warm->cma, size >> PAGE_SHIFT,
+				 min(get_order(size), CONFIG_CMA_ALIGNMENT),
+				 true);
+		if (!page) {
+			chunk = ALIGN_DOWN(chunk / 2, CMA_MIN_ALIGNMENT_BYTES);
+			continue;
+		}
+		if (gen_pool_add(warm->pool, page_to_phys(page), size,
+				 warm->nid)) {
+			cma_release(warm->cma, page, size >> PAGE_SHIFT);
+			break;
+		}
+		left -= size;
+		cond_resched();
+	}
+
+	pr_info("%s: %zu MiB kept warm\n", cma_get_name(warm->cma),
+		(size_t)gen_pool_size(warm->pool) / SZ_1M);
+}
+
+static void __init dma_cma_warm_start(struct dma_cma_warm *warm,
+				      struct cma *cma, int nid)
+{
+	if (!cma)
+		return;
+
+	warm->pool = gen_pool_create(PAGE_SHIFT, nid);
+	if (!warm->pool)
+		return;
+	warm->cma = cma;
+	warm->nid = nid;
+	INIT_WORK(&warm->work, dma_cma_warm_fill);
+	queue_work(system_unbound_wq, &warm->work);
+}
+
+/*
+ * After the CMA areas are activated, but before devices start allocating
+ * from them.  The gen_pool hands out physical addresses as unsigned long.
+ */
+static int __init dma_cma_warm_init(void)
+{
+	int nid __maybe_unused;
+
+	if (!warm_size_bytes)
+		return 0;
+	if (sizeof(phys_addr_t) > sizeof(unsigned long))
+		return 0;
+
+#ifdef CONFIG_DMA_PERNUMA_CMA
+	for_each_online_node(nid)
+		dma_cma_warm_start(&dma_cma_warm_pernuma[nid],
+				   dma_contiguous_pernuma_area[nid], nid);
+#endif
+	dma_cma_warm_start(&dma_cma_warm_default, dma_contiguous_default_area,
+			   NUMA_NO_NODE);
+	return 0;
+}
+postcore_initcall(dma_cma_warm_init);
+
 /*
  * Support for reserved memory regions defined in device tree
  */
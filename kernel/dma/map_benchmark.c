@@ -16,6 +16,7 @@
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
 
@@ -29,20 +30,59 @@ struct map_benchmark_data {
 	atomic64_t sum_sq_map;
 	atomic64_t sum_sq_unmap;
 	atomic64_t loops;
+	atomic64_t map_hist[DMA_MAP_HIST_BUCKETS];
+	atomic64_t unmap_hist[DMA_MAP_HIST_BUCKETS];
 };
 
+static void map_benchmark_hist_add(atomic64_t *hist, u64 val_100ns)
+{
+	atomic64_inc(&hist[min_t(u64, val_100ns, DMA_MAP_HIST_BUCKETS - 1)]);
+}
+
+/* Smallest latency in 100ns that at least @permille of the loops did not exceed */
+static u64 map_benchmark_percentile(atomic64_t *hist, u64 loops,
+				    unsigned int permille)
+{
+	u64 rank = max_t(u64, DIV_ROUND_UP_ULL(loops * permille, 1000), 1);
+	u64 count = 0;
+	int i;
+
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS - 1; i++) {
+		count += atomic64_read(&hist[i]);
+		if (count >= rank)
+			break;
+	}
+	return i;
+}
+
 static int map_benchmark_thread(void *data)
 {
-	void *buf;
-	dma_addr_t dma_addr;
+	void *buf = NULL;
+	void *cpu_addr = NULL;
+	dma_addr_t dma_addr = 0;
 	struct map_benchmark_data *map = data;
 	int npages = map->bparam.granule;
 	u64 size = npages * PAGE_SIZE;
+	unsigned int mode = map->bparam.mode;
+	unsigned int nents = mode == DMA_MAP_BENCH_SG ? map->bparam.nents : 1;
+	struct scatterlist *sg;
+	struct sg_table sgt;
 	int ret = 0;
+	int i;
 
-	buf = alloc_pages_exact(size, GFP_KERNEL);
-	if (!buf)
-		return -ENOMEM;
+	if (mode != DMA_MAP_BENCH_COHERENT) {
+		buf = alloc_pages_exact(size * nents, GFP_KERNEL);
+		if (!buf)
+			return -ENOMEM;
+	}
+
+	if (mode == DMA_MAP_BENCH_SG) {
+		ret = sg_alloc_table(&sgt, nents, GFP_KERNEL);
+		if (ret)
+			goto out_free;
+		for_each_sg(sgt.sgl, sg, nents, i)
+			sg_set_buf(sg, buf + i * size, size);
+	}
 
 	while (!kthread_should_stop())  {
 		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
@@ -55,14 +95,27 @@ static int map_benchmark_thread(void *data)
 		 * overhead of BIDIRECTIONAL or TO_DEVICE mappings;
 		 * 66 means evertything goes well! 66 is lucky.
 		 */
-		if (map->dir != DMA_FROM_DEVICE)
-			memset(buf, 0x66, size);
+		if (buf && map->dir != DMA_FROM_DEVICE)
+			memset(buf, 0x66, size * nents);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
+		switch (mode) {
+		case DMA_MAP_BENCH_SINGLE:
+			dma_addr = dma_map_single(map->dev, buf, size, map->dir);
+			ret = dma_mapping_error(map->dev, dma_addr);
+			break;
+		case DMA_MAP_BENCH_SG:
+			ret = dma_map_sg(map->dev, sgt.sgl, nents, map->dir) ?
+			      0 : -ENOMEM;
+			break;
+		case DMA_MAP_BENCH_COHERENT:
+			cpu_addr = dma_alloc_coherent(map->dev, size, &dma_addr,
+						      GFP_KERNEL);
+			ret = cpu_addr ? 0 : -ENOMEM;
+			break;
+		}
+		if (unlikely(ret)) {
+			pr_err("dma map failed on %s\n", dev_name(map->dev));
 			ret = -ENOMEM;
 			goto out;
 		}
@@ -73,7 +126,17 @@ static int map_benchmark_thread(void *data)
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		switch (mode) {
+		case DMA_MAP_BENCH_SINGLE:
+			dma_unmap_single(map->dev, dma_addr, size, map->dir);
+			break;
+		case DMA_MAP_BENCH_SG:
+			dma_unmap_sg(map->dev, sgt.sgl, nents, map->dir);
+			break;
+		case DMA_MAP_BENCH_COHERENT:
+			dma_free_coherent(map->dev, size, cpu_addr, dma_addr);
+			break;
+		}
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -88,11 +151,17 @@ static int map_benchmark_thread(void *data)
 		atomic64_add(unmap_100ns, &map->sum_unmap_100ns);
 		atomic64_add(map_sq, &map->sum_sq_map);
 		atomic64_add(unmap_sq, &map->sum_sq_unmap);
+		map_benchmark_hist_add(map->map_hist, map_100ns);
+		map_benchmark_hist_add(map->unmap_hist, unmap_100ns);
 		atomic64_inc(&map->loops);
 	}
 
 out:
-	free_pages_exact(buf, size);
+	if (mode == DMA_MAP_BENCH_SG)
+		sg_free_table(&sgt);
+out_free:
+	if (buf)
+		free_pages_exact(buf, size * nents);
 	return ret;
 }
 
@@ -131,6 +200,10 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	atomic64_set(&map->sum_sq_map, 0);
 	atomic64_set(&map->sum_sq_unmap, 0);
 	atomic64_set(&map->loops, 0);
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		atomic64_set(&map->map_hist[i], 0);
+		atomic64_set(&map->unmap_hist[i], 0);
+	}
 
 	for (i = 0; i < threads; i++) {
 		get_task_struct(tsk[i]);
@@ -167,6 +240,20 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 				map->bparam.avg_unmap_100ns;
 		map->bparam.map_stddev = int_sqrt64(map_variance);
 		map->bparam.unmap_stddev = int_sqrt64(unmap_variance);
+
+		/* latency percentiles */
+		map->bparam.map_p50_100ns =
+			map_benchmark_percentile(map->map_hist, loops, 500);
+		map->bparam.map_p99_100ns =
+			map_benchmark_percentile(map->map_hist, loops, 990);
+		map->bparam.map_p999_100ns =
+			map_benchmark_percentile(map->map_hist, loops, 999);
+		map->bparam.unmap_p50_100ns =
+			map_benchmark_percentile(map->unmap_hist, loops, 500);
+		map->bparam.unmap_p99_100ns =
+			map_benchmark_percentile(map->unmap_hist, loops, 990);
+		map->bparam.unmap_p999_100ns =
+			map_benchmark_percentile(map->unmap_hist, loops, 999);
 	}
 
 out:
@@ -218,6 +305,23 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		switch (map->bparam.mode) {
+		case DMA_MAP_BENCH_SINGLE:
+		case DMA_MAP_BENCH_COHERENT:
+			break;
+		case DMA_MAP_BENCH_SG:
+			if (map->bparam.nents < 1 ||
+			    map->bparam.nents > DMA_MAP_MAX_NENTS ||
+			    map->bparam.nents * map->bparam.granule > 1024) {
+				pr_err("invalid number of segments\n");
+				return -EINVAL;
+			}
+			break;
+		default:
+			pr_err("invalid benchmark mode\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -20,6 +20,14 @@ static unsigned long pool_size_dma32;
 static struct gen_pool *atomic_pool_kernel __ro_after_init;
 static unsigned long pool_size_kernel;
 
+/*
+ * Per-node GFP_KERNEL pools.  They start out empty and are grown on demand
+ * for the nodes that devices allocating from the atomic pools sit on.
+ */
+static struct gen_pool **atomic_pool_node __ro_after_init;
+static unsigned long *pool_size_node;
+static nodemask_t atomic_pool_node_grow;
+
 /* Size can be defined by the coherent_pool command line */
 static size_t atomic_pool_size;
 
@@ -36,16 +44,29 @@ early_param("coherent_pool", early_coherent_pool);
 static void __init dma_atomic_pool_debugfs_init(void)
 {
 	struct dentry *root;
+	char name[24];
+	int nid;
 
 	root = debugfs_create_dir("dma_pools", NULL);
 	debugfs_create_ulong("pool_size_dma", 0400, root, &pool_size_dma);
 	debugfs_create_ulong("pool_size_dma32", 0400, root, &pool_size_dma32);
 	debugfs_create_ulong("pool_size_kernel", 0400, root, &pool_size_kernel);
+
+	if (!atomic_pool_node)
+		return;
+	for_each_node_state(nid, N_MEMORY) {
+		if (!atomic_pool_node[nid])
+			continue;
+		snprintf(name, sizeof(name), "pool_size_node%d", nid);
+		debugfs_create_ulong(name, 0400, root, &pool_size_node[nid]);
+	}
 }
 
-static void dma_atomic_pool_size_add(gfp_t gfp, size_t size)
+static void dma_atomic_pool_size_add(gfp_t gfp, size_t size, int nid)
 {
-	if (gfp & __GFP_DMA)
+	if (nid != NUMA_NO_NODE)
+		pool_size_node[nid] += size;
+	else if (gfp & __GFP_DMA)
 		pool_size_dma += size;
 	else if (gfp & __GFP_DMA32)
 		pool_size_dma32 += size;
@@ -77,7 +98,7 @@ static bool cma_in_zone(gfp_t gfp)
 }
 
 static int atomic_pool_expand(struct gen_pool *pool, size_t pool_size,
-			      gfp_t gfp)
+			      gfp_t gfp, int nid)
 {
 	unsigned int order;
 	struct page *page = NULL;
@@ -89,10 +110,13 @@ static int atomic_pool_expand(struct gen_pool *pool, size_t pool_size,
 
 	do {
 		pool_size = 1 << (PAGE_SHIFT + order);
-		if (cma_in_zone(gfp))
+		if (nid != NUMA_NO_NODE)
+			page = alloc_pages_node(nid, gfp | __GFP_THISNODE |
+						__GFP_NOWARN, order);
+		else if (cma_in_zone(gfp))
 			page = dma_alloc_from_contiguous(NULL, 1 << order,
 							 order, false);
-		if (!page)
+		if (!page && nid == NUMA_NO_NODE)
 			page = alloc_pages(gfp, order);
 	} while (!page && order-- > 0);
 	if (!page)
@@ -118,11 +142,11 @@ static int atomic_pool_expand(struct gen_pool *pool, size_t pool_size,
 	if (ret)
 		goto remove_mapping;
 	ret = gen_pool_add_virt(pool, (unsigned long)addr, page_to_phys(page),
-				pool_size, NUMA_NO_NODE);
+				pool_size, nid);
 	if (ret)
 		goto encrypt_mapping;
 
-	dma_atomic_pool_size_add(gfp, pool_size);
+	dma_atomic_pool_size_add(gfp, pool_size, nid);
 	return 0;
 
 encrypt_mapping:
@@ -142,21 +166,29 @@ free_page: __maybe_unused
 	return ret;
 }
 
-static void atomic_pool_resize(struct gen_pool *pool, gfp_t gfp)
+static void atomic_pool_resize(struct gen_pool *pool, gfp_t gfp, int nid)
 {
 	if (pool && gen_pool_avail(pool) < atomic_pool_size)
-		atomic_pool_expand(pool, gen_pool_size(pool), gfp);
+		atomic_pool_expand(pool, max_t(size_t, gen_pool_size(pool),
+					       atomic_pool_size), gfp, nid);
 }
 
 static void atomic_pool_work_fn(struct work_struct *work)
 {
+	int nid;
+
 	if (IS_ENABLED(CONFIG_ZONE_DMA))
 		atomic_pool_resize(atomic_pool_dma,
-				   GFP_KERNEL | GFP_DMA);
+				   GFP_KERNEL | GFP_DMA, NUMA_NO_NODE);
 	if (IS_ENABLED(CONFIG_ZONE_DMA32))
 		atomic_pool_resize(atomic_pool_dma32,
-				   GFP_KERNEL | GFP_DMA32);
-	atomic_pool_resize(atomic_pool_kernel, GFP_KERNEL);
+				   GFP_KERNEL | GFP_DMA32, NUMA_NO_NODE);
+	atomic_pool_resize(atomic_pool_kernel, GFP_KERNEL, NUMA_NO_NODE);
+
+	for_each_node_mask(nid, atomic_pool_node_grow) {
+		node_clear(nid, atomic_pool_node_grow);
+		atomic_pool_resize(atomic_pool_node[nid], GFP_KERNEL, nid);
+	}
 }
 
 static __init struct gen_pool *__dma_atomic_pool_init(size_t pool_size,
@@ -171,7 +203,7 @@ static __init struct gen_pool *__dma_atomic_pool_init(size_t pool_size,
 
 	gen_pool_set_algo(pool, gen_pool_first_fit_order_align, NULL);
 
-	ret = atomic_pool_expand(pool, pool_size, gfp);
+	ret = atomic_pool_expand(pool, pool_size, gfp, NUMA_NO_NODE);
 	if (ret) {
 		gen_pool_destroy(pool);
 		pr_err("DMA: failed to allocate %zu KiB %pGg pool for atomic allocation\n",
@@ -184,6 +216,34 @@ static __init struct gen_pool *__dma_atomic_pool_init(size_t pool_size,
 	return pool;
 }
 
+static void __init dma_atomic_pool_node_init(void)
+{
+	struct gen_pool *pool;
+	int nid;
+
+	if (nr_node_ids <= 1)
+		return;
+
+	atomic_pool_node = kcalloc(nr_node_ids, sizeof(*atomic_pool_node),
+				   GFP_KERNEL);
+	pool_size_node = kcalloc(nr_node_ids, sizeof(*pool_size_node),
+				 GFP_KERNEL);
+	if (!atomic_pool_node || !pool_size_node) {
+		kfree(atomic_pool_node);
+		kfree(pool_size_node);
+		atomic_pool_node = NULL;
+		return;
+	}
+
+	for_each_node_state(nid, N_MEMORY) {
+		pool = gen_pool_create(PAGE_SHIFT, nid);
+		if (!pool)
+			continue;
+		gen_pool_set_algo(pool, gen_pool_first_fit_order_align, NULL);
+		atomic_pool_node[nid] = pool;
+	}
+}
+
 static int __init dma_atomic_pool_init(void)
 {
 	int ret = 0;
@@ -216,6 +276,7 @@ static int __init dma_atomic_pool_init(void)
 			ret = -ENOMEM;
 	}
 
+	dma_atomic_pool_node_init();
 	dma_atomic_pool_debugfs_init();
 	return ret;
 }
@@ -237,6 +298,16 @@ static inline struct gen_pool *dma_guess_pool(struct gen_pool *prev, gfp_t gfp)
 	return NULL;
 }
 
+static struct gen_pool *dma_node_pool(struct device *dev, gfp_t gfp)
+{
+	int nid = dev_to_node(dev);
+
+	if (!atomic_pool_node || nid == NUMA_NO_NODE ||
+	    (gfp & (GFP_DMA | GFP_DMA32)))
+		return NULL;
+	return atomic_pool_node[nid];
+}
+
 static struct page *__dma_alloc_from_pool(struct device *dev, size_t size,
 		struct gen_pool *pool, void **cpu_addr,
 		bool (*phys_addr_ok)(struct device *, phys_addr_t, size_t))
@@ -266,9 +337,22 @@ struct page *dma_alloc_from_pool(struct device *dev, size_t size,
 		void **cpu_addr, gfp_t gfp,
 		bool (*phys_addr_ok)(struct device *, phys_addr_t, size_t))
 {
-	struct gen_pool *pool = NULL;
+	struct gen_pool *pool = dma_node_pool(dev, gfp);
 	struct page *page;
 
+	/* Try the device's node first, fall back to the zone pools */
+	if (pool) {
+		page = __dma_alloc_from_pool(dev, size, pool, cpu_addr,
+					     phys_addr_ok);
+		if (gen_pool_avail(pool) < atomic_pool_size) {
+			node_set(dev_to_node(dev), atomic_pool_node_grow);
+			schedule_work(&atomic_pool_work);
+		}
+		if (page)
+			return page;
+		pool = NULL;
+	}
+
 	while ((pool = dma_guess_pool(pool, gfp))) {
 		page = __dma_alloc_from_pool(dev, size, pool, cpu_addr,
 					     phys_addr_ok);
@@ -282,7 +366,13 @@ struct page *dma_alloc_from_pool(struct device *dev, size_t size,
 
 bool dma_free_from_pool(struct device *dev, void *start, size_t size)
 {
-	struct gen_pool *pool = NULL;
+	struct gen_pool *pool = dma_node_pool(dev, 0);
+
+	if (pool && gen_pool_has_addr(pool, (unsigned long)start, size)) {
+		gen_pool_free(pool, (unsigned long)start, size);
+		return true;
+	}
+	pool = NULL;
 
 	while ((pool = dma_guess_pool(pool, 0))) {
 		if (!gen_pool_has_addr(pool, (unsigned long)start, size))
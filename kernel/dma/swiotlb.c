@@ -615,13 +615,46 @@ static unsigned int wrap_area_index(struct io_tlb_mem *mem, unsigned int index)
 	return index;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static void inc_used_and_hiwater(struct io_tlb_mem *mem, unsigned int nslots)
+{
+	unsigned long old_hiwater, new_used;
+
+	new_used = atomic_long_add_return(nslots, &mem->total_used);
+	old_hiwater = atomic_long_read(&mem->used_hiwater);
+	do {
+		if (new_used <= old_hiwater)
+			break;
+	} while (!atomic_long_try_cmpxchg(&mem->used_hiwater,
+					  &old_hiwater, new_used));
+}
+
+static void dec_used(struct io_tlb_mem *mem, unsigned int nslots)
+{
+	atomic_long_sub(nslots, &mem->total_used);
+}
+
+#define swiotlb_inc_stat(mem, name)	atomic_long_inc(&(mem)->name)
+#else /* !CONFIG_DEBUG_FS */
+static void inc_used_and_hiwater(struct io_tlb_mem *mem, unsigned int nslots)
+{
+}
+static void dec_used(struct io_tlb_mem *mem, unsigned int nslots)
+{
+}
+#define swiotlb_inc_stat(mem, name)	do { } while (0)
+#endif /* CONFIG_DEBUG_FS */
+
 /*
  * Find a suitable number of IO TLB entries size that will fit this request and
  * allocate a buffer from that IO TLB pool.
+ *
+ * With @trylock, give up right away if the area is contended or looks too
+ * full, so that the caller can try another area first.
  */
 static int swiotlb_do_find_slots(struct device *dev, int area_index,
 		phys_addr_t orig_addr, size_t alloc_size,
-		unsigned int alloc_align_mask)
+		unsigned int alloc_align_mask, bool trylock)
 {
 	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
 	struct io_tlb_area *area = mem->areas + area_index;
@@ -651,7 +684,16 @@ static int swiotlb_do_find_slots(struct device *dev, int area_index,
 		stride = max(stride, stride << (PAGE_SHIFT - IO_TLB_SHIFT));
 	stride = max(stride, (alloc_align_mask >> IO_TLB_SHIFT) + 1);
 
-	spin_lock_irqsave(&area->lock, flags);
+	if (trylock) {
+		if (nslots > mem->area_nslabs - READ_ONCE(area->used))
+			return -1;
+		if (!spin_trylock_irqsave(&area->lock, flags)) {
+			swiotlb_inc_stat(mem, contended);
+			return -1;
+		}
+	} else {
+		spin_lock_irqsave(&area->lock, flags);
+	}
 	if (unlikely(nslots > mem->area_nslabs - area->used))
 		goto not_found;
 
@@ -704,26 +746,39 @@ static int swiotlb_do_find_slots(struct device *dev, int area_index,
 		area->index = index + nslots;
 	else
 		area->index = 0;
-	area->used += nslots;
+	WRITE_ONCE(area->used, area->used + nslots);
 	spin_unlock_irqrestore(&area->lock, flags);
+	inc_used_and_hiwater(mem, nslots);
 	return slot_index;
 }
 
+/*
+ * Start at the area of the current CPU.  A first pass only takes
+ * uncontended area locks; only when that fails, wait for the locks.
+ */
 static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 		size_t alloc_size, unsigned int alloc_align_mask)
 {
 	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
 	int start = raw_smp_processor_id() & (mem->nareas - 1);
-	int i = start, index;
+	int i, index, pass;
 
-	do {
-		index = swiotlb_do_find_slots(dev, i, orig_addr, alloc_size,
-					      alloc_align_mask);
-		if (index >= 0)
-			return index;
-		if (++i >= mem->nareas)
-			i = 0;
-	} while (i != start);
+	for (pass = 0; pass < 2; pass++) {
+		/* A single area has nowhere else to go, just wait for it */
+		if (!pass && mem->nareas == 1)
+			continue;
+
+		i = start;
+		do {
+			index = swiotlb_do_find_slots(dev, i, orig_addr,
+						      alloc_size,
+						      alloc_align_mask, !pass);
+			if (index >= 0)
+				return index;
+			if (++i >= mem->nareas)
+				i = 0;
+		} while (i != start);
+	}
 
 	return -1;
 }
@@ -767,6 +822,7 @@ phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 	index = swiotlb_find_slots(dev, orig_addr,
 				   alloc_size + offset, alloc_align_mask);
 	if (index == -1) {
+		swiotlb_inc_stat(mem, full);
 		if (!(attrs & DMA_ATTR_NO_WARN))
 			dev_warn_ratelimited(dev,
 	"swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
@@ -836,8 +892,9 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 && mem->slots[i].list;
 	     i--)
 		mem->slots[i].list = ++count;
-	area->used -= nslots;
+	WRITE_ONCE(area->used, area->used - nslots);
 	spin_unlock_irqrestore(&area->lock, flags);
+	dec_used(mem, nslots);
 }
 
 /*
@@ -939,6 +996,49 @@ static int io_tlb_used_get(void *data, u64 *val)
 }
 DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
 
+#ifdef CONFIG_DEBUG_FS
+static int io_tlb_hiwater_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->used_hiwater);
+	return 0;
+}
+
+static int io_tlb_hiwater_set(void *data, u64 val)
+{
+	struct io_tlb_mem *mem = data;
+
+	/* Only allow setting to zero */
+	if (val != 0)
+		return -EINVAL;
+
+	atomic_long_set(&mem->used_hiwater, val);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_hiwater, io_tlb_hiwater_get,
+			 io_tlb_hiwater_set, "%llu\n");
+
+static int io_tlb_contended_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->contended);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_contended, io_tlb_contended_get, NULL,
+			 "%llu\n");
+
+static int io_tlb_full_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->full);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_full, io_tlb_full_get, NULL, "%llu\n");
+#endif /* CONFIG_DEBUG_FS */
+
 static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem,
 					 const char *dirname)
 {
@@ -949,6 +1049,14 @@ static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem,
 	debugfs_create_ulong("io_tlb_nslabs", 0400, mem->debugfs, &mem->nslabs);
 	debugfs_create_file("io_tlb_used", 0400, mem->debugfs, NULL,
 			&fops_io_tlb_used);
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("io_tlb_used_hiwater", 0600, mem->debugfs, mem,
+			&fops_io_tlb_hiwater);
+	debugfs_create_file("io_tlb_contended", 0400, mem->debugfs, mem,
+			&fops_io_tlb_contended);
+	debugfs_create_file("io_tlb_full", 0400, mem->debugfs, mem,
+			&fops_io_tlb_full);
+#endif
 }
 
 static int __init __maybe_unused swiotlb_create_default_debugfs(void)
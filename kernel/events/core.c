@@ -17,6 +17,7 @@
 #include <linux/poll.h>
 #include <linux/slab.h>
 #include <linux/hash.h>
+#include <linux/jhash.h>
 #include <linux/tick.h>
 #include <linux/sysfs.h>
 #include <linux/dcache.h>
@@ -6526,6 +6527,9 @@ static int perf_mmap(struct file *file, struct vm_area_struct *vma)
 	if (vma->vm_flags & VM_WRITE)
 		flags |= RING_BUFFER_WRITABLE;
 
+	if (event->attr.callchain_id)
+		flags |= RING_BUFFER_CALLCHAIN_ID;
+
 	if (!rb) {
 		rb = rb_alloc(nr_pages,
 			      event->attr.watermark ? event->attr.wakeup_watermark : 0,
@@ -7263,7 +7267,18 @@ void perf_output_sample(struct perf_output_handle *handle,
 	if (sample_type & PERF_SAMPLE_READ)
 		perf_output_read(handle, event);
 
-	if (sample_type & PERF_SAMPLE_CALLCHAIN) {
+	if (sample_type & PERF_SAMPLE_CALLCHAIN && data->callchain_id) {
+		u64 nr = 2;
+
+		if (!data->callchain_id_sent)
+			nr += data->callchain->nr;
+		perf_output_put(handle, nr);
+		perf_output_put(handle, (u64)PERF_CONTEXT_STACK_ID);
+		perf_output_put(handle, data->callchain_id);
+		if (!data->callchain_id_sent)
+			__output_copy(handle, data->callchain->ip,
+				      data->callchain->nr * sizeof(u64));
+	} else if (sample_type & PERF_SAMPLE_CALLCHAIN) {
 		int size = 1;
 
 		size += data->callchain->nr;
@@ -7549,6 +7564,44 @@ perf_callchain(struct perf_event *event, struct pt_regs *regs)
 	return callchain ?: &__empty_callchain;
 }
 
+/*
+ * Give the callchain a stack id, and find out whether it was already sent
+ * to the buffer the sample goes to. The table remembers one id per slot,
+ * salted with the generation of the buffer so that all of them are
+ * forgotten when records are lost. Racing writers at worst both send the
+ * callchain.
+ */
+static void perf_prepare_callchain_id(struct perf_event *event,
+				      struct perf_sample_data *data)
+{
+	struct perf_callchain_entry *callchain = data->callchain;
+	struct perf_buffer *rb;
+	u64 id, key, *slot;
+
+	data->callchain_id = 0;
+	if (!event->attr.callchain_id || !callchain->nr)
+		return;
+
+	if (event->parent)
+		event = event->parent;
+
+	rb = rcu_dereference(event->rb);
+	if (!rb || !rb->callchain_ids)
+		return;
+
+	id = (u64)jhash2((u32 *)callchain->ip, callchain->nr * 2, 0) << 32 |
+	     jhash2((u32 *)callchain->ip, callchain->nr * 2, 1);
+	data->callchain_id = id ?: 1;
+
+	key = data->callchain_id ^
+	      (READ_ONCE(rb->callchain_id_gen) * GOLDEN_RATIO_64);
+	slot = rb->callchain_ids + hash_64(data->callchain_id,
+					   PERF_CALLCHAIN_ID_BITS);
+	data->callchain_id_sent = READ_ONCE(*slot) == key;
+	if (!data->callchain_id_sent)
+		WRITE_ONCE(*slot, key);
+}
+
 void perf_prepare_sample(struct perf_event_header *header,
 			 struct perf_sample_data *data,
 			 struct perf_event *event,
@@ -7579,7 +7632,11 @@ void perf_prepare_sample(struct perf_event_header *header,
 		if (filtered_sample_type & PERF_SAMPLE_CALLCHAIN)
 			data->callchain = perf_callchain(event, regs);
 
-		size += data->callchain->nr;
+		perf_prepare_callchain_id(event, data);
+		if (data->callchain_id)
+			size += 2;
+		if (!data->callchain_id || !data->callchain_id_sent)
+			size += data->callchain->nr;
 
 		header->size += size * sizeof(u64);
 	}
@@ -12113,6 +12170,9 @@ static int perf_copy_attr(struct perf_event_attr __user *uattr,
 	if (attr->sigtrap && !attr->remove_on_exec)
 		return -EINVAL;
 
+	if (attr->callchain_id && !(attr->sample_type & PERF_SAMPLE_CALLCHAIN))
+		return -EINVAL;
+
 out:
 	return ret;
 
@@ -9,14 +9,17 @@
 /* Buffer handling */
 
 #define RING_BUFFER_WRITABLE		0x01
+#define RING_BUFFER_CALLCHAIN_ID	0x02
+
+#define PERF_CALLCHAIN_ID_BITS		12
 
 struct perf_buffer {
 	refcount_t			refcount;
 	struct rcu_head			rcu_head;
 #ifdef CONFIG_PERF_USE_VMALLOC
 	struct work_struct		work;
-	int				page_order;	/* allocation order  */
 #endif
+	int				page_order;	/* allocation order  */
 	int				nr_pages;	/* nr of data pages  */
 	int				overwrite;	/* can overwrite itself */
 	int				paused;		/* can write into ring buffer */
@@ -54,6 +57,10 @@ struct perf_buffer {
 	void				**aux_pages;
 	void				*aux_priv;
 
+	/* Stack ids sent, see perf_prepare_callchain_id() */
+	u64				*callchain_ids;
+	unsigned long			callchain_id_gen;
+
 	struct perf_event_mmap_page	*user_page;
 	void				*data_pages[];
 };
@@ -96,26 +103,16 @@ void perf_event_aux_event(struct perf_event *event, unsigned long head,
 extern struct page *
 perf_mmap_to_page(struct perf_buffer *rb, unsigned long pgoff);
 
-#ifdef CONFIG_PERF_USE_VMALLOC
 /*
- * Back perf_mmap() with vmalloc memory.
- *
- * Required for architectures that have d-cache aliasing issues.
+ * Each of the nr_pages data pages is made of (1 << page_order) pages: with
+ * CONFIG_PERF_USE_VMALLOC there is a single vmalloc'ed one, otherwise they
+ * are as large as could be allocated.
  */
-
 static inline int page_order(struct perf_buffer *rb)
 {
 	return rb->page_order;
 }
 
-#else
-
-static inline int page_order(struct perf_buffer *rb)
-{
-	return 0;
-}
-#endif
-
 static inline int data_page_nr(struct perf_buffer *rb)
 {
 	return rb->nr_pages << page_order(rb);
@@ -175,6 +175,8 @@ __perf_output_begin(struct perf_output_handle *handle,
 		if (rb->nr_pages) {
 			local_inc(&rb->lost);
 			atomic64_inc(&event->lost_samples);
+			/* The lost record may have held a callchain. */
+			WRITE_ONCE(rb->callchain_id_gen, rb->callchain_id_gen + 1);
 		}
 		goto out;
 	}
@@ -257,6 +259,7 @@ __perf_output_begin(struct perf_output_handle *handle,
 fail:
 	local_inc(&rb->lost);
 	atomic64_inc(&event->lost_samples);
+	WRITE_ONCE(rb->callchain_id_gen, rb->callchain_id_gen + 1);
 	perf_output_put_handle(handle);
 out:
 	rcu_read_unlock();
@@ -334,6 +337,21 @@ ring_buffer_init(struct perf_buffer *rb, long watermark, int flags)
 		rb->paused = 1;
 }
 
+/*
+ * The table of stack ids is only an optimization: without it the
+ * callchains are sent in full. It isn't used for overwritable buffers,
+ * whose older records, the callchains included, get overwritten.
+ */
+static void rb_alloc_callchain_ids(struct perf_buffer *rb, int node, int flags)
+{
+	if ((flags & (RING_BUFFER_CALLCHAIN_ID | RING_BUFFER_WRITABLE)) !=
+	    (RING_BUFFER_CALLCHAIN_ID | RING_BUFFER_WRITABLE))
+		return;
+
+	rb->callchain_ids = kcalloc_node(1 << PERF_CALLCHAIN_ID_BITS, sizeof(u64),
+					 GFP_KERNEL | __GFP_NOWARN, node);
+}
+
 void perf_aux_output_flag(struct perf_output_handle *handle, u64 flags)
 {
 	/*
@@ -769,31 +787,47 @@ void rb_free_aux(struct perf_buffer *rb)
 #ifndef CONFIG_PERF_USE_VMALLOC
 
 /*
- * Back perf_mmap() with regular GFP_KERNEL-0 pages.
+ * Back perf_mmap() with regular GFP_KERNEL pages.
+ *
+ * The data pages are allocated with the highest order that succeeds, up to
+ * the size of the buffer, so that large buffers are physically contiguous
+ * and the output code crosses into a new chunk less often. The allocations
+ * are split, so each page can be mapped and freed on its own.
  */
 
 static struct page *
 __perf_mmap_to_page(struct perf_buffer *rb, unsigned long pgoff)
 {
-	if (pgoff > rb->nr_pages)
+	/* The '>' counts in the user page. */
+	if (pgoff > data_page_nr(rb))
 		return NULL;
 
 	if (pgoff == 0)
 		return virt_to_page(rb->user_page);
 
-	return virt_to_page(rb->data_pages[pgoff - 1]);
+	pgoff--;
+	return virt_to_page(rb->data_pages[pgoff >> page_order(rb)]) +
+	       (pgoff & ((1UL << page_order(rb)) - 1));
 }
 
-static void *perf_mmap_alloc_page(int cpu)
+static void *perf_mmap_alloc_page(int cpu, int order)
 {
+	gfp_t gfp = GFP_KERNEL | __GFP_ZERO;
 	struct page *page;
 	int node;
 
+	/* Fall back to smaller pages rather than trying too hard. */
+	if (order)
+		gfp |= __GFP_NOWARN | __GFP_NORETRY;
+
 	node = (cpu == -1) ? cpu : cpu_to_node(cpu);
-	page = alloc_pages_node(node, GFP_KERNEL | __GFP_ZERO, 0);
+	page = alloc_pages_node(node, gfp, order);
 	if (!page)
 		return NULL;
 
+	if (order)
+		split_page(page, order);
+
 	return page_address(page);
 }
 
@@ -805,11 +839,19 @@ static void perf_mmap_free_page(void *addr)
 	__free_page(page);
 }
 
+static void perf_mmap_free_pages(void *addr, int order)
+{
+	int i;
+
+	for (i = 0; i < (1 << order); i++)
+		perf_mmap_free_page(addr + i * PAGE_SIZE);
+}
+
 struct perf_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 {
 	struct perf_buffer *rb;
 	unsigned long size;
-	int i, node;
+	int i, nr, node, order;
 
 	size = sizeof(struct perf_buffer);
 	size += nr_pages * sizeof(void *);
@@ -822,29 +864,43 @@ struct perf_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 	if (!rb)
 		goto fail;
 
-	rb->user_page = perf_mmap_alloc_page(cpu);
+	rb_alloc_callchain_ids(rb, node, flags);
+
+	rb->user_page = perf_mmap_alloc_page(cpu, 0);
 	if (!rb->user_page)
 		goto fail_user_page;
 
-	for (i = 0; i < nr_pages; i++) {
-		rb->data_pages[i] = perf_mmap_alloc_page(cpu);
-		if (!rb->data_pages[i])
+	/* nr_pages is a power of two, so is the number of chunks. */
+	order = nr_pages ? min_t(int, ilog2(nr_pages), MAX_ORDER - 1) : 0;
+	for (;;) {
+		nr = nr_pages >> order;
+		for (i = 0; i < nr; i++) {
+			rb->data_pages[i] = perf_mmap_alloc_page(cpu, order);
+			if (!rb->data_pages[i])
+				break;
+		}
+		if (i == nr)
+			break;
+
+		while (i--)
+			perf_mmap_free_pages(rb->data_pages[i], order);
+		if (!order)
 			goto fail_data_pages;
+		order--;
 	}
 
-	rb->nr_pages = nr_pages;
+	rb->nr_pages = nr;
+	rb->page_order = order;
 
 	ring_buffer_init(rb, watermark, flags);
 
 	return rb;
 
 fail_data_pages:
-	for (i--; i >= 0; i--)
-		perf_mmap_free_page(rb->data_pages[i]);
-
 	perf_mmap_free_page(rb->user_page);
 
 fail_user_page:
+	kfree(rb->callchain_ids);
 	kfree(rb);
 
 fail:
@@ -857,7 +913,8 @@ void rb_free(struct perf_buffer *rb)
 
 	perf_mmap_free_page(rb->user_page);
 	for (i = 0; i < rb->nr_pages; i++)
-		perf_mmap_free_page(rb->data_pages[i]);
+		perf_mmap_free_pages(rb->data_pages[i], page_order(rb));
+	kfree(rb->callchain_ids);
 	kfree(rb);
 }
 
@@ -894,6 +951,7 @@ static void rb_free_work(struct work_struct *work)
 		perf_mmap_unmark_page(base + (i * PAGE_SIZE));
 
 	vfree(base);
+	kfree(rb->callchain_ids);
 	kfree(rb);
 }
 
@@ -923,6 +981,8 @@ struct perf_buffer *rb_alloc(int nr_pages, long watermark, int cpu, int flags)
 	if (!all_buf)
 		goto fail_all_buf;
 
+	rb_alloc_callchain_ids(rb, node, flags);
+
 	rb->user_page = all_buf;
 	rb->data_pages[0] = all_buf + PAGE_SIZE;
 	if (nr_pages) {
@@ -27,6 +27,7 @@
 #include <linux/task_work.h>
 #include <linux/shmem_fs.h>
 #include <linux/khugepaged.h>
+#include <linux/sort.h>
 
 #include <linux/uprobes.h>
 
@@ -41,6 +42,7 @@ static struct rb_root uprobes_tree = RB_ROOT;
 #define no_uprobe_events()	RB_EMPTY_ROOT(&uprobes_tree)
 
 static DEFINE_SPINLOCK(uprobes_treelock);	/* serialize rbtree access */
+static seqcount_spinlock_t uprobes_seqcount = SEQCNT_SPINLOCK_ZERO(uprobes_seqcount, &uprobes_treelock);
 
 #define UPROBES_HASH_SZ	13
 /* serialize uprobe->pending_list */
@@ -55,6 +57,7 @@ DEFINE_STATIC_PERCPU_RWSEM(dup_mmap_sem);
 struct uprobe {
 	struct rb_node		rb_node;	/* node in the rb tree */
 	refcount_t		ref;
+	struct rcu_head		rcu;		/* lockless lookups, see find_uprobe_rcu() */
 	struct rw_semaphore	register_rwsem;
 	struct rw_semaphore	consumer_rwsem;
 	struct list_head	pending_list;
@@ -596,6 +599,14 @@ static struct uprobe *get_uprobe(struct uprobe *uprobe)
 	return uprobe;
 }
 
+/* For lockless lookups, which can find a uprobe on its way out. */
+static struct uprobe *try_get_uprobe(struct uprobe *uprobe)
+{
+	if (refcount_inc_not_zero(&uprobe->ref))
+		return uprobe;
+	return NULL;
+}
+
 static void put_uprobe(struct uprobe *uprobe)
 {
 	if (refcount_dec_and_test(&uprobe->ref)) {
@@ -607,7 +618,7 @@ static void put_uprobe(struct uprobe *uprobe)
 		mutex_lock(&delayed_uprobe_lock);
 		delayed_uprobe_remove(uprobe, NULL);
 		mutex_unlock(&delayed_uprobe_lock);
-		kfree(uprobe);
+		kfree_rcu(uprobe, rcu);
 	}
 }
 
@@ -679,11 +690,40 @@ static struct uprobe *find_uprobe(struct inode *inode, loff_t offset)
 	return uprobe;
 }
 
+/*
+ * Find a uprobe corresponding to a given inode:offset without taking
+ * uprobes_treelock, for handle_swbp(). A lookup that raced with a tree
+ * update may miss, so retry if the tree changed under us.
+ */
+static struct uprobe *find_uprobe_rcu(struct inode *inode, loff_t offset)
+{
+	struct __uprobe_key key = {
+		.inode = inode,
+		.offset = offset,
+	};
+	struct uprobe *uprobe = NULL;
+	struct rb_node *node;
+	unsigned int seq;
+
+	rcu_read_lock();
+	do {
+		seq = read_seqcount_begin(&uprobes_seqcount);
+		node = rb_find_rcu(&key, &uprobes_tree, __uprobe_cmp_key);
+		if (node) {
+			uprobe = try_get_uprobe(__node_2_uprobe(node));
+			break;
+		}
+	} while (read_seqcount_retry(&uprobes_seqcount, seq));
+	rcu_read_unlock();
+
+	return uprobe;
+}
+
 static struct uprobe *__insert_uprobe(struct uprobe *uprobe)
 {
 	struct rb_node *node;
 
-	node = rb_find_add(&uprobe->rb_node, &uprobes_tree, __uprobe_cmp);
+	node = rb_find_add_rcu(&uprobe->rb_node, &uprobes_tree, __uprobe_cmp);
 	if (node)
 		return get_uprobe(__node_2_uprobe(node));
 
@@ -705,7 +745,9 @@ static struct uprobe *insert_uprobe(struct uprobe *uprobe)
 	struct uprobe *u;
 
 	spin_lock(&uprobes_treelock);
+	write_seqcount_begin(&uprobes_seqcount);
 	u = __insert_uprobe(uprobe);
+	write_seqcount_end(&uprobes_seqcount);
 	spin_unlock(&uprobes_treelock);
 
 	return u;
@@ -939,7 +981,9 @@ static void delete_uprobe(struct uprobe *uprobe)
 		return;
 
 	spin_lock(&uprobes_treelock);
+	write_seqcount_begin(&uprobes_seqcount);
 	rb_erase(&uprobe->rb_node, &uprobes_tree);
+	write_seqcount_end(&uprobes_seqcount);
 	spin_unlock(&uprobes_treelock);
 	RB_CLEAR_NODE(&uprobe->rb_node); /* for uprobe_is_active() */
 	put_uprobe(uprobe);
@@ -949,6 +993,7 @@ struct map_info {
 	struct map_info *next;
 	struct mm_struct *mm;
 	unsigned long vaddr;
+	loff_t offset;		/* File offset mapped at @vaddr */
 };
 
 static inline struct map_info *free_map_info(struct map_info *info)
@@ -958,10 +1003,16 @@ static inline struct map_info *free_map_info(struct map_info *info)
 	return next;
 }
 
+/*
+ * Collect the mms that map any of [@offset, @end] of @mapping. Each entry
+ * is for one vma, at the lowest offset of the range that it maps.
+ */
 static struct map_info *
-build_map_info(struct address_space *mapping, loff_t offset, bool is_register)
+build_map_info(struct address_space *mapping, loff_t offset, loff_t end,
+	       bool is_register)
 {
 	unsigned long pgoff = offset >> PAGE_SHIFT;
+	unsigned long pgend = end >> PAGE_SHIFT;
 	struct vm_area_struct *vma;
 	struct map_info *curr = NULL;
 	struct map_info *prev = NULL;
@@ -970,7 +1021,7 @@ build_map_info(struct address_space *mapping, loff_t offset, bool is_register)
 
  again:
 	i_mmap_lock_read(mapping);
-	vma_interval_tree_foreach(vma, &mapping->i_mmap, pgoff, pgoff) {
+	vma_interval_tree_foreach(vma, &mapping->i_mmap, pgoff, pgend) {
 		if (!valid_vma(vma, is_register))
 			continue;
 
@@ -998,7 +1049,8 @@ build_map_info(struct address_space *mapping, loff_t offset, bool is_register)
 		curr = info;
 
 		info->mm = vma->vm_mm;
-		info->vaddr = offset_to_vaddr(vma, offset);
+		info->offset = max(offset, vaddr_to_offset(vma, vma->vm_start));
+		info->vaddr = offset_to_vaddr(vma, info->offset);
 	}
 	i_mmap_unlock_read(mapping);
 
@@ -1028,20 +1080,26 @@ build_map_info(struct address_space *mapping, loff_t offset, bool is_register)
 	return curr;
 }
 
+/*
+ * Install or remove the breakpoints of @cnt uprobes of the same inode,
+ * sorted by offset, walking the mappings of the inode and locking each mm
+ * only once for all of them. @new[i] is the consumer being added to
+ * @uprobes[i], NULL when unregistering.
+ *
+ * The caller holds the register_rwsem of the uprobes and dup_mmap_sem.
+ */
 static int
-register_for_each_vma(struct uprobe *uprobe, struct uprobe_consumer *new)
+__register_for_each_vma(struct uprobe **uprobes, struct uprobe_consumer **new,
+			int cnt, bool is_register)
 {
-	bool is_register = !!new;
+	struct inode *inode = uprobes[0]->inode;
 	struct map_info *info;
-	int err = 0;
+	int i, err = 0;
 
-	percpu_down_write(&dup_mmap_sem);
-	info = build_map_info(uprobe->inode->i_mapping,
-					uprobe->offset, is_register);
-	if (IS_ERR(info)) {
-		err = PTR_ERR(info);
-		goto out;
-	}
+	info = build_map_info(inode->i_mapping, uprobes[0]->offset,
+			      uprobes[cnt - 1]->offset, is_register);
+	if (IS_ERR(info))
+		return PTR_ERR(info);
 
 	while (info) {
 		struct mm_struct *mm = info->mm;
@@ -1051,34 +1109,54 @@ register_for_each_vma(struct uprobe *uprobe, struct uprobe_consumer *new)
 			goto free;
 
 		mmap_write_lock(mm);
-		vma = find_vma(mm, info->vaddr);
-		if (!vma || !valid_vma(vma, is_register) ||
-		    file_inode(vma->vm_file) != uprobe->inode)
-			goto unlock;
-
-		if (vma->vm_start > info->vaddr ||
-		    vaddr_to_offset(vma, info->vaddr) != uprobe->offset)
-			goto unlock;
-
-		if (is_register) {
-			/* consult only the "caller", new consumer. */
-			if (consumer_filter(new,
-					UPROBE_FILTER_REGISTER, mm))
-				err = install_breakpoint(uprobe, mm, vma, info->vaddr);
-		} else if (test_bit(MMF_HAS_UPROBES, &mm->flags)) {
-			if (!filter_chain(uprobe,
-					UPROBE_FILTER_UNREGISTER, mm))
-				err |= remove_breakpoint(uprobe, mm, info->vaddr);
+		for (i = 0; i < cnt; i++) {
+			struct uprobe *uprobe = uprobes[i];
+			unsigned long vaddr;
+
+			if (uprobe->offset < info->offset)
+				continue;
+			vaddr = info->vaddr + (uprobe->offset - info->offset);
+
+			vma = find_vma(mm, vaddr);
+			if (!vma || !valid_vma(vma, is_register) ||
+			    file_inode(vma->vm_file) != inode)
+				continue;
+
+			if (vma->vm_start > vaddr ||
+			    vaddr_to_offset(vma, vaddr) != uprobe->offset)
+				continue;
+
+			if (is_register) {
+				/* consult only the "caller", new consumer. */
+				if (consumer_filter(new[i],
+						UPROBE_FILTER_REGISTER, mm))
+					err = install_breakpoint(uprobe, mm, vma, vaddr);
+				if (err)
+					break;
+			} else if (test_bit(MMF_HAS_UPROBES, &mm->flags)) {
+				if (!filter_chain(uprobe,
+						UPROBE_FILTER_UNREGISTER, mm))
+					err |= remove_breakpoint(uprobe, mm, vaddr);
+			}
 		}
-
- unlock:
 		mmap_write_unlock(mm);
  free:
 		mmput(mm);
 		info = free_map_info(info);
 	}
- out:
+
+	return err;
+}
+
+static int
+register_for_each_vma(struct uprobe *uprobe, struct uprobe_consumer *new)
+{
+	int err;
+
+	percpu_down_write(&dup_mmap_sem);
+	err = __register_for_each_vma(&uprobe, &new, 1, !!new);
 	percpu_up_write(&dup_mmap_sem);
+
 	return err;
 }
 
@@ -1135,12 +1213,10 @@ EXPORT_SYMBOL_GPL(uprobe_unregister);
  * Return errno if it cannot successully install probes
  * else return 0 (success)
  */
-static int __uprobe_register(struct inode *inode, loff_t offset,
-			     loff_t ref_ctr_offset, struct uprobe_consumer *uc)
+static int uprobe_validate_register(struct inode *inode, loff_t offset,
+				    loff_t ref_ctr_offset,
+				    struct uprobe_consumer *uc)
 {
-	struct uprobe *uprobe;
-	int ret;
-
 	/* Uprobe must have at least one set consumer */
 	if (!uc->handler && !uc->ret_handler)
 		return -EINVAL;
@@ -1162,6 +1238,19 @@ static int __uprobe_register(struct inode *inode, loff_t offset,
 	if (!IS_ALIGNED(ref_ctr_offset, sizeof(short)))
 		return -EINVAL;
 
+	return 0;
+}
+
+static int __uprobe_register(struct inode *inode, loff_t offset,
+			     loff_t ref_ctr_offset, struct uprobe_consumer *uc)
+{
+	struct uprobe *uprobe;
+	int ret;
+
+	ret = uprobe_validate_register(inode, offset, ref_ctr_offset, uc);
+	if (ret)
+		return ret;
+
  retry:
 	uprobe = alloc_uprobe(inode, offset, ref_ctr_offset);
 	if (!uprobe)
@@ -1203,6 +1292,271 @@ int uprobe_register_refctr(struct inode *inode, loff_t offset,
 }
 EXPORT_SYMBOL_GPL(uprobe_register_refctr);
 
+/*
+ * Batches hold the register_rwsem of all their uprobes at once, which is
+ * fine as long as there is only one batch at a time: single registrations
+ * take one register_rwsem and then dup_mmap_sem, batches take all of them
+ * and then dup_mmap_sem.
+ */
+static DEFINE_MUTEX(uprobes_batch_mutex);
+
+struct uprobe_batch_entry {
+	loff_t			offset;
+	loff_t			ref_ctr_offset;
+	struct uprobe_consumer	*uc;
+};
+
+static int uprobe_batch_cmp(const void *a, const void *b)
+{
+	const struct uprobe_batch_entry *ea = a, *eb = b;
+
+	if (ea->offset != eb->offset)
+		return ea->offset < eb->offset ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Sort the probes by offset, which is also the order of their uprobes in
+ * the tree, and check that there is only one per offset.
+ */
+static struct uprobe_batch_entry *
+uprobe_batch_entries(int cnt, const loff_t *offsets,
+		     const loff_t *ref_ctr_offsets, struct uprobe_consumer **ucs)
+{
+	struct uprobe_batch_entry *entries;
+	int i;
+
+	entries = kvcalloc(cnt, sizeof(*entries), GFP_KERNEL);
+	if (!entries)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0; i < cnt; i++) {
+		entries[i].offset = offsets[i];
+		entries[i].ref_ctr_offset = ref_ctr_offsets ? ref_ctr_offsets[i] : 0;
+		entries[i].uc = ucs[i];
+	}
+	sort(entries, cnt, sizeof(*entries), uprobe_batch_cmp, NULL);
+
+	for (i = 1; i < cnt; i++) {
+		if (entries[i].offset == entries[i - 1].offset) {
+			kvfree(entries);
+			return ERR_PTR(-EINVAL);
+		}
+	}
+
+	return entries;
+}
+
+static void uprobe_batch_lock(struct uprobe **uprobes, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		down_write_nest_lock(&uprobes[i]->register_rwsem,
+				     &uprobes_batch_mutex);
+}
+
+static void uprobe_batch_unlock(struct uprobe **uprobes, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++)
+		up_write(&uprobes[i]->register_rwsem);
+}
+
+/*
+ * Drop the uprobes of a batch that failed before their consumers were
+ * added. The ones we created are still in the tree with no consumer; as
+ * in __uprobe_register(), a concurrent registration of one of them will
+ * notice it is gone and retry.
+ */
+static void uprobe_batch_abort(struct uprobe **uprobes, int cnt)
+{
+	int i;
+
+	for (i = 0; i < cnt; i++) {
+		down_write(&uprobes[i]->register_rwsem);
+		if (!uprobes[i]->consumers && uprobe_is_active(uprobes[i]))
+			delete_uprobe(uprobes[i]);
+		up_write(&uprobes[i]->register_rwsem);
+		put_uprobe(uprobes[i]);
+	}
+}
+
+/**
+ * uprobe_register_batch - register probes at several offsets of a file
+ * @inode: the file in which the probes have to be placed.
+ * @cnt: number of probes.
+ * @offsets: offsets from the start of the file, all different.
+ * @ref_ctr_offsets: offsets of the reference counters, or NULL.
+ * @ucs: consumer of each probe.
+ *
+ * Same as calling uprobe_register_refctr() for each probe, but the
+ * mappings of @inode are walked, and each mm locked, once for all of them,
+ * and dup_mmap_sem is only taken once. Either all the probes are
+ * registered or none.
+ *
+ * Return errno if it cannot successully install probes
+ * else return 0 (success)
+ */
+int uprobe_register_batch(struct inode *inode, int cnt, const loff_t *offsets,
+			  const loff_t *ref_ctr_offsets,
+			  struct uprobe_consumer **ucs)
+{
+	struct uprobe_batch_entry *entries;
+	struct uprobe_consumer **sorted;
+	struct uprobe **uprobes;
+	int i, ret;
+
+	if (cnt <= 0)
+		return -EINVAL;
+
+	for (i = 0; i < cnt; i++) {
+		ret = uprobe_validate_register(inode, offsets[i],
+				ref_ctr_offsets ? ref_ctr_offsets[i] : 0, ucs[i]);
+		if (ret)
+			return ret;
+	}
+
+	entries = uprobe_batch_entries(cnt, offsets, ref_ctr_offsets, ucs);
+	if (IS_ERR(entries))
+		return PTR_ERR(entries);
+
+	uprobes = kvcalloc(cnt, sizeof(*uprobes), GFP_KERNEL);
+	sorted = kvcalloc(cnt, sizeof(*sorted), GFP_KERNEL);
+	if (!uprobes || !sorted) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (i = 0; i < cnt; i++)
+		sorted[i] = entries[i].uc;
+
+	mutex_lock(&uprobes_batch_mutex);
+ retry:
+	for (i = 0; i < cnt; i++) {
+		struct uprobe *uprobe;
+
+		uprobe = alloc_uprobe(inode, entries[i].offset,
+				      entries[i].ref_ctr_offset);
+		if (IS_ERR_OR_NULL(uprobe)) {
+			ret = uprobe ? PTR_ERR(uprobe) : -ENOMEM;
+			uprobe_batch_abort(uprobes, i);
+			goto out_unlock;
+		}
+		uprobes[i] = uprobe;
+	}
+
+	uprobe_batch_lock(uprobes, cnt);
+
+	/* We can race with uprobe_unregister()->delete_uprobe(). */
+	for (i = 0; i < cnt; i++) {
+		if (unlikely(!uprobe_is_active(uprobes[i]))) {
+			uprobe_batch_unlock(uprobes, cnt);
+			uprobe_batch_abort(uprobes, cnt);
+			goto retry;
+		}
+	}
+
+	for (i = 0; i < cnt; i++)
+		consumer_add(uprobes[i], sorted[i]);
+
+	percpu_down_write(&dup_mmap_sem);
+	ret = __register_for_each_vma(uprobes, sorted, cnt, true);
+	percpu_up_write(&dup_mmap_sem);
+
+	if (ret) {
+		for (i = 0; i < cnt; i++)
+			__uprobe_unregister(uprobes[i], sorted[i]);
+	}
+
+	uprobe_batch_unlock(uprobes, cnt);
+	for (i = 0; i < cnt; i++)
+		put_uprobe(uprobes[i]);
+ out_unlock:
+	mutex_unlock(&uprobes_batch_mutex);
+ out_free:
+	kvfree(sorted);
+	kvfree(uprobes);
+	kvfree(entries);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(uprobe_register_batch);
+
+/**
+ * uprobe_unregister_batch - unregister probes at several offsets of a file
+ * @inode: the file in which the probes have to be removed.
+ * @cnt: number of probes.
+ * @offsets: offsets from the start of the file, all different.
+ * @ucs: consumer of each probe.
+ *
+ * The counterpart of uprobe_register_batch(), the probes may also have
+ * been registered one by one.
+ */
+void uprobe_unregister_batch(struct inode *inode, int cnt,
+			     const loff_t *offsets,
+			     struct uprobe_consumer **ucs)
+{
+	struct uprobe_batch_entry *entries;
+	struct uprobe_consumer **sorted = NULL;
+	struct uprobe **uprobes = NULL;
+	int i, n = 0, err;
+
+	entries = uprobe_batch_entries(cnt, offsets, NULL, ucs);
+	if (!IS_ERR(entries)) {
+		uprobes = kvcalloc(cnt, sizeof(*uprobes), GFP_KERNEL);
+		sorted = kvcalloc(cnt, sizeof(*sorted), GFP_KERNEL);
+	}
+	if (!uprobes || !sorted) {
+		/* Fall back to one at a time. */
+		for (i = 0; i < cnt; i++)
+			uprobe_unregister(inode, offsets[i], ucs[i]);
+		goto out_free;
+	}
+
+	mutex_lock(&uprobes_batch_mutex);
+	for (i = 0; i < cnt; i++) {
+		struct uprobe *uprobe = find_uprobe(inode, entries[i].offset);
+
+		if (WARN_ON(!uprobe))
+			continue;
+		uprobes[n] = uprobe;
+		sorted[n++] = entries[i].uc;
+	}
+	if (!n)
+		goto out_unlock;
+
+	uprobe_batch_lock(uprobes, n);
+
+	for (i = 0; i < n; i++)
+		WARN_ON(!consumer_del(uprobes[i], sorted[i]));
+
+	percpu_down_write(&dup_mmap_sem);
+	err = __register_for_each_vma(uprobes, sorted, n, false);
+	percpu_up_write(&dup_mmap_sem);
+
+	/*
+	 * As in __uprobe_unregister(), a uprobe whose breakpoints could not
+	 * all be removed stays in the tree.
+	 */
+	for (i = 0; i < n; i++) {
+		if (!uprobes[i]->consumers && !err)
+			delete_uprobe(uprobes[i]);
+	}
+
+	uprobe_batch_unlock(uprobes, n);
+	for (i = 0; i < n; i++)
+		put_uprobe(uprobes[i]);
+ out_unlock:
+	mutex_unlock(&uprobes_batch_mutex);
+ out_free:
+	kvfree(sorted);
+	kvfree(uprobes);
+	if (!IS_ERR(entries))
+		kvfree(entries);
+}
+EXPORT_SYMBOL_GPL(uprobe_unregister_batch);
+
 /*
  * uprobe_apply - unregister an already registered probe.
  * @inode: the file in which the probe has to be removed.
@@ -2053,7 +2407,7 @@ static struct uprobe *find_active_uprobe(unsigned long bp_vaddr, int *is_swbp)
 			struct inode *inode = file_inode(vma->vm_file);
 			loff_t offset = vaddr_to_offset(vma, bp_vaddr);
 
-			uprobe = find_uprobe(inode, offset);
+			uprobe = find_uprobe_rcu(inode, offset);
 		}
 
 		if (!uprobe)
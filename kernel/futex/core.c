@@ -37,6 +37,10 @@
 #include <linux/memblock.h>
 #include <linux/fault-inject.h>
 #include <linux/slab.h>
+#include <linux/hashtable.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/signal.h>
+#include <linux/topology.h>
 
 #include "futex.h"
 #include "../locking/rtmutex_common.h"
@@ -53,6 +57,139 @@ static struct {
 #define futex_queues   (__futex_data.queues)
 #define futex_hashsize (__futex_data.hashsize)
 
+/*
+ * Private futex hash tables.
+ *
+ * With futex.private_hash=1 on the command line, each process gets its own
+ * hash table for its PROCESS_PRIVATE futexes instead of sharing the global
+ * one, so that unrelated processes stop contending on the same buckets and
+ * the buckets live on the node of the thread that first needed them.
+ * Shared futexes always use the global table.
+ *
+ * A task attaches to its process' table on its first private futex
+ * operation and holds a reference until its futex state is released at exit
+ * or exec.  All private keys are hashed by tasks of the key's mm, and all
+ * of those that can have queued a waiter are attached, so every lookup of a
+ * given key sees the same table for as long as it has waiters.  A table is
+ * freed once the last attached task has gone, and the next private futex
+ * operation in that process allocates a fresh one, sized for the thread
+ * count at that time.
+ *
+ * The tables are found by mm in a small global hash, which is only looked
+ * at when a task attaches.
+ */
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "futex."
+
+static bool futex_private_hash_enabled __ro_after_init;
+module_param_named(private_hash, futex_private_hash_enabled, bool, 0444);
+
+#define FUTEX_PHASH_PER_THREAD	16
+#define FUTEX_PHASH_MIN		64
+#define FUTEX_PHASH_MAX		16384
+
+struct futex_private_hash {
+	struct hlist_node	 node;
+	struct mm_struct	*mm;
+	unsigned int		 users;
+	unsigned int		 hash_mask;
+	struct futex_hash_bucket queues[];
+};
+
+static DEFINE_HASHTABLE(futex_phash_table, 8);
+static DEFINE_SPINLOCK(futex_phash_lock);
+
+static struct futex_private_hash *futex_private_hash_find(struct mm_struct *mm)
+{
+	struct futex_private_hash *fph;
+
+	hash_for_each_possible(futex_phash_table, fph, node, (unsigned long)mm)
+		if (fph->mm == mm)
+			return fph;
+	return NULL;
+}
+
+static struct futex_private_hash *futex_private_hash_alloc(struct mm_struct *mm)
+{
+	struct futex_private_hash *fph;
+	unsigned long size, i;
+
+	size = max_t(unsigned long,
+		     FUTEX_PHASH_PER_THREAD * get_nr_threads(current),
+		     4 * num_online_cpus());
+	size = clamp_t(unsigned long, roundup_pow_of_two(size),
+		       FUTEX_PHASH_MIN,
+		       min_t(unsigned long, futex_hashsize, FUTEX_PHASH_MAX));
+
+	fph = kvmalloc_node(struct_size(fph, queues, size), GFP_KERNEL_ACCOUNT,
+			    numa_node_id());
+	if (!fph)
+		return NULL;
+
+	fph->mm = mm;
+	fph->users = 1;
+	fph->hash_mask = size - 1;
+	for (i = 0; i < size; i++) {
+		atomic_set(&fph->queues[i].waiters, 0);
+		plist_head_init(&fph->queues[i].chain);
+		spin_lock_init(&fph->queues[i].lock);
+	}
+	return fph;
+}
+
+/*
+ * Attach @tsk to the private hash of its process, creating the hash if
+ * there isn't one yet and @create is set.
+ */
+static int futex_private_hash_get(struct task_struct *tsk, bool create)
+{
+	struct futex_private_hash *fph, *new = NULL;
+	struct mm_struct *mm = tsk->mm;
+
+	spin_lock(&futex_phash_lock);
+	fph = futex_private_hash_find(mm);
+	if (!fph && create) {
+		spin_unlock(&futex_phash_lock);
+		new = futex_private_hash_alloc(mm);
+		if (!new)
+			return -ENOMEM;
+		spin_lock(&futex_phash_lock);
+		fph = futex_private_hash_find(mm);
+		if (!fph) {
+			hash_add(futex_phash_table, &new->node, (unsigned long)mm);
+			tsk->futex_phash = new;
+			new = NULL;
+			goto out;
+		}
+	}
+	if (fph) {
+		fph->users++;
+		tsk->futex_phash = fph;
+	}
+out:
+	spin_unlock(&futex_phash_lock);
+	kvfree(new);
+	return 0;
+}
+
+static void futex_private_hash_put(struct task_struct *tsk)
+{
+	struct futex_private_hash *fph = tsk->futex_phash;
+
+	if (!fph)
+		return;
+	tsk->futex_phash = NULL;
+
+	spin_lock(&futex_phash_lock);
+	if (--fph->users) {
+		spin_unlock(&futex_phash_lock);
+		return;
+	}
+	hash_del(&fph->node);
+	spin_unlock(&futex_phash_lock);
+	kvfree(fph);
+}
+
 
 /*
  * Fault injections for futexes.
@@ -106,17 +243,22 @@ late_initcall(fail_futex_debugfs);
 #endif /* CONFIG_FAIL_FUTEX */
 
 /**
- * futex_hash - Return the hash bucket in the global hash
+ * futex_hash - Return the hash bucket for a futex key
  * @key:	Pointer to the futex key for which the hash is calculated
  *
  * We hash on the keys returned from get_futex_key (see below) and return the
- * corresponding hash bucket in the global hash.
+ * corresponding hash bucket in the private hash of the current process for
+ * a private key when it has one, and otherwise in the global hash.
  */
 struct futex_hash_bucket *futex_hash(union futex_key *key)
 {
+	struct futex_private_hash *fph = current->futex_phash;
 	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
 			  key->both.offset);
 
+	if (fph && !(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED)))
+		return &fph->queues[hash & fph->hash_mask];
+
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
@@ -248,6 +390,11 @@ int get_futex_key(u32 __user *uaddr, bool fshared, union futex_key *key,
 	 *        but access_ok() should be faster than find_vma()
 	 */
 	if (!fshared) {
+		if (futex_private_hash_enabled && unlikely(!current->futex_phash)) {
+			err = futex_private_hash_get(current, true);
+			if (err)
+				return err;
+		}
 		key->private.mm = mm;
 		key->private.address = address;
 		return 0;
@@ -1026,8 +1173,16 @@ static void futex_cleanup(struct task_struct *tsk)
 	}
 #endif
 
-	if (unlikely(!list_empty(&tsk->pi_state_list)))
+	if (unlikely(!list_empty(&tsk->pi_state_list))) {
+		/*
+		 * The waiters on the PI futexes we own may be queued in the
+		 * private hash even if we never did a futex operation
+		 * ourselves; they keep it alive, so just look it up.
+		 */
+		if (futex_private_hash_enabled && !tsk->futex_phash)
+			futex_private_hash_get(tsk, false);
 		exit_pi_state_list(tsk);
+	}
 }
 
 /**
@@ -1106,6 +1261,8 @@ void futex_exec_release(struct task_struct *tsk)
 	 */
 	futex_cleanup_begin(tsk);
 	futex_cleanup(tsk);
+	/* The new binary gets a new mm, and with it a new private hash. */
+	futex_private_hash_put(tsk);
 	/*
 	 * Reset the state to FUTEX_STATE_OK. The task is alive and about
 	 * exec a new binary.
@@ -1117,6 +1274,7 @@ void futex_exit_release(struct task_struct *tsk)
 {
 	futex_cleanup_begin(tsk);
 	futex_cleanup(tsk);
+	futex_private_hash_put(tsk);
 	futex_cleanup_end(tsk, FUTEX_STATE_DEAD);
 }
 
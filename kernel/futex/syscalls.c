@@ -305,6 +305,45 @@ SYSCALL_DEFINE5(futex_waitv, struct futex_waitv __user *, waiters,
 	return ret;
 }
 
+/**
+ * sys_futex_wakev - Wake waiters on a list of futexes
+ * @waiters:    List of futexes to wake
+ * @nr_futexes: Length of the list
+ * @flags:      No flags are defined yet, must be 0
+ *
+ * Given an array of `struct futex_waitv`, wake up to `val` waiters on each
+ * uaddr, with the same private/shared flags as futex_waitv() uses.  This
+ * does the same as a futex_wake() for each entry, but each hash bucket lock
+ * is taken only once and all the woken tasks are woken together at the end.
+ * If an address appears more than once, each entry wakes its own share.
+ *
+ * Returns the total number of waiters woken.  Nothing is woken if any of the
+ * entries is malformed or its address faults.
+ */
+SYSCALL_DEFINE3(futex_wakev, struct futex_waitv __user *, waiters,
+		unsigned int, nr_futexes, unsigned int, flags)
+{
+	struct futex_vector *futexv;
+	int ret;
+
+	if (flags)
+		return -EINVAL;
+
+	if (!nr_futexes || nr_futexes > FUTEX_WAITV_MAX || !waiters)
+		return -EINVAL;
+
+	futexv = kcalloc(nr_futexes, sizeof(*futexv), GFP_KERNEL);
+	if (!futexv)
+		return -ENOMEM;
+
+	ret = futex_parse_waitv(futexv, waiters, nr_futexes);
+	if (!ret)
+		ret = futex_wake_multiple(futexv, nr_futexes);
+
+	kfree(futexv);
+	return ret;
+}
+
 #ifdef CONFIG_COMPAT
 COMPAT_SYSCALL_DEFINE2(set_robust_list,
 		struct compat_robust_list_head __user *, head,
@@ -185,6 +185,84 @@ int futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 	return ret;
 }
 
+/**
+ * futex_wake_multiple - Wake waiters on a list of futexes
+ * @vs:		The futex list to wake, with the number of waiters to wake at
+ *		each address in w.val
+ * @count:	The number of entries in @vs
+ *
+ * All the keys are looked up first, so a fault on any of the addresses fails
+ * the whole call without waking anybody.  Then each hash bucket involved is
+ * locked once, all the entries hashing to it are dealt with, and the woken
+ * tasks are collected on a single wake queue which is only run, once, after
+ * the last bucket has been unlocked.
+ *
+ * Return: The total number of tasks woken, or an error code.
+ */
+int futex_wake_multiple(struct futex_vector *vs, unsigned int count)
+{
+	struct futex_hash_bucket *hb;
+	struct futex_q *this, *next;
+	unsigned int i, j;
+	int ret, woken = 0;
+	DEFINE_WAKE_Q(wake_q);
+
+	for (i = 0; i < count; i++) {
+		u32 __user *uaddr = (u32 __user *)(unsigned long)vs[i].w.uaddr;
+		unsigned int flags = 0;
+
+		if (!vs[i].w.val || vs[i].w.val > INT_MAX)
+			return -EINVAL;
+
+		if (!(vs[i].w.flags & FUTEX_PRIVATE_FLAG))
+			flags |= FLAGS_SHARED;
+
+		ret = get_futex_key(uaddr, flags & FLAGS_SHARED, &vs[i].q.key,
+				    FUTEX_READ);
+		if (unlikely(ret))
+			return ret;
+
+		/* The bucket is remembered in lock_ptr until it's been done. */
+		hb = futex_hash(&vs[i].q.key);
+		vs[i].q.lock_ptr = futex_hb_waiters_pending(hb) ? &hb->lock : NULL;
+	}
+
+	ret = 0;
+	for (i = 0; i < count && !ret; i++) {
+		if (!vs[i].q.lock_ptr)
+			continue;
+		hb = container_of(vs[i].q.lock_ptr, struct futex_hash_bucket, lock);
+
+		spin_lock(&hb->lock);
+		for (j = i; j < count; j++) {
+			int nr = 0;
+
+			if (vs[j].q.lock_ptr != &hb->lock)
+				continue;
+			vs[j].q.lock_ptr = NULL;
+
+			plist_for_each_entry_safe(this, next, &hb->chain, list) {
+				if (!futex_match(&this->key, &vs[j].q.key))
+					continue;
+				if (this->pi_state || this->rt_waiter) {
+					ret = -EINVAL;
+					break;
+				}
+				futex_wake_mark(&wake_q, this);
+				if (++nr >= vs[j].w.val)
+					break;
+			}
+			woken += nr;
+			if (ret)
+				break;
+		}
+		spin_unlock(&hb->lock);
+	}
+
+	wake_up_q(&wake_q);
+	return ret ? ret : woken;
+}
+
 static int futex_atomic_op_inuser(unsigned int encoded_op, u32 __user *uaddr)
 {
 	unsigned int op =	  (encoded_op & 0x70000000) >> 28;
@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * In-kernel balancing of unmanaged interrupts.
+ *
+ * Every irqbalance.interval_ms the worker samples, for each online
+ * housekeeping CPU, the hard and soft interrupt time it accumulated, and
+ * for each interrupt the number of times it fired. The time of a CPU is
+ * shared out between the interrupts it handled in proportion to their
+ * rate, and then interrupts are moved from the busiest CPU to the least
+ * busy one until the two are within irqbalance.threshold_pct of each
+ * other, at most IRQ_BALANCE_MAX_MOVES per pass.
+ *
+ * Only interrupts which could be moved through /proc/irq/N/smp_affinity
+ * are considered, and only to CPUs in their affinity mask: the mask is left
+ * as it was, the balancer merely picks which of its CPUs the interrupt is
+ * delivered to, as the vector allocator does when the mask is first set.
+ * Managed and per CPU interrupts, those marked IRQD_NO_BALANCING, and those
+ * that can only be moved from interrupt context are left alone. If the
+ * irqchip can't target the chosen CPU (e.g. the matrix allocator has no
+ * vector left on it) the interrupt is skipped for this pass.
+ *
+ * The balancer is off unless irqbalance.interval_ms is set, from the
+ * command line or at run time. Without IRQ_TIME_ACCOUNTING the interrupt
+ * rate alone is used as the load.
+ */
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/cpu.h>
+#include <linux/kernel_stat.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/isolation.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "irqbalance."
+
+#define IRQ_BALANCE_MAX_MOVES	8
+
+struct irq_balance_cpu {
+	u64		time;		/* Interrupt time at the last pass */
+	u64		load;		/* Load over the last interval */
+	u64		count;		/* Interrupts over the last interval */
+};
+
+static DEFINE_PER_CPU(struct irq_balance_cpu, irq_balance_cpu);
+
+static struct cpumask irq_balance_cpus;
+static struct cpumask irq_balance_mask;
+
+static unsigned int irq_balance_threshold_pct = 25;
+module_param_named(threshold_pct, irq_balance_threshold_pct, uint, 0644);
+
+static unsigned int irq_balance_moves;
+module_param_named(moves, irq_balance_moves, uint, 0444);
+
+static unsigned int irq_balance_interval_ms;
+
+static void irq_balance_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_balance_work, irq_balance_fn);
+
+static bool irq_balance_ready;
+static bool irq_balance_primed;
+
+static int param_set_irq_balance_interval(const char *val,
+					  const struct kernel_param *kp)
+{
+	int ret = param_set_uint(val, kp);
+
+	if (!ret && READ_ONCE(irq_balance_ready))
+		mod_delayed_work(system_unbound_wq, &irq_balance_work, 0);
+	return ret;
+}
+
+static const struct kernel_param_ops irq_balance_interval_ops = {
+	.set = param_set_irq_balance_interval,
+	.get = param_get_uint,
+};
+module_param_cb(interval_ms, &irq_balance_interval_ops,
+		&irq_balance_interval_ms, 0644);
+
+static u64 irq_balance_cpu_time(unsigned int cpu)
+{
+	u64 *cpustat = kcpustat_cpu(cpu).cpustat;
+
+	return cpustat[CPUTIME_IRQ] + cpustat[CPUTIME_SOFTIRQ];
+}
+
+/*
+ * Return the CPU @desc is delivered to, or nr_cpu_ids if it isn't one we
+ * may move it away from. Called with desc->lock held.
+ */
+static unsigned int irq_balance_target(struct irq_desc *desc)
+{
+	struct irq_data *data = irq_desc_get_irq_data(desc);
+	const struct cpumask *m = irq_data_get_effective_affinity_mask(data);
+
+	if (!desc->action || !irqd_can_balance(data) ||
+	    irqd_affinity_is_managed(data) || irqd_is_per_cpu(data) ||
+	    irq_settings_is_per_cpu_devid(desc) ||
+	    !irqd_is_started(data) || !irq_can_move_pcntxt(data) ||
+	    irqd_is_setaffinity_pending(data))
+		return nr_cpu_ids;
+
+	if (cpumask_empty(m))
+		m = irq_data_get_affinity_mask(data);
+	if (cpumask_weight(m) != 1)
+		return nr_cpu_ids;
+
+	return cpumask_first(m);
+}
+
+/*
+ * Sample the interrupt counts since the last pass: account them to the CPU
+ * each interrupt was delivered to and remember them in the descriptor.
+ */
+static void irq_balance_sample(void)
+{
+	struct irq_desc *desc;
+	unsigned int irq, cpu, count;
+	u64 total = 0;
+
+	for_each_cpu(cpu, &irq_balance_cpus) {
+		struct irq_balance_cpu *ibc = per_cpu_ptr(&irq_balance_cpu, cpu);
+		u64 time = irq_balance_cpu_time(cpu);
+
+		ibc->load = time - ibc->time;
+		ibc->time = time;
+		ibc->count = 0;
+		total += ibc->load;
+	}
+
+	for_each_active_irq(irq) {
+		desc = irq_to_desc(irq);
+		raw_spin_lock_irq(&desc->lock);
+		count = data_race(desc->tot_count);
+		desc->balance_delta = count - desc->balance_count;
+		desc->balance_count = count;
+		cpu = irq_balance_target(desc);
+		if (cpu < nr_cpu_ids && cpumask_test_cpu(cpu, &irq_balance_cpus))
+			per_cpu_ptr(&irq_balance_cpu, cpu)->count += desc->balance_delta;
+		else
+			desc->balance_delta = 0;
+		raw_spin_unlock_irq(&desc->lock);
+	}
+
+	/* No interrupt time accounting: the rate is the load. */
+	if (!total) {
+		for_each_cpu(cpu, &irq_balance_cpus) {
+			struct irq_balance_cpu *ibc = per_cpu_ptr(&irq_balance_cpu, cpu);
+
+			ibc->load = ibc->count;
+		}
+	}
+}
+
+static u64 irq_balance_weight(struct irq_balance_cpu *ibc, unsigned int delta)
+{
+	if (!ibc->count)
+		return 0;
+	return div64_u64(ibc->load * delta, ibc->count);
+}
+
+/*
+ * Move the heaviest interrupt on @src that fits into the imbalance @gap and
+ * may run on @dst. Returns the load that was moved, zero if none.
+ */
+static u64 irq_balance_move_one(unsigned int src, unsigned int dst, u64 gap)
+{
+	struct irq_balance_cpu *ibc = per_cpu_ptr(&irq_balance_cpu, src);
+	struct irq_desc *desc, *best = NULL;
+	unsigned int irq, best_irq = 0, best_delta = 0;
+	u64 w, best_w = 0;
+	int ret;
+
+	for_each_active_irq(irq) {
+		desc = irq_to_desc(irq);
+		raw_spin_lock_irq(&desc->lock);
+		w = irq_balance_weight(ibc, desc->balance_delta);
+		if (w > best_w && w < gap && irq_balance_target(desc) == src &&
+		    cpumask_test_cpu(dst, irq_data_get_affinity_mask(&desc->irq_data))) {
+			best = desc;
+			best_irq = irq;
+			best_delta = desc->balance_delta;
+			best_w = w;
+		}
+		raw_spin_unlock_irq(&desc->lock);
+	}
+
+	if (!best)
+		return 0;
+
+	raw_spin_lock_irq(&best->lock);
+	if (irq_balance_target(best) != src) {
+		raw_spin_unlock_irq(&best->lock);
+		return 0;
+	}
+	/* Keep the affinity mask the user asked for, only retarget. */
+	cpumask_copy(&irq_balance_mask, irq_data_get_affinity_mask(&best->irq_data));
+	ret = irq_do_set_affinity(&best->irq_data, cpumask_of(dst), false);
+	cpumask_copy(best->irq_common_data.affinity, &irq_balance_mask);
+	/* Don't pick it again this pass. */
+	best->balance_delta = 0;
+	raw_spin_unlock_irq(&best->lock);
+
+	if (ret) {
+		pr_debug("IRQ %u: can't move from CPU%u to CPU%u: %d\n",
+			 best_irq, src, dst, ret);
+		return 0;
+	}
+
+	irq_balance_moves++;
+	ibc->count -= best_delta;
+	per_cpu_ptr(&irq_balance_cpu, dst)->count += best_delta;
+	return best_w;
+}
+
+static void irq_balance_pass(void)
+{
+	unsigned int i, cpu, src, dst;
+	u64 max, min, gap, moved;
+
+	irq_balance_sample();
+
+	/* The first sample after being enabled covers an unknown interval. */
+	if (!irq_balance_primed) {
+		irq_balance_primed = true;
+		return;
+	}
+
+	for (i = 0; i < IRQ_BALANCE_MAX_MOVES; i++) {
+		max = 0;
+		min = U64_MAX;
+		src = dst = nr_cpu_ids;
+		for_each_cpu(cpu, &irq_balance_cpus) {
+			u64 load = per_cpu_ptr(&irq_balance_cpu, cpu)->load;
+
+			if (load >= max) {
+				max = load;
+				src = cpu;
+			}
+			if (load < min) {
+				min = load;
+				dst = cpu;
+			}
+		}
+
+		if (src >= nr_cpu_ids || src == dst)
+			return;
+		gap = max - min;
+		if (gap * 100 <= max * irq_balance_threshold_pct)
+			return;
+
+		moved = irq_balance_move_one(src, dst, gap);
+		if (!moved)
+			return;
+
+		per_cpu_ptr(&irq_balance_cpu, src)->load -= moved;
+		per_cpu_ptr(&irq_balance_cpu, dst)->load += moved;
+	}
+}
+
+static void irq_balance_fn(struct work_struct *work)
+{
+	unsigned int interval = READ_ONCE(irq_balance_interval_ms);
+
+	if (!interval) {
+		irq_balance_primed = false;
+		return;
+	}
+
+	cpus_read_lock();
+	irq_lock_sparse();
+
+	cpumask_and(&irq_balance_cpus, cpu_online_mask, irq_default_affinity);
+	cpumask_and(&irq_balance_cpus, &irq_balance_cpus,
+		    housekeeping_cpumask(HK_TYPE_DOMAIN));
+	irq_balance_pass();
+
+	irq_unlock_sparse();
+	cpus_read_unlock();
+
+	queue_delayed_work(system_unbound_wq, &irq_balance_work,
+			   msecs_to_jiffies(interval));
+}
+
+static int __init irq_balance_init(void)
+{
+	WRITE_ONCE(irq_balance_ready, true);
+	if (irq_balance_interval_ms)
+		queue_delayed_work(system_unbound_wq, &irq_balance_work, 0);
+	return 0;
+}
+late_initcall(irq_balance_init);
@@ -177,3 +177,142 @@ static int __init init_lockevent_counts(void)
 	return -ENOMEM;
 }
 fs_initcall(init_lockevent_counts);
+
+#ifdef CONFIG_LOCK_CLASS_STATS
+#include <linux/log2.h>
+#include <linux/seq_file.h>
+
+/*
+ * Per lock class statistics, reported in <debugfs>/lock_class_stats.
+ *
+ * Each line gives the class name, then the number of optimistic spins that
+ * took the lock and that gave up, the number of waits and of handoffs, the
+ * total spin and sleep time in ns, and then histograms of the spin times
+ * and of the sleep times, in buckets of <1us, <4us, <16us, ... and >=4ms.
+ *
+ * Like the event counts these are per-cpu and updated without disabling
+ * preemption, so updating them is cheap and the odd update may get lost.  The
+ * first LOCKCLASS_MAX classes to be initialised get their own entry; class 0
+ * collects the statically initialised locks and anything beyond that.
+ */
+#define LOCKCLASS_MAX		128
+#define LOCKCLASS_NAME_LEN	32
+#define LOCKCLASS_BUCKETS	8
+
+struct lockclass_stats {
+	unsigned long	count[LOCKCLASS_NR_STATS];
+	u64		spin_ns;
+	u64		sleep_ns;
+	unsigned long	spin_hist[LOCKCLASS_BUCKETS];
+	unsigned long	sleep_hist[LOCKCLASS_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct lockclass_stats, lockclass_stats[LOCKCLASS_MAX]);
+static char lockclass_names[LOCKCLASS_MAX][LOCKCLASS_NAME_LEN] = { "<other>" };
+static unsigned int lockclass_nr = 1;
+static DEFINE_RAW_SPINLOCK(lockclass_lock);
+
+unsigned int lockclass_register(const char *name, struct lock_class_key *key)
+{
+	unsigned int id = READ_ONCE(key->class_stats_id);
+	unsigned long flags;
+
+	if (id || !name)
+		return id;
+
+	raw_spin_lock_irqsave(&lockclass_lock, flags);
+	id = key->class_stats_id;
+	if (!id && lockclass_nr < LOCKCLASS_MAX) {
+		id = lockclass_nr;
+		strscpy(lockclass_names[id], name, LOCKCLASS_NAME_LEN);
+		/* Make the name visible before the id is counted. */
+		smp_store_release(&lockclass_nr, id + 1);
+		WRITE_ONCE(key->class_stats_id, id);
+	}
+	raw_spin_unlock_irqrestore(&lockclass_lock, flags);
+
+	return id;
+}
+
+static inline unsigned int lockclass_bucket(u64 ns)
+{
+	if (ns < 1024)
+		return 0;
+	return min_t(unsigned int, (ilog2(ns >> 10) >> 1) + 1,
+		     LOCKCLASS_BUCKETS - 1);
+}
+
+void __lockclass_spin(unsigned int id, u64 start, bool taken)
+{
+	struct lockclass_stats *s = raw_cpu_ptr(&lockclass_stats[id]);
+	u64 ns = local_clock() - start;
+
+	s->count[taken ? LOCKCLASS_SPIN_TAKEN : LOCKCLASS_SPIN_FAILED]++;
+	s->spin_ns += ns;
+	s->spin_hist[lockclass_bucket(ns)]++;
+}
+
+void __lockclass_sleep(unsigned int id, u64 start)
+{
+	struct lockclass_stats *s = raw_cpu_ptr(&lockclass_stats[id]);
+	u64 ns = local_clock() - start;
+
+	s->count[LOCKCLASS_SLEEP]++;
+	s->sleep_ns += ns;
+	s->sleep_hist[lockclass_bucket(ns)]++;
+}
+
+void __lockclass_handoff(unsigned int id)
+{
+	raw_cpu_inc(lockclass_stats[id].count[LOCKCLASS_HANDOFF]);
+}
+
+static int lockclass_show(struct seq_file *m, void *v)
+{
+	unsigned int nr = smp_load_acquire(&lockclass_nr);
+	struct lockclass_stats sum;
+	unsigned int id, cpu, i;
+
+	for (id = 0; id < nr; id++) {
+		memset(&sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct lockclass_stats *s = per_cpu_ptr(&lockclass_stats[id], cpu);
+
+			for (i = 0; i < LOCKCLASS_NR_STATS; i++)
+				sum.count[i] += READ_ONCE(s->count[i]);
+			sum.spin_ns += READ_ONCE(s->spin_ns);
+			sum.sleep_ns += READ_ONCE(s->sleep_ns);
+			for (i = 0; i < LOCKCLASS_BUCKETS; i++) {
+				sum.spin_hist[i] += READ_ONCE(s->spin_hist[i]);
+				sum.sleep_hist[i] += READ_ONCE(s->sleep_hist[i]);
+			}
+		}
+
+		/* Only show the classes that have seen contention. */
+		if (!sum.count[LOCKCLASS_SPIN_TAKEN] &&
+		    !sum.count[LOCKCLASS_SPIN_FAILED] &&
+		    !sum.count[LOCKCLASS_SLEEP])
+			continue;
+
+		seq_printf(m, "%-*s", LOCKCLASS_NAME_LEN, lockclass_names[id]);
+		for (i = 0; i < LOCKCLASS_NR_STATS; i++)
+			seq_printf(m, " %lu", sum.count[i]);
+		seq_printf(m, " %llu %llu", sum.spin_ns, sum.sleep_ns);
+		for (i = 0; i < LOCKCLASS_BUCKETS; i++)
+			seq_printf(m, " %lu", sum.spin_hist[i]);
+		for (i = 0; i < LOCKCLASS_BUCKETS; i++)
+			seq_printf(m, " %lu", sum.sleep_hist[i]);
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(lockclass);
+
+static int __init init_lockclass_stats(void)
+{
+	debugfs_create_file("lock_class_stats", 0400, NULL, NULL,
+			    &lockclass_fops);
+	return 0;
+}
+fs_initcall(init_lockclass_stats);
+#endif /* CONFIG_LOCK_CLASS_STATS */
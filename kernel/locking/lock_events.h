@@ -57,4 +57,51 @@ static inline void __lockevent_add(enum lock_events event, int inc)
 #define lockevent_cond_inc(ev, c)
 
 #endif /* CONFIG_LOCK_EVENT_COUNTS */
+
+#ifdef CONFIG_LOCK_CLASS_STATS
+#include <linux/sched/clock.h>
+
+/*
+ * Per lock class statistics of the sleeping locks: how long optimistic
+ * spinning took and whether it got the lock, how long the waiters slept and
+ * how often the handoff protocol had to be used.  A lock class is the init
+ * site of the lock, as with lockdep, and the locks know their class by the
+ * id assigned to its key in lockclass_register().
+ */
+enum lockclass_stat {
+	LOCKCLASS_SPIN_TAKEN,
+	LOCKCLASS_SPIN_FAILED,
+	LOCKCLASS_SLEEP,
+	LOCKCLASS_HANDOFF,
+	LOCKCLASS_NR_STATS
+};
+
+extern unsigned int lockclass_register(const char *name,
+				       struct lock_class_key *key);
+extern void __lockclass_spin(unsigned int id, u64 start, bool taken);
+extern void __lockclass_sleep(unsigned int id, u64 start);
+extern void __lockclass_handoff(unsigned int id);
+
+static inline u64 lockclass_clock(void)
+{
+	return local_clock();
+}
+
+#define lockclass_spin(l, start, taken)	\
+	__lockclass_spin((l)->class_stats_id, start, taken)
+#define lockclass_sleep(l, start)	__lockclass_sleep((l)->class_stats_id, start)
+#define lockclass_handoff(l)		__lockclass_handoff((l)->class_stats_id)
+
+#else  /* CONFIG_LOCK_CLASS_STATS */
+
+static inline u64 lockclass_clock(void)
+{
+	return 0;
+}
+
+#define lockclass_spin(l, start, taken)	do { (void)(start); } while (0)
+#define lockclass_sleep(l, start)	do { (void)(start); } while (0)
+#define lockclass_handoff(l)		do { } while (0)
+
+#endif /* CONFIG_LOCK_CLASS_STATS */
 #endif /* __LOCKING_LOCK_EVENTS_H */
@@ -660,6 +660,58 @@ static struct lock_torture_ops percpu_rwsem_lock_ops = {
 	.name		= "percpu_rwsem_lock"
 };
 
+#include <linux/numa-rwsem.h>
+static struct numa_rw_semaphore numa_rwsem;
+
+static void torture_numa_rwsem_init(void)
+{
+	BUG_ON(numa_init_rwsem(&numa_rwsem));
+}
+
+static void torture_numa_rwsem_exit(void)
+{
+	numa_free_rwsem(&numa_rwsem);
+}
+
+static int torture_numa_rwsem_down_write(int tid __maybe_unused)
+__acquires(numa_rwsem)
+{
+	numa_down_write(&numa_rwsem);
+	return 0;
+}
+
+static void torture_numa_rwsem_up_write(int tid __maybe_unused)
+__releases(numa_rwsem)
+{
+	numa_up_write(&numa_rwsem);
+}
+
+static int torture_numa_rwsem_down_read(int tid __maybe_unused)
+__acquires(numa_rwsem)
+{
+	numa_down_read(&numa_rwsem);
+	return 0;
+}
+
+static void torture_numa_rwsem_up_read(int tid __maybe_unused)
+__releases(numa_rwsem)
+{
+	numa_up_read(&numa_rwsem);
+}
+
+static struct lock_torture_ops numa_rwsem_lock_ops = {
+	.init		= torture_numa_rwsem_init,
+	.exit		= torture_numa_rwsem_exit,
+	.writelock	= torture_numa_rwsem_down_write,
+	.write_delay	= torture_rwsem_write_delay,
+	.task_boost     = torture_boost_dummy,
+	.writeunlock	= torture_numa_rwsem_up_write,
+	.readlock       = torture_numa_rwsem_down_read,
+	.read_delay     = torture_rwsem_read_delay,
+	.readunlock     = torture_numa_rwsem_up_read,
+	.name		= "numa_rwsem_lock"
+};
+
 /*
  * Lock torture writer kthread.  Repeatedly acquires and releases
  * the lock, checking for duplicate acquisitions.
@@ -912,6 +964,7 @@ static int __init lock_torture_init(void)
 #endif
 		&rwsem_lock_ops,
 		&percpu_rwsem_lock_ops,
+		&numa_rwsem_lock_ops,
 	};
 
 	if (!torture_init_begin(torture_type, verbose))
@@ -35,6 +35,7 @@
 
 #ifndef CONFIG_PREEMPT_RT
 #include "mutex.h"
+#include "lock_events.h"
 
 #ifdef CONFIG_DEBUG_MUTEXES
 # define MUTEX_WARN_ON(cond) DEBUG_LOCKS_WARN_ON(cond)
@@ -51,6 +52,9 @@ __mutex_init(struct mutex *lock, const char *name, struct lock_class_key *key)
 #ifdef CONFIG_MUTEX_SPIN_ON_OWNER
 	osq_lock_init(&lock->osq);
 #endif
+#ifdef CONFIG_LOCK_CLASS_STATS
+	lock->class_stats_id = lockclass_register(name, key);
+#endif
 
 	debug_mutex_init(lock, name, key);
 }
@@ -246,6 +250,9 @@ static void __mutex_handoff(struct mutex *lock, struct task_struct *task)
 		if (atomic_long_try_cmpxchg_release(&lock->owner, &owner, new))
 			break;
 	}
+
+	if (task)
+		lockclass_handoff(lock);
 }
 
 #ifndef CONFIG_DEBUG_LOCK_ALLOC
@@ -441,6 +448,8 @@ static __always_inline bool
 mutex_optimistic_spin(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 		      struct mutex_waiter *waiter)
 {
+	u64 start;
+
 	if (!waiter) {
 		/*
 		 * The purpose of the mutex_can_spin_on_owner() function is
@@ -461,6 +470,7 @@ mutex_optimistic_spin(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 			goto fail;
 	}
 
+	start = lockclass_clock();
 	for (;;) {
 		struct task_struct *owner;
 
@@ -488,12 +498,14 @@ mutex_optimistic_spin(struct mutex *lock, struct ww_acquire_ctx *ww_ctx,
 	if (!waiter)
 		osq_unlock(&lock->osq);
 
+	lockclass_spin(lock, start, true);
 	return true;
 
 
 fail_unlock:
 	if (!waiter)
 		osq_unlock(&lock->osq);
+	lockclass_spin(lock, start, false);
 
 fail:
 	/*
@@ -572,6 +584,7 @@ __mutex_lock_common(struct mutex *lock, unsigned int state, unsigned int subclas
 {
 	struct mutex_waiter waiter;
 	struct ww_mutex *ww;
+	u64 wait_start;
 	int ret;
 
 	if (!use_ww_ctx)
@@ -627,6 +640,7 @@ __mutex_lock_common(struct mutex *lock, unsigned int state, unsigned int subclas
 
 	debug_mutex_lock_common(lock, &waiter);
 	waiter.task = current;
+	wait_start = lockclass_clock();
 	if (use_ww_ctx)
 		waiter.ww_ctx = ww_ctx;
 
@@ -701,6 +715,7 @@ __mutex_lock_common(struct mutex *lock, unsigned int state, unsigned int subclas
 	raw_spin_lock(&lock->wait_lock);
 acquired:
 	__set_current_state(TASK_RUNNING);
+	lockclass_sleep(lock, wait_start);
 
 	if (ww_ctx) {
 		/*
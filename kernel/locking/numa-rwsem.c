@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#include <linux/atomic.h>
+#include <linux/slab.h>
+#include <linux/nodemask.h>
+#include <linux/lockdep.h>
+#include <linux/numa-rwsem.h>
+#include <linux/rcuwait.h>
+#include <linux/sched.h>
+#include <linux/errno.h>
+#include <linux/export.h>
+
+int __numa_init_rwsem(struct numa_rw_semaphore *sem,
+		      const char *name, struct lock_class_key *key)
+{
+	int node;
+
+	sem->nodes = kcalloc(nr_node_ids, sizeof(*sem->nodes), GFP_KERNEL);
+	if (unlikely(!sem->nodes))
+		return -ENOMEM;
+
+	for_each_node(node) {
+		sem->nodes[node] = kzalloc_node(sizeof(struct numa_rwsem_node),
+						GFP_KERNEL, node);
+		if (unlikely(!sem->nodes[node])) {
+			numa_free_rwsem(sem);
+			return -ENOMEM;
+		}
+	}
+
+	rcuwait_init(&sem->writer);
+	atomic_set(&sem->block, 0);
+	init_rwsem(&sem->rw_sem);
+	/* The outer lock is what lockdep needs to know about. */
+	lockdep_set_novalidate_class(&sem->rw_sem);
+#ifdef CONFIG_DEBUG_LOCK_ALLOC
+	debug_check_no_locks_freed((void *)sem, sizeof(*sem));
+	lockdep_init_map(&sem->dep_map, name, key, 0);
+#endif
+	return 0;
+}
+EXPORT_SYMBOL_GPL(__numa_init_rwsem);
+
+void numa_free_rwsem(struct numa_rw_semaphore *sem)
+{
+	int node;
+
+	/* Like percpu_free_rwsem(), this is safe after kzalloc(). */
+	if (!sem->nodes)
+		return;
+
+	for_each_node(node)
+		kfree(sem->nodes[node]);
+	kfree(sem->nodes);
+	sem->nodes = NULL; /* catch use after free bugs */
+}
+EXPORT_SYMBOL_GPL(numa_free_rwsem);
+
+/*
+ * The fast path saw a writer and backed out.  Prod the writer, which may be
+ * waiting for the counters to drain, and unless this is a trylock wait for
+ * it to be done.  No writer can be active while we hold the inner rwsem, so
+ * the increment can't be missed by the next one.
+ */
+bool __numa_down_read(struct numa_rw_semaphore *sem, bool try)
+{
+	rcuwait_wake_up(&sem->writer);
+
+	if (try)
+		return false;
+
+	down_read(&sem->rw_sem);
+	atomic_long_inc(__numa_rwsem_count(sem));
+	up_read(&sem->rw_sem);
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(__numa_down_read);
+
+static bool readers_active_check(struct numa_rw_semaphore *sem)
+{
+	long sum = 0;
+	int node;
+
+	for_each_node(node)
+		sum += atomic_long_read(&sem->nodes[node]->read_count);
+
+	if (sum)
+		return false;
+
+	/*
+	 * If we observed the decrement; ensure we see the entire critical
+	 * section.
+	 */
+	smp_mb(); /* C matches B */
+
+	return true;
+}
+
+void numa_down_write(struct numa_rw_semaphore *sem)
+{
+	might_sleep();
+	rwsem_acquire(&sem->dep_map, 0, 0, _RET_IP_);
+
+	/* Exclude other writers, and park the readers that see us. */
+	down_write(&sem->rw_sem);
+
+	/*
+	 * Block new readers; any reader that increments its counter after
+	 * this is guaranteed to see it and back out.
+	 */
+	atomic_set(&sem->block, 1);
+	smp_mb(); /* D matches A */
+
+	/* Wait for the readers already inside to leave. */
+	rcuwait_wait_event(&sem->writer, readers_active_check(sem),
+			   TASK_UNINTERRUPTIBLE);
+}
+EXPORT_SYMBOL_GPL(numa_down_write);
+
+void numa_up_write(struct numa_rw_semaphore *sem)
+{
+	rwsem_release(&sem->dep_map, _RET_IP_);
+
+	/*
+	 * Signal the writer is done, no fast path yet.  The release pairs
+	 * with the acquire in __numa_down_read_trylock().
+	 */
+	atomic_set_release(&sem->block, 0);
+
+	/* Let in the readers that found us here, and the next writer. */
+	up_write(&sem->rw_sem);
+}
+EXPORT_SYMBOL_GPL(numa_up_write);
@@ -0,0 +1,257 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _GEN_CNA_LOCK_SLOWPATH
+#error "do not include this file"
+#endif
+
+#include <linux/topology.h>
+#include <linux/sched/clock.h>
+#include <linux/sched/rt.h>
+
+/*
+ * Implement a NUMA-aware version of MCS (aka CNA, or compact NUMA-aware lock).
+ *
+ * In CNA, spinning threads are organized in two queues, a primary queue for
+ * threads running on the same NUMA node as the current lock holder, and a
+ * secondary queue for threads running on other nodes. Schematically, it
+ * looks like this:
+ *
+ *    cna_node
+ *   +----------+     +--------+         +--------+
+ *   |mcs:next  | --> |mcs:next| --> ... |mcs:next| --> NULL  [Primary queue]
+ *   |mcs:locked| -.  +--------+         +--------+
+ *   +----------+  |
+ *                 `----------------------.
+ *                                        v
+ *                 +--------+         +--------+
+ *                 |mcs:next| --> ... |mcs:next|            [Secondary queue]
+ *                 +--------+         +--------+
+ *                     ^                    |
+ *                     `--------------------'
+ *
+ * N.B. locked := 1 if secondary queue is absent. Otherwise, it contains the
+ * encoded pointer to the tail of the secondary queue, which is organized as a
+ * circular list. The encoded tail may have the top bit set, so @locked must
+ * be looked at as a u32.
+ *
+ * When the lock is passed on, the holder looks for the first waiter in the
+ * primary queue that runs on its own node and hands the lock to it, moving
+ * the waiters that were skipped to the tail of the secondary queue. Only
+ * waiters that have a successor are moved, so the nodes being relinked are
+ * never the lock's tail and their next pointers cannot change under us.
+ *
+ * The secondary queue is put back in front of the primary queue when the
+ * primary queue runs dry, or when its oldest waiters have been kept waiting
+ * for longer than numa_spinlock_threshold, which bounds the unfairness.
+ *
+ * Waiters that are not running in task context, and real-time tasks, are
+ * never moved to the secondary queue, so they cannot be delayed by it.
+ *
+ * For more details, see https://arxiv.org/abs/1810.05600.
+ *
+ * Authors: Alex Kogan <alex.kogan@oracle.com>
+ *          Dave Dice <dave.dice@oracle.com>
+ */
+
+struct cna_node {
+	struct mcs_spinlock	mcs;
+	u16			numa_node;
+	u8			priority;	/* Never move to the secondary queue */
+	u32			encoded_tail;	/* Our own encoded tail */
+	u64			start_time;	/* When the secondary queue was started */
+};
+
+static ulong numa_spinlock_threshold_ns __ro_after_init = 1000000;	/* 1ms */
+
+void __cna_queued_spin_lock_slowpath(struct qspinlock *lock, u32 val);
+
+static void __init cna_init_nodes_per_cpu(unsigned int cpu)
+{
+	struct mcs_spinlock *base = per_cpu_ptr(&qnodes[0].mcs, cpu);
+	int i;
+
+	for (i = 0; i < MAX_NODES; i++) {
+		struct cna_node *cn = (struct cna_node *)grab_mcs_node(base, i);
+
+		cn->numa_node = cpu_to_node(cpu);
+		cn->encoded_tail = encode_tail(cpu, i);
+		/*
+		 * make sure @encoded_tail is not confused with other valid
+		 * values for @locked (0 or 1)
+		 */
+		WARN_ON(cn->encoded_tail <= 1);
+	}
+}
+
+static void __init cna_init_nodes(void)
+{
+	unsigned int cpu;
+
+	/*
+	 * struct cna_node must fit the qnode; the padding that was added
+	 * for pvqspinlock is reused for it.
+	 */
+	BUILD_BUG_ON(sizeof(struct cna_node) > sizeof(struct qnode));
+
+	for_each_possible_cpu(cpu)
+		cna_init_nodes_per_cpu(cpu);
+}
+
+static __always_inline void cna_init_node(struct mcs_spinlock *node)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+
+	cn->priority = !in_task() || rt_task(current);
+}
+
+static __always_inline bool cna_is_local(struct cna_node *cn,
+					 struct cna_node *other)
+{
+	return other->priority || other->numa_node == cn->numa_node;
+}
+
+/*
+ * cna_try_clear_tail - try to clear the lock tail, or if there are waiters
+ * in the secondary queue, to make them the primary queue.
+ *
+ * Called by the queue head when it is also the tail of the primary queue.
+ * The secondary queue isn't visible to anybody else, so the tail of it can
+ * be detached before it's published as the lock tail.
+ */
+static inline bool cna_try_clear_tail(struct qspinlock *lock, u32 val,
+				      struct mcs_spinlock *node)
+{
+	struct mcs_spinlock *stail, *shead;
+	u32 new;
+
+	if ((u32)node->locked <= 1)
+		return __try_clear_tail(lock, val, node);
+
+	stail = decode_tail(node->locked);
+	shead = stail->next;
+	new = ((struct cna_node *)stail)->encoded_tail | _Q_LOCKED_VAL;
+
+	stail->next = NULL;
+	if (atomic_try_cmpxchg_release(&lock->val, &val, new)) {
+		/* The secondary queue is the primary queue now. */
+		smp_store_release(&shead->locked, 1);
+		return true;
+	}
+	stail->next = shead;
+
+	return false;
+}
+
+/*
+ * cna_lock_handoff - pass the MCS lock to the next waiter
+ *
+ * Prefer the first waiter in the primary queue that runs on our node,
+ * moving the ones before it to the secondary queue, unless the secondary
+ * queue has been waiting for too long, in which case it goes first.
+ */
+static inline void cna_lock_handoff(struct mcs_spinlock *node,
+				    struct mcs_spinlock *next)
+{
+	struct cna_node *cn = (struct cna_node *)node;
+	struct cna_node *succ = (struct cna_node *)next;
+	struct mcs_spinlock *stail = NULL, *last = NULL, *iter;
+	u32 val = 1;
+
+	if ((u32)node->locked > 1) {
+		val = node->locked;
+		stail = decode_tail(val);
+	}
+
+	if (stail &&
+	    local_clock() - cn->start_time > numa_spinlock_threshold_ns) {
+		/* Splice the secondary queue in front of @next. */
+		succ = (struct cna_node *)stail->next;
+		stail->next = next;
+		val = 1;
+		goto pass;
+	}
+
+	for (iter = next; iter && !cna_is_local(cn, (struct cna_node *)iter);
+	     iter = READ_ONCE(iter->next))
+		last = iter;
+
+	if (iter && last) {
+		/* Move @next .. @last to the tail of the secondary queue. */
+		if (stail) {
+			last->next = stail->next;
+			stail->next = next;
+		} else {
+			last->next = next;
+			cn->start_time = local_clock();
+		}
+		val = ((struct cna_node *)last)->encoded_tail;
+		succ = (struct cna_node *)iter;
+	}
+
+pass:
+	if (val > 1)
+		succ->start_time = cn->start_time;
+	smp_store_release(&succ->mcs.locked, val);
+}
+
+/*
+ * Switch to the NUMA-aware slow path for spin locks when we are on a NUMA
+ * system and nothing else (e.g. a hypervisor) has taken over the slow path,
+ * unless it was disabled or forced with the numa_spinlock= boot option.
+ */
+enum {
+	NUMA_SPINLOCK_AUTO,
+	NUMA_SPINLOCK_ON,
+	NUMA_SPINLOCK_OFF,
+};
+
+static int numa_spinlock_flag __initdata = NUMA_SPINLOCK_AUTO;
+
+static int __init numa_spinlock_setup(char *str)
+{
+	if (!strcmp(str, "auto")) {
+		numa_spinlock_flag = NUMA_SPINLOCK_AUTO;
+		return 1;
+	} else if (!strcmp(str, "on")) {
+		numa_spinlock_flag = NUMA_SPINLOCK_ON;
+		return 1;
+	} else if (!strcmp(str, "off")) {
+		numa_spinlock_flag = NUMA_SPINLOCK_OFF;
+		return 1;
+	}
+
+	return 0;
+}
+__setup("numa_spinlock=", numa_spinlock_setup);
+
+/*
+ * The threshold is given in milliseconds.
+ */
+static int __init numa_spinlock_threshold_setup(char *str)
+{
+	unsigned int ms;
+
+	if (kstrtouint(str, 0, &ms))
+		return 0;
+
+	numa_spinlock_threshold_ns = (ulong)ms * NSEC_PER_MSEC;
+	return 1;
+}
+__setup("numa_spinlock_threshold=", numa_spinlock_threshold_setup);
+
+void __init cna_configure_spin_lock_slowpath(void)
+{
+	if (numa_spinlock_flag == NUMA_SPINLOCK_OFF)
+		return;
+
+	if (numa_spinlock_flag == NUMA_SPINLOCK_AUTO &&
+	    (nr_node_ids < 2 ||
+	     pv_ops.lock.queued_spin_lock_slowpath !=
+			native_queued_spin_lock_slowpath))
+		return;
+
+	cna_init_nodes();
+
+	pv_ops.lock.queued_spin_lock_slowpath = __cna_queued_spin_lock_slowpath;
+
+	pr_info("Enabling CNA spinlock\n");
+}
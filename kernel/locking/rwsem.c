@@ -330,6 +330,9 @@ void __init_rwsem(struct rw_semaphore *sem, const char *name,
 #ifdef CONFIG_RWSEM_SPIN_ON_OWNER
 	osq_lock_init(&sem->osq);
 #endif
+#ifdef CONFIG_LOCK_CLASS_STATS
+	sem->class_stats_id = lockclass_register(name, key);
+#endif
 }
 EXPORT_SYMBOL(__init_rwsem);
 
@@ -469,6 +472,7 @@ static void rwsem_mark_wake(struct rw_semaphore *sem,
 				if (!(oldcount & RWSEM_FLAG_HANDOFF)) {
 					adjustment -= RWSEM_FLAG_HANDOFF;
 					lockevent_inc(rwsem_rlock_handoff);
+					lockclass_handoff(sem);
 				}
 				waiter->handoff_set = true;
 			}
@@ -657,6 +661,7 @@ static inline bool rwsem_try_write_lock(struct rw_semaphore *sem,
 	if (new & RWSEM_FLAG_HANDOFF) {
 		waiter->handoff_set = true;
 		lockevent_inc(rwsem_wlock_handoff);
+		lockclass_handoff(sem);
 		return false;
 	}
 
@@ -828,6 +833,7 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 	int prev_owner_state = OWNER_NULL;
 	int loop = 0;
 	u64 rspin_threshold = 0;
+	u64 start;
 
 	preempt_disable();
 
@@ -835,6 +841,8 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 	if (!osq_lock(&sem->osq))
 		goto done;
 
+	start = lockclass_clock();
+
 	/*
 	 * Optimistically spin on the owner field and attempt to acquire the
 	 * lock whenever the owner changes. Spinning will be stopped when:
@@ -937,6 +945,7 @@ static bool rwsem_optimistic_spin(struct rw_semaphore *sem)
 		cpu_relax();
 	}
 	osq_unlock(&sem->osq);
+	lockclass_spin(sem, start, taken);
 done:
 	preempt_enable();
 	lockevent_cond_inc(rwsem_opt_fail, !taken);
@@ -1007,6 +1016,7 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 	long adjustment = -RWSEM_READER_BIAS;
 	long rcnt = (count >> RWSEM_READER_SHIFT);
 	struct rwsem_waiter waiter;
+	u64 wait_start;
 	DEFINE_WAKE_Q(wake_q);
 
 	/*
@@ -1041,6 +1051,7 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 	}
 
 queue:
+	wait_start = lockclass_clock();
 	waiter.task = current;
 	waiter.type = RWSEM_WAITING_FOR_READ;
 	waiter.timeout = jiffies + RWSEM_WAIT_TIMEOUT;
@@ -1098,6 +1109,7 @@ rwsem_down_read_slowpath(struct rw_semaphore *sem, long count, unsigned int stat
 
 	__set_current_state(TASK_RUNNING);
 	lockevent_inc(rwsem_rlock);
+	lockclass_sleep(sem, wait_start);
 	trace_contention_end(sem, 0);
 	return sem;
 
@@ -1116,6 +1128,7 @@ static struct rw_semaphore __sched *
 rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 {
 	struct rwsem_waiter waiter;
+	u64 wait_start;
 	DEFINE_WAKE_Q(wake_q);
 
 	/* do optimistic spinning and steal lock if possible */
@@ -1128,6 +1141,7 @@ rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 	 * Optimistic spinning failed, proceed to the slowpath
 	 * and block until we can acquire the sem.
 	 */
+	wait_start = lockclass_clock();
 	waiter.task = current;
 	waiter.type = RWSEM_WAITING_FOR_WRITE;
 	waiter.timeout = jiffies + RWSEM_WAIT_TIMEOUT;
@@ -1196,6 +1210,7 @@ rwsem_down_write_slowpath(struct rw_semaphore *sem, int state)
 	__set_current_state(TASK_RUNNING);
 	raw_spin_unlock_irq(&sem->wait_lock);
 	lockevent_inc(rwsem_wlock);
+	lockclass_sleep(sem, wait_start);
 	trace_contention_end(sem, 0);
 	return sem;
 
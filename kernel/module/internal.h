@@ -65,6 +65,9 @@ struct load_info {
 	unsigned long symoffs, stroffs, init_typeoffs, core_typeoffs;
 	struct _ddebug_info dyndbg;
 	bool sig_ok;
+	/* load time stats, copied into the module once it is allocated */
+	u32 read_us, decompress_us, sig_us;
+	ktime_t layout_start;
 #ifdef CONFIG_KALLSYMS
 	unsigned long mod_kallsyms_init_off;
 #endif
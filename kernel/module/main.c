@@ -23,6 +23,7 @@
 #include <linux/seq_file.h>
 #include <linux/syscalls.h>
 #include <linux/fcntl.h>
+#include <linux/file.h>
 #include <linux/rcupdate.h>
 #include <linux/capability.h>
 #include <linux/cpu.h>
@@ -54,6 +55,7 @@
 #include <linux/dynamic_debug.h>
 #include <linux/audit.h>
 #include <linux/cfi.h>
+#include <linux/hash.h>
 #include <uapi/linux/module.h>
 #include "internal.h"
 
@@ -964,6 +966,20 @@ static ssize_t show_taint(struct module_attribute *mattr,
 static struct module_attribute modinfo_taint =
 	__ATTR(taint, 0444, show_taint, NULL);
 
+static ssize_t show_load_time(struct module_attribute *mattr,
+			      struct module_kobject *mk, char *buffer)
+{
+	struct module *mod = mk->mod;
+
+	/* read, decompress, signature check, layout and init, in usecs */
+	return sprintf(buffer, "%u %u %u %u %u\n", mod->load_us.read,
+		       mod->load_us.decompress, mod->load_us.sig,
+		       mod->load_us.layout, mod->load_us.init);
+}
+
+static struct module_attribute modinfo_load_time =
+	__ATTR(load_time, 0444, show_load_time, NULL);
+
 struct module_attribute *modinfo_attrs[] = {
 	&module_uevent,
 	&modinfo_version,
@@ -975,6 +991,7 @@ struct module_attribute *modinfo_attrs[] = {
 #endif
 	&modinfo_initsize,
 	&modinfo_taint,
+	&modinfo_load_time,
 #ifdef CONFIG_MODULE_UNLOAD
 	&modinfo_refcnt,
 #endif
@@ -2449,6 +2466,7 @@ static noinline int do_init_module(struct module *mod)
 {
 	int ret = 0;
 	struct mod_initfree *freeinit;
+	ktime_t start;
 
 	freeinit = kmalloc(sizeof(*freeinit), GFP_KERNEL);
 	if (!freeinit) {
@@ -2457,10 +2475,12 @@ static noinline int do_init_module(struct module *mod)
 	}
 	freeinit->module_init = mod->init_layout.base;
 
+	start = ktime_get();
 	do_mod_ctors(mod);
 	/* Start the module */
 	if (mod->init != NULL)
 		ret = do_one_initcall(mod->init);
+	mod->load_us.init = ktime_us_delta(ktime_get(), start);
 	if (ret < 0) {
 		goto fail_free_freeinit;
 	}
@@ -2710,9 +2730,12 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	 * off the sig length at the end of the module, making
 	 * checks against info->len more correct.
 	 */
+	info->layout_start = ktime_get();
 	err = module_sig_check(info, flags);
+	info->sig_us = ktime_us_delta(ktime_get(), info->layout_start);
 	if (err)
 		goto free_copy;
+	info->layout_start = ktime_get();
 
 	/*
 	 * Do basic sanity checks against the ELF header and
@@ -2759,6 +2782,10 @@ static int load_module(struct load_info *info, const char __user *uargs,
 
 	audit_log_kern_module(mod->name);
 
+	mod->load_us.read = info->read_us;
+	mod->load_us.decompress = info->decompress_us;
+	mod->load_us.sig = info->sig_us;
+
 	/* Reserve our place in the list. */
 	err = add_unformed_module(mod);
 	if (err)
@@ -2869,6 +2896,7 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	/* Done! */
 	trace_module_load(mod);
 
+	mod->load_us.layout = ktime_us_delta(ktime_get(), info->layout_start);
 	return do_init_module(mod);
 
  sysfs_cleanup:
@@ -2921,6 +2949,7 @@ SYSCALL_DEFINE3(init_module, void __user *, umod,
 {
 	int err;
 	struct load_info info = { };
+	ktime_t start;
 
 	err = may_init_module();
 	if (err)
@@ -2929,41 +2958,111 @@ SYSCALL_DEFINE3(init_module, void __user *, umod,
 	pr_debug("init_module: umod=%p, len=%lu, uargs=%p\n",
 	       umod, len, uargs);
 
+	start = ktime_get();
 	err = copy_module_from_user(umod, len, &info);
 	if (err)
 		return err;
+	info.read_us = ktime_us_delta(ktime_get(), start);
 
 	return load_module(&info, uargs, 0);
 }
 
-SYSCALL_DEFINE3(finit_module, int, fd, const char __user *, uargs, int, flags)
+/*
+ * A device storm at boot can have udev load the same module file for each
+ * of many devices at once.  Rather than have every one of them read,
+ * decompress and check the signature of the file, only to find in
+ * add_unformed_module() that the module is already loading, the first
+ * finit_module() on a file does the work and the concurrent ones on the
+ * same file wait for it and return its result.
+ */
+struct idempotent {
+	const void *cookie;
+	struct hlist_node entry;
+	struct completion complete;
+	int ret;
+};
+
+#define IDEM_HASH_BITS 8
+static struct hlist_head idem_hash[1 << IDEM_HASH_BITS];
+static DEFINE_SPINLOCK(idem_lock);
+
+/* Returns true if another load of @cookie is already in flight. */
+static bool idempotent(struct idempotent *u, const void *cookie)
+{
+	struct hlist_head *head = idem_hash + hash_ptr(cookie, IDEM_HASH_BITS);
+	struct idempotent *existing;
+	bool first = true;
+
+	u->ret = 0;
+	u->cookie = cookie;
+	init_completion(&u->complete);
+
+	spin_lock(&idem_lock);
+	hlist_for_each_entry(existing, head, entry) {
+		if (existing->cookie == cookie) {
+			first = false;
+			break;
+		}
+	}
+	hlist_add_head(&u->entry, head);
+	spin_unlock(&idem_lock);
+	return !first;
+}
+
+/* Hand @ret to all the loads of the same cookie, including ours. */
+static int idempotent_complete(struct idempotent *u, int ret)
+{
+	const void *cookie = u->cookie;
+	struct hlist_head *head = idem_hash + hash_ptr(cookie, IDEM_HASH_BITS);
+	struct hlist_node *next;
+	struct idempotent *pos;
+
+	spin_lock(&idem_lock);
+	hlist_for_each_entry_safe(pos, next, head, entry) {
+		if (pos->cookie != cookie)
+			continue;
+		hlist_del_init(&pos->entry);
+		pos->ret = ret;
+		complete(&pos->complete);
+	}
+	spin_unlock(&idem_lock);
+	return ret;
+}
+
+static int idempotent_wait_for_completion(struct idempotent *u)
+{
+	if (wait_for_completion_killable(&u->complete)) {
+		spin_lock(&idem_lock);
+		if (!hlist_unhashed(&u->entry))
+			hlist_del(&u->entry);
+		spin_unlock(&idem_lock);
+		return -EINTR;
+	}
+	return u->ret;
+}
+
+static int init_module_from_fd(int fd, const char __user *uargs, int flags)
 {
 	struct load_info info = { };
 	void *buf = NULL;
+	ktime_t start;
 	int len;
 	int err;
 
-	err = may_init_module();
-	if (err)
-		return err;
-
-	pr_debug("finit_module: fd=%d, uargs=%p, flags=%i\n", fd, uargs, flags);
-
-	if (flags & ~(MODULE_INIT_IGNORE_MODVERSIONS
-		      |MODULE_INIT_IGNORE_VERMAGIC
-		      |MODULE_INIT_COMPRESSED_FILE))
-		return -EINVAL;
-
+	start = ktime_get();
 	len = kernel_read_file_from_fd(fd, 0, &buf, INT_MAX, NULL,
 				       READING_MODULE);
 	if (len < 0)
 		return len;
+	info.read_us = ktime_us_delta(ktime_get(), start);
 
 	if (flags & MODULE_INIT_COMPRESSED_FILE) {
+		start = ktime_get();
 		err = module_decompress(&info, buf, len);
 		vfree(buf); /* compressed data is no longer needed */
 		if (err)
 			return err;
+		info.decompress_us = ktime_us_delta(ktime_get(), start);
 	} else {
 		info.hdr = buf;
 		info.len = len;
@@ -2972,6 +3071,39 @@ SYSCALL_DEFINE3(finit_module, int, fd, const char __user *, uargs, int, flags)
 	return load_module(&info, uargs, flags);
 }
 
+SYSCALL_DEFINE3(finit_module, int, fd, const char __user *, uargs, int, flags)
+{
+	struct idempotent idem;
+	struct fd f;
+	int err;
+
+	err = may_init_module();
+	if (err)
+		return err;
+
+	pr_debug("finit_module: fd=%d, uargs=%p, flags=%i\n", fd, uargs, flags);
+
+	if (flags & ~(MODULE_INIT_IGNORE_MODVERSIONS
+		      |MODULE_INIT_IGNORE_VERMAGIC
+		      |MODULE_INIT_COMPRESSED_FILE))
+		return -EINVAL;
+
+	f = fdget(fd);
+	if (!f.file)
+		return -EBADF;
+
+	/* The same file, opened by each of the loaders. */
+	if (idempotent(&idem, file_inode(f.file))) {
+		fdput(f);
+		return idempotent_wait_for_completion(&idem);
+	}
+
+	err = init_module_from_fd(fd, uargs, flags);
+	idempotent_complete(&idem, err);
+	fdput(f);
+	return err;
+}
+
 static inline int within(unsigned long addr, void *start, unsigned long size)
 {
 	return ((void *)addr >= start && (void *)addr < start + size);
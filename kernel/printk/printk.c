@@ -42,6 +42,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -376,6 +377,31 @@ EXPORT_SYMBOL(console_set_on_cmdline);
 /* Flag: console code may call schedule() */
 static int console_may_schedule;
 
+/*
+ * Set once every registered console has a printing thread. From then on
+ * printk() only stores the record and wakes the threads, unless
+ * allow_direct_printing() says they cannot be relied upon. Cleared for
+ * good if a thread cannot be started.
+ */
+static bool printk_kthreads_available;
+
+/* Printing threads wait here for new records. */
+static DECLARE_WAIT_QUEUE_HEAD(printer_wait);
+
+/*
+ * Return true when the console_lock owner should print the records itself
+ * rather than leave them to the printing threads: before the threads are
+ * up, and when they may never get to run, i.e. on panic, on oops and
+ * once the system is going down.
+ */
+static bool allow_direct_printing(void)
+{
+	return !printk_kthreads_available ||
+	       system_state > SYSTEM_RUNNING ||
+	       oops_in_progress ||
+	       panic_in_progress();
+}
+
 enum con_msg_format_flags {
 	MSG_FORMAT_DEFAULT	= 0,
 	MSG_FORMAT_SYSLOG	= (1 << 0),
@@ -2339,8 +2365,12 @@ asmlinkage int vprintk_emit(int facility, int level,
 
 	printed_len = vprintk_store(facility, level, dev_info, fmt, args);
 
-	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	/*
+	 * If called from the scheduler, we can not call up(). Once the
+	 * printing threads run, leave the printing to them: wake_up_klogd()
+	 * below wakes them up.
+	 */
+	if (!in_sched && allow_direct_printing()) {
 		/*
 		 * The caller may be holding system-critical or
 		 * timing-sensitive locks. Disable preemption during
@@ -2386,6 +2416,7 @@ EXPORT_SYMBOL(_printk);
 
 static bool pr_flush(int timeout_ms, bool reset_on_progress);
 static bool __pr_flush(struct console *con, int timeout_ms, bool reset_on_progress);
+static bool printk_start_kthread(struct console *con);
 
 #else /* CONFIG_PRINTK */
 
@@ -2421,6 +2452,7 @@ static void call_console_driver(struct console *con, const char *text, size_t le
 static bool suppress_message_printing(int level) { return false; }
 static bool pr_flush(int timeout_ms, bool reset_on_progress) { return true; }
 static bool __pr_flush(struct console *con, int timeout_ms, bool reset_on_progress) { return true; }
+static bool printk_start_kthread(struct console *con) { return false; }
 
 #endif /* CONFIG_PRINTK */
 
@@ -2621,6 +2653,7 @@ void resume_console(void)
 	down_console_sem();
 	console_suspended = 0;
 	console_unlock();
+	wake_up_interruptible(&printer_wait);
 	pr_flush(1000, true);
 }
 
@@ -2878,6 +2911,9 @@ static bool console_flush_all(bool do_cond_resched, u64 *next_seq, bool *handove
 
 			if (!console_is_usable(con))
 				continue;
+			/* Its printing thread takes care of it. */
+			if (con->thread && !allow_direct_printing())
+				continue;
 			any_usable = true;
 
 			if (console_srcu_read_flags(con) & CON_EXTENDED) {
@@ -3405,6 +3441,9 @@ void register_console(struct console *newcon)
 	 * register_console() completes.
 	 */
 
+	if (printk_kthreads_available && !printk_start_kthread(newcon))
+		printk_kthreads_available = false;
+
 	console_sysfs_notify();
 
 	/*
@@ -3472,6 +3511,11 @@ static int unregister_console_locked(struct console *console)
 	 */
 	synchronize_srcu(&console_srcu);
 
+	if (console->thread) {
+		kthread_stop(console->thread);
+		console->thread = NULL;
+	}
+
 	console_sysfs_notify();
 
 	if (console->exit)
@@ -3604,6 +3648,13 @@ static int __init printk_late_init(void)
 			unregister_console_locked(con);
 		}
 	}
+
+	/* Hand the printing over to the threads if all of them could start. */
+	printk_kthreads_available = true;
+	for_each_console(con) {
+		if (!printk_start_kthread(con))
+			printk_kthreads_available = false;
+	}
 	console_list_unlock();
 
 	ret = cpuhp_setup_state_nocalls(CPUHP_PRINTK_DEAD, "printk:dead", NULL,
@@ -3707,6 +3758,106 @@ static bool pr_flush(int timeout_ms, bool reset_on_progress)
 	return __pr_flush(NULL, timeout_ms, reset_on_progress);
 }
 
+static bool printer_should_wake(struct console *con)
+{
+	short flags;
+	int cookie;
+
+	if (kthread_should_stop())
+		return true;
+
+	/* The panic CPU flushes the consoles itself. */
+	if (console_suspended || panic_in_progress())
+		return false;
+
+	cookie = console_srcu_read_lock();
+	flags = console_srcu_read_flags(con);
+	console_srcu_read_unlock(cookie);
+	if (!(flags & CON_ENABLED) || !con->write)
+		return false;
+
+	/* Racy read of @con->seq, the record is checked again when locked. */
+	return prb_read_valid(prb, data_race(READ_ONCE(con->seq)), NULL);
+}
+
+/*
+ * Printing thread of a console. It prints one record per console_lock
+ * hold, so that the other console_lock users never wait for more than one
+ * record to be written out, and whoever called printk() does not wait at
+ * all.
+ */
+static int printk_kthread_func(void *data)
+{
+	struct console *con = data;
+	char *dropped_text = NULL;
+	char *ext_text = NULL;
+	bool handover;
+	char *text;
+	int cookie;
+
+	text = kmalloc(CONSOLE_LOG_MAX, GFP_KERNEL);
+	if (con->flags & CON_EXTENDED)
+		ext_text = kmalloc(CONSOLE_EXT_LOG_MAX, GFP_KERNEL);
+	else
+		dropped_text = kmalloc(DROPPED_TEXT_MAX, GFP_KERNEL);
+	if (!text || (!ext_text && !dropped_text)) {
+		con_printk(KERN_ERR, con, "failed to allocate printing thread buffers\n");
+		/* All consoles are printed directly again. */
+		printk_kthreads_available = false;
+		wait_event_interruptible(printer_wait, kthread_should_stop());
+		goto out;
+	}
+
+	con_printk(KERN_INFO, con, "printing thread started\n");
+	for (;;) {
+		wait_event_interruptible(printer_wait, printer_should_wake(con));
+		if (kthread_should_stop())
+			break;
+
+		console_lock();
+		if (console_suspended) {
+			up_console_sem();
+			continue;
+		}
+
+		cookie = console_srcu_read_lock();
+		handover = false;
+		if (console_is_usable(con))
+			console_emit_next_record(con, text, ext_text, dropped_text,
+						 &handover, cookie);
+		/* On handover, the waiter owns the console_lock now. */
+		if (!handover) {
+			console_srcu_read_unlock(cookie);
+			__console_unlock();
+		}
+
+		cond_resched();
+	}
+	con_printk(KERN_INFO, con, "printing thread stopped\n");
+out:
+	kfree(dropped_text);
+	kfree(ext_text);
+	kfree(text);
+	return 0;
+}
+
+/* Must be called under console_list_lock(). */
+static bool printk_start_kthread(struct console *con)
+{
+	struct task_struct *thread;
+
+	lockdep_assert_console_list_lock_held();
+
+	thread = kthread_run(printk_kthread_func, con, "pr/%s%d",
+			     con->name, con->index);
+	if (IS_ERR(thread)) {
+		con_printk(KERN_ERR, con, "unable to start printing thread\n");
+		return false;
+	}
+	con->thread = thread;
+	return true;
+}
+
 /*
  * Delayed printk version, for scheduler-internal messages:
  */
@@ -3725,8 +3876,10 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 			console_unlock();
 	}
 
-	if (pending & PRINTK_PENDING_WAKEUP)
+	if (pending & PRINTK_PENDING_WAKEUP) {
 		wake_up_interruptible(&log_wait);
+		wake_up_interruptible(&printer_wait);
+	}
 }
 
 static DEFINE_PER_CPU(struct irq_work, wake_up_klogd_work) =
@@ -3750,6 +3903,7 @@ static void __wake_up_klogd(int val)
 	 * This pairs with devkmsg_read:A and syslog_print:A.
 	 */
 	if (wq_has_sleeper(&log_wait) || /* LMM(__wake_up_klogd:A) */
+	    wq_has_sleeper(&printer_wait) ||
 	    (val & PRINTK_PENDING_OUTPUT)) {
 		this_cpu_or(printk_pending, val);
 		irq_work_queue(this_cpu_ptr(&wake_up_klogd_work));
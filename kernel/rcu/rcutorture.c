@@ -191,6 +191,7 @@ static unsigned long shutdown_jiffies;
 static unsigned long start_gp_seq;
 static atomic_long_t n_nocb_offload;
 static atomic_long_t n_nocb_deoffload;
+static atomic_long_t n_nocb_regroup;
 
 static int rcu_torture_writer_state;
 #define RTWS_FIXED_DELAY	0
@@ -2136,7 +2137,10 @@ static int rcu_nocb_toggle(void *arg)
 	do {
 		r = torture_random(&rand);
 		cpu = (r >> 4) % (maxcpu + 1);
-		if (r & 0x1) {
+		if ((r & 0x7) == 0x7) {
+			if (!rcu_nocb_cpu_regroup(cpu, (r >> 16) % (maxcpu + 1)))
+				atomic_long_inc(&n_nocb_regroup);
+		} else if (r & 0x1) {
 			rcu_nocb_cpu_offload(cpu);
 			atomic_long_inc(&n_nocb_offload);
 		} else {
@@ -2210,8 +2214,9 @@ rcu_torture_stats_print(void)
 		data_race(n_barrier_attempts),
 		data_race(n_rcu_torture_barrier_error));
 	pr_cont("read-exits: %ld ", data_race(n_read_exits)); // Statistic.
-	pr_cont("nocb-toggles: %ld:%ld\n",
-		atomic_long_read(&n_nocb_offload), atomic_long_read(&n_nocb_deoffload));
+	pr_cont("nocb-toggles: %ld:%ld:%ld\n",
+		atomic_long_read(&n_nocb_offload), atomic_long_read(&n_nocb_deoffload),
+		atomic_long_read(&n_nocb_regroup));
 
 	pr_alert("%s%s ", torture_type, TORTURE_FLAG);
 	if (atomic_read(&n_rcu_torture_mberror) ||
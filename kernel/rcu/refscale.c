@@ -24,6 +24,7 @@
 #include <linux/moduleparam.h>
 #include <linux/notifier.h>
 #include <linux/percpu.h>
+#include <linux/percpu-rwsem.h>
 #include <linux/rcupdate.h>
 #include <linux/rcupdate_trace.h>
 #include <linux/reboot.h>
@@ -33,6 +34,7 @@
 #include <linux/stat.h>
 #include <linux/srcu.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/torture.h>
 #include <linux/types.h>
 
@@ -68,7 +70,7 @@ MODULE_AUTHOR("Joel Fernandes (Google) <joel@joelfernandes.org>");
 
 static char *scale_type = "rcu";
 module_param(scale_type, charp, 0444);
-MODULE_PARM_DESC(scale_type, "Type of test (rcu, srcu, refcnt, rwsem, rwlock.");
+MODULE_PARM_DESC(scale_type, "Type of test (rcu, srcu, refcnt, rwsem, rwlock, mutex, percpu-rwsem.");
 
 torture_param(int, verbose, 0, "Enable verbose debugging printk()s");
 torture_param(int, verbose_batched, 0, "Batch verbose debugging printk()s");
@@ -84,6 +86,8 @@ torture_param(int, nreaders, -1, "Number of readers, -1 for 75% of CPUs.");
 torture_param(int, nruns, 30, "Number of experiments to run.");
 // Reader delay in nanoseconds, 0 for no delay.
 torture_param(int, readdelay, 0, "Read-side delay in nanoseconds.");
+// Sweep the number of readers and the read-side delay, with CSV output.
+torture_param(bool, sweep, false, "Sweep readers and delays up to nreaders and readdelay.");
 
 #ifdef MODULE
 # define REFSCALE_SHUTDOWN 0
@@ -122,6 +126,9 @@ static atomic_t n_cooleddown;
 // Track which experiment is currently running.
 static int exp_idx;
 
+// Read-side delay of the current experiment, readdelay unless sweeping.
+static int exp_readdelay;
+
 // Operations vector for selecting different types of tests.
 struct ref_scale_ops {
 	void (*init)(void);
@@ -523,12 +530,74 @@ static struct ref_scale_ops clock_ops = {
 	.name		= "clock"
 };
 
+// Definitions for mutex
+static DEFINE_MUTEX(test_mutex);
+
+static void ref_mutex_section(const int nloops)
+{
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		mutex_lock(&test_mutex);
+		mutex_unlock(&test_mutex);
+	}
+}
+
+static void ref_mutex_delay_section(const int nloops, const int udl, const int ndl)
+{
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		mutex_lock(&test_mutex);
+		un_delay(udl, ndl);
+		mutex_unlock(&test_mutex);
+	}
+}
+
+static struct ref_scale_ops mutex_ops = {
+	.readsection	= ref_mutex_section,
+	.delaysection	= ref_mutex_delay_section,
+	.name		= "mutex"
+};
+
+// Definitions for percpu-rwsem
+DEFINE_STATIC_PERCPU_RWSEM(test_percpu_rwsem);
+
+static void ref_percpu_rwsem_section(const int nloops)
+{
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		percpu_down_read(&test_percpu_rwsem);
+		percpu_up_read(&test_percpu_rwsem);
+	}
+}
+
+static void ref_percpu_rwsem_delay_section(const int nloops, const int udl, const int ndl)
+{
+	int i;
+
+	for (i = nloops; i >= 0; i--) {
+		percpu_down_read(&test_percpu_rwsem);
+		un_delay(udl, ndl);
+		percpu_up_read(&test_percpu_rwsem);
+	}
+}
+
+static struct ref_scale_ops percpu_rwsem_ops = {
+	.readsection	= ref_percpu_rwsem_section,
+	.delaysection	= ref_percpu_rwsem_delay_section,
+	.name		= "percpu-rwsem"
+};
+
 static void rcu_scale_one_reader(void)
 {
-	if (readdelay <= 0)
+	int delay = READ_ONCE(exp_readdelay);
+
+	if (delay <= 0)
 		cur_ops->readsection(loops);
 	else
-		cur_ops->delaysection(loops, readdelay / 1000, readdelay % 1000);
+		cur_ops->delaysection(loops, delay / 1000, delay % 1000);
 }
 
 // Reader kthread.  Repeatedly does empty RCU read-side
@@ -653,6 +722,82 @@ static u64 process_durations(int n)
 	return sum;
 }
 
+// Run one experiment with the first n readers, returning false if the
+// test is being stopped.
+static bool run_experiment(int n)
+{
+	int r;
+
+	reset_readers();
+	atomic_set(&nreaders_exp, n);
+	atomic_set(&n_started, n);
+	atomic_set(&n_warmedup, n);
+	atomic_set(&n_cooleddown, n);
+
+	for (r = 0; r < n; r++) {
+		smp_store_release(&reader_tasks[r].start_reader, 1);
+		wake_up(&reader_tasks[r].wq);
+	}
+
+	VERBOSE_SCALEOUT("main_func: experiment started, waiting for %d readers",
+			n);
+
+	wait_event(main_wq,
+		   !atomic_read(&nreaders_exp) || torture_must_stop());
+
+	VERBOSE_SCALEOUT("main_func: experiment ended");
+
+	return !torture_must_stop();
+}
+
+static int ref_scale_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+// Print one CSV line for each pair of reader count and read-side delay,
+// doubling the readers from 1 up to nreaders and the delay from 0, then
+// 16ns, up to readdelay.  Each line gives the aggregate rate of
+// read-side sections and percentiles of the per-reader average time per
+// section over nruns experiments, in picoseconds for sub-ns resolution.
+static void run_sweep(u64 *samples)
+{
+	int delay, exp, n, r;
+	u64 ops, ns;
+	int nsamples;
+
+	SCALEOUT("csv: type,readers,delay_ns,ops_per_sec,p50_ps,p90_ps,p99_ps,max_ps\n");
+
+	for (delay = 0; ; delay = delay ? min(delay * 2, readdelay) : min(readdelay, 16)) {
+		WRITE_ONCE(exp_readdelay, delay);
+		for (n = 1; ; n = min(n * 2, nreaders)) {
+			ops = 0;
+			nsamples = 0;
+			for (exp = 0; exp < nruns; exp++) {
+				exp_idx = exp;
+				if (!run_experiment(n))
+					return;
+				for (r = 0; r < n; r++) {
+					ns = max_t(u64, reader_tasks[r].last_duration_ns, 1);
+					ops += div64_u64((u64)loops * NSEC_PER_SEC, ns);
+					samples[nsamples++] = div64_u64(ns * 1000, loops);
+				}
+			}
+			sort(samples, nsamples, sizeof(samples[0]), ref_scale_cmp_u64, NULL);
+			SCALEOUT("csv: %s,%d,%d,%llu,%llu,%llu,%llu,%llu\n",
+				 cur_ops->name, n, delay, div_u64(ops, nruns),
+				 samples[nsamples / 2], samples[nsamples * 9 / 10],
+				 samples[nsamples * 99 / 100], samples[nsamples - 1]);
+			if (n == nreaders)
+				break;
+		}
+		if (delay >= readdelay)
+			break;
+	}
+}
+
 // The main_func is the main orchestrator, it performs a bunch of
 // experiments.  For every experiment, it orders all the readers
 // involved to start and waits for them to finish the experiment. It
@@ -661,10 +806,11 @@ static u64 process_durations(int n)
 // point all the timestamps are printed.
 static int main_func(void *arg)
 {
-	int exp, r;
+	int exp;
 	char buf1[64];
 	char *buf;
 	u64 *result_avg;
+	u64 *samples = NULL;
 
 	set_cpus_allowed_ptr(current, cpumask_of(nreaders % nr_cpu_ids));
 	set_user_nice(current, MAX_NICE);
@@ -672,7 +818,9 @@ static int main_func(void *arg)
 	VERBOSE_SCALEOUT("main_func task started");
 	result_avg = kzalloc(nruns * sizeof(*result_avg), GFP_KERNEL);
 	buf = kzalloc(800 + 64, GFP_KERNEL);
-	if (!result_avg || !buf) {
+	if (sweep)
+		samples = kcalloc(nruns * nreaders, sizeof(*samples), GFP_KERNEL);
+	if (!result_avg || !buf || (sweep && !samples)) {
 		SCALEOUT_ERRSTRING("out of memory");
 		goto oom_exit;
 	}
@@ -684,33 +832,22 @@ static int main_func(void *arg)
 	while (atomic_read(&n_init) < nreaders + 1)
 		schedule_timeout_uninterruptible(1);
 
+	if (sweep) {
+		run_sweep(samples);
+		if (torture_must_stop())
+			goto end;
+		SCALEOUT("END OF TEST. Sweep done.\n");
+		goto oom_exit;
+	}
+
 	// Start exp readers up per experiment
 	for (exp = 0; exp < nruns && !torture_must_stop(); exp++) {
 		if (torture_must_stop())
 			goto end;
 
-		reset_readers();
-		atomic_set(&nreaders_exp, nreaders);
-		atomic_set(&n_started, nreaders);
-		atomic_set(&n_warmedup, nreaders);
-		atomic_set(&n_cooleddown, nreaders);
-
 		exp_idx = exp;
 
-		for (r = 0; r < nreaders; r++) {
-			smp_store_release(&reader_tasks[r].start_reader, 1);
-			wake_up(&reader_tasks[r].wq);
-		}
-
-		VERBOSE_SCALEOUT("main_func: experiment started, waiting for %d readers",
-				nreaders);
-
-		wait_event(main_wq,
-			   !atomic_read(&nreaders_exp) || torture_must_stop());
-
-		VERBOSE_SCALEOUT("main_func: experiment ended");
-
-		if (torture_must_stop())
+		if (!run_experiment(nreaders))
 			goto end;
 
 		result_avg[exp] = div_u64(1000 * process_durations(nreaders), nreaders * loops);
@@ -750,6 +887,7 @@ static int main_func(void *arg)
 	torture_kthread_stopping("main_func");
 	kfree(result_avg);
 	kfree(buf);
+	kfree(samples);
 	return 0;
 }
 
@@ -757,8 +895,8 @@ static void
 ref_scale_print_module_parms(struct ref_scale_ops *cur_ops, const char *tag)
 {
 	pr_alert("%s" SCALE_FLAG
-		 "--- %s:  verbose=%d shutdown=%d holdoff=%d loops=%ld nreaders=%d nruns=%d readdelay=%d\n", scale_type, tag,
-		 verbose, shutdown, holdoff, loops, nreaders, nruns, readdelay);
+		 "--- %s:  verbose=%d shutdown=%d holdoff=%d loops=%ld nreaders=%d nruns=%d readdelay=%d sweep=%d\n", scale_type, tag,
+		 verbose, shutdown, holdoff, loops, nreaders, nruns, readdelay, sweep);
 }
 
 static void
@@ -812,6 +950,7 @@ ref_scale_init(void)
 	static struct ref_scale_ops *scale_ops[] = {
 		&rcu_ops, &srcu_ops, RCU_TRACE_OPS RCU_TASKS_OPS &refcnt_ops, &rwlock_ops,
 		&rwsem_ops, &lock_ops, &lock_irq_ops, &acqrel_ops, &clock_ops,
+		&mutex_ops, &percpu_rwsem_ops,
 	};
 
 	if (!torture_init_begin(scale_type, verbose))
@@ -856,6 +995,7 @@ ref_scale_init(void)
 		nreaders = 1;
 	if (WARN_ONCE(nruns <= 0, "%s: nruns = %d, adjusted to 1\n", __func__, nruns))
 		nruns = 1;
+	exp_readdelay = readdelay;
 	reader_tasks = kcalloc(nreaders, sizeof(reader_tasks[0]),
 			       GFP_KERNEL);
 	if (!reader_tasks) {
@@ -26,6 +26,8 @@
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/srcu.h>
+#include <linux/topology.h>
+#include <linux/workqueue.h>
 
 #include "rcu.h"
 #include "rcu_segcblist.h"
@@ -68,6 +70,13 @@ module_param(big_cpu_lim, int, 0444);
 static int small_contention_lim __read_mostly = 100;
 module_param(small_contention_lim, int, 0444);
 
+/*
+ * Number of CPUs from which the grace-period reader-counter scans are
+ * split up by NUMA node and run in parallel on each node, 0 to disable.
+ */
+static int node_scan_cpu_lim __read_mostly = 256;
+module_param(node_scan_cpu_lim, int, 0644);
+
 /* Early-boot callback-management, so early that no lock is required! */
 static LIST_HEAD(srcu_boot_list);
 static bool __read_mostly srcu_init_done;
@@ -406,39 +415,129 @@ static void check_init_srcu_struct(struct srcu_struct *ssp)
 }
 
 /*
- * Returns approximate total of the readers' ->srcu_lock_count[] values
- * for the rank of per-CPU counters specified by idx.
+ * On big NUMA systems, most of the per-CPU counters live in memory that
+ * is remote to the CPU scanning them, so the scans below are instead
+ * handed out to one worker on each node, which only reads the counters
+ * of its own node's CPUs.
  */
-static unsigned long srcu_readers_lock_idx(struct srcu_struct *ssp, int idx)
+struct srcu_node_scan {
+	struct work_struct work;
+	struct srcu_struct *ssp;
+	int node;
+	int idx;
+	bool unlocks;
+	unsigned long sum;
+	unsigned long mask;
+};
+
+/*
+ * The scans run from the grace-period workqueue, which may have to make
+ * progress for reclaim, so neither the scan state nor the workqueue that
+ * runs them is allocated on the way.  One scan at a time uses them, any
+ * other scan of the moment does the serial loop instead.
+ */
+static struct workqueue_struct *srcu_scan_wq;
+static struct srcu_node_scan *srcu_node_scans;
+static DEFINE_MUTEX(srcu_node_scan_mutex);
+
+/* CPUs of offline or unknown nodes are counted by the first online node. */
+static int srcu_cpu_scan_node(int cpu)
+{
+	int node = cpu_to_node(cpu);
+
+	return node == NUMA_NO_NODE || !node_online(node) ? first_online_node : node;
+}
+
+static void srcu_node_scan_cpus(struct srcu_node_scan *sns, int node)
 {
 	int cpu;
-	unsigned long sum = 0;
 
+	sns->sum = 0;
+	sns->mask = 0;
 	for_each_possible_cpu(cpu) {
-		struct srcu_data *cpuc = per_cpu_ptr(ssp->sda, cpu);
+		struct srcu_data *cpuc = per_cpu_ptr(sns->ssp->sda, cpu);
 
-		sum += atomic_long_read(&cpuc->srcu_lock_count[idx]);
+		if (node != NUMA_NO_NODE && srcu_cpu_scan_node(cpu) != node)
+			continue;
+		if (!sns->unlocks) {
+			sns->sum += atomic_long_read(&cpuc->srcu_lock_count[sns->idx]);
+			continue;
+		}
+		sns->sum += atomic_long_read(&cpuc->srcu_unlock_count[sns->idx]);
+		if (IS_ENABLED(CONFIG_PROVE_RCU))
+			sns->mask = sns->mask | READ_ONCE(cpuc->srcu_nmi_safety);
 	}
+}
+
+static void srcu_node_scan_fn(struct work_struct *work)
+{
+	struct srcu_node_scan *sns = container_of(work, struct srcu_node_scan, work);
+
+	srcu_node_scan_cpus(sns, sns->node);
+}
+
+/*
+ * Sum the lock or unlock counters of rank idx, in parallel on each node if
+ * the system is big enough that this is worth a round of work items and
+ * no other scan holds the per-node state.  The sum is complete when this
+ * returns, and flush_work() orders the workers' reads before anything that
+ * follows.
+ */
+static unsigned long srcu_readers_sum_idx(struct srcu_struct *ssp, int idx,
+					  bool unlocks, unsigned long *maskp)
+{
+	struct srcu_node_scan one = { .ssp = ssp, .idx = idx, .unlocks = unlocks };
+	struct srcu_node_scan *sns = READ_ONCE(srcu_node_scans);
+	int lim = READ_ONCE(node_scan_cpu_lim);
+	unsigned long sum = 0;
+	int node;
+
+	if (!sns || !lim || num_possible_cpus() < lim || num_online_nodes() < 2 ||
+	    !mutex_trylock(&srcu_node_scan_mutex)) {
+		srcu_node_scan_cpus(&one, NUMA_NO_NODE);
+		*maskp = one.mask;
+		return one.sum;
+	}
+
+	for_each_online_node(node) {
+		sns[node].ssp = ssp;
+		sns[node].node = node;
+		sns[node].idx = idx;
+		sns[node].unlocks = unlocks;
+		INIT_WORK(&sns[node].work, srcu_node_scan_fn);
+		queue_work_node(node, srcu_scan_wq, &sns[node].work);
+	}
+	*maskp = 0;
+	for_each_online_node(node) {
+		flush_work(&sns[node].work);
+		sum += sns[node].sum;
+		*maskp |= sns[node].mask;
+	}
+	mutex_unlock(&srcu_node_scan_mutex);
 	return sum;
 }
 
+/*
+ * Returns approximate total of the readers' ->srcu_lock_count[] values
+ * for the rank of per-CPU counters specified by idx.
+ */
+static unsigned long srcu_readers_lock_idx(struct srcu_struct *ssp, int idx)
+{
+	unsigned long mask;
+
+	return srcu_readers_sum_idx(ssp, idx, false, &mask);
+}
+
 /*
  * Returns approximate total of the readers' ->srcu_unlock_count[] values
  * for the rank of per-CPU counters specified by idx.
  */
 static unsigned long srcu_readers_unlock_idx(struct srcu_struct *ssp, int idx)
 {
-	int cpu;
-	unsigned long mask = 0;
-	unsigned long sum = 0;
-
-	for_each_possible_cpu(cpu) {
-		struct srcu_data *cpuc = per_cpu_ptr(ssp->sda, cpu);
+	unsigned long mask;
+	unsigned long sum;
 
-		sum += atomic_long_read(&cpuc->srcu_unlock_count[idx]);
-		if (IS_ENABLED(CONFIG_PROVE_RCU))
-			mask = mask | READ_ONCE(cpuc->srcu_nmi_safety);
-	}
+	sum = srcu_readers_sum_idx(ssp, idx, true, &mask);
 	WARN_ONCE(IS_ENABLED(CONFIG_PROVE_RCU) && (mask & (mask >> 1)),
 		  "Mixed NMI-safe readers for srcu_struct at %ps.\n", ssp);
 	return sum;
@@ -1811,6 +1910,16 @@ void __init srcu_init(void)
 		}
 	}
 
+	/* Per-node reader scans, see srcu_readers_sum_idx(). */
+	if (nr_node_ids > 1) {
+		srcu_scan_wq = alloc_workqueue("srcu_scan",
+					       WQ_MEM_RECLAIM | WQ_UNBOUND, 0);
+		if (srcu_scan_wq)
+			srcu_node_scans = kcalloc(nr_node_ids,
+						  sizeof(*srcu_node_scans),
+						  GFP_KERNEL);
+	}
+
 	/*
 	 * Once that is set, call_srcu() can follow the normal path and
 	 * queue delayed work. This must follow RCU workqueues creation
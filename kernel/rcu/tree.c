@@ -196,6 +196,14 @@ module_param(rcu_min_cached_objs, int, 0444);
 static int rcu_delay_page_cache_fill_msec = 5000;
 module_param(rcu_delay_page_cache_fill_msec, int, 0444);
 
+// kvfree_rcu() holds objects for up to KFREE_DRAIN_JIFFIES so that they
+// share grace periods, which is good for power but lets a burst of frees
+// pin a lot of memory.  Once the objects queued on a CPU add up to more
+// than this many kilobytes, a grace period is started for them right away.
+// Zero turns the limit off.
+static ulong rcu_kfree_flush_kb = 4096;
+module_param(rcu_kfree_flush_kb, ulong, 0644);
+
 /* Retrieve RCU kthreads priority for rcutorture */
 int rcu_get_gp_kthreads_prio(void)
 {
@@ -2918,6 +2926,7 @@ struct kfree_rcu_cpu_work {
  * @monitor_work: Promote @head to @head_free after KFREE_DRAIN_JIFFIES
  * @initialized: The @rcu_work fields have been initialized
  * @count: Number of objects for which GP not started
+ * @nr_bytes: Number of bytes held by the objects for which GP not started
  * @bkvcache:
  *	A simple cache list that contains objects for reuse purpose.
  *	In order to save some per-cpu space the list is singular.
@@ -2942,6 +2951,7 @@ struct kfree_rcu_cpu {
 	struct delayed_work monitor_work;
 	bool initialized;
 	int count;
+	unsigned long nr_bytes;
 
 	struct delayed_work page_cache_work;
 	atomic_t backoff_page_cache_fill;
@@ -3131,12 +3141,21 @@ need_offload_krc(struct kfree_rcu_cpu *krcp)
 	return !!krcp->head;
 }
 
+static bool
+krc_over_bytes_limit(struct kfree_rcu_cpu *krcp)
+{
+	ulong limit_kb = READ_ONCE(rcu_kfree_flush_kb);
+
+	return limit_kb && READ_ONCE(krcp->nr_bytes) >> 10 >= limit_kb;
+}
+
 static void
 schedule_delayed_monitor_work(struct kfree_rcu_cpu *krcp)
 {
 	long delay, delay_left;
 
-	delay = READ_ONCE(krcp->count) >= KVFREE_BULK_MAX_ENTR ? 1:KFREE_DRAIN_JIFFIES;
+	delay = READ_ONCE(krcp->count) >= KVFREE_BULK_MAX_ENTR ||
+		krc_over_bytes_limit(krcp) ? 1 : KFREE_DRAIN_JIFFIES;
 	if (delayed_work_pending(&krcp->monitor_work)) {
 		delay_left = krcp->monitor_work.timer.expires - jiffies;
 		if (delay < delay_left)
@@ -3187,6 +3206,7 @@ static void kfree_rcu_monitor(struct work_struct *work)
 			}
 
 			WRITE_ONCE(krcp->count, 0);
+			WRITE_ONCE(krcp->nr_bytes, 0);
 
 			// One work is per one batch, so there are three
 			// "free channels", the batch can handle. It can
@@ -3389,8 +3409,13 @@ void kvfree_call_rcu(struct rcu_head *head, rcu_callback_t func)
 	}
 
 	WRITE_ONCE(krcp->count, krcp->count + 1);
+	// Objects from vmalloc() are only counted as a page, finding out
+	// their real size would take the vmap lock.
+	WRITE_ONCE(krcp->nr_bytes, krcp->nr_bytes +
+		   (is_vmalloc_addr(ptr) ? PAGE_SIZE : __ksize(ptr)));
 
-	// Set timer to drain after KFREE_DRAIN_JIFFIES.
+	// Set timer to drain after KFREE_DRAIN_JIFFIES, or right away if
+	// too much memory is being held.
 	if (rcu_scheduler_active == RCU_SCHEDULER_RUNNING)
 		schedule_delayed_monitor_work(krcp);
 
@@ -3458,6 +3483,30 @@ static struct shrinker kfree_rcu_shrinker = {
 	.seeks = DEFAULT_SEEKS,
 };
 
+// Report the bytes held by kvfree_rcu() objects that are still waiting
+// for a grace period to start, one "<cpu> <bytes>" line per CPU that has
+// any, through /sys/module/rcutree/parameters/kfree_rcu_queued_bytes.
+static int param_get_kfree_rcu_queued_bytes(char *buffer, const struct kernel_param *kp)
+{
+	unsigned long nr_bytes;
+	int cpu, len = 0;
+
+	for_each_possible_cpu(cpu) {
+		nr_bytes = READ_ONCE(per_cpu_ptr(&krc, cpu)->nr_bytes);
+		if (nr_bytes)
+			len += scnprintf(buffer + len, PAGE_SIZE - len, "%d %lu\n",
+					 cpu, nr_bytes);
+	}
+
+	return len;
+}
+
+static const struct kernel_param_ops kfree_rcu_queued_bytes_ops = {
+	.get = param_get_kfree_rcu_queued_bytes,
+};
+
+module_param_cb(kfree_rcu_queued_bytes, &kfree_rcu_queued_bytes_ops, NULL, 0444);
+
 void __init kfree_rcu_scheduler_running(void)
 {
 	int cpu;
@@ -237,10 +237,19 @@ struct rcu_data {
 					 */
 	struct list_head nocb_entry_rdp; /* rcu_data node in wakeup chain. */
 	struct rcu_data *nocb_toggling_rdp; /* rdp queued for (de-)offloading */
+	u64 nocb_gp_wake_ns;		/* Time of first unserviced wakeup. */
+	unsigned long nocb_gp_nwakes;	/* # wakeups serviced. */
+	u64 nocb_gp_wake_lat_ns;	/* Total wakeup-to-run latency. */
+	u64 nocb_gp_wake_lat_max_ns;	/* Worst wakeup-to-run latency. */
+	unsigned long nocb_gp_nwaits;	/* # grace periods waited for. */
+	u64 nocb_gp_wait_ns;		/* Total time waiting for them. */
+	unsigned long nocb_gp_load;	/* CBs invoked by group, last period. */
 
 	/* The following fields are used by CB kthread, hence new cacheline. */
 	struct rcu_data *nocb_gp_rdp ____cacheline_internodealigned_in_smp;
 					/* GP rdp takes GP-end wakeups. */
+	unsigned long nocb_regroup_cbs;	/* ->n_cbs_invoked at last rebalance. */
+	unsigned long nocb_regroup_load; /* CBs invoked, last period. */
 #endif /* #ifdef CONFIG_RCU_NOCB_CPU */
 
 	/* 6) RCU priority boosting. */
@@ -235,6 +235,8 @@ static bool __wake_nocb_gp(struct rcu_data *rdp_gp,
 		WRITE_ONCE(rdp_gp->nocb_gp_sleep, false);
 		needwake = true;
 	}
+	if (needwake && !rdp_gp->nocb_gp_wake_ns)
+		WRITE_ONCE(rdp_gp->nocb_gp_wake_ns, local_clock());
 	raw_spin_unlock_irqrestore(&rdp_gp->nocb_gp_lock, flags);
 	if (needwake) {
 		trace_rcu_nocb_wake(rcu_state.name, rdp->cpu, TPS("DoWake"));
@@ -670,6 +672,30 @@ static void nocb_gp_sleep(struct rcu_data *my_rdp, int cpu)
 	trace_rcu_nocb_wake(rcu_state.name, cpu, TPS("EndSleep"));
 }
 
+/*
+ * Account for the time between the first wakeup of this GP kthread that
+ * found it asleep and the kthread getting to run.
+ */
+static void nocb_gp_account_wake(struct rcu_data *my_rdp)
+{
+	unsigned long flags;
+	u64 lat = 0;
+
+	raw_spin_lock_irqsave(&my_rdp->nocb_gp_lock, flags);
+	if (my_rdp->nocb_gp_wake_ns) {
+		lat = local_clock() - my_rdp->nocb_gp_wake_ns;
+		WRITE_ONCE(my_rdp->nocb_gp_wake_ns, 0);
+	}
+	raw_spin_unlock_irqrestore(&my_rdp->nocb_gp_lock, flags);
+
+	if (!lat || (s64)lat < 0)
+		return;
+	WRITE_ONCE(my_rdp->nocb_gp_nwakes, my_rdp->nocb_gp_nwakes + 1);
+	WRITE_ONCE(my_rdp->nocb_gp_wake_lat_ns, my_rdp->nocb_gp_wake_lat_ns + lat);
+	if (lat > my_rdp->nocb_gp_wake_lat_max_ns)
+		WRITE_ONCE(my_rdp->nocb_gp_wake_lat_max_ns, lat);
+}
+
 /*
  * No-CBs GP kthreads come here to wait for additional callbacks to show up
  * or for grace periods to end.
@@ -690,6 +716,9 @@ static void nocb_gp_wait(struct rcu_data *my_rdp)
 	struct rcu_node *rnp;
 	unsigned long wait_gp_seq = 0; // Suppress "use uninitialized" warning.
 	bool wasempty = false;
+	u64 wait_start;
+
+	nocb_gp_account_wake(my_rdp);
 
 	/*
 	 * Each pass through the following loop checks for CBs and for the
@@ -830,10 +859,14 @@ static void nocb_gp_wait(struct rcu_data *my_rdp)
 	} else {
 		rnp = my_rdp->mynode;
 		trace_rcu_this_gp(rnp, my_rdp, wait_gp_seq, TPS("StartWait"));
+		wait_start = local_clock();
 		swait_event_interruptible_exclusive(
 			rnp->nocb_gp_wq[rcu_seq_ctr(wait_gp_seq) & 0x1],
 			rcu_seq_done(&rnp->gp_seq, wait_gp_seq) ||
 			!READ_ONCE(my_rdp->nocb_gp_sleep));
+		WRITE_ONCE(my_rdp->nocb_gp_nwaits, my_rdp->nocb_gp_nwaits + 1);
+		WRITE_ONCE(my_rdp->nocb_gp_wait_ns,
+			   my_rdp->nocb_gp_wait_ns + local_clock() - wait_start);
 		trace_rcu_this_gp(rnp, my_rdp, wait_gp_seq, TPS("EndWait"));
 	}
 
@@ -1551,6 +1584,206 @@ static void __init rcu_organize_nocb_kthreads(void)
 		pr_cont("%s\n", gotnocbscbs ? "" : " (self only)");
 }
 
+/*
+ * Move an offloaded CPU over to the group of another rcuog kthread, by
+ * de-offloading it and offloading it again once it points to its new
+ * group.  The CPU must be online and must not lead a group of its own.
+ * The caller must hold cpus_read_lock() and ->barrier_mutex.
+ */
+static int __rcu_nocb_cpu_regroup(int cpu, int gp_cpu)
+{
+	struct rcu_data *rdp = per_cpu_ptr(&rcu_data, cpu);
+	struct rcu_data *rdp_gp = per_cpu_ptr(&rcu_data, gp_cpu);
+	int ret;
+
+	lockdep_assert_cpus_held();
+	lockdep_assert_held(&rcu_state.barrier_mutex);
+
+	if (!rcu_rdp_is_offloaded(rdp) || !cpu_online(cpu) ||
+	    rdp->nocb_gp_rdp == rdp || rdp->nocb_gp_rdp == rdp_gp ||
+	    rdp_gp->nocb_gp_rdp != rdp_gp || !READ_ONCE(rdp_gp->nocb_gp_kthread))
+		return -EINVAL;
+
+	ret = work_on_cpu(cpu, rcu_nocb_rdp_deoffload, rdp);
+	if (ret)
+		return ret;
+	cpumask_clear_cpu(cpu, rcu_nocb_mask);
+
+	/* No nocb kthread looks at this rdp until it is offloaded again. */
+	WRITE_ONCE(rdp->nocb_gp_rdp, rdp_gp);
+	WRITE_ONCE(rdp->nocb_gp_kthread, rdp_gp->nocb_gp_kthread);
+
+	ret = work_on_cpu(cpu, rcu_nocb_rdp_offload, rdp);
+	if (!ret)
+		cpumask_set_cpu(cpu, rcu_nocb_mask);
+	return ret;
+}
+
+int rcu_nocb_cpu_regroup(int cpu, int gp_cpu)
+{
+	int ret;
+
+	if (cpu >= nr_cpu_ids || gp_cpu >= nr_cpu_ids)
+		return -EINVAL;
+
+	cpus_read_lock();
+	mutex_lock(&rcu_state.barrier_mutex);
+	ret = __rcu_nocb_cpu_regroup(cpu, gp_cpu);
+	mutex_unlock(&rcu_state.barrier_mutex);
+	cpus_read_unlock();
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(rcu_nocb_cpu_regroup);
+
+/*
+ * Rebalance the rcuog groups every this many milliseconds, zero to stick
+ * to the grouping chosen at boot.
+ */
+static int rcu_nocb_rebalance_ms;
+
+static void rcu_nocb_rebalance(struct work_struct *unused);
+static DECLARE_DELAYED_WORK(rcu_nocb_rebalance_work, rcu_nocb_rebalance);
+
+/*
+ * Each period, add up the callbacks invoked on behalf of each group, and
+ * if the busiest group did more than twice the work of the idlest one,
+ * move the CPU that best evens them out from the first to the second.
+ * Groups that handled fewer than qhimark callbacks are left alone, as
+ * moving a CPU costs a de-offload and a re-offload.
+ */
+static void rcu_nocb_rebalance(struct work_struct *unused)
+{
+	struct rcu_data *rdp, *rdp_max = NULL, *rdp_min = NULL, *rdp_move = NULL;
+	unsigned long cbs, diff, best = 0;
+	int cpu, ms;
+
+	cpus_read_lock();
+	mutex_lock(&rcu_state.barrier_mutex);
+
+	for_each_possible_cpu(cpu) {
+		rdp = per_cpu_ptr(&rcu_data, cpu);
+		if (rdp->nocb_gp_rdp == rdp)
+			rdp->nocb_gp_load = 0;
+	}
+	for_each_possible_cpu(cpu) {
+		rdp = per_cpu_ptr(&rcu_data, cpu);
+		cbs = READ_ONCE(rdp->n_cbs_invoked);
+		rdp->nocb_regroup_load = cbs - rdp->nocb_regroup_cbs;
+		rdp->nocb_regroup_cbs = cbs;
+		if (rdp->nocb_gp_rdp && rcu_rdp_is_offloaded(rdp))
+			rdp->nocb_gp_rdp->nocb_gp_load += rdp->nocb_regroup_load;
+	}
+	for_each_possible_cpu(cpu) {
+		rdp = per_cpu_ptr(&rcu_data, cpu);
+		if (rdp->nocb_gp_rdp != rdp || !READ_ONCE(rdp->nocb_gp_kthread))
+			continue;
+		if (!rdp_max || rdp->nocb_gp_load > rdp_max->nocb_gp_load)
+			rdp_max = rdp;
+		if (!rdp_min || rdp->nocb_gp_load < rdp_min->nocb_gp_load)
+			rdp_min = rdp;
+	}
+	if (!rdp_max || rdp_max == rdp_min || rdp_max->nocb_gp_load < qhimark ||
+	    rdp_max->nocb_gp_load <= 2 * rdp_min->nocb_gp_load)
+		goto out;
+
+	/* Pick the CPU whose load is closest to half the difference. */
+	diff = rdp_max->nocb_gp_load - rdp_min->nocb_gp_load;
+	for_each_cpu(cpu, rcu_nocb_mask) {
+		rdp = per_cpu_ptr(&rcu_data, cpu);
+		if (rdp->nocb_gp_rdp != rdp_max || rdp == rdp_max ||
+		    !cpu_online(cpu) || !rdp->nocb_regroup_load ||
+		    rdp->nocb_regroup_load >= diff)
+			continue;
+		cbs = min(rdp->nocb_regroup_load, diff - rdp->nocb_regroup_load);
+		if (cbs > best) {
+			best = cbs;
+			rdp_move = rdp;
+		}
+	}
+	if (rdp_move && !__rcu_nocb_cpu_regroup(rdp_move->cpu, rdp_min->cpu))
+		pr_info("NOCB: Moved CPU %d from rcuog/%d to rcuog/%d\n",
+			rdp_move->cpu, rdp_max->cpu, rdp_min->cpu);
+
+out:
+	mutex_unlock(&rcu_state.barrier_mutex);
+	cpus_read_unlock();
+
+	ms = READ_ONCE(rcu_nocb_rebalance_ms);
+	if (ms > 0)
+		schedule_delayed_work(&rcu_nocb_rebalance_work, msecs_to_jiffies(ms));
+}
+
+static int param_set_nocb_rebalance_ms(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_int(val, kp);
+
+	if (!ret && rcu_scheduler_fully_active && rcu_state.nocb_is_setup &&
+	    READ_ONCE(rcu_nocb_rebalance_ms) > 0)
+		mod_delayed_work(system_wq, &rcu_nocb_rebalance_work, 0);
+	return ret;
+}
+
+static const struct kernel_param_ops nocb_rebalance_ms_ops = {
+	.set = param_set_nocb_rebalance_ms,
+	.get = param_get_int,
+};
+module_param_cb(rcu_nocb_rebalance_ms, &nocb_rebalance_ms_ops, &rcu_nocb_rebalance_ms, 0644);
+
+static int __init rcu_nocb_rebalance_init(void)
+{
+	if (rcu_state.nocb_is_setup && rcu_nocb_rebalance_ms > 0)
+		schedule_delayed_work(&rcu_nocb_rebalance_work,
+				      msecs_to_jiffies(rcu_nocb_rebalance_ms));
+	return 0;
+}
+late_initcall(rcu_nocb_rebalance_init);
+
+/*
+ * Report one line per rcuog kthread through
+ * /sys/module/rcutree/parameters/rcu_nocb_group_stats: its CPU, the
+ * number of CPUs in its group, the callbacks they invoked in the last
+ * rebalance period, the number of wakeups and their average and worst
+ * latency, and the number of grace periods waited for and the average
+ * wait, with times in nanoseconds.
+ */
+static int param_get_nocb_group_stats(char *buffer, const struct kernel_param *kp)
+{
+	struct rcu_data *rdp, *rdp_gp;
+	unsigned long nwakes, nwaits;
+	int cpu, gp_cpu, len = 0, n;
+
+	if (!cpumask_available(rcu_nocb_mask))
+		return 0;
+
+	for_each_possible_cpu(gp_cpu) {
+		rdp_gp = per_cpu_ptr(&rcu_data, gp_cpu);
+		if (rdp_gp->nocb_gp_rdp != rdp_gp || !READ_ONCE(rdp_gp->nocb_gp_kthread))
+			continue;
+		n = 0;
+		for_each_cpu(cpu, rcu_nocb_mask) {
+			rdp = per_cpu_ptr(&rcu_data, cpu);
+			if (READ_ONCE(rdp->nocb_gp_rdp) == rdp_gp)
+				n++;
+		}
+		nwakes = data_race(rdp_gp->nocb_gp_nwakes);
+		nwaits = data_race(rdp_gp->nocb_gp_nwaits);
+		len += scnprintf(buffer + len, PAGE_SIZE - len,
+				 "%d %d %lu %lu %llu %llu %lu %llu\n",
+				 gp_cpu, n, data_race(rdp_gp->nocb_gp_load), nwakes,
+				 nwakes ? div64_ul(data_race(rdp_gp->nocb_gp_wake_lat_ns), nwakes) : 0,
+				 data_race(rdp_gp->nocb_gp_wake_lat_max_ns), nwaits,
+				 nwaits ? div64_ul(data_race(rdp_gp->nocb_gp_wait_ns), nwaits) : 0);
+	}
+
+	return len;
+}
+
+static const struct kernel_param_ops nocb_group_stats_ops = {
+	.get = param_get_nocb_group_stats,
+};
+module_param_cb(rcu_nocb_group_stats, &nocb_group_stats_ops, NULL, 0444);
+
 /*
  * Bind the current task to the offloaded CPUs.  If there are no offloaded
  * CPUs, leave the task unbound.  Splat if the bind attempt fails.
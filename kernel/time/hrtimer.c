@@ -24,6 +24,7 @@
 
 #include <linux/cpu.h>
 #include <linux/export.h>
+#include <linux/moduleparam.h>
 #include <linux/percpu.h>
 #include <linux/hrtimer.h>
 #include <linux/notifier.h>
@@ -1209,6 +1210,54 @@ hrtimer_update_softirq_timer(struct hrtimer_cpu_base *cpu_base, bool reprogram)
 	hrtimer_reprogram(cpu_base->softirq_next_timer, reprogram);
 }
 
+/*
+ * Coalescing of timers with slack across tasks: when set, the hard expiry
+ * of a timer with a range is moved back to the last multiple of
+ * coalesce_ns (rounded down to a power of two) that still lies within the
+ * range, if any.  Timers whose ranges cover the same grid point then end
+ * up with the same hard expiry and are expired by one interrupt.  Timers
+ * never expire before their soft expiry, nor after their hard one.
+ */
+static unsigned int hrtimer_coalesce_shift __read_mostly;
+
+static int hrtimer_coalesce_set(const char *val, const struct kernel_param *kp)
+{
+	unsigned long ns;
+	int ret = kstrtoul(val, 0, &ns);
+
+	if (ret)
+		return ret;
+	WRITE_ONCE(hrtimer_coalesce_shift, ns > 1 ? ilog2(ns) : 0);
+	return 0;
+}
+
+static int hrtimer_coalesce_get(char *buffer, const struct kernel_param *kp)
+{
+	unsigned int shift = READ_ONCE(hrtimer_coalesce_shift);
+
+	return sprintf(buffer, "%llu\n", shift ? 1ULL << shift : 0);
+}
+
+static const struct kernel_param_ops hrtimer_coalesce_ops = {
+	.set = hrtimer_coalesce_set,
+	.get = hrtimer_coalesce_get,
+};
+module_param_cb(coalesce_ns, &hrtimer_coalesce_ops, NULL, 0644);
+
+static inline void hrtimer_coalesce_expires(struct hrtimer *timer, u64 delta_ns)
+{
+	unsigned int shift = READ_ONCE(hrtimer_coalesce_shift);
+	ktime_t expires;
+
+	if (!shift || !delta_ns)
+		return;
+
+	expires = hrtimer_get_expires(timer) & ~((1ULL << shift) - 1);
+	if (expires >= hrtimer_get_softexpires(timer) &&
+	    expires < hrtimer_get_expires(timer))
+		timer->node.expires = expires;
+}
+
 static int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 				    u64 delta_ns, const enum hrtimer_mode mode,
 				    struct hrtimer_clock_base *base)
@@ -1246,6 +1295,7 @@ static int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 	tim = hrtimer_update_lowres(timer, tim, mode);
 
 	hrtimer_set_expires_range_ns(timer, tim, delta_ns);
+	hrtimer_coalesce_expires(timer, delta_ns);
 
 	/* Switch the timer base, if necessary: */
 	if (!force_local) {
@@ -1714,11 +1764,13 @@ static void __run_hrtimer(struct hrtimer_cpu_base *cpu_base,
 	base->running = NULL;
 }
 
-static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
-				 unsigned long flags, unsigned int active_mask)
+/* Returns the number of timers expired. */
+static unsigned int __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
+					 unsigned long flags, unsigned int active_mask)
 {
 	struct hrtimer_clock_base *base;
 	unsigned int active = cpu_base->active_bases & active_mask;
+	unsigned int expired = 0;
 
 	for_each_active_base(base, cpu_base, active) {
 		struct timerqueue_node *node;
@@ -1749,8 +1801,11 @@ static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
 			__run_hrtimer(cpu_base, base, timer, &basenow, flags);
 			if (active_mask == HRTIMER_ACTIVE_SOFT)
 				hrtimer_sync_wait_running(cpu_base, flags);
+			expired++;
 		}
 	}
+
+	return expired;
 }
 
 static __latent_entropy void hrtimer_run_softirq(struct softirq_action *h)
@@ -1782,6 +1837,7 @@ void hrtimer_interrupt(struct clock_event_device *dev)
 {
 	struct hrtimer_cpu_base *cpu_base = this_cpu_ptr(&hrtimer_bases);
 	ktime_t expires_next, now, entry_time, delta;
+	unsigned int n, expired = 0;
 	unsigned long flags;
 	int retries = 0;
 
@@ -1808,7 +1864,11 @@ void hrtimer_interrupt(struct clock_event_device *dev)
 		raise_softirq_irqoff(HRTIMER_SOFTIRQ);
 	}
 
-	__hrtimer_run_queues(cpu_base, now, flags, HRTIMER_ACTIVE_HARD);
+	n = __hrtimer_run_queues(cpu_base, now, flags, HRTIMER_ACTIVE_HARD);
+	cpu_base->nr_expired += n;
+	expired += n;
+	if (expired > cpu_base->max_expired)
+		cpu_base->max_expired = expired;
 
 	/* Reevaluate the clock bases for the [soft] next expiry */
 	expires_next = hrtimer_update_next_event(cpu_base);
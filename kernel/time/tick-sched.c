@@ -25,6 +25,8 @@
 #include <linux/irq_work.h>
 #include <linux/posix-timers.h>
 #include <linux/context_tracking.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/mm.h>
 
 #include <asm/irq_regs.h>
@@ -252,32 +254,37 @@ bool tick_nohz_full_running;
 EXPORT_SYMBOL_GPL(tick_nohz_full_running);
 static atomic_t tick_dep_mask;
 
-static bool check_tick_dependency(atomic_t *dep)
+static bool check_tick_dependency(atomic_t *dep, struct tick_sched *ts)
 {
 	int val = atomic_read(dep);
 
 	if (val & TICK_DEP_MASK_POSIX_TIMER) {
 		trace_tick_stop(0, TICK_DEP_MASK_POSIX_TIMER);
+		ts->retained[TICK_RETAIN_POSIX_TIMER]++;
 		return true;
 	}
 
 	if (val & TICK_DEP_MASK_PERF_EVENTS) {
 		trace_tick_stop(0, TICK_DEP_MASK_PERF_EVENTS);
+		ts->retained[TICK_RETAIN_PERF_EVENTS]++;
 		return true;
 	}
 
 	if (val & TICK_DEP_MASK_SCHED) {
 		trace_tick_stop(0, TICK_DEP_MASK_SCHED);
+		ts->retained[TICK_RETAIN_SCHED]++;
 		return true;
 	}
 
 	if (val & TICK_DEP_MASK_CLOCK_UNSTABLE) {
 		trace_tick_stop(0, TICK_DEP_MASK_CLOCK_UNSTABLE);
+		ts->retained[TICK_RETAIN_CLOCK_UNSTABLE]++;
 		return true;
 	}
 
 	if (val & TICK_DEP_MASK_RCU) {
 		trace_tick_stop(0, TICK_DEP_MASK_RCU);
+		ts->retained[TICK_RETAIN_RCU]++;
 		return true;
 	}
 
@@ -291,16 +298,16 @@ static bool can_stop_full_tick(int cpu, struct tick_sched *ts)
 	if (unlikely(!cpu_online(cpu)))
 		return false;
 
-	if (check_tick_dependency(&tick_dep_mask))
+	if (check_tick_dependency(&tick_dep_mask, ts))
 		return false;
 
-	if (check_tick_dependency(&ts->tick_dep_mask))
+	if (check_tick_dependency(&ts->tick_dep_mask, ts))
 		return false;
 
-	if (check_tick_dependency(&current->tick_dep_mask))
+	if (check_tick_dependency(&current->tick_dep_mask, ts))
 		return false;
 
-	if (check_tick_dependency(&current->signal->tick_dep_mask))
+	if (check_tick_dependency(&current->signal->tick_dep_mask, ts))
 		return false;
 
 	return true;
@@ -782,8 +789,26 @@ static inline bool local_timer_softirq_pending(void)
 	return local_softirq_pending() & BIT(TIMER_SOFTIRQ);
 }
 
+/*
+ * Return the reason why the tick must keep going regardless of the timers
+ * queued on this CPU, or TICK_RETAIN_NR if there is none.
+ */
+static enum tick_retain_reason tick_nohz_retain_reason(void)
+{
+	if (rcu_needs_cpu())
+		return TICK_RETAIN_RCU_NEEDS_CPU;
+	if (arch_needs_cpu())
+		return TICK_RETAIN_ARCH;
+	if (irq_work_needs_cpu())
+		return TICK_RETAIN_IRQ_WORK;
+	if (local_timer_softirq_pending())
+		return TICK_RETAIN_TIMER_SOFTIRQ;
+	return TICK_RETAIN_NR;
+}
+
 static ktime_t tick_nohz_next_event(struct tick_sched *ts, int cpu)
 {
+	enum tick_retain_reason reason;
 	u64 basemono, next_tick, delta, expires;
 	unsigned long basejiff;
 	unsigned int seq;
@@ -807,8 +832,8 @@ static ktime_t tick_nohz_next_event(struct tick_sched *ts, int cpu)
 	 * minimal delta which brings us back to this place
 	 * immediately. Lather, rinse and repeat...
 	 */
-	if (rcu_needs_cpu() || arch_needs_cpu() ||
-	    irq_work_needs_cpu() || local_timer_softirq_pending()) {
+	reason = tick_nohz_retain_reason();
+	if (reason != TICK_RETAIN_NR) {
 		next_tick = basemono + TICK_NSEC;
 	} else {
 		/*
@@ -838,6 +863,7 @@ static ktime_t tick_nohz_next_event(struct tick_sched *ts, int cpu)
 		 * next period, so no point in stopping it either, bail.
 		 */
 		if (!ts->tick_stopped) {
+			ts->retained[reason != TICK_RETAIN_NR ? reason : TICK_RETAIN_TIMER]++;
 			ts->timer_expires = 0;
 			goto out;
 		}
@@ -1438,6 +1464,56 @@ static inline void tick_nohz_irq_enter(void)
 		tick_nohz_update_jiffies(now);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static const char * const tick_retain_names[TICK_RETAIN_NR] = {
+	[TICK_RETAIN_POSIX_TIMER]	= "posix_timer",
+	[TICK_RETAIN_PERF_EVENTS]	= "perf_events",
+	[TICK_RETAIN_SCHED]		= "sched",
+	[TICK_RETAIN_CLOCK_UNSTABLE]	= "clock_unstable",
+	[TICK_RETAIN_RCU]		= "rcu",
+	[TICK_RETAIN_RCU_NEEDS_CPU]	= "rcu_needs_cpu",
+	[TICK_RETAIN_ARCH]		= "arch",
+	[TICK_RETAIN_IRQ_WORK]		= "irq_work",
+	[TICK_RETAIN_TIMER_SOFTIRQ]	= "timer_softirq",
+	[TICK_RETAIN_TIMER]		= "timer",
+};
+
+/*
+ * /sys/kernel/debug/tick_retain: how many times each CPU kept its tick
+ * going when it tried to stop it, by reason.  Unused entries of the
+ * reason table (dependency bits that are never checked) are skipped.
+ */
+static int tick_retain_show(struct seq_file *m, void *v)
+{
+	int cpu, i;
+
+	seq_puts(m, "cpu");
+	for (i = 0; i < TICK_RETAIN_NR; i++)
+		if (tick_retain_names[i])
+			seq_printf(m, " %s", tick_retain_names[i]);
+	seq_putc(m, '\n');
+
+	for_each_online_cpu(cpu) {
+		struct tick_sched *ts = tick_get_tick_sched(cpu);
+
+		seq_printf(m, "%d", cpu);
+		for (i = 0; i < TICK_RETAIN_NR; i++)
+			if (tick_retain_names[i])
+				seq_printf(m, " %lu", data_race(ts->retained[i]));
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(tick_retain);
+
+static int __init tick_retain_debugfs_init(void)
+{
+	debugfs_create_file("tick_retain", 0444, NULL, NULL, &tick_retain_fops);
+	return 0;
+}
+late_initcall(tick_retain_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
+
 #else
 
 static inline void tick_nohz_switch_to_nohz(void) { }
@@ -20,6 +20,24 @@ enum tick_nohz_mode {
 	NOHZ_MODE_HIGHRES,
 };
 
+/*
+ * Reasons for keeping the tick going on a CPU that could otherwise stop
+ * it.  The first ones are the tick dependencies of full dynticks.
+ */
+enum tick_retain_reason {
+	TICK_RETAIN_POSIX_TIMER		= TICK_DEP_BIT_POSIX_TIMER,
+	TICK_RETAIN_PERF_EVENTS		= TICK_DEP_BIT_PERF_EVENTS,
+	TICK_RETAIN_SCHED		= TICK_DEP_BIT_SCHED,
+	TICK_RETAIN_CLOCK_UNSTABLE	= TICK_DEP_BIT_CLOCK_UNSTABLE,
+	TICK_RETAIN_RCU			= TICK_DEP_BIT_RCU,
+	TICK_RETAIN_RCU_NEEDS_CPU	= TICK_DEP_BIT_MAX + 1,
+	TICK_RETAIN_ARCH,
+	TICK_RETAIN_IRQ_WORK,
+	TICK_RETAIN_TIMER_SOFTIRQ,
+	TICK_RETAIN_TIMER,
+	TICK_RETAIN_NR
+};
+
 /**
  * struct tick_sched - sched tick emulation and no idle tick control/stats
  * @sched_timer:	hrtimer to schedule the periodic tick in high
@@ -51,6 +69,7 @@ enum tick_nohz_mode {
  * @tick_dep_mask:	Tick dependency mask - is set, if someone needs the tick
  * @last_tick_jiffies:	Value of jiffies seen on last tick
  * @stalled_jiffies:	Number of stalled jiffies detected across ticks
+ * @retained:		Times the tick could not be stopped, by reason
  */
 struct tick_sched {
 	struct hrtimer			sched_timer;
@@ -81,6 +100,7 @@ struct tick_sched {
 	atomic_t			tick_dep_mask;
 	unsigned long			last_tick_jiffies;
 	unsigned int			stalled_jiffies;
+	unsigned long			retained[TICK_RETAIN_NR];
 };
 
 extern struct tick_sched *tick_get_tick_sched(int cpu);
@@ -114,6 +114,40 @@ static struct tk_fast tk_fast_raw  ____cacheline_aligned = {
 	.base[1] = FAST_TK_INIT,
 };
 
+/**
+ * struct tk_coarse_base - Tick granular time, as of the last update
+ * @xtime:		CLOCK_REALTIME
+ * @wall_to_monotonic:	Offset from CLOCK_REALTIME to CLOCK_MONOTONIC
+ * @mono:		CLOCK_MONOTONIC
+ * @offs:		Offsets from CLOCK_MONOTONIC, indexed by enum tk_offsets
+ */
+struct tk_coarse_base {
+	struct timespec64	xtime;
+	struct timespec64	wall_to_monotonic;
+	ktime_t			mono;
+	ktime_t			offs[TK_OFFS_MAX];
+};
+
+/**
+ * struct tk_fast_coarse - Coarse timekeeper readable without tk_core.seq
+ * @seq:	Sequence latch. The lowest bit is the index for @base
+ * @base:	Two copies of the coarse time
+ *
+ * The coarse clocks only change on a timekeeping update, so there is
+ * nothing to compute at read time. Keeping them in a latch instead of
+ * behind tk_core.seq means readers never spin while an update is in
+ * progress; they take the copy that isn't being written. See
+ * @update_fast_coarse().
+ */
+struct tk_fast_coarse {
+	seqcount_latch_t	seq;
+	struct tk_coarse_base	base[2];
+};
+
+static struct tk_fast_coarse tk_fast_coarse ____cacheline_aligned = {
+	.seq     = SEQCNT_LATCH_ZERO(tk_fast_coarse.seq),
+};
+
 static inline void tk_normalize_xtime(struct timekeeper *tk)
 {
 	while (tk->tkr_mono.xtime_nsec >= ((u64)NSEC_PER_SEC << tk->tkr_mono.shift)) {
@@ -431,6 +465,37 @@ static void update_fast_timekeeper(const struct tk_read_base *tkr,
 	memcpy(base + 1, base, sizeof(*base));
 }
 
+/**
+ * update_fast_coarse - Update the latched coarse time
+ * @tk:		Timekeeper from which we take the update
+ *
+ * Same latch technique as @update_fast_timekeeper(). Called with
+ * tk_core.seq held for writing, so the copies are consistent with what
+ * the seqcount protected readers see.
+ */
+static void update_fast_coarse(const struct timekeeper *tk)
+{
+	struct tk_coarse_base *base = tk_fast_coarse.base;
+
+	/* Force readers off to base[1] */
+	raw_write_seqcount_latch(&tk_fast_coarse.seq);
+
+	/* Update base[0] */
+	base->xtime = tk_xtime(tk);
+	base->wall_to_monotonic = tk->wall_to_monotonic;
+	base->mono = ktime_add_ns(tk->tkr_mono.base,
+				  tk->tkr_mono.xtime_nsec >> tk->tkr_mono.shift);
+	base->offs[TK_OFFS_REAL] = tk->offs_real;
+	base->offs[TK_OFFS_BOOT] = tk->offs_boot;
+	base->offs[TK_OFFS_TAI] = tk->offs_tai;
+
+	/* Force readers back to base[0] */
+	raw_write_seqcount_latch(&tk_fast_coarse.seq);
+
+	/* Update base[1] */
+	memcpy(base + 1, base, sizeof(*base));
+}
+
 static __always_inline u64 fast_tk_get_delta_ns(struct tk_read_base *tkr)
 {
 	u64 delta, cycles = tk_clock_read(tkr);
@@ -770,6 +835,7 @@ static void timekeeping_update(struct timekeeper *tk, unsigned int action)
 	tk->tkr_mono.base_real = tk->tkr_mono.base + tk->offs_real;
 	update_fast_timekeeper(&tk->tkr_mono, &tk_fast_mono);
 	update_fast_timekeeper(&tk->tkr_raw,  &tk_fast_raw);
+	update_fast_coarse(tk);
 
 	if (action & TK_CLOCK_WAS_SET)
 		tk->clock_was_set_seq++;
@@ -899,21 +965,19 @@ EXPORT_SYMBOL_GPL(ktime_get_with_offset);
 
 ktime_t ktime_get_coarse_with_offset(enum tk_offsets offs)
 {
-	struct timekeeper *tk = &tk_core.timekeeper;
+	struct tk_coarse_base *base;
 	unsigned int seq;
-	ktime_t base, *offset = offsets[offs];
-	u64 nsecs;
+	ktime_t now;
 
 	WARN_ON(timekeeping_suspended);
 
 	do {
-		seq = read_seqcount_begin(&tk_core.seq);
-		base = ktime_add(tk->tkr_mono.base, *offset);
-		nsecs = tk->tkr_mono.xtime_nsec >> tk->tkr_mono.shift;
+		seq = raw_read_seqcount_latch(&tk_fast_coarse.seq);
+		base = tk_fast_coarse.base + (seq & 0x01);
+		now = ktime_add(base->mono, base->offs[offs]);
+	} while (read_seqcount_latch_retry(&tk_fast_coarse.seq, seq));
 
-	} while (read_seqcount_retry(&tk_core.seq, seq));
-
-	return ktime_add_ns(base, nsecs);
+	return now;
 }
 EXPORT_SYMBOL_GPL(ktime_get_coarse_with_offset);
 
@@ -2252,31 +2316,33 @@ void getboottime64(struct timespec64 *ts)
 }
 EXPORT_SYMBOL_GPL(getboottime64);
 
+/*
+ * The coarse readers below use the latched copy, so they don't retry
+ * behind a timekeeping update and are NMI safe.
+ */
 void ktime_get_coarse_real_ts64(struct timespec64 *ts)
 {
-	struct timekeeper *tk = &tk_core.timekeeper;
 	unsigned int seq;
 
 	do {
-		seq = read_seqcount_begin(&tk_core.seq);
-
-		*ts = tk_xtime(tk);
-	} while (read_seqcount_retry(&tk_core.seq, seq));
+		seq = raw_read_seqcount_latch(&tk_fast_coarse.seq);
+		*ts = tk_fast_coarse.base[seq & 0x01].xtime;
+	} while (read_seqcount_latch_retry(&tk_fast_coarse.seq, seq));
 }
 EXPORT_SYMBOL(ktime_get_coarse_real_ts64);
 
 void ktime_get_coarse_ts64(struct timespec64 *ts)
 {
-	struct timekeeper *tk = &tk_core.timekeeper;
+	struct tk_coarse_base *base;
 	struct timespec64 now, mono;
 	unsigned int seq;
 
 	do {
-		seq = read_seqcount_begin(&tk_core.seq);
-
-		now = tk_xtime(tk);
-		mono = tk->wall_to_monotonic;
-	} while (read_seqcount_retry(&tk_core.seq, seq));
+		seq = raw_read_seqcount_latch(&tk_fast_coarse.seq);
+		base = tk_fast_coarse.base + (seq & 0x01);
+		now = base->xtime;
+		mono = base->wall_to_monotonic;
+	} while (read_seqcount_latch_retry(&tk_fast_coarse.seq, seq));
 
 	set_normalized_timespec64(ts, now.tv_sec + mono.tv_sec,
 				now.tv_nsec + mono.tv_nsec);
@@ -1217,6 +1217,101 @@ int timer_reduce(struct timer_list *timer, unsigned long expires)
 }
 EXPORT_SYMBOL(timer_reduce);
 
+/* Most timers mod_timer_batch() handles in one go with interrupts off */
+#define MOD_TIMER_BATCH_MAX	32
+
+/*
+ * Like lock_timer_base(), but keep @held locked if @timer lives on it.
+ * The base of a timer can't change under its base lock, so there is
+ * no need to recheck the flags then.
+ */
+static struct timer_base *lock_timer_base_batch(struct timer_list *timer,
+						struct timer_base *held,
+						unsigned long *flags)
+{
+	if (held) {
+		u32 tf = READ_ONCE(timer->flags);
+
+		if (!(tf & TIMER_MIGRATING) && get_timer_base(tf) == held)
+			return held;
+		raw_spin_unlock_irqrestore(&held->lock, *flags);
+	}
+	return lock_timer_base(timer, flags);
+}
+
+/**
+ * mod_timer_batch - Modify the timeouts of several timers
+ * @timers:	The timers to be modified
+ * @expires:	New absolute timeouts in jiffies, one for each timer
+ * @nr:		Number of timers
+ *
+ * mod_timer_batch() does mod_timer(@timers[i], @expires[i]) for each
+ * timer, but takes the lock of a timer base only once for consecutive
+ * timers on the same base.  Callers re-arming many timers at once, e.g.
+ * those of all the connections served by a CPU, should batch timers that
+ * were armed on the same CPU together.
+ *
+ * Unlike mod_timer(), timers are not moved to the base of the current
+ * CPU, they stay where they were last armed.
+ *
+ * Return: The number of timers that were active.
+ */
+unsigned int mod_timer_batch(struct timer_list **timers,
+			     const unsigned long *expires, unsigned int nr)
+{
+	struct timer_base *base = NULL, *new_base;
+	unsigned long flags, bucket_expiry;
+	unsigned int i, idx, ret = 0, held = 0;
+
+	for (i = 0; i < nr; i++) {
+		struct timer_list *timer = timers[i];
+
+		debug_assert_init(timer);
+
+		/* The same shortcut as in __mod_timer(). */
+		if (timer_pending(timer) && timer->expires == expires[i]) {
+			ret++;
+			continue;
+		}
+
+		if (base && held == MOD_TIMER_BATCH_MAX) {
+			raw_spin_unlock_irqrestore(&base->lock, flags);
+			base = NULL;
+		}
+		new_base = lock_timer_base_batch(timer, base, &flags);
+		if (new_base != base) {
+			base = new_base;
+			forward_timer_base(base);
+			held = 0;
+		}
+		held++;
+
+		/* Has @timer been shutdown? */
+		if (!timer->function)
+			continue;
+
+		idx = calc_wheel_index(expires[i], base->clk, &bucket_expiry);
+		if (timer_pending(timer)) {
+			ret++;
+			if (idx == timer_get_idx(timer)) {
+				timer->expires = expires[i];
+				continue;
+			}
+			detach_if_pending(timer, base, false);
+		}
+
+		debug_timer_activate(timer);
+		timer->expires = expires[i];
+		enqueue_timer(base, timer, idx, bucket_expiry);
+	}
+
+	if (base)
+		raw_spin_unlock_irqrestore(&base->lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(mod_timer_batch);
+
 /**
  * add_timer - Start a timer
  * @timer:	The timer to be started
@@ -21,6 +21,9 @@
 
 #define CHACHA_KEY_WORDS	(CHACHA_KEY_SIZE / sizeof(u32))
 
+/* Messages up to this long get their key stream in the same call as block0 */
+#define CHACHA20POLY1305_SHORT_LEN	(3 * CHACHA_BLOCK_SIZE)
+
 static void chacha_load_key(u32 *k, const u8 *in)
 {
 	k[0] = get_unaligned_le32(in);
@@ -227,11 +230,14 @@ bool chacha20poly1305_crypt_sg_inplace(struct scatterlist *src,
 		};
 		u8 block0[POLY1305_KEY_SIZE];
 		u8 chacha_stream[CHACHA_BLOCK_SIZE];
+		u8 short_stream[CHACHA_BLOCK_SIZE +
+				CHACHA20POLY1305_SHORT_LEN];
 		struct {
 			u8 mac[2][POLY1305_DIGEST_SIZE];
 		};
 		__le64 lens[2];
 	} b __aligned(16);
+	bool short_msg = src_len <= CHACHA20POLY1305_SHORT_LEN;
 
 	if (WARN_ON(src_len > INT_MAX))
 		return false;
@@ -242,7 +248,16 @@ bool chacha20poly1305_crypt_sg_inplace(struct scatterlist *src,
 	b.iv[1] = cpu_to_le64(nonce);
 
 	chacha_init(chacha_state, b.k, (u8 *)b.iv);
-	chacha20_crypt(chacha_state, b.block0, pad0, sizeof(b.block0));
+	/*
+	 * A short message takes no more blocks than a SIMD implementation does
+	 * in one go, so generate its key stream together with block0 rather
+	 * than paying for a second call, as small packets would otherwise.
+	 */
+	if (short_msg)
+		chacha20_crypt(chacha_state, b.short_stream, pad0,
+			       CHACHA_BLOCK_SIZE + src_len);
+	else
+		chacha20_crypt(chacha_state, b.block0, pad0, sizeof(b.block0));
 	poly1305_init(&poly1305_state, b.block0);
 
 	if (unlikely(ad_len)) {
@@ -262,6 +277,12 @@ bool chacha20poly1305_crypt_sg_inplace(struct scatterlist *src,
 		if (!encrypt)
 			poly1305_update(&poly1305_state, addr, length);
 
+		if (short_msg) {
+			crypto_xor(addr, b.short_stream + CHACHA_BLOCK_SIZE +
+					 src_len - sl, length);
+			length = 0;
+		}
+
 		if (unlikely(partial)) {
 			size_t l = min(length, CHACHA_BLOCK_SIZE - partial);
 
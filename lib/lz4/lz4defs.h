@@ -176,11 +176,21 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	const BYTE *s = (const BYTE *)srcPtr;
 	BYTE *const e = (BYTE *)dstEnd;
 
-	do {
+	/*
+	 * Two words per iteration while that stays within the 7 bytes of
+	 * overrun; long literal runs and matches spend most of their time
+	 * here. Source and destination may be as close as 8 bytes, so the
+	 * words are still copied in order.
+	 */
+	while (e - d > 8) {
+		LZ4_copy8(d, s);
+		LZ4_copy8(d + 8, s + 8);
+		d += 16;
+		s += 16;
+	}
+
+	if (d < e)
 		LZ4_copy8(d, s);
-		d += 8;
-		s += 8;
-	} while (d < e);
 }
 
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
@@ -28,6 +28,9 @@ EXPORT_SYMBOL_GPL(raid6_call);
 
 const struct raid6_calls * const raid6_algos[] = {
 #if defined(__i386__) && !defined(__arch_um__)
+#ifdef CONFIG_AS_GFNI
+	&raid6_gfnix2,
+#endif
 #ifdef CONFIG_AS_AVX512
 	&raid6_avx512x2,
 	&raid6_avx512x1,
@@ -42,6 +45,10 @@ const struct raid6_calls * const raid6_algos[] = {
 	&raid6_mmxx1,
 #endif
 #if defined(__x86_64__) && !defined(__arch_um__)
+#ifdef CONFIG_AS_GFNI
+	&raid6_gfnix4,
+	&raid6_gfnix2,
+#endif
 #ifdef CONFIG_AS_AVX512
 	&raid6_avx512x4,
 	&raid6_avx512x2,
@@ -92,6 +99,9 @@ EXPORT_SYMBOL_GPL(raid6_datap_recov);
 
 const struct raid6_recov_calls *const raid6_recov_algos[] = {
 #ifdef CONFIG_X86
+#ifdef CONFIG_AS_GFNI
+	&raid6_recov_gfni,
+#endif
 #ifdef CONFIG_AS_AVX512
 	&raid6_recov_avx512,
 #endif
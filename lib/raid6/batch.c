@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * raid6/batch.c
+ *
+ * Syndrome generation for a batch of stripes, optionally spread over
+ * several CPUs.
+ *
+ * The stripes are handed out in runs of RAID6_BATCH_RUN to the caller and
+ * to up to @threads - 1 workers on system_unbound_wq, so that each CPU
+ * streams through neighbouring stripes.  The caller always takes part, so
+ * a batch makes progress even when the workqueue is busy, and returns only
+ * once every stripe has its P and Q.
+ */
+
+#include <linux/raid/pq.h>
+#include <linux/atomic.h>
+#include <linux/cpumask.h>
+#include <linux/export.h>
+#include <linux/minmax.h>
+#include <linux/workqueue.h>
+
+/* Stripes taken at a time by one CPU */
+#define RAID6_BATCH_RUN		8
+
+/* Workers helping a single caller */
+#define RAID6_BATCH_MAX_WORKERS	7
+
+/* Below this many bytes in the whole batch, don't bother with workers */
+#define RAID6_BATCH_MIN_BYTES	(1UL << 20)
+
+struct raid6_batch {
+	int		disks;
+	size_t		bytes;
+	int		nr;
+	void		***ptrs;
+	atomic_t	next;
+};
+
+struct raid6_batch_work {
+	struct work_struct	work;
+	struct raid6_batch	*batch;
+};
+
+static void raid6_batch_run(struct raid6_batch *b)
+{
+	int i, end;
+
+	while ((i = atomic_fetch_add(RAID6_BATCH_RUN, &b->next)) < b->nr) {
+		end = min(i + RAID6_BATCH_RUN, b->nr);
+		for (; i < end; i++)
+			raid6_call.gen_syndrome(b->disks, b->bytes, b->ptrs[i]);
+	}
+}
+
+static void raid6_batch_work_fn(struct work_struct *work)
+{
+	raid6_batch_run(container_of(work, struct raid6_batch_work, work)->batch);
+}
+
+/**
+ * raid6_gen_syndrome_batch - compute P and Q for a batch of stripes
+ * @disks: number of blocks in each stripe, including P and Q
+ * @bytes: length of each block
+ * @nr: number of stripes
+ * @ptrs: @nr block pointer arrays, laid out as for gen_syndrome()
+ * @threads: maximum number of CPUs to use, 0 or 1 to stay on this one
+ *
+ * May sleep if @threads is larger than 1.
+ */
+void raid6_gen_syndrome_batch(int disks, size_t bytes, int nr, void ***ptrs,
+			      unsigned int threads)
+{
+	struct raid6_batch_work workers[RAID6_BATCH_MAX_WORKERS];
+	struct raid6_batch b = {
+		.disks	= disks,
+		.bytes	= bytes,
+		.nr	= nr,
+		.ptrs	= ptrs,
+		.next	= ATOMIC_INIT(0),
+	};
+	unsigned int i, nr_workers = 0;
+
+	if (threads > 1 && (size_t)nr * disks * bytes >= RAID6_BATCH_MIN_BYTES) {
+		nr_workers = min3(threads - 1, num_online_cpus() - 1,
+				  (unsigned int)RAID6_BATCH_MAX_WORKERS);
+		/* No point in waking more workers than there are runs */
+		nr_workers = min(nr_workers,
+				 (unsigned int)DIV_ROUND_UP(nr, RAID6_BATCH_RUN) - 1);
+	}
+
+	for (i = 0; i < nr_workers; i++) {
+		INIT_WORK_ONSTACK(&workers[i].work, raid6_batch_work_fn);
+		workers[i].batch = &b;
+		queue_work(system_unbound_wq, &workers[i].work);
+	}
+
+	raid6_batch_run(&b);
+
+	for (i = 0; i < nr_workers; i++) {
+		flush_work(&workers[i].work);
+		destroy_work_on_stack(&workers[i].work);
+	}
+}
+EXPORT_SYMBOL_GPL(raid6_gen_syndrome_batch);
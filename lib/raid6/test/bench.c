@@ -0,0 +1,259 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * raid6bench.c
+ *
+ * Throughput of the RAID-6 syndrome and recovery routines over working
+ * sets from cache resident to DRAM sized.
+ *
+ * raid6_select_algo() times gen() on a single stripe that stays in L1,
+ * which need not say much about which routine is fastest once the stripes
+ * md works on come from memory.  This walks every usable routine over a
+ * buffer of consecutive stripes, growing it by four each step, and reports
+ * MB/s of data blocks processed.  With -j the results are also written out
+ * as JSON, for comparing the boot time choice across CPUs.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/raid/pq.h>
+
+#define MAX_DISKS	256
+
+const char raid6_empty_zero_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+static int disks = 16;
+static size_t block = PAGE_SIZE;
+static size_t min_set = 16 << 10;
+static size_t max_set = 256 << 20;
+static unsigned int run_ms = 50;
+
+static char *buf;
+static size_t nr_stripes;
+static size_t cur_set;
+static FILE *json;
+static int nr_results;
+
+enum op { OP_GEN, OP_XOR, OP_2DATA, OP_DATAP };
+
+static const char * const op_names[] = {
+	[OP_GEN]	= "gen",
+	[OP_XOR]	= "xor",
+	[OP_2DATA]	= "2data",
+	[OP_DATAP]	= "datap",
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void stripe_ptrs(size_t s, void **ptrs)
+{
+	int d;
+
+	for (d = 0; d < disks; d++)
+		ptrs[d] = buf + (s * disks + d) * block;
+}
+
+static void run_op(enum op op, const struct raid6_calls *gen,
+		   const struct raid6_recov_calls *rec)
+{
+	void *ptrs[MAX_DISKS];
+	size_t s;
+
+	for (s = 0; s < nr_stripes; s++) {
+		stripe_ptrs(s, ptrs);
+		switch (op) {
+		case OP_GEN:
+			gen->gen_syndrome(disks, block, ptrs);
+			break;
+		case OP_XOR:
+			/* The same half of the disks as raid6_choose_gen() */
+			gen->xor_syndrome(disks, (disks >> 1) - 1, disks - 3,
+					  block, ptrs);
+			break;
+		case OP_2DATA:
+			rec->data2(disks, block, 0, 1, ptrs);
+			break;
+		case OP_DATAP:
+			rec->datap(disks, block, 0, ptrs);
+			break;
+		}
+	}
+}
+
+/* MB/s of data blocks gone through, the way raid6_choose_gen() counts */
+static double measure(enum op op, const struct raid6_calls *gen,
+		      const struct raid6_recov_calls *rec)
+{
+	double t0, t;
+	size_t loops = 0, data;
+
+	/* Warm up, and fault the buffer in */
+	run_op(op, gen, rec);
+
+	t0 = now();
+	do {
+		run_op(op, gen, rec);
+		loops++;
+		t = now() - t0;
+	} while (t * 1000 < run_ms);
+
+	data = nr_stripes * (disks - 2) * block;
+	if (op == OP_XOR)
+		data /= 2;
+	return loops * data / t / (1 << 20);
+}
+
+static void report(enum op op, const char *name, int priority, double mbps)
+{
+	size_t set = cur_set;
+
+	printf("%8zuK  %-5s  %-10s %8.0f MB/s\n", set >> 10, op_names[op],
+	       name, mbps);
+
+	if (!json)
+		return;
+	fprintf(json, "%s\n    { \"op\": \"%s\", \"algo\": \"%s\", "
+		"\"priority\": %d, \"working_set\": %zu, \"mbps\": %.0f }",
+		nr_results++ ? "," : "", op_names[op], name, priority, set,
+		mbps);
+}
+
+static size_t parse_size(const char *s)
+{
+	char *end;
+	size_t v = strtoul(s, &end, 0);
+
+	switch (*end) {
+	case 'g': case 'G':
+		v <<= 10;
+		/* fall through */
+	case 'm': case 'M':
+		v <<= 10;
+		/* fall through */
+	case 'k': case 'K':
+		v <<= 10;
+	}
+	return v;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-d disks] [-b block] [-s min_set] [-S max_set]\n"
+		"       [-t ms] [-j file]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	const struct raid6_calls *const *algo;
+	const struct raid6_recov_calls *const *ra;
+	const struct raid6_calls *best_gen = NULL;
+	size_t set;
+	int c;
+
+	while ((c = getopt(argc, argv, "d:b:s:S:t:j:")) != -1) {
+		switch (c) {
+		case 'd':
+			disks = atoi(optarg);
+			break;
+		case 'b':
+			block = parse_size(optarg);
+			break;
+		case 's':
+			min_set = parse_size(optarg);
+			break;
+		case 'S':
+			max_set = parse_size(optarg);
+			break;
+		case 't':
+			run_ms = atoi(optarg);
+			break;
+		case 'j':
+			json = fopen(optarg, "w");
+			if (!json) {
+				perror(optarg);
+				return 1;
+			}
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (disks < 4 || disks > MAX_DISKS || !block || block % 512 ||
+	    min_set > max_set)
+		usage(argv[0]);
+
+	if (posix_memalign((void **)&buf, PAGE_SIZE, max_set + disks * block)) {
+		fprintf(stderr, "raid6bench: out of memory\n");
+		return 1;
+	}
+	for (set = 0; set < max_set + disks * block; set++)
+		buf[set] = rand();
+
+	/* The recovery routines use this for their zero blocks */
+	if (block > PAGE_SIZE)
+		fprintf(stderr, "raid6bench: block larger than a page, "
+			"skipping recovery\n");
+
+	/* What the recovery routines call, if raid6_select_algo() is skipped */
+	for (algo = raid6_algos; *algo; algo++)
+		if (!(*algo)->valid || (*algo)->valid())
+			if (!best_gen || (*algo)->priority > best_gen->priority)
+				best_gen = *algo;
+	raid6_call = *best_gen;
+
+	if (json)
+		fprintf(json, "{\n  \"disks\": %d,\n  \"block\": %zu,\n"
+			"  \"results\": [", disks, block);
+
+	for (set = min_set; set <= max_set; set *= 4) {
+		nr_stripes = set / (disks * block);
+		if (!nr_stripes)
+			nr_stripes = 1;
+		/* Sizes under one stripe all end up the same */
+		if (nr_stripes * disks * block == cur_set)
+			continue;
+		cur_set = nr_stripes * disks * block;
+
+		for (algo = raid6_algos; *algo; algo++) {
+			if ((*algo)->valid && !(*algo)->valid())
+				continue;
+
+			report(OP_GEN, (*algo)->name, (*algo)->priority,
+			       measure(OP_GEN, *algo, NULL));
+			if ((*algo)->xor_syndrome)
+				report(OP_XOR, (*algo)->name,
+				       (*algo)->priority,
+				       measure(OP_XOR, *algo, NULL));
+		}
+
+		for (ra = raid6_recov_algos; block <= PAGE_SIZE && *ra; ra++) {
+			if ((*ra)->valid && !(*ra)->valid())
+				continue;
+
+			report(OP_2DATA, (*ra)->name, (*ra)->priority,
+			       measure(OP_2DATA, NULL, *ra));
+			report(OP_DATAP, (*ra)->name, (*ra)->priority,
+			       measure(OP_DATAP, NULL, *ra));
+		}
+		printf("\n");
+	}
+
+	if (json) {
+		fprintf(json, "\n  ]\n}\n");
+		fclose(json);
+	}
+
+	free(buf);
+	return 0;
+}
@@ -52,24 +52,50 @@ static inline void kernel_fpu_end(void)
 					   * Extensions
 					   */
 #define X86_FEATURE_MMXEXT	(1*32+22) /* AMD MMX extensions */
+#define X86_FEATURE_GFNI	(16*32+ 8) /* Galois Field New Instructions */
 
 /* Should work well enough on modern CPUs for testing */
 static inline int boot_cpu_has(int flag)
 {
 	u32 eax, ebx, ecx, edx;
 
-	eax = (flag & 0x100) ? 7 :
+	eax = (flag & 0x300) ? 7 :
 		(flag & 0x20) ? 0x80000001 : 1;
 	ecx = 0;
 
 	asm volatile("cpuid"
 		     : "+a" (eax), "=b" (ebx), "=d" (edx), "+c" (ecx));
 
-	return ((flag & 0x100 ? ebx :
+	return ((flag & 0x200 ? ecx : flag & 0x100 ? ebx :
 		(flag & 0x80) ? ecx : edx) >> (flag & 31)) & 1;
 }
 
 #endif /* ndef __KERNEL__ */
 
+#ifdef CONFIG_AS_GFNI
+/*
+ * vgf2p8mulb multiplies in the AES field, not in the RAID-6 one, but
+ * multiplication by a constant is linear over GF(2), so vgf2p8affineqb
+ * can do it with the right bit matrix.  Row 7 - i of the matrix picks the
+ * bits of the source byte that make up bit i of the product.
+ */
+static inline u64 raid6_gfni_matrix(u8 c)
+{
+	u64 matrix = 0;
+	int i, k;
+
+	for (i = 0; i < 8; i++) {
+		u8 row = 0;
+
+		for (k = 0; k < 8; k++)
+			if (raid6_gfmul[c][1 << k] & (1 << i))
+				row |= 1 << k;
+		matrix |= (u64)row << (8 * (7 - i));
+	}
+
+	return matrix;
+}
+#endif
+
 #endif
 #endif
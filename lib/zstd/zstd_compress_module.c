@@ -11,7 +11,9 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/slab.h>
 #include <linux/string.h>
+#include <linux/workqueue.h>
 #include <linux/zstd.h>
 
 #include "common/zstd_deps.h"
@@ -101,6 +103,143 @@ size_t zstd_compress_cctx(zstd_cctx *cctx, void *dst, size_t dst_capacity,
 }
 EXPORT_SYMBOL(zstd_compress_cctx);
 
+struct zstd_parallel_job {
+	const void *src;
+	size_t src_size;
+	void *dst;
+	size_t frame_capacity;
+	size_t chunk_size;
+	size_t nr_chunks;
+	size_t *frame_sizes;
+	const zstd_parameters *parameters;
+	size_t workspace_size;
+	unsigned int nr_workers;
+};
+
+struct zstd_parallel_worker {
+	struct work_struct work;
+	struct zstd_parallel_job *job;
+	unsigned int index;
+};
+
+/* Worker n compresses the chunks n, n + nr_workers, n + 2 * nr_workers... */
+static void zstd_parallel_work(struct work_struct *work)
+{
+	struct zstd_parallel_worker *worker =
+		container_of(work, struct zstd_parallel_worker, work);
+	struct zstd_parallel_job *job = worker->job;
+	void *workspace;
+	zstd_cctx *cctx;
+	size_t i;
+
+	workspace = kvmalloc(job->workspace_size, GFP_KERNEL);
+	cctx = zstd_init_cctx(workspace, job->workspace_size);
+
+	for (i = worker->index; i < job->nr_chunks; i += job->nr_workers) {
+		size_t offset = i * job->chunk_size;
+
+		if (!cctx) {
+			job->frame_sizes[i] = ERROR(memory_allocation);
+			continue;
+		}
+		job->frame_sizes[i] = zstd_compress_cctx(cctx,
+			(char *)job->dst + i * job->frame_capacity,
+			job->frame_capacity, (const char *)job->src + offset,
+			min(job->chunk_size, job->src_size - offset),
+			job->parameters);
+	}
+
+	kvfree(workspace);
+}
+
+size_t zstd_compress_parallel_bound(size_t src_size, size_t chunk_size)
+{
+	size_t nr_chunks = DIV_ROUND_UP(src_size, chunk_size) ?: 1;
+
+	return nr_chunks * ZSTD_compressBound(chunk_size);
+}
+EXPORT_SYMBOL(zstd_compress_parallel_bound);
+
+size_t zstd_compress_parallel(void *dst, size_t dst_capacity,
+	const void *src, size_t src_size, const zstd_parameters *parameters,
+	size_t chunk_size, unsigned int nr_workers)
+{
+	struct zstd_parallel_worker *workers;
+	struct zstd_parallel_job job;
+	void *staging = NULL;
+	size_t ret = 0, i, bound;
+	unsigned int n;
+
+	if (!chunk_size)
+		return ERROR(parameter_outOfBound);
+
+	job.src = src;
+	job.src_size = src_size;
+	job.chunk_size = chunk_size;
+	job.nr_chunks = DIV_ROUND_UP(src_size, chunk_size) ?: 1;
+	job.frame_capacity = ZSTD_compressBound(chunk_size);
+	job.parameters = parameters;
+	job.workspace_size = zstd_cctx_workspace_bound(&parameters->cParams);
+	job.nr_workers = clamp_t(size_t, nr_workers, 1, job.nr_chunks);
+
+	/*
+	 * Each frame is written at a fixed offset so that the workers need no
+	 * coordination, then moved down behind the previous one. That is done
+	 * in place when dst holds the worst case, in a bounce buffer otherwise.
+	 */
+	bound = job.nr_chunks * job.frame_capacity;
+	job.dst = dst;
+	if (dst_capacity < bound) {
+		staging = kvmalloc(bound, GFP_KERNEL);
+		if (!staging)
+			return ERROR(memory_allocation);
+		job.dst = staging;
+	}
+
+	job.frame_sizes = kcalloc(job.nr_chunks, sizeof(*job.frame_sizes),
+				  GFP_KERNEL);
+	workers = kcalloc(job.nr_workers, sizeof(*workers), GFP_KERNEL);
+	if (!job.frame_sizes || !workers) {
+		ret = ERROR(memory_allocation);
+		goto out;
+	}
+
+	for (n = 0; n < job.nr_workers; n++) {
+		workers[n].job = &job;
+		workers[n].index = n;
+		INIT_WORK(&workers[n].work, zstd_parallel_work);
+		/* The caller's CPU would only wait, let it take a share */
+		if (n)
+			queue_work(system_unbound_wq, &workers[n].work);
+	}
+	zstd_parallel_work(&workers[0].work);
+	for (n = 1; n < job.nr_workers; n++)
+		flush_work(&workers[n].work);
+
+	for (i = 0; i < job.nr_chunks; i++) {
+		size_t frame_size = job.frame_sizes[i];
+
+		if (ZSTD_isError(frame_size)) {
+			ret = frame_size;
+			goto out;
+		}
+		if (frame_size > dst_capacity - ret) {
+			ret = ERROR(dstSize_tooSmall);
+			goto out;
+		}
+		memmove((char *)dst + ret,
+			(char *)job.dst + i * job.frame_capacity, frame_size);
+		ret += frame_size;
+	}
+
+out:
+	kfree(workers);
+	kfree(job.frame_sizes);
+	kvfree(staging);
+	return ret;
+}
+EXPORT_SYMBOL(zstd_compress_parallel);
+
 size_t zstd_cstream_workspace_bound(const zstd_compression_parameters *cparams)
 {
 	return ZSTD_estimateCStreamSize_usingCParams(*cparams);
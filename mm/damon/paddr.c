@@ -7,11 +7,13 @@
 
 #define pr_fmt(fmt) "damon-pa: " fmt
 
+#include <linux/migrate.h>
 #include <linux/mmu_notifier.h>
 #include <linux/page_idle.h>
 #include <linux/pagemap.h>
 #include <linux/rmap.h>
 #include <linux/swap.h>
+#include <linux/workqueue.h>
 
 #include "../internal.h"
 #include "ops-common.h"
@@ -70,17 +72,6 @@ static void __damon_pa_prepare_access_check(struct damon_region *r)
 	damon_pa_mkold(r->sampling_addr);
 }
 
-static void damon_pa_prepare_access_checks(struct damon_ctx *ctx)
-{
-	struct damon_target *t;
-	struct damon_region *r;
-
-	damon_for_each_target(t, ctx) {
-		damon_for_each_region(r, t)
-			__damon_pa_prepare_access_check(r);
-	}
-}
-
 struct damon_pa_access_chk_result {
 	unsigned long page_sz;
 	bool accessed;
@@ -165,39 +156,135 @@ static bool damon_pa_young(unsigned long paddr, unsigned long *page_sz)
 	return result.accessed;
 }
 
-static void __damon_pa_check_access(struct damon_region *r)
-{
-	static unsigned long last_addr;
-	static unsigned long last_page_sz = PAGE_SIZE;
-	static bool last_accessed;
+/* The last checked page of a run of regions */
+struct damon_pa_access_cache {
+	unsigned long addr;
+	unsigned long page_sz;
+	bool accessed;
+};
 
+static void __damon_pa_check_access(struct damon_region *r,
+		struct damon_pa_access_cache *last)
+{
 	/* If the region is in the last checked page, reuse the result */
-	if (ALIGN_DOWN(last_addr, last_page_sz) ==
-				ALIGN_DOWN(r->sampling_addr, last_page_sz)) {
-		if (last_accessed)
+	if (ALIGN_DOWN(last->addr, last->page_sz) ==
+				ALIGN_DOWN(r->sampling_addr, last->page_sz)) {
+		if (last->accessed)
 			r->nr_accesses++;
 		return;
 	}
 
-	last_accessed = damon_pa_young(r->sampling_addr, &last_page_sz);
-	if (last_accessed)
+	last->accessed = damon_pa_young(r->sampling_addr, &last->page_sz);
+	if (last->accessed)
 		r->nr_accesses++;
 
-	last_addr = r->sampling_addr;
+	last->addr = r->sampling_addr;
+}
+
+/* Most threads sharing the access checks of a target */
+#define DAMON_PA_MAX_WORKERS	16
+
+/*
+ * struct damon_pa_shard - A contiguous run of the regions of a target.
+ * @work:		Work item of the thread walking the run.
+ * @r:			First region of the run.
+ * @nr_regions:		Number of regions in the run.
+ * @prepare:		Prepare, rather than check, the access checks.
+ * @max_nr_accesses:	Result of the access checks of the run.
+ */
+struct damon_pa_shard {
+	struct work_struct work;
+	struct damon_region *r;
+	unsigned int nr_regions;
+	bool prepare;
+	unsigned int max_nr_accesses;
+};
+
+static void damon_pa_walk_shard(struct damon_pa_shard *s)
+{
+	struct damon_pa_access_cache last = { .page_sz = PAGE_SIZE };
+	struct damon_region *r = s->r;
+	unsigned int i;
+
+	for (i = 0; i < s->nr_regions; i++, r = damon_next_region(r)) {
+		if (s->prepare) {
+			__damon_pa_prepare_access_check(r);
+			continue;
+		}
+		__damon_pa_check_access(r, &last);
+		s->max_nr_accesses = max(r->nr_accesses, s->max_nr_accesses);
+	}
+}
+
+static void damon_pa_shard_fn(struct work_struct *work)
+{
+	damon_pa_walk_shard(container_of(work, struct damon_pa_shard, work));
+}
+
+/*
+ * Prepare or check the accesses to the regions of @t, spread over up to
+ * &damon_attrs->nr_workers threads.  kdamond walks the first run itself and
+ * waits for the others, so the regions are left alone by the time this
+ * returns.
+ */
+static unsigned int damon_pa_walk_target(struct damon_ctx *ctx,
+		struct damon_target *t, bool prepare)
+{
+	struct damon_pa_shard shards[DAMON_PA_MAX_WORKERS];
+	struct damon_region *r;
+	unsigned int nr_shards, nr, i, max_nr_accesses = 0;
+
+	if (!t->nr_regions)
+		return 0;
+
+	nr_shards = clamp_t(unsigned long, ctx->attrs.nr_workers, 1,
+			DAMON_PA_MAX_WORKERS);
+	nr_shards = min(nr_shards, t->nr_regions);
+
+	r = damon_first_region(t);
+	for (i = 0; i < nr_shards; i++) {
+		nr = t->nr_regions / nr_shards + (i < t->nr_regions % nr_shards);
+		shards[i].r = r;
+		shards[i].nr_regions = nr;
+		shards[i].prepare = prepare;
+		shards[i].max_nr_accesses = 0;
+		if (i) {
+			INIT_WORK_ONSTACK(&shards[i].work, damon_pa_shard_fn);
+			queue_work(system_unbound_wq, &shards[i].work);
+		}
+		while (nr--)
+			r = damon_next_region(r);
+	}
+
+	damon_pa_walk_shard(&shards[0]);
+	max_nr_accesses = shards[0].max_nr_accesses;
+
+	for (i = 1; i < nr_shards; i++) {
+		flush_work(&shards[i].work);
+		destroy_work_on_stack(&shards[i].work);
+		max_nr_accesses = max(shards[i].max_nr_accesses,
+				max_nr_accesses);
+	}
+
+	return max_nr_accesses;
+}
+
+static void damon_pa_prepare_access_checks(struct damon_ctx *ctx)
+{
+	struct damon_target *t;
+
+	damon_for_each_target(t, ctx)
+		damon_pa_walk_target(ctx, t, true);
 }
 
 static unsigned int damon_pa_check_accesses(struct damon_ctx *ctx)
 {
 	struct damon_target *t;
-	struct damon_region *r;
 	unsigned int max_nr_accesses = 0;
 
-	damon_for_each_target(t, ctx) {
-		damon_for_each_region(r, t) {
-			__damon_pa_check_access(r);
-			max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
-		}
-	}
+	damon_for_each_target(t, ctx)
+		max_nr_accesses = max(damon_pa_walk_target(ctx, t, false),
+				max_nr_accesses);
 
 	return max_nr_accesses;
 }
@@ -261,7 +348,52 @@ static unsigned long damon_pa_deactivate_pages(struct damon_region *r)
 	return damon_pa_mark_accessed_or_deactivate(r, false);
 }
 
-static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
+static unsigned long damon_pa_migrate(struct damon_region *r,
+		struct damos *s)
+{
+	struct migration_target_control mtc = {
+		.nid = s->target_nid,
+		.gfp_mask = (GFP_HIGHUSER_MOVABLE & ~__GFP_RECLAIM) |
+			__GFP_THISNODE | __GFP_NOWARN | __GFP_NOMEMALLOC |
+			GFP_NOWAIT,
+	};
+	unsigned long addr;
+	unsigned int nr_succeeded = 0;
+	LIST_HEAD(page_list);
+
+	if (s->target_nid == NUMA_NO_NODE ||
+	    !node_state(s->target_nid, N_MEMORY))
+		return 0;
+
+	for (addr = r->ar.start; addr < r->ar.end; addr += PAGE_SIZE) {
+		struct page *page = damon_get_page(PHYS_PFN(addr));
+
+		if (!page)
+			continue;
+		if (page_to_nid(page) == s->target_nid ||
+		    isolate_lru_page(page)) {
+			put_page(page);
+			continue;
+		}
+		mod_node_page_state(page_pgdat(page),
+				NR_ISOLATED_ANON + page_is_file_lru(page),
+				thp_nr_pages(page));
+		list_add(&page->lru, &page_list);
+		put_page(page);
+	}
+	if (list_empty(&page_list))
+		return 0;
+
+	if (migrate_pages(&page_list, alloc_migration_target, NULL,
+			(unsigned long)&mtc, MIGRATE_ASYNC,
+			s->action == DAMOS_MIGRATE_COLD ?
+			MR_DEMOTION : MR_NUMA_MISPLACED, &nr_succeeded))
+		putback_movable_pages(&page_list);
+	cond_resched();
+	return nr_succeeded * PAGE_SIZE;
+}
+
+unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme)
 {
@@ -272,6 +404,9 @@ static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		return damon_pa_mark_accessed(r);
 	case DAMOS_LRU_DEPRIO:
 		return damon_pa_deactivate_pages(r);
+	case DAMOS_MIGRATE_HOT:
+	case DAMOS_MIGRATE_COLD:
+		return damon_pa_migrate(r, scheme);
 	case DAMOS_STAT:
 		break;
 	default:
@@ -281,7 +416,7 @@ static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 	return 0;
 }
 
-static int damon_pa_scheme_score(struct damon_ctx *context,
+int damon_pa_scheme_score(struct damon_ctx *context,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme)
 {
@@ -292,6 +427,10 @@ static int damon_pa_scheme_score(struct damon_ctx *context,
 		return damon_hot_score(context, r, scheme);
 	case DAMOS_LRU_DEPRIO:
 		return damon_cold_score(context, r, scheme);
+	case DAMOS_MIGRATE_HOT:
+		return damon_hot_score(context, r, scheme);
+	case DAMOS_MIGRATE_COLD:
+		return damon_cold_score(context, r, scheme);
 	default:
 		break;
 	}
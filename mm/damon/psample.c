@@ -0,0 +1,281 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * DAMON Primitives for The Physical Address Space, Sampled by The PMU
+ *
+ * Instead of clearing and checking the Accessed bits of one page of each
+ * region, count a region accessed in a sampling interval if the PMU took a
+ * data address sample in it.  Any event the PMU can report the data address
+ * of through the overflow handler will do, e.g. Intel PEBS load latency or
+ * AMD IBS op sampling; the event is set by the parameters below, as raw
+ * perf_event_attr values.  Arm SPE, which only writes to an AUX buffer, can't
+ * be used.
+ *
+ * The schemes are applied as for the paddr operations.  Only one context can
+ * use these operations at a time, and CPUs that come online while it runs
+ * aren't sampled.
+ */
+
+#define pr_fmt(fmt) "damon-ps: " fmt
+
+#include <linux/cpu.h>
+#include <linux/module.h>
+#include <linux/perf_event.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+
+#include "ops-common.h"
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "damon_psample."
+
+/* perf_event_attr.type of the event to sample, e.g. PERF_TYPE_RAW */
+static unsigned int event_type = PERF_TYPE_RAW;
+module_param(event_type, uint, 0600);
+
+/* perf_event_attr.config, zero for no event */
+static unsigned long long event_config __read_mostly;
+module_param(event_config, ullong, 0600);
+
+/* perf_event_attr.config1, e.g. the PEBS load latency threshold */
+static unsigned long long event_config1 __read_mostly;
+module_param(event_config1, ullong, 0600);
+
+static unsigned long long sample_period __read_mostly = 10007;
+module_param(sample_period, ullong, 0600);
+
+static unsigned int precise_ip __read_mostly = 2;
+module_param(precise_ip, uint, 0600);
+
+/* Samples of lower weight (e.g. load latency in cycles) are ignored */
+static unsigned long long min_weight __read_mostly;
+module_param(min_weight, ullong, 0600);
+
+/* Per CPU samples kept between two access checks, a power of two */
+#define DAMON_PS_NR_SAMPLES	1024
+
+/*
+ * struct damon_ps_buf - Data addresses sampled on a CPU.
+ * @head:	Number of samples taken, written from the overflow handler.
+ * @tail:	Number of samples consumed, updated by kdamond.
+ * @addr:	The last %DAMON_PS_NR_SAMPLES physical addresses.
+ */
+struct damon_ps_buf {
+	unsigned int head;
+	unsigned int tail;
+	u64 addr[DAMON_PS_NR_SAMPLES];
+};
+
+static DEFINE_PER_CPU(struct damon_ps_buf *, damon_ps_bufs);
+static DEFINE_PER_CPU(struct perf_event *, damon_ps_events);
+
+static DEFINE_MUTEX(damon_ps_lock);
+static struct damon_ctx *damon_ps_ctx;
+
+/* Sorted samples of the last interval, only used by kdamond */
+static u64 *damon_ps_samples;
+
+static void damon_ps_overflow(struct perf_event *event,
+		struct perf_sample_data *data, struct pt_regs *regs)
+{
+	struct damon_ps_buf *buf = this_cpu_read(damon_ps_bufs);
+	struct perf_event_header header;
+	unsigned int head;
+
+	/* Fills in the physical address, as for a sample output to userspace */
+	perf_prepare_sample(&header, data, event, regs);
+	if (!data->phys_addr)
+		return;
+	if (min_weight && data->weight.full < min_weight)
+		return;
+
+	head = buf->head;
+	buf->addr[head & (DAMON_PS_NR_SAMPLES - 1)] = data->phys_addr;
+	/* Pairs with the acquire in damon_ps_drain() */
+	smp_store_release(&buf->head, head + 1);
+}
+
+static void damon_ps_release(void)
+{
+	struct perf_event *event;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		event = per_cpu(damon_ps_events, cpu);
+		if (event)
+			perf_event_release_kernel(event);
+		per_cpu(damon_ps_events, cpu) = NULL;
+		kfree(per_cpu(damon_ps_bufs, cpu));
+		per_cpu(damon_ps_bufs, cpu) = NULL;
+	}
+	kvfree(damon_ps_samples);
+	damon_ps_samples = NULL;
+}
+
+static int damon_ps_create(void)
+{
+	struct perf_event_attr attr = {
+		.type = event_type,
+		.size = sizeof(attr),
+		.config = event_config,
+		.config1 = event_config1,
+		.sample_period = sample_period,
+		.sample_type = PERF_SAMPLE_ADDR | PERF_SAMPLE_PHYS_ADDR |
+			PERF_SAMPLE_WEIGHT,
+		.precise_ip = precise_ip,
+	};
+	struct perf_event *event;
+	int cpu, err = 0;
+
+	if (!event_config || !sample_period)
+		return -EINVAL;
+
+	damon_ps_samples = kvmalloc_array(nr_cpu_ids * DAMON_PS_NR_SAMPLES,
+			sizeof(*damon_ps_samples), GFP_KERNEL);
+	if (!damon_ps_samples)
+		return -ENOMEM;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		per_cpu(damon_ps_bufs, cpu) = kzalloc_node(
+				sizeof(struct damon_ps_buf), GFP_KERNEL,
+				cpu_to_node(cpu));
+		if (!per_cpu(damon_ps_bufs, cpu)) {
+			err = -ENOMEM;
+			break;
+		}
+
+		event = perf_event_create_kernel_counter(&attr, cpu, NULL,
+				damon_ps_overflow, NULL);
+		if (IS_ERR(event)) {
+			err = PTR_ERR(event);
+			break;
+		}
+		per_cpu(damon_ps_events, cpu) = event;
+	}
+	cpus_read_unlock();
+
+	if (err)
+		damon_ps_release();
+	return err;
+}
+
+static void damon_ps_init(struct damon_ctx *ctx)
+{
+	int err;
+
+	mutex_lock(&damon_ps_lock);
+	if (damon_ps_ctx) {
+		pr_warn("already used by another context\n");
+		goto out;
+	}
+	err = damon_ps_create();
+	if (err) {
+		pr_warn("can't sample event %u:%#llx (%d)\n", event_type,
+				event_config, err);
+		goto out;
+	}
+	damon_ps_ctx = ctx;
+out:
+	mutex_unlock(&damon_ps_lock);
+}
+
+static void damon_ps_cleanup(struct damon_ctx *ctx)
+{
+	mutex_lock(&damon_ps_lock);
+	if (damon_ps_ctx == ctx) {
+		damon_ps_release();
+		damon_ps_ctx = NULL;
+	}
+	mutex_unlock(&damon_ps_lock);
+}
+
+/*
+ * Take the samples taken since the last call, or just drop them if @samples
+ * is NULL.  Returns the number of samples taken.
+ */
+static unsigned int damon_ps_drain(u64 *samples)
+{
+	struct damon_ps_buf *buf;
+	unsigned int head, nr = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		buf = per_cpu(damon_ps_bufs, cpu);
+		if (!buf)
+			continue;
+		head = smp_load_acquire(&buf->head);
+		/* Samples that were overwritten are lost */
+		if (head - buf->tail > DAMON_PS_NR_SAMPLES)
+			buf->tail = head - DAMON_PS_NR_SAMPLES;
+		for (; samples && buf->tail != head; buf->tail++)
+			samples[nr++] = READ_ONCE(buf->addr[buf->tail &
+					(DAMON_PS_NR_SAMPLES - 1)]);
+		buf->tail = head;
+	}
+	return nr;
+}
+
+static void damon_ps_prepare_access_checks(struct damon_ctx *ctx)
+{
+	/* Only count the samples of this sampling interval */
+	if (damon_ps_ctx == ctx)
+		damon_ps_drain(NULL);
+}
+
+static int damon_ps_cmp(const void *a, const void *b)
+{
+	u64 l = *(const u64 *)a, r = *(const u64 *)b;
+
+	return l < r ? -1 : l > r;
+}
+
+static unsigned int damon_ps_check_accesses(struct damon_ctx *ctx)
+{
+	struct damon_target *t;
+	struct damon_region *r;
+	unsigned int nr, i, max_nr_accesses = 0;
+
+	if (damon_ps_ctx != ctx)
+		return 0;
+
+	nr = damon_ps_drain(damon_ps_samples);
+	sort(damon_ps_samples, nr, sizeof(*damon_ps_samples), damon_ps_cmp,
+			NULL);
+
+	/* The regions are sorted too, so walk both in step */
+	damon_for_each_target(t, ctx) {
+		i = 0;
+		damon_for_each_region(r, t) {
+			while (i < nr && damon_ps_samples[i] < r->ar.start)
+				i++;
+			if (i < nr && damon_ps_samples[i] < r->ar.end)
+				r->nr_accesses++;
+			max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
+		}
+	}
+
+	return max_nr_accesses;
+}
+
+static int __init damon_ps_initcall(void)
+{
+	struct damon_operations ops = {
+		.id = DAMON_OPS_PSAMPLE,
+		.init = damon_ps_init,
+		.update = NULL,
+		.prepare_access_checks = damon_ps_prepare_access_checks,
+		.check_accesses = damon_ps_check_accesses,
+		.reset_aggregated = NULL,
+		.target_valid = NULL,
+		.cleanup = damon_ps_cleanup,
+		.apply_scheme = damon_pa_apply_scheme,
+		.get_scheme_score = damon_pa_scheme_score,
+	};
+
+	return damon_register_ops(&ops);
+};
+
+subsys_initcall(damon_ps_initcall);
@@ -60,6 +60,9 @@ static const struct snmp_mib mptcp_snmp_list[] = {
 	SNMP_MIB_ITEM("RcvWndShared", MPTCP_MIB_RCVWNDSHARED),
 	SNMP_MIB_ITEM("RcvWndConflictUpdate", MPTCP_MIB_RCVWNDCONFLICTUPDATE),
 	SNMP_MIB_ITEM("RcvWndConflict", MPTCP_MIB_RCVWNDCONFLICT),
+	SNMP_MIB_ITEM("SndSched", MPTCP_MIB_SNDSCHED),
+	SNMP_MIB_ITEM("SndBurstReuse", MPTCP_MIB_SNDBURSTREUSE),
+	SNMP_MIB_ITEM("SndSubflowSwitch", MPTCP_MIB_SNDSUBFLOWSWITCH),
 	SNMP_MIB_SENTINEL
 };
 
@@ -55,6 +55,9 @@ enum linux_mptcp_mib_field {
 					 * conflict with another subflow while updating msk rcv wnd
 					 */
 	MPTCP_MIB_RCVWNDCONFLICT,	/* Conflict with while updating msk rcv wnd */
+	MPTCP_MIB_SNDSCHED,		/* Subflow picked by looking at all of them */
+	MPTCP_MIB_SNDBURSTREUSE,	/* Last subflow reused within its burst */
+	MPTCP_MIB_SNDSUBFLOWSWITCH,	/* Pushing pending data moved to another subflow */
 	__MPTCP_MIB_MAX
 };
 
@@ -483,7 +483,7 @@ static long mptcp_timeout_from_subflow(const struct mptcp_subflow_context *subfl
 	       inet_csk(ssk)->icsk_timeout - jiffies : 0;
 }
 
-static void mptcp_set_timeout(struct sock *sk)
+void mptcp_set_timeout(struct sock *sk)
 {
 	struct mptcp_subflow_context *subflow;
 	long tout = 0;
@@ -1362,6 +1362,24 @@ static int mptcp_sendmsg_frag(struct sock *sk, struct sock *ssk,
 					 sizeof(struct ipv6hdr) - \
 					 sizeof(struct frag_hdr))
 
+/* upper bound on the bytes sent on a subflow before picking again */
+#define MPTCP_SEND_BURST_MAX		(MPTCP_SEND_BURST_SIZE * 16)
+
+/* Stick to the picked subflow for about what it can send in a millisecond,
+ * or for its cwnd if that's less.  Slow subflows still get a single TSO/GSO
+ * packet at a time, while fast ones no longer go through the scheduler and
+ * a subflow lock switch every 64K.
+ */
+static int mptcp_subflow_burst(const struct sock *ssk)
+{
+	const struct tcp_sock *tp = tcp_sk(ssk);
+	u64 cwnd_bytes = (u64)tcp_snd_cwnd(tp) * READ_ONCE(tp->mss_cache);
+	u64 paced = READ_ONCE(ssk->sk_pacing_rate) >> 10;
+
+	return clamp_t(u64, min(cwnd_bytes, paced), MPTCP_SEND_BURST_SIZE,
+		       MPTCP_SEND_BURST_MAX);
+}
+
 struct subflow_send_info {
 	struct sock *ssk;
 	u64 linger_time;
@@ -1393,11 +1411,11 @@ bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
 #define SSK_MODE_BACKUP	1
 #define SSK_MODE_MAX	2
 
-/* implement the mptcp packet scheduler;
+/* implement the default mptcp packet scheduler;
  * returns the subflow that will transmit the next DSS
  * additionally updates the rtx timeout
  */
-static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
+struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 {
 	struct subflow_send_info send_info[SSK_MODE_MAX];
 	struct mptcp_subflow_context *subflow;
@@ -1422,9 +1440,12 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	    sk_stream_memory_free(msk->last_snd) &&
 	    mptcp_subflow_active(mptcp_subflow_ctx(msk->last_snd))) {
 		mptcp_set_timeout(sk);
+		MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_SNDBURSTREUSE);
 		return msk->last_snd;
 	}
 
+	MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_SNDSCHED);
+
 	/* pick the subflow with the lower wmem/wspace ratio */
 	for (i = 0; i < SSK_MODE_MAX; ++i) {
 		send_info[i].ssk = NULL;
@@ -1475,7 +1496,10 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 	if (!ssk || !sk_stream_memory_free(ssk))
 		return NULL;
 
-	burst = min_t(int, MPTCP_SEND_BURST_SIZE, mptcp_wnd_end(msk) - msk->snd_nxt);
+	burst = 0;
+	if (after64(mptcp_wnd_end(msk), msk->snd_nxt))
+		burst = min_t(u64, mptcp_subflow_burst(ssk),
+			      mptcp_wnd_end(msk) - msk->snd_nxt);
 	wmem = READ_ONCE(ssk->sk_wmem_queued);
 	if (!burst) {
 		msk->last_snd = NULL;
@@ -1522,6 +1546,55 @@ static void mptcp_update_post_push(struct mptcp_sock *msk,
 		msk->snd_nxt = snd_nxt_new;
 }
 
+/* send the data in [seq, snd_nxt) again on the active subflows that didn't
+ * carry any of it, for the schedulers asking for redundancy
+ */
+static void __mptcp_push_redundant(struct sock *sk, u64 seq)
+{
+	struct mptcp_sock *msk = mptcp_sk(sk);
+	struct mptcp_subflow_context *subflow;
+	struct mptcp_data_frag *dfrag;
+	int ret;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+		struct mptcp_sendmsg_info info = {};
+		bool copied = false;
+
+		if (subflow->pushed) {
+			subflow->pushed = 0;
+			continue;
+		}
+		if (subflow->backup || !mptcp_subflow_active(subflow))
+			continue;
+
+		lock_sock(ssk);
+		list_for_each_entry(dfrag, &msk->rtx_queue, list) {
+			if (!before64(dfrag->data_seq, msk->snd_nxt))
+				break;
+			if (!after64(dfrag->data_seq + dfrag->already_sent, seq))
+				continue;
+
+			info.sent = after64(seq, dfrag->data_seq) ?
+				    seq - dfrag->data_seq : 0;
+			info.limit = dfrag->already_sent;
+			while (info.sent < info.limit) {
+				ret = mptcp_sendmsg_frag(sk, ssk, dfrag, &info);
+				if (ret <= 0)
+					goto push;
+
+				copied = true;
+				info.sent += ret;
+			}
+		}
+push:
+		if (copied)
+			tcp_push(ssk, 0, info.mss_now, tcp_sk(ssk)->nonagle,
+				 info.size_goal);
+		release_sock(ssk);
+	}
+}
+
 void mptcp_check_and_set_pending(struct sock *sk)
 {
 	if (mptcp_send_head(sk))
@@ -1536,6 +1609,7 @@ void __mptcp_push_pending(struct sock *sk, unsigned int flags)
 				.flags = flags,
 	};
 	bool do_check_data_fin = false;
+	u64 snd_nxt = msk->snd_nxt;
 	struct mptcp_data_frag *dfrag;
 	int len;
 
@@ -1547,13 +1621,17 @@ void __mptcp_push_pending(struct sock *sk, unsigned int flags)
 			int ret = 0;
 
 			prev_ssk = ssk;
-			ssk = mptcp_subflow_get_send(msk);
+			ssk = mptcp_sched_get_send(msk);
 
 			/* First check. If the ssk has changed since
 			 * the last round, release prev_ssk
 			 */
-			if (ssk != prev_ssk && prev_ssk)
+			if (ssk != prev_ssk && prev_ssk) {
 				mptcp_push_release(prev_ssk, &info);
+				if (ssk)
+					MPTCP_INC_STATS(sock_net(sk),
+							MPTCP_MIB_SNDSUBFLOWSWITCH);
+			}
 			if (!ssk)
 				goto out;
 
@@ -1575,6 +1653,8 @@ void __mptcp_push_pending(struct sock *sk, unsigned int flags)
 			do_check_data_fin = true;
 			info.sent += ret;
 			len -= ret;
+			if (mptcp_sched_redundant(msk))
+				mptcp_subflow_ctx(ssk)->pushed = 1;
 
 			mptcp_update_post_push(msk, dfrag, ret);
 		}
@@ -1586,6 +1666,10 @@ void __mptcp_push_pending(struct sock *sk, unsigned int flags)
 		mptcp_push_release(ssk, &info);
 
 out:
+	/* no subflow lock is held here */
+	if (mptcp_sched_redundant(msk) && after64(msk->snd_nxt, snd_nxt))
+		__mptcp_push_redundant(sk, snd_nxt);
+
 	/* ensure the rtx timer is running */
 	if (!mptcp_timer_pending(sk))
 		mptcp_reset_timer(sk);
@@ -1614,7 +1698,7 @@ static void __mptcp_subflow_push_pending(struct sock *sk, struct sock *ssk, bool
 			/* check for a different subflow usage only after
 			 * spooling the first chunk of data
 			 */
-			xmit_ssk = first ? ssk : mptcp_subflow_get_send(msk);
+			xmit_ssk = first ? ssk : mptcp_sched_get_send(msk);
 			if (!xmit_ssk)
 				goto out;
 			if (xmit_ssk != ssk) {
@@ -2211,7 +2295,7 @@ static void mptcp_timeout_timer(struct timer_list *t)
  *
  * A backup subflow is returned only if that is the only kind available.
  */
-static struct sock *mptcp_subflow_get_retrans(struct mptcp_sock *msk)
+struct sock *mptcp_subflow_get_retrans(struct mptcp_sock *msk)
 {
 	struct sock *backup = NULL, *pick = NULL;
 	struct mptcp_subflow_context *subflow;
@@ -2500,7 +2584,7 @@ static void __mptcp_retrans(struct sock *sk)
 	mptcp_clean_una_wakeup(sk);
 
 	/* first check ssk: need to kick "stale" logic */
-	ssk = mptcp_subflow_get_retrans(msk);
+	ssk = mptcp_sched_get_retrans(msk);
 	dfrag = mptcp_rtx_head(sk);
 	if (!dfrag) {
 		if (mptcp_data_fin_enabled(msk)) {
@@ -2723,6 +2807,10 @@ static int mptcp_init_sock(struct sock *sk)
 	 */
 	mptcp_ca_reset(sk);
 
+	rcu_read_lock();
+	mptcp_init_sched(mptcp_sk(sk), mptcp_sched_find(mptcp_get_scheduler(net)));
+	rcu_read_unlock();
+
 	sk_sockets_allocated_inc(sk);
 	sk->sk_rcvbuf = READ_ONCE(sock_net(sk)->ipv4.sysctl_tcp_rmem[1]);
 	sk->sk_sndbuf = READ_ONCE(sock_net(sk)->ipv4.sysctl_tcp_wmem[1]);
@@ -3073,6 +3161,7 @@ struct sock *mptcp_sk_clone(const struct sock *sk,
 	msk->snd_una = msk->write_seq;
 	msk->wnd_end = msk->snd_nxt + req->rsk_rcv_wnd;
 	msk->setsockopt_seq = mptcp_sk(sk)->setsockopt_seq;
+	mptcp_init_sched(msk, mptcp_sk(sk)->sched);
 
 	sock_reset_flag(nsk, SOCK_RCU_FREE);
 	/* will be fully established after successful MPC subflow creation */
@@ -3189,6 +3278,7 @@ static void mptcp_destroy(struct sock *sk)
 	 */
 	mptcp_dispose_initial_subflow(msk);
 	mptcp_destroy_common(msk, 0);
+	mptcp_release_sched(msk);
 	sk_sockets_allocated_dec(sk);
 }
 
@@ -255,6 +255,30 @@ struct mptcp_data_frag {
 	struct page *page;
 };
 
+#define MPTCP_SCHED_NAME_MAX	16
+
+/* Schedulers asking for new data to be sent on every active subflow */
+#define MPTCP_SCHED_FLAG_REDUNDANT	BIT(0)
+
+struct mptcp_sock;
+
+/* MPTCP packet scheduler, all the hooks but get_send are optional and are
+ * called with the msk socket lock held
+ */
+struct mptcp_sched_ops {
+	/* the subflow to send the next chunk of new data on, or NULL */
+	struct sock *(*get_send)(struct mptcp_sock *msk);
+	/* the subflow to retransmit on, mptcp_subflow_get_retrans() if unset */
+	struct sock *(*get_retrans)(struct mptcp_sock *msk);
+	void (*init)(struct mptcp_sock *msk);
+	void (*release)(struct mptcp_sock *msk);
+
+	u32			flags;
+	char			name[MPTCP_SCHED_NAME_MAX];
+	struct module		*owner;
+	struct list_head	list;
+};
+
 /* MPTCP connection sock */
 struct mptcp_sock {
 	/* inet_connection_sock must be the first member */
@@ -318,6 +342,7 @@ struct mptcp_sock {
 	u32 setsockopt_seq;
 	char		ca_name[TCP_CA_NAME_MAX];
 	struct mptcp_sock	*dl_next;
+	struct mptcp_sched_ops	*sched;
 };
 
 #define mptcp_data_lock(sk) spin_lock_bh(&(sk)->sk_lock.slock)
@@ -482,7 +507,8 @@ struct mptcp_subflow_context {
 		local_id_valid : 1, /* local_id is correctly initialized */
 		valid_csum_seen : 1,        /* at least one csum validated */
 		is_mptfo : 1,	    /* subflow is doing TFO */
-		__unused : 8;
+		pushed : 1,	    /* carried new data in this push, redundant schedulers only */
+		__unused : 7;
 	enum mptcp_data_avail data_avail;
 	u32	remote_nonce;
 	u64	thmac;
@@ -615,6 +641,7 @@ int mptcp_is_checksum_enabled(const struct net *net);
 int mptcp_allow_join_id0(const struct net *net);
 unsigned int mptcp_stale_loss_cnt(const struct net *net);
 int mptcp_get_pm_type(const struct net *net);
+const char *mptcp_get_scheduler(const struct net *net);
 void mptcp_copy_inaddrs(struct sock *msk, const struct sock *ssk);
 void mptcp_subflow_fully_established(struct mptcp_subflow_context *subflow,
 				     const struct mptcp_options_received *mp_opt);
@@ -678,6 +705,24 @@ static inline void mptcp_subflow_tcp_fallback(struct sock *sk,
 }
 
 void __init mptcp_proto_init(void);
+
+struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk);
+struct sock *mptcp_subflow_get_retrans(struct mptcp_sock *msk);
+void mptcp_set_timeout(struct sock *sk);
+struct mptcp_sched_ops *mptcp_sched_find(const char *name);
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_sched_init(void);
+void mptcp_init_sched(struct mptcp_sock *msk, struct mptcp_sched_ops *sched);
+void mptcp_release_sched(struct mptcp_sock *msk);
+int mptcp_set_sched(struct mptcp_sock *msk, const char *name);
+struct sock *mptcp_sched_get_send(struct mptcp_sock *msk);
+struct sock *mptcp_sched_get_retrans(struct mptcp_sock *msk);
+
+static inline bool mptcp_sched_redundant(const struct mptcp_sock *msk)
+{
+	return msk->sched && (msk->sched->flags & MPTCP_SCHED_FLAG_REDUNDANT);
+}
 #if IS_ENABLED(CONFIG_MPTCP_IPV6)
 int __init mptcp_proto_v6_init(void);
 #endif
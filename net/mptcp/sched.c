@@ -0,0 +1,249 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Multipath TCP
+ *
+ * Packet schedulers: pick the subflow carrying the next chunk of data.
+ * The scheduler is chosen per netns with the net.mptcp.scheduler sysctl and
+ * per socket with the MPTCP_SCHEDULER socket option.
+ */
+
+#define pr_fmt(fmt) "MPTCP: " fmt
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
+#include <net/tcp.h>
+#include "protocol.h"
+
+static DEFINE_SPINLOCK(mptcp_sched_list_lock);
+static LIST_HEAD(mptcp_sched_list);
+
+/* the built-in heuristic, lowest linger time on the subflow */
+static struct mptcp_sched_ops mptcp_sched_default = {
+	.get_send	= mptcp_subflow_get_send,
+	.name		= "default",
+	.owner		= THIS_MODULE,
+};
+
+static bool mptcp_sched_can_send(struct mptcp_subflow_context *subflow)
+{
+	return mptcp_subflow_active(subflow) &&
+	       sk_stream_memory_free(mptcp_subflow_tcp_sock(subflow));
+}
+
+/* take turns on the active subflows, falling back to the first backup one */
+static struct sock *mptcp_sched_rr_get_send(struct mptcp_sock *msk)
+{
+	struct sock *first = NULL, *pick = NULL, *backup = NULL;
+	struct mptcp_subflow_context *subflow;
+	bool after_last = !msk->last_snd;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+
+		if (!mptcp_sched_can_send(subflow))
+			goto next;
+
+		if (subflow->backup) {
+			if (!backup)
+				backup = ssk;
+			goto next;
+		}
+
+		if (!first)
+			first = ssk;
+		if (after_last) {
+			pick = ssk;
+			break;
+		}
+next:
+		if (ssk == msk->last_snd)
+			after_last = true;
+	}
+
+	if (!pick)
+		pick = first ?: backup;
+	msk->last_snd = pick;
+	return pick;
+}
+
+static struct mptcp_sched_ops mptcp_sched_rr = {
+	.get_send	= mptcp_sched_rr_get_send,
+	.name		= "roundrobin",
+	.owner		= THIS_MODULE,
+};
+
+/* the active subflow with the lowest smoothed RTT and room in its cwnd */
+static struct sock *mptcp_sched_minrtt_get_send(struct mptcp_sock *msk)
+{
+	u32 best[2] = { U32_MAX, U32_MAX };
+	struct mptcp_subflow_context *subflow;
+	struct sock *pick[2] = { NULL, NULL };
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+		const struct tcp_sock *tp = tcp_sk(ssk);
+		u32 srtt;
+
+		if (!mptcp_sched_can_send(subflow))
+			continue;
+
+		/* data queued past the cwnd would only wait there */
+		if (tcp_packets_in_flight(tp) >= tcp_snd_cwnd(tp))
+			continue;
+
+		/* no sample yet: usable, but after any measured subflow */
+		srtt = READ_ONCE(tp->srtt_us) ?: U32_MAX - 1;
+		if (srtt < best[subflow->backup]) {
+			best[subflow->backup] = srtt;
+			pick[subflow->backup] = ssk;
+		}
+	}
+
+	return pick[0] ?: pick[1];
+}
+
+static struct mptcp_sched_ops mptcp_sched_minrtt = {
+	.get_send	= mptcp_sched_minrtt_get_send,
+	.name		= "minrtt",
+	.owner		= THIS_MODULE,
+};
+
+/* min-RTT, with the new data copied on the other active subflows */
+static struct mptcp_sched_ops mptcp_sched_redundant = {
+	.get_send	= mptcp_sched_minrtt_get_send,
+	.flags		= MPTCP_SCHED_FLAG_REDUNDANT,
+	.name		= "redundant",
+	.owner		= THIS_MODULE,
+};
+
+/* must be called with rcu read lock held */
+struct mptcp_sched_ops *mptcp_sched_find(const char *name)
+{
+	struct mptcp_sched_ops *sched;
+
+	list_for_each_entry_rcu(sched, &mptcp_sched_list, list) {
+		if (!strcmp(sched->name, name))
+			return sched;
+	}
+
+	return NULL;
+}
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched)
+{
+	if (!sched->get_send)
+		return -EINVAL;
+
+	spin_lock(&mptcp_sched_list_lock);
+	if (mptcp_sched_find(sched->name)) {
+		spin_unlock(&mptcp_sched_list_lock);
+		return -EEXIST;
+	}
+	list_add_tail_rcu(&sched->list, &mptcp_sched_list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	pr_debug("%s registered", sched->name);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(mptcp_register_scheduler);
+
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched)
+{
+	if (sched == &mptcp_sched_default)
+		return;
+
+	spin_lock(&mptcp_sched_list_lock);
+	list_del_rcu(&sched->list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	/* sockets using it hold a module reference */
+	synchronize_rcu();
+}
+EXPORT_SYMBOL_GPL(mptcp_unregister_scheduler);
+
+void mptcp_sched_init(void)
+{
+	mptcp_register_scheduler(&mptcp_sched_default);
+	mptcp_register_scheduler(&mptcp_sched_rr);
+	mptcp_register_scheduler(&mptcp_sched_minrtt);
+	mptcp_register_scheduler(&mptcp_sched_redundant);
+}
+
+void mptcp_init_sched(struct mptcp_sock *msk, struct mptcp_sched_ops *sched)
+{
+	if (!sched || !try_module_get(sched->owner))
+		sched = &mptcp_sched_default;
+
+	msk->sched = sched;
+	if (sched->init)
+		sched->init(msk);
+
+	pr_debug("msk=%p sched=%s", msk, sched->name);
+}
+
+void mptcp_release_sched(struct mptcp_sock *msk)
+{
+	struct mptcp_sched_ops *sched = msk->sched;
+
+	if (!sched)
+		return;
+
+	msk->sched = NULL;
+	if (sched->release)
+		sched->release(msk);
+	module_put(sched->owner);
+}
+
+int mptcp_set_sched(struct mptcp_sock *msk, const char *name)
+{
+	struct mptcp_sched_ops *sched;
+	int ret = 0;
+
+	msk_owned_by_me(msk);
+
+	rcu_read_lock();
+	sched = mptcp_sched_find(name);
+	if (!sched || !try_module_get(sched->owner)) {
+		ret = -ENOENT;
+	} else {
+		mptcp_release_sched(msk);
+		mptcp_init_sched(msk, sched);
+		/* mptcp_init_sched() took its own reference */
+		module_put(sched->owner);
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
+struct sock *mptcp_sched_get_send(struct mptcp_sock *msk)
+{
+	struct mptcp_sched_ops *sched = msk->sched;
+	struct sock *ssk;
+
+	msk_owned_by_me(msk);
+
+	/* the default scheduler also handles fallback and the timeout */
+	if (!sched || sched == &mptcp_sched_default ||
+	    __mptcp_check_fallback(msk))
+		return mptcp_subflow_get_send(msk);
+
+	ssk = sched->get_send(msk);
+	if (ssk)
+		mptcp_set_timeout((struct sock *)msk);
+	return ssk;
+}
+
+struct sock *mptcp_sched_get_retrans(struct mptcp_sock *msk)
+{
+	struct mptcp_sched_ops *sched = msk->sched;
+
+	msk_owned_by_me(msk);
+
+	if (!sched || !sched->get_retrans || __mptcp_check_fallback(msk))
+		return mptcp_subflow_get_retrans(msk);
+
+	return sched->get_retrans(msk);
+}
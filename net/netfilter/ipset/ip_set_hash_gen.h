@@ -201,6 +201,7 @@ static const union nf_inet_addr zeromask = {};
 #undef mtype_ext_cleanup
 #undef mtype_add_cidr
 #undef mtype_del_cidr
+#undef mtype_add_net_map
 #undef mtype_ahash_memsize
 #undef mtype_flush
 #undef mtype_destroy
@@ -245,6 +246,7 @@ static const union nf_inet_addr zeromask = {};
 #define mtype_ext_cleanup	IPSET_TOKEN(MTYPE, _ext_cleanup)
 #define mtype_add_cidr		IPSET_TOKEN(MTYPE, _add_cidr)
 #define mtype_del_cidr		IPSET_TOKEN(MTYPE, _del_cidr)
+#define mtype_add_net_map	IPSET_TOKEN(MTYPE, _add_net_map)
 #define mtype_ahash_memsize	IPSET_TOKEN(MTYPE, _ahash_memsize)
 #define mtype_flush		IPSET_TOKEN(MTYPE, _flush)
 #define mtype_destroy		IPSET_TOKEN(MTYPE, _destroy)
@@ -303,6 +305,10 @@ struct htype {
 #ifdef IP_SET_HASH_WITH_NETS
 	struct net_prefixes nets[NLEN]; /* book-keeping of prefixes */
 #endif
+#ifdef IP_SET_HASH_WITH_NETS_MAP
+	/* Prefix lengths added, by the first octet of the network */
+	unsigned long net_map[256][BITS_TO_LONGS(HOST_MASK + 1)];
+#endif
 };
 
 /* ADD|DEL entries saved during resize */
@@ -350,6 +356,9 @@ static void
 mtype_del_cidr(struct ip_set *set, struct htype *h, u8 cidr, u8 n)
 {
 	u8 i, j, net_end = NLEN - 1;
+#ifdef IP_SET_HASH_WITH_NETS_MAP
+	int o;
+#endif
 
 	spin_lock_bh(&set->lock);
 	for (i = 0; i < NLEN; i++) {
@@ -361,6 +370,13 @@ mtype_del_cidr(struct ip_set *set, struct htype *h, u8 cidr, u8 n)
 		for (j = i; j < net_end && h->nets[j].cidr[n]; j++)
 			h->nets[j].cidr[n] = h->nets[j + 1].cidr[n];
 		h->nets[j].cidr[n] = 0;
+#ifdef IP_SET_HASH_WITH_NETS_MAP
+		/* Bits are not cleared one by one, but no network of
+		 * the size is left now.
+		 */
+		for (o = 0; o < ARRAY_SIZE(h->net_map); o++)
+			clear_bit(NCIDR_GET(cidr), h->net_map[o]);
+#endif
 		goto unlock;
 	}
 unlock:
@@ -368,6 +384,26 @@ mtype_del_cidr(struct ip_set *set, struct htype *h, u8 cidr, u8 n)
 }
 #endif
 
+#ifdef IP_SET_HASH_WITH_NETS_MAP
+/* The element is a network to test the packet address against, as the
+ * first member.  Record its size under the first octets it covers, so that
+ * mtype_test_cidrs() can skip the sizes that can't match.
+ */
+static void
+mtype_add_net_map(struct htype *h, const struct mtype_elem *d)
+{
+	u8 cidr = DCIDR_GET(d->cidr, 0);
+	u32 i, first = *(const u8 *)&d->ip, nr = 1;
+
+	if (cidr < 8) {
+		nr = 1 << (8 - cidr);
+		first &= ~(nr - 1);
+	}
+	for (i = first; i < first + nr; i++)
+		set_bit(cidr, h->net_map[i]);
+}
+#endif
+
 /* Calculate the actual memory size of the set data */
 static size_t
 mtype_ahash_memsize(const struct htype *h, const struct htable *t)
@@ -419,6 +455,9 @@ mtype_flush(struct ip_set *set)
 #ifdef IP_SET_HASH_WITH_NETS
 	memset(h->nets, 0, sizeof(h->nets));
 #endif
+#ifdef IP_SET_HASH_WITH_NETS_MAP
+	memset(h->net_map, 0, sizeof(h->net_map));
+#endif
 }
 
 /* Destroy the hashtable part of the set */
@@ -960,6 +999,9 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 #ifdef IP_SET_HASH_WITH_NETS
 	for (i = 0; i < IPSET_NET_COUNT; i++)
 		mtype_add_cidr(set, h, NCIDR_PUT(DCIDR_GET(d->cidr, i)), i);
+#endif
+#ifdef IP_SET_HASH_WITH_NETS_MAP
+	mtype_add_net_map(h, d);
 #endif
 	memcpy(data, d, sizeof(struct mtype_elem));
 overwrite_extensions:
@@ -1160,11 +1202,18 @@ mtype_test_cidrs(struct ip_set *set, struct mtype_elem *d,
 	int ret, i, j = 0, k;
 #else
 	int ret, i, j = 0;
+#endif
+#ifdef IP_SET_HASH_WITH_NETS_MAP
+	const unsigned long *map = h->net_map[*(const u8 *)&d->ip];
 #endif
 	u32 key, multi = 0;
 
 	pr_debug("test by nets\n");
 	for (; j < NLEN && h->nets[j].cidr[0] && !multi; j++) {
+#ifdef IP_SET_HASH_WITH_NETS_MAP
+		if (!test_bit(NCIDR_GET(h->nets[j].cidr[0]), map))
+			continue;
+#endif
 #if IPSET_NET_COUNT == 2
 		mtype_data_reset_elem(d, &orig);
 		mtype_data_netmask(d, NCIDR_GET(h->nets[j].cidr[0]), false);
@@ -35,6 +35,7 @@ MODULE_ALIAS("ip_set_hash:net");
 /* Type specific function prefix */
 #define HTYPE		hash_net
 #define IP_SET_HASH_WITH_NETS
+#define IP_SET_HASH_WITH_NETS_MAP
 
 /* IPv4 variant */
 
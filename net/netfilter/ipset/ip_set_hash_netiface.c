@@ -37,6 +37,7 @@ MODULE_ALIAS("ip_set_hash:net,iface");
 /* Type specific function prefix */
 #define HTYPE		hash_netiface
 #define IP_SET_HASH_WITH_NETS
+#define IP_SET_HASH_WITH_NETS_MAP
 #define IP_SET_HASH_WITH_MULTI
 #define IP_SET_HASH_WITH_NET0
 
@@ -38,6 +38,7 @@ MODULE_ALIAS("ip_set_hash:net,port");
 #define HTYPE		hash_netport
 #define IP_SET_HASH_WITH_PROTO
 #define IP_SET_HASH_WITH_NETS
+#define IP_SET_HASH_WITH_NETS_MAP
 
 /* We squeeze the "nomatch" flag into cidr: we don't support cidr == 0
  * However this way we have to store internally cidr - 1,
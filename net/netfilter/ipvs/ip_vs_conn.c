@@ -32,6 +32,8 @@
 #include <linux/seq_file.h>
 #include <linux/jhash.h>
 #include <linux/random.h>
+#include <linux/percpu_counter.h>
+#include <linux/workqueue.h>
 
 #include <net/net_namespace.h>
 #include <net/ip_vs.h>
@@ -43,19 +45,42 @@
 
 /*
  * Connection hash size. Default is what was selected at compile time.
+ * The table grows up to 1 << conn_tab_max_bits buckets as connections are
+ * added, and shrinks back to its initial size as they go away.
 */
 static int ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
 module_param_named(conn_tab_bits, ip_vs_conn_tab_bits, int, 0444);
 MODULE_PARM_DESC(conn_tab_bits, "Set connections' hash size");
 
-/* size and mask values */
+static int ip_vs_conn_tab_max_bits = 24;
+module_param_named(conn_tab_max_bits, ip_vs_conn_tab_max_bits, int, 0444);
+MODULE_PARM_DESC(conn_tab_max_bits, "Set connections' maximum hash size");
+
+/* current size, and the resize limits */
 int ip_vs_conn_tab_size __read_mostly;
-static int ip_vs_conn_tab_mask __read_mostly;
+static unsigned int ip_vs_conn_tab_min __read_mostly;
+static unsigned int ip_vs_conn_tab_max __read_mostly;
 
 /*
  *  Connection hash table: for input and output packets lookups of IPVS
+ *
+ *  While it is resized, @future is the table being filled: new entries go
+ *  there, the buckets are moved over one by one, and lookups check both.
  */
-static struct hlist_head *ip_vs_conn_tab __read_mostly;
+struct ip_vs_conn_tab {
+	unsigned int			size;
+	unsigned int			mask;
+	struct ip_vs_conn_tab __rcu	*future;
+	struct hlist_head		buckets[];
+};
+
+static struct ip_vs_conn_tab __rcu *ip_vs_conn_tab __read_mostly;
+
+/* Number of hashed entries, for the resize decisions */
+static struct percpu_counter ip_vs_conn_nr;
+
+static void ip_vs_conn_tab_resize(struct work_struct *work);
+static DECLARE_WORK(ip_vs_conn_resize_work, ip_vs_conn_tab_resize);
 
 /*  SLAB cache for IPVS connections */
 static struct kmem_cache *ip_vs_conn_cachep __read_mostly;
@@ -83,6 +108,8 @@ static unsigned int ip_vs_conn_rnd __read_mostly;
 struct ip_vs_aligned_lock
 {
 	spinlock_t	l;
+	/* bumped while a resize moves the buckets under l */
+	seqcount_spinlock_t	seq;
 } __attribute__((__aligned__(SMP_CACHE_BYTES)));
 
 /* lock array for conn table */
@@ -99,10 +126,38 @@ static inline void ct_write_unlock_bh(unsigned int key)
 	spin_unlock_bh(&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].l);
 }
 
+/* A lookup that raced with a resize moving its bucket may miss the entry */
+static inline unsigned int ct_read_begin(unsigned int key)
+{
+	return read_seqcount_begin(
+		&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].seq);
+}
+
+static inline bool ct_read_retry(unsigned int key, unsigned int seq)
+{
+	return read_seqcount_retry(
+		&__ip_vs_conntbl_lock_array[key&CT_LOCKARRAY_MASK].seq, seq);
+}
+
+/* Walk the chains of @hash in the table, then in the one being filled */
+#define ip_vs_conn_tab_for_each_chain(head, t, hash)			\
+	for (t = rcu_dereference(ip_vs_conn_tab);			\
+	     t && ((head) = &t->buckets[(hash) & t->mask], true);	\
+	     t = rcu_dereference(t->future))
+
+/* The bucket @idx of the current table, NULL past its end */
+static struct hlist_head *ip_vs_conn_tab_bucket(unsigned int idx)
+{
+	struct ip_vs_conn_tab *t = rcu_dereference(ip_vs_conn_tab);
+
+	return idx < t->size ? &t->buckets[idx] : NULL;
+}
+
 static void ip_vs_conn_expire(struct timer_list *t);
 
 /*
- *	Returns hash value for IPVS connection entry
+ *	Returns hash value for IPVS connection entry, the bucket being its
+ *	low bits, as many as the table has
  */
 static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned int proto,
 				       const union nf_inet_addr *addr,
@@ -110,13 +165,13 @@ static unsigned int ip_vs_conn_hashkey(struct netns_ipvs *ipvs, int af, unsigned
 {
 #ifdef CONFIG_IP_VS_IPV6
 	if (af == AF_INET6)
-		return (jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
+		return jhash_3words(jhash(addr, 16, ip_vs_conn_rnd),
 				    (__force u32)port, proto, ip_vs_conn_rnd) ^
-			((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+			((size_t)ipvs>>8);
 #endif
-	return (jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
+	return jhash_3words((__force u32)addr->ip, (__force u32)port, proto,
 			    ip_vs_conn_rnd) ^
-		((size_t)ipvs>>8)) & ip_vs_conn_tab_mask;
+		((size_t)ipvs>>8);
 }
 
 static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
@@ -126,8 +181,7 @@ static unsigned int ip_vs_conn_hashkey_param(const struct ip_vs_conn_param *p,
 	__be16 port;
 
 	if (p->pe_data && p->pe->hashkey_raw)
-		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse) &
-			ip_vs_conn_tab_mask;
+		return p->pe->hashkey_raw(p, ip_vs_conn_rnd, inverse);
 
 	if (likely(!inverse)) {
 		addr = p->caddr;
@@ -160,8 +214,21 @@ static unsigned int ip_vs_conn_hashkey_conn(const struct ip_vs_conn *cp)
  *	Hashes ip_vs_conn in ip_vs_conn_tab by netns,proto,addr,port.
  *	returns bool success.
  */
+static void ip_vs_conn_tab_check(void)
+{
+	unsigned int size = READ_ONCE(ip_vs_conn_tab_size);
+	s64 nr = percpu_counter_read_positive(&ip_vs_conn_nr);
+
+	if (work_pending(&ip_vs_conn_resize_work))
+		return;
+	if ((nr > size && size < ip_vs_conn_tab_max) ||
+	    (nr < size / 4 && size > ip_vs_conn_tab_min))
+		queue_work(system_unbound_wq, &ip_vs_conn_resize_work);
+}
+
 static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 {
+	struct ip_vs_conn_tab *t, *nt;
 	unsigned int hash;
 	int ret;
 
@@ -177,7 +244,13 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	if (!(cp->flags & IP_VS_CONN_F_HASHED)) {
 		cp->flags |= IP_VS_CONN_F_HASHED;
 		refcount_inc(&cp->refcnt);
-		hlist_add_head_rcu(&cp->c_list, &ip_vs_conn_tab[hash]);
+		/* Under the lock, a resize moves this bucket before or after */
+		t = rcu_dereference_bh(ip_vs_conn_tab);
+		nt = rcu_dereference_bh(t->future);
+		if (nt)
+			t = nt;
+		hlist_add_head_rcu(&cp->c_list, &t->buckets[hash & t->mask]);
+		percpu_counter_inc(&ip_vs_conn_nr);
 		ret = 1;
 	} else {
 		pr_err("%s(): request for already hashed, called from %pS\n",
@@ -188,6 +261,8 @@ static inline int ip_vs_conn_hash(struct ip_vs_conn *cp)
 	spin_unlock(&cp->lock);
 	ct_write_unlock_bh(hash);
 
+	if (ret)
+		ip_vs_conn_tab_check();
 	return ret;
 }
 
@@ -211,6 +286,7 @@ static inline int ip_vs_conn_unhash(struct ip_vs_conn *cp)
 		hlist_del_rcu(&cp->c_list);
 		cp->flags &= ~IP_VS_CONN_F_HASHED;
 		refcount_dec(&cp->refcnt);
+		percpu_counter_dec(&ip_vs_conn_nr);
 		ret = 1;
 	} else
 		ret = 0;
@@ -242,6 +318,7 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 		if (refcount_dec_if_one(&cp->refcnt)) {
 			hlist_del_rcu(&cp->c_list);
 			cp->flags &= ~IP_VS_CONN_F_HASHED;
+			percpu_counter_dec(&ip_vs_conn_nr);
 			ret = true;
 		}
 	}
@@ -249,6 +326,8 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 	spin_unlock(&cp->lock);
 	ct_write_unlock_bh(hash);
 
+	if (ret)
+		ip_vs_conn_tab_check();
 	return ret;
 }
 
@@ -262,28 +341,36 @@ static inline bool ip_vs_conn_unlink(struct ip_vs_conn *cp)
 static inline struct ip_vs_conn *
 __ip_vs_conn_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	unsigned int hash, seq;
+	struct ip_vs_conn_tab *t;
+	struct hlist_head *head;
 	struct ip_vs_conn *cp;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->cport == cp->cport && p->vport == cp->vport &&
-		    cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->vaddr) &&
-		    ((!p->cport) ^ (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			rcu_read_unlock();
-			return cp;
+retry:
+	seq = ct_read_begin(hash);
+	ip_vs_conn_tab_for_each_chain(head, t, hash) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
+			if (p->cport == cp->cport && p->vport == cp->vport &&
+			    cp->af == p->af &&
+			    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
+			    ip_vs_addr_equal(p->af, p->vaddr, &cp->vaddr) &&
+			    ((!p->cport) ^ (!(cp->flags & IP_VS_CONN_F_NO_CPORT))) &&
+			    p->protocol == cp->protocol &&
+			    cp->ipvs == p->ipvs) {
+				if (!__ip_vs_conn_get(cp))
+					continue;
+				/* HIT */
+				rcu_read_unlock();
+				return cp;
+			}
 		}
 	}
+	if (ct_read_retry(hash, seq))
+		goto retry;
 
 	rcu_read_unlock();
 
@@ -348,38 +435,46 @@ EXPORT_SYMBOL_GPL(ip_vs_conn_in_get_proto);
 /* Get reference to connection template */
 struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	unsigned int hash, seq;
+	struct ip_vs_conn_tab *t;
+	struct hlist_head *head;
 	struct ip_vs_conn *cp;
 
 	hash = ip_vs_conn_hashkey_param(p, false);
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (unlikely(p->pe_data && p->pe->ct_match)) {
-			if (cp->ipvs != p->ipvs)
+retry:
+	seq = ct_read_begin(hash);
+	ip_vs_conn_tab_for_each_chain(head, t, hash) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
+			if (unlikely(p->pe_data && p->pe->ct_match)) {
+				if (cp->ipvs != p->ipvs)
+					continue;
+				if (p->pe == cp->pe && p->pe->ct_match(p, cp)) {
+					if (__ip_vs_conn_get(cp))
+						goto out;
+				}
 				continue;
-			if (p->pe == cp->pe && p->pe->ct_match(p, cp)) {
+			}
+
+			if (cp->af == p->af &&
+			    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
+			    /* protocol should only be IPPROTO_IP if
+			     * p->vaddr is a fwmark */
+			    ip_vs_addr_equal(p->protocol == IPPROTO_IP ? AF_UNSPEC :
+					     p->af, p->vaddr, &cp->vaddr) &&
+			    p->vport == cp->vport && p->cport == cp->cport &&
+			    cp->flags & IP_VS_CONN_F_TEMPLATE &&
+			    p->protocol == cp->protocol &&
+			    cp->ipvs == p->ipvs) {
 				if (__ip_vs_conn_get(cp))
 					goto out;
 			}
-			continue;
-		}
-
-		if (cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->caddr, &cp->caddr) &&
-		    /* protocol should only be IPPROTO_IP if
-		     * p->vaddr is a fwmark */
-		    ip_vs_addr_equal(p->protocol == IPPROTO_IP ? AF_UNSPEC :
-				     p->af, p->vaddr, &cp->vaddr) &&
-		    p->vport == cp->vport && p->cport == cp->cport &&
-		    cp->flags & IP_VS_CONN_F_TEMPLATE &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (__ip_vs_conn_get(cp))
-				goto out;
 		}
 	}
+	if (ct_read_retry(hash, seq))
+		goto retry;
 	cp = NULL;
 
   out:
@@ -400,9 +495,11 @@ struct ip_vs_conn *ip_vs_ct_in_get(const struct ip_vs_conn_param *p)
  *	p->vaddr, p->vport: pkt dest address (foreign host) */
 struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 {
-	unsigned int hash;
+	unsigned int hash, seq;
 	struct ip_vs_conn *cp, *ret=NULL;
 	const union nf_inet_addr *saddr;
+	struct ip_vs_conn_tab *t;
+	struct hlist_head *head;
 	__be16 sport;
 
 	/*
@@ -412,31 +509,38 @@ struct ip_vs_conn *ip_vs_conn_out_get(const struct ip_vs_conn_param *p)
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
-		if (p->vport != cp->cport)
-			continue;
+retry:
+	seq = ct_read_begin(hash);
+	ip_vs_conn_tab_for_each_chain(head, t, hash) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
+			if (p->vport != cp->cport)
+				continue;
 
-		if (IP_VS_FWD_METHOD(cp) != IP_VS_CONN_F_MASQ) {
-			sport = cp->vport;
-			saddr = &cp->vaddr;
-		} else {
-			sport = cp->dport;
-			saddr = &cp->daddr;
-		}
+			if (IP_VS_FWD_METHOD(cp) != IP_VS_CONN_F_MASQ) {
+				sport = cp->vport;
+				saddr = &cp->vaddr;
+			} else {
+				sport = cp->dport;
+				saddr = &cp->daddr;
+			}
 
-		if (p->cport == sport && cp->af == p->af &&
-		    ip_vs_addr_equal(p->af, p->vaddr, &cp->caddr) &&
-		    ip_vs_addr_equal(p->af, p->caddr, saddr) &&
-		    p->protocol == cp->protocol &&
-		    cp->ipvs == p->ipvs) {
-			if (!__ip_vs_conn_get(cp))
-				continue;
-			/* HIT */
-			ret = cp;
-			break;
+			if (p->cport == sport && cp->af == p->af &&
+			    ip_vs_addr_equal(p->af, p->vaddr, &cp->caddr) &&
+			    ip_vs_addr_equal(p->af, p->caddr, saddr) &&
+			    p->protocol == cp->protocol &&
+			    cp->ipvs == p->ipvs) {
+				if (!__ip_vs_conn_get(cp))
+					continue;
+				/* HIT */
+				ret = cp;
+				goto out;
+			}
 		}
 	}
+	if (ct_read_retry(hash, seq))
+		goto retry;
 
+out:
 	rcu_read_unlock();
 
 	IP_VS_DBG_BUF(9, "lookup/out %s %s:%d->%s:%d %s\n",
@@ -1044,24 +1148,28 @@ ip_vs_conn_new(const struct ip_vs_conn_param *p, int dest_af,
  *	/proc/net/ip_vs_conn entries
  */
 #ifdef CONFIG_PROC_FS
+/* Entries moved by a resize while the table is read may be missed or
+ * shown twice.
+ */
 struct ip_vs_iter_state {
 	struct seq_net_private	p;
-	struct hlist_head	*l;
+	unsigned int		idx;
 };
 
 static void *ip_vs_conn_array(struct seq_file *seq, loff_t pos)
 {
-	int idx;
+	unsigned int idx;
 	struct ip_vs_conn *cp;
+	struct hlist_head *head;
 	struct ip_vs_iter_state *iter = seq->private;
 
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+	for (idx = 0; (head = ip_vs_conn_tab_bucket(idx)); idx++) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
 			/* __ip_vs_conn_get() is not needed by
 			 * ip_vs_conn_seq_show and ip_vs_conn_sync_seq_show
 			 */
 			if (pos-- == 0) {
-				iter->l = &ip_vs_conn_tab[idx];
+				iter->idx = idx;
 				return cp;
 			}
 		}
@@ -1076,7 +1184,7 @@ static void *ip_vs_conn_seq_start(struct seq_file *seq, loff_t *pos)
 {
 	struct ip_vs_iter_state *iter = seq->private;
 
-	iter->l = NULL;
+	iter->idx = 0;
 	rcu_read_lock();
 	return *pos ? ip_vs_conn_array(seq, *pos - 1) :SEQ_START_TOKEN;
 }
@@ -1085,9 +1193,9 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 {
 	struct ip_vs_conn *cp = v;
 	struct ip_vs_iter_state *iter = seq->private;
+	struct hlist_head *head;
 	struct hlist_node *e;
-	struct hlist_head *l = iter->l;
-	int idx;
+	unsigned int idx;
 
 	++*pos;
 	if (v == SEQ_START_TOKEN)
@@ -1098,15 +1206,15 @@ static void *ip_vs_conn_seq_next(struct seq_file *seq, void *v, loff_t *pos)
 	if (e)
 		return hlist_entry(e, struct ip_vs_conn, c_list);
 
-	idx = l - ip_vs_conn_tab;
-	while (++idx < ip_vs_conn_tab_size) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
-			iter->l = &ip_vs_conn_tab[idx];
+	idx = iter->idx;
+	while ((head = ip_vs_conn_tab_bucket(++idx))) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
+			iter->idx = idx;
 			return cp;
 		}
 		cond_resched_rcu();
 	}
-	iter->l = NULL;
+	iter->idx = 0;
 	return NULL;
 }
 
@@ -1307,10 +1415,11 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
 	/*
 	 * Randomly scan 1/32 of the whole table every second
 	 */
-	for (idx = 0; idx < (ip_vs_conn_tab_size>>5); idx++) {
-		unsigned int hash = get_random_u32() & ip_vs_conn_tab_mask;
+	for (idx = 0; idx < (READ_ONCE(ip_vs_conn_tab_size)>>5); idx++) {
+		struct ip_vs_conn_tab *t = rcu_dereference(ip_vs_conn_tab);
+		unsigned int hash = get_random_u32() & t->mask;
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[hash], c_list) {
+		hlist_for_each_entry_rcu(cp, &t->buckets[hash], c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1370,14 +1479,15 @@ void ip_vs_random_dropentry(struct netns_ipvs *ipvs)
  */
 static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 {
-	int idx;
+	unsigned int idx;
+	struct hlist_head *head;
 	struct ip_vs_conn *cp, *cp_c;
 
 flush_again:
 	rcu_read_lock();
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
+	for (idx = 0; (head = ip_vs_conn_tab_bucket(idx)); idx++) {
 
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 			if (atomic_read(&cp->n_control))
@@ -1395,7 +1505,8 @@ static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 	rcu_read_unlock();
 
 	/* the counter may be not NULL, because maybe some conn entries
-	   are run by slow timer handler or unhashed but still referred */
+	   are run by slow timer handler or unhashed but still referred,
+	   or were moved behind us by a resize */
 	if (atomic_read(&ipvs->conn_count) != 0) {
 		schedule();
 		goto flush_again;
@@ -1405,13 +1516,14 @@ static void ip_vs_conn_flush(struct netns_ipvs *ipvs)
 #ifdef CONFIG_SYSCTL
 void ip_vs_expire_nodest_conn_flush(struct netns_ipvs *ipvs)
 {
-	int idx;
+	unsigned int idx;
+	struct hlist_head *head;
 	struct ip_vs_conn *cp, *cp_c;
 	struct ip_vs_dest *dest;
 
 	rcu_read_lock();
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++) {
-		hlist_for_each_entry_rcu(cp, &ip_vs_conn_tab[idx], c_list) {
+	for (idx = 0; (head = ip_vs_conn_tab_bucket(idx)); idx++) {
+		hlist_for_each_entry_rcu(cp, head, c_list) {
 			if (cp->ipvs != ipvs)
 				continue;
 
@@ -1440,6 +1552,93 @@ void ip_vs_expire_nodest_conn_flush(struct netns_ipvs *ipvs)
 }
 #endif
 
+static struct ip_vs_conn_tab *ip_vs_conn_tab_alloc(unsigned int size)
+{
+	struct ip_vs_conn_tab *t;
+	unsigned int idx;
+
+	t = kvmalloc(struct_size(t, buckets, size), GFP_KERNEL);
+	if (!t)
+		return NULL;
+
+	t->size = size;
+	t->mask = size - 1;
+	RCU_INIT_POINTER(t->future, NULL);
+	for (idx = 0; idx < size; idx++)
+		INIT_HLIST_HEAD(&t->buckets[idx]);
+	return t;
+}
+
+/* Size for @nr entries: grow past one entry per bucket, shrink below 1/4,
+ * to about two buckets per entry either way.
+ */
+static unsigned int ip_vs_conn_tab_target(unsigned int size, s64 nr)
+{
+	if (nr > size)
+		size = nr >= ip_vs_conn_tab_max / 2 ? ip_vs_conn_tab_max :
+			roundup_pow_of_two(nr * 2);
+	else if (nr < size / 4)
+		size = max_t(unsigned int, ip_vs_conn_tab_min,
+			     roundup_pow_of_two(max_t(s64, nr, 1) * 2));
+	return size;
+}
+
+/* Move the chain @idx of @t to @nt.  Its entries all share a lock, as
+ * the tables have more buckets than there are locks.
+ */
+static void ip_vs_conn_tab_move(struct ip_vs_conn_tab *t,
+				struct ip_vs_conn_tab *nt, unsigned int idx)
+{
+	struct ip_vs_aligned_lock *l =
+		&__ip_vs_conntbl_lock_array[idx & CT_LOCKARRAY_MASK];
+	struct hlist_node *next;
+	struct ip_vs_conn *cp;
+	unsigned int hash;
+
+	spin_lock_bh(&l->l);
+	write_seqcount_begin(&l->seq);
+	hlist_for_each_entry_safe(cp, next, &t->buckets[idx], c_list) {
+		hash = ip_vs_conn_hashkey_conn(cp);
+		hlist_del_rcu(&cp->c_list);
+		hlist_add_head_rcu(&cp->c_list, &nt->buckets[hash & nt->mask]);
+	}
+	write_seqcount_end(&l->seq);
+	spin_unlock_bh(&l->l);
+}
+
+static void ip_vs_conn_tab_resize(struct work_struct *work)
+{
+	struct ip_vs_conn_tab *t, *nt;
+	unsigned int size, idx;
+	s64 nr;
+
+	t = rcu_dereference_protected(ip_vs_conn_tab, 1);
+	nr = percpu_counter_sum_positive(&ip_vs_conn_nr);
+	size = ip_vs_conn_tab_target(t->size, nr);
+	if (size == t->size)
+		return;
+
+	nt = ip_vs_conn_tab_alloc(size);
+	if (!nt)
+		return;
+
+	/* From here on, new entries go to nt */
+	rcu_assign_pointer(t->future, nt);
+	for (idx = 0; idx < t->size; idx++) {
+		ip_vs_conn_tab_move(t, nt, idx);
+		cond_resched();
+	}
+
+	rcu_assign_pointer(ip_vs_conn_tab, nt);
+	WRITE_ONCE(ip_vs_conn_tab_size, size);
+	/* Readers and writers still holding t also look at t->future */
+	synchronize_rcu();
+	kvfree(t);
+
+	pr_info("Connection hash table resized (size=%u, conns=%lld)\n",
+		size, nr);
+}
+
 /*
  * per netns init and exit
  */
@@ -1481,6 +1680,7 @@ void __net_exit ip_vs_conn_net_cleanup(struct netns_ipvs *ipvs)
 
 int __init ip_vs_conn_init(void)
 {
+	struct ip_vs_conn_tab *t;
 	int idx;
 
 	/* Compute size and mask */
@@ -1488,38 +1688,50 @@ int __init ip_vs_conn_init(void)
 		pr_info("conn_tab_bits not in [8, 20]. Using default value\n");
 		ip_vs_conn_tab_bits = CONFIG_IP_VS_TAB_BITS;
 	}
+	if (ip_vs_conn_tab_max_bits < ip_vs_conn_tab_bits ||
+	    ip_vs_conn_tab_max_bits > 28) {
+		pr_info("conn_tab_max_bits not in [conn_tab_bits, 28]. "
+			"Not resizing\n");
+		ip_vs_conn_tab_max_bits = ip_vs_conn_tab_bits;
+	}
 	ip_vs_conn_tab_size = 1 << ip_vs_conn_tab_bits;
-	ip_vs_conn_tab_mask = ip_vs_conn_tab_size - 1;
+	ip_vs_conn_tab_min = ip_vs_conn_tab_size;
+	ip_vs_conn_tab_max = 1U << ip_vs_conn_tab_max_bits;
 
 	/*
 	 * Allocate the connection hash table and initialize its list heads
 	 */
-	ip_vs_conn_tab = vmalloc(array_size(ip_vs_conn_tab_size,
-					    sizeof(*ip_vs_conn_tab)));
-	if (!ip_vs_conn_tab)
+	t = ip_vs_conn_tab_alloc(ip_vs_conn_tab_size);
+	if (!t)
 		return -ENOMEM;
+	RCU_INIT_POINTER(ip_vs_conn_tab, t);
+
+	if (percpu_counter_init(&ip_vs_conn_nr, 0, GFP_KERNEL)) {
+		kvfree(t);
+		return -ENOMEM;
+	}
 
 	/* Allocate ip_vs_conn slab cache */
 	ip_vs_conn_cachep = kmem_cache_create("ip_vs_conn",
 					      sizeof(struct ip_vs_conn), 0,
 					      SLAB_HWCACHE_ALIGN, NULL);
 	if (!ip_vs_conn_cachep) {
-		vfree(ip_vs_conn_tab);
+		percpu_counter_destroy(&ip_vs_conn_nr);
+		kvfree(t);
 		return -ENOMEM;
 	}
 
 	pr_info("Connection hash table configured "
-		"(size=%d, memory=%ldKbytes)\n",
-		ip_vs_conn_tab_size,
-		(long)(ip_vs_conn_tab_size*sizeof(*ip_vs_conn_tab))/1024);
+		"(size=%d, max=%u, memory=%ldKbytes)\n",
+		ip_vs_conn_tab_size, ip_vs_conn_tab_max,
+		(long)(ip_vs_conn_tab_size*sizeof(t->buckets[0]))/1024);
 	IP_VS_DBG(0, "Each connection entry needs %zd bytes at least\n",
 		  sizeof(struct ip_vs_conn));
 
-	for (idx = 0; idx < ip_vs_conn_tab_size; idx++)
-		INIT_HLIST_HEAD(&ip_vs_conn_tab[idx]);
-
 	for (idx = 0; idx < CT_LOCKARRAY_SIZE; idx++)  {
 		spin_lock_init(&__ip_vs_conntbl_lock_array[idx].l);
+		seqcount_spinlock_init(&__ip_vs_conntbl_lock_array[idx].seq,
+				       &__ip_vs_conntbl_lock_array[idx].l);
 	}
 
 	/* calculate the random value for connection hash */
@@ -1530,9 +1742,11 @@ int __init ip_vs_conn_init(void)
 
 void ip_vs_conn_cleanup(void)
 {
+	cancel_work_sync(&ip_vs_conn_resize_work);
 	/* Wait all ip_vs_conn_rcu_free() callbacks to complete */
 	rcu_barrier();
 	/* Release the empty cache */
 	kmem_cache_destroy(ip_vs_conn_cachep);
-	vfree(ip_vs_conn_tab);
+	percpu_counter_destroy(&ip_vs_conn_nr);
+	kvfree(rcu_dereference_protected(ip_vs_conn_tab, 1));
 }
@@ -39,6 +39,14 @@ struct ip_vs_mh_lookup {
 	struct ip_vs_dest __rcu	*dest;	/* real server (cache) */
 };
 
+/* A lookup table is built aside and replaces the current one as a whole,
+ * so the scheduler never sees one half populated.
+ */
+struct ip_vs_mh_table {
+	struct rcu_head		rcu_head;
+	struct ip_vs_mh_lookup	lookup[];
+};
+
 struct ip_vs_mh_dest_setup {
 	unsigned int	offset; /* starting offset */
 	unsigned int	skip;	/* skip */
@@ -60,7 +68,7 @@ static int primes[] = {251, 509, 1021, 2039, 4093,
 
 struct ip_vs_mh_state {
 	struct rcu_head			rcu_head;
-	struct ip_vs_mh_lookup		*lookup;
+	struct ip_vs_mh_table __rcu	*table;
 	struct ip_vs_mh_dest_setup	*dest_setup;
 	hsiphash_key_t			hash1, hash2;
 	int				gcd;
@@ -102,13 +110,13 @@ ip_vs_mh_hashkey(int af, const union nf_inet_addr *addr,
 }
 
 /* Reset all the hash buckets of the specified table. */
-static void ip_vs_mh_reset(struct ip_vs_mh_state *s)
+static void ip_vs_mh_reset(struct ip_vs_mh_table *t)
 {
 	int i;
 	struct ip_vs_mh_lookup *l;
 	struct ip_vs_dest *dest;
 
-	l = &s->lookup[0];
+	l = &t->lookup[0];
 	for (i = 0; i < IP_VS_MH_TAB_SIZE; i++) {
 		dest = rcu_dereference_protected(l->dest, 1);
 		if (dest) {
@@ -119,6 +127,16 @@ static void ip_vs_mh_reset(struct ip_vs_mh_state *s)
 	}
 }
 
+/* Drop a replaced table once the readers that may still use it are gone. */
+static void ip_vs_mh_table_free(struct rcu_head *head)
+{
+	struct ip_vs_mh_table *t;
+
+	t = container_of(head, struct ip_vs_mh_table, rcu_head);
+	ip_vs_mh_reset(t);
+	kfree(t);
+}
+
 static int ip_vs_mh_permutate(struct ip_vs_mh_state *s,
 			      struct ip_vs_service *svc)
 {
@@ -157,7 +175,8 @@ static int ip_vs_mh_permutate(struct ip_vs_mh_state *s,
 }
 
 static int ip_vs_mh_populate(struct ip_vs_mh_state *s,
-			     struct ip_vs_service *svc)
+			     struct ip_vs_service *svc,
+			     struct ip_vs_mh_table *t)
 {
 	int n, c, dt_count;
 	unsigned long *table;
@@ -167,12 +186,10 @@ static int ip_vs_mh_populate(struct ip_vs_mh_state *s,
 
 	/* If gcd is smaller then 1, number of dests or
 	 * all last_weight of dests are zero. So, skip
-	 * the population for the dests and reset lookup table.
+	 * the population for the dests and leave the lookup table empty.
 	 */
-	if (s->gcd < 1) {
-		ip_vs_mh_reset(s);
+	if (s->gcd < 1)
 		return 0;
-	}
 
 	table = bitmap_zalloc(IP_VS_MH_TAB_SIZE, GFP_KERNEL);
 	if (!table)
@@ -205,13 +222,13 @@ static int ip_vs_mh_populate(struct ip_vs_mh_state *s,
 
 			__set_bit(c, table);
 
-			dest = rcu_dereference_protected(s->lookup[c].dest, 1);
+			dest = rcu_dereference_protected(t->lookup[c].dest, 1);
 			new_dest = list_entry(p, struct ip_vs_dest, n_list);
 			if (dest != new_dest) {
 				if (dest)
 					ip_vs_dest_put(dest);
 				ip_vs_dest_hold(new_dest);
-				RCU_INIT_POINTER(s->lookup[c].dest, new_dest);
+				RCU_INIT_POINTER(t->lookup[c].dest, new_dest);
 			}
 
 			if (++n == IP_VS_MH_TAB_SIZE)
@@ -233,11 +250,12 @@ static int ip_vs_mh_populate(struct ip_vs_mh_state *s,
 /* Get ip_vs_dest associated with supplied parameters. */
 static inline struct ip_vs_dest *
 ip_vs_mh_get(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
+	     struct ip_vs_mh_table *t,
 	     const union nf_inet_addr *addr, __be16 port)
 {
 	unsigned int hash = ip_vs_mh_hashkey(svc->af, addr, port, &s->hash1, 0)
 					     % IP_VS_MH_TAB_SIZE;
-	struct ip_vs_dest *dest = rcu_dereference(s->lookup[hash].dest);
+	struct ip_vs_dest *dest = rcu_dereference(t->lookup[hash].dest);
 
 	return (!dest || is_unavailable(dest)) ? NULL : dest;
 }
@@ -245,6 +263,7 @@ ip_vs_mh_get(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
 /* As ip_vs_mh_get, but with fallback if selected server is unavailable */
 static inline struct ip_vs_dest *
 ip_vs_mh_get_fallback(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
+		      struct ip_vs_mh_table *t,
 		      const union nf_inet_addr *addr, __be16 port)
 {
 	unsigned int offset, roffset;
@@ -254,7 +273,7 @@ ip_vs_mh_get_fallback(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
 	/* First try the dest it's supposed to go to */
 	ihash = ip_vs_mh_hashkey(svc->af, addr, port,
 				 &s->hash1, 0) % IP_VS_MH_TAB_SIZE;
-	dest = rcu_dereference(s->lookup[ihash].dest);
+	dest = rcu_dereference(t->lookup[ihash].dest);
 	if (!dest)
 		return NULL;
 	if (!is_unavailable(dest))
@@ -270,7 +289,7 @@ ip_vs_mh_get_fallback(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
 		roffset = (offset + ihash) % IP_VS_MH_TAB_SIZE;
 		hash = ip_vs_mh_hashkey(svc->af, addr, port, &s->hash1,
 					roffset) % IP_VS_MH_TAB_SIZE;
-		dest = rcu_dereference(s->lookup[hash].dest);
+		dest = rcu_dereference(t->lookup[hash].dest);
 		if (!dest)
 			break;
 		if (!is_unavailable(dest))
@@ -288,24 +307,41 @@ ip_vs_mh_get_fallback(struct ip_vs_service *svc, struct ip_vs_mh_state *s,
 static int ip_vs_mh_reassign(struct ip_vs_mh_state *s,
 			     struct ip_vs_service *svc)
 {
+	struct ip_vs_mh_table *t, *old;
 	int ret;
 
 	if (svc->num_dests > IP_VS_MH_TAB_SIZE)
 		return -EINVAL;
 
+	t = kzalloc(struct_size(t, lookup, IP_VS_MH_TAB_SIZE), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+
 	if (svc->num_dests >= 1) {
 		s->dest_setup = kcalloc(svc->num_dests,
 					sizeof(struct ip_vs_mh_dest_setup),
 					GFP_KERNEL);
-		if (!s->dest_setup)
+		if (!s->dest_setup) {
+			kfree(t);
 			return -ENOMEM;
+		}
 	}
 
 	ip_vs_mh_permutate(s, svc);
 
-	ret = ip_vs_mh_populate(s, svc);
-	if (ret < 0)
+	ret = ip_vs_mh_populate(s, svc, t);
+	if (ret < 0) {
+		ip_vs_mh_reset(t);
+		kfree(t);
 		goto out;
+	}
+
+	/* Readers may still walk the old table, it keeps its dests until
+	 * they are done.
+	 */
+	old = rcu_replace_pointer(s->table, t, true);
+	if (old)
+		call_rcu(&old->rcu_head, ip_vs_mh_table_free);
 
 	IP_VS_DBG_BUF(6, "MH: reassign lookup table of %s:%u\n",
 		      IP_VS_DBG_ADDR(svc->af, &svc->addr),
@@ -372,9 +408,14 @@ static int ip_vs_mh_shift_weight(struct ip_vs_service *svc, int gcd)
 static void ip_vs_mh_state_free(struct rcu_head *head)
 {
 	struct ip_vs_mh_state *s;
+	struct ip_vs_mh_table *t;
 
 	s = container_of(head, struct ip_vs_mh_state, rcu_head);
-	kfree(s->lookup);
+	t = rcu_dereference_protected(s->table, 1);
+	if (t) {
+		ip_vs_mh_reset(t);
+		kfree(t);
+	}
 	kfree(s);
 }
 
@@ -388,13 +429,6 @@ static int ip_vs_mh_init_svc(struct ip_vs_service *svc)
 	if (!s)
 		return -ENOMEM;
 
-	s->lookup = kcalloc(IP_VS_MH_TAB_SIZE, sizeof(struct ip_vs_mh_lookup),
-			    GFP_KERNEL);
-	if (!s->lookup) {
-		kfree(s);
-		return -ENOMEM;
-	}
-
 	generate_hash_secret(&s->hash1, &s->hash2);
 	s->gcd = ip_vs_mh_gcd_weight(svc);
 	s->rshift = ip_vs_mh_shift_weight(svc, s->gcd);
@@ -406,7 +440,6 @@ static int ip_vs_mh_init_svc(struct ip_vs_service *svc)
 	/* Assign the lookup table with current dests */
 	ret = ip_vs_mh_reassign(s, svc);
 	if (ret < 0) {
-		ip_vs_mh_reset(s);
 		ip_vs_mh_state_free(&s->rcu_head);
 		return ret;
 	}
@@ -420,9 +453,7 @@ static void ip_vs_mh_done_svc(struct ip_vs_service *svc)
 {
 	struct ip_vs_mh_state *s = svc->sched_data;
 
-	/* Got to clean up lookup entry here */
-	ip_vs_mh_reset(s);
-
+	/* The lookup entries are cleaned up after the readers are gone */
 	call_rcu(&s->rcu_head, ip_vs_mh_state_free);
 	IP_VS_DBG(6, "MH lookup table (memory=%zdbytes) released\n",
 		  sizeof(struct ip_vs_mh_lookup) * IP_VS_MH_TAB_SIZE);
@@ -476,6 +507,7 @@ ip_vs_mh_schedule(struct ip_vs_service *svc, const struct sk_buff *skb,
 {
 	struct ip_vs_dest *dest;
 	struct ip_vs_mh_state *s;
+	struct ip_vs_mh_table *t;
 	__be16 port = 0;
 	const union nf_inet_addr *hash_addr;
 
@@ -487,11 +519,12 @@ ip_vs_mh_schedule(struct ip_vs_service *svc, const struct sk_buff *skb,
 		port = ip_vs_mh_get_port(skb, iph);
 
 	s = (struct ip_vs_mh_state *)svc->sched_data;
+	t = rcu_dereference(s->table);
 
 	if (svc->flags & IP_VS_SVC_F_SCHED_MH_FALLBACK)
-		dest = ip_vs_mh_get_fallback(svc, s, hash_addr, port);
+		dest = ip_vs_mh_get_fallback(svc, s, t, hash_addr, port);
 	else
-		dest = ip_vs_mh_get(svc, s, hash_addr, port);
+		dest = ip_vs_mh_get(svc, s, t, hash_addr, port);
 
 	if (!dest) {
 		ip_vs_scheduler_err(svc, "no destination available");
@@ -79,6 +79,12 @@ struct ovs_conntrack_info {
 #define OVS_CT_LIMIT_UNLIMITED	0
 #define OVS_CT_LIMIT_DEFAULT OVS_CT_LIMIT_UNLIMITED
 #define CT_LIMIT_HASH_BUCKETS 512
+/* Zones whose tracked count is below limit - limit / CT_LIMIT_SLACK admit
+ * new connections without pruning closed ones first.
+ */
+#define CT_LIMIT_SLACK 8
+#define CT_LIMIT_GC_INTERVAL HZ
+#define CT_LIMIT_GC_MAX_PASSES 64
 static DEFINE_STATIC_KEY_FALSE(ovs_ct_limit_enabled);
 
 struct ovs_ct_limit {
@@ -87,12 +93,18 @@ struct ovs_ct_limit {
 	struct rcu_head rcu;
 	u16 zone;
 	u32 limit;
+	/* Connections committed in this zone.  The count includes closed
+	 * connections until they are pruned by ct_limit_gc().
+	 */
+	struct nf_conncount_list conns;
 };
 
 struct ovs_ct_limit_info {
 	u32 default_limit;
 	struct hlist_head *limits;
 	struct nf_conncount_data *data;
+	struct delayed_work gc_work;
+	struct net *net;
 };
 
 static const struct nla_policy ct_limit_policy[OVS_CT_LIMIT_ATTR_MAX + 1] = {
@@ -934,6 +946,15 @@ static struct hlist_head *ct_limit_hash_bucket(
 	return &info->limits[zone & (CT_LIMIT_HASH_BUCKETS - 1)];
 }
 
+static void ct_limit_free_rcu(struct rcu_head *rcu)
+{
+	struct ovs_ct_limit *ct_limit = container_of(rcu, struct ovs_ct_limit,
+						     rcu);
+
+	nf_conncount_cache_free(&ct_limit->conns);
+	kfree(ct_limit);
+}
+
 /* Call with ovs_mutex */
 static void ct_limit_set(const struct ovs_ct_limit_info *info,
 			 struct ovs_ct_limit *new_ct_limit)
@@ -944,9 +965,9 @@ static void ct_limit_set(const struct ovs_ct_limit_info *info,
 	head = ct_limit_hash_bucket(info, new_ct_limit->zone);
 	hlist_for_each_entry_rcu(ct_limit, head, hlist_node) {
 		if (ct_limit->zone == new_ct_limit->zone) {
-			hlist_replace_rcu(&ct_limit->hlist_node,
-					  &new_ct_limit->hlist_node);
-			kfree_rcu(ct_limit, rcu);
+			/* Keep the connections already tracked for the zone. */
+			WRITE_ONCE(ct_limit->limit, new_ct_limit->limit);
+			kfree(new_ct_limit);
 			return;
 		}
 	}
@@ -965,14 +986,15 @@ static void ct_limit_del(const struct ovs_ct_limit_info *info, u16 zone)
 	hlist_for_each_entry_safe(ct_limit, n, head, hlist_node) {
 		if (ct_limit->zone == zone) {
 			hlist_del_rcu(&ct_limit->hlist_node);
-			kfree_rcu(ct_limit, rcu);
+			call_rcu(&ct_limit->rcu, ct_limit_free_rcu);
 			return;
 		}
 	}
 }
 
 /* Call with RCU read lock */
-static u32 ct_limit_get(const struct ovs_ct_limit_info *info, u16 zone)
+static struct ovs_ct_limit *ct_limit_find(const struct ovs_ct_limit_info *info,
+					  u16 zone)
 {
 	struct ovs_ct_limit *ct_limit;
 	struct hlist_head *head;
@@ -980,10 +1002,65 @@ static u32 ct_limit_get(const struct ovs_ct_limit_info *info, u16 zone)
 	head = ct_limit_hash_bucket(info, zone);
 	hlist_for_each_entry_rcu(ct_limit, head, hlist_node) {
 		if (ct_limit->zone == zone)
-			return ct_limit->limit;
+			return ct_limit;
 	}
 
-	return info->default_limit;
+	return NULL;
+}
+
+/* Prune closed connections from the zone's list.  Each pass of
+ * nf_conncount_gc_list() stops after a handful of evictions, so keep going
+ * while passes make progress.  The list lock is taken from the datapath in
+ * softirq context, so bottom halves are kept off around each pass.
+ */
+static void ct_limit_gc(struct net *net, struct ovs_ct_limit *ct_limit,
+			int max_passes)
+{
+	struct nf_conncount_list *conns = &ct_limit->conns;
+	unsigned int count;
+	bool done;
+
+	do {
+		count = READ_ONCE(conns->count);
+		/* Let the pass run even if the list was added to this jiffy. */
+		WRITE_ONCE(conns->last_gc, (u32)jiffies - 1);
+		local_bh_disable();
+		done = nf_conncount_gc_list(net, conns);
+		local_bh_enable();
+		if (done)
+			break;
+	} while (READ_ONCE(conns->count) < count && --max_passes > 0);
+}
+
+/* Zones with their own limit count connections on a per-zone list.  The
+ * admission check reads the list length without taking any lock, and
+ * while the zone is comfortably below its limit new connections are added
+ * without walking the list, leaving closed ones to the deferred gc.  Only
+ * zones close to their limit reconcile the count before deciding.
+ */
+static int ovs_ct_check_zone_limit(struct net *net,
+				   struct ovs_ct_limit *ct_limit,
+				   const struct nf_conntrack_tuple *tuple,
+				   const struct nf_conntrack_zone *zone)
+{
+	struct nf_conncount_list *conns = &ct_limit->conns;
+	u32 limit = READ_ONCE(ct_limit->limit);
+
+	if (limit == OVS_CT_LIMIT_UNLIMITED)
+		return 0;
+
+	if (READ_ONCE(conns->count) < limit - limit / CT_LIMIT_SLACK)
+		WRITE_ONCE(conns->last_gc, (u32)jiffies);
+	else
+		ct_limit_gc(net, ct_limit, 1);
+
+	if (nf_conncount_add(net, conns, tuple, zone))
+		return -ENOMEM;
+
+	if (READ_ONCE(conns->count) > limit)
+		return -ENOMEM;
+
+	return 0;
 }
 
 static int ovs_ct_check_limit(struct net *net,
@@ -993,11 +1070,17 @@ static int ovs_ct_check_limit(struct net *net,
 	struct ovs_net *ovs_net = net_generic(net, ovs_net_id);
 	const struct ovs_ct_limit_info *ct_limit_info = ovs_net->ct_limit_info;
 	u32 per_zone_limit, connections;
+	struct ovs_ct_limit *ct_limit;
 	u32 conncount_key;
 
 	conncount_key = info->zone.id;
 
-	per_zone_limit = ct_limit_get(ct_limit_info, info->zone.id);
+	ct_limit = ct_limit_find(ct_limit_info, info->zone.id);
+	if (ct_limit)
+		return ovs_ct_check_zone_limit(net, ct_limit, tuple,
+					       &info->zone);
+
+	per_zone_limit = ct_limit_info->default_limit;
 	if (per_zone_limit == OVS_CT_LIMIT_UNLIMITED)
 		return 0;
 
@@ -1663,6 +1746,32 @@ static void __ovs_ct_free_action(struct ovs_conntrack_info *ct_info)
 }
 
 #if	IS_ENABLED(CONFIG_NETFILTER_CONNCOUNT)
+static void ovs_ct_limit_gc_work(struct work_struct *work)
+{
+	struct ovs_ct_limit_info *info = container_of(to_delayed_work(work),
+						      struct ovs_ct_limit_info,
+						      gc_work);
+	struct ovs_ct_limit *ct_limit;
+	bool found = false;
+	int i;
+
+	for (i = 0; i < CT_LIMIT_HASH_BUCKETS; i++) {
+		rcu_read_lock();
+		hlist_for_each_entry_rcu(ct_limit, &info->limits[i],
+					 hlist_node) {
+			ct_limit_gc(info->net, ct_limit,
+				    CT_LIMIT_GC_MAX_PASSES);
+			found = true;
+		}
+		rcu_read_unlock();
+		cond_resched();
+	}
+
+	/* Setting a zone limit arms us again */
+	if (found)
+		schedule_delayed_work(&info->gc_work, CT_LIMIT_GC_INTERVAL);
+}
+
 static int ovs_ct_limit_init(struct net *net, struct ovs_net *ovs_net)
 {
 	int i, err;
@@ -1694,14 +1803,19 @@ static int ovs_ct_limit_init(struct net *net, struct ovs_net *ovs_net)
 		pr_err("openvswitch: failed to init nf_conncount %d\n", err);
 		return err;
 	}
+
+	ovs_net->ct_limit_info->net = net;
+	INIT_DELAYED_WORK(&ovs_net->ct_limit_info->gc_work,
+			  ovs_ct_limit_gc_work);
 	return 0;
 }
 
 static void ovs_ct_limit_exit(struct net *net, struct ovs_net *ovs_net)
 {
-	const struct ovs_ct_limit_info *info = ovs_net->ct_limit_info;
+	struct ovs_ct_limit_info *info = ovs_net->ct_limit_info;
 	int i;
 
+	cancel_delayed_work_sync(&info->gc_work);
 	nf_conncount_destroy(net, NFPROTO_INET, info->data);
 	for (i = 0; i < CT_LIMIT_HASH_BUCKETS; ++i) {
 		struct hlist_head *head = &info->limits[i];
@@ -1709,7 +1823,7 @@ static void ovs_ct_limit_exit(struct net *net, struct ovs_net *ovs_net)
 
 		hlist_for_each_entry_rcu(ct_limit, head, hlist_node,
 					 lockdep_ovsl_is_held())
-			kfree_rcu(ct_limit, rcu);
+			call_rcu(&ct_limit->rcu, ct_limit_free_rcu);
 	}
 	kfree(info->limits);
 	kfree(info);
@@ -1777,10 +1891,13 @@ static int ovs_ct_limit_set_zone_limit(struct nlattr *nla_zone_limit,
 
 			ct_limit->zone = zone;
 			ct_limit->limit = zone_limit->limit;
+			nf_conncount_list_init(&ct_limit->conns);
 
 			ovs_lock();
 			ct_limit_set(info, ct_limit);
 			ovs_unlock();
+			schedule_delayed_work(&info->gc_work,
+					      CT_LIMIT_GC_INTERVAL);
 		}
 		rem -= NLA_ALIGN(sizeof(*zone_limit));
 		zone_limit = (struct ovs_zone_limit *)((u8 *)zone_limit +
@@ -1857,6 +1974,21 @@ static int __ovs_ct_limit_get_zone_limit(struct net *net,
 	return nla_put_nohdr(reply, sizeof(zone_limit), &zone_limit);
 }
 
+/* Call with RCU read lock */
+static int ovs_ct_limit_put_zone_limit(struct net *net,
+				       struct ovs_ct_limit *ct_limit,
+				       struct sk_buff *reply)
+{
+	struct ovs_zone_limit zone_limit;
+
+	ct_limit_gc(net, ct_limit, CT_LIMIT_GC_MAX_PASSES);
+
+	zone_limit.zone_id = ct_limit->zone;
+	zone_limit.limit = READ_ONCE(ct_limit->limit);
+	zone_limit.count = READ_ONCE(ct_limit->conns.count);
+	return nla_put_nohdr(reply, sizeof(zone_limit), &zone_limit);
+}
+
 static int ovs_ct_limit_get_zone_limit(struct net *net,
 				       struct nlattr *nla_zone_limit,
 				       struct ovs_ct_limit_info *info,
@@ -1880,12 +2012,21 @@ static int ovs_ct_limit_get_zone_limit(struct net *net,
 							&zone))) {
 			OVS_NLERR(true, "zone id is out of range");
 		} else {
-			rcu_read_lock();
-			limit = ct_limit_get(info, zone);
-			rcu_read_unlock();
+			struct ovs_ct_limit *ct_limit;
 
-			err = __ovs_ct_limit_get_zone_limit(
-				net, info->data, zone, limit, reply);
+			rcu_read_lock();
+			ct_limit = ct_limit_find(info, zone);
+			if (ct_limit) {
+				err = ovs_ct_limit_put_zone_limit(net, ct_limit,
+								  reply);
+				rcu_read_unlock();
+			} else {
+				limit = info->default_limit;
+				rcu_read_unlock();
+
+				err = __ovs_ct_limit_get_zone_limit(
+					net, info->data, zone, limit, reply);
+			}
 			if (err)
 				return err;
 		}
@@ -1916,8 +2057,7 @@ static int ovs_ct_limit_get_all_zone_limit(struct net *net,
 	for (i = 0; i < CT_LIMIT_HASH_BUCKETS; ++i) {
 		head = &info->limits[i];
 		hlist_for_each_entry_rcu(ct_limit, head, hlist_node) {
-			err = __ovs_ct_limit_get_zone_limit(net, info->data,
-				ct_limit->zone, ct_limit->limit, reply);
+			err = ovs_ct_limit_put_zone_limit(net, ct_limit, reply);
 			if (err)
 				goto exit_err;
 		}
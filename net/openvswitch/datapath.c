@@ -161,11 +161,14 @@ static int get_dpifindex(const struct datapath *dp)
 	return ifindex;
 }
 
+static void ovs_dp_upcall_batch_exit(struct datapath *dp);
+
 static void destroy_dp_rcu(struct rcu_head *rcu)
 {
 	struct datapath *dp = container_of(rcu, struct datapath, rcu);
 
 	ovs_flow_tbl_destroy(&dp->table);
+	ovs_dp_upcall_batch_exit(dp);
 	free_percpu(dp->stats_percpu);
 	kfree(dp->ports);
 	ovs_meters_exit(dp);
@@ -420,6 +423,125 @@ static size_t upcall_msg_size(const struct dp_upcall_info *upcall_info,
 	return size;
 }
 
+/* Called with the batch lock held.  Returns the queued messages, if any. */
+static struct sk_buff *upcall_batch_detach(struct dp_upcall_batch *b,
+					   u32 *portid, u32 *count)
+{
+	struct sk_buff *skb = b->head;
+	u64 wait_ns;
+
+	if (!skb)
+		return NULL;
+
+	wait_ns = ktime_get_ns() - b->first_ns;
+	b->stats.n_batches++;
+	b->stats.wait_ns += wait_ns;
+	if (wait_ns > b->stats.max_wait_ns)
+		b->stats.max_wait_ns = wait_ns;
+
+	*portid = b->portid;
+	*count = b->count;
+	b->head = NULL;
+	b->tail = NULL;
+	b->count = 0;
+	return skb;
+}
+
+static void upcall_batch_send(struct dp_upcall_batch *b, struct sk_buff *skb,
+			      u32 portid, u32 count)
+{
+	struct datapath *dp = b->dp;
+	struct dp_stats_percpu *stats;
+
+	if (!genlmsg_unicast(ovs_dp_get_net(dp), skb, portid))
+		return;
+
+	spin_lock(&b->lock);
+	b->stats.n_lost += count;
+	spin_unlock(&b->lock);
+
+	stats = this_cpu_ptr(dp->stats_percpu);
+	u64_stats_update_begin(&stats->syncp);
+	stats->n_lost += count;
+	u64_stats_update_end(&stats->syncp);
+}
+
+static enum hrtimer_restart upcall_batch_timer(struct hrtimer *timer)
+{
+	struct dp_upcall_batch *b = container_of(timer, struct dp_upcall_batch,
+						 timer);
+	struct sk_buff *skb;
+	u32 portid, count;
+
+	spin_lock(&b->lock);
+	skb = upcall_batch_detach(b, &portid, &count);
+	spin_unlock(&b->lock);
+
+	if (skb)
+		upcall_batch_send(b, skb, portid, count);
+
+	return HRTIMER_NORESTART;
+}
+
+/* Send 'user_skb' to 'portid', either directly or by appending it to this
+ * CPU's upcall batch.  Userspace that enables batching must be prepared to
+ * receive several upcall messages in a single Netlink datagram.
+ */
+static int ovs_dp_upcall_unicast(struct datapath *dp, struct sk_buff *user_skb,
+				 u32 portid)
+{
+	u32 batch_size = READ_ONCE(dp->upcall_batch_size);
+	struct sk_buff *flush = NULL;
+	struct dp_upcall_batch *b;
+	u32 flush_portid, flush_count;
+	bool aligned;
+
+	if (!batch_size)
+		return genlmsg_unicast(ovs_dp_get_net(dp), user_skb, portid);
+
+	/* Messages are concatenated, so each one must end on a Netlink
+	 * alignment boundary for the next one to be parsable.
+	 */
+	aligned = IS_ALIGNED(user_skb->len, NLMSG_ALIGNTO);
+
+	b = this_cpu_ptr(dp->upcall_batch);
+	spin_lock(&b->lock);
+	if (b->head && (!aligned || b->portid != portid ||
+			b->head->len + user_skb->len > batch_size))
+		flush = upcall_batch_detach(b, &flush_portid, &flush_count);
+
+	if (aligned) {
+		if (!b->head) {
+			b->head = user_skb;
+			b->portid = portid;
+			b->first_ns = ktime_get_ns();
+			hrtimer_start(&b->timer,
+				      us_to_ktime(READ_ONCE(dp->upcall_batch_usecs)),
+				      HRTIMER_MODE_REL_PINNED_SOFT);
+		} else {
+			if (b->tail)
+				b->tail->next = user_skb;
+			else
+				skb_shinfo(b->head)->frag_list = user_skb;
+			b->tail = user_skb;
+			b->head->len += user_skb->len;
+			b->head->data_len += user_skb->len;
+			b->head->truesize += user_skb->truesize;
+		}
+		b->count++;
+		b->stats.n_upcalls++;
+	}
+	spin_unlock(&b->lock);
+
+	if (flush)
+		upcall_batch_send(b, flush, flush_portid, flush_count);
+
+	if (!aligned)
+		return genlmsg_unicast(ovs_dp_get_net(dp), user_skb, portid);
+
+	return 0;
+}
+
 static void pad_packet(struct datapath *dp, struct sk_buff *skb)
 {
 	if (!(dp->user_features & OVS_DP_F_UNALIGNED)) {
@@ -578,7 +700,7 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 
 	((struct nlmsghdr *) user_skb->data)->nlmsg_len = user_skb->len;
 
-	err = genlmsg_unicast(ovs_dp_get_net(dp), user_skb, upcall_info->portid);
+	err = ovs_dp_upcall_unicast(dp, user_skb, upcall_info->portid);
 	user_skb = NULL;
 out:
 	if (err)
@@ -1558,10 +1680,38 @@ static size_t ovs_dp_cmd_msg_size(void)
 	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_USER_FEATURES */
 	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_MASKS_CACHE_SIZE */
 	msgsize += nla_total_size(sizeof(u32) * nr_cpu_ids); /* OVS_DP_ATTR_PER_CPU_PIDS */
+	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_UPCALL_BATCH_SIZE */
+	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_UPCALL_BATCH_USECS */
+	/* OVS_DP_ATTR_UPCALL_BATCH_STATS */
+	msgsize += nla_total_size_64bit(sizeof(struct ovs_dp_upcall_batch_stats));
 
 	return msgsize;
 }
 
+static int ovs_dp_put_upcall_batch_stats(struct datapath *dp,
+					 struct sk_buff *skb)
+{
+	struct ovs_dp_upcall_batch_stats stats = {};
+	int i;
+
+	/* A per-CPU array would not fit in an attribute on big systems */
+	for_each_possible_cpu(i) {
+		struct dp_upcall_batch *b = per_cpu_ptr(dp->upcall_batch, i);
+
+		spin_lock_bh(&b->lock);
+		stats.n_batches += b->stats.n_batches;
+		stats.n_upcalls += b->stats.n_upcalls;
+		stats.n_lost += b->stats.n_lost;
+		stats.wait_ns += b->stats.wait_ns;
+		stats.max_wait_ns = max(stats.max_wait_ns,
+					b->stats.max_wait_ns);
+		spin_unlock_bh(&b->lock);
+	}
+
+	return nla_put_64bit(skb, OVS_DP_ATTR_UPCALL_BATCH_STATS,
+			     sizeof(stats), &stats, OVS_DP_ATTR_PAD);
+}
+
 /* Called with ovs_mutex. */
 static int ovs_dp_cmd_fill_info(struct datapath *dp, struct sk_buff *skb,
 				u32 portid, u32 seq, u32 flags, u8 cmd)
@@ -1606,6 +1756,15 @@ static int ovs_dp_cmd_fill_info(struct datapath *dp, struct sk_buff *skb,
 			goto nla_put_failure;
 	}
 
+	if (nla_put_u32(skb, OVS_DP_ATTR_UPCALL_BATCH_SIZE,
+			dp->upcall_batch_size) ||
+	    nla_put_u32(skb, OVS_DP_ATTR_UPCALL_BATCH_USECS,
+			dp->upcall_batch_usecs))
+		goto nla_put_failure;
+
+	if (ovs_dp_put_upcall_batch_stats(dp, skb))
+		goto nla_put_failure;
+
 	genlmsg_end(skb, ovs_header);
 	return 0;
 
@@ -1735,6 +1894,14 @@ static int ovs_dp_change(struct datapath *dp, struct nlattr *a[])
 			return err;
 	}
 
+	if (a[OVS_DP_ATTR_UPCALL_BATCH_USECS])
+		WRITE_ONCE(dp->upcall_batch_usecs,
+			   nla_get_u32(a[OVS_DP_ATTR_UPCALL_BATCH_USECS]));
+
+	if (a[OVS_DP_ATTR_UPCALL_BATCH_SIZE])
+		WRITE_ONCE(dp->upcall_batch_size,
+			   nla_get_u32(a[OVS_DP_ATTR_UPCALL_BATCH_SIZE]));
+
 	dp->user_features = user_features;
 
 	if (dp->user_features & OVS_DP_F_DISPATCH_UPCALL_PER_CPU &&
@@ -1765,6 +1932,42 @@ static int ovs_dp_stats_init(struct datapath *dp)
 	return 0;
 }
 
+static int ovs_dp_upcall_batch_init(struct datapath *dp)
+{
+	int i;
+
+	dp->upcall_batch = alloc_percpu(struct dp_upcall_batch);
+	if (!dp->upcall_batch)
+		return -ENOMEM;
+
+	for_each_possible_cpu(i) {
+		struct dp_upcall_batch *b = per_cpu_ptr(dp->upcall_batch, i);
+
+		spin_lock_init(&b->lock);
+		hrtimer_init(&b->timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL_PINNED_SOFT);
+		b->timer.function = upcall_batch_timer;
+		b->dp = dp;
+	}
+	dp->upcall_batch_usecs = OVS_DP_UPCALL_BATCH_DEFAULT_USECS;
+
+	return 0;
+}
+
+/* Upcalls can no longer be queued, drop whatever is still batched. */
+static void ovs_dp_upcall_batch_exit(struct datapath *dp)
+{
+	int i;
+
+	for_each_possible_cpu(i) {
+		struct dp_upcall_batch *b = per_cpu_ptr(dp->upcall_batch, i);
+
+		hrtimer_cancel(&b->timer);
+		kfree_skb(b->head);
+	}
+	free_percpu(dp->upcall_batch);
+}
+
 static int ovs_dp_vport_init(struct datapath *dp)
 {
 	int i;
@@ -1815,10 +2018,14 @@ static int ovs_dp_cmd_new(struct sk_buff *skb, struct genl_info *info)
 	if (err)
 		goto err_destroy_table;
 
-	err = ovs_dp_vport_init(dp);
+	err = ovs_dp_upcall_batch_init(dp);
 	if (err)
 		goto err_destroy_stats;
 
+	err = ovs_dp_vport_init(dp);
+	if (err)
+		goto err_destroy_batch;
+
 	err = ovs_meters_init(dp);
 	if (err)
 		goto err_destroy_ports;
@@ -1885,6 +2092,8 @@ static int ovs_dp_cmd_new(struct sk_buff *skb, struct genl_info *info)
 	ovs_meters_exit(dp);
 err_destroy_ports:
 	kfree(dp->ports);
+err_destroy_batch:
+	ovs_dp_upcall_batch_exit(dp);
 err_destroy_stats:
 	free_percpu(dp->stats_percpu);
 err_destroy_table:
@@ -2060,6 +2269,10 @@ static const struct nla_policy datapath_policy[OVS_DP_ATTR_MAX + 1] = {
 	[OVS_DP_ATTR_MASKS_CACHE_SIZE] =  NLA_POLICY_RANGE(NLA_U32, 0,
 		PCPU_MIN_UNIT_SIZE / sizeof(struct mask_cache_entry)),
 	[OVS_DP_ATTR_IFINDEX] = {.type = NLA_U32 },
+	[OVS_DP_ATTR_UPCALL_BATCH_SIZE] = NLA_POLICY_RANGE(NLA_U32, 0,
+		OVS_DP_UPCALL_BATCH_MAX_SIZE),
+	[OVS_DP_ATTR_UPCALL_BATCH_USECS] = NLA_POLICY_RANGE(NLA_U32, 1,
+		USEC_PER_SEC),
 };
 
 static const struct genl_small_ops dp_datapath_genl_ops[] = {
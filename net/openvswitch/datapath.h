@@ -65,6 +65,33 @@ struct dp_nlsk_pids {
 	u32 pids[];
 };
 
+#define OVS_DP_UPCALL_BATCH_MAX_SIZE		(1 << 20)
+#define OVS_DP_UPCALL_BATCH_DEFAULT_USECS	100
+
+/**
+ * struct dp_upcall_batch - per-CPU queue of upcall messages.
+ * @lock: Protects the queue against the flush timer and datapath teardown.
+ * @timer: Sends the batch once it has been queued for the batching delay.
+ * @dp: Datapath owning the queue.
+ * @head: First upcall message; later ones are chained on its frag_list.
+ * @tail: Last message on @head's frag_list, or %NULL.
+ * @portid: Netlink port all queued messages are destined to.
+ * @count: Number of messages queued.
+ * @first_ns: Time the first message was queued.
+ * @stats: Batching statistics reported in %OVS_DP_ATTR_UPCALL_BATCH_STATS.
+ */
+struct dp_upcall_batch {
+	spinlock_t lock;
+	struct hrtimer timer;
+	struct datapath *dp;
+	struct sk_buff *head;
+	struct sk_buff *tail;
+	u32 portid;
+	u32 count;
+	u64 first_ns;
+	struct ovs_dp_upcall_batch_stats stats;
+};
+
 /**
  * struct datapath - datapath for flow-based packet switching
  * @rcu: RCU callback head for deferred destruction.
@@ -77,6 +104,9 @@ struct dp_nlsk_pids {
  * @max_headroom: the maximum headroom of all vports in this datapath; it will
  * be used by all the internal vports in this dp.
  * @upcall_portids: RCU protected 'struct dp_nlsk_pids'.
+ * @upcall_batch: Per-CPU upcall batching queues.
+ * @upcall_batch_size: Byte limit of an upcall batch, 0 if batching is off.
+ * @upcall_batch_usecs: Maximum time an upcall waits in a batch.
  *
  * Context: See the comment on locking at the top of datapath.c for additional
  * locking information.
@@ -105,6 +135,10 @@ struct datapath {
 	struct dp_meter_table meter_tbl;
 
 	struct dp_nlsk_pids __rcu *upcall_portids;
+
+	struct dp_upcall_batch __percpu *upcall_batch;
+	u32 upcall_batch_size;
+	u32 upcall_batch_usecs;
 };
 
 /**
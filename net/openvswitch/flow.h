@@ -180,10 +180,17 @@ struct sw_flow_key_range {
 	unsigned short int end;
 };
 
+#define SW_FLOW_MASK_BLOOM_BITS	512
+
 struct sw_flow_mask {
 	int ref_count;
 	struct rcu_head rcu;
 	struct sw_flow_key_range range;
+	/* Bloom filter over the masked key hashes of all flows ever inserted
+	 * with this mask.  Bits are never cleared, so the filter only yields
+	 * false positives and lets a lookup skip masks that cannot match.
+	 */
+	DECLARE_BITMAP(bloom, SW_FLOW_MASK_BLOOM_BITS);
 	struct sw_flow_key key;
 };
 
@@ -655,6 +655,18 @@ static u32 flow_hash(const struct sw_flow_key *key,
 	return jhash2(hash_key, hash_u32s, 0);
 }
 
+static void mask_bloom_add(struct sw_flow_mask *mask, u32 hash)
+{
+	set_bit(hash % SW_FLOW_MASK_BLOOM_BITS, mask->bloom);
+	set_bit((hash >> 16) % SW_FLOW_MASK_BLOOM_BITS, mask->bloom);
+}
+
+static bool mask_bloom_test(const struct sw_flow_mask *mask, u32 hash)
+{
+	return test_bit(hash % SW_FLOW_MASK_BLOOM_BITS, mask->bloom) &&
+	       test_bit((hash >> 16) % SW_FLOW_MASK_BLOOM_BITS, mask->bloom);
+}
+
 static int flow_key_start(const struct sw_flow_key *key)
 {
 	if (key->tun_proto)
@@ -709,9 +721,14 @@ static struct sw_flow *masked_flow_lookup(struct table_instance *ti,
 
 	ovs_flow_mask_key(&masked_key, unmasked, false, mask);
 	hash = flow_hash(&masked_key, &mask->range);
-	head = find_bucket(ti, hash);
 	(*n_mask_hit)++;
 
+	/* No flow with this mask hashes here, skip the bucket walk. */
+	if (!mask_bloom_test(mask, hash))
+		return NULL;
+
+	head = find_bucket(ti, hash);
+
 	hlist_for_each_entry_rcu(flow, head, flow_table.node[ti->node_ver],
 				 lockdep_ovsl_is_held()) {
 		if (flow->mask == mask && flow->flow_table.hash == hash &&
@@ -969,8 +986,10 @@ static struct sw_flow_mask *mask_alloc(void)
 	struct sw_flow_mask *mask;
 
 	mask = kmalloc(sizeof(*mask), GFP_KERNEL);
-	if (mask)
+	if (mask) {
 		mask->ref_count = 1;
+		bitmap_zero(mask->bloom, SW_FLOW_MASK_BLOOM_BITS);
+	}
 
 	return mask;
 }
@@ -1040,6 +1059,8 @@ static void flow_key_insert(struct flow_table *table, struct sw_flow *flow)
 	struct table_instance *ti;
 
 	flow->flow_table.hash = flow_hash(&flow->key, &flow->mask->range);
+	/* Publish the bloom bits before the flow becomes visible. */
+	mask_bloom_add(flow->mask, flow->flow_table.hash);
 	ti = ovsl_dereference(table->ti);
 	table_instance_insert(ti, flow);
 	table->count++;
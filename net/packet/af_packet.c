@@ -542,9 +542,25 @@ static void prb_del_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 }
 
 static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
-		struct sk_buff_head *rb_queue)
+		struct sk_buff_head *rb_queue,
+		struct tpacket_kbdq_core __percpu *prb_cpu)
 {
 	struct tpacket_kbdq_core *pkc;
+	int cpu;
+
+	if (prb_cpu) {
+		for_each_possible_cpu(cpu) {
+			pkc = per_cpu_ptr(prb_cpu, cpu);
+
+			spin_lock_bh(pkc->blk_lock);
+			pkc->delete_blk_timer = 1;
+			spin_unlock_bh(pkc->blk_lock);
+
+			prb_del_retire_blk_timer(pkc);
+		}
+		free_percpu(prb_cpu);
+		return;
+	}
 
 	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 
@@ -555,11 +571,8 @@ static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
 	prb_del_retire_blk_timer(pkc);
 }
 
-static void prb_setup_retire_blk_timer(struct packet_sock *po)
+static void prb_setup_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	struct tpacket_kbdq_core *pkc;
-
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	timer_setup(&pkc->retire_blk_timer, prb_retire_rx_blk_timer_expired,
 		    0);
 	pkc->retire_blk_timer.expires = jiffies;
@@ -608,12 +621,12 @@ static void prb_init_ft_ops(struct tpacket_kbdq_core *p1,
 	p1->feature_req_word = req_u->req3.tp_feature_req_word;
 }
 
-static void init_prb_bdqc(struct packet_sock *po,
-			struct packet_ring_buffer *rb,
-			struct pgv *pg_vec,
-			union tpacket_req_u *req_u)
+static void prb_init_core(struct packet_sock *po,
+			struct tpacket_kbdq_core *p1,
+			struct pgv *pg_vec, unsigned int nr_blocks,
+			union tpacket_req_u *req_u,
+			unsigned short retire_blk_tov, bool per_cpu)
 {
-	struct tpacket_kbdq_core *p1 = GET_PBDQC_FROM_RB(rb);
 	struct tpacket_block_desc *pbd;
 
 	memset(p1, 0x0, sizeof(*p1));
@@ -623,26 +636,70 @@ static void init_prb_bdqc(struct packet_sock *po,
 	pbd = (struct tpacket_block_desc *)pg_vec[0].buffer;
 	p1->pkblk_start	= pg_vec[0].buffer;
 	p1->kblk_size = req_u->req3.tp_block_size;
-	p1->knum_blocks	= req_u->req3.tp_block_nr;
+	p1->knum_blocks	= nr_blocks;
 	p1->hdrlen = po->tp_hdrlen;
 	p1->version = po->tp_version;
 	p1->last_kactive_blk_num = 0;
-	po->stats.stats3.tp_freeze_q_cnt = 0;
-	if (req_u->req3.tp_retire_blk_tov)
-		p1->retire_blk_tov = req_u->req3.tp_retire_blk_tov;
-	else
-		p1->retire_blk_tov = prb_calc_retire_blk_tmo(po,
-						req_u->req3.tp_block_size);
+	p1->retire_blk_tov = retire_blk_tov;
 	p1->tov_in_jiffies = msecs_to_jiffies(p1->retire_blk_tov);
 	p1->blk_sizeof_priv = req_u->req3.tp_sizeof_priv;
 	rwlock_init(&p1->blk_fill_in_prog_lock);
 
+	p1->po = po;
+	if (per_cpu) {
+		spin_lock_init(&p1->cpu_lock);
+		p1->blk_lock = &p1->cpu_lock;
+		p1->stats = &p1->cpu_stats;
+	} else {
+		p1->blk_lock = &po->sk.sk_receive_queue.lock;
+		p1->stats = &po->stats.stats3;
+	}
+
 	p1->max_frame_len = p1->kblk_size - BLK_PLUS_PRIV(p1->blk_sizeof_priv);
 	prb_init_ft_ops(p1, req_u);
-	prb_setup_retire_blk_timer(po);
+	prb_setup_retire_blk_timer(p1);
 	prb_open_block(p1, pbd);
 }
 
+static int init_prb_bdqc(struct packet_sock *po,
+			struct packet_ring_buffer *rb,
+			struct pgv *pg_vec,
+			union tpacket_req_u *req_u,
+			struct tpacket_kbdq_core __percpu **prb_cpu)
+{
+	unsigned int nr_blocks = req_u->req3.tp_block_nr;
+	unsigned short retire_blk_tov;
+	int cpu;
+
+	po->stats.stats3.tp_freeze_q_cnt = 0;
+	if (req_u->req3.tp_retire_blk_tov)
+		retire_blk_tov = req_u->req3.tp_retire_blk_tov;
+	else
+		retire_blk_tov = prb_calc_retire_blk_tmo(po,
+						req_u->req3.tp_block_size);
+
+	if (!(req_u->req3.tp_feature_req_word & TP_FT_REQ_PER_CPU)) {
+		prb_init_core(po, GET_PBDQC_FROM_RB(rb), pg_vec, nr_blocks,
+			      req_u, retire_blk_tov, false);
+		return 0;
+	}
+
+	/* CPU n fills the n-th slice of the blocks, under its own lock */
+	if (nr_blocks % nr_cpu_ids)
+		return -EINVAL;
+	nr_blocks /= nr_cpu_ids;
+
+	*prb_cpu = alloc_percpu(struct tpacket_kbdq_core);
+	if (!*prb_cpu)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		prb_init_core(po, per_cpu_ptr(*prb_cpu, cpu),
+			      pg_vec + cpu * nr_blocks, nr_blocks, req_u,
+			      retire_blk_tov, true);
+	return 0;
+}
+
 /*  Do NOT update the last_blk_num first.
  *  Assumes sk_buff_head lock is held.
  */
@@ -678,13 +735,12 @@ static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
  */
 static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 {
-	struct packet_sock *po =
-		from_timer(po, t, rx_ring.prb_bdqc.retire_blk_timer);
-	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	struct tpacket_kbdq_core *pkc = from_timer(pkc, t, retire_blk_timer);
+	struct packet_sock *po = pkc->po;
 	unsigned int frozen;
 	struct tpacket_block_desc *pbd;
 
-	spin_lock(&po->sk.sk_receive_queue.lock);
+	spin_lock(pkc->blk_lock);
 
 	frozen = prb_queue_frozen(pkc);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
@@ -746,7 +802,7 @@ static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 	_prb_refresh_rx_retire_blk_timer(pkc);
 
 out:
-	spin_unlock(&po->sk.sk_receive_queue.lock);
+	spin_unlock(pkc->blk_lock);
 }
 
 static void prb_flush_block(struct tpacket_kbdq_core *pkc1,
@@ -910,7 +966,7 @@ static void prb_freeze_queue(struct tpacket_kbdq_core *pkc,
 				  struct packet_sock *po)
 {
 	pkc->reset_pending_on_curr_blk = 1;
-	po->stats.stats3.tp_freeze_q_cnt++;
+	pkc->stats->tp_freeze_q_cnt++;
 }
 
 #define TOTAL_PKT_LEN_INCL_ALIGN(length) (ALIGN((length), V3_ALIGNMENT))
@@ -982,11 +1038,9 @@ static int prb_queue_frozen(struct tpacket_kbdq_core *pkc)
 	return pkc->reset_pending_on_curr_blk;
 }
 
-static void prb_clear_blk_fill_status(struct packet_ring_buffer *rb)
+static void prb_clear_blk_fill_status(struct tpacket_kbdq_core *pkc)
 	__releases(&pkc->blk_fill_in_prog_lock)
 {
-	struct tpacket_kbdq_core *pkc  = GET_PBDQC_FROM_RB(rb);
-
 	read_unlock(&pkc->blk_fill_in_prog_lock);
 }
 
@@ -1046,17 +1100,16 @@ static void prb_fill_curr_block(char *curr,
 	prb_run_all_ft_ops(pkc, ppd);
 }
 
-/* Assumes caller has the sk->rx_queue.lock */
+/* Assumes caller has the pkc->blk_lock */
 static void *__packet_lookup_frame_in_block(struct packet_sock *po,
+					    struct tpacket_kbdq_core *pkc,
 					    struct sk_buff *skb,
 					    unsigned int len
 					    )
 {
-	struct tpacket_kbdq_core *pkc;
 	struct tpacket_block_desc *pbd;
 	char *curr, *end;
 
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
 
 	/* Queue is frozen when user space is lagging behind */
@@ -1109,6 +1162,7 @@ static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 }
 
 static void *packet_current_rx_frame(struct packet_sock *po,
+					    struct tpacket_kbdq_core *pkc,
 					    struct sk_buff *skb,
 					    int status, unsigned int len)
 {
@@ -1120,7 +1174,7 @@ static void *packet_current_rx_frame(struct packet_sock *po,
 					po->rx_ring.head, status);
 		return curr;
 	case TPACKET_V3:
-		return __packet_lookup_frame_in_block(po, skb, len);
+		return __packet_lookup_frame_in_block(po, pkc, skb, len);
 	default:
 		WARN(1, "TPACKET version not supported\n");
 		BUG();
@@ -1128,12 +1182,21 @@ static void *packet_current_rx_frame(struct packet_sock *po,
 	}
 }
 
-static void *prb_lookup_block(const struct packet_sock *po,
-			      const struct packet_ring_buffer *rb,
+/* The block ring tpacket_rcv() fills on this CPU */
+static struct tpacket_kbdq_core *prb_rx_core(const struct packet_sock *po)
+{
+	struct tpacket_kbdq_core __percpu *prb_cpu;
+
+	prb_cpu = READ_ONCE(po->rx_ring.prb_cpu);
+	if (prb_cpu)
+		return raw_cpu_ptr(prb_cpu);
+	return GET_PBDQC_FROM_RB(&po->rx_ring);
+}
+
+static void *prb_lookup_block(const struct tpacket_kbdq_core *pkc,
 			      unsigned int idx,
 			      int status)
 {
-	struct tpacket_kbdq_core *pkc  = GET_PBDQC_FROM_RB(rb);
 	struct tpacket_block_desc *pbd = GET_PBLOCK_DESC(pkc, idx);
 
 	if (status != BLOCK_STATUS(pbd))
@@ -1141,13 +1204,14 @@ static void *prb_lookup_block(const struct packet_sock *po,
 	return pbd;
 }
 
-static int prb_previous_blk_num(struct packet_ring_buffer *rb)
+static int prb_previous_blk_num(const struct tpacket_kbdq_core *pkc)
 {
-	unsigned int prev;
-	if (rb->prb_bdqc.kactive_blk_num)
-		prev = rb->prb_bdqc.kactive_blk_num-1;
+	unsigned int prev, active = READ_ONCE(pkc->kactive_blk_num);
+
+	if (active)
+		prev = active - 1;
 	else
-		prev = rb->prb_bdqc.knum_blocks-1;
+		prev = pkc->knum_blocks - 1;
 	return prev;
 }
 
@@ -1156,8 +1220,23 @@ static void *__prb_previous_block(struct packet_sock *po,
 					 struct packet_ring_buffer *rb,
 					 int status)
 {
-	unsigned int previous = prb_previous_blk_num(rb);
-	return prb_lookup_block(po, rb, previous, status);
+	struct tpacket_kbdq_core *pkc;
+	void *pbd = NULL;
+	int cpu;
+
+	if (!rb->prb_cpu) {
+		pkc = GET_PBDQC_FROM_RB(rb);
+		return prb_lookup_block(pkc, prb_previous_blk_num(pkc), status);
+	}
+
+	/* Any of the rings having closed a block is enough */
+	for_each_possible_cpu(cpu) {
+		pkc = per_cpu_ptr(rb->prb_cpu, cpu);
+		pbd = prb_lookup_block(pkc, prb_previous_blk_num(pkc), status);
+		if (!pbd)
+			break;
+	}
+	return pbd;
 }
 
 static void *packet_previous_rx_frame(struct packet_sock *po,
@@ -1259,15 +1338,16 @@ static bool __tpacket_has_room(const struct packet_sock *po, int pow_off)
 
 static bool __tpacket_v3_has_room(const struct packet_sock *po, int pow_off)
 {
+	struct tpacket_kbdq_core *pkc = prb_rx_core(po);
 	int idx, len;
 
-	len = READ_ONCE(po->rx_ring.prb_bdqc.knum_blocks);
-	idx = READ_ONCE(po->rx_ring.prb_bdqc.kactive_blk_num);
+	len = READ_ONCE(pkc->knum_blocks);
+	idx = READ_ONCE(pkc->kactive_blk_num);
 	if (pow_off)
 		idx += len >> pow_off;
 	if (idx >= len)
 		idx -= len;
-	return prb_lookup_block(po, &po->rx_ring, idx, TP_STATUS_KERNEL);
+	return prb_lookup_block(pkc, idx, TP_STATUS_KERNEL);
 }
 
 static int __packet_rcv_has_room(const struct packet_sock *po,
@@ -2248,6 +2328,8 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	unsigned short macoff, hdrlen;
 	unsigned int netoff;
 	struct sk_buff *copy_skb = NULL;
+	struct tpacket_kbdq_core *pkc = NULL;
+	spinlock_t *lock;
 	struct timespec64 ts;
 	__u32 ts_status;
 	bool is_drop_n_account = false;
@@ -2340,22 +2422,25 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 				do_vnet = false;
 			}
 		}
-	} else if (unlikely(macoff + snaplen >
-			    GET_PBDQC_FROM_RB(&po->rx_ring)->max_frame_len)) {
-		u32 nval;
-
-		nval = GET_PBDQC_FROM_RB(&po->rx_ring)->max_frame_len - macoff;
-		pr_err_once("tpacket_rcv: packet too big, clamped from %u to %u. macoff=%u\n",
-			    snaplen, nval, macoff);
-		snaplen = nval;
-		if (unlikely((int)snaplen < 0)) {
-			snaplen = 0;
-			macoff = GET_PBDQC_FROM_RB(&po->rx_ring)->max_frame_len;
-			do_vnet = false;
+	} else {
+		pkc = prb_rx_core(po);
+		if (unlikely(macoff + snaplen > pkc->max_frame_len)) {
+			u32 nval;
+
+			nval = pkc->max_frame_len - macoff;
+			pr_err_once("tpacket_rcv: packet too big, clamped from %u to %u. macoff=%u\n",
+				    snaplen, nval, macoff);
+			snaplen = nval;
+			if (unlikely((int)snaplen < 0)) {
+				snaplen = 0;
+				macoff = pkc->max_frame_len;
+				do_vnet = false;
+			}
 		}
 	}
-	spin_lock(&sk->sk_receive_queue.lock);
-	h.raw = packet_current_rx_frame(po, skb,
+	lock = pkc ? pkc->blk_lock : &sk->sk_receive_queue.lock;
+	spin_lock(lock);
+	h.raw = packet_current_rx_frame(po, pkc, skb,
 					TP_STATUS_KERNEL, (macoff+snaplen));
 	if (!h.raw)
 		goto drop_n_account;
@@ -2372,7 +2457,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 				    sizeof(struct virtio_net_hdr),
 				    vio_le(), true, 0)) {
 		if (po->tp_version == TPACKET_V3)
-			prb_clear_blk_fill_status(&po->rx_ring);
+			prb_clear_blk_fill_status(pkc);
 		goto drop_n_account;
 	}
 
@@ -2388,13 +2473,16 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			status |= TP_STATUS_LOSING;
 	}
 
-	po->stats.stats1.tp_packets++;
+	if (pkc)
+		pkc->stats->tp_packets++;
+	else
+		po->stats.stats1.tp_packets++;
 	if (copy_skb) {
 		status |= TP_STATUS_COPY;
 		skb_clear_delivery_time(copy_skb);
 		__skb_queue_tail(&sk->sk_receive_queue, copy_skb);
 	}
-	spin_unlock(&sk->sk_receive_queue.lock);
+	spin_unlock(lock);
 
 	skb_copy_bits(skb, 0, h.raw + macoff, snaplen);
 
@@ -2487,7 +2575,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		spin_unlock(&sk->sk_receive_queue.lock);
 		sk->sk_data_ready(sk);
 	} else if (po->tp_version == TPACKET_V3) {
-		prb_clear_blk_fill_status(&po->rx_ring);
+		prb_clear_blk_fill_status(pkc);
 	}
 
 drop_n_restore:
@@ -2503,7 +2591,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	return 0;
 
 drop_n_account:
-	spin_unlock(&sk->sk_receive_queue.lock);
+	spin_unlock(lock);
 	atomic_inc(&po->tp_drops);
 	is_drop_n_account = true;
 
@@ -4015,6 +4103,31 @@ packet_setsockopt(struct socket *sock, int level, int optname, sockptr_t optval,
 	}
 }
 
+/* Take and clear the counts of the per CPU rings */
+static void prb_fold_cpu_stats(struct packet_sock *po,
+			       struct tpacket_stats_v3 *st)
+{
+	struct tpacket_kbdq_core *pkc;
+	int cpu;
+
+	/* Keeps packet_set_ring() from freeing the rings */
+	mutex_lock(&po->pg_vec_lock);
+	if (!po->rx_ring.prb_cpu)
+		goto out;
+
+	for_each_possible_cpu(cpu) {
+		pkc = per_cpu_ptr(po->rx_ring.prb_cpu, cpu);
+
+		spin_lock_bh(pkc->blk_lock);
+		st->tp_packets += pkc->cpu_stats.tp_packets;
+		st->tp_freeze_q_cnt += pkc->cpu_stats.tp_freeze_q_cnt;
+		memset(&pkc->cpu_stats, 0, sizeof(pkc->cpu_stats));
+		spin_unlock_bh(pkc->blk_lock);
+	}
+out:
+	mutex_unlock(&po->pg_vec_lock);
+}
+
 static int packet_getsockopt(struct socket *sock, int level, int optname,
 			     char __user *optval, int __user *optlen)
 {
@@ -4045,6 +4158,7 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 		drops = atomic_xchg(&po->tp_drops, 0);
 
 		if (po->tp_version == TPACKET_V3) {
+			prb_fold_cpu_stats(po, &st.stats3);
 			lv = sizeof(struct tpacket_stats_v3);
 			st.stats3.tp_drops = drops;
 			st.stats3.tp_packets += drops;
@@ -4363,6 +4477,7 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 {
 	struct pgv *pg_vec = NULL;
 	struct packet_sock *po = pkt_sk(sk);
+	struct tpacket_kbdq_core __percpu *prb_cpu = NULL;
 	unsigned long *rx_owner_map = NULL;
 	int was_running, order = 0;
 	struct packet_ring_buffer *rb;
@@ -4436,7 +4551,10 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		case TPACKET_V3:
 			/* Block transmit is not supported yet */
 			if (!tx_ring) {
-				init_prb_bdqc(po, rb, pg_vec, req_u);
+				err = init_prb_bdqc(po, rb, pg_vec, req_u,
+						    &prb_cpu);
+				if (err)
+					goto out_free_pg_vec;
 			} else {
 				struct tpacket_req3 *req3 = &req_u->req3;
 
@@ -4486,6 +4604,8 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		swap(rb->pg_vec, pg_vec);
 		if (po->tp_version <= TPACKET_V2)
 			swap(rb->rx_owner_map, rx_owner_map);
+		else if (!tx_ring)
+			swap(rb->prb_cpu, prb_cpu);
 		rb->frame_max = (req->tp_frame_nr - 1);
 		rb->head = 0;
 		rb->frame_size = req->tp_frame_size;
@@ -4513,7 +4633,7 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 	if (pg_vec && (po->tp_version > TPACKET_V2)) {
 		/* Because we don't support block-based V3 on tx-ring */
 		if (!tx_ring)
-			prb_shutdown_retire_blk_timer(po, rb_queue);
+			prb_shutdown_retire_blk_timer(po, rb_queue, prb_cpu);
 	}
 
 out_free_pg_vec:
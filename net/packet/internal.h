@@ -50,6 +50,16 @@ struct tpacket_kbdq_core {
 
 	/* timer to retire an outstanding block */
 	struct timer_list retire_blk_timer;
+
+	/* blk_lock serializes the filling: the receive queue lock, or
+	 * cpu_lock for the per CPU rings of a TP_FT_REQ_PER_CPU socket,
+	 * which count their packets in cpu_stats.
+	 */
+	spinlock_t	*blk_lock;
+	spinlock_t	cpu_lock;
+	struct tpacket_stats_v3	*stats;
+	struct tpacket_stats_v3	cpu_stats;
+	struct packet_sock	*po;
 };
 
 struct pgv {
@@ -70,6 +80,9 @@ struct packet_ring_buffer {
 
 	unsigned int __percpu	*pending_refcnt;
 
+	/* V3 rx ring split in one block ring per possible CPU */
+	struct tpacket_kbdq_core __percpu	*prb_cpu;
+
 	union {
 		unsigned long			*rx_owner_map;
 		struct tpacket_kbdq_core	prb_bdqc;
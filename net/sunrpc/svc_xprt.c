@@ -439,6 +439,52 @@ static bool svc_xprt_ready(struct svc_xprt *xprt)
 	return false;
 }
 
+/*
+ * Take the last thread that went idle off the list, or return NULL.  The
+ * list is pushed to locklessly by the threads, pops are serialized by
+ * sp_lock.  The caller holds rcu_read_lock() to wake the thread up.
+ */
+static struct svc_rqst *__svc_pool_pop_idle(struct svc_pool *pool)
+{
+	struct llist_node *ln;
+	struct svc_rqst *rqstp;
+
+	ln = llist_del_first(&pool->sp_idle_threads);
+	if (!ln)
+		return NULL;
+	rqstp = llist_entry(ln, struct svc_rqst, rq_idle);
+	svc_thread_set_busy(rqstp);
+	return rqstp;
+}
+
+static struct svc_rqst *svc_pool_pop_idle(struct svc_pool *pool)
+{
+	struct svc_rqst *rqstp;
+
+	spin_lock_bh(&pool->sp_lock);
+	rqstp = __svc_pool_pop_idle(pool);
+	spin_unlock_bh(&pool->sp_lock);
+	return rqstp;
+}
+
+/*
+ * Only the head of the idle list can come off it, so a thread that wakes
+ * up by itself (timeout, signal, spurious wakeup) pops the threads above it
+ * and wakes them up, until it is off.
+ */
+static void svc_thread_unidle(struct svc_rqst *rqstp)
+{
+	struct svc_rqst *other;
+
+	rcu_read_lock();
+	while (!svc_thread_busy(rqstp)) {
+		other = svc_pool_pop_idle(rqstp->rq_pool);
+		if (other && other != rqstp)
+			wake_up_process(other->rq_task);
+	}
+	rcu_read_unlock();
+}
+
 /**
  * svc_xprt_enqueue - Queue a transport on an idle nfsd thread
  * @xprt: transport with data pending
@@ -464,24 +510,23 @@ void svc_xprt_enqueue(struct svc_xprt *xprt)
 
 	atomic_long_inc(&pool->sp_stats.packets);
 
+	rcu_read_lock();
 	spin_lock_bh(&pool->sp_lock);
 	list_add_tail(&xprt->xpt_ready, &pool->sp_sockets);
 	pool->sp_stats.sockets_queued++;
+	/* Pairs with the llist_add() in svc_get_next_xprt() */
+	smp_mb();
+	/* find a thread for this xprt */
+	rqstp = __svc_pool_pop_idle(pool);
 	spin_unlock_bh(&pool->sp_lock);
 
-	/* find a thread for this xprt */
-	rcu_read_lock();
-	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
-		if (test_and_set_bit(RQ_BUSY, &rqstp->rq_flags))
-			continue;
+	if (rqstp) {
 		atomic_long_inc(&pool->sp_stats.threads_woken);
 		rqstp->rq_qtime = ktime_get();
 		wake_up_process(rqstp->rq_task);
-		goto out_unlock;
+	} else {
+		set_bit(SP_CONGESTED, &pool->sp_flags);
 	}
-	set_bit(SP_CONGESTED, &pool->sp_flags);
-	rqstp = NULL;
-out_unlock:
 	rcu_read_unlock();
 	trace_svc_xprt_enqueue(xprt, rqstp);
 }
@@ -580,13 +625,11 @@ void svc_wake_up(struct svc_serv *serv)
 	pool = &serv->sv_pools[0];
 
 	rcu_read_lock();
-	list_for_each_entry_rcu(rqstp, &pool->sp_all_threads, rq_all) {
-		/* skip any that aren't queued */
-		if (test_bit(RQ_BUSY, &rqstp->rq_flags))
-			continue;
-		rcu_read_unlock();
+	rqstp = svc_pool_pop_idle(pool);
+	if (rqstp) {
 		wake_up_process(rqstp->rq_task);
 		trace_svc_wake_up(rqstp->rq_task->pid);
+		rcu_read_unlock();
 		return;
 	}
 	rcu_read_unlock();
@@ -753,6 +796,7 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 	smp_mb__before_atomic();
 	clear_bit(SP_CONGESTED, &pool->sp_flags);
 	clear_bit(RQ_BUSY, &rqstp->rq_flags);
+	llist_add(&rqstp->rq_idle, &pool->sp_idle_threads);
 	smp_mb__after_atomic();
 
 	if (likely(rqst_should_sleep(rqstp)))
@@ -760,6 +804,7 @@ static struct svc_xprt *svc_get_next_xprt(struct svc_rqst *rqstp, long timeout)
 	else
 		__set_current_state(TASK_RUNNING);
 
+	svc_thread_unidle(rqstp);
 	try_to_freeze();
 
 	set_bit(RQ_BUSY, &rqstp->rq_flags);
@@ -150,13 +150,14 @@ static ssize_t rpc_sysfs_xprt_info_show(struct kobject *kobj,
 		       "max_num_slots=%u\nmin_num_slots=%u\nnum_reqs=%u\n"
 		       "binding_q_len=%u\nsending_q_len=%u\npending_q_len=%u\n"
 		       "backlog_q_len=%u\nmain_xprt=%d\nsrc_port=%u\n"
-		       "tasks_queuelen=%ld\ndst_port=%s\n",
+		       "tasks_queuelen=%ld\ndst_port=%s\nsrtt_us=%u\n",
 		       xprt->last_used, xprt->cong, xprt->cwnd, xprt->max_reqs,
 		       xprt->min_reqs, xprt->num_reqs, xprt->binding.qlen,
 		       xprt->sending.qlen, xprt->pending.qlen,
 		       xprt->backlog.qlen, xprt->main, srcport,
 		       atomic_long_read(&xprt->queuelen),
-		       xprt->address_strings[RPC_DISPLAY_PORT]);
+		       xprt->address_strings[RPC_DISPLAY_PORT],
+		       READ_ONCE(xprt->srtt_us));
 out:
 	xprt_put(xprt);
 	return ret;
@@ -1458,6 +1458,92 @@ __be32 * xdr_inline_decode(struct xdr_stream *xdr, size_t nbytes)
 }
 EXPORT_SYMBOL_GPL(xdr_inline_decode);
 
+/**
+ * xdr_stream_read_bytes - Copy XDR data out of the stream
+ * @xdr: pointer to xdr_stream struct
+ * @ptr: location to store the data, or NULL to skip it
+ * @len: number of bytes of data to decode
+ *
+ * Like xdr_inline_decode() followed by a memcpy(), but data spanning
+ * buffers is copied from each of them straight to @ptr, not through the
+ * scratch buffer, so it can be of any size.  The XDR padding after the
+ * data is skipped.
+ *
+ * Return values:
+ *   %0 on success
+ *   %-EBADMSG on XDR buffer overflow
+ */
+int xdr_stream_read_bytes(struct xdr_stream *xdr, void *ptr, size_t len)
+{
+	size_t nbytes = xdr_align_size(len), cplen;
+	__be32 *p;
+
+	if (unlikely(XDR_QUADLEN(len) > xdr->nwords))
+		goto out_overflow;
+	while (nbytes) {
+		if (xdr->p == xdr->end && !xdr_set_next_buffer(xdr))
+			goto out_overflow;
+		cplen = min_t(size_t, nbytes,
+			      (char *)xdr->end - (char *)xdr->p);
+		p = __xdr_inline_decode(xdr, cplen);
+		if (unlikely(!p))
+			goto out_overflow;
+		nbytes -= cplen;
+		cplen = min(cplen, len);
+		if (ptr) {
+			memcpy(ptr, p, cplen);
+			ptr += cplen;
+		}
+		len -= cplen;
+	}
+	return 0;
+out_overflow:
+	trace_rpc_xdr_overflow(xdr, len);
+	return -EBADMSG;
+}
+EXPORT_SYMBOL_GPL(xdr_stream_read_bytes);
+
+/**
+ * xdr_stream_decode_u32s - Decode a run of 32-bit integers
+ * @xdr: pointer to xdr_stream struct
+ * @array: location to store the integers
+ * @nstore: number of integers to store in @array
+ * @count: number of integers to decode, at least @nstore
+ *
+ * The integers are converted straight from the buffers of @xdr, with one
+ * bounds check per buffer rather than per integer, and without going
+ * through the scratch buffer when they span several buffers.
+ *
+ * Return values:
+ *   %0 on success
+ *   %-EBADMSG on XDR buffer overflow
+ */
+int xdr_stream_decode_u32s(struct xdr_stream *xdr, u32 *array,
+			   size_t nstore, size_t count)
+{
+	size_t n;
+	__be32 *p;
+
+	if (unlikely(count > xdr->nwords))
+		goto out_overflow;
+	while (count) {
+		if (xdr->p == xdr->end && !xdr_set_next_buffer(xdr))
+			goto out_overflow;
+		n = min_t(size_t, count, xdr->end - xdr->p);
+		p = __xdr_inline_decode(xdr, n << 2);
+		if (unlikely(!p))
+			goto out_overflow;
+		count -= n;
+		for (; n && nstore; n--, nstore--)
+			*array++ = be32_to_cpup(p++);
+	}
+	return 0;
+out_overflow:
+	trace_rpc_xdr_overflow(xdr, count << 2);
+	return -EBADMSG;
+}
+EXPORT_SYMBOL_GPL(xdr_stream_decode_u32s);
+
 static void xdr_realign_pages(struct xdr_stream *xdr)
 {
 	struct xdr_buf *buf = xdr->buf;
@@ -2173,14 +2259,18 @@ EXPORT_SYMBOL_GPL(xdr_process_buf);
  */
 ssize_t xdr_stream_decode_opaque(struct xdr_stream *xdr, void *ptr, size_t size)
 {
-	ssize_t ret;
-	void *p;
+	__u32 len;
 
-	ret = xdr_stream_decode_opaque_inline(xdr, &p, size);
-	if (ret <= 0)
-		return ret;
-	memcpy(ptr, p, ret);
-	return ret;
+	if (unlikely(xdr_stream_decode_u32(xdr, &len) < 0))
+		return -EBADMSG;
+	if (unlikely(len > size)) {
+		if (xdr_stream_read_bytes(xdr, NULL, len) < 0)
+			return -EBADMSG;
+		return -EMSGSIZE;
+	}
+	if (unlikely(xdr_stream_read_bytes(xdr, ptr, len) < 0))
+		return -EBADMSG;
+	return len;
 }
 EXPORT_SYMBOL_GPL(xdr_stream_decode_opaque);
 
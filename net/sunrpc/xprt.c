@@ -1053,6 +1053,16 @@ xprt_request_rb_remove(struct rpc_xprt *xprt, struct rpc_rqst *req)
 	rb_erase(&req->rq_recv, &xprt->recv_queue);
 }
 
+/* Average the reply times by 1/8, as TCP does for its RTT */
+static void xprt_update_srtt(struct rpc_xprt *xprt, s64 rtt_us)
+{
+	u32 srtt = xprt->srtt_us, sample = clamp_t(s64, rtt_us, 1, U32_MAX);
+
+	if (srtt)
+		sample = srtt - (srtt >> 3) + (sample >> 3);
+	WRITE_ONCE(xprt->srtt_us, sample);
+}
+
 /**
  * xprt_lookup_rqst - find an RPC request corresponding to an XID
  * @xprt: transport on which the original request was transmitted
@@ -1068,6 +1078,9 @@ struct rpc_rqst *xprt_lookup_rqst(struct rpc_xprt *xprt, __be32 xid)
 	if (entry != NULL) {
 		trace_xprt_lookup_rqst(xprt, xid, 0);
 		entry->rq_rtt = ktime_sub(ktime_get(), entry->rq_xtime);
+		/* A retransmitted request may be getting an earlier reply */
+		if (entry->rq_ntrans == 1)
+			xprt_update_srtt(xprt, ktime_to_us(entry->rq_rtt));
 		return entry;
 	}
 
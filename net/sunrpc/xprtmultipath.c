@@ -414,26 +414,56 @@ struct rpc_xprt *__xprt_switch_find_next_entry_roundrobin(struct list_head *head
 	return xprt_switch_find_first_entry(head);
 }
 
+/* Mean reply time of the active transports that have had a reply */
+static
+u32 xprt_switch_avg_srtt(struct list_head *head)
+{
+	struct rpc_xprt *pos;
+	unsigned int n = 0;
+	u64 sum = 0;
+	u32 srtt;
+
+	list_for_each_entry_rcu(pos, head, xprt_switch) {
+		srtt = READ_ONCE(pos->srtt_us);
+		if (!srtt || !xprt_is_active(pos))
+			continue;
+		sum += srtt;
+		n++;
+	}
+	return n ? div_u64(sum, n) : 0;
+}
+
 static
 struct rpc_xprt *xprt_switch_find_next_entry_roundrobin(struct rpc_xprt_switch *xps,
 		const struct rpc_xprt *cur)
 {
 	struct list_head *head = &xps->xps_xprt_list;
-	struct rpc_xprt *xprt;
+	struct rpc_xprt *xprt, *slow = NULL;
 	unsigned int nactive;
+	u32 avg_srtt;
 
+	avg_srtt = xprt_switch_avg_srtt(head);
 	for (;;) {
 		unsigned long xprt_queuelen, xps_queuelen;
 
 		xprt = __xprt_switch_find_next_entry_roundrobin(head, cur);
 		if (!xprt)
 			break;
+		/* Went round: all the short enough queues are slow */
+		if (xprt == slow)
+			break;
 		xprt_queuelen = atomic_long_read(&xprt->queuelen);
 		xps_queuelen = atomic_long_read(&xps->xps_queuelen);
 		nactive = READ_ONCE(xps->xps_nactive);
-		/* Exit loop if xprt_queuelen <= average queue length */
-		if (xprt_queuelen * nactive <= xps_queuelen)
-			break;
+		/* Exit loop if xprt_queuelen <= average queue length, and
+		 * the replies don't take twice longer than the average.
+		 */
+		if (xprt_queuelen * nactive <= xps_queuelen) {
+			if (READ_ONCE(xprt->srtt_us) / 2 <= avg_srtt)
+				break;
+			if (!slow)
+				slow = xprt;
+		}
 		cur = xprt;
 	}
 	return xprt;
@@ -813,10 +813,12 @@ inline int rpcrdma_prepare_send_sges(struct rpcrdma_xprt *r_xprt,
 	case rpcrdma_noch_pullup:
 		if (!rpcrdma_prepare_noch_pullup(r_xprt, req, xdr))
 			goto out_unmap;
+		r_xprt->rx_stats.pullup_call_count++;
 		break;
 	case rpcrdma_noch_mapped:
 		if (!rpcrdma_prepare_noch_mapped(r_xprt, req, xdr))
 			goto out_unmap;
+		r_xprt->rx_stats.mapped_call_count++;
 		break;
 	case rpcrdma_readch:
 		if (!rpcrdma_prepare_readch(r_xprt, req, xdr))
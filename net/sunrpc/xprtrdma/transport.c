@@ -707,13 +707,17 @@ void xprt_rdma_print_stats(struct rpc_xprt *xprt, struct seq_file *seq)
 		   r_xprt->rx_stats.failed_marshal_count,
 		   r_xprt->rx_stats.bad_reply_count,
 		   r_xprt->rx_stats.nomsg_call_count);
-	seq_printf(seq, "%lu %lu %lu %lu %lu %lu\n",
+	seq_printf(seq, "%lu %lu %lu %lu %lu %lu ",
 		   r_xprt->rx_stats.mrs_recycled,
 		   r_xprt->rx_stats.mrs_orphaned,
 		   r_xprt->rx_stats.mrs_allocated,
 		   r_xprt->rx_stats.local_inv_needed,
 		   r_xprt->rx_stats.empty_sendctx_q,
 		   r_xprt->rx_stats.reply_waits_for_send);
+	seq_printf(seq, "%lu %lu %lu\n",
+		   r_xprt->rx_stats.pullup_call_count,
+		   r_xprt->rx_stats.mapped_call_count,
+		   r_xprt->rx_stats.signaled_send_count);
 }
 
 static int
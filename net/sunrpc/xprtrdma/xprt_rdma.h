@@ -413,6 +413,11 @@ struct rpcrdma_stats {
 	unsigned long		local_inv_needed;
 	unsigned long		nomsg_call_count;
 	unsigned long		bcall_count;
+
+	/* how inline calls were sent, and how often a Send was signaled */
+	unsigned long		pullup_call_count;
+	unsigned long		mapped_call_count;
+	unsigned long		signaled_send_count;
 };
 
 /*
@@ -38,6 +38,7 @@
 #include <asm/byteorder.h>
 #include <linux/types.h>
 #include <linux/skmsg.h>
+#include <net/netns/generic.h>
 #include <net/tls.h>
 
 #define TLS_PAGE_ORDER	(min_t(unsigned int, PAGE_ALLOC_COSTLY_ORDER,	\
@@ -50,6 +51,39 @@
 #define TLS_DEC_STATS(net, field)				\
 	SNMP_DEC_STATS((net)->mib.tls_statistics, field)
 
+enum tls_hist_id {
+	TLS_HIST_TX_SW_BYTES,
+	TLS_HIST_RX_SW_BYTES,
+	TLS_HIST_TX_DEVICE_BYTES,
+	TLS_HIST_RX_DEVICE_BYTES,
+	TLS_HIST_ENCRYPT_NS,
+	TLS_HIST_DECRYPT_NS,
+	TLS_HIST_ASYNC_ENCRYPT_NS,
+	TLS_HIST_ASYNC_DECRYPT_NS,
+	TLS_HIST_MAX
+};
+
+/* Bucket 0 counts zeroes, bucket i values in [2^(i - 1), 2^i) */
+#define TLS_HIST_BUCKETS	32
+
+struct tls_hist {
+	u64 buckets[TLS_HIST_MAX][TLS_HIST_BUCKETS];
+};
+
+struct tls_net {
+	struct tls_hist __percpu *hist;
+};
+
+extern unsigned int tls_net_id;
+
+static inline void tls_hist_add(struct net *net, enum tls_hist_id id, u64 val)
+{
+	struct tls_net *tn = net_generic(net, tls_net_id);
+	u32 bucket = min_t(u32, fls64(val), TLS_HIST_BUCKETS - 1);
+
+	this_cpu_inc(tn->hist->buckets[id][bucket]);
+}
+
 /* TLS records are maintained in 'struct tls_rec'. It stores the memory pages
  * allocated or mapped for each TLS record. After encryption, the records are
  * stores in a linked list.
@@ -72,6 +106,7 @@ struct tls_rec {
 
 	char aad_space[TLS_AAD_SPACE_SIZE];
 	u8 iv_data[MAX_IV_SIZE];
+	u64 submit_ns;
 	struct aead_request aead_req;
 	u8 aead_req_ctx[];
 };
@@ -290,6 +290,9 @@ static int tls_push_record(struct sock *sk,
 	skb_frag_t *frag;
 	int i;
 
+	tls_hist_add(sock_net(sk), TLS_HIST_TX_DEVICE_BYTES,
+		     record->len - prot->overhead_size);
+
 	record->end_seq = tp->write_seq + record->len;
 	list_add_tail_rcu(&record->list, &offload_ctx->records_list);
 	offload_ctx->open_record = NULL;
@@ -37,6 +37,44 @@ static int tls_statistics_seq_show(struct seq_file *seq, void *v)
 
 	return 0;
 }
+
+static const char * const tls_hist_names[TLS_HIST_MAX] = {
+	[TLS_HIST_TX_SW_BYTES]		= "TlsTxSwRecordBytes",
+	[TLS_HIST_RX_SW_BYTES]		= "TlsRxSwRecordBytes",
+	[TLS_HIST_TX_DEVICE_BYTES]	= "TlsTxDeviceRecordBytes",
+	[TLS_HIST_RX_DEVICE_BYTES]	= "TlsRxDeviceRecordBytes",
+	[TLS_HIST_ENCRYPT_NS]		= "TlsEncryptNs",
+	[TLS_HIST_DECRYPT_NS]		= "TlsDecryptNs",
+	[TLS_HIST_ASYNC_ENCRYPT_NS]	= "TlsAsyncEncryptNs",
+	[TLS_HIST_ASYNC_DECRYPT_NS]	= "TlsAsyncDecryptNs",
+};
+
+/* One line per histogram. Column i counts values below 2^i that are not
+ * counted in column i - 1, the last column also counts everything above.
+ */
+static int tls_hist_seq_show(struct seq_file *seq, void *v)
+{
+	struct tls_net *tn = net_generic(seq->private, tls_net_id);
+	u64 sum[TLS_HIST_BUCKETS];
+	int cpu, id, i;
+
+	for (id = 0; id < TLS_HIST_MAX; id++) {
+		memset(sum, 0, sizeof(sum));
+		for_each_possible_cpu(cpu) {
+			struct tls_hist *hist = per_cpu_ptr(tn->hist, cpu);
+
+			for (i = 0; i < TLS_HIST_BUCKETS; i++)
+				sum[i] += READ_ONCE(hist->buckets[id][i]);
+		}
+
+		seq_printf(seq, "%-32s", tls_hist_names[id]);
+		for (i = 0; i < TLS_HIST_BUCKETS; i++)
+			seq_printf(seq, " %llu", sum[i]);
+		seq_putc(seq, '\n');
+	}
+
+	return 0;
+}
 #endif
 
 int __net_init tls_proc_init(struct net *net)
@@ -45,6 +83,12 @@ int __net_init tls_proc_init(struct net *net)
 	if (!proc_create_net_single("tls_stat", 0444, net->proc_net,
 				    tls_statistics_seq_show, NULL))
 		return -ENOMEM;
+
+	if (!proc_create_net_single("tls_hist", 0444, net->proc_net,
+				    tls_hist_seq_show, NULL)) {
+		remove_proc_entry("tls_stat", net->proc_net);
+		return -ENOMEM;
+	}
 #endif /* CONFIG_PROC_FS */
 
 	return 0;
@@ -52,5 +96,6 @@ int __net_init tls_proc_init(struct net *net)
 
 void __net_exit tls_proc_fini(struct net *net)
 {
+	remove_proc_entry("tls_hist", net->proc_net);
 	remove_proc_entry("tls_stat", net->proc_net);
 }
@@ -46,6 +46,11 @@
 
 #include "tls.h"
 
+static bool rx_parallel;
+module_param(rx_parallel, bool, 0644);
+MODULE_PARM_DESC(rx_parallel,
+		 "Spread software RX decryption of TLS 1.2 records over CPUs with pcrypt");
+
 struct tls_decrypt_arg {
 	struct_group(inargs,
 	bool zc;
@@ -60,6 +65,7 @@ struct tls_decrypt_ctx {
 	u8 iv[MAX_IV_SIZE];
 	u8 aad[TLS_MAX_AAD_SIZE];
 	u8 tail;
+	u64 submit_ns;
 	struct scatterlist sg[];
 };
 
@@ -183,6 +189,7 @@ static void tls_decrypt_done(struct crypto_async_request *req, int err)
 	struct scatterlist *sgout = aead_req->dst;
 	struct scatterlist *sgin = aead_req->src;
 	struct tls_sw_context_rx *ctx;
+	struct tls_decrypt_ctx *dctx;
 	struct tls_context *tls_ctx;
 	struct scatterlist *sg;
 	unsigned int pages;
@@ -192,6 +199,13 @@ static void tls_decrypt_done(struct crypto_async_request *req, int err)
 	tls_ctx = tls_get_ctx(sk);
 	ctx = tls_sw_ctx_rx(tls_ctx);
 
+	/* Laid out right behind the request, see tls_decrypt_sg() */
+	dctx = (void *)aead_req + sizeof(*aead_req) +
+	       crypto_aead_reqsize(ctx->aead_recv);
+	if (err != -EINPROGRESS)
+		tls_hist_add(sock_net(sk), TLS_HIST_ASYNC_DECRYPT_NS,
+			     ktime_get_ns() - dctx->submit_ns);
+
 	/* Propagate if there was an err */
 	if (err) {
 		if (err == -EBADMSG)
@@ -221,7 +235,7 @@ static void tls_decrypt_done(struct crypto_async_request *req, int err)
 static int tls_do_decryption(struct sock *sk,
 			     struct scatterlist *sgin,
 			     struct scatterlist *sgout,
-			     char *iv_recv,
+			     struct tls_decrypt_ctx *dctx,
 			     size_t data_len,
 			     struct aead_request *aead_req,
 			     struct tls_decrypt_arg *darg)
@@ -235,7 +249,7 @@ static int tls_do_decryption(struct sock *sk,
 	aead_request_set_ad(aead_req, prot->aad_size);
 	aead_request_set_crypt(aead_req, sgin, sgout,
 			       data_len + prot->tag_size,
-			       (u8 *)iv_recv);
+			       dctx->iv);
 
 	if (darg->async) {
 		aead_request_set_callback(aead_req,
@@ -248,6 +262,8 @@ static int tls_do_decryption(struct sock *sk,
 					  crypto_req_done, &ctx->async_wait);
 	}
 
+	tls_hist_add(sock_net(sk), TLS_HIST_RX_SW_BYTES, data_len);
+	dctx->submit_ns = ktime_get_ns();
 	ret = crypto_aead_decrypt(aead_req);
 	if (ret == -EINPROGRESS) {
 		if (darg->async)
@@ -256,6 +272,8 @@ static int tls_do_decryption(struct sock *sk,
 		ret = crypto_wait_req(ret, &ctx->async_wait);
 	}
 	darg->async = false;
+	tls_hist_add(sock_net(sk), TLS_HIST_DECRYPT_NS,
+		     ktime_get_ns() - dctx->submit_ns);
 
 	return ret;
 }
@@ -432,6 +450,9 @@ static void tls_encrypt_done(struct crypto_async_request *req, int err)
 
 	rec = container_of(aead_req, struct tls_rec, aead_req);
 	msg_en = &rec->msg_encrypted;
+	if (err != -EINPROGRESS)
+		tls_hist_add(sock_net(sk), TLS_HIST_ASYNC_ENCRYPT_NS,
+			     ktime_get_ns() - rec->submit_ns);
 
 	sge = sk_msg_elem(msg_en, msg_en->sg.curr);
 	sge->offset -= prot->prepend_size;
@@ -526,6 +547,8 @@ static int tls_do_encryption(struct sock *sk,
 	list_add_tail((struct list_head *)&rec->list, &ctx->tx_list);
 	atomic_inc(&ctx->encrypt_pending);
 
+	tls_hist_add(sock_net(sk), TLS_HIST_TX_SW_BYTES, data_len);
+	rec->submit_ns = ktime_get_ns();
 	rc = crypto_aead_encrypt(aead_req);
 	if (!rc || rc != -EINPROGRESS) {
 		atomic_dec(&ctx->encrypt_pending);
@@ -534,7 +557,15 @@ static int tls_do_encryption(struct sock *sk,
 	}
 
 	if (!rc) {
+		tls_hist_add(sock_net(sk), TLS_HIST_ENCRYPT_NS,
+			     ktime_get_ns() - rec->submit_ns);
 		WRITE_ONCE(rec->tx_ready, true);
+		/* The plaintext is not needed once encrypted. Drop it now
+		 * rather than when the record leaves tx_list, so that records
+		 * waiting for TCP only pin their ciphertext and not the page
+		 * cache pages they were built from.
+		 */
+		sk_msg_free(sk, &rec->msg_plaintext);
 	} else if (rc != -EINPROGRESS) {
 		list_del(&rec->list);
 		return rc;
@@ -1567,7 +1598,7 @@ static int tls_decrypt_sg(struct sock *sk, struct iov_iter *out_iov,
 	}
 
 	/* Prepare and submit AEAD request */
-	err = tls_do_decryption(sk, sgin, sgout, dctx->iv,
+	err = tls_do_decryption(sk, sgin, sgout, dctx,
 				data_len + prot->tail_size, aead_req, darg);
 	if (err)
 		goto exit_free_pages;
@@ -1652,6 +1683,10 @@ tls_decrypt_device(struct sock *sk, struct msghdr *msg,
 	if (err <= 0)
 		return err;
 
+	tls_hist_add(sock_net(sk), TLS_HIST_RX_DEVICE_BYTES,
+		     strp_msg(tls_strp_msg(ctx))->full_len -
+		     prot->overhead_size);
+
 	pad = tls_padding_length(prot, tls_strp_msg(ctx), darg);
 	if (pad < 0)
 		return pad;
@@ -2710,6 +2745,22 @@ int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx, int tx)
 		goto free_iv;
 	}
 
+	/* pcrypt decrypts the queued records in parallel and completes them
+	 * in order. Only records that are decrypted asynchronously benefit,
+	 * which excludes TLS 1.3 where the record type is only known after
+	 * decryption. Fall back to the plain cipher if pcrypt is unavailable.
+	 */
+	if (!*aead && !tx && READ_ONCE(rx_parallel) &&
+	    crypto_info->version != TLS_1_3_VERSION) {
+		char pcrypt_name[CRYPTO_MAX_ALG_NAME];
+
+		snprintf(pcrypt_name, sizeof(pcrypt_name), "pcrypt(%s)",
+			 cipher_name);
+		*aead = crypto_alloc_aead(pcrypt_name, 0, 0);
+		if (IS_ERR(*aead))
+			*aead = NULL;
+	}
+
 	if (!*aead) {
 		*aead = crypto_alloc_aead(cipher_name, 0, 0);
 		if (IS_ERR(*aead)) {
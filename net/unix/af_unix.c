@@ -568,6 +568,7 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	skb_queue_purge(&sk->sk_error_queue);
 
 	DEBUG_NET_WARN_ON_ONCE(refcount_read(&sk->sk_wmem_alloc));
 	DEBUG_NET_WARN_ON_ONCE(!sk_unhashed(sk));
@@ -765,6 +766,8 @@ static ssize_t unix_stream_splice_read(struct socket *,  loff_t *ppos,
 static int unix_dgram_sendmsg(struct socket *, struct msghdr *, size_t);
 static int unix_dgram_recvmsg(struct socket *, struct msghdr *, size_t, int);
 static int unix_read_skb(struct sock *sk, skb_read_actor_t recv_actor);
+static int unix_stream_setsockopt(struct socket *sock, int level, int optname,
+				  sockptr_t optval, unsigned int optlen);
 static int unix_stream_read_skb(struct sock *sk, skb_read_actor_t recv_actor);
 static int unix_dgram_connect(struct socket *, struct sockaddr *,
 			      int, int);
@@ -847,6 +850,7 @@ static const struct proto_ops unix_stream_ops = {
 #endif
 	.listen =	unix_listen,
 	.shutdown =	unix_shutdown,
+	.setsockopt =	unix_stream_setsockopt,
 	.sendmsg =	unix_stream_sendmsg,
 	.recvmsg =	unix_stream_recvmsg,
 	.read_skb =	unix_stream_read_skb,
@@ -1005,6 +1009,8 @@ static int unix_create(struct net *net, struct socket *sock, int protocol,
 	switch (sock->type) {
 	case SOCK_STREAM:
 		sock->ops = &unix_stream_ops;
+		/* SOL_SOCKET options go through unix_stream_setsockopt() */
+		set_bit(SOCK_CUSTOM_SOCKOPT, &sock->flags);
 		break;
 		/*
 		 *	Believe it or not BSD has AF_UNIX, SOCK_RAW though
@@ -1671,6 +1677,8 @@ static void unix_sock_inherit_flags(const struct socket *old,
 		set_bit(SOCK_PASSCRED, &new->flags);
 	if (test_bit(SOCK_PASSSEC, &old->flags))
 		set_bit(SOCK_PASSSEC, &new->flags);
+	if (test_bit(SOCK_CUSTOM_SOCKOPT, &old->flags))
+		set_bit(SOCK_CUSTOM_SOCKOPT, &new->flags);
 }
 
 static int unix_accept(struct socket *sock, struct socket *newsock, int flags,
@@ -2150,11 +2158,86 @@ static int queue_oob(struct socket *sock, struct msghdr *msg, struct sock *other
 }
 #endif
 
+/* sock_setsockopt() only takes SO_ZEROCOPY for the families that supported
+ * it first, so stream sockets handle it here and pass on the rest.
+ */
+static int unix_stream_setsockopt(struct socket *sock, int level, int optname,
+				  sockptr_t optval, unsigned int optlen)
+{
+	struct sock *sk = sock->sk;
+	int val;
+
+	if (level != SOL_SOCKET)
+		return -EOPNOTSUPP;
+
+	if (optname != SO_ZEROCOPY)
+		return sock_setsockopt(sock, level, optname, optval, optlen);
+
+	if (optlen < sizeof(int))
+		return -EINVAL;
+
+	if (copy_from_sockptr(&val, optval, sizeof(val)))
+		return -EFAULT;
+
+	if (val < 0 || val > 1)
+		return -EINVAL;
+
+	lock_sock(sk);
+	if (val)
+		sock_set_flag(sk, SOCK_ZEROCOPY);
+	else
+		sock_reset_flag(sk, SOCK_ZEROCOPY);
+	release_sock(sk);
+
+	return 0;
+}
+
+/* Build an skb of up to *size bytes that points at the pinned user pages,
+ * the completion is queued on our error queue once the peer has read it all.
+ */
+static struct sk_buff *unix_stream_zerocopy_skb(struct sock *sk,
+						struct msghdr *msg,
+						struct scm_cookie *scm,
+						bool send_fds, int *size,
+						struct ubuf_info *uarg,
+						int *err)
+{
+	struct sk_buff *skb;
+
+	skb = sock_alloc_send_pskb(sk, 0, 0, msg->msg_flags & MSG_DONTWAIT,
+				   err, 0);
+	if (!skb)
+		return NULL;
+
+	*err = unix_scm_to_skb(scm, skb, send_fds);
+	if (*err < 0)
+		goto free;
+
+	/* Not the stream variant: the pages are charged to sk_wmem_alloc,
+	 * as sock_wfree() expects, not to sk_wmem_queued.
+	 */
+	*err = __zerocopy_sg_from_iter(msg, NULL, skb, &msg->msg_iter, *size);
+	/* Out of frags, the rest goes in the next skb */
+	if (*err == -EMSGSIZE && skb->len)
+		*err = 0;
+	if (*err)
+		goto free;
+
+	skb_zcopy_set(skb, uarg, NULL);
+	*size = skb->len;
+	return skb;
+
+free:
+	kfree_skb(skb);
+	return NULL;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
 	struct sock *sk = sock->sk;
 	struct sock *other = NULL;
+	struct ubuf_info *uarg = NULL;
 	int err, size;
 	struct sk_buff *skb;
 	int sent = 0;
@@ -2190,12 +2273,30 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (sk->sk_shutdown & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	if ((msg->msg_flags & MSG_ZEROCOPY) && len &&
+	    sock_flag(sk, SOCK_ZEROCOPY)) {
+		uarg = msg_zerocopy_realloc(sk, len, NULL);
+		if (!uarg) {
+			err = -ENOBUFS;
+			goto out_err;
+		}
+	}
+
 	while (sent < len) {
 		size = len - sent;
 
 		/* Keep two messages in the pipe so it schedules better */
 		size = min_t(int, size, (sk->sk_sndbuf >> 1) - 64);
 
+		if (uarg) {
+			skb = unix_stream_zerocopy_skb(sk, msg, &scm, !fds_sent,
+						       &size, uarg, &err);
+			if (!skb)
+				goto out_err;
+			fds_sent = true;
+			goto queue;
+		}
+
 		/* allow fallback to order-0 allocations */
 		size = min_t(int, size, SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ);
 
@@ -2226,6 +2327,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			goto out_err;
 		}
 
+queue:
 		unix_state_lock(other);
 
 		if (sock_flag(other, SOCK_DEAD) ||
@@ -2250,6 +2352,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 #endif
 
 	scm_destroy(&scm);
+	net_zcopy_put(uarg);
 
 	return sent;
 
@@ -2262,6 +2365,10 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	err = -EPIPE;
 out_err:
 	scm_destroy(&scm);
+	if (sent)
+		net_zcopy_put(uarg);
+	else
+		net_zcopy_put_abort(uarg, true);
 	return sent ? : err;
 }
 
@@ -2554,6 +2661,12 @@ static int unix_read_skb(struct sock *sk, skb_read_actor_t recv_actor)
 	if (!skb)
 		return err;
 
+	/* The skb may be queued elsewhere, don't lend the sender's pages */
+	if (skb_orphan_frags_rx(skb, GFP_KERNEL)) {
+		kfree_skb(skb);
+		return -ENOMEM;
+	}
+
 	copied = recv_actor(sk, skb);
 	kfree_skb(skb);
 
@@ -2811,6 +2924,15 @@ static int unix_stream_read_generic(struct unix_stream_read_state *state,
 				goto again;
 		}
 
+		/* Spliced pages outlive the skb, so MSG_ZEROCOPY pages are
+		 * copied first: the sender may reuse them on completion.
+		 */
+		if (state->pipe && skb_orphan_frags_rx(skb, GFP_ATOMIC)) {
+			unix_state_unlock(sk);
+			err = -ENOMEM;
+			break;
+		}
+
 		unix_state_unlock(sk);
 
 		if (check_creds) {
@@ -2944,11 +3066,17 @@ static int unix_stream_recvmsg(struct socket *sock, struct msghdr *msg,
 		.size = size,
 		.flags = flags
 	};
-
-#ifdef CONFIG_BPF_SYSCALL
 	struct sock *sk = sock->sk;
+#ifdef CONFIG_BPF_SYSCALL
 	const struct proto *prot = READ_ONCE(sk->sk_prot);
+#endif
 
+	/* MSG_ZEROCOPY completions */
+	if (flags & MSG_ERRQUEUE)
+		return sock_recv_errqueue(sk, msg, size, SOL_SOCKET,
+					  SO_ZEROCOPY);
+
+#ifdef CONFIG_BPF_SYSCALL
 	if (prot != &unix_stream_proto)
 		return prot->recvmsg(sk, msg, size, flags, NULL);
 #endif
@@ -3158,7 +3286,7 @@ static __poll_t unix_poll(struct file *file, struct socket *sock, poll_table *wa
 	mask = 0;
 
 	/* exceptional events? */
-	if (sk->sk_err)
+	if (sk->sk_err || !skb_queue_empty_lockless(&sk->sk_error_queue))
 		mask |= EPOLLERR;
 	if (sk->sk_shutdown == SHUTDOWN_MASK)
 		mask |= EPOLLHUP;
@@ -31,6 +31,7 @@
 #include "xsk.h"
 
 #define TX_BATCH_SIZE 32
+#define XSK_MAX_PKT_DESCS (MAX_SKB_FRAGS + 1)
 
 static DEFINE_PER_CPU(struct list_head, xskmap_flush_list);
 
@@ -141,7 +142,7 @@ static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 	int err;
 
 	addr = xp_get_handle(xskb);
-	err = xskq_prod_reserve_desc(xs->rx, addr, len);
+	err = xskq_prod_reserve_desc(xs->rx, addr, len, 0);
 	if (err) {
 		xs->rx_queue_full++;
 		return err;
@@ -169,12 +170,86 @@ static void xsk_copy_xdp(struct xdp_buff *to, struct xdp_buff *from, u32 len)
 	memcpy(to_buf, from_buf, len + metalen);
 }
 
+/* Copy a frame that does not fit in one chunk, or that came in with frags,
+ * into as many chunks as needed and chain them with XDP_PKT_CONTD.
+ */
+static int __xsk_rcv_mb(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
+	u32 frame_size = xsk_pool_get_rx_frame_size(xs->pool);
+	struct xdp_buff *bufs[XSK_MAX_PKT_DESCS];
+	u32 nr, i, frag = 0, src_len, copied;
+	void *src = xdp->data;
+
+	nr = DIV_ROUND_UP(len, frame_size);
+	if (nr > XSK_MAX_PKT_DESCS) {
+		xs->rx_dropped++;
+		return -ENOSPC;
+	}
+
+	if (xskq_prod_nb_free(xs->rx, nr) < nr) {
+		xs->rx_queue_full++;
+		return -ENOBUFS;
+	}
+
+	i = xsk_buff_alloc_batch(xs->pool, bufs, nr);
+	if (i < nr) {
+		while (i--)
+			xsk_buff_free(bufs[i]);
+		xs->rx_dropped++;
+		return -ENOMEM;
+	}
+
+	if (!xdp_data_meta_unsupported(xdp)) {
+		u32 metalen = xdp->data - xdp->data_meta;
+
+		memcpy(bufs[0]->data - metalen, xdp->data_meta, metalen);
+	}
+
+	src_len = xdp->data_end - xdp->data;
+	for (i = 0, copied = 0; i < nr; i++) {
+		struct xdp_buff_xsk *xskb = container_of(bufs[i], struct xdp_buff_xsk, xdp);
+		u32 buf_len = min(frame_size, len - copied);
+		void *dst = bufs[i]->data;
+		u32 room, copy;
+
+		for (room = buf_len; room; room -= copy) {
+			while (!src_len) {
+				src = skb_frag_address(&sinfo->frags[frag]);
+				src_len = skb_frag_size(&sinfo->frags[frag]);
+				frag++;
+			}
+
+			copy = min(room, src_len);
+			memcpy(dst, src, copy);
+			dst += copy;
+			src += copy;
+			src_len -= copy;
+		}
+		copied += buf_len;
+
+		/* Cannot fail, the space was checked above */
+		xskq_prod_reserve_desc(xs->rx, xp_get_handle(xskb), buf_len,
+				       i < nr - 1 ? XDP_PKT_CONTD : 0);
+		xp_release(xskb);
+	}
+
+	return 0;
+}
+
 static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 {
 	struct xdp_buff *xsk_xdp;
 	int err;
 	u32 len;
 
+	if (xs->pool->umem->flags & XDP_UMEM_SG_FLAG) {
+		len = xdp_get_buff_len(xdp);
+		if (len > xsk_pool_get_rx_frame_size(xs->pool) ||
+		    xdp_buff_has_frags(xdp))
+			return __xsk_rcv_mb(xs, xdp, len);
+	}
+
 	len = xdp->data_end - xdp->data;
 	if (len > xsk_pool_get_rx_frame_size(xs->pool)) {
 		xs->rx_dropped++;
@@ -229,7 +304,7 @@ static int xsk_rcv_check(struct xdp_sock *xs, struct xdp_buff *xdp)
 static void xsk_flush(struct xdp_sock *xs)
 {
 	xskq_prod_submit(xs->rx);
-	__xskq_cons_release(xs->pool->fq);
+	xskq_cons_release_fq(xs->pool->fq);
 	sock_def_readable(&xs->sk);
 }
 
@@ -333,6 +408,7 @@ bool xsk_tx_peek_desc(struct xsk_buff_pool *pool, struct xdp_desc *desc)
 			goto out;
 
 		xskq_cons_release(xs->tx);
+		xs->tx->nb_descs++;
 		rcu_read_unlock();
 		return true;
 	}
@@ -391,6 +467,7 @@ u32 xsk_tx_peek_release_desc_batch(struct xsk_buff_pool *pool, u32 nb_pkts)
 	}
 
 	__xskq_cons_release(xs->tx);
+	xs->tx->nb_descs += nb_pkts;
 	xskq_prod_write_addr_batch(pool->cq, pool->tx_descs, nb_pkts);
 	xs->sk.sk_write_space(&xs->sk);
 
@@ -404,6 +481,11 @@ static int xsk_wakeup(struct xdp_sock *xs, u8 flags)
 {
 	struct net_device *dev = xs->dev;
 
+	if ((flags & XDP_WAKEUP_RX) && xs->rx)
+		xs->rx->nb_wakeups++;
+	if ((flags & XDP_WAKEUP_TX) && xs->tx)
+		xs->tx->nb_wakeups++;
+
 	return dev->netdev_ops->ndo_xsk_wakeup(dev, xs->queue_id, flags);
 }
 
@@ -420,15 +502,37 @@ static void xsk_destruct_skb(struct sk_buff *skb)
 	sock_wfree(skb);
 }
 
+/* Completion addresses of an skb built from several Tx descriptors */
+struct xsk_tx_addrs {
+	u32 nr;
+	u64 addr[];
+};
+
+static void xsk_destruct_skb_mb(struct sk_buff *skb)
+{
+	struct xsk_tx_addrs *addrs = skb_shinfo(skb)->destructor_arg;
+	struct xdp_sock *xs = xdp_sk(skb->sk);
+	unsigned long flags;
+	u32 i;
+
+	spin_lock_irqsave(&xs->pool->cq_lock, flags);
+	for (i = 0; i < addrs->nr; i++)
+		xskq_prod_submit_addr(xs->pool->cq, addrs->addr[i]);
+	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+
+	kfree(addrs);
+	sock_wfree(skb);
+}
+
 static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
-					      struct xdp_desc *desc)
+					      struct xdp_desc *descs, u32 nr)
 {
 	struct xsk_buff_pool *pool = xs->pool;
-	u32 hr, len, ts, offset, copy, copied;
+	u32 hr, len, ts, offset, copy, copied, d;
 	struct sk_buff *skb;
 	struct page *page;
 	void *buffer;
-	int err, i;
+	int err, i = 0;
 	u64 addr;
 
 	hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(xs->dev->needed_headroom));
@@ -439,28 +543,36 @@ static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
 
 	skb_reserve(skb, hr);
 
-	addr = desc->addr;
-	len = desc->len;
-	ts = pool->unaligned ? len : pool->chunk_size;
+	for (d = 0, ts = 0; d < nr; d++) {
+		addr = descs[d].addr;
+		len = descs[d].len;
+		ts += pool->unaligned ? len : pool->chunk_size;
+
+		buffer = xsk_buff_raw_get_data(pool, addr);
+		offset = offset_in_page(buffer);
+		addr = buffer - pool->addrs;
+
+		for (copied = 0; copied < len; i++) {
+			if (unlikely(i == MAX_SKB_FRAGS)) {
+				kfree_skb(skb);
+				return ERR_PTR(-EMSGSIZE);
+			}
 
-	buffer = xsk_buff_raw_get_data(pool, addr);
-	offset = offset_in_page(buffer);
-	addr = buffer - pool->addrs;
+			page = pool->umem->pgs[addr >> PAGE_SHIFT];
+			get_page(page);
 
-	for (copied = 0, i = 0; copied < len; i++) {
-		page = pool->umem->pgs[addr >> PAGE_SHIFT];
-		get_page(page);
+			copy = min_t(u32, PAGE_SIZE - offset, len - copied);
+			skb_fill_page_desc(skb, i, page, offset, copy);
 
-		copy = min_t(u32, PAGE_SIZE - offset, len - copied);
-		skb_fill_page_desc(skb, i, page, offset, copy);
+			copied += copy;
+			addr += copy;
+			offset = 0;
+		}
 
-		copied += copy;
-		addr += copy;
-		offset = 0;
+		skb->len += len;
+		skb->data_len += len;
 	}
 
-	skb->len += len;
-	skb->data_len += len;
 	skb->truesize += ts;
 
 	refcount_add(ts, &xs->sk.sk_wmem_alloc);
@@ -469,57 +581,83 @@ static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
 }
 
 static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
-				     struct xdp_desc *desc)
+				     struct xdp_desc *descs, u32 nr)
 {
 	struct net_device *dev = xs->dev;
+	struct xsk_tx_addrs *addrs = NULL;
 	struct sk_buff *skb;
+	u32 i;
+
+	if (nr > 1) {
+		addrs = kmalloc(struct_size(addrs, addr, nr), GFP_KERNEL);
+		if (!addrs)
+			return ERR_PTR(-ENOMEM);
+		addrs->nr = nr;
+		for (i = 0; i < nr; i++)
+			addrs->addr[i] = descs[i].addr;
+	}
 
 	if (dev->priv_flags & IFF_TX_SKB_NO_LINEAR) {
-		skb = xsk_build_skb_zerocopy(xs, desc);
+		skb = xsk_build_skb_zerocopy(xs, descs, nr);
 		if (IS_ERR(skb))
-			return skb;
+			goto free_addrs;
 	} else {
-		u32 hr, tr, len;
+		u32 hr, tr, len, off;
 		void *buffer;
 		int err;
 
 		hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(dev->needed_headroom));
 		tr = dev->needed_tailroom;
-		len = desc->len;
+		for (i = 0, len = 0; i < nr; i++)
+			len += descs[i].len;
 
 		skb = sock_alloc_send_skb(&xs->sk, hr + len + tr, 1, &err);
-		if (unlikely(!skb))
-			return ERR_PTR(err);
+		if (unlikely(!skb)) {
+			skb = ERR_PTR(err);
+			goto free_addrs;
+		}
 
 		skb_reserve(skb, hr);
 		skb_put(skb, len);
 
-		buffer = xsk_buff_raw_get_data(xs->pool, desc->addr);
-		err = skb_store_bits(skb, 0, buffer, len);
-		if (unlikely(err)) {
-			kfree_skb(skb);
-			return ERR_PTR(err);
+		for (i = 0, off = 0; i < nr; off += descs[i].len, i++) {
+			buffer = xsk_buff_raw_get_data(xs->pool, descs[i].addr);
+			err = skb_store_bits(skb, off, buffer, descs[i].len);
+			if (unlikely(err)) {
+				kfree_skb(skb);
+				skb = ERR_PTR(err);
+				goto free_addrs;
+			}
 		}
 	}
 
 	skb->dev = dev;
 	skb->priority = xs->sk.sk_priority;
 	skb->mark = xs->sk.sk_mark;
-	skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
-	skb->destructor = xsk_destruct_skb;
+	if (addrs) {
+		skb_shinfo(skb)->destructor_arg = addrs;
+		skb->destructor = xsk_destruct_skb_mb;
+	} else {
+		skb_shinfo(skb)->destructor_arg = (void *)(long)descs[0].addr;
+		skb->destructor = xsk_destruct_skb;
+	}
+
+	return skb;
 
+free_addrs:
+	kfree(addrs);
 	return skb;
 }
 
 static int xsk_generic_xmit(struct sock *sk)
 {
+	struct xdp_desc descs[XSK_MAX_PKT_DESCS];
 	struct xdp_sock *xs = xdp_sk(sk);
 	u32 max_batch = TX_BATCH_SIZE;
 	bool sent_frame = false;
-	struct xdp_desc desc;
 	struct sk_buff *skb;
 	unsigned long flags;
-	int err = 0;
+	int err = 0, nr;
 
 	mutex_lock(&xs->mutex);
 
@@ -532,39 +670,52 @@ static int xsk_generic_xmit(struct sock *sk)
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->pool)) {
+	while ((nr = xskq_cons_peek_pkt(xs->tx, descs, XSK_MAX_PKT_DESCS,
+					xs->pool))) {
 		if (max_batch-- == 0) {
 			err = -EAGAIN;
 			goto out;
 		}
 
+		/* Invalid packet, already released */
+		if (nr < 0)
+			continue;
+
 		/* This is the backpressure mechanism for the Tx path.
 		 * Reserve space in the completion queue and only proceed
 		 * if there is space in it. This avoids having to implement
 		 * any buffering in the Tx path.
 		 */
 		spin_lock_irqsave(&xs->pool->cq_lock, flags);
-		if (xskq_prod_reserve(xs->pool->cq)) {
+		if (xskq_prod_reserve_n(xs->pool->cq, nr)) {
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 			goto out;
 		}
 		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 
-		skb = xsk_build_skb(xs, &desc);
+		skb = xsk_build_skb(xs, descs, nr);
 		if (IS_ERR(skb)) {
 			err = PTR_ERR(skb);
 			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
+			xskq_prod_cancel_n(xs->pool->cq, nr);
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+			if (err == -EMSGSIZE) {
+				/* Too many frags, drop the packet */
+				xs->tx->invalid_descs++;
+				xskq_cons_release_n(xs->tx, nr);
+				continue;
+			}
 			goto out;
 		}
 
 		err = __dev_direct_xmit(skb, xs->queue_id);
 		if  (err == NETDEV_TX_BUSY) {
 			/* Tell user-space to retry the send */
+			if (skb->destructor == xsk_destruct_skb_mb)
+				kfree(skb_shinfo(skb)->destructor_arg);
 			skb->destructor = sock_wfree;
 			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
+			xskq_prod_cancel_n(xs->pool->cq, nr);
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 			/* Free skb without triggering the perf drop trace */
 			consume_skb(skb);
@@ -572,7 +723,8 @@ static int xsk_generic_xmit(struct sock *sk)
 			goto out;
 		}
 
-		xskq_cons_release(xs->tx);
+		xskq_cons_release_n(xs->tx, nr);
+		xs->tx->nb_descs += nr;
 		/* Ignore NET_XMIT_CN as packet might have been sent */
 		if (err == NET_XMIT_DROP) {
 			/* SKB completed but not sent */
@@ -633,6 +785,7 @@ static int __xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len
 	struct sock *sk = sock->sk;
 	struct xdp_sock *xs = xdp_sk(sk);
 	struct xsk_buff_pool *pool;
+	u32 batch;
 
 	if (unlikely(!xsk_is_bound(xs)))
 		return -ENXIO;
@@ -648,6 +801,13 @@ static int __xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len
 	if (xs->zc && xsk_no_wakeup(sk))
 		return 0;
 
+	/* Coalesce wakeups until a whole batch is pending */
+	if (xs->tx) {
+		batch = READ_ONCE(xs->tx->wakeup_batch);
+		if (batch && xskq_cons_present_entries(xs->tx) < batch)
+			return 0;
+	}
+
 	pool = xs->pool;
 	if (pool->cached_need_wakeup & XDP_WAKEUP_TX)
 		return xsk_xmit(sk);
@@ -889,7 +1049,9 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP))
+		      XDP_USE_NEED_WAKEUP | XDP_SHARED_UMEM_FQ))
+		return -EINVAL;
+	if ((flags & XDP_SHARED_UMEM_FQ) && !(flags & XDP_SHARED_UMEM))
 		return -EINVAL;
 
 	rtnl_lock();
@@ -946,6 +1108,15 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			/* Share the umem with another socket on another qid
 			 * and/or device.
 			 */
+			bool share_fq = flags & XDP_SHARED_UMEM_FQ;
+
+			if (share_fq && xs->fq_tmp) {
+				/* Either our own fq or the shared one. */
+				err = -EINVAL;
+				sockfd_put(sock);
+				goto out_unlock;
+			}
+
 			xs->pool = xp_create_and_assign_umem(xs,
 							     umem_xs->umem);
 			if (!xs->pool) {
@@ -954,9 +1125,21 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 				goto out_unlock;
 			}
 
+			if (share_fq) {
+				err = xp_share_fq(xs->pool, umem_xs->pool);
+				if (err) {
+					xp_destroy(xs->pool);
+					xs->pool = NULL;
+					sockfd_put(sock);
+					goto out_unlock;
+				}
+			}
+
 			err = xp_assign_dev_shared(xs->pool, umem_xs, dev,
 						   qid);
 			if (err) {
+				if (share_fq)
+					xskq_destroy(xs->pool->fq);
 				xp_destroy(xs->pool);
 				xs->pool = NULL;
 				sockfd_put(sock);
@@ -964,7 +1147,8 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			}
 		} else {
 			/* Share the buffer pool with the other socket. */
-			if (xs->fq_tmp || xs->cq_tmp) {
+			if (xs->fq_tmp || xs->cq_tmp ||
+			    (flags & XDP_SHARED_UMEM_FQ)) {
 				/* Do not allow setting your own fq or cq. */
 				err = -EINVAL;
 				sockfd_put(sock);
@@ -1130,6 +1314,28 @@ static int xsk_setsockopt(struct socket *sock, int level, int optname,
 		mutex_unlock(&xs->mutex);
 		return err;
 	}
+	case XDP_TX_WAKEUP_BATCH:
+	{
+		u32 batch;
+
+		if (optlen < sizeof(batch))
+			return -EINVAL;
+		if (copy_from_sockptr(&batch, optval, sizeof(batch)))
+			return -EFAULT;
+
+		mutex_lock(&xs->mutex);
+		if (!xs->tx) {
+			mutex_unlock(&xs->mutex);
+			return -ENOBUFS;
+		}
+		if (batch > xs->tx->nentries) {
+			mutex_unlock(&xs->mutex);
+			return -EINVAL;
+		}
+		WRITE_ONCE(xs->tx->wakeup_batch, batch);
+		mutex_unlock(&xs->mutex);
+		return 0;
+	}
 	default:
 		break;
 	}
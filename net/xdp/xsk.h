@@ -44,5 +44,6 @@ void xsk_map_try_sock_delete(struct xsk_map *map, struct xdp_sock *xs,
 void xsk_clear_pool_at_qid(struct net_device *dev, u16 queue_id);
 int xsk_reg_pool_at_qid(struct net_device *dev, struct xsk_buff_pool *pool,
 			u16 queue_id);
+int xp_share_fq(struct xsk_buff_pool *pool, struct xsk_buff_pool *owner);
 
 #endif /* XSK_H_ */
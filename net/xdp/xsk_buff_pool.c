@@ -184,6 +184,13 @@ int xp_assign_dev(struct xsk_buff_pool *pool,
 		goto err_unreg_pool;
 	}
 
+	/* Multi-buffer packets need a driver that understands XDP_PKT_CONTD */
+	if ((pool->umem->flags & XDP_UMEM_SG_FLAG) &&
+	    netdev->xdp_zc_max_segs <= 1) {
+		err = -EOPNOTSUPP;
+		goto err_unreg_pool;
+	}
+
 	bpf.command = XDP_SETUP_XSK_POOL;
 	bpf.xsk.pool = pool;
 	bpf.xsk.queue_id = queue_id;
@@ -212,6 +219,22 @@ int xp_assign_dev(struct xsk_buff_pool *pool,
 	return err;
 }
 
+/* Let @pool draw its Rx buffers from the fill ring of @owner */
+int xp_share_fq(struct xsk_buff_pool *pool, struct xsk_buff_pool *owner)
+{
+	int err;
+
+	if (pool->fq || !owner->fq)
+		return -EINVAL;
+
+	err = xskq_share(owner->fq);
+	if (err)
+		return err;
+
+	pool->fq = owner->fq;
+	return 0;
+}
+
 int xp_assign_dev_shared(struct xsk_buff_pool *pool, struct xdp_sock *umem_xs,
 			 struct net_device *dev, u16 queue_id)
 {
@@ -472,6 +495,79 @@ static bool xp_check_aligned(struct xsk_buff_pool *pool, u64 *addr)
 	return *addr < pool->addrs_cnt;
 }
 
+static struct xdp_buff_xsk *xp_addr_to_xskb(struct xsk_buff_pool *pool, u64 addr)
+{
+	struct xdp_buff_xsk *xskb;
+
+	if (pool->unaligned) {
+		xskb = pool->free_heads[--pool->free_heads_cnt];
+		xp_init_xskb_addr(xskb, pool, addr);
+		if (pool->dma_pages_cnt)
+			xp_init_xskb_dma(xskb, pool, pool->dma_pages, addr);
+	} else {
+		xskb = &pool->heads[xp_aligned_extract_idx(pool, addr)];
+	}
+
+	return xskb;
+}
+
+static int xp_addr_to_node(struct xsk_buff_pool *pool, u64 addr)
+{
+	return page_to_nid(pool->umem->pgs[addr >> PAGE_SHIFT]);
+}
+
+/* Allocate from a fill ring shared with the pools of other queues. Buffers
+ * on another node are parked in that node's stash for pools running there,
+ * and buffers parked on the local node are handed out first.
+ */
+static u32 xp_alloc_shared(struct xsk_buff_pool *pool, struct xdp_buff **xdp,
+			   u32 max)
+{
+	struct xsk_fq_share *share = pool->fq->share;
+	struct xsk_fq_stash *stash;
+	int nid = numa_node_id();
+	u32 nb_entries = 0;
+	u64 addr;
+	bool ok;
+
+	if (max > pool->free_heads_cnt)
+		max = pool->free_heads_cnt;
+
+	spin_lock_bh(&share->lock);
+	stash = &share->stash[nid];
+	while (nb_entries < max && stash->cnt) {
+		addr = stash->addrs[--stash->cnt];
+		xdp[nb_entries++] = &xp_addr_to_xskb(pool, addr)->xdp;
+	}
+
+	while (nb_entries < max) {
+		if (!xskq_cons_peek_addr_unchecked(pool->fq, &addr))
+			break;
+		xskq_cons_release(pool->fq);
+
+		ok = pool->unaligned ? xp_check_unaligned(pool, &addr) :
+			xp_check_aligned(pool, &addr);
+		if (unlikely(!ok)) {
+			pool->fq->invalid_descs++;
+			continue;
+		}
+
+		if (nr_node_ids > 1) {
+			stash = &share->stash[xp_addr_to_node(pool, addr)];
+			if (stash != &share->stash[nid] &&
+			    stash->cnt < XSK_FQ_STASH_SIZE) {
+				stash->addrs[stash->cnt++] = addr;
+				continue;
+			}
+		}
+
+		xdp[nb_entries++] = &xp_addr_to_xskb(pool, addr)->xdp;
+	}
+	spin_unlock_bh(&share->lock);
+
+	return nb_entries;
+}
+
 static struct xdp_buff_xsk *__xp_alloc(struct xsk_buff_pool *pool)
 {
 	struct xdp_buff_xsk *xskb;
@@ -497,15 +593,7 @@ static struct xdp_buff_xsk *__xp_alloc(struct xsk_buff_pool *pool)
 		break;
 	}
 
-	if (pool->unaligned) {
-		xskb = pool->free_heads[--pool->free_heads_cnt];
-		xp_init_xskb_addr(xskb, pool, addr);
-		if (pool->dma_pages_cnt)
-			xp_init_xskb_dma(xskb, pool, pool->dma_pages, addr);
-	} else {
-		xskb = &pool->heads[xp_aligned_extract_idx(pool, addr)];
-	}
-
+	xskb = xp_addr_to_xskb(pool, addr);
 	xskq_cons_release(pool->fq);
 	return xskb;
 }
@@ -513,9 +601,18 @@ static struct xdp_buff_xsk *__xp_alloc(struct xsk_buff_pool *pool)
 struct xdp_buff *xp_alloc(struct xsk_buff_pool *pool)
 {
 	struct xdp_buff_xsk *xskb;
+	struct xdp_buff *buff;
 
 	if (!pool->free_list_cnt) {
-		xskb = __xp_alloc(pool);
+		if (unlikely(pool->fq->share)) {
+			if (!xp_alloc_shared(pool, &buff, 1)) {
+				pool->fq->queue_empty_descs++;
+				return NULL;
+			}
+			xskb = container_of(buff, struct xdp_buff_xsk, xdp);
+		} else {
+			xskb = __xp_alloc(pool);
+		}
 		if (!xskb)
 			return NULL;
 	} else {
@@ -563,15 +660,7 @@ static u32 xp_alloc_new_from_fq(struct xsk_buff_pool *pool, struct xdp_buff **xd
 			continue;
 		}
 
-		if (pool->unaligned) {
-			xskb = pool->free_heads[--pool->free_heads_cnt];
-			xp_init_xskb_addr(xskb, pool, addr);
-			if (pool->dma_pages_cnt)
-				xp_init_xskb_dma(xskb, pool, pool->dma_pages, addr);
-		} else {
-			xskb = &pool->heads[xp_aligned_extract_idx(pool, addr)];
-		}
-
+		xskb = xp_addr_to_xskb(pool, addr);
 		*xdp = &xskb->xdp;
 		xdp++;
 	}
@@ -623,7 +712,10 @@ u32 xp_alloc_batch(struct xsk_buff_pool *pool, struct xdp_buff **xdp, u32 max)
 		xdp += nb_entries1;
 	}
 
-	nb_entries2 = xp_alloc_new_from_fq(pool, xdp, max);
+	if (unlikely(pool->fq->share))
+		nb_entries2 = xp_alloc_shared(pool, xdp, max);
+	else
+		nb_entries2 = xp_alloc_new_from_fq(pool, xdp, max);
 	if (!nb_entries2)
 		pool->fq->queue_empty_descs++;
 
@@ -633,9 +725,21 @@ EXPORT_SYMBOL(xp_alloc_batch);
 
 bool xp_can_alloc(struct xsk_buff_pool *pool, u32 count)
 {
+	struct xsk_fq_share *share = pool->fq->share;
+	bool ret;
+
 	if (pool->free_list_cnt >= count)
 		return true;
-	return xskq_cons_has_entries(pool->fq, count - pool->free_list_cnt);
+	count -= pool->free_list_cnt;
+
+	if (likely(!share))
+		return xskq_cons_has_entries(pool->fq, count);
+
+	spin_lock_bh(&share->lock);
+	ret = share->stash[numa_node_id()].cnt >= count ||
+	      xskq_cons_has_entries(pool->fq, count);
+	spin_unlock_bh(&share->lock);
+	return ret;
 }
 EXPORT_SYMBOL(xp_can_alloc);
 
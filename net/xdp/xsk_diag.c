@@ -86,6 +86,9 @@ static int xsk_diag_put_stats(const struct xdp_sock *xs, struct sk_buff *nlskb)
 	du.n_fill_ring_empty = xs->pool ? xskq_nb_queue_empty_descs(xs->pool->fq) : 0;
 	du.n_tx_invalid = xskq_nb_invalid_descs(xs->tx);
 	du.n_tx_ring_empty = xskq_nb_queue_empty_descs(xs->tx);
+	du.n_rx_wakeups = xskq_nb_wakeups(xs->rx);
+	du.n_tx_wakeups = xskq_nb_wakeups(xs->tx);
+	du.n_tx_descs = xskq_nb_descs(xs->tx);
 	return nla_put(nlskb, XDP_DIAG_STATS, sizeof(du), &du);
 }
 
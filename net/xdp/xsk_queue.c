@@ -6,6 +6,7 @@
 #include <linux/log2.h>
 #include <linux/slab.h>
 #include <linux/overflow.h>
+#include <linux/netdevice.h>
 #include <net/xdp_sock_drv.h>
 
 #include "xsk_queue.h"
@@ -47,11 +48,43 @@ struct xsk_queue *xskq_create(u32 nentries, bool umem_queue)
 	return q;
 }
 
+/* Take a reference to a fill ring for another buffer pool. From now on all
+ * consumers of the ring have to hold q->share->lock.
+ */
+int xskq_share(struct xsk_queue *q)
+{
+	struct xsk_fq_share *share;
+
+	if (q->share) {
+		refcount_inc(&q->share->users);
+		return 0;
+	}
+
+	share = kvzalloc(struct_size(share, stash, nr_node_ids), GFP_KERNEL);
+	if (!share)
+		return -ENOMEM;
+
+	spin_lock_init(&share->lock);
+	/* One reference for the current owner of the ring, one for the new */
+	refcount_set(&share->users, 2);
+	WRITE_ONCE(q->share, share);
+
+	/* Wait for the owner to finish any unlocked access to the ring */
+	synchronize_net();
+	return 0;
+}
+
 void xskq_destroy(struct xsk_queue *q)
 {
 	if (!q)
 		return;
 
+	if (q->share) {
+		if (!refcount_dec_and_test(&q->share->users))
+			return;
+		kvfree(q->share);
+	}
+
 	page_frag_free(q->ring);
 	kfree(q);
 }
@@ -37,6 +37,21 @@ struct xdp_umem_ring {
 	u64 desc[] ____cacheline_aligned_in_smp;
 };
 
+#define XSK_FQ_STASH_SIZE 64
+
+/* Buffers taken off a shared fill ring that live on another node */
+struct xsk_fq_stash {
+	u32 cnt;
+	u64 addrs[XSK_FQ_STASH_SIZE];
+};
+
+/* State of a fill ring shared by the buffer pools of several queues */
+struct xsk_fq_share {
+	spinlock_t lock; /* serializes all consumers of the ring */
+	refcount_t users;
+	struct xsk_fq_stash stash[]; /* one per node */
+};
+
 struct xsk_queue {
 	u32 ring_mask;
 	u32 nentries;
@@ -45,6 +60,10 @@ struct xsk_queue {
 	struct xdp_ring *ring;
 	u64 invalid_descs;
 	u64 queue_empty_descs;
+	u64 nb_wakeups;
+	u64 nb_descs;
+	u32 wakeup_batch;
+	struct xsk_fq_share *share;
 };
 
 /* The structure of the shared state of the rings are a simple
@@ -129,6 +148,17 @@ static inline bool xskq_cons_read_addr_unchecked(struct xsk_queue *q, u64 *addr)
 	return false;
 }
 
+static inline u32 xp_valid_options(struct xsk_buff_pool *pool)
+{
+	return pool->umem->flags & XDP_UMEM_SG_FLAG ? XDP_PKT_CONTD : 0;
+}
+
+/* True if the packet described by @desc continues in the next descriptor */
+static inline bool xp_mb_desc(struct xsk_buff_pool *pool, struct xdp_desc *desc)
+{
+	return desc->options & xp_valid_options(pool) & XDP_PKT_CONTD;
+}
+
 static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 					    struct xdp_desc *desc)
 {
@@ -144,7 +174,7 @@ static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 	if (chunk >= pool->addrs_cnt)
 		return false;
 
-	if (desc->options)
+	if (desc->options & ~xp_valid_options(pool))
 		return false;
 	return true;
 }
@@ -164,7 +194,7 @@ static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
 	    xp_desc_crosses_non_contig_pg(pool, addr, desc->len))
 		return false;
 
-	if (desc->options)
+	if (desc->options & ~xp_valid_options(pool))
 		return false;
 	return true;
 }
@@ -214,26 +244,39 @@ static inline u32 xskq_cons_read_desc_batch(struct xsk_queue *q, struct xsk_buff
 					    u32 max)
 {
 	u32 cached_cons = q->cached_cons, nb_entries = 0;
+	u32 pkt_cons = cached_cons, pkt_entries = 0;
 	struct xdp_desc *descs = pool->tx_descs;
+	bool drop = false;
 
 	while (cached_cons != q->cached_prod && nb_entries < max) {
 		struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
 		u32 idx = cached_cons & q->ring_mask;
+		struct xdp_desc *desc = &descs[nb_entries];
+
+		*desc = ring->desc[idx];
+		cached_cons++;
+		if (unlikely(!xskq_cons_is_valid_desc(q, desc, pool)))
+			drop = true;
+		else
+			nb_entries++;
 
-		descs[nb_entries] = ring->desc[idx];
-		if (unlikely(!xskq_cons_is_valid_desc(q, &descs[nb_entries], pool))) {
-			/* Skip the entry */
-			cached_cons++;
+		if (xp_mb_desc(pool, desc))
 			continue;
-		}
 
-		nb_entries++;
-		cached_cons++;
+		/* End of packet, an invalid fragment drops all of it */
+		if (unlikely(drop)) {
+			nb_entries = pkt_entries;
+			drop = false;
+		}
+		pkt_entries = nb_entries;
+		pkt_cons = cached_cons;
 	}
 
-	/* Release valid plus any invalid entries */
-	xskq_cons_release_n(q, cached_cons - q->cached_cons);
-	return nb_entries;
+	/* Release complete packets plus any invalid entries. A packet that
+	 * did not fit is picked up on the next call.
+	 */
+	xskq_cons_release_n(q, pkt_cons - q->cached_cons);
+	return pkt_entries;
 }
 
 /* Functions for consumers */
@@ -243,6 +286,19 @@ static inline void __xskq_cons_release(struct xsk_queue *q)
 	smp_store_release(&q->ring->consumer, q->cached_cons); /* D, matchees A */
 }
 
+/* Publish the consumer pointer of a fill ring that may be shared */
+static inline void xskq_cons_release_fq(struct xsk_queue *q)
+{
+	if (unlikely(q->share)) {
+		spin_lock_bh(&q->share->lock);
+		__xskq_cons_release(q);
+		spin_unlock_bh(&q->share->lock);
+		return;
+	}
+
+	__xskq_cons_release(q);
+}
+
 static inline void __xskq_cons_peek(struct xsk_queue *q)
 {
 	/* Refresh the local pointer */
@@ -289,6 +345,50 @@ static inline bool xskq_cons_peek_desc(struct xsk_queue *q,
 	return xskq_cons_read_desc(q, desc, pool);
 }
 
+/* Peek at all descriptors of the packet at the head of the ring and copy
+ * them to @descs. Returns the number of descriptors, 0 if no complete
+ * packet is in the ring yet, or -EINVAL if the packet was invalid or had
+ * more than @max descriptors, in which case it has been released.
+ */
+static inline int xskq_cons_peek_pkt(struct xsk_queue *q, struct xdp_desc *descs,
+				     u32 max, struct xsk_buff_pool *pool)
+{
+	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
+	u32 cached_cons = q->cached_cons, nr = 0;
+	struct xdp_desc desc;
+	bool valid = true;
+
+	for (;;) {
+		if (cached_cons == q->cached_prod) {
+			xskq_cons_get_entries(q);
+			if (cached_cons == q->cached_prod)
+				return 0;
+		}
+
+		desc = ring->desc[cached_cons++ & q->ring_mask];
+		if (nr < max && xp_validate_desc(pool, &desc))
+			descs[nr] = desc;
+		else
+			valid = false;
+		nr++;
+
+		if (!xp_mb_desc(pool, &desc))
+			break;
+		/* A ring full of fragments will never see the end */
+		if (cached_cons - q->cached_cons == q->nentries) {
+			valid = false;
+			break;
+		}
+	}
+
+	if (unlikely(!valid)) {
+		q->invalid_descs++;
+		xskq_cons_release_n(q, cached_cons - q->cached_cons);
+		return -EINVAL;
+	}
+	return nr;
+}
+
 /* To improve performance in the xskq_cons_release functions, only update local state here.
  * Reflect this to global state when we get new entries from the ring in
  * xskq_cons_get_entries() and whenever Rx or Tx processing are completed in the NAPI loop.
@@ -325,21 +425,31 @@ static inline bool xskq_prod_is_full(struct xsk_queue *q)
 	return xskq_prod_nb_free(q, 1) ? false : true;
 }
 
+static inline void xskq_prod_cancel_n(struct xsk_queue *q, u32 cnt)
+{
+	q->cached_prod -= cnt;
+}
+
 static inline void xskq_prod_cancel(struct xsk_queue *q)
 {
-	q->cached_prod--;
+	xskq_prod_cancel_n(q, 1);
 }
 
-static inline int xskq_prod_reserve(struct xsk_queue *q)
+static inline int xskq_prod_reserve_n(struct xsk_queue *q, u32 cnt)
 {
-	if (xskq_prod_is_full(q))
+	if (xskq_prod_nb_free(q, cnt) < cnt)
 		return -ENOSPC;
 
 	/* A, matches D */
-	q->cached_prod++;
+	q->cached_prod += cnt;
 	return 0;
 }
 
+static inline int xskq_prod_reserve(struct xsk_queue *q)
+{
+	return xskq_prod_reserve_n(q, 1);
+}
+
 static inline int xskq_prod_reserve_addr(struct xsk_queue *q, u64 addr)
 {
 	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
@@ -366,7 +476,7 @@ static inline void xskq_prod_write_addr_batch(struct xsk_queue *q, struct xdp_de
 }
 
 static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
-					 u64 addr, u32 len)
+					 u64 addr, u32 len, u32 options)
 {
 	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
 	u32 idx;
@@ -378,6 +488,7 @@ static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
 	idx = q->cached_prod++ & q->ring_mask;
 	ring->desc[idx].addr = addr;
 	ring->desc[idx].len = len;
+	ring->desc[idx].options = options;
 
 	return 0;
 }
@@ -425,7 +536,18 @@ static inline u64 xskq_nb_queue_empty_descs(struct xsk_queue *q)
 	return q ? q->queue_empty_descs : 0;
 }
 
+static inline u64 xskq_nb_wakeups(struct xsk_queue *q)
+{
+	return q ? q->nb_wakeups : 0;
+}
+
+static inline u64 xskq_nb_descs(struct xsk_queue *q)
+{
+	return q ? q->nb_descs : 0;
+}
+
 struct xsk_queue *xskq_create(u32 nentries, bool umem_queue);
+int xskq_share(struct xsk_queue *q);
 void xskq_destroy(struct xsk_queue *q_ops);
 
 #endif /* _LINUX_XSK_QUEUE_H */
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Here's a sample kernel module showing the use of uprobe_register_batch()
+ * to place probes at several offsets of one file at once, and count how
+ * many times each of them is hit.
+ *
+ * For more information on theory of operation of uprobes, see
+ * Documentation/trace/uprobetracer.rst
+ *
+ * The hit counts are printed in /var/log/messages and on the console when
+ * the module is removed.
+ */
+
+#define pr_fmt(fmt) "%s: " fmt, __func__
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/namei.h>
+#include <linux/slab.h>
+#include <linux/uprobes.h>
+
+#define MAX_PROBES 64
+
+static char path[PATH_MAX];
+module_param_string(path, path, sizeof(path), 0444);
+MODULE_PARM_DESC(path, "Probed file.");
+
+static unsigned long offsets[MAX_PROBES];
+static int nr_offsets;
+module_param_array(offsets, ulong, &nr_offsets, 0444);
+MODULE_PARM_DESC(offsets, "Probed offsets in the file, given by comma separated numbers.");
+
+struct sample_probe {
+	struct uprobe_consumer	uc;
+	atomic_long_t		nhit;
+};
+
+static struct path probe_path;
+static struct sample_probe *probes;
+static struct uprobe_consumer **ucs;
+static loff_t *probe_offsets;
+
+static int sample_handler(struct uprobe_consumer *uc, struct pt_regs *regs)
+{
+	struct sample_probe *sp = container_of(uc, struct sample_probe, uc);
+
+	atomic_long_inc(&sp->nhit);
+	return 0;
+}
+
+static void sample_free(void)
+{
+	kfree(probe_offsets);
+	kfree(ucs);
+	kfree(probes);
+}
+
+static int __init uprobe_init(void)
+{
+	int ret, i;
+
+	if (!path[0] || !nr_offsets)
+		return -EINVAL;
+
+	probes = kcalloc(nr_offsets, sizeof(*probes), GFP_KERNEL);
+	ucs = kcalloc(nr_offsets, sizeof(*ucs), GFP_KERNEL);
+	probe_offsets = kcalloc(nr_offsets, sizeof(*probe_offsets), GFP_KERNEL);
+	if (!probes || !ucs || !probe_offsets) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (i = 0; i < nr_offsets; i++) {
+		probes[i].uc.handler = sample_handler;
+		ucs[i] = &probes[i].uc;
+		probe_offsets[i] = offsets[i];
+	}
+
+	ret = kern_path(path, LOOKUP_FOLLOW, &probe_path);
+	if (ret)
+		goto out_free;
+
+	ret = uprobe_register_batch(d_inode(probe_path.dentry), nr_offsets,
+				    probe_offsets, NULL, ucs);
+	if (ret) {
+		pr_err("uprobe_register_batch failed, returned %d\n", ret);
+		path_put(&probe_path);
+		goto out_free;
+	}
+
+	pr_info("Planted %d uprobes in %s\n", nr_offsets, path);
+	return 0;
+
+out_free:
+	sample_free();
+	return ret;
+}
+
+static void __exit uprobe_exit(void)
+{
+	int i;
+
+	uprobe_unregister_batch(d_inode(probe_path.dentry), nr_offsets,
+				probe_offsets, ucs);
+	path_put(&probe_path);
+
+	for (i = 0; i < nr_offsets; i++)
+		pr_info("uprobe at %s:0x%llx unregistered. %ld times hit\n",
+			path, probe_offsets[i],
+			atomic_long_read(&probes[i].nhit));
+	sample_free();
+}
+
+module_init(uprobe_init)
+module_exit(uprobe_exit)
+MODULE_LICENSE("GPL");
@@ -7,6 +7,11 @@
  * This program is particularly useful for measuring the kernel's futex hash
  * table/function implementation. In order for it to make sense, use with as
  * many threads and futexes as possible.
+ *
+ * With --sweep the run is repeated with 1, 2, 4, ... threads up to the
+ * requested count, to show how the hash scales with contention, and
+ * --json writes the results of each step to a file. With --latency
+ * every 64th futex_wait() is timed, for the latency percentiles.
  */
 
 /* For the CLR_() macros */
@@ -15,6 +20,7 @@
 
 #include <errno.h>
 #include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <linux/compiler.h>
 #include <linux/kernel.h>
@@ -28,11 +34,14 @@
 #include <subcmd/parse-options.h>
 #include "bench.h"
 #include "futex.h"
+#include "lat-hist.h"
 
 #include <err.h>
 
 static bool done = false;
 static int futex_flag = 0;
+static bool sweep;
+static const char *json_file;
 
 struct timeval bench__start, bench__end, bench__runtime;
 static struct mutex thread_lock;
@@ -45,6 +54,7 @@ struct worker {
 	u_int32_t *futex;
 	pthread_t thread;
 	unsigned long ops;
+	struct lat_hist lat;
 };
 
 static struct bench_futex_parameters params = {
@@ -59,6 +69,9 @@ static const struct option options[] = {
 	OPT_BOOLEAN( 's', "silent",  &params.silent, "Silent mode: do not display data/details"),
 	OPT_BOOLEAN( 'S', "shared",  &params.fshared, "Use shared futexes instead of private ones"),
 	OPT_BOOLEAN( 'm', "mlockall", &params.mlockall, "Lock all current and future memory"),
+	OPT_BOOLEAN( 'w', "sweep",   &sweep, "Repeat with 1, 2, 4, ... threads up to --threads"),
+	OPT_BOOLEAN( 'l', "latency", &params.latency, "Time every 64th futex_wait() for latency percentiles"),
+	OPT_STRING(  'J', "json",    &json_file, "file", "Write the results of each run as JSON"),
 	OPT_END()
 };
 
@@ -83,6 +96,10 @@ static void *workerfn(void *arg)
 
 	do {
 		for (i = 0; i < params.nfutexes; i++, ops++) {
+			unsigned long long t0 = 0;
+
+			if (params.latency && !(ops & 63))
+				t0 = lat_hist_now();
 			/*
 			 * We want the futex calls to fail in order to stress
 			 * the hashing of uaddr and not measure other steps,
@@ -90,6 +107,8 @@ static void *workerfn(void *arg)
 			 * the critical region protected by hb->lock.
 			 */
 			ret = futex_wait(&w->futex[i], 1234, NULL, futex_flag);
+			if (t0)
+				lat_hist_add(&w->lat, lat_hist_now() - t0);
 			if (!params.silent &&
 			    (!ret || errno != EAGAIN || errno != EWOULDBLOCK))
 				warn("Non-expected futex return call");
@@ -110,7 +129,7 @@ static void toggle_done(int sig __maybe_unused,
 	timersub(&bench__end, &bench__start, &bench__runtime);
 }
 
-static void print_summary(void)
+static void print_summary(struct lat_hist *lat)
 {
 	unsigned long avg = avg_stats(&throughput_stats);
 	double stddev = stddev_stats(&throughput_stats);
@@ -118,59 +137,52 @@ static void print_summary(void)
 	printf("%sAveraged %ld operations/sec (+- %.2f%%), total secs = %d\n",
 	       !params.silent ? "\n" : "", avg, rel_stddev_stats(stddev, avg),
 	       (int)bench__runtime.tv_sec);
+	if (!params.latency)
+		return;
+	printf("futex_wait latency p50/p90/p99 = %llu/%llu/%llu ns\n",
+	       lat_hist_percentile(lat, 50), lat_hist_percentile(lat, 90),
+	       lat_hist_percentile(lat, 99));
 }
 
-int bench_futex_hash(int argc, const char **argv)
+static void print_json(FILE *json, unsigned int nthreads, struct lat_hist *lat)
+{
+	unsigned long avg = avg_stats(&throughput_stats);
+	double stddev = stddev_stats(&throughput_stats);
+
+	fprintf(json, "    { \"threads\": %u, \"ops_per_sec\": %lu, "
+		"\"stddev_pct\": %.2f", nthreads, avg,
+		rel_stddev_stats(stddev, avg));
+	if (params.latency)
+		fprintf(json, ", \"p50_ns\": %llu, \"p90_ns\": %llu, "
+			"\"p99_ns\": %llu", lat_hist_percentile(lat, 50),
+			lat_hist_percentile(lat, 90),
+			lat_hist_percentile(lat, 99));
+	fprintf(json, " }");
+}
+
+static void run_threads(struct worker *worker, unsigned int nthreads,
+			struct perf_cpu_map *cpu, struct lat_hist *lat)
 {
 	int ret = 0;
 	cpu_set_t *cpuset;
-	struct sigaction act;
 	unsigned int i;
 	pthread_attr_t thread_attr;
-	struct worker *worker = NULL;
-	struct perf_cpu_map *cpu;
 	int nrcpus;
 	size_t size;
 
-	argc = parse_options(argc, argv, options, bench_futex_hash_usage, 0);
-	if (argc) {
-		usage_with_options(bench_futex_hash_usage, options);
-		exit(EXIT_FAILURE);
-	}
-
-	cpu = perf_cpu_map__new(NULL);
-	if (!cpu)
-		goto errmem;
-
-	memset(&act, 0, sizeof(act));
-	sigfillset(&act.sa_mask);
-	act.sa_sigaction = toggle_done;
-	sigaction(SIGINT, &act, NULL);
-
-	if (params.mlockall) {
-		if (mlockall(MCL_CURRENT | MCL_FUTURE))
-			err(EXIT_FAILURE, "mlockall");
-	}
-
-	if (!params.nthreads) /* default to the number of CPUs */
-		params.nthreads = perf_cpu_map__nr(cpu);
-
-	worker = calloc(params.nthreads, sizeof(*worker));
-	if (!worker)
-		goto errmem;
-
-	if (!params.fshared)
-		futex_flag = FUTEX_PRIVATE_FLAG;
-
 	printf("Run summary [PID %d]: %d threads, each operating on %d [%s] futexes for %d secs.\n\n",
-	       getpid(), params.nthreads, params.nfutexes, params.fshared ? "shared":"private", params.runtime);
+	       getpid(), nthreads, params.nfutexes, params.fshared ? "shared":"private", params.runtime);
+
+	memset(worker, 0, nthreads * sizeof(*worker));
+	memset(lat, 0, sizeof(*lat));
+	done = false;
 
 	init_stats(&throughput_stats);
 	mutex_init(&thread_lock);
 	cond_init(&thread_parent);
 	cond_init(&thread_worker);
 
-	threads_starting = params.nthreads;
+	threads_starting = nthreads;
 	pthread_attr_init(&thread_attr);
 	gettimeofday(&bench__start, NULL);
 
@@ -179,7 +191,7 @@ int bench_futex_hash(int argc, const char **argv)
 	BUG_ON(!cpuset);
 	size = CPU_ALLOC_SIZE(nrcpus);
 
-	for (i = 0; i < params.nthreads; i++) {
+	for (i = 0; i < nthreads; i++) {
 		worker[i].tid = i;
 		worker[i].futex = calloc(params.nfutexes, sizeof(*worker[i].futex));
 		if (!worker[i].futex)
@@ -213,7 +225,7 @@ int bench_futex_hash(int argc, const char **argv)
 	sleep(params.runtime);
 	toggle_done(0, NULL, NULL);
 
-	for (i = 0; i < params.nthreads; i++) {
+	for (i = 0; i < nthreads; i++) {
 		ret = pthread_join(worker[i].thread, NULL);
 		if (ret)
 			err(EXIT_FAILURE, "pthread_join");
@@ -224,10 +236,11 @@ int bench_futex_hash(int argc, const char **argv)
 	cond_destroy(&thread_worker);
 	mutex_destroy(&thread_lock);
 
-	for (i = 0; i < params.nthreads; i++) {
+	for (i = 0; i < nthreads; i++) {
 		unsigned long t = bench__runtime.tv_sec > 0 ?
 			worker[i].ops / bench__runtime.tv_sec : 0;
 		update_stats(&throughput_stats, t);
+		lat_hist_merge(lat, &worker[i].lat);
 		if (!params.silent) {
 			if (params.nfutexes == 1)
 				printf("[thread %2d] futex: %p [ %ld ops/sec ]\n",
@@ -241,11 +254,84 @@ int bench_futex_hash(int argc, const char **argv)
 		zfree(&worker[i].futex);
 	}
 
-	print_summary();
+	print_summary(lat);
+	return;
+errmem:
+	err(EXIT_FAILURE, "calloc");
+}
+
+int bench_futex_hash(int argc, const char **argv)
+{
+	struct sigaction act;
+	unsigned int nthreads;
+	struct worker *worker = NULL;
+	struct perf_cpu_map *cpu;
+	struct lat_hist *lat;
+	FILE *json = NULL;
+
+	argc = parse_options(argc, argv, options, bench_futex_hash_usage, 0);
+	if (argc) {
+		usage_with_options(bench_futex_hash_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	cpu = perf_cpu_map__new(NULL);
+	if (!cpu)
+		goto errmem;
+
+	memset(&act, 0, sizeof(act));
+	sigfillset(&act.sa_mask);
+	act.sa_sigaction = toggle_done;
+	sigaction(SIGINT, &act, NULL);
+
+	if (params.mlockall) {
+		if (mlockall(MCL_CURRENT | MCL_FUTURE))
+			err(EXIT_FAILURE, "mlockall");
+	}
+
+	if (!params.nthreads) /* default to the number of CPUs */
+		params.nthreads = perf_cpu_map__nr(cpu);
+
+	worker = calloc(params.nthreads, sizeof(*worker));
+	lat = malloc(sizeof(*lat));
+	if (!worker || !lat)
+		goto errmem;
+
+	if (!params.fshared)
+		futex_flag = FUTEX_PRIVATE_FLAG;
+
+	if (json_file) {
+		json = fopen(json_file, "w");
+		if (!json)
+			err(EXIT_FAILURE, "%s", json_file);
+		fprintf(json, "{\n  \"futexes\": %u,\n  \"shared\": %s,\n"
+			"  \"runtime\": %u,\n  \"results\": [\n",
+			params.nfutexes, params.fshared ? "true" : "false",
+			params.runtime);
+	}
+
+	nthreads = sweep ? 1 : params.nthreads;
+	for (;;) {
+		run_threads(worker, nthreads, cpu, lat);
+		if (json)
+			print_json(json, nthreads, lat);
+		if (nthreads == params.nthreads)
+			break;
+		if (json)
+			fprintf(json, ",\n");
+		printf("\n");
+		nthreads = min(nthreads * 2, params.nthreads);
+	}
+
+	if (json) {
+		fprintf(json, "\n  ]\n}\n");
+		fclose(json);
+	}
 
+	free(lat);
 	free(worker);
 	free(cpu);
-	return ret;
+	return 0;
 errmem:
 	err(EXIT_FAILURE, "calloc");
 }
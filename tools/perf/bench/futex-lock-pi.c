@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: GPL-2.0
 /*
  * Copyright (C) 2015 Davidlohr Bueso.
+ *
+ * With --latency every futex_lock_pi() is timed, for the latency
+ * percentiles of taking the contended lock.
  */
 
 /* For the CLR_() macros */
@@ -18,6 +21,7 @@
 #include <perf/cpumap.h>
 #include "bench.h"
 #include "futex.h"
+#include "lat-hist.h"
 
 #include <err.h>
 #include <stdlib.h>
@@ -29,6 +33,7 @@ struct worker {
 	u_int32_t *futex;
 	pthread_t thread;
 	unsigned long ops;
+	struct lat_hist lat;
 };
 
 static u_int32_t global_futex = 0;
@@ -51,6 +56,7 @@ static const struct option options[] = {
 	OPT_BOOLEAN( 's', "silent",  &params.silent, "Silent mode: do not display data/details"),
 	OPT_BOOLEAN( 'S', "shared",  &params.fshared, "Use shared futexes instead of private ones"),
 	OPT_BOOLEAN( 'm', "mlockall", &params.mlockall, "Lock all current and future memory"),
+	OPT_BOOLEAN( 'l', "latency", &params.latency, "Time each futex_lock_pi() for latency percentiles"),
 	OPT_END()
 };
 
@@ -59,7 +65,7 @@ static const char * const bench_futex_lock_pi_usage[] = {
 	NULL
 };
 
-static void print_summary(void)
+static void print_summary(struct lat_hist *lat)
 {
 	unsigned long avg = avg_stats(&throughput_stats);
 	double stddev = stddev_stats(&throughput_stats);
@@ -67,6 +73,11 @@ static void print_summary(void)
 	printf("%sAveraged %ld operations/sec (+- %.2f%%), total secs = %d\n",
 	       !params.silent ? "\n" : "", avg, rel_stddev_stats(stddev, avg),
 	       (int)bench__runtime.tv_sec);
+	if (!params.latency)
+		return;
+	printf("futex_lock_pi latency p50/p90/p99 = %llu/%llu/%llu ns\n",
+	       lat_hist_percentile(lat, 50), lat_hist_percentile(lat, 90),
+	       lat_hist_percentile(lat, 99));
 }
 
 static void toggle_done(int sig __maybe_unused,
@@ -92,8 +103,11 @@ static void *workerfn(void *arg)
 	mutex_unlock(&thread_lock);
 
 	do {
+		unsigned long long t0 = 0;
 		int ret;
 	again:
+		if (params.latency)
+			t0 = lat_hist_now();
 		ret = futex_lock_pi(w->futex, NULL, futex_flag);
 
 		if (ret) { /* handle lock acquisition */
@@ -105,6 +119,8 @@ static void *workerfn(void *arg)
 
 			goto again;
 		}
+		if (t0)
+			lat_hist_add(&w->lat, lat_hist_now() - t0);
 
 		usleep(1);
 		ret = futex_unlock_pi(w->futex, futex_flag);
@@ -165,6 +181,7 @@ int bench_futex_lock_pi(int argc, const char **argv)
 	struct sigaction act;
 	pthread_attr_t thread_attr;
 	struct perf_cpu_map *cpu;
+	struct lat_hist *lat;
 
 	argc = parse_options(argc, argv, options, bench_futex_lock_pi_usage, 0);
 	if (argc)
@@ -188,7 +205,8 @@ int bench_futex_lock_pi(int argc, const char **argv)
 		params.nthreads = perf_cpu_map__nr(cpu);
 
 	worker = calloc(params.nthreads, sizeof(*worker));
-	if (!worker)
+	lat = calloc(1, sizeof(*lat));
+	if (!worker || !lat)
 		err(EXIT_FAILURE, "calloc");
 
 	if (!params.fshared)
@@ -234,6 +252,7 @@ int bench_futex_lock_pi(int argc, const char **argv)
 			worker[i].ops / bench__runtime.tv_sec : 0;
 
 		update_stats(&throughput_stats, t);
+		lat_hist_merge(lat, &worker[i].lat);
 		if (!params.silent)
 			printf("[thread %3d] futex: %p [ %ld ops/sec ]\n",
 			       worker[i].tid, worker[i].futex, t);
@@ -242,8 +261,9 @@ int bench_futex_lock_pi(int argc, const char **argv)
 			zfree(&worker[i].futex);
 	}
 
-	print_summary();
+	print_summary(lat);
 
+	free(lat);
 	free(worker);
 	perf_cpu_map__put(cpu);
 	return ret;
@@ -6,6 +6,10 @@
  * equal amount of them. The program output reflects the avg latency
  * for each individual thread to service its share of work. Ultimately
  * it can be used to measure futex_wake() changes.
+ *
+ * With --latency each blocked thread also times how long it took from
+ * the wakers being released to it running again, for the wakeup latency
+ * percentiles.
  */
 #include "bench.h"
 #include <linux/compiler.h>
@@ -30,6 +34,7 @@ int bench_futex_wake_parallel(int argc __maybe_unused, const char **argv __maybe
 #include <linux/time64.h>
 #include <errno.h>
 #include "futex.h"
+#include "lat-hist.h"
 #include <perf/cpumap.h>
 
 #include <err.h>
@@ -56,6 +61,8 @@ static pthread_barrier_t barrier;
 static struct stats waketime_stats, wakeup_stats;
 static unsigned int threads_starting;
 static int futex_flag = 0;
+static unsigned long long wake_start;
+static struct lat_hist wake_lat;
 
 static struct bench_futex_parameters params;
 
@@ -65,6 +72,7 @@ static const struct option options[] = {
 	OPT_BOOLEAN( 's', "silent",  &params.silent, "Silent mode: do not display data/details"),
 	OPT_BOOLEAN( 'S', "shared",  &params.fshared, "Use shared futexes instead of private ones"),
 	OPT_BOOLEAN( 'm', "mlockall", &params.mlockall, "Lock all current and future memory"),
+	OPT_BOOLEAN( 'l', "latency", &params.latency, "Time each wakeup for latency percentiles"),
 
 	OPT_END()
 };
@@ -115,6 +123,8 @@ static void wakeup_threads(struct thread_data *td, pthread_attr_t thread_attr)
 			err(EXIT_FAILURE, "pthread_create");
 	}
 
+	/* the wakers get going as soon as we reach the barrier */
+	wake_start = lat_hist_now();
 	pthread_barrier_wait(&barrier);
 
 	for (i = 0; i < params.nwakes; i++)
@@ -138,6 +148,14 @@ static void *blocked_workerfn(void *arg __maybe_unused)
 			break;
 	}
 
+	if (params.latency) {
+		unsigned long long ns = lat_hist_now() - wake_start;
+
+		mutex_lock(&thread_lock);
+		lat_hist_add(&wake_lat, ns);
+		mutex_unlock(&thread_lock);
+	}
+
 	pthread_exit(NULL);
 	return NULL;
 }
@@ -212,6 +230,11 @@ static void print_summary(void)
 	       params.nthreads,
 	       waketime_avg / USEC_PER_MSEC,
 	       rel_stddev_stats(waketime_stddev, waketime_avg));
+	if (params.latency)
+		printf("Wakeup latency p50/p90/p99 = %llu/%llu/%llu ns\n",
+		       lat_hist_percentile(&wake_lat, 50),
+		       lat_hist_percentile(&wake_lat, 90),
+		       lat_hist_percentile(&wake_lat, 99));
 }
 
 
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LAT_HIST_H
+#define _LAT_HIST_H
+
+/*
+ * Latency histogram for the benchmarks: buckets of 1/16th of a power of two,
+ * exact below 16ns and at most about 6% off above, so that percentiles of
+ * any number of samples can be had in constant space.
+ */
+
+#include <time.h>
+
+#define LAT_HIST_SUB_BITS	4
+#define LAT_HIST_BUCKETS	((64 - LAT_HIST_SUB_BITS + 1) << LAT_HIST_SUB_BITS)
+
+struct lat_hist {
+	unsigned long long nr;
+	unsigned long long buckets[LAT_HIST_BUCKETS];
+};
+
+static inline unsigned long long lat_hist_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void lat_hist_add(struct lat_hist *h, unsigned long long ns)
+{
+	unsigned int msb, idx = ns;
+
+	if (ns >= (1 << LAT_HIST_SUB_BITS)) {
+		msb = 63 - __builtin_clzll(ns);
+		idx = ((msb - LAT_HIST_SUB_BITS + 1) << LAT_HIST_SUB_BITS) +
+		      ((ns >> (msb - LAT_HIST_SUB_BITS)) &
+		       ((1 << LAT_HIST_SUB_BITS) - 1));
+	}
+	h->buckets[idx]++;
+	h->nr++;
+}
+
+static inline void lat_hist_merge(struct lat_hist *dst,
+				  const struct lat_hist *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < LAT_HIST_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+	dst->nr += src->nr;
+}
+
+/* The lower bound of the bucket holding the @pct percentile, in ns */
+static inline unsigned long long lat_hist_percentile(const struct lat_hist *h,
+						     double pct)
+{
+	unsigned long long want = h->nr * pct / 100, seen = 0;
+	unsigned int i, shift;
+
+	for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen <= want)
+			continue;
+		shift = i >> LAT_HIST_SUB_BITS;
+		if (!shift)
+			return i;
+		return ((1ULL << LAT_HIST_SUB_BITS) +
+			(i & ((1 << LAT_HIST_SUB_BITS) - 1))) << (shift - 1);
+	}
+	return 0;
+}
+
+#endif /* _LAT_HIST_H */
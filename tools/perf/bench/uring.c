@@ -0,0 +1,347 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * uring.c
+ *
+ * uring: Benchmark for io_uring submission and completion
+ *
+ * A single thread keeps up to a ring's worth of requests in flight,
+ * submitting them in batches of --batch with one io_uring_enter(2), or none
+ * with --sqpoll, and reaping whatever has completed. The requests are one
+ * of:
+ *
+ *   nop   IORING_OP_NOP, the cost of the ring itself
+ *   read  IORING_OP_READ{,_FIXED} of --size bytes at offset 0 of --file
+ *   recv  IORING_OP_RECV of --size bytes on an AF_UNIX datagram socket,
+ *         whose peer is written from the same thread before each request
+ *
+ * The result is the rate of completions and the distribution of the time
+ * from submitting a request to reaping its completion.
+ *
+ * Like the other benchmarks this is meant to compare kernels, so it uses
+ * the raw system calls rather than liburing.
+ */
+#include <subcmd/parse-options.h>
+#include "bench.h"
+#include "lat-hist.h"
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <linux/kernel.h>
+#include <asm/barrier.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+static unsigned int nsecs = 5;
+static unsigned int depth = 128;
+static unsigned int batch = 32;
+static unsigned int size = 4096;
+static const char *op_str = "nop";
+static const char *file = "/dev/zero";
+static bool sqpoll, fixed_files, fixed_bufs;
+static volatile bool done;
+
+enum uring_op { URING_NOP, URING_READ, URING_RECV };
+
+static const char * const uring_op_names[] = {
+	[URING_NOP]	= "nop",
+	[URING_READ]	= "read",
+	[URING_RECV]	= "recv",
+};
+
+static const struct option options[] = {
+	OPT_STRING('o', "op",      &op_str, "op", "Request to issue: nop, read or recv"),
+	OPT_UINTEGER('r', "runtime", &nsecs, "Specify runtime (in seconds)"),
+	OPT_UINTEGER('d', "depth",   &depth, "Ring entries, and most requests in flight"),
+	OPT_UINTEGER('b', "batch",   &batch, "Requests submitted per io_uring_enter(2)"),
+	OPT_UINTEGER('s', "size",    &size,  "Bytes per read or recv"),
+	OPT_STRING('f', "file",    &file,  "path", "File to read from"),
+	OPT_BOOLEAN('P', "sqpoll",  &sqpoll,      "Submit from a kernel thread (IORING_SETUP_SQPOLL)"),
+	OPT_BOOLEAN('F', "fixed-files", &fixed_files, "Use registered files"),
+	OPT_BOOLEAN('B', "fixed-buffers", &fixed_bufs, "Use registered buffers (read only)"),
+	OPT_END()
+};
+
+static const char * const bench_uring_usage[] = {
+	"perf bench uring <options>",
+	NULL
+};
+
+struct uring {
+	int fd;
+	unsigned int *sq_head, *sq_tail, *sq_mask, *sq_flags, *sq_array;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	unsigned int sq_entries;
+};
+
+/* Time from submitting a request to reaping its completion */
+static struct lat_hist lat;
+
+static void toggle_done(int sig __maybe_unused)
+{
+	done = true;
+}
+
+static void *uring_mmap(int fd, size_t len, off_t off)
+{
+	void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, fd, off);
+
+	if (p == MAP_FAILED)
+		err(EXIT_FAILURE, "mmap");
+	return p;
+}
+
+static void uring_setup(struct uring *ring)
+{
+	struct io_uring_params p;
+	void *sq, *cq;
+
+	memset(&p, 0, sizeof(p));
+	if (sqpoll) {
+		p.flags |= IORING_SETUP_SQPOLL;
+		p.sq_thread_idle = 1000;
+	}
+
+	ring->fd = syscall(__NR_io_uring_setup, depth, &p);
+	if (ring->fd < 0)
+		err(EXIT_FAILURE, "io_uring_setup");
+
+	sq = uring_mmap(ring->fd, p.sq_off.array + p.sq_entries * sizeof(__u32),
+			IORING_OFF_SQ_RING);
+	cq = uring_mmap(ring->fd, p.cq_off.cqes +
+			p.cq_entries * sizeof(struct io_uring_cqe),
+			IORING_OFF_CQ_RING);
+	ring->sqes = uring_mmap(ring->fd,
+				p.sq_entries * sizeof(struct io_uring_sqe),
+				IORING_OFF_SQES);
+
+	ring->sq_head = sq + p.sq_off.head;
+	ring->sq_tail = sq + p.sq_off.tail;
+	ring->sq_mask = sq + p.sq_off.ring_mask;
+	ring->sq_flags = sq + p.sq_off.flags;
+	ring->sq_array = sq + p.sq_off.array;
+	ring->cq_head = cq + p.cq_off.head;
+	ring->cq_tail = cq + p.cq_off.tail;
+	ring->cq_mask = cq + p.cq_off.ring_mask;
+	ring->cqes = cq + p.cq_off.cqes;
+	ring->sq_entries = p.sq_entries;
+}
+
+static int uring_enter(struct uring *ring, unsigned int to_submit,
+		       unsigned int min_complete, unsigned int flags)
+{
+	return syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete,
+		       flags, NULL, 0);
+}
+
+static int uring_register(struct uring *ring, unsigned int opcode,
+			  void *arg, unsigned int nr_args)
+{
+	return syscall(__NR_io_uring_register, ring->fd, opcode, arg, nr_args);
+}
+
+int bench_uring(int argc, const char **argv)
+{
+	unsigned long long *submit_ns, start, runtime, total = 0;
+	unsigned int *free_slots, nr_free, inflight = 0, i;
+	int fd = -1, peer = -1, sv[2];
+	enum uring_op op;
+	struct iovec *iovs;
+	struct uring ring;
+	char *bufs;
+
+	argc = parse_options(argc, argv, options, bench_uring_usage, 0);
+	if (argc || !depth || !batch || !size)
+		usage_with_options(bench_uring_usage, options);
+
+	for (op = URING_NOP; op <= URING_RECV; op++)
+		if (!strcmp(op_str, uring_op_names[op]))
+			break;
+	if (op > URING_RECV)
+		usage_with_options(bench_uring_usage, options);
+
+	signal(SIGINT, toggle_done);
+
+	uring_setup(&ring);
+	/* The ring may have been rounded up to a power of two */
+	depth = ring.sq_entries;
+	batch = min(batch, depth);
+
+	submit_ns = calloc(depth, sizeof(*submit_ns));
+	free_slots = calloc(depth, sizeof(*free_slots));
+	iovs = calloc(depth, sizeof(*iovs));
+	bufs = calloc(depth, size);
+	if (!submit_ns || !free_slots || !iovs || !bufs)
+		err(EXIT_FAILURE, "calloc");
+	for (i = 0; i < depth; i++) {
+		free_slots[i] = i;
+		iovs[i].iov_base = bufs + (size_t)i * size;
+		iovs[i].iov_len = size;
+	}
+	nr_free = depth;
+
+	if (op == URING_READ) {
+		fd = open(file, O_RDONLY);
+		if (fd < 0)
+			err(EXIT_FAILURE, "open %s", file);
+	} else if (op == URING_RECV) {
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sv))
+			err(EXIT_FAILURE, "socketpair");
+		fd = sv[0];
+		peer = sv[1];
+		fcntl(peer, F_SETFL, O_NONBLOCK);
+	}
+
+	if (fixed_files && fd >= 0) {
+		if (uring_register(&ring, IORING_REGISTER_FILES, &fd, 1))
+			err(EXIT_FAILURE, "IORING_REGISTER_FILES");
+	}
+	if (fixed_bufs && op == URING_READ) {
+		if (uring_register(&ring, IORING_REGISTER_BUFFERS, iovs, depth))
+			err(EXIT_FAILURE, "IORING_REGISTER_BUFFERS");
+	}
+
+	printf("Run summary [PID %d]: %s%s%s, depth %u, batch %u, %u bytes, for %u secs.\n\n",
+	       getpid(), uring_op_names[op], sqpoll ? ", sqpoll" : "",
+	       fixed_files ? ", fixed files" : "", depth, batch, size, nsecs);
+
+	alarm(nsecs);
+	signal(SIGALRM, toggle_done);
+	start = lat_hist_now();
+
+	while (!done || inflight) {
+		unsigned int tail = *ring.sq_tail, queued = 0, head, flags = 0;
+		unsigned long long t = lat_hist_now();
+		int ret;
+
+		while (!done && nr_free && queued < batch) {
+			unsigned int slot = free_slots[--nr_free];
+			unsigned int idx = (tail + queued) & *ring.sq_mask;
+			struct io_uring_sqe *sqe = &ring.sqes[idx];
+
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->user_data = slot;
+			sqe->fd = fixed_files ? 0 : fd;
+			if (fixed_files && fd >= 0)
+				sqe->flags |= IOSQE_FIXED_FILE;
+
+			switch (op) {
+			case URING_NOP:
+				sqe->opcode = IORING_OP_NOP;
+				break;
+			case URING_READ:
+				sqe->opcode = fixed_bufs ? IORING_OP_READ_FIXED :
+							   IORING_OP_READ;
+				sqe->addr = (unsigned long)iovs[slot].iov_base;
+				sqe->len = size;
+				sqe->buf_index = slot;
+				break;
+			case URING_RECV:
+				/* Wait for some recvs to drain the socket */
+				if (write(peer, iovs[slot].iov_base, size) != size) {
+					if (errno != EAGAIN)
+						err(EXIT_FAILURE, "write");
+					nr_free++;
+					goto submit;
+				}
+				sqe->opcode = IORING_OP_RECV;
+				sqe->addr = (unsigned long)iovs[slot].iov_base;
+				sqe->len = size;
+				break;
+			}
+
+			ring.sq_array[idx] = idx;
+			submit_ns[slot] = t;
+			queued++;
+		}
+submit:
+		smp_store_release(ring.sq_tail, tail + queued);
+		inflight += queued;
+
+		if (sqpoll) {
+			if (READ_ONCE(*ring.sq_flags) & IORING_SQ_NEED_WAKEUP)
+				flags |= IORING_ENTER_SQ_WAKEUP;
+			queued = 0;
+		}
+		/* Only wait when there is nothing more to submit */
+		if (inflight && (!nr_free || done))
+			flags |= IORING_ENTER_GETEVENTS;
+		if (queued || flags) {
+			ret = uring_enter(&ring, queued, flags &
+					  IORING_ENTER_GETEVENTS ? 1 : 0, flags);
+			if (ret < 0 && errno != EINTR && errno != EAGAIN &&
+			    errno != EBUSY)
+				err(EXIT_FAILURE, "io_uring_enter");
+		}
+
+		t = lat_hist_now();
+		head = *ring.cq_head;
+		while (head != smp_load_acquire(ring.cq_tail)) {
+			struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+			unsigned int slot = cqe->user_data;
+
+			if (cqe->res < 0) {
+				errno = -cqe->res;
+				err(EXIT_FAILURE, "%s", uring_op_names[op]);
+			}
+			lat_hist_add(&lat, t - submit_ns[slot]);
+			free_slots[nr_free++] = slot;
+			inflight--;
+			total++;
+			head++;
+		}
+		smp_store_release(ring.cq_head, head);
+	}
+
+	runtime = lat_hist_now() - start;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Completed %'llu requests\n", total);
+		printf(" %14s: %llu.%03llu [sec]\n\n", "Total time",
+		       runtime / 1000000000, runtime / 1000000 % 1000);
+		printf(" %'14llu ops/sec\n",
+		       runtime ? total * 1000000000 / runtime : 0);
+		printf(" %14s: %llu/%llu/%llu/%llu/%llu [nsec]\n",
+		       "p50/90/99/99.9/99.99", lat_hist_percentile(&lat, 50),
+		       lat_hist_percentile(&lat, 90),
+		       lat_hist_percentile(&lat, 99),
+		       lat_hist_percentile(&lat, 99.9),
+		       lat_hist_percentile(&lat, 99.99));
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%llu %llu %llu\n",
+		       runtime ? total * 1000000000 / runtime : 0,
+		       lat_hist_percentile(&lat, 50), lat_hist_percentile(&lat, 99));
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	if (peer >= 0)
+		close(peer);
+	if (fd >= 0)
+		close(fd);
+	close(ring.fd);
+	free(bufs);
+	free(iovs);
+	free(free_slots);
+	free(submit_ns);
+	return 0;
+}
@@ -596,6 +596,83 @@ static int test_cgcore_proc_migration(const char *root)
 	return ret;
 }
 
+static int wait_for_parent(const char *cgroup, void *arg)
+{
+	int ppid = getppid();
+
+	while (getppid() == ppid)
+		sleep(1);
+
+	return 0;
+}
+
+/*
+ * Test migration of several processes with a single write.
+ * All PIDs written to cgroup.procs at once are migrated, and a write
+ * naming a PID that doesn't exist migrates none of them.
+ */
+static int test_cgcore_proc_batch_migration(const char *root)
+{
+	int ret = KSFT_FAIL;
+	int i, pid, n_procs = 16;
+	char *src = NULL, *dst = NULL;
+	char buf[PAGE_SIZE];
+	size_t len = 0;
+
+	src = cg_name(root, "cg_src");
+	dst = cg_name(root, "cg_dst");
+	if (!src || !dst)
+		goto cleanup;
+
+	if (cg_create(src))
+		goto cleanup;
+	if (cg_create(dst))
+		goto cleanup;
+
+	for (i = 0; i < n_procs; i++) {
+		pid = cg_run_nowait(src, wait_for_parent, NULL);
+		if (pid < 0)
+			goto cleanup;
+		len += snprintf(buf + len, sizeof(buf) - len, "%d ", pid);
+	}
+
+	if (cg_wait_for_proc_count(src, n_procs))
+		goto cleanup;
+
+	/* PID_MAX_LIMIT is 4M, so this one can't exist */
+	snprintf(buf + len, sizeof(buf) - len, "%d", 1 << 23);
+	if (!cg_write(dst, "cgroup.procs", buf))
+		goto cleanup;
+	if (cg_read_lc(dst, "cgroup.procs") != 0)
+		goto cleanup;
+
+	buf[len] = '\0';
+	if (cg_write(dst, "cgroup.procs", buf))
+		goto cleanup;
+	if (cg_read_lc(dst, "cgroup.procs") != n_procs)
+		goto cleanup;
+	if (cg_read_lc(src, "cgroup.procs") != 0)
+		goto cleanup;
+
+	ret = KSFT_PASS;
+
+cleanup:
+	if (src)
+		cg_killall(src);
+	if (dst)
+		cg_killall(dst);
+	while (waitpid(-1, NULL, 0) > 0)
+		;
+
+	if (dst)
+		cg_destroy(dst);
+	if (src)
+		cg_destroy(src);
+	free(dst);
+	free(src);
+	return ret;
+}
+
 static void *migrating_thread_fn(void *arg)
 {
 	int g, i, n_iterations = 1000;
@@ -850,6 +927,7 @@ struct corecg_test {
 	T(test_cgcore_invalid_domain),
 	T(test_cgcore_populated),
 	T(test_cgcore_proc_migration),
+	T(test_cgcore_proc_batch_migration),
 	T(test_cgcore_thread_migration),
 	T(test_cgcore_destroy),
 	T(test_cgcore_lesser_euid_open),
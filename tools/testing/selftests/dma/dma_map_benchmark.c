@@ -21,6 +21,12 @@ static char *directions[] = {
 	"FROM_DEVICE",
 };
 
+static char *modes[] = {
+	"SINGLE",
+	"SG",
+	"COHERENT",
+};
+
 int main(int argc, char **argv)
 {
 	struct map_benchmark map;
@@ -31,11 +37,13 @@ int main(int argc, char **argv)
 	int bits = 32, xdelay = 0, dir = DMA_MAP_BIDIRECTIONAL;
 	/* default granule 1 PAGESIZE */
 	int granule = 1;
+	/* default dma_map_single, one segment for dma_map_sg */
+	int mode = DMA_MAP_BENCH_SINGLE, nents = 1;
 
 	int cmd = DMA_MAP_BENCHMARK;
 	char *p;
 
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:m:e:")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -58,6 +66,12 @@ int main(int argc, char **argv)
 		case 'g':
 			granule = atoi(optarg);
 			break;
+		case 'm':
+			mode = atoi(optarg);
+			break;
+		case 'e':
+			nents = atoi(optarg);
+			break;
 		default:
 			return -1;
 		}
@@ -98,6 +112,19 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (mode != DMA_MAP_BENCH_SINGLE && mode != DMA_MAP_BENCH_SG &&
+			mode != DMA_MAP_BENCH_COHERENT) {
+		fprintf(stderr, "invalid benchmark mode\n");
+		exit(1);
+	}
+
+	if (nents < 1 || nents > DMA_MAP_MAX_NENTS ||
+			nents * granule > 1024) {
+		fprintf(stderr, "invalid number of segments, must be in 1-%d and segments * granule <= 1024\n",
+			DMA_MAP_MAX_NENTS);
+		exit(1);
+	}
+
 	fd = open("/sys/kernel/debug/dma_map_benchmark", O_RDWR);
 	if (fd == -1) {
 		perror("open");
@@ -112,18 +139,27 @@ int main(int argc, char **argv)
 	map.dma_dir = dir;
 	map.dma_trans_ns = xdelay;
 	map.granule = granule;
+	map.mode = mode;
+	map.nents = nents;
 
 	if (ioctl(fd, cmd, &map)) {
 		perror("ioctl");
 		exit(1);
 	}
 
-	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d\n",
-			threads, seconds, node, dir[directions], granule);
+	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d mode:%s nents:%d\n",
+			threads, seconds, node, dir[directions], granule,
+			modes[mode], nents);
 	printf("average map latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
+	printf("map latency(us) p50:%.1f p99:%.1f p99.9:%.1f\n",
+			map.map_p50_100ns/10.0, map.map_p99_100ns/10.0,
+			map.map_p999_100ns/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_unmap_100ns/10.0, map.unmap_stddev/10.0);
+	printf("unmap latency(us) p50:%.1f p99:%.1f p99.9:%.1f\n",
+			map.unmap_p50_100ns/10.0, map.unmap_p99_100ns/10.0,
+			map.unmap_p999_100ns/10.0);
 
 	return 0;
 }
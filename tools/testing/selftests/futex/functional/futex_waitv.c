@@ -57,6 +57,19 @@ void *waiterfn(void *arg)
 	return NULL;
 }
 
+static u_int32_t wakev_futexes[2];
+
+void *wakev_waiterfn(void *arg)
+{
+	u_int32_t *uaddr = arg;
+	struct timespec to;
+
+	to.tv_sec = 1;
+	to.tv_nsec = 0;
+
+	return (void *)(long)futex_wait(uaddr, 0, &to, FUTEX_PRIVATE_FLAG);
+}
+
 int main(int argc, char *argv[])
 {
 	pthread_t waiter;
@@ -82,7 +95,7 @@ int main(int argc, char *argv[])
 	}
 
 	ksft_print_header();
-	ksft_set_plan(7);
+	ksft_set_plan(8);
 	ksft_print_msg("%s: Test FUTEX_WAITV\n",
 		       basename(argv[0]));
 
@@ -232,6 +245,40 @@ int main(int argc, char *argv[])
 		ksft_test_result_pass("futex_waitv invalid clockid\n");
 	}
 
+	/* Waking two futexes with a single futex_wakev() */
+	{
+		struct futex_waitv wakev[2];
+		pthread_t waiters[2];
+		void *wret[2];
+
+		for (i = 0; i < 2; i++) {
+			wakev[i].uaddr = (uintptr_t)&wakev_futexes[i];
+			wakev[i].flags = FUTEX_32 | FUTEX_PRIVATE_FLAG;
+			wakev[i].val = 1;
+			wakev[i].__reserved = 0;
+			if (pthread_create(&waiters[i], NULL, wakev_waiterfn,
+					   &wakev_futexes[i]))
+				error("pthread_create failed\n", errno);
+		}
+
+		usleep(WAKE_WAIT_US);
+
+		res = futex_wakev(wakev, 2, 0);
+		for (i = 0; i < 2; i++)
+			pthread_join(waiters[i], &wret[i]);
+
+		if (res < 0 && errno == ENOSYS) {
+			ksft_test_result_skip("futex_wakev not supported\n");
+		} else if (res != 2 || wret[0] || wret[1]) {
+			ksft_test_result_fail("futex_wakev returned: %d %s\n",
+					      res < 0 ? errno : res,
+					      res < 0 ? strerror(errno) : "");
+			ret = RET_FAIL;
+		} else {
+			ksft_test_result_pass("futex_wakev\n");
+		}
+	}
+
 	ksft_print_cnts();
 	return ret;
 }
@@ -12,7 +12,9 @@
 #include <stdlib.h>
 #include <time.h>
 #include <pthread.h>
+#include <sched.h>
 #include <linux/bitmap.h>
+#include <asm/barrier.h>
 
 #include "kvm_util.h"
 #include "test_util.h"
@@ -67,6 +69,25 @@ static bool host_quit;
 static int iteration;
 static int vcpu_last_completed_iteration[KVM_MAX_VCPUS];
 
+/*
+ * Dirty ring mode: instead of fetching the bitmaps after each iteration,
+ * harvester threads keep collecting the vCPUs' dirty rings and resetting
+ * them while the vCPUs run, as live migration does.
+ */
+static uint32_t dirty_ring_count;
+static int nr_harvesters = 1;
+static uint64_t vcpu_ring_full_exits[KVM_MAX_VCPUS];
+
+struct harvester {
+	pthread_t thread;
+	int idx;
+	struct kvm_vm *vm;
+	uint64_t pages;
+	uint64_t resets;
+	struct timespec reset_total;
+	struct timespec reset_max;
+};
+
 static void vcpu_worker(struct memstress_vcpu_args *vcpu_args)
 {
 	struct kvm_vcpu *vcpu = vcpu_args->vcpu;
@@ -86,8 +107,17 @@ static void vcpu_worker(struct memstress_vcpu_args *vcpu_args)
 
 		clock_gettime(CLOCK_MONOTONIC, &start);
 		ret = _vcpu_run(vcpu);
+		/* Wait for the harvesters to make room, then go on dirtying */
+		while (!ret && run->exit_reason == KVM_EXIT_DIRTY_RING_FULL &&
+		       !READ_ONCE(host_quit)) {
+			vcpu_ring_full_exits[vcpu_idx]++;
+			sched_yield();
+			ret = _vcpu_run(vcpu);
+		}
 		ts_diff = timespec_elapsed(start);
 
+		if (!ret && run->exit_reason == KVM_EXIT_DIRTY_RING_FULL)
+			break;
 		TEST_ASSERT(ret == 0, "vcpu_run failed: %d\n", ret);
 		TEST_ASSERT(get_ucall(vcpu, NULL) == UCALL_SYNC,
 			    "Invalid guest sync status: exit_reason=%s\n",
@@ -207,6 +237,92 @@ static void free_bitmaps(unsigned long *bitmaps[], int slots)
 	free(bitmaps);
 }
 
+/* Collect and mark the new entries of one vCPU's ring, return how many */
+static uint32_t harvest_ring(struct kvm_vcpu *vcpu, uint32_t *fetch_index)
+{
+	struct kvm_dirty_gfn *gfns = vcpu_map_dirty_ring(vcpu);
+	struct kvm_dirty_gfn *cur;
+	uint32_t count = 0;
+
+	for (;;) {
+		cur = &gfns[*fetch_index & (dirty_ring_count - 1)];
+		if (smp_load_acquire(&cur->flags) != KVM_DIRTY_GFN_F_DIRTY)
+			break;
+		smp_store_release(&cur->flags, KVM_DIRTY_GFN_F_RESET);
+		(*fetch_index)++;
+		count++;
+	}
+
+	return count;
+}
+
+/* Harvester n takes care of vCPUs n, n + nr_harvesters, ... */
+static void *harvester_fn(void *arg)
+{
+	struct harvester *h = arg;
+	uint32_t fetch_index[KVM_MAX_VCPUS] = { 0 };
+	struct timespec start, ts_diff;
+	uint64_t count;
+	int i;
+
+	while (!READ_ONCE(host_quit)) {
+		count = 0;
+		for (i = h->idx; i < nr_vcpus; i += nr_harvesters)
+			count += harvest_ring(memstress_args.vcpu_args[i].vcpu,
+					      &fetch_index[i]);
+		if (!count) {
+			sched_yield();
+			continue;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		kvm_vm_reset_dirty_ring(h->vm);
+		ts_diff = timespec_elapsed(start);
+
+		h->pages += count;
+		h->resets++;
+		h->reset_total = timespec_add(h->reset_total, ts_diff);
+		if (timespec_to_ns(ts_diff) > timespec_to_ns(h->reset_max))
+			h->reset_max = ts_diff;
+	}
+
+	return NULL;
+}
+
+static void report_harvest(struct harvester *harvesters,
+			   struct timespec runtime)
+{
+	struct timespec reset_total = (struct timespec){0};
+	struct timespec reset_max = (struct timespec){0};
+	uint64_t pages = 0, resets = 0, ring_full = 0;
+	int i;
+
+	for (i = 0; i < nr_harvesters; i++) {
+		pages += harvesters[i].pages;
+		resets += harvesters[i].resets;
+		reset_total = timespec_add(reset_total,
+					   harvesters[i].reset_total);
+		if (timespec_to_ns(harvesters[i].reset_max) >
+		    timespec_to_ns(reset_max))
+			reset_max = harvesters[i].reset_max;
+	}
+	for (i = 0; i < nr_vcpus; i++)
+		ring_full += vcpu_ring_full_exits[i];
+
+	pr_info("Harvested %lu pages in %ld.%.9lds (%lu pages/s) with %d threads\n",
+		pages, runtime.tv_sec, runtime.tv_nsec,
+		timespec_to_ns(runtime) ?
+		pages * NSEC_PER_SEC / timespec_to_ns(runtime) : 0,
+		nr_harvesters);
+	pr_info("Dirty ring full exits: %lu\n", ring_full);
+	if (resets) {
+		reset_total = timespec_div(reset_total, resets);
+		pr_info("Reset dirty rings %lu times, avg %ld.%.9lds, max %ld.%.9lds\n",
+			resets, reset_total.tv_sec, reset_total.tv_nsec,
+			reset_max.tv_sec, reset_max.tv_nsec);
+	}
+}
+
 static void run_test(enum vm_guest_mode mode, void *arg)
 {
 	struct test_params *p = arg;
@@ -221,8 +337,14 @@ static void run_test(enum vm_guest_mode mode, void *arg)
 	struct timespec vcpu_dirty_total = (struct timespec){0};
 	struct timespec avg;
 	struct timespec clear_dirty_log_total = (struct timespec){0};
+	struct timespec harvest_start;
+	struct harvester *harvesters = NULL;
 	int i;
 
+	if (dirty_ring_count)
+		memstress_args.dirty_ring_size = dirty_ring_count *
+						 sizeof(struct kvm_dirty_gfn);
+
 	vm = memstress_create_vm(mode, nr_vcpus, guest_percpu_mem_size,
 				 p->slots, p->backing_src,
 				 p->partition_vcpu_memory_access);
@@ -282,6 +404,18 @@ static void run_test(enum vm_guest_mode mode, void *arg)
 	pr_info("Enabling dirty logging time: %ld.%.9lds\n\n",
 		ts_diff.tv_sec, ts_diff.tv_nsec);
 
+	if (dirty_ring_count) {
+		harvesters = calloc(nr_harvesters, sizeof(*harvesters));
+		TEST_ASSERT(harvesters, "Failed to allocate harvesters.");
+		clock_gettime(CLOCK_MONOTONIC, &harvest_start);
+		for (i = 0; i < nr_harvesters; i++) {
+			harvesters[i].idx = i;
+			harvesters[i].vm = vm;
+			pthread_create(&harvesters[i].thread, NULL,
+				       harvester_fn, &harvesters[i]);
+		}
+	}
+
 	memstress_set_write_percent(vm, p->write_percent);
 	memstress_set_random_access(vm, p->random_access);
 
@@ -305,6 +439,10 @@ static void run_test(enum vm_guest_mode mode, void *arg)
 		pr_info("Iteration %d dirty memory time: %ld.%.9lds\n",
 			iteration, ts_diff.tv_sec, ts_diff.tv_nsec);
 
+		/* The harvesters collect as the vCPUs go */
+		if (dirty_ring_count)
+			continue;
+
 		clock_gettime(CLOCK_MONOTONIC, &start);
 		get_dirty_log(vm, bitmaps, p->slots);
 		ts_diff = timespec_elapsed(start);
@@ -347,6 +485,15 @@ static void run_test(enum vm_guest_mode mode, void *arg)
 	host_quit = true;
 	memstress_join_vcpu_threads(nr_vcpus);
 
+	if (dirty_ring_count) {
+		ts_diff = timespec_elapsed(harvest_start);
+		for (i = 0; i < nr_harvesters; i++)
+			pthread_join(harvesters[i].thread, NULL);
+		report_harvest(harvesters, ts_diff);
+		free(harvesters);
+		goto out;
+	}
+
 	avg = timespec_div(get_dirty_log_total, p->iterations);
 	pr_info("Get dirty log over %lu iterations took %ld.%.9lds. (Avg %ld.%.9lds/iteration)\n",
 		p->iterations, get_dirty_log_total.tv_sec,
@@ -359,6 +506,7 @@ static void run_test(enum vm_guest_mode mode, void *arg)
 			clear_dirty_log_total.tv_nsec, avg.tv_sec, avg.tv_nsec);
 	}
 
+out:
 	free_bitmaps(bitmaps, p->slots);
 	arch_cleanup_vm(vm);
 	memstress_destroy_vm(vm);
@@ -369,7 +517,8 @@ static void help(char *name)
 	puts("");
 	printf("usage: %s [-h] [-a] [-i iterations] [-p offset] [-g] "
 	       "[-m mode] [-n] [-b vcpu bytes] [-v vcpus] [-o] [-r random seed ] [-s mem type]"
-	       "[-x memslots] [-w percentage] [-c physical cpus to run test on]\n", name);
+	       "[-x memslots] [-w percentage] [-c physical cpus to run test on]"
+	       "[-R ring entries] [-H harvesters]\n", name);
 	puts("");
 	printf(" -a: access memory randomly rather than in order.\n");
 	printf(" -i: specify iteration counts (default: %"PRIu64")\n",
@@ -413,6 +562,10 @@ static void help(char *name)
 	       "     To leave the application task unpinned, drop the final entry:\n\n"
 	       "         ./dirty_log_perf_test -v 3 -c 22,23,24\n\n"
 	       "     (default: no pinning)\n");
+	printf(" -R: Use a dirty ring of this many entries per vCPU instead of\n"
+	       "     the dirty bitmap; rounded down to a power of two.\n");
+	printf(" -H: specify the number of threads harvesting the dirty rings\n"
+	       "     while the vCPUs run. (default: 1)\n");
 	puts("");
 	exit(0);
 }
@@ -438,7 +591,7 @@ int main(int argc, char *argv[])
 
 	guest_modes_append_default();
 
-	while ((opt = getopt(argc, argv, "ab:c:eghi:m:nop:r:s:v:x:w:")) != -1) {
+	while ((opt = getopt(argc, argv, "ab:c:eghH:i:m:nop:r:R:s:v:x:w:")) != -1) {
 		switch (opt) {
 		case 'a':
 			p.random_access = true;
@@ -459,6 +612,9 @@ int main(int argc, char *argv[])
 		case 'h':
 			help(argv[0]);
 			break;
+		case 'H':
+			nr_harvesters = atoi_positive("Number of harvesters", optarg);
+			break;
 		case 'i':
 			p.iterations = atoi_positive("Number of iterations", optarg);
 			break;
@@ -477,6 +633,10 @@ int main(int argc, char *argv[])
 		case 'r':
 			p.random_seed = atoi_positive("Random seed", optarg);
 			break;
+		case 'R':
+			dirty_ring_count = atoi_positive("Dirty ring entries", optarg);
+			dirty_ring_count = 1 << (31 - __builtin_clz(dirty_ring_count));
+			break;
 		case 's':
 			p.backing_src = parse_backing_src_type(optarg);
 			break;
@@ -507,6 +667,14 @@ int main(int argc, char *argv[])
 
 	TEST_ASSERT(p.iterations >= 2, "The test should have at least two iterations");
 
+	if (dirty_ring_count) {
+		__TEST_REQUIRE(kvm_has_cap(KVM_CAP_DIRTY_LOG_RING) ||
+			       kvm_has_cap(KVM_CAP_DIRTY_LOG_RING_ACQ_REL),
+			       "Dirty ring not supported");
+		/* Manual protection only applies to the bitmap */
+		dirty_log_manual_caps = 0;
+	}
+
 	pr_info("Test iterations: %"PRIu64"\n",	p.iterations);
 
 	for_each_guest_mode(run_test, &p);
@@ -42,6 +42,8 @@ struct memstress_args {
 	bool nested;
 	/* Randomize which pages are accessed by the guest. */
 	bool random_access;
+	/* If non-zero, the size in bytes of each vCPU's dirty ring. */
+	uint32_t dirty_ring_size;
 	/* True if all vCPUs are pinned to pCPUs */
 	bool pin_vcpus;
 	/* The vCPU=>pCPU pinning map. Only valid if pin_vcpus is true. */
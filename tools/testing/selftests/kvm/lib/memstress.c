@@ -164,8 +164,14 @@ struct kvm_vm *memstress_create_vm(enum vm_guest_mode mode, int nr_vcpus,
 	 * The memory is also added to memslot 0, but that's a benign side
 	 * effect as KVM allows aliasing HVAs in meslots.
 	 */
-	vm = __vm_create_with_vcpus(mode, nr_vcpus, slot0_pages + guest_num_pages,
-				    memstress_guest_code, vcpus);
+	vm = __vm_create(mode, nr_vcpus, slot0_pages + guest_num_pages);
+
+	/* The dirty ring can only be enabled before any vCPU is created. */
+	if (args->dirty_ring_size)
+		vm_enable_dirty_ring(vm, args->dirty_ring_size);
+
+	for (i = 0; i < nr_vcpus; i++)
+		vcpus[i] = vm_vcpu_add(vm, i, memstress_guest_code);
 
 	args->vm = vm;
 
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/errqueue.h>
+#include <sys/socket.h>
+
+#include "../../kselftest_harness.h"
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY	60
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY	0x4000000
+#endif
+
+#define BUF_SIZE	(64 * 1024)
+
+FIXTURE(msg_zerocopy)
+{
+	int fd[2];
+	char buf[BUF_SIZE];
+	char rcv[BUF_SIZE];
+};
+
+FIXTURE_SETUP(msg_zerocopy)
+{
+	int one = 1;
+	int ret;
+
+	ret = socketpair(AF_UNIX, SOCK_STREAM, 0, self->fd);
+	ASSERT_EQ(0, ret);
+
+	ret = setsockopt(self->fd[0], SOL_SOCKET, SO_ZEROCOPY,
+			 &one, sizeof(one));
+	ASSERT_EQ(0, ret);
+
+	memset(self->buf, 'a', sizeof(self->buf));
+}
+
+FIXTURE_TEARDOWN(msg_zerocopy)
+{
+	close(self->fd[0]);
+	close(self->fd[1]);
+}
+
+/* Wait for the completion of the sends lo..hi and return its ee_code. */
+static int wait_completion(struct __test_metadata *_metadata, int fd,
+			   __u32 lo, __u32 hi)
+{
+	char control[CMSG_SPACE(sizeof(struct sock_extended_err))];
+	struct pollfd pfd = { .fd = fd };
+	struct sock_extended_err *serr;
+	struct msghdr msg = {
+		.msg_control = control,
+		.msg_controllen = sizeof(control),
+	};
+	struct cmsghdr *cm;
+	int ret;
+
+	ret = poll(&pfd, 1, 1000);
+	ASSERT_EQ(1, ret);
+	ASSERT_TRUE(pfd.revents & POLLERR);
+
+	ret = recvmsg(fd, &msg, MSG_ERRQUEUE);
+	ASSERT_EQ(0, ret);
+
+	cm = CMSG_FIRSTHDR(&msg);
+	ASSERT_NE(NULL, cm);
+	ASSERT_EQ(SOL_SOCKET, cm->cmsg_level);
+	ASSERT_EQ(SO_ZEROCOPY, cm->cmsg_type);
+
+	serr = (struct sock_extended_err *)CMSG_DATA(cm);
+	ASSERT_EQ(0, serr->ee_errno);
+	ASSERT_EQ(SO_EE_ORIGIN_ZEROCOPY, serr->ee_origin);
+	ASSERT_EQ(lo, serr->ee_info);
+	ASSERT_EQ(hi, serr->ee_data);
+
+	return serr->ee_code;
+}
+
+TEST_F(msg_zerocopy, setsockopt)
+{
+	int one = 1, val = 0;
+	socklen_t len = sizeof(val);
+	int fd, ret;
+
+	ret = getsockopt(self->fd[0], SOL_SOCKET, SO_ZEROCOPY, &val, &len);
+	ASSERT_EQ(0, ret);
+	ASSERT_EQ(1, val);
+
+	val = 2;
+	ret = setsockopt(self->fd[0], SOL_SOCKET, SO_ZEROCOPY,
+			 &val, sizeof(val));
+	ASSERT_EQ(-1, ret);
+	ASSERT_EQ(EINVAL, errno);
+
+	/* Other SOL_SOCKET options still work on stream sockets */
+	ret = setsockopt(self->fd[0], SOL_SOCKET, SO_PASSCRED,
+			 &one, sizeof(one));
+	ASSERT_EQ(0, ret);
+
+	/* Datagram sockets don't support it */
+	fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	ASSERT_LE(0, fd);
+
+	ret = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one));
+	ASSERT_EQ(-1, ret);
+	ASSERT_EQ(EOPNOTSUPP, errno);
+
+	close(fd);
+}
+
+TEST_F(msg_zerocopy, recv)
+{
+	int i, ret;
+
+	for (i = 0; i < 2; i++) {
+		ret = send(self->fd[0], self->buf, sizeof(self->buf),
+			   MSG_ZEROCOPY);
+		ASSERT_EQ(sizeof(self->buf), ret);
+
+		ret = recv(self->fd[1], self->rcv, sizeof(self->rcv),
+			   MSG_WAITALL);
+		ASSERT_EQ(sizeof(self->rcv), ret);
+		ASSERT_EQ(0, memcmp(self->buf, self->rcv, sizeof(self->rcv)));
+
+		wait_completion(_metadata, self->fd[0], i, i);
+	}
+}
+
+/* Spliced data must not change when the sender reuses its buffer. */
+TEST_F(msg_zerocopy, splice)
+{
+	size_t done = 0;
+	int pipefd[2];
+	ssize_t ret;
+
+	ASSERT_EQ(0, pipe(pipefd));
+	ASSERT_LE(BUF_SIZE, fcntl(pipefd[1], F_SETPIPE_SZ, BUF_SIZE));
+
+	ret = send(self->fd[0], self->buf, sizeof(self->buf), MSG_ZEROCOPY);
+	ASSERT_EQ(sizeof(self->buf), ret);
+
+	while (done < sizeof(self->buf)) {
+		ret = splice(self->fd[1], NULL, pipefd[1], NULL,
+			     sizeof(self->buf) - done, 0);
+		ASSERT_LT(0, ret);
+		done += ret;
+	}
+
+	wait_completion(_metadata, self->fd[0], 0, 0);
+	memset(self->buf, 'b', sizeof(self->buf));
+
+	ret = read(pipefd[0], self->rcv, sizeof(self->rcv));
+	ASSERT_EQ(sizeof(self->rcv), ret);
+	memset(self->buf, 'a', sizeof(self->buf));
+	ASSERT_EQ(0, memcmp(self->buf, self->rcv, sizeof(self->rcv)));
+
+	close(pipefd[0]);
+	close(pipefd[1]);
+}
+
+TEST_HARNESS_MAIN
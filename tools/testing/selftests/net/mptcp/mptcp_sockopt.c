@@ -81,6 +81,10 @@ struct mptcp_subflow_addrs {
 #define MPTCP_SUBFLOW_ADDRS	3
 #endif
 
+#ifndef MPTCP_SCHEDULER
+#define MPTCP_SCHEDULER		4
+#endif
+
 struct so_state {
 	struct mptcp_info mi;
 	uint64_t mptcpi_rcv_delta;
@@ -634,6 +638,31 @@ static void test_ip_tos_sockopt(int fd)
 		xerror("expect socklen_t == -1");
 }
 
+static void test_scheduler_sockopt(int fd)
+{
+	static const char sched[] = "roundrobin";
+	char name[16];
+	socklen_t s;
+	int r;
+
+	r = setsockopt(fd, SOL_MPTCP, MPTCP_SCHEDULER, "bogus", 5);
+	if (r != -1 || errno != ENOENT)
+		xerror("setsockopt MPTCP_SCHEDULER bogus: %d errno %d", r, errno);
+
+	r = setsockopt(fd, SOL_MPTCP, MPTCP_SCHEDULER, sched, strlen(sched));
+	if (r != 0)
+		die_perror("setsockopt MPTCP_SCHEDULER");
+
+	memset(name, 0, sizeof(name));
+	s = sizeof(name);
+	r = getsockopt(fd, SOL_MPTCP, MPTCP_SCHEDULER, name, &s);
+	if (r != 0)
+		die_perror("getsockopt MPTCP_SCHEDULER");
+
+	if (strcmp(name, sched))
+		xerror("scheduler %s != %s", name, sched);
+}
+
 static int client(int pipefd)
 {
 	int fd = -1;
@@ -652,6 +681,7 @@ static int client(int pipefd)
 	}
 
 	test_ip_tos_sockopt(fd);
+	test_scheduler_sockopt(fd);
 
 	connect_one_server(fd, pipefd);
 
@@ -21,6 +21,7 @@
  *	/proc/${pid}/numa_maps
  *	/proc/${pid}/smaps
  *	/proc/${pid}/smaps_rollup
+ *	/proc/${pid}/smaps_summary
  */
 #undef NDEBUG
 #include <assert.h>
@@ -36,6 +37,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <linux/smaps_summary.h>
 
 /*
  * 0: vsyscall VMA doesn't exist	vsyscall=none
@@ -295,6 +297,46 @@ static int test_proc_pid_smaps_rollup(pid_t pid)
 	}
 }
 
+static int test_proc_pid_smaps_summary(pid_t pid)
+{
+	const uint64_t mask = (1ULL << SMAPS_SUMMARY_RSS) |
+			      (1ULL << SMAPS_SUMMARY_PSS) |
+			      (1ULL << SMAPS_SUMMARY_SWAP_PSS);
+	struct {
+		struct smaps_summary hdr;
+		uint64_t values[3];
+	} sum;
+	char buf[64];
+	snprintf(buf, sizeof(buf), "/proc/%u/smaps_summary", pid);
+	int fd = open(buf, O_RDWR);
+	if (fd == -1) {
+		if (errno == ENOENT) {
+			/*
+			 * /proc/${pid}/smaps_summary is under CONFIG_PROC_PAGE_MONITOR,
+			 * it doesn't necessarily exist.
+			 */
+			return EXIT_SUCCESS;
+		}
+		perror("open /proc/${pid}/smaps_summary");
+		return EXIT_FAILURE;
+	} else {
+		assert(write(fd, &mask, sizeof(mask)) == sizeof(mask));
+		ssize_t rv = read(fd, &sum, sizeof(sum));
+		assert(rv == sizeof(sum));
+		assert(sum.hdr.version == SMAPS_SUMMARY_VERSION);
+		assert(sum.hdr.size == sizeof(sum));
+		assert(sum.hdr.mask == mask);
+		assert(sum.values[0] == 0);
+		assert(sum.values[1] == 0);
+		assert(sum.values[2] == 0);
+		/* Nothing past the summary, which can be read again from 0. */
+		assert(read(fd, &sum, sizeof(sum)) == 0);
+		assert(pread(fd, &sum, sizeof(sum), 0) == sizeof(sum));
+		close(fd);
+		return EXIT_SUCCESS;
+	}
+}
+
 int main(void)
 {
 	int rv = EXIT_SUCCESS;
@@ -371,6 +413,9 @@ int main(void)
 		if (rv == EXIT_SUCCESS) {
 			rv = test_proc_pid_smaps_rollup(pid);
 		}
+		if (rv == EXIT_SUCCESS) {
+			rv = test_proc_pid_smaps_summary(pid);
+		}
 		/*
 		 * TODO test /proc/${pid}/statm, task_statm()
 		 * ->start_code, ->end_code aren't updated by munmap().
@@ -5,7 +5,9 @@
 #include <fcntl.h>
 #include <stdint.h>
 #include <malloc.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <linux/fs.h>
 #include "../kselftest.h"
 #include "vm_util.h"
 
@@ -184,13 +186,62 @@ static void test_mprotect_file(int pagemap_fd, int pagesize)
 	test_mprotect(pagemap_fd, pagesize, false);
 }
 
+static long pagemap_scan_dirty(int pagemap_fd, char *start, char *end,
+			       struct page_region *vec, int vec_len)
+{
+	struct pm_scan_arg arg = {
+		.size = sizeof(arg),
+		.flags = PM_SCAN_CLEAR_SOFT_DIRTY,
+		.start = (uintptr_t)start,
+		.end = (uintptr_t)end,
+		.vec = (uintptr_t)vec,
+		.vec_len = vec_len,
+		.category_mask = PAGE_IS_SOFT_DIRTY,
+		.return_mask = PAGE_IS_SOFT_DIRTY,
+	};
+
+	return ioctl(pagemap_fd, PAGEMAP_SCAN, &arg);
+}
+
+static void test_pagemap_scan(int pagemap_fd, int pagesize)
+{
+	struct page_region vec[4];
+	char *map;
+	long ret;
+	int i;
+
+	map = mmap(NULL, 4 * pagesize, PROT_READ|PROT_WRITE,
+		   MAP_ANONYMOUS|MAP_PRIVATE, -1, 0);
+	if (map == MAP_FAILED)
+		ksft_exit_fail_msg("anon mmap failed\n");
+
+	for (i = 0; i < 4; i++)
+		map[i * pagesize] = 1;
+	clear_softdirty();
+	map[1 * pagesize] = 2;
+	map[2 * pagesize] = 2;
+
+	ret = pagemap_scan_dirty(pagemap_fd, map, map + 4 * pagesize, vec, 4);
+	ksft_test_result(ret == 1 &&
+			 vec[0].start == (uintptr_t)(map + pagesize) &&
+			 vec[0].end == (uintptr_t)(map + 3 * pagesize) &&
+			 vec[0].categories == PAGE_IS_SOFT_DIRTY,
+			 "Test %s reports written pages\n", __func__);
+
+	ret = pagemap_scan_dirty(pagemap_fd, map, map + 4 * pagesize, vec, 4);
+	ksft_test_result(ret == 0 && !pagemap_is_softdirty(pagemap_fd, map + pagesize),
+			 "Test %s clears soft-dirty\n", __func__);
+
+	munmap(map, 4 * pagesize);
+}
+
 int main(int argc, char **argv)
 {
 	int pagemap_fd;
 	int pagesize;
 
 	ksft_print_header();
-	ksft_set_plan(15);
+	ksft_set_plan(17);
 
 	pagemap_fd = open(PAGEMAP_FILE_PATH, O_RDONLY);
 	if (pagemap_fd < 0)
@@ -203,6 +254,7 @@ int main(int argc, char **argv)
 	test_hugepage(pagemap_fd, pagesize);
 	test_mprotect_anon(pagemap_fd, pagesize);
 	test_mprotect_file(pagemap_fd, pagesize);
+	test_pagemap_scan(pagemap_fd, pagesize);
 
 	close(pagemap_fd);
 
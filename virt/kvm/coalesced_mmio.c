@@ -61,6 +61,34 @@ static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_dev *dev, u32 last)
 	return 1;
 }
 
+/*
+ * The per-vCPU ring is only ever written by its own vCPU, so no lock is
+ * needed.  The VMM merges the rings of all vCPUs in ->seq order.
+ */
+static int coalesced_mmio_write_vcpu(struct kvm_vcpu *vcpu,
+				     struct kvm_coalesced_mmio_dev *dev,
+				     gpa_t addr, int len, const void *val)
+{
+	struct kvm_coalesced_mmio_vcpu_ring *ring = vcpu->coalesced_mmio_ring;
+	struct kvm_coalesced_mmio_seq *entry;
+	__u32 insert;
+
+	insert = READ_ONCE(ring->last);
+	if (insert >= KVM_COALESCED_MMIO_VCPU_MAX ||
+	    (READ_ONCE(ring->first) - insert - 1) % KVM_COALESCED_MMIO_VCPU_MAX == 0)
+		return -EOPNOTSUPP;
+
+	entry = &ring->coalesced_mmio[insert];
+	entry->phys_addr = addr;
+	entry->len = len;
+	memcpy(entry->data, val, len);
+	entry->pio = dev->zone.pio;
+	entry->seq = atomic64_inc_return(&dev->kvm->coalesced_mmio_seq);
+	smp_wmb();
+	ring->last = (insert + 1) % KVM_COALESCED_MMIO_VCPU_MAX;
+	return 0;
+}
+
 static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
 				struct kvm_io_device *this, gpa_t addr,
 				int len, const void *val)
@@ -72,6 +100,9 @@ static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
 	if (!coalesced_mmio_in_range(dev, addr, len))
 		return -EOPNOTSUPP;
 
+	if (vcpu && vcpu->coalesced_mmio_ring)
+		return coalesced_mmio_write_vcpu(vcpu, dev, addr, len, val);
+
 	spin_lock(&dev->kvm->ring_lock);
 
 	insert = READ_ONCE(ring->last);
@@ -134,6 +165,43 @@ void kvm_coalesced_mmio_free(struct kvm *kvm)
 		free_page((unsigned long)kvm->coalesced_mmio_ring);
 }
 
+int kvm_coalesced_mmio_vcpu_init(struct kvm_vcpu *vcpu)
+{
+	struct page *page;
+
+	if (!vcpu->kvm->coalesced_mmio_vcpu_ring)
+		return 0;
+
+	page = alloc_page(GFP_KERNEL_ACCOUNT | __GFP_ZERO);
+	if (!page)
+		return -ENOMEM;
+
+	vcpu->coalesced_mmio_ring = page_address(page);
+	return 0;
+}
+
+void kvm_coalesced_mmio_vcpu_free(struct kvm_vcpu *vcpu)
+{
+	if (vcpu->coalesced_mmio_ring)
+		free_page((unsigned long)vcpu->coalesced_mmio_ring);
+	vcpu->coalesced_mmio_ring = NULL;
+}
+
+int kvm_vm_ioctl_enable_coalesced_mmio_vcpu_ring(struct kvm *kvm)
+{
+	int r = 0;
+
+	mutex_lock(&kvm->lock);
+	/* vCPUs created earlier would have no ring */
+	if (kvm->created_vcpus)
+		r = -EINVAL;
+	else
+		kvm->coalesced_mmio_vcpu_ring = true;
+	mutex_unlock(&kvm->lock);
+
+	return r;
+}
+
 int kvm_vm_ioctl_register_coalesced_mmio(struct kvm *kvm,
 					 struct kvm_coalesced_mmio_zone *zone)
 {
@@ -50,11 +50,20 @@ static bool kvm_dirty_ring_full(struct kvm_dirty_ring *ring)
 	return kvm_dirty_ring_used(ring) >= ring->size;
 }
 
-static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
+/*
+ * Write-protect (or clear dirty bits for) a run of harvested GFNs.  mmu_lock
+ * is taken on the first run and then held across all runs of a ring, so that
+ * a ring full of scattered GFNs doesn't bounce the lock once per run.
+ */
+static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask,
+				bool *locked)
 {
 	struct kvm_memory_slot *memslot;
 	int as_id, id;
 
+	if (!mask)
+		return;
+
 	as_id = slot >> 16;
 	id = (u16)slot;
 
@@ -66,9 +75,13 @@ static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
 	if (!memslot || (offset + __fls(mask)) >= memslot->npages)
 		return;
 
-	KVM_MMU_LOCK(kvm);
+	if (!*locked) {
+		KVM_MMU_LOCK(kvm);
+		*locked = true;
+	} else {
+		KVM_MMU_COND_RESCHED(kvm);
+	}
 	kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, memslot, offset, mask);
-	KVM_MMU_UNLOCK(kvm);
 }
 
 int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size)
@@ -109,6 +122,7 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 	int count = 0;
 	struct kvm_dirty_gfn *entry;
 	bool first_round = true;
+	bool locked = false;
 
 	/* This is only needed to make compilers happy */
 	cur_slot = cur_offset = mask = 0;
@@ -147,14 +161,16 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 				continue;
 			}
 		}
-		kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+		kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask, &locked);
 		cur_slot = next_slot;
 		cur_offset = next_offset;
 		mask = 1;
 		first_round = false;
 	}
 
-	kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+	kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask, &locked);
+	if (locked)
+		KVM_MMU_UNLOCK(kvm);
 
 	/*
 	 * The request KVM_REQ_DIRTY_RING_SOFT_FULL will be cleared
@@ -187,6 +203,10 @@ void kvm_dirty_ring_push(struct kvm_vcpu *vcpu, u32 slot, u64 offset)
 	ring->dirty_index++;
 	trace_kvm_dirty_ring_push(ring, slot, offset);
 
+	vcpu->stat.generic.dirty_ring_max_used =
+		max_t(u64, vcpu->stat.generic.dirty_ring_max_used,
+		      kvm_dirty_ring_used(ring));
+
 	if (kvm_dirty_ring_soft_full(ring))
 		kvm_make_request(KVM_REQ_DIRTY_RING_SOFT_FULL, vcpu);
 }
@@ -203,6 +223,7 @@ bool kvm_dirty_ring_check_request(struct kvm_vcpu *vcpu)
 	    kvm_dirty_ring_soft_full(&vcpu->dirty_ring)) {
 		kvm_make_request(KVM_REQ_DIRTY_RING_SOFT_FULL, vcpu);
 		vcpu->run->exit_reason = KVM_EXIT_DIRTY_RING_FULL;
+		++vcpu->stat.generic.dirty_ring_full_exits;
 		trace_kvm_dirty_ring_exit(vcpu);
 		return true;
 	}
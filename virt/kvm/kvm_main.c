@@ -494,6 +494,7 @@ static void kvm_vcpu_destroy(struct kvm_vcpu *vcpu)
 {
 	kvm_arch_vcpu_destroy(vcpu);
 	kvm_dirty_ring_free(&vcpu->dirty_ring);
+	kvm_coalesced_mmio_vcpu_free(vcpu);
 
 	/*
 	 * No need for rcu_read_lock as VCPU_RUN is the only place that changes
@@ -1151,7 +1152,7 @@ static struct kvm *kvm_create_vm(unsigned long type, const char *fdname)
 	rcuwait_init(&kvm->mn_memslots_update_rcuwait);
 	xa_init(&kvm->vcpu_array);
 
-	INIT_LIST_HEAD(&kvm->gpc_list);
+	kvm->gpc_tree = RB_ROOT_CACHED;
 	spin_lock_init(&kvm->gpc_lock);
 
 	INIT_LIST_HEAD(&kvm->devices);
@@ -3814,6 +3815,9 @@ static vm_fault_t kvm_vcpu_fault(struct vm_fault *vmf)
 #ifdef CONFIG_KVM_MMIO
 	else if (vmf->pgoff == KVM_COALESCED_MMIO_PAGE_OFFSET)
 		page = virt_to_page(vcpu->kvm->coalesced_mmio_ring);
+	else if (vmf->pgoff == KVM_COALESCED_MMIO_PAGE_OFFSET + 1 &&
+		 vcpu->coalesced_mmio_ring)
+		page = virt_to_page(vcpu->coalesced_mmio_ring);
 #endif
 	else if (kvm_page_in_dirty_ring(vcpu->kvm, vmf->pgoff))
 		page = kvm_dirty_ring_get_page(
@@ -3953,6 +3957,10 @@ static int kvm_vm_ioctl_create_vcpu(struct kvm *kvm, u32 id)
 			goto arch_vcpu_destroy;
 	}
 
+	r = kvm_coalesced_mmio_vcpu_init(vcpu);
+	if (r)
+		goto dirty_ring_free;
+
 	mutex_lock(&kvm->lock);
 
 #ifdef CONFIG_LOCKDEP
@@ -3995,6 +4003,8 @@ static int kvm_vm_ioctl_create_vcpu(struct kvm *kvm, u32 id)
 
 unlock_vcpu_destroy:
 	mutex_unlock(&kvm->lock);
+	kvm_coalesced_mmio_vcpu_free(vcpu);
+dirty_ring_free:
 	kvm_dirty_ring_free(&vcpu->dirty_ring);
 arch_vcpu_destroy:
 	kvm_arch_vcpu_destroy(vcpu);
@@ -4058,6 +4068,58 @@ static int kvm_vcpu_ioctl_get_stats_fd(struct kvm_vcpu *vcpu)
 	return fd;
 }
 
+#ifdef CONFIG_HAVE_KVM_PRE_FAULT_MEMORY
+/*
+ * Map @range into the vCPU's MMU ahead of time, so that a large guest doesn't
+ * have to take a fault for every page when it first touches its memory.  The
+ * ioctl is per vCPU, so populating a big memslot can be spread across vCPU
+ * threads, each working on its own part of the range.
+ */
+static int kvm_vcpu_pre_fault_memory(struct kvm_vcpu *vcpu,
+				     struct kvm_pre_fault_memory *range)
+{
+	u64 full_size;
+	long r = 0;
+	int idx;
+
+	if (range->flags)
+		return -EINVAL;
+
+	if (!PAGE_ALIGNED(range->gpa) ||
+	    !PAGE_ALIGNED(range->size) ||
+	    range->gpa + range->size <= range->gpa)
+		return -EINVAL;
+
+	vcpu_load(vcpu);
+	idx = srcu_read_lock(&vcpu->kvm->srcu);
+
+	full_size = range->size;
+	do {
+		if (signal_pending(current)) {
+			r = -EINTR;
+			break;
+		}
+
+		/* returns the number of bytes mapped starting at range->gpa */
+		r = kvm_arch_vcpu_pre_fault_memory(vcpu, range);
+		if (WARN_ON_ONCE(r == 0))
+			r = -EIO;
+		if (r < 0)
+			break;
+
+		range->size -= r;
+		range->gpa += r;
+		cond_resched();
+	} while (range->size);
+
+	srcu_read_unlock(&vcpu->kvm->srcu, idx);
+	vcpu_put(vcpu);
+
+	/* Return success if at least one page was mapped successfully.  */
+	return full_size == range->size ? r : 0;
+}
+#endif
+
 static long kvm_vcpu_ioctl(struct file *filp,
 			   unsigned int ioctl, unsigned long arg)
 {
@@ -4259,6 +4321,20 @@ static long kvm_vcpu_ioctl(struct file *filp,
 		r = kvm_vcpu_ioctl_get_stats_fd(vcpu);
 		break;
 	}
+#ifdef CONFIG_HAVE_KVM_PRE_FAULT_MEMORY
+	case KVM_PRE_FAULT_MEMORY: {
+		struct kvm_pre_fault_memory range;
+
+		r = -EFAULT;
+		if (copy_from_user(&range, argp, sizeof(range)))
+			break;
+		r = kvm_vcpu_pre_fault_memory(vcpu, &range);
+		/* Pass back leftover range. */
+		if (copy_to_user(argp, &range, sizeof(range)))
+			r = -EFAULT;
+		break;
+	}
+#endif
 	default:
 		r = kvm_arch_vcpu_ioctl(filp, ioctl, arg);
 	}
@@ -4497,6 +4573,8 @@ static long kvm_vm_ioctl_check_extension_generic(struct kvm *kvm, long arg)
 #ifdef CONFIG_KVM_MMIO
 	case KVM_CAP_COALESCED_MMIO:
 		return KVM_COALESCED_MMIO_PAGE_OFFSET;
+	case KVM_CAP_COALESCED_MMIO_VCPU_RING:
+		return KVM_COALESCED_MMIO_PAGE_OFFSET + 1;
 	case KVM_CAP_COALESCED_PIO:
 		return 1;
 #endif
@@ -4531,6 +4609,9 @@ static long kvm_vm_ioctl_check_extension_generic(struct kvm *kvm, long arg)
 #endif
 	case KVM_CAP_BINARY_STATS_FD:
 	case KVM_CAP_SYSTEM_EVENT_DATA:
+#ifdef CONFIG_HAVE_KVM_PRE_FAULT_MEMORY
+	case KVM_CAP_PRE_FAULT_MEMORY:
+#endif
 		return 1;
 	default:
 		break;
@@ -4587,8 +4668,12 @@ static int kvm_vm_ioctl_reset_dirty_pages(struct kvm *kvm)
 
 	mutex_lock(&kvm->slots_lock);
 
-	kvm_for_each_vcpu(i, vcpu, kvm)
-		cleared += kvm_dirty_ring_reset(vcpu->kvm, &vcpu->dirty_ring);
+	kvm_for_each_vcpu(i, vcpu, kvm) {
+		int count = kvm_dirty_ring_reset(vcpu->kvm, &vcpu->dirty_ring);
+
+		vcpu->stat.generic.dirty_ring_harvested += count;
+		cleared += count;
+	}
 
 	mutex_unlock(&kvm->slots_lock);
 
@@ -4634,6 +4719,12 @@ static int kvm_vm_ioctl_enable_cap_generic(struct kvm *kvm,
 		kvm->manual_dirty_log_protect = cap->args[0];
 		return 0;
 	}
+#endif
+#ifdef CONFIG_KVM_MMIO
+	case KVM_CAP_COALESCED_MMIO_VCPU_RING:
+		if (cap->flags || cap->args[0])
+			return -EINVAL;
+		return kvm_vm_ioctl_enable_coalesced_mmio_vcpu_ring(kvm);
 #endif
 	case KVM_CAP_HALT_POLL: {
 		if (cap->flags || cap->args[0] != (unsigned int)cap->args[0])
@@ -5076,6 +5167,7 @@ static long kvm_dev_ioctl(struct file *filp,
 #endif
 #ifdef CONFIG_KVM_MMIO
 		r += PAGE_SIZE;    /* coalesced mmio ring page */
+		r += PAGE_SIZE;    /* per-vCPU coalesced mmio ring page */
 #endif
 		break;
 	case KVM_TRACE_ENABLE:
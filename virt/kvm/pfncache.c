@@ -26,11 +26,14 @@ void gfn_to_pfn_cache_invalidate_start(struct kvm *kvm, unsigned long start,
 				       unsigned long end, bool may_block)
 {
 	DECLARE_BITMAP(vcpu_bitmap, KVM_MAX_VCPUS);
+	struct interval_tree_node *node;
 	struct gfn_to_pfn_cache *gpc;
 	bool evict_vcpus = false;
 
 	spin_lock(&kvm->gpc_lock);
-	list_for_each_entry(gpc, &kvm->gpc_list, list) {
+	for (node = interval_tree_iter_first(&kvm->gpc_tree, start, end - 1);
+	     node; node = interval_tree_iter_next(node, start, end - 1)) {
+		gpc = container_of(node, struct gfn_to_pfn_cache, node);
 		write_lock_irq(&gpc->lock);
 
 		/* Only a single page so no need to care about length */
@@ -109,6 +112,28 @@ static void gpc_unmap_khva(kvm_pfn_t pfn, void *khva)
 	}
 }
 
+/*
+ * Re-key the cache in kvm->gpc_tree if its uHVA changed.  Must be done
+ * before the refresh does its final mmu_notifier retry check: invalidations
+ * that started earlier force a retry, later ones find the cache in the tree.
+ */
+static void gpc_update_tree(struct gfn_to_pfn_cache *gpc)
+{
+	struct kvm *kvm = gpc->kvm;
+
+	lockdep_assert_held(&gpc->refresh_lock);
+
+	if (gpc->node.start == gpc->uhva)
+		return;
+
+	spin_lock(&kvm->gpc_lock);
+	interval_tree_remove(&gpc->node, &kvm->gpc_tree);
+	gpc->node.start = gpc->uhva;
+	gpc->node.last = gpc->uhva;
+	interval_tree_insert(&gpc->node, &kvm->gpc_tree);
+	spin_unlock(&kvm->gpc_lock);
+}
+
 static inline bool mmu_notifier_retry_cache(struct kvm *kvm, unsigned long mmu_seq)
 {
 	/*
@@ -162,6 +187,8 @@ static kvm_pfn_t hva_to_pfn_retry(struct gfn_to_pfn_cache *gpc)
 
 		write_unlock_irq(&gpc->lock);
 
+		gpc_update_tree(gpc);
+
 		/*
 		 * If the previous iteration "failed" due to an mmu_notifier
 		 * event, release the pfn and unmap the kernel virtual address
@@ -362,12 +389,16 @@ int kvm_gpc_activate(struct gfn_to_pfn_cache *gpc, gpa_t gpa, unsigned long len)
 		if (KVM_BUG_ON(gpc->valid, kvm))
 			return -EIO;
 
+		mutex_lock(&gpc->refresh_lock);
 		spin_lock(&kvm->gpc_lock);
-		list_add(&gpc->list, &kvm->gpc_list);
+		gpc->node.start = gpc->uhva;
+		gpc->node.last = gpc->uhva;
+		interval_tree_insert(&gpc->node, &kvm->gpc_tree);
 		spin_unlock(&kvm->gpc_lock);
+		mutex_unlock(&gpc->refresh_lock);
 
 		/*
-		 * Activate the cache after adding it to the list, a concurrent
+		 * Activate the cache after adding it to the tree, a concurrent
 		 * refresh must not establish a mapping until the cache is
 		 * reachable by mmu_notifier events.
 		 */
@@ -399,7 +430,7 @@ void kvm_gpc_deactivate(struct gfn_to_pfn_cache *gpc)
 		 * Leave the GPA => uHVA cache intact, it's protected by the
 		 * memslot generation.  The PFN lookup needs to be redone every
 		 * time as mmu_notifier protection is lost when the cache is
-		 * removed from the VM's gpc_list.
+		 * removed from the VM's gpc_tree.
 		 */
 		old_khva = gpc->khva - offset_in_page(gpc->khva);
 		gpc->khva = NULL;
@@ -408,9 +439,11 @@ void kvm_gpc_deactivate(struct gfn_to_pfn_cache *gpc)
 		gpc->pfn = KVM_PFN_ERR_FAULT;
 		write_unlock_irq(&gpc->lock);
 
+		mutex_lock(&gpc->refresh_lock);
 		spin_lock(&kvm->gpc_lock);
-		list_del(&gpc->list);
+		interval_tree_remove(&gpc->node, &kvm->gpc_tree);
 		spin_unlock(&kvm->gpc_lock);
+		mutex_unlock(&gpc->refresh_lock);
 
 		gpc_unmap_khva(old_pfn, old_khva);
 	}